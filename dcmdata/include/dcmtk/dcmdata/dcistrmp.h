@@ -0,0 +1,294 @@
+/*
+ *
+ *  Copyright (C) 2016, OFFIS e.V.
+ *  All rights reserved.  See COPYRIGHT file for details.
+ *
+ *  This software and supporting documentation were developed by
+ *
+ *    OFFIS e.V.
+ *    R&D Division Health
+ *    Escherweg 2
+ *    D-26121 Oldenburg, Germany
+ *
+ *
+ *  Module:  dcmdata
+ *
+ *  Author:  OFFIS DICOM Team
+ *
+ *  Purpose: DcmInputPixelStream and related classes,
+ *    implements streamed input of uncompressed pixel data that is
+ *    decompressed frame by frame from an encapsulated pixel data element.
+ *
+ */
+
+#ifndef DCISTRMP_H
+#define DCISTRMP_H
+
+#include "dcmtk/config/osconfig.h"
+#include "dcmtk/dcmdata/dcistrma.h"
+#include "dcmtk/dcmdata/dcfcache.h"
+
+class DcmItem;
+class DcmPixelData;
+class DcmPixelFramePrefetcher;
+
+/** producer class that delivers the uncompressed pixel data of a compressed
+ *  (encapsulated) pixel data element. The frames are decompressed one at a time
+ *  when they are needed, so that at most two uncompressed frames are kept in
+ *  memory. If the toolkit is compiled with thread support, the next frame is
+ *  decompressed in a separate thread while the current frame is consumed, e.g.
+ *  while it is written to a network connection.
+ */
+class DCMTK_DCMDATA_EXPORT DcmPixelFrameProducer: public DcmProducer
+{
+public:
+  /** constructor
+   *  @param dataset dataset in which the pixel data element is located. Used to
+   *    access rows, columns, samples per pixel etc. Must not be modified and must
+   *    exist as long as this object exists.
+   *  @param pixelData pixel data element with a compressed representation. Must
+   *    not be modified and must exist as long as this object exists.
+   *  @param numberOfFrames number of frames to be delivered
+   *  @param frameSize size of a single uncompressed frame in bytes
+   */
+  DcmPixelFrameProducer(DcmItem *dataset,
+                        DcmPixelData *pixelData,
+                        Uint32 numberOfFrames,
+                        Uint32 frameSize);
+
+  /// destructor
+  virtual ~DcmPixelFrameProducer();
+
+  /** returns the status of the producer. Unless the status is good,
+   *  the producer will not permit any operation.
+   *  @return status, true if good
+   */
+  virtual OFBool good() const;
+
+  /** returns the status of the producer as an OFCondition object.
+   *  Unless the status is good, the producer will not permit any operation.
+   *  @return status, EC_Normal if good
+   */
+  virtual OFCondition status() const;
+
+  /** returns true if the producer is at the end of stream.
+   *  @return true if end of stream, false otherwise
+   */
+  virtual OFBool eos();
+
+  /** returns the minimum number of bytes that can be read with the
+   *  next call to read().
+   *  @return minimum of data available in producer
+   */
+  virtual offile_off_t avail();
+
+  /** reads as many bytes as possible into the given block. Frames are
+   *  decompressed as needed.
+   *  @param buf pointer to memory block, must not be NULL
+   *  @param buflen length of memory block
+   *  @return number of bytes actually read.
+   */
+  virtual offile_off_t read(void *buf, offile_off_t buflen);
+
+  /** skips over the given number of bytes (or less). Skipped frames are
+   *  not decompressed.
+   *  @param skiplen number of bytes to skip
+   *  @return number of bytes actually skipped.
+   */
+  virtual offile_off_t skip(offile_off_t skiplen);
+
+  /** resets the stream to the position by the given number of bytes.
+   *  @param num number of bytes to putback. If the putback operation
+   *    fails, the producer status becomes bad.
+   */
+  virtual void putback(offile_off_t num);
+
+  /** returns the total number of bytes delivered by this producer, i.e.\ the
+   *  size of all uncompressed frames plus a pad byte if this size is odd.
+   *  @return length of uncompressed pixel data value
+   */
+  offile_off_t length() const { return length_; }
+
+  /** decompresses the given frame into the given buffer. This method is
+   *  only used internally (and by the prefetch thread).
+   *  @param frameNo number of frame, starting with 0
+   *  @param buffer buffer of at least frameSize bytes (rounded up to an even number)
+   *  @return EC_Normal if successful, an error code otherwise
+   */
+  OFCondition decodeFrame(Uint32 frameNo, Uint8 *buffer);
+
+private:
+
+  /// private unimplemented copy constructor
+  DcmPixelFrameProducer(const DcmPixelFrameProducer&);
+
+  /// private unimplemented copy assignment operator
+  DcmPixelFrameProducer& operator=(const DcmPixelFrameProducer&);
+
+  /** makes sure that the given frame is available in the current frame buffer
+   *  @param frameNo number of frame, starting with 0
+   *  @return EC_Normal if successful, an error code otherwise
+   */
+  OFCondition loadFrame(Uint32 frameNo);
+
+  /** waits for the prefetch thread (if any) to finish
+   *  @return number of the frame decompressed by the prefetch thread, or
+   *    numberOfFrames_ if no frame has been prefetched
+   */
+  Uint32 finishPrefetch();
+
+  /// dataset in which the pixel data element is located
+  DcmItem *dataset_;
+
+  /// pixel data element with compressed representation
+  DcmPixelData *pixelData_;
+
+  /// number of frames
+  Uint32 numberOfFrames_;
+
+  /// size of an uncompressed frame in bytes
+  Uint32 frameSize_;
+
+  /// total number of bytes delivered (including pad byte)
+  offile_off_t length_;
+
+  /// current read position
+  offile_off_t position_;
+
+  /// buffer containing the current frame
+  Uint8 *currentBuffer_;
+
+  /// buffer for the next frame (filled by the prefetch thread)
+  Uint8 *nextBuffer_;
+
+  /// number of the frame in the current frame buffer (numberOfFrames_ if none)
+  Uint32 currentFrame_;
+
+  /// number of the frame that follows the last decompressed frame
+  Uint32 nextFrameToDecode_;
+
+  /// index of the fragment that contains the next frame to be decompressed
+  Uint32 startFragment_;
+
+  /// file cache used when reading compressed fragments from file
+  DcmFileCache cache_;
+
+  /// prefetch thread, NULL if none is running
+  DcmPixelFramePrefetcher *prefetcher_;
+
+  /// status
+  OFCondition status_;
+};
+
+
+/** input stream factory for uncompressed pixel data that is decompressed
+ *  frame by frame from a compressed pixel data element
+ */
+class DCMTK_DCMDATA_EXPORT DcmInputPixelStreamFactory: public DcmInputStreamFactory
+{
+public:
+  /** constructor
+   *  @param dataset dataset in which the pixel data element is located. Must not
+   *    be modified and must exist as long as this factory exists.
+   *  @param pixelData pixel data element with a compressed representation. Must
+   *    not be modified and must exist as long as this factory exists.
+   *  @param numberOfFrames number of frames to be delivered
+   *  @param frameSize size of a single uncompressed frame in bytes
+   */
+  DcmInputPixelStreamFactory(DcmItem *dataset,
+                             DcmPixelData *pixelData,
+                             Uint32 numberOfFrames,
+                             Uint32 frameSize);
+
+  /// copy constructor
+  DcmInputPixelStreamFactory(const DcmInputPixelStreamFactory &arg);
+
+  /// destructor
+  virtual ~DcmInputPixelStreamFactory();
+
+  /** create a new input stream object
+   *  @return pointer to new input stream object
+   */
+  virtual DcmInputStream *create() const;
+
+  /** returns a pointer to a copy of this object
+   */
+  virtual DcmInputStreamFactory *clone() const
+  {
+    return new DcmInputPixelStreamFactory(*this);
+  }
+
+private:
+
+  /// private unimplemented copy assignment operator
+  DcmInputPixelStreamFactory& operator=(const DcmInputPixelStreamFactory&);
+
+  /// dataset in which the pixel data element is located
+  DcmItem *dataset_;
+
+  /// pixel data element with compressed representation
+  DcmPixelData *pixelData_;
+
+  /// number of frames
+  Uint32 numberOfFrames_;
+
+  /// size of an uncompressed frame in bytes
+  Uint32 frameSize_;
+};
+
+
+/** input stream that delivers uncompressed pixel data which is decompressed
+ *  frame by frame from a compressed pixel data element. An element value can
+ *  be bound to this stream using DcmElement::createValueFromTempFile() together
+ *  with a DcmInputPixelStreamFactory. When such an element is written (e.g.\ to
+ *  a network connection), the pixel data is never completely held in memory.
+ */
+class DCMTK_DCMDATA_EXPORT DcmInputPixelStream: public DcmInputStream
+{
+public:
+  /** constructor
+   *  @param dataset dataset in which the pixel data element is located
+   *  @param pixelData pixel data element with a compressed representation
+   *  @param numberOfFrames number of frames to be delivered
+   *  @param frameSize size of a single uncompressed frame in bytes
+   */
+  DcmInputPixelStream(DcmItem *dataset,
+                      DcmPixelData *pixelData,
+                      Uint32 numberOfFrames,
+                      Uint32 frameSize);
+
+  /// destructor
+  virtual ~DcmInputPixelStream();
+
+  /** creates a new factory object for the current stream and stream position.
+   *  Since the stream cannot be repositioned, this is only possible at the
+   *  start of the stream.
+   *  @return pointer to new factory object if successful, NULL otherwise.
+   */
+  virtual DcmInputStreamFactory *newFactory() const;
+
+private:
+
+  /// private unimplemented copy constructor
+  DcmInputPixelStream(const DcmInputPixelStream&);
+
+  /// private unimplemented copy assignment operator
+  DcmInputPixelStream& operator=(const DcmInputPixelStream&);
+
+  /// the final producer of the filter chain
+  DcmPixelFrameProducer producer_;
+
+  /// dataset in which the pixel data element is located
+  DcmItem *dataset_;
+
+  /// pixel data element with compressed representation
+  DcmPixelData *pixelData_;
+
+  /// number of frames
+  Uint32 numberOfFrames_;
+
+  /// size of an uncompressed frame in bytes
+  Uint32 frameSize_;
+};
+
+#endif
@@ -0,0 +1,351 @@
+/*
+ *
+ *  Copyright (C) 2016, OFFIS e.V.
+ *  All rights reserved.  See COPYRIGHT file for details.
+ *
+ *  This software and supporting documentation were developed by
+ *
+ *    OFFIS e.V.
+ *    R&D Division Health
+ *    Escherweg 2
+ *    D-26121 Oldenburg, Germany
+ *
+ *
+ *  Module:  dcmdata
+ *
+ *  Author:  OFFIS DICOM Team
+ *
+ *  Purpose: DcmInputPixelStream and related classes,
+ *    implements streamed input of uncompressed pixel data that is
+ *    decompressed frame by frame from an encapsulated pixel data element.
+ *
+ */
+
+#include "dcmtk/config/osconfig.h"
+#include "dcmtk/dcmdata/dcistrmp.h"
+#include "dcmtk/dcmdata/dcpixel.h"
+#include "dcmtk/dcmdata/dcerror.h"
+
+#ifdef WITH_THREADS
+#include "dcmtk/ofstd/ofthread.h"
+#endif
+
+#define INCLUDE_CSTRING
+#include "dcmtk/ofstd/ofstdinc.h"
+
+
+#ifdef WITH_THREADS
+
+/** helper class that decompresses a single frame in a separate thread
+ */
+class DcmPixelFramePrefetcher: public OFThread
+{
+public:
+  /** constructor
+   *  @param producer producer that decompresses the frame
+   *  @param frameNo number of frame to be decompressed
+   *  @param buffer buffer to which the frame is decompressed
+   */
+  DcmPixelFramePrefetcher(DcmPixelFrameProducer &producer, Uint32 frameNo, Uint8 *buffer)
+  : OFThread()
+  , producer_(producer)
+  , frameNo_(frameNo)
+  , buffer_(buffer)
+  , result_()
+  {
+  }
+
+  /// number of the frame that is decompressed
+  Uint32 frameNo() const { return frameNo_; }
+
+  /// result of the decompression, only valid after join()
+  const OFCondition &result() const { return result_; }
+
+protected:
+
+  /// decompress the frame
+  virtual void run()
+  {
+    result_ = producer_.decodeFrame(frameNo_, buffer_);
+  }
+
+private:
+
+  /// private unimplemented copy constructor
+  DcmPixelFramePrefetcher(const DcmPixelFramePrefetcher&);
+
+  /// private unimplemented copy assignment operator
+  DcmPixelFramePrefetcher& operator=(const DcmPixelFramePrefetcher&);
+
+  /// producer that decompresses the frame
+  DcmPixelFrameProducer &producer_;
+  /// number of frame to be decompressed
+  Uint32 frameNo_;
+  /// target buffer
+  Uint8 *buffer_;
+  /// result of the decompression
+  OFCondition result_;
+};
+
+#endif
+
+
+DcmPixelFrameProducer::DcmPixelFrameProducer(DcmItem *dataset,
+                                             DcmPixelData *pixelData,
+                                             Uint32 numberOfFrames,
+                                             Uint32 frameSize)
+: DcmProducer()
+, dataset_(dataset)
+, pixelData_(pixelData)
+, numberOfFrames_(numberOfFrames)
+, frameSize_(frameSize)
+, length_(OFstatic_cast(offile_off_t, numberOfFrames) * frameSize)
+, position_(0)
+, currentBuffer_(NULL)
+, nextBuffer_(NULL)
+, currentFrame_(numberOfFrames)
+, nextFrameToDecode_(0)
+, startFragment_(0)
+, cache_()
+, prefetcher_(NULL)
+, status_(EC_Normal)
+{
+  // the value of an attribute must always have an even length
+  if (length_ & 1) ++length_;
+  if ((dataset_ == NULL) || (pixelData_ == NULL) || (numberOfFrames_ == 0) || (frameSize_ == 0))
+    status_ = EC_IllegalCall;
+  else
+  {
+    // the decoder may need an extra pad byte if the frame size is odd
+    const Uint32 bufSize = frameSize_ + (frameSize_ & 1);
+    currentBuffer_ = new Uint8[bufSize];
+#ifdef WITH_THREADS
+    // a second buffer is only needed if frames are decompressed in advance
+    if (numberOfFrames_ > 1) nextBuffer_ = new Uint8[bufSize];
+#endif
+  }
+}
+
+
+DcmPixelFrameProducer::~DcmPixelFrameProducer()
+{
+  finishPrefetch();
+  delete[] currentBuffer_;
+  delete[] nextBuffer_;
+}
+
+
+OFBool DcmPixelFrameProducer::good() const
+{
+  return status_.good();
+}
+
+
+OFCondition DcmPixelFrameProducer::status() const
+{
+  return status_;
+}
+
+
+OFBool DcmPixelFrameProducer::eos()
+{
+  return (position_ >= length_);
+}
+
+
+offile_off_t DcmPixelFrameProducer::avail()
+{
+  if (status_.good()) return length_ - position_;
+  return 0;
+}
+
+
+offile_off_t DcmPixelFrameProducer::read(void *buf, offile_off_t buflen)
+{
+  offile_off_t result = 0;
+  if (status_.good() && buf)
+  {
+    const offile_off_t frameDataLength = OFstatic_cast(offile_off_t, numberOfFrames_) * frameSize_;
+    unsigned char *target = OFstatic_cast(unsigned char *, buf);
+    offile_off_t numBytes;
+    while ((buflen > 0) && (position_ < length_))
+    {
+      if (position_ >= frameDataLength)
+      {
+        // pad byte after the last frame
+        numBytes = length_ - position_;
+        if (numBytes > buflen) numBytes = buflen;
+        memset(target, 0, OFstatic_cast(size_t, numBytes));
+      }
+      else
+      {
+        const Uint32 frameNo = OFstatic_cast(Uint32, position_ / frameSize_);
+        if (loadFrame(frameNo).bad()) break;
+        const offile_off_t offset = position_ - OFstatic_cast(offile_off_t, frameNo) * frameSize_;
+        numBytes = frameSize_ - offset;
+        if (numBytes > buflen) numBytes = buflen;
+        memcpy(target, currentBuffer_ + offset, OFstatic_cast(size_t, numBytes));
+      }
+      target += numBytes;
+      buflen -= numBytes;
+      position_ += numBytes;
+      result += numBytes;
+    }
+  }
+  return result;
+}
+
+
+offile_off_t DcmPixelFrameProducer::skip(offile_off_t skiplen)
+{
+  offile_off_t result = 0;
+  if (status_.good())
+  {
+    // frames that are skipped completely are never decompressed
+    result = length_ - position_;
+    if (result > skiplen) result = skiplen;
+    position_ += result;
+  }
+  return result;
+}
+
+
+void DcmPixelFrameProducer::putback(offile_off_t num)
+{
+  if (status_.good() && num)
+  {
+    if (num <= position_) position_ -= num;
+    else status_ = EC_PutbackFailed; // tried to putback before start of stream
+  }
+}
+
+
+OFCondition DcmPixelFrameProducer::decodeFrame(Uint32 frameNo, Uint8 *buffer)
+{
+  // the index of the first fragment is only known if frames are decompressed in order
+  Uint32 startFragment = (frameNo == nextFrameToDecode_) ? startFragment_ : 0;
+  OFString decompressedColorModel;
+  OFCondition result = pixelData_->getUncompressedFrame(dataset_, frameNo, startFragment,
+    buffer, frameSize_ + (frameSize_ & 1), decompressedColorModel, &cache_);
+  if (result.good())
+  {
+    startFragment_ = startFragment;
+    nextFrameToDecode_ = frameNo + 1;
+  }
+  return result;
+}
+
+
+OFCondition DcmPixelFrameProducer::loadFrame(Uint32 frameNo)
+{
+  if (frameNo == currentFrame_) return EC_Normal;
+  OFCondition result = EC_Normal;
+  if (finishPrefetch() == frameNo)
+  {
+    // the requested frame has already been decompressed in the background
+    Uint8 *tmp = currentBuffer_;
+    currentBuffer_ = nextBuffer_;
+    nextBuffer_ = tmp;
+  }
+  else result = decodeFrame(frameNo, currentBuffer_);
+  if (result.bad())
+  {
+    currentFrame_ = numberOfFrames_;
+    status_ = result;
+    return result;
+  }
+  currentFrame_ = frameNo;
+#ifdef WITH_THREADS
+  // decompress the next frame while the current one is being consumed
+  if (frameNo + 1 < numberOfFrames_)
+  {
+    prefetcher_ = new DcmPixelFramePrefetcher(*this, frameNo + 1, nextBuffer_);
+    if (prefetcher_->start() != 0)
+    {
+      delete prefetcher_;
+      prefetcher_ = NULL;
+    }
+  }
+#endif
+  return result;
+}
+
+
+Uint32 DcmPixelFrameProducer::finishPrefetch()
+{
+  Uint32 result = numberOfFrames_;
+#ifdef WITH_THREADS
+  if (prefetcher_)
+  {
+    prefetcher_->join();
+    // in case of error, the frame is decompressed again (and the error reported) when needed
+    if (prefetcher_->result().good()) result = prefetcher_->frameNo();
+    delete prefetcher_;
+    prefetcher_ = NULL;
+  }
+#endif
+  return result;
+}
+
+
+/* ======================================================================= */
+
+DcmInputPixelStreamFactory::DcmInputPixelStreamFactory(DcmItem *dataset,
+                                                       DcmPixelData *pixelData,
+                                                       Uint32 numberOfFrames,
+                                                       Uint32 frameSize)
+: DcmInputStreamFactory()
+, dataset_(dataset)
+, pixelData_(pixelData)
+, numberOfFrames_(numberOfFrames)
+, frameSize_(frameSize)
+{
+}
+
+DcmInputPixelStreamFactory::DcmInputPixelStreamFactory(const DcmInputPixelStreamFactory& arg)
+: DcmInputStreamFactory(arg)
+, dataset_(arg.dataset_)
+, pixelData_(arg.pixelData_)
+, numberOfFrames_(arg.numberOfFrames_)
+, frameSize_(arg.frameSize_)
+{
+}
+
+DcmInputPixelStreamFactory::~DcmInputPixelStreamFactory()
+{
+}
+
+DcmInputStream *DcmInputPixelStreamFactory::create() const
+{
+  return new DcmInputPixelStream(dataset_, pixelData_, numberOfFrames_, frameSize_);
+}
+
+/* ======================================================================= */
+
+DcmInputPixelStream::DcmInputPixelStream(DcmItem *dataset,
+                                         DcmPixelData *pixelData,
+                                         Uint32 numberOfFrames,
+                                         Uint32 frameSize)
+: DcmInputStream(&producer_) // safe because DcmInputStream only stores pointer
+, producer_(dataset, pixelData, numberOfFrames, frameSize)
+, dataset_(dataset)
+, pixelData_(pixelData)
+, numberOfFrames_(numberOfFrames)
+, frameSize_(frameSize)
+{
+}
+
+DcmInputPixelStream::~DcmInputPixelStream()
+{
+}
+
+DcmInputStreamFactory *DcmInputPixelStream::newFactory() const
+{
+  DcmInputStreamFactory *result = NULL;
+  if ((currentProducer() == &producer_) && (tell() == 0))
+  {
+    // no filter installed and still at the start of the stream
+    result = new DcmInputPixelStreamFactory(dataset_, pixelData_, numberOfFrames_, frameSize_);
+  }
+  return result;
+}
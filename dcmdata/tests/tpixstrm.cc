@@ -0,0 +1,103 @@
+/*
+ *
+ *  Copyright (C) 2016, OFFIS e.V.
+ *  All rights reserved.  See COPYRIGHT file for details.
+ *
+ *  This software and supporting documentation were developed by
+ *
+ *    OFFIS e.V.
+ *    R&D Division Health
+ *    Escherweg 2
+ *    D-26121 Oldenburg, Germany
+ *
+ *
+ *  Module:  dcmdata
+ *
+ *  Author:  OFFIS DICOM Team
+ *
+ *  Purpose: test program for class DcmInputPixelStream
+ *
+ */
+
+
+#include "dcmtk/config/osconfig.h"    /* make sure OS specific configuration is included first */
+
+#include "dcmtk/ofstd/oftest.h"
+#include "dcmtk/dcmdata/dctk.h"
+#include "dcmtk/dcmdata/dcistrmp.h"
+#include "dcmtk/dcmdata/dcrleerg.h"
+#include "dcmtk/dcmdata/dcrledrg.h"
+
+
+static const Uint16 ROWS = 5;
+static const Uint16 COLUMNS = 3;
+static const Uint32 FRAMES = 3;
+static const Uint32 FRAME_SIZE = ROWS * COLUMNS;
+
+OFTEST(dcmdata_pixelDataStream)
+{
+    /* make sure data dictionary is loaded */
+    if (!dcmDataDict.isDictionaryLoaded())
+    {
+      OFCHECK_FAIL("no data dictionary loaded, check environment variable: " DCM_DICT_ENVIRONMENT_VARIABLE);
+      return;
+    }
+
+    /* create a multi-frame image with an odd frame size */
+    Uint8 pixels[FRAMES * FRAME_SIZE];
+    for (Uint32 i = 0; i < FRAMES * FRAME_SIZE; ++i)
+        pixels[i] = OFstatic_cast(Uint8, (i * 7) % 251);
+    DcmDataset dset;
+    OFCHECK(dset.putAndInsertUint16(DCM_SamplesPerPixel, 1).good());
+    OFCHECK(dset.putAndInsertString(DCM_PhotometricInterpretation, "MONOCHROME2").good());
+    OFCHECK(dset.putAndInsertString(DCM_NumberOfFrames, "3").good());
+    OFCHECK(dset.putAndInsertUint16(DCM_Rows, ROWS).good());
+    OFCHECK(dset.putAndInsertUint16(DCM_Columns, COLUMNS).good());
+    OFCHECK(dset.putAndInsertUint16(DCM_BitsAllocated, 8).good());
+    OFCHECK(dset.putAndInsertUint16(DCM_BitsStored, 8).good());
+    OFCHECK(dset.putAndInsertUint16(DCM_HighBit, 7).good());
+    OFCHECK(dset.putAndInsertUint16(DCM_PixelRepresentation, 0).good());
+    OFCHECK(dset.putAndInsertUint8Array(DCM_PixelData, pixels, FRAMES * FRAME_SIZE).good());
+
+    /* compress the pixel data and discard the uncompressed representation */
+    DcmRLEEncoderRegistration::registerCodecs();
+    DcmRLEDecoderRegistration::registerCodecs();
+    OFCHECK(dset.chooseRepresentation(EXS_RLELossless, NULL).good());
+    dset.removeAllButCurrentRepresentations();
+    DcmElement *elem = NULL;
+    OFCHECK(dset.findAndGetElement(DCM_PixelData, elem).good());
+    DcmPixelData *pixelData = OFstatic_cast(DcmPixelData *, elem);
+    OFCHECK(pixelData != NULL && !pixelData->hasRepresentation(EXS_LittleEndianExplicit));
+
+    if (pixelData != NULL)
+    {
+        /* read the stream directly, in blocks that do not match the frame size */
+        DcmInputPixelStream stream(&dset, pixelData, FRAMES, FRAME_SIZE);
+        OFCHECK(stream.good());
+        OFCHECK_EQUAL(stream.avail(), OFstatic_cast(offile_off_t, FRAMES * FRAME_SIZE + 1));
+        DcmInputStreamFactory *factory = stream.newFactory();
+        OFCHECK(factory != NULL);
+        delete factory;
+        Uint8 buffer[FRAMES * FRAME_SIZE + 1];
+        offile_off_t pos = 0;
+        while (!stream.eos() && stream.good())
+            pos += stream.read(buffer + pos, 4);
+        OFCHECK(stream.good());
+        OFCHECK_EQUAL(pos, OFstatic_cast(offile_off_t, FRAMES * FRAME_SIZE + 1));
+        OFCHECK(memcmp(buffer, pixels, FRAMES * FRAME_SIZE) == 0);
+        OFCHECK_EQUAL(buffer[FRAMES * FRAME_SIZE], 0);
+        /* no factory can be created once the stream has been read */
+        OFCHECK(stream.newFactory() == NULL);
+
+        /* bind the stream to an element value, which is loaded on demand */
+        DcmOtherByteOtherWord element(DcmTag(DCM_PixelData, EVR_OB));
+        OFCHECK(element.createValueFromTempFile(new DcmInputPixelStreamFactory(&dset, pixelData, FRAMES, FRAME_SIZE),
+            FRAMES * FRAME_SIZE + 1, gLocalByteOrder).good());
+        Uint8 *value = NULL;
+        OFCHECK(element.getUint8Array(value).good());
+        OFCHECK(value != NULL && memcmp(value, pixels, FRAMES * FRAME_SIZE) == 0);
+    }
+
+    DcmRLEDecoderRegistration::cleanup();
+    DcmRLEEncoderRegistration::cleanup();
+}
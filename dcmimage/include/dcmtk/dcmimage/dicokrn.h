@@ -0,0 +1,280 @@
+/*
+ *
+ *  Copyright (C) 2016, OFFIS e.V.
+ *  All rights reserved.  See COPYRIGHT file for details.
+ *
+ *  This software and supporting documentation were developed by
+ *
+ *    OFFIS e.V.
+ *    R&D Division Health
+ *    Escherweg 2
+ *    D-26121 Oldenburg, Germany
+ *
+ *
+ *  Module:  dcmimage
+ *
+ *  Author:  OFFIS DICOM Team
+ *
+ *  Purpose: DicomColorKernel (Header)
+ *
+ */
+
+
+#ifndef DICOKRN_H
+#define DICOKRN_H
+
+#include "dcmtk/config/osconfig.h"
+#include "dcmtk/ofstd/oftypes.h"
+#include "dcmtk/ofstd/ofcast.h"
+
+#include "dcmtk/dcmimage/dicdefin.h"
+#include "dcmtk/dcmimage/dicopxt.h"
+
+
+/*---------------------*
+ *  class declaration  *
+ *---------------------*/
+
+/** Class implementing the inner loops of the color model conversion and of the reordering
+ *  of color pixel data (color-by-pixel vs. color-by-plane), i.e. the most time consuming
+ *  parts of loading and rendering color images (e.g. multi-frame ultrasound or endoscopy
+ *  images).
+ *  The generic implementations process one pixel after the other. For unsigned 8 bit data,
+ *  vectorized implementations are provided where the compiler supports SSE2 (which is always
+ *  the case on x86-64). They use fixed-point arithmetic and produce exactly the same output
+ *  values as the generic implementations.
+ */
+class DCMTK_DCMIMAGE_EXPORT DiColorKernel
+{
+
+ public:
+
+    /** convert YCbCr (full range) pixel data with 8 bits per sample to RGB (generic version).
+     *  The pixel data is either stored color-by-pixel (step = 3) or color-by-plane (step = 1).
+     *  The conversion uses lookup tables with integer values for the chrominance parts.
+     *
+     ** @param  y      pointer to the first luminance value
+     *  @param  cb     pointer to the first blue chrominance value
+     *  @param  cr     pointer to the first red chrominance value
+     *  @param  step   distance between two consecutive values of the same component
+     *  @param  red    pointer to the output values of the red component
+     *  @param  green  pointer to the output values of the green component
+     *  @param  blue   pointer to the output values of the blue component
+     *  @param  count  number of pixels to be converted
+     */
+    template<class T1, class T2>
+    static void convertYBRToRGB(const T1 *y,
+                                const T1 *cb,
+                                const T1 *cr,
+                                const unsigned long step,
+                                T2 *red,
+                                T2 *green,
+                                T2 *blue,
+                                const unsigned long count)
+    {
+        Sint16 rcr_tab[256];
+        Sint16 gcb_tab[256];
+        Sint16 gcr_tab[256];
+        Sint16 bcb_tab[256];
+        initYBRTables(rcr_tab, gcb_tab, gcr_tab, bcb_tab);
+        unsigned long i;
+        for (i = count; i != 0; --i, y += step, cb += step, cr += step)
+            convertYBRValue(*y, *cb, *cr, rcr_tab, gcb_tab, gcr_tab, bcb_tab, *(red++), *(green++), *(blue++));
+    }
+
+    /** convert YCbCr (full range) pixel data with 8 bits per sample to RGB (version for
+     *  unsigned 8 bit data).  See generic version for details.
+     */
+    static void convertYBRToRGB(const Uint8 *y,
+                                const Uint8 *cb,
+                                const Uint8 *cr,
+                                const unsigned long step,
+                                Uint8 *red,
+                                Uint8 *green,
+                                Uint8 *blue,
+                                const unsigned long count);
+
+    /** convert YCbCr 4:2:2 (full range) pixel data with 8 bits per sample to RGB (generic
+     *  version).  The pixel data is stored color-by-pixel (Y1 Y2 Cb Cr), i.e. each pair of
+     *  pixels shares the chrominance values.  Unlike convertYBRToRGB(), the conversion is
+     *  computed with floating-point values (without lookup tables).
+     *
+     ** @param  pixel  pointer to the input pixel data
+     *  @param  red    pointer to the output values of the red component
+     *  @param  green  pointer to the output values of the green component
+     *  @param  blue   pointer to the output values of the blue component
+     *  @param  count  number of pixels to be converted (should be even)
+     */
+    template<class T1, class T2>
+    static void convertYBR422ToRGB(const T1 *pixel,
+                                   T2 *red,
+                                   T2 *green,
+                                   T2 *blue,
+                                   const unsigned long count)
+    {
+        const T1 *p = pixel;
+        unsigned long i;
+        for (i = count / 2; i != 0; --i, p += 4)
+        {
+            convertYBR422Value(p[0], p[2], p[3], *(red++), *(green++), *(blue++));
+            convertYBR422Value(p[1], p[2], p[3], *(red++), *(green++), *(blue++));
+        }
+    }
+
+    /** convert YCbCr 4:2:2 (full range) pixel data with 8 bits per sample to RGB (version for
+     *  unsigned 8 bit data).  See generic version for details.
+     */
+    static void convertYBR422ToRGB(const Uint8 *pixel,
+                                   Uint8 *red,
+                                   Uint8 *green,
+                                   Uint8 *blue,
+                                   const unsigned long count);
+
+    /** split color-by-pixel data into three planes (generic version).
+     *  The sign of the input values is removed (see removeSign()).
+     *
+     ** @param  pixel   pointer to the input pixel data (color-by-pixel)
+     *  @param  plane0  pointer to the output values of the first component
+     *  @param  plane1  pointer to the output values of the second component
+     *  @param  plane2  pointer to the output values of the third component
+     *  @param  count   number of pixels to be processed
+     *  @param  offset  offset used to remove the sign of the input values
+     */
+    template<class T1, class T2>
+    static void deinterleave(const T1 *pixel,
+                             T2 *plane0,
+                             T2 *plane1,
+                             T2 *plane2,
+                             const unsigned long count,
+                             const T1 offset)
+    {
+        const T1 *p = pixel;
+        unsigned long i;
+        for (i = count; i != 0; --i)
+        {
+            *(plane0++) = removeSign(*(p++), offset);
+            *(plane1++) = removeSign(*(p++), offset);
+            *(plane2++) = removeSign(*(p++), offset);
+        }
+    }
+
+    /** split color-by-pixel data into three planes (version for unsigned 8 bit data).
+     *  See generic version for details.
+     */
+    static void deinterleave(const Uint8 *pixel,
+                             Uint8 *plane0,
+                             Uint8 *plane1,
+                             Uint8 *plane2,
+                             const unsigned long count,
+                             const Uint8 offset);
+
+    /** merge three planes into color-by-pixel data (generic version)
+     *
+     ** @param  plane0   pointer to the input values of the first component
+     *  @param  plane1   pointer to the input values of the second component
+     *  @param  plane2   pointer to the input values of the third component
+     *  @param  pixel    pointer to the output pixel data (color-by-pixel)
+     *  @param  count    number of pixels to be processed
+     *  @param  inverse  invert values if true, i.e. subtract them from 'maxvalue'
+     *  @param  maxvalue maximum output value (used for the inversion)
+     */
+    template<class T1, class T2>
+    static void interleave(const T1 *plane0,
+                           const T1 *plane1,
+                           const T1 *plane2,
+                           T2 *pixel,
+                           const unsigned long count,
+                           const int inverse,
+                           const T2 maxvalue)
+    {
+        T2 *q = pixel;
+        unsigned long i;
+        if (inverse)
+        {
+            for (i = count; i != 0; --i)
+            {
+                *(q++) = maxvalue - OFstatic_cast(T2, *(plane0++));
+                *(q++) = maxvalue - OFstatic_cast(T2, *(plane1++));
+                *(q++) = maxvalue - OFstatic_cast(T2, *(plane2++));
+            }
+        } else {
+            for (i = count; i != 0; --i)
+            {
+                *(q++) = OFstatic_cast(T2, *(plane0++));
+                *(q++) = OFstatic_cast(T2, *(plane1++));
+                *(q++) = OFstatic_cast(T2, *(plane2++));
+            }
+        }
+    }
+
+    /** merge three planes into color-by-pixel data (version for unsigned 8 bit data).
+     *  See generic version for details.
+     */
+    static void interleave(const Uint8 *plane0,
+                           const Uint8 *plane1,
+                           const Uint8 *plane2,
+                           Uint8 *pixel,
+                           const unsigned long count,
+                           const int inverse,
+                           const Uint8 maxvalue);
+
+
+ private:
+
+    /** initialize the lookup tables for the chrominance parts of the YCbCr to RGB conversion
+     *
+     ** @param  rcr_tab  table for the red component (Cr part), 256 entries
+     *  @param  gcb_tab  table for the green component (Cb part), 256 entries
+     *  @param  gcr_tab  table for the green component (Cr part), 256 entries
+     *  @param  bcb_tab  table for the blue component (Cb part), 256 entries
+     */
+    static void initYBRTables(Sint16 *rcr_tab,
+                              Sint16 *gcb_tab,
+                              Sint16 *gcr_tab,
+                              Sint16 *bcb_tab);
+
+    /** convert a single YCbCr value to RGB using the given lookup tables
+     */
+    template<class T1, class T2>
+    static inline void convertYBRValue(const T1 y,
+                                       const T1 cb,
+                                       const T1 cr,
+                                       const Sint16 *rcr_tab,
+                                       const Sint16 *gcb_tab,
+                                       const Sint16 *gcr_tab,
+                                       const Sint16 *bcb_tab,
+                                       T2 &red,
+                                       T2 &green,
+                                       T2 &blue)
+    {
+        const Sint32 maxvalue = 255;
+        const Sint32 sr = OFstatic_cast(Sint32, y) + OFstatic_cast(Sint32, rcr_tab[OFstatic_cast(Uint32, cr)]);
+        const Sint32 sg = OFstatic_cast(Sint32, y) - OFstatic_cast(Sint32, gcb_tab[OFstatic_cast(Uint32, cb)]) - OFstatic_cast(Sint32, gcr_tab[OFstatic_cast(Uint32, cr)]);
+        const Sint32 sb = OFstatic_cast(Sint32, y) + OFstatic_cast(Sint32, bcb_tab[OFstatic_cast(Uint32, cb)]);
+        red   = (sr < 0) ? 0 : (sr > maxvalue) ? OFstatic_cast(T2, maxvalue) : OFstatic_cast(T2, sr);
+        green = (sg < 0) ? 0 : (sg > maxvalue) ? OFstatic_cast(T2, maxvalue) : OFstatic_cast(T2, sg);
+        blue  = (sb < 0) ? 0 : (sb > maxvalue) ? OFstatic_cast(T2, maxvalue) : OFstatic_cast(T2, sb);
+    }
+
+    /** convert a single YCbCr value to RGB using floating-point arithmetic
+     */
+    template<class T1, class T2>
+    static inline void convertYBR422Value(const T1 y,
+                                          const T1 cb,
+                                          const T1 cr,
+                                          T2 &red,
+                                          T2 &green,
+                                          T2 &blue)
+    {
+        const double maxvalue = 255;
+        const double dr = OFstatic_cast(double, y) + 1.4020 * OFstatic_cast(double, cr) - 0.7010 * maxvalue;
+        const double dg = OFstatic_cast(double, y) - 0.3441 * OFstatic_cast(double, cb) - 0.7141 * OFstatic_cast(double, cr) + 0.5291 * maxvalue;
+        const double db = OFstatic_cast(double, y) + 1.7720 * OFstatic_cast(double, cb) - 0.8859 * maxvalue;
+        red   = (dr < 0.0) ? 0 : (dr > maxvalue) ? OFstatic_cast(T2, maxvalue) : OFstatic_cast(T2, dr);
+        green = (dg < 0.0) ? 0 : (dg > maxvalue) ? OFstatic_cast(T2, maxvalue) : OFstatic_cast(T2, dg);
+        blue  = (db < 0.0) ? 0 : (db > maxvalue) ? OFstatic_cast(T2, maxvalue) : OFstatic_cast(T2, db);
+    }
+};
+
+
+#endif
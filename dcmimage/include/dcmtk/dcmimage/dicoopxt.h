@@ -27,6 +27,7 @@
 
 #include "dcmtk/dcmimage/dicoopx.h"
 #include "dcmtk/dcmimage/dicopx.h"
+#include "dcmtk/dcmimage/dicokrn.h"
 #include "dcmtk/dcmimgle/dipxrept.h"
 
 #include "dcmtk/ofstd/ofbmanip.h"
@@ -335,17 +336,9 @@ class DiColorOutputPixelTemplate
                     register int j;
                     if (bits1 == bits2)
                     {
-                        /* invert output data */
-                        if (inverse)
-                        {
-                            for (i = start; i < start + Count; ++i)
-                                for (j = 0; j < 3; ++j)                         // copy inverted data
-                                    *(q++) = max2 - OFstatic_cast(T2, pixel[j][i]);
-                        } else {
-                            for (i = start; i < start + Count; ++i)
-                                for (j = 0; j < 3; ++j)                         // copy
-                                    *(q++) = OFstatic_cast(T2, pixel[j][i]);
-                        }
+                        /* copy (and invert) output data */
+                        DiColorKernel::interleave(pixel[0] + start, pixel[1] + start, pixel[2] + start, q, Count, inverse, max2);
+                        q += 3 * Count;
                     }
                     else if (bits1 < bits2)                                     // optimization possible using LUT
                     {
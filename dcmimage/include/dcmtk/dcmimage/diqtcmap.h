@@ -30,10 +30,11 @@
 #include "dcmtk/dcmimage/diqtpix.h"   /* gcc 3.4 needs this */
 #include "dcmtk/dcmimage/diqthash.h"  /* gcc 3.4 needs this */
 #include "dcmtk/dcmimage/diqtctab.h"  /* gcc 3.4 needs this */
+#include "dcmtk/dcmimage/diqticm.h"   /* gcc 3.4 needs this */
 
 class DicomImage;
-class DcmQuantColorHashTable;
 class DcmQuantColorTable;
+class DcmQuantInverseColorMap;
 class DcmQuantPixel;
 class DcmQuantScaleTable;
 
@@ -54,11 +55,10 @@ public:
    *  @param frameNumber number of frame (in sourceImage) that is converted
    *  @param maxval maximum pixel value to which all color samples
    *    were down-sampled during computation of the histogram on which
-   *    the color LUT is based.  This value is required to make sure that the
-   *    hash table doesn't get too large.
-   *  @param cht color hash table.  This table is passed by the caller since
-   *    the same hash table can be used if multiple frames are converted.
-   *    Initially (i.e. when called for the first frame) the hash table is empty.
+   *    the color LUT is based.
+   *  @param icm inverse color map used to find the closest match in the color LUT.
+   *    This object is passed by the caller since the same inverse color map can
+   *    be used if multiple frames are converted.
    *  @param colormap color LUT to which the color image is mapped.
    *  @param fs error diffusion object, e.g. an instance of class DcmQuantIdent
    *    or class DcmQuantFloydSteinberg, depending on the template instantiation.
@@ -70,7 +70,7 @@ public:
     DicomImage& sourceImage,
     unsigned long frameNumber,
     unsigned long maxval,
-    DcmQuantColorHashTable& cht,
+    DcmQuantInverseColorMap& icm,
     DcmQuantColorTable& colormap,
     T1& fs,
     T2 *tp)
@@ -107,13 +107,8 @@ public:
 
             fs.adjust(px, col, maxval_l);
 
-            // Check hash table to see if we have already matched this color.
-            ind = cht.lookup(px);
-            if (ind < 0)
-            {
-              ind = colormap.computeIndex(px);
-              cht.add(px, ind);
-            }
+            // find the closest match in the color LUT
+            ind = icm.computeIndex(px);
 
             fs.propagate(px, colormap.getPixel(ind), col);
             tp[col] = OFstatic_cast(T2, ind);
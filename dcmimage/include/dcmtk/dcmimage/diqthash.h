@@ -71,6 +71,10 @@ public:
    *  color image) to the hash table.  The counter (integer value associated
    *  to each color) counts the occurence of the color in the image.
    *  If more than maxcolors colors are found, the function returns zero.
+   *  Large frames are split into several ranges of rows, which are counted
+   *  in parallel if more than one thread is allowed (see
+   *  DicomImageClass::setNumberOfThreads()).  The result does not depend on
+   *  the number of threads.
    *  @param image image in which colors are to be counted
    *  @param newmaxval maximum pixel value to which the contents of the
    *    image are scaled down (see documentation of class DcmQuantScaleTable)
@@ -85,6 +89,22 @@ public:
     unsigned long newmaxval,
     unsigned long maxcolors);
 
+  /** adds the given pixels to the hash table.  The counter (integer value
+   *  associated to each color) counts the occurence of the color.
+   *  @param data pointer to the pixel data (three samples per pixel, R G B)
+   *  @param count number of pixels
+   *  @param scaletable scale table used to scale down the pixel values
+   *  @param maxcolors maximum number of new colors allowed.  If more new colors
+   *    are found, the method immediately returns.
+   *  @return number of new colors added to the hash table, a value greater than
+   *    maxcolors if too many new colors were found.
+   */
+  unsigned long addPixels(
+    const DcmQuantComponent *data,
+    unsigned long count,
+    const DcmQuantScaleTable& scaletable,
+    unsigned long maxcolors);
+
   /** counts the number of entries in the hash table
    *  @return number of entries in hash table
    */
@@ -112,6 +132,14 @@ private:
   /// private undefined copy assignment operator
   DcmQuantColorHashTable& operator=(const DcmQuantColorHashTable& src);
 
+  /** moves the contents of the given hash table into this hash table.
+   *  The result is the same as if the pixels counted in the given hash table
+   *  had been added to this hash table after the pixels counted so far.
+   *  @param other hash table to be merged into this hash table, empty upon return
+   *  @return number of entries added to this hash table
+   */
+  unsigned long merge(DcmQuantColorHashTable& other);
+
   /** Retrieves the specified item from the hash table.
    *  If the item has not been created a new item is created and is returned.
    */
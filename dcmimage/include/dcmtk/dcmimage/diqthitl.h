@@ -102,6 +102,15 @@ public:
     list_.push_front(new DcmQuantHistogramItem(colorP, value));
   }
 
+  /** moves the contents of the given list into this list.  The counters of
+   *  pixels contained in both lists are added.  The result is the same as if
+   *  the pixels counted in the given list had been added to this list after
+   *  the pixels counted in this list (see add()).
+   *  @param other list to be merged into this list, empty upon return
+   *  @return number of entries added to this list
+   */
+  unsigned long merge(DcmQuantHistogramItemList& other);
+
   /// returns current number of objects in the list
   inline size_t size() const
   {
@@ -0,0 +1,179 @@
+/*
+ *
+ *  Copyright (C) 2016, OFFIS e.V.
+ *  All rights reserved.  See COPYRIGHT file for details.
+ *
+ *  This software and supporting documentation were developed by
+ *
+ *    OFFIS e.V.
+ *    R&D Division Health
+ *    Escherweg 2
+ *    D-26121 Oldenburg, Germany
+ *
+ *
+ *  Module:  dcmimage
+ *
+ *  Author:  OFFIS DICOM Team
+ *
+ *  Purpose: class DcmQuantInverseColorMap
+ *
+ */
+
+
+#ifndef DIQTICM_H
+#define DIQTICM_H
+
+#include "dcmtk/config/osconfig.h"
+#include "dcmtk/dcmimage/diqtpix.h"   /* for DcmQuantPixel */
+
+class DcmQuantColorTable;
+
+
+/** number of cells of the inverse color map along each color axis (at most).
+ *  Must be a power of two.
+ */
+#define DcmQuantInverseColorMapCells 16
+
+/** maximum number of colors for which the result of a look-up is cached.
+ *  If the number of possible colors ((maxval + 1)^3) does not exceed this
+ *  value, each color is only looked up once.
+ */
+#define DcmQuantInverseColorMapCacheSize 262144
+
+
+/** this class implements an inverse color map, i.e. a structure that
+ *  determines for any color the closest match in a color LUT.
+ *  The RGB color space is divided into a regular grid of cells.  For each
+ *  cell, a list of candidates is computed when the cell is used for the
+ *  first time.  It contains only those entries of the color LUT that can be
+ *  the closest match for at least one color in the cell (based on the
+ *  minimum and maximum distance between the cell and the LUT entry, like
+ *  the inverse colormap of the IJG JPEG library).
+ *  Looking up a color therefore requires only a few distance computations
+ *  instead of a search through the complete color LUT, and the result is
+ *  always the exact closest match.  Additionally, the results are cached
+ *  for each color if the number of possible colors is small enough.
+ */
+class DCMTK_DCMIMAGE_EXPORT DcmQuantInverseColorMap
+{
+public:
+
+  /** constructor
+   *  @param colormap color LUT to which colors are mapped.  The color LUT is
+   *    copied, i.e. it is not accessed after construction of this object.
+   *  @param maxval maximum value of each color component of the colors that
+   *    are looked up (see DcmQuantColorTable::getMaxVal())
+   */
+  DcmQuantInverseColorMap(const DcmQuantColorTable& colormap, unsigned long maxval);
+
+  /// destructor
+  ~DcmQuantInverseColorMap();
+
+  /** determines for a given color the closest match in the color LUT.
+   *  If several entries of the color LUT have the same distance to the color,
+   *  the entry with the lowest index is returned.
+   *  @param px color to look up in LUT, each component must be <= maxval
+   *  @return index of closest match in LUT, -1 if look-up table empty
+   */
+  inline int computeIndex(const DcmQuantPixel& px)
+  {
+    if (cache)
+    {
+      int& result = cache[(OFstatic_cast(unsigned long, px.getRed()) * (maxval + 1)
+        + OFstatic_cast(unsigned long, px.getGreen())) * (maxval + 1)
+        + OFstatic_cast(unsigned long, px.getBlue())];
+      if (result < 0) result = searchCandidates(px);
+      return result;
+    }
+    return searchCandidates(px);
+  }
+
+private:
+
+  /// private undefined copy constructor
+  DcmQuantInverseColorMap(const DcmQuantInverseColorMap& src);
+
+  /// private undefined copy assignment operator
+  DcmQuantInverseColorMap& operator=(const DcmQuantInverseColorMap& src);
+
+  /** determines for a given color the closest match in the color LUT
+   *  by searching the candidates of the cell in which the color is located.
+   *  @param px color to look up in LUT
+   *  @return index of closest match in LUT, -1 if look-up table empty
+   */
+  inline int searchCandidates(const DcmQuantPixel& px)
+  {
+    const unsigned long cell = ((OFstatic_cast(unsigned long, px.getRed() >> shift) * cells
+      + OFstatic_cast(unsigned long, px.getGreen() >> shift)) * cells
+      + OFstatic_cast(unsigned long, px.getBlue() >> shift));
+    if (candidates[cell] == NULL) computeCandidates(cell);
+
+    // the first entry of the candidate list is the number of candidates,
+    // followed by pairs of minimum distance and index (see computeCandidates())
+    const int *candidate = candidates[cell];
+    int count = *candidate++;
+    const int *color;
+    int r2, g2, b2;
+    long newdist;
+    int r1 = OFstatic_cast(int, px.getRed());
+    int g1 = OFstatic_cast(int, px.getGreen());
+    int b1 = OFstatic_cast(int, px.getBlue());
+    long dist = 2000000000;
+    int result = -1;
+    while ((count-- > 0) && (candidate[0] <= dist))
+    {
+      color = palette + 3 * candidate[1];
+      r2 = r1 - color[0];
+      g2 = g1 - color[1];
+      b2 = b1 - color[2];
+      newdist = r2*r2 + g2*g2 + b2*b2;
+      if ((newdist < dist) || ((newdist == dist) && (candidate[1] < result)))
+      {
+        result = candidate[1];
+        dist = newdist;
+      }
+      candidate += 2;
+    }
+    return result;
+  }
+
+  /** computes the list of candidates for the given cell
+   *  @param cell index of the cell
+   */
+  void computeCandidates(unsigned long cell);
+
+  /// color LUT, three components (R, G, B) per entry
+  int *palette;
+
+  /// number of entries in color LUT
+  unsigned long numColors;
+
+  /// maximum value of each color component
+  unsigned long maxval;
+
+  /// number of bits by which color components are shifted to compute the cell
+  int shift;
+
+  /// number of cells along each color axis
+  unsigned long cells;
+
+  /** candidate list for each cell, NULL if not yet computed.  Each list
+   *  consists of the number of candidates followed by the minimum distance to
+   *  the cell and the index of each candidate, sorted by ascending distance.
+   *  Since no color in the cell is closer to a candidate than its minimum
+   *  distance, the search ends at the first candidate whose minimum distance
+   *  exceeds the distance to the closest match found so far.
+   */
+  int **candidates;
+
+  /// temporary array for the minimum distances of all LUT entries to a cell
+  long *minDistance;
+
+  /** index of the closest match for each possible color, -1 if not yet
+   *  computed.  NULL if the number of possible colors is too large.
+   */
+  int *cache;
+};
+
+
+#endif
@@ -52,13 +52,15 @@ class DCMTK_DCMIMAGE_EXPORT DiRGBImage
      */
     virtual ~DiRGBImage();
 
-    /** process next couple of frames
+    /** process the given range of frames (random access)
      *
-     ** @param  fcount  number of frames to be processed (0 = same number as before)
+     ** @param  fstart  number of the first frame to be processed (0..n-1)
+     *  @param  fcount  number of frames to be processed (0 = same number as before)
      *
      ** @return status, true if successful, false otherwise
      */
-    virtual int processNextFrames(const unsigned long fcount);
+    virtual int processFrames(const unsigned long fstart,
+                              const unsigned long fcount);
 
 
  protected:
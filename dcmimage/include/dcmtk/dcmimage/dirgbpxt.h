@@ -26,6 +26,7 @@
 #include "dcmtk/config/osconfig.h"
 
 #include "dcmtk/dcmimage/dicopxt.h"
+#include "dcmtk/dcmimage/dicokrn.h"
 #include "dcmtk/dcmimgle/diinpx.h"  /* gcc 3.4 needs this */
 
 
@@ -119,13 +120,7 @@ class DiRGBPixelTemplate
                 }
             }
             else
-            {
-                register int j;
-                register unsigned long i;
-                for (i = 0; i < count; ++i)                             /* for all pixel ... */
-                    for (j = 0; j < 3; ++j)
-                        this->Data[j][i] = removeSign(*(p++), offset);  /* ... copy planes */
-            }
+                DiColorKernel::deinterleave(p, this->Data[0], this->Data[1], this->Data[2], count, offset);
         }
     }
 };
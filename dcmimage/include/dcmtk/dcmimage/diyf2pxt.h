@@ -26,6 +26,7 @@
 #include "dcmtk/config/osconfig.h"
 
 #include "dcmtk/dcmimage/dicopxt.h"
+#include "dcmtk/dcmimage/dicokrn.h"
 #include "dcmtk/dcmimgle/diinpx.h"  /* gcc 3.4 needs this */
 
 
@@ -106,14 +107,20 @@ class DiYBR422PixelTemplate
             if (rgb)    /* convert to RGB model */
             {
                 const T2 maxvalue = OFstatic_cast(T2, DicomImageClass::maxval(bits));
-                for (i = count / 2; i != 0; --i)
+                DiPixelRepresentationTemplate<T1> rep;
+                if ((bits == 8) && !rep.isSigned())         // only for unsigned 8 bit
+                    DiColorKernel::convertYBR422ToRGB(p, r, g, b, count);
+                else
                 {
-                    y1 = removeSign(*(p++), offset);
-                    y2 = removeSign(*(p++), offset);
-                    cb = removeSign(*(p++), offset);
-                    cr = removeSign(*(p++), offset);
-                    convertValue(*(r++), *(g++), *(b++), y1, cb, cr, maxvalue);
-                    convertValue(*(r++), *(g++), *(b++), y2, cb, cr, maxvalue);
+                    for (i = count / 2; i != 0; --i)
+                    {
+                        y1 = removeSign(*(p++), offset);
+                        y2 = removeSign(*(p++), offset);
+                        cb = removeSign(*(p++), offset);
+                        cr = removeSign(*(p++), offset);
+                        convertValue(*(r++), *(g++), *(b++), y1, cb, cr, maxvalue);
+                        convertValue(*(r++), *(g++), *(b++), y2, cb, cr, maxvalue);
+                    }
                 }
             } else {    /* retain YCbCr model: YCbCr_422_full -> YCbCr_full */
                 for (i = count / 2; i != 0; --i)
@@ -139,9 +139,10 @@ void DiARGBImage::Init()
 /*********************************************************************/
 
 
-int DiARGBImage::processNextFrames(const unsigned long fcount)
+int DiARGBImage::processFrames(const unsigned long fstart,
+                               const unsigned long fcount)
 {
-    if (DiImage::processNextFrames(fcount))
+    if (DiImage::processFrames(fstart, fcount))
     {
         delete InterData;
         InterData = NULL;
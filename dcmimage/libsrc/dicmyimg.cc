@@ -90,9 +90,10 @@ void DiCMYKImage::Init()
 /*********************************************************************/
 
 
-int DiCMYKImage::processNextFrames(const unsigned long fcount)
+int DiCMYKImage::processFrames(const unsigned long fstart,
+                               const unsigned long fcount)
 {
-    if (DiImage::processNextFrames(fcount))
+    if (DiImage::processFrames(fstart, fcount))
     {
         delete InterData;
         InterData = NULL;
@@ -0,0 +1,450 @@
+/*
+ *
+ *  Copyright (C) 2016, OFFIS e.V.
+ *  All rights reserved.  See COPYRIGHT file for details.
+ *
+ *  This software and supporting documentation were developed by
+ *
+ *    OFFIS e.V.
+ *    R&D Division Health
+ *    Escherweg 2
+ *    D-26121 Oldenburg, Germany
+ *
+ *
+ *  Module:  dcmimage
+ *
+ *  Author:  OFFIS DICOM Team
+ *
+ *  Purpose: DicomColorKernel (Source)
+ *
+ */
+
+
+#include "dcmtk/config/osconfig.h"
+
+#include "dcmtk/dcmimage/dicokrn.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2))
+#define DICOKRN_USE_SSE2
+#include <emmintrin.h>
+#endif
+
+
+#ifdef DICOKRN_USE_SSE2
+
+/*------------------*
+ *  SSE2 functions  *
+ *------------------*/
+
+/* The chrominance parts of the YCbCr to RGB conversion are computed as 'value * factor + offset'
+ * with 20 fractional bits.  The factors and offsets are the rounded coefficients of the conversion.
+ * Truncating the results towards zero gives exactly the entries of the lookup tables used by
+ * convertYBRToRGB(), rounding them down gives exactly the results of the floating-point
+ * arithmetic used by convertYBR422ToRGB() (checked for all possible input values).
+ */
+
+/// number of fractional bits
+#define DICOKRN_SCALE_BITS 20
+/// red component, Cr part: 1.4020 * Cr - 0.7010 * 255
+#define DICOKRN_RCR_FACTOR 1470104
+#define DICOKRN_RCR_OFFSET -187438203
+/// green component, Cb part: 0.3441 * Cb
+#define DICOKRN_GCB_FACTOR 360815
+/// green component, Cr part: 0.7141 * Cr - 0.5291 * 255
+#define DICOKRN_GCR_FACTOR 748788
+#define DICOKRN_GCR_OFFSET -141474398
+/// blue component, Cb part: 1.7720 * Cb - 0.8859 * 255
+#define DICOKRN_BCB_FACTOR 1858077
+#define DICOKRN_BCB_OFFSET -236878037
+
+
+/** create a factor for multiplyValues().  Since the factors exceed the range of 16 bit
+ *  integers, they are split into two parts: factor = high * 128 + low.
+ *
+ ** @param  factor  factor (absolute value less than 2^22)
+ *
+ ** @return pairs of low and high part (16 bit each)
+ */
+static inline __m128i makeFactor(const Sint32 factor)
+{
+    const short high = OFstatic_cast(short, factor / 128);
+    const short low = OFstatic_cast(short, factor % 128);
+    return _mm_set_epi16(high, low, high, low, high, low, high, low);
+}
+
+
+/** prepare eight values (16 bit, 0..255) for multiplyValues(), i.e. create pairs of
+ *  'value' and 'value * 128' (16 bit each)
+ */
+static inline void splitValues(const __m128i values,
+                               __m128i &lower,
+                               __m128i &upper)
+{
+    const __m128i shifted = _mm_slli_epi16(values, 7);
+    lower = _mm_unpacklo_epi16(values, shifted);
+    upper = _mm_unpackhi_epi16(values, shifted);
+}
+
+
+/** multiply four values (prepared by splitValues()) with a factor (created by makeFactor())
+ *
+ ** @return four products (32 bit)
+ */
+static inline __m128i multiplyValues(const __m128i values,
+                                     const __m128i factor)
+{
+    return _mm_madd_epi16(values, factor);
+}
+
+
+/** divide eight intermediate results (32 bit) by 2^DICOKRN_SCALE_BITS and truncate towards zero
+ *
+ ** @return eight results (16 bit)
+ */
+static inline __m128i truncateValues(__m128i lower,
+                                     __m128i upper)
+{
+    const __m128i round = _mm_set1_epi32((1 << DICOKRN_SCALE_BITS) - 1);
+    lower = _mm_add_epi32(lower, _mm_and_si128(_mm_srai_epi32(lower, 31), round));
+    upper = _mm_add_epi32(upper, _mm_and_si128(_mm_srai_epi32(upper, 31), round));
+    return _mm_packs_epi32(_mm_srai_epi32(lower, DICOKRN_SCALE_BITS), _mm_srai_epi32(upper, DICOKRN_SCALE_BITS));
+}
+
+
+/** divide eight intermediate results (32 bit) by 2^DICOKRN_SCALE_BITS and round down
+ *
+ ** @return eight results (16 bit)
+ */
+static inline __m128i floorValues(const __m128i lower,
+                                  const __m128i upper)
+{
+    return _mm_packs_epi32(_mm_srai_epi32(lower, DICOKRN_SCALE_BITS), _mm_srai_epi32(upper, DICOKRN_SCALE_BITS));
+}
+
+
+/** convert eight YCbCr values (16 bit) to RGB (16 bit, not yet clipped).
+ *  The results are identical to the table-based conversion (see initYBRTables()).
+ */
+static inline void convertValues(const __m128i y,
+                                 const __m128i cb,
+                                 const __m128i cr,
+                                 __m128i &red,
+                                 __m128i &green,
+                                 __m128i &blue)
+{
+    __m128i cbLower, cbUpper, crLower, crUpper;
+    splitValues(cb, cbLower, cbUpper);
+    splitValues(cr, crLower, crUpper);
+    __m128i factor = makeFactor(DICOKRN_RCR_FACTOR);
+    __m128i offset = _mm_set1_epi32(DICOKRN_RCR_OFFSET);
+    red = _mm_add_epi16(y, truncateValues(_mm_add_epi32(multiplyValues(crLower, factor), offset),
+        _mm_add_epi32(multiplyValues(crUpper, factor), offset)));
+    factor = makeFactor(DICOKRN_GCB_FACTOR);
+    green = _mm_sub_epi16(y, truncateValues(multiplyValues(cbLower, factor), multiplyValues(cbUpper, factor)));
+    factor = makeFactor(DICOKRN_GCR_FACTOR);
+    offset = _mm_set1_epi32(DICOKRN_GCR_OFFSET);
+    green = _mm_sub_epi16(green, truncateValues(_mm_add_epi32(multiplyValues(crLower, factor), offset),
+        _mm_add_epi32(multiplyValues(crUpper, factor), offset)));
+    factor = makeFactor(DICOKRN_BCB_FACTOR);
+    offset = _mm_set1_epi32(DICOKRN_BCB_OFFSET);
+    blue = _mm_add_epi16(y, truncateValues(_mm_add_epi32(multiplyValues(cbLower, factor), offset),
+        _mm_add_epi32(multiplyValues(cbUpper, factor), offset)));
+}
+
+
+/** convert eight YCbCr values (16 bit) to RGB (16 bit, not yet clipped).
+ *  The results are identical to the floating-point conversion (see convertYBR422Value()).
+ */
+static inline void convertValues422(const __m128i y,
+                                    const __m128i cb,
+                                    const __m128i cr,
+                                    __m128i &red,
+                                    __m128i &green,
+                                    __m128i &blue)
+{
+    __m128i cbLower, cbUpper, crLower, crUpper;
+    splitValues(cb, cbLower, cbUpper);
+    splitValues(cr, crLower, crUpper);
+    __m128i factor = makeFactor(DICOKRN_RCR_FACTOR);
+    __m128i offset = _mm_set1_epi32(DICOKRN_RCR_OFFSET);
+    red = _mm_add_epi16(y, floorValues(_mm_add_epi32(multiplyValues(crLower, factor), offset),
+        _mm_add_epi32(multiplyValues(crUpper, factor), offset)));
+    // both chrominance parts of the green component are combined before rounding
+    factor = makeFactor(-DICOKRN_GCB_FACTOR);
+    const __m128i factor2 = makeFactor(-DICOKRN_GCR_FACTOR);
+    offset = _mm_set1_epi32(-DICOKRN_GCR_OFFSET);
+    green = _mm_add_epi16(y, floorValues(
+        _mm_add_epi32(_mm_add_epi32(multiplyValues(cbLower, factor), multiplyValues(crLower, factor2)), offset),
+        _mm_add_epi32(_mm_add_epi32(multiplyValues(cbUpper, factor), multiplyValues(crUpper, factor2)), offset)));
+    factor = makeFactor(DICOKRN_BCB_FACTOR);
+    offset = _mm_set1_epi32(DICOKRN_BCB_OFFSET);
+    blue = _mm_add_epi16(y, floorValues(_mm_add_epi32(multiplyValues(cbLower, factor), offset),
+        _mm_add_epi32(multiplyValues(cbUpper, factor), offset)));
+}
+
+
+/** clip eight RGB values (16 bit) of two halves and store them (8 bit)
+ */
+static inline void storeBlock(const __m128i r0,
+                              const __m128i g0,
+                              const __m128i b0,
+                              const __m128i r1,
+                              const __m128i g1,
+                              const __m128i b1,
+                              Uint8 *red,
+                              Uint8 *green,
+                              Uint8 *blue)
+{
+    // saturation clips the results to the range 0..255
+    _mm_storeu_si128(OFreinterpret_cast(__m128i *, red), _mm_packus_epi16(r0, r1));
+    _mm_storeu_si128(OFreinterpret_cast(__m128i *, green), _mm_packus_epi16(g0, g1));
+    _mm_storeu_si128(OFreinterpret_cast(__m128i *, blue), _mm_packus_epi16(b0, b1));
+}
+
+
+/** convert sixteen YCbCr values (8 bit) to RGB and store the clipped results
+ */
+static inline void convertBlock(const __m128i y,
+                                const __m128i cb,
+                                const __m128i cr,
+                                Uint8 *red,
+                                Uint8 *green,
+                                Uint8 *blue)
+{
+    const __m128i zero = _mm_setzero_si128();
+    __m128i r0, g0, b0, r1, g1, b1;
+    convertValues(_mm_unpacklo_epi8(y, zero), _mm_unpacklo_epi8(cb, zero), _mm_unpacklo_epi8(cr, zero), r0, g0, b0);
+    convertValues(_mm_unpackhi_epi8(y, zero), _mm_unpackhi_epi8(cb, zero), _mm_unpackhi_epi8(cr, zero), r1, g1, b1);
+    storeBlock(r0, g0, b0, r1, g1, b1, red, green, blue);
+}
+
+
+/** convert sixteen YCbCr values (8 bit) to RGB using floating-point semantics and store the
+ *  clipped results
+ */
+static inline void convertBlock422(const __m128i y,
+                                   const __m128i cb,
+                                   const __m128i cr,
+                                   Uint8 *red,
+                                   Uint8 *green,
+                                   Uint8 *blue)
+{
+    const __m128i zero = _mm_setzero_si128();
+    __m128i r0, g0, b0, r1, g1, b1;
+    convertValues422(_mm_unpacklo_epi8(y, zero), _mm_unpacklo_epi8(cb, zero), _mm_unpacklo_epi8(cr, zero), r0, g0, b0);
+    convertValues422(_mm_unpackhi_epi8(y, zero), _mm_unpackhi_epi8(cb, zero), _mm_unpackhi_epi8(cr, zero), r1, g1, b1);
+    storeBlock(r0, g0, b0, r1, g1, b1, red, green, blue);
+}
+
+
+/** load sixteen color-by-pixel values (48 bytes) and split them into three planes.
+ *  Each round interleaves the first and the second half of the 48 bytes, i.e. moves the
+ *  byte at position p to position 2p mod 47.  After four rounds, the byte at position
+ *  3i+c (pixel i, component c) is at position 16c+i.
+ */
+static inline void loadPixels(const Uint8 *pixel,
+                              __m128i &plane0,
+                              __m128i &plane1,
+                              __m128i &plane2)
+{
+    __m128i x0 = _mm_loadu_si128(OFreinterpret_cast(const __m128i *, pixel));
+    __m128i x1 = _mm_loadu_si128(OFreinterpret_cast(const __m128i *, pixel + 16));
+    __m128i x2 = _mm_loadu_si128(OFreinterpret_cast(const __m128i *, pixel + 32));
+    for (int i = 0; i < 4; ++i)
+    {
+        const __m128i y0 = _mm_unpacklo_epi8(x0, _mm_unpackhi_epi64(x1, x1));
+        const __m128i y1 = _mm_unpacklo_epi8(_mm_unpackhi_epi64(x0, x0), x2);
+        const __m128i y2 = _mm_unpacklo_epi8(x1, _mm_unpackhi_epi64(x2, x2));
+        x0 = y0;
+        x1 = y1;
+        x2 = y2;
+    }
+    plane0 = x0;
+    plane1 = x1;
+    plane2 = x2;
+}
+
+
+/** merge sixteen values of three planes and store them color-by-pixel (48 bytes).
+ *  Each round is the inverse of a round in loadPixels(), i.e. moves the even bytes to the
+ *  first half and the odd bytes to the second half of the 48 bytes.
+ */
+static inline void storePixels(__m128i x0,
+                               __m128i x1,
+                               __m128i x2,
+                               Uint8 *pixel)
+{
+    const __m128i mask = _mm_set1_epi16(0x00ff);
+    for (int i = 0; i < 4; ++i)
+    {
+        const __m128i y0 = _mm_packus_epi16(_mm_and_si128(x0, mask), _mm_and_si128(x1, mask));
+        const __m128i y1 = _mm_packus_epi16(_mm_and_si128(x2, mask), _mm_srli_epi16(x0, 8));
+        const __m128i y2 = _mm_packus_epi16(_mm_srli_epi16(x1, 8), _mm_srli_epi16(x2, 8));
+        x0 = y0;
+        x1 = y1;
+        x2 = y2;
+    }
+    _mm_storeu_si128(OFreinterpret_cast(__m128i *, pixel), x0);
+    _mm_storeu_si128(OFreinterpret_cast(__m128i *, pixel + 16), x1);
+    _mm_storeu_si128(OFreinterpret_cast(__m128i *, pixel + 32), x2);
+}
+
+
+/** load sixteen YCbCr 4:2:2 values (32 bytes, Y1 Y2 Cb Cr) and upsample the chrominance
+ */
+static inline void loadPixels422(const Uint8 *pixel,
+                                 __m128i &y,
+                                 __m128i &cb,
+                                 __m128i &cr)
+{
+    __m128i v0 = _mm_loadu_si128(OFreinterpret_cast(const __m128i *, pixel));
+    __m128i v1 = _mm_loadu_si128(OFreinterpret_cast(const __m128i *, pixel + 16));
+    // separate the luminance pairs from the chrominance pairs (16 bit each)
+    v0 = _mm_shuffle_epi32(_mm_shufflehi_epi16(_mm_shufflelo_epi16(v0, 0xd8), 0xd8), 0xd8);
+    v1 = _mm_shuffle_epi32(_mm_shufflehi_epi16(_mm_shufflelo_epi16(v1, 0xd8), 0xd8), 0xd8);
+    y = _mm_unpacklo_epi64(v0, v1);
+    const __m128i c = _mm_unpackhi_epi64(v0, v1);
+    const __m128i cb8 = _mm_and_si128(c, _mm_set1_epi16(0x00ff));
+    const __m128i cr8 = _mm_srli_epi16(c, 8);
+    // each chrominance value is used for two pixels
+    cb = _mm_packus_epi16(_mm_unpacklo_epi16(cb8, cb8), _mm_unpackhi_epi16(cb8, cb8));
+    cr = _mm_packus_epi16(_mm_unpacklo_epi16(cr8, cr8), _mm_unpackhi_epi16(cr8, cr8));
+}
+
+#endif
+
+
+/*------------------*
+ *  public methods  *
+ *------------------*/
+
+void DiColorKernel::convertYBRToRGB(const Uint8 *y,
+                                    const Uint8 *cb,
+                                    const Uint8 *cr,
+                                    const unsigned long step,
+                                    Uint8 *red,
+                                    Uint8 *green,
+                                    Uint8 *blue,
+                                    const unsigned long count)
+{
+    unsigned long done = 0;
+#ifdef DICOKRN_USE_SSE2
+    __m128i vy, vcb, vcr;
+    if (step == 1)
+    {
+        for (done = 0; done + 16 <= count; done += 16)
+        {
+            vy = _mm_loadu_si128(OFreinterpret_cast(const __m128i *, y + done));
+            vcb = _mm_loadu_si128(OFreinterpret_cast(const __m128i *, cb + done));
+            vcr = _mm_loadu_si128(OFreinterpret_cast(const __m128i *, cr + done));
+            convertBlock(vy, vcb, vcr, red + done, green + done, blue + done);
+        }
+    }
+    else if ((step == 3) && (cb == y + 1) && (cr == y + 2))
+    {
+        for (done = 0; done + 16 <= count; done += 16)
+        {
+            loadPixels(y + done * 3, vy, vcb, vcr);
+            convertBlock(vy, vcb, vcr, red + done, green + done, blue + done);
+        }
+    }
+#endif
+    convertYBRToRGB<Uint8, Uint8>(y + done * step, cb + done * step, cr + done * step, step, red + done, green + done,
+        blue + done, count - done);
+}
+
+
+void DiColorKernel::convertYBR422ToRGB(const Uint8 *pixel,
+                                       Uint8 *red,
+                                       Uint8 *green,
+                                       Uint8 *blue,
+                                       const unsigned long count)
+{
+    unsigned long done = 0;
+#ifdef DICOKRN_USE_SSE2
+    __m128i vy, vcb, vcr;
+    for (done = 0; done + 16 <= count; done += 16)
+    {
+        loadPixels422(pixel + done * 2, vy, vcb, vcr);
+        convertBlock422(vy, vcb, vcr, red + done, green + done, blue + done);
+    }
+#endif
+    convertYBR422ToRGB<Uint8, Uint8>(pixel + done * 2, red + done, green + done, blue + done, count - done);
+}
+
+
+void DiColorKernel::deinterleave(const Uint8 *pixel,
+                                 Uint8 *plane0,
+                                 Uint8 *plane1,
+                                 Uint8 *plane2,
+                                 const unsigned long count,
+                                 const Uint8 offset)
+{
+    unsigned long done = 0;
+#ifdef DICOKRN_USE_SSE2
+    __m128i v0, v1, v2;
+    for (done = 0; done + 16 <= count; done += 16)
+    {
+        loadPixels(pixel + done * 3, v0, v1, v2);
+        _mm_storeu_si128(OFreinterpret_cast(__m128i *, plane0 + done), v0);
+        _mm_storeu_si128(OFreinterpret_cast(__m128i *, plane1 + done), v1);
+        _mm_storeu_si128(OFreinterpret_cast(__m128i *, plane2 + done), v2);
+    }
+#endif
+    deinterleave<Uint8, Uint8>(pixel + done * 3, plane0 + done, plane1 + done, plane2 + done, count - done, offset);
+}
+
+
+void DiColorKernel::interleave(const Uint8 *plane0,
+                               const Uint8 *plane1,
+                               const Uint8 *plane2,
+                               Uint8 *pixel,
+                               const unsigned long count,
+                               const int inverse,
+                               const Uint8 maxvalue)
+{
+    unsigned long done = 0;
+#ifdef DICOKRN_USE_SSE2
+    const __m128i max16 = _mm_set1_epi8(OFstatic_cast(char, maxvalue));
+    __m128i v0, v1, v2;
+    for (done = 0; done + 16 <= count; done += 16)
+    {
+        v0 = _mm_loadu_si128(OFreinterpret_cast(const __m128i *, plane0 + done));
+        v1 = _mm_loadu_si128(OFreinterpret_cast(const __m128i *, plane1 + done));
+        v2 = _mm_loadu_si128(OFreinterpret_cast(const __m128i *, plane2 + done));
+        if (inverse)
+        {
+            // same result as the generic version (modulo 256)
+            v0 = _mm_sub_epi8(max16, v0);
+            v1 = _mm_sub_epi8(max16, v1);
+            v2 = _mm_sub_epi8(max16, v2);
+        }
+        storePixels(v0, v1, v2, pixel + done * 3);
+    }
+#endif
+    interleave<Uint8, Uint8>(plane0 + done, plane1 + done, plane2 + done, pixel + done * 3, count - done, inverse, maxvalue);
+}
+
+
+/*-------------------*
+ *  private methods  *
+ *-------------------*/
+
+void DiColorKernel::initYBRTables(Sint16 *rcr_tab,
+                                  Sint16 *gcb_tab,
+                                  Sint16 *gcr_tab,
+                                  Sint16 *bcb_tab)
+{
+    const double maxvalue = 255;
+    const double r_const = 0.7010 * maxvalue;
+    const double g_const = 0.5291 * maxvalue;
+    const double b_const = 0.8859 * maxvalue;
+    unsigned long l;
+    for (l = 0; l < 256; ++l)
+    {
+        rcr_tab[l] = OFstatic_cast(Sint16, 1.4020 * OFstatic_cast(double, l) - r_const);
+        gcb_tab[l] = OFstatic_cast(Sint16, 0.3441 * OFstatic_cast(double, l));
+        gcr_tab[l] = OFstatic_cast(Sint16, 0.7141 * OFstatic_cast(double, l) - g_const);
+        bcb_tab[l] = OFstatic_cast(Sint16, 1.7720 * OFstatic_cast(double, l) - b_const);
+    }
+}
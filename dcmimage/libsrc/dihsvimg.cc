@@ -90,9 +90,10 @@ void DiHSVImage::Init()
 /*********************************************************************/
 
 
-int DiHSVImage::processNextFrames(const unsigned long fcount)
+int DiHSVImage::processFrames(const unsigned long fstart,
+                              const unsigned long fcount)
 {
-    if (DiImage::processNextFrames(fcount))
+    if (DiImage::processFrames(fstart, fcount))
     {
         delete InterData;
         InterData = NULL;
@@ -156,9 +156,10 @@ void DiPaletteImage::Init()
 /*********************************************************************/
 
 
-int DiPaletteImage::processNextFrames(const unsigned long fcount)
+int DiPaletteImage::processFrames(const unsigned long fstart,
+                                  const unsigned long fcount)
 {
-    if (DiImage::processNextFrames(fcount))
+    if (DiImage::processFrames(fstart, fcount))
     {
         delete InterData;
         InterData = NULL;
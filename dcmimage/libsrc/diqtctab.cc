@@ -335,8 +335,6 @@ void DcmQuantColorTable::computeClusters()
 {
   unsigned long i;
   unsigned long j;
-  unsigned long k=0;
-  int cluster;
   int newdist;
   int r1, g1, b1;
   int r2, g2, b2;
@@ -344,28 +342,25 @@ void DcmQuantColorTable::computeClusters()
   // initialize clusters
   for (i = 0; i < numColors; ++i) array[i]->setValue(2000000000);
 
-  for (i = 0; i < numColors-1; ++i)
+  for (i = 0; i + 1 < numColors; ++i)
   {
-    cluster = array[i]->getValue();
     r1 = OFstatic_cast(int, array[i]->getRed());
     g1 = OFstatic_cast(int, array[i]->getGreen());
     b1 = OFstatic_cast(int, array[i]->getBlue());
 
     for (j = i+1; j < numColors; ++j)
     {
-      // compute euclidean distance between i and j
+      // compute euclidean distance between i and j.  A color is only
+      // guaranteed to be mapped to entry i (or j) if its distance is less
+      // than half of this distance, i.e. the squared distance is less than
+      // a quarter of the squared distance between i and j.
       r2 = r1 - OFstatic_cast(int, array[j]->getRed());
       g2 = g1 - OFstatic_cast(int, array[j]->getGreen());
       b2 = b1 - OFstatic_cast(int, array[j]->getBlue());
-      newdist = (r2*r2 + g2*g2 + b2*b2)/2;
-      if (newdist < cluster)
-      {
-        cluster = newdist;
-        k = j;
-      }
+      newdist = (r2*r2 + g2*g2 + b2*b2)/4;
+      if (newdist < array[i]->getValue()) array[i]->setValue(newdist);
+      if (newdist < array[j]->getValue()) array[j]->setValue(newdist);
     }
-    array[i]->setValue(cluster);
-    array[k]->setValue(cluster);
   }
 }
 
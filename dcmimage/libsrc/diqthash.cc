@@ -24,6 +24,87 @@
 #include "dcmtk/dcmimage/diqthash.h"
 #include "dcmtk/dcmdata/dcxfer.h"      /* for E_TransferSyntax */
 #include "dcmtk/dcmimgle/dcmimage.h"    /* for DicomImage */
+#include "dcmtk/dcmimgle/diparlop.h"    /* for DiParallelLoop */
+#include "dcmtk/dcmimgle/diutils.h"     /* for DicomImageClass */
+
+
+/** helper class for DcmQuantColorHashTable::addToHashTable().
+ *  Splits the rows of a frame into several ranges and counts the colors of
+ *  each range in a separate hash table.  The ranges are processed in parallel.
+ */
+class DcmQuantHistogramLoop: public DiParallelLoop
+{
+public:
+  /** constructor
+   *  @param data pointer to the pixel data of the frame
+   *  @param rows number of rows of the frame
+   *  @param cols number of columns of the frame
+   *  @param scaletable scale table used to scale down the pixel values
+   *  @param tables hash table for each range
+   *  @param limits maximum number of new colors for each range
+   *  @param counts number of new colors for each range (returned)
+   *  @param ranges number of ranges
+   */
+  DcmQuantHistogramLoop(
+    const DcmQuantComponent *data,
+    unsigned long rows,
+    unsigned long cols,
+    const DcmQuantScaleTable& scaletable,
+    DcmQuantColorHashTable **tables,
+    const unsigned long *limits,
+    unsigned long *counts,
+    unsigned long ranges)
+  : DiParallelLoop()
+  , data_(data)
+  , rows_(rows)
+  , cols_(cols)
+  , scaletable_(scaletable)
+  , tables_(tables)
+  , limits_(limits)
+  , counts_(counts)
+  , ranges_(ranges)
+  {
+  }
+
+  /** counts the colors of the given ranges
+   *  @param first first range to be processed
+   *  @param last range after the last one to be processed
+   */
+  virtual void processRange(const unsigned long first, const unsigned long last)
+  {
+    for (unsigned long i = first; i < last; ++i)
+    {
+      const unsigned long start = rows_ * i / ranges_;
+      const unsigned long end = rows_ * (i + 1) / ranges_;
+      counts_[i] = tables_[i]->addPixels(data_ + start * cols_ * 3, (end - start) * cols_, scaletable_, limits_[i]);
+    }
+  }
+
+private:
+  /// private undefined copy constructor
+  DcmQuantHistogramLoop(const DcmQuantHistogramLoop& src);
+
+  /// private undefined copy assignment operator
+  DcmQuantHistogramLoop& operator=(const DcmQuantHistogramLoop& src);
+
+  /// pointer to the pixel data of the frame
+  const DcmQuantComponent *data_;
+  /// number of rows of the frame
+  unsigned long rows_;
+  /// number of columns of the frame
+  unsigned long cols_;
+  /// scale table used to scale down the pixel values
+  const DcmQuantScaleTable& scaletable_;
+  /// hash table for each range
+  DcmQuantColorHashTable **tables_;
+  /// maximum number of new colors for each range
+  const unsigned long *limits_;
+  /// number of new colors for each range
+  unsigned long *counts_;
+  /// number of ranges
+  unsigned long ranges_;
+};
+
 
 
 DcmQuantColorHashTable::DcmQuantColorHashTable()
@@ -62,6 +143,55 @@ unsigned long DcmQuantColorHashTable::createHistogram(DcmQuantHistogramItemPoint
 }
 
 
+unsigned long DcmQuantColorHashTable::merge(DcmQuantColorHashTable& other)
+{
+  unsigned long result = 0;
+  table_iterator it = m_Table.begin();
+  table_iterator ot = other.m_Table.begin();
+  for (; it != m_Table.end(); ++it, ++ot)
+  {
+    if (*ot)
+    {
+      if (*it) result += (*it)->merge(**ot);
+      else
+      {
+        // simply take over the list
+        *it = *ot;
+        *ot = OFnullptr;
+        result += (*it)->size();
+      }
+    }
+  }
+  return result;
+}
+
+
+unsigned long DcmQuantColorHashTable::addPixels(
+  const DcmQuantComponent *data,
+  unsigned long count,
+  const DcmQuantScaleTable& scaletable,
+  unsigned long maxcolors)
+{
+  unsigned long numcolors = 0;
+  const DcmQuantComponent *cp = data;
+  DcmQuantPixel px;
+  register DcmQuantComponent r, g, b;
+  for (unsigned long i = 0; i < count; i++)
+  {
+    // get pixel
+    r = *cp++;
+    g = *cp++;
+    b = *cp++;
+    px.scale(r, g, b, scaletable);
+
+    // lookup and increase if already in hash table
+    numcolors += item(px).add(px);
+    if (numcolors > maxcolors) break;
+  }
+  return numcolors;
+}
+
+
 unsigned long DcmQuantColorHashTable::addToHashTable(
   DicomImage& image,
   unsigned long newmaxval,
@@ -73,9 +203,7 @@ unsigned long DcmQuantColorHashTable::addToHashTable(
   const int bits = sizeof(DcmQuantComponent)*8;
 
   unsigned long numcolors = 0;
-  unsigned long j, k;
   const DcmQuantComponent *cp;
-  DcmQuantPixel px;
   const void *data = NULL;
 
   // compute maxval
@@ -85,30 +213,53 @@ unsigned long DcmQuantColorHashTable::addToHashTable(
   DcmQuantScaleTable scaletable;
   scaletable.createTable(maxval, newmaxval);
 
-  register DcmQuantComponent r, g, b;
+  // determine number of ranges that are counted in parallel
+  unsigned long ranges = DicomImageClass::getNumberOfThreads();
+  if (ranges > rows) ranges = rows;
+  if (ranges > cols * rows / DIPARLOP_MIN_PIXELS_PER_THREAD) ranges = cols * rows / DIPARLOP_MIN_PIXELS_PER_THREAD;
+  if (ranges < 1) ranges = 1;
+
+  // the first range is counted in this hash table, all others in a new one
+  DcmQuantColorHashTable **tables = new DcmQuantColorHashTable *[ranges];
+  unsigned long *limits = new unsigned long[ranges];
+  unsigned long *counts = new unsigned long[ranges];
+  unsigned long i;
+  tables[0] = this;
+  for (i = 1; i < ranges; i++) tables[i] = NULL;
 
-  for (unsigned long ff=0; ff<frames; ff++)
+  for (unsigned long ff=0; (ff<frames) && (numcolors <= maxcolors); ff++)
   {
     data = image.getOutputData(bits, ff, 0);
     if (data)
     {
       cp = OFstatic_cast(const DcmQuantComponent *, data);
-      for (j = 0; j < rows; j++)
+      limits[0] = maxcolors - numcolors;
+      for (i = 1; i < ranges; i++)
+      {
+        tables[i] = new DcmQuantColorHashTable();
+        limits[i] = maxcolors;
+      }
+
+      DcmQuantHistogramLoop loop(cp, rows, cols, scaletable, tables, limits, counts, ranges);
+      loop.run(ranges, (cols * rows) / ranges);
+
+      // merge the hash tables in the order of the ranges
+      numcolors += counts[0];
+      for (i = 1; i < ranges; i++)
       {
-        for (k = 0; k < cols; k++)
-        {
-          // get pixel
-          r = *cp++;
-          g = *cp++;
-          b = *cp++;
-          px.scale(r, g, b, scaletable);
-
-          // lookup and increase if already in hash table
-          numcolors += item(px).add(px);
-          if (numcolors > maxcolors) return 0;
-        }
+        if ((numcolors <= maxcolors) && (counts[i] <= maxcolors))
+          numcolors += merge(*tables[i]);
+        else numcolors = maxcolors + 1;
+        delete tables[i];
+        tables[i] = NULL;
       }
     }
   }
-  return numcolors;
+
+  delete[] tables;
+  delete[] limits;
+  delete[] counts;
+
+  // return zero if too many colors were found
+  return (numcolors > maxcolors) ? 0 : numcolors;
 }
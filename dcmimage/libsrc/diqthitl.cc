@@ -51,3 +51,30 @@ void DcmQuantHistogramItemList::moveto(DcmQuantHistogramItemPointer *array, unsi
     first = list_.erase(first);
   }
 }
+
+
+unsigned long DcmQuantHistogramItemList::merge(DcmQuantHistogramItemList& other)
+{
+  unsigned long result = 0;
+  DcmQuantHistogramItem *entry;
+  // new entries are inserted at the beginning of a list, i.e. the last entry
+  // of the other list has been added first
+  while (! other.list_.empty())
+  {
+    entry = other.list_.back();
+    other.list_.pop_back();
+    first = list_.begin();
+    while ((first != last) && ! (*first)->equals(*entry)) ++first;
+    if (first != last)
+    {
+      (*first)->setValue((*first)->getValue() + entry->getValue());
+      delete entry;
+    }
+    else
+    {
+      list_.push_front(entry);
+      ++result;
+    }
+  }
+  return result;
+}
@@ -0,0 +1,167 @@
+/*
+ *
+ *  Copyright (C) 2016, OFFIS e.V.
+ *  All rights reserved.  See COPYRIGHT file for details.
+ *
+ *  This software and supporting documentation were developed by
+ *
+ *    OFFIS e.V.
+ *    R&D Division Health
+ *    Escherweg 2
+ *    D-26121 Oldenburg, Germany
+ *
+ *
+ *  Module:  dcmimage
+ *
+ *  Author:  OFFIS DICOM Team
+ *
+ *  Purpose: class DcmQuantInverseColorMap
+ *
+ */
+
+
+#include "dcmtk/config/osconfig.h"
+#include "dcmtk/dcmimage/diqticm.h"
+#include "dcmtk/dcmimage/diqtctab.h"  /* for DcmQuantColorTable */
+
+#define INCLUDE_CSTDLIB
+#include "dcmtk/ofstd/ofstdinc.h"
+
+/* ------------------------------------------------------------ */
+
+// static comparison function for qsort
+
+BEGIN_EXTERN_C
+static int candidatecompare(const void *x1, const void *x2)
+{
+  // compare minimum distance first, then index
+  const int *c1 = OFstatic_cast(const int *, x1);
+  const int *c2 = OFstatic_cast(const int *, x2);
+  if (c1[0] != c2[0]) return (c1[0] < c2[0]) ? -1 : 1;
+  return c1[1] - c2[1];
+}
+END_EXTERN_C
+
+/* ------------------------------------------------------------ */
+
+
+DcmQuantInverseColorMap::DcmQuantInverseColorMap(const DcmQuantColorTable& colormap, unsigned long theMaxval)
+: palette(NULL)
+, numColors(colormap.getColors())
+, maxval(theMaxval)
+, shift(0)
+, cells(0)
+, candidates(NULL)
+, minDistance(NULL)
+, cache(NULL)
+{
+  // copy the color LUT, for faster access
+  palette = new int[3 * numColors + 1];
+  for (unsigned long i = 0; i < numColors; ++i)
+  {
+    palette[3 * i]     = OFstatic_cast(int, colormap.getRed(i));
+    palette[3 * i + 1] = OFstatic_cast(int, colormap.getGreen(i));
+    palette[3 * i + 2] = OFstatic_cast(int, colormap.getBlue(i));
+  }
+  minDistance = new long[numColors + 1];
+
+  // determine the size of the cells
+  while ((maxval >> shift) >= DcmQuantInverseColorMapCells) ++shift;
+  cells = (maxval >> shift) + 1;
+  const unsigned long numCells = cells * cells * cells;
+  candidates = new int *[numCells];
+  for (unsigned long k = 0; k < numCells; ++k) candidates[k] = NULL;
+
+  // create the cache (if not too large)
+  const unsigned long colors = (maxval + 1) * (maxval + 1) * (maxval + 1);
+  if (colors <= DcmQuantInverseColorMapCacheSize)
+  {
+    cache = new int[colors];
+    for (unsigned long k = 0; k < colors; ++k) cache[k] = -1;
+  }
+}
+
+
+DcmQuantInverseColorMap::~DcmQuantInverseColorMap()
+{
+  const unsigned long numCells = cells * cells * cells;
+  for (unsigned long k = 0; k < numCells; ++k) delete[] candidates[k];
+  delete[] candidates;
+  delete[] palette;
+  delete[] minDistance;
+  delete[] cache;
+}
+
+
+void DcmQuantInverseColorMap::computeCandidates(unsigned long cell)
+{
+  // determine the bounds of the cell
+  int lower[3];
+  int upper[3];
+  unsigned long c = cell;
+  int i;
+  for (i = 2; i >= 0; --i)
+  {
+    lower[i] = OFstatic_cast(int, (c % cells) << shift);
+    upper[i] = lower[i] + (1 << shift) - 1;
+    if (upper[i] > OFstatic_cast(int, maxval)) upper[i] = OFstatic_cast(int, maxval);
+    c /= cells;
+  }
+
+  // compute the minimum and maximum distance of each LUT entry to the cell.
+  // The closest match for any color in the cell is not farther away than the
+  // smallest maximum distance.
+  long mindist, maxdist, d;
+  const int *color = palette;
+  long minmaxdist = 2000000000;
+  unsigned long j;
+  for (j = 0; j < numColors; ++j, color += 3)
+  {
+    mindist = 0;
+    maxdist = 0;
+    for (i = 0; i < 3; ++i)
+    {
+      if (color[i] < lower[i])
+      {
+        d = lower[i] - color[i];
+        mindist += d * d;
+        d = upper[i] - color[i];
+        maxdist += d * d;
+      }
+      else if (color[i] > upper[i])
+      {
+        d = color[i] - upper[i];
+        mindist += d * d;
+        d = color[i] - lower[i];
+        maxdist += d * d;
+      }
+      else
+      {
+        d = (color[i] - lower[i] > upper[i] - color[i]) ? color[i] - lower[i] : upper[i] - color[i];
+        maxdist += d * d;
+      }
+    }
+    minDistance[j] = mindist;
+    if (maxdist < minmaxdist) minmaxdist = maxdist;
+  }
+
+  // all LUT entries that are not farther away than this are candidates
+  unsigned long count = 0;
+  for (j = 0; j < numColors; ++j)
+  {
+    if (minDistance[j] <= minmaxdist) ++count;
+  }
+  int *list = new int[2 * count + 1];
+  int *entry = list;
+  *entry++ = OFstatic_cast(int, count);
+  for (j = 0; j < numColors; ++j)
+  {
+    if (minDistance[j] <= minmaxdist)
+    {
+      *entry++ = OFstatic_cast(int, minDistance[j]);
+      *entry++ = OFstatic_cast(int, j);
+    }
+  }
+  if (count > 1) qsort(list + 1, count, 2 * sizeof(int), candidatecompare);
+  candidates[cell] = list;
+}
@@ -26,8 +26,8 @@
 #include "dcmtk/dcmimage/diqtid.h"    /* for DcmQuantIdent */
 #include "dcmtk/dcmimage/diqtcmap.h"  /* for DcmQuantColorMapping */
 #include "dcmtk/dcmimage/diqtpix.h"   /* for DcmQuantPixel */
-#include "dcmtk/dcmimage/diqthash.h"  /* for DcmQuantColorHashTable */
 #include "dcmtk/dcmimage/diqtctab.h"  /* for DcmQuantColorTable */
+#include "dcmtk/dcmimage/diqticm.h"   /* for DcmQuantInverseColorMap */
 #include "dcmtk/dcmimage/diqtfs.h"    /* for DcmQuantFloydSteinberg */
 #include "dcmtk/dcmimage/dilogger.h"  /* for logging macros */
 #include "dcmtk/dcmdata/dcswap.h"     /* for swapIfNecessary() */
@@ -82,7 +82,7 @@ OFCondition DcmQuant::createPaletteColorImage(
 
     // map the colors in the image to their closest match in the
     // new colormap, and write 'em out.
-    DcmQuantColorHashTable cht;
+    DcmQuantInverseColorMap icm(colormap, maxval);
     DCMIMAGE_DEBUG("mapping image data to color table");
 
     DcmQuantFloydSteinberg fs;
@@ -118,14 +118,14 @@ OFCondition DcmQuant::createPaletteColorImage(
               if (isByteData)
               {
                 if (floydSteinberg)
-                  DcmQuantColorMapping<DcmQuantFloydSteinberg,Uint8>::create(sourceImage, ff, maxval, cht, colormap, fs, imageData8  + cols*rows*ff);
-                  else DcmQuantColorMapping<DcmQuantIdent,    Uint8>::create(sourceImage, ff, maxval, cht, colormap, id, imageData8  + cols*rows*ff);
+                  DcmQuantColorMapping<DcmQuantFloydSteinberg,Uint8>::create(sourceImage, ff, maxval, icm, colormap, fs, imageData8  + cols*rows*ff);
+                  else DcmQuantColorMapping<DcmQuantIdent,    Uint8>::create(sourceImage, ff, maxval, icm, colormap, id, imageData8  + cols*rows*ff);
               }
               else
               {
                 if (floydSteinberg)
-                  DcmQuantColorMapping<DcmQuantFloydSteinberg,Uint16>::create(sourceImage, ff, maxval, cht, colormap, fs, imageData16 + cols*rows*ff);
-                  else DcmQuantColorMapping<DcmQuantIdent,    Uint16>::create(sourceImage, ff, maxval, cht, colormap, id, imageData16 + cols*rows*ff);
+                  DcmQuantColorMapping<DcmQuantFloydSteinberg,Uint16>::create(sourceImage, ff, maxval, icm, colormap, fs, imageData16 + cols*rows*ff);
+                  else DcmQuantColorMapping<DcmQuantIdent,    Uint16>::create(sourceImage, ff, maxval, icm, colormap, id, imageData16 + cols*rows*ff);
              }
             } // for all frames
 
@@ -90,9 +90,10 @@ void DiRGBImage::Init()
 /*********************************************************************/
 
 
-int DiRGBImage::processNextFrames(const unsigned long fcount)
+int DiRGBImage::processFrames(const unsigned long fstart,
+                              const unsigned long fcount)
 {
-    if (DiImage::processNextFrames(fcount))
+    if (DiImage::processFrames(fstart, fcount))
     {
         delete InterData;
         InterData = NULL;
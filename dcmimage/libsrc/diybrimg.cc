@@ -91,9 +91,10 @@ void DiYBRImage::Init()
 /*********************************************************************/
 
 
-int DiYBRImage::processNextFrames(const unsigned long fcount)
+int DiYBRImage::processFrames(const unsigned long fstart,
+                              const unsigned long fcount)
 {
-    if (DiImage::processNextFrames(fcount))
+    if (DiImage::processFrames(fstart, fcount))
     {
         delete InterData;
         InterData = NULL;
@@ -89,9 +89,10 @@ void DiYBR422Image::Init()
 /*********************************************************************/
 
 
-int DiYBR422Image::processNextFrames(const unsigned long fcount)
+int DiYBR422Image::processFrames(const unsigned long fstart,
+                                 const unsigned long fcount)
 {
-    if (DiImage::processNextFrames(fcount))
+    if (DiImage::processFrames(fstart, fcount))
     {
         delete InterData;
         InterData = NULL;
@@ -88,9 +88,10 @@ void DiYBRPart422Image::Init()
 /*********************************************************************/
 
 
-int DiYBRPart422Image::processNextFrames(const unsigned long fcount)
+int DiYBRPart422Image::processFrames(const unsigned long fstart,
+                                     const unsigned long fcount)
 {
-    if (DiImage::processNextFrames(fcount))
+    if (DiImage::processFrames(fstart, fcount))
     {
         delete InterData;
         InterData = NULL;
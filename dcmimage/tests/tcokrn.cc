@@ -0,0 +1,379 @@
+/*
+ *
+ *  Copyright (C) 2016, OFFIS e.V.
+ *  All rights reserved.  See COPYRIGHT file for details.
+ *
+ *  This software and supporting documentation were developed by
+ *
+ *    OFFIS e.V.
+ *    R&D Division Health
+ *    Escherweg 2
+ *    D-26121 Oldenburg, Germany
+ *
+ *
+ *  Module:  dcmimage
+ *
+ *  Author:  OFFIS DICOM Team
+ *
+ *  Purpose: test that the vectorized color kernels give the same output as
+ *           the generic implementations
+ *
+ */
+
+
+#include "dcmtk/config/osconfig.h"    /* make sure OS specific configuration is included first */
+
+#include "dcmtk/ofstd/oftest.h"
+#include "dcmtk/ofstd/ofvector.h"
+#include "dcmtk/dcmdata/dcdatset.h"
+#include "dcmtk/dcmdata/dcdeftag.h"
+#include "dcmtk/dcmimgle/dcmimage.h"
+#include "dcmtk/dcmimage/diregist.h"
+#include "dcmtk/dcmimage/dicokrn.h"
+
+
+/* numbers of pixels with and without a tail that is not a multiple of the vector size */
+static const unsigned long testCounts[] =
+{
+    0, 1, 2, 7, 15, 16, 17, 30, 31, 32, 33, 47, 48, 49, 63, 64, 65, 1001
+};
+
+#define ARRAY_SIZE(a) (sizeof(a) / sizeof(a[0]))
+
+
+/* fill the given vector with pseudo-random values */
+template<class T>
+static void makeValues(OFVector<T> &values,
+                       const size_t count,
+                       const unsigned long seed)
+{
+    unsigned long state = seed;
+    values.resize(count);
+    for (size_t i = 0; i < count; ++i)
+    {
+        state = state * 1103515245UL + 12345UL;
+        values[i] = OFstatic_cast(T, (state >> 8) & 0xffff);
+    }
+}
+
+/* compare 'count' values of the expected and the actual output. The first differing
+ * value (if any) is reported as a test failure.
+ */
+template<class T1, class T2>
+static OFBool compareValues(const T1 *expected,
+                            const T2 *output,
+                            const unsigned long count,
+                            const char *description,
+                            const unsigned long parameter)
+{
+    for (unsigned long i = 0; i < count; ++i)
+    {
+        if (OFstatic_cast(unsigned long, expected[i]) != OFstatic_cast(unsigned long, output[i]))
+        {
+            OFCHECK_FAIL(description << " (" << parameter << "): value " << i << " is "
+                << OFstatic_cast(unsigned long, output[i]) << " instead of "
+                << OFstatic_cast(unsigned long, expected[i]));
+            return OFFalse;
+        }
+    }
+    return OFTrue;
+}
+
+/* convert the given YCbCr values (color-by-plane and color-by-pixel) with the specialized
+ * and the generic version of DiColorKernel::convertYBRToRGB(), and with the generic version
+ * for 16 bit data, and compare the results
+ */
+static void compareYBRToRGB(const Uint8 *y,
+                            const Uint8 *cb,
+                            const Uint8 *cr,
+                            const unsigned long count)
+{
+    // the data does not start at an aligned address
+    OFVector<Uint8> pixel(3 * count + 1);
+    OFVector<Uint16> y16(count + 1), cb16(count + 1), cr16(count + 1);
+    for (unsigned long i = 0; i < count; ++i)
+    {
+        pixel[3 * i + 1] = y[i];
+        pixel[3 * i + 2] = cb[i];
+        pixel[3 * i + 3] = cr[i];
+        y16[i] = y[i];
+        cb16[i] = cb[i];
+        cr16[i] = cr[i];
+    }
+    OFVector<Uint8> expected(3 * count + 1), output(3 * count + 1);
+    OFVector<Uint16> output16(3 * count + 1);
+    Uint8 *r = &expected[1];
+    Uint8 *g = r + count;
+    Uint8 *b = g + count;
+    DiColorKernel::convertYBRToRGB<Uint8, Uint8>(y, cb, cr, 1, r, g, b, count);
+
+    // color-by-plane
+    DiColorKernel::convertYBRToRGB(y, cb, cr, 1, &output[1], &output[1] + count, &output[1] + 2 * count, count);
+    compareValues(&expected[1], &output[1], 3 * count, "convertYBRToRGB(), color-by-plane, 8 bit", count);
+    DiColorKernel::convertYBRToRGB(&y16[0], &cb16[0], &cr16[0], 1, &output16[1], &output16[1] + count, &output16[1] + 2 * count, count);
+    compareValues(&expected[1], &output16[1], 3 * count, "convertYBRToRGB(), color-by-plane, 16 bit", count);
+
+    // color-by-pixel
+    DiColorKernel::convertYBRToRGB(&pixel[1], &pixel[2], &pixel[3], 3, &output[1], &output[1] + count, &output[1] + 2 * count, count);
+    compareValues(&expected[1], &output[1], 3 * count, "convertYBRToRGB(), color-by-pixel, 8 bit", count);
+}
+
+/* convert the given YCbCr 4:2:2 values with the specialized and the generic version of
+ * DiColorKernel::convertYBR422ToRGB(), and with the generic version for 16 bit data, and
+ * compare the results
+ */
+static void compareYBR422ToRGB(const Uint8 *pixel,
+                               const unsigned long count)
+{
+    OFVector<Uint8> expected(3 * count + 1), output(3 * count + 1);
+    OFVector<Uint16> pixel16(2 * count + 1), output16(3 * count + 1);
+    for (unsigned long i = 0; i < 2 * count; ++i)
+        pixel16[i] = pixel[i];
+    Uint8 *r = &expected[1];
+    DiColorKernel::convertYBR422ToRGB<Uint8, Uint8>(pixel, r, r + count, r + 2 * count, count);
+    DiColorKernel::convertYBR422ToRGB(pixel, &output[1], &output[1] + count, &output[1] + 2 * count, count);
+    compareValues(&expected[1], &output[1], 3 * count, "convertYBR422ToRGB(), 8 bit", count);
+    DiColorKernel::convertYBR422ToRGB(&pixel16[0], &output16[1], &output16[1] + count, &output16[1] + 2 * count, count);
+    compareValues(&expected[1], &output16[1], 3 * count, "convertYBR422ToRGB(), 16 bit", count);
+}
+
+/* split color-by-pixel data into planes with the specialized and the generic version of
+ * DiColorKernel::deinterleave() and compare the results
+ */
+template<class T>
+static void compareDeinterleave(const OFVector<T> &values,
+                                const unsigned long count)
+{
+    OFVector<T> expected(3 * count + 1), output(3 * count + 1);
+    const T *pixel = &values[1];
+    for (unsigned long i = 0; i < count; ++i)
+    {
+        expected[1 + i] = pixel[3 * i];
+        expected[1 + count + i] = pixel[3 * i + 1];
+        expected[1 + 2 * count + i] = pixel[3 * i + 2];
+    }
+    T *plane = &output[1];
+    DiColorKernel::deinterleave(pixel, plane, plane + count, plane + 2 * count, count, OFstatic_cast(T, 0));
+    compareValues(&expected[1], plane, 3 * count, (sizeof(T) == 1) ? "deinterleave(), 8 bit" : "deinterleave(), 16 bit", count);
+    DiColorKernel::deinterleave<T, T>(pixel, plane, plane + count, plane + 2 * count, count, OFstatic_cast(T, 0));
+    compareValues(&expected[1], plane, 3 * count, (sizeof(T) == 1) ? "deinterleave<>(), 8 bit" : "deinterleave<>(), 16 bit", count);
+}
+
+/* merge planes into color-by-pixel data with the specialized and the generic version of
+ * DiColorKernel::interleave() and compare the results
+ */
+template<class T>
+static void compareInterleave(const OFVector<T> &values,
+                              const unsigned long count,
+                              const int inverse,
+                              const T maxvalue)
+{
+    OFVector<T> expected(3 * count + 1), output(3 * count + 1);
+    const T *plane = &values[1];
+    for (unsigned long i = 0; i < count; ++i)
+    {
+        for (unsigned long c = 0; c < 3; ++c)
+        {
+            const T value = plane[c * count + i];
+            expected[1 + 3 * i + c] = inverse ? OFstatic_cast(T, maxvalue - value) : value;
+        }
+    }
+    T *pixel = &output[1];
+    DiColorKernel::interleave(plane, plane + count, plane + 2 * count, pixel, count, inverse, maxvalue);
+    compareValues(&expected[1], pixel, 3 * count, (sizeof(T) == 1) ? "interleave(), 8 bit" : "interleave(), 16 bit", count);
+    DiColorKernel::interleave<T, T>(plane, plane + count, plane + 2 * count, pixel, count, inverse, maxvalue);
+    compareValues(&expected[1], pixel, 3 * count, (sizeof(T) == 1) ? "interleave<>(), 8 bit" : "interleave<>(), 16 bit", count);
+}
+
+/* create a color image dataset with the given pixel values, which are stored color-by-pixel
+ * or color-by-plane as specified by 'planar'
+ */
+static void makeColorDataset(DcmDataset &dset,
+                             const char *photometricInterpretation,
+                             const Uint16 rows,
+                             const Uint16 columns,
+                             const int bits,
+                             const OFBool planar,
+                             const OFVector<Uint16> &pixels)
+{
+    const unsigned long count = OFstatic_cast(unsigned long, rows) * columns;
+    dset.clear();
+    dset.putAndInsertString(DCM_PhotometricInterpretation, photometricInterpretation);
+    dset.putAndInsertUint16(DCM_SamplesPerPixel, 3);
+    dset.putAndInsertUint16(DCM_PlanarConfiguration, planar ? 1 : 0);
+    dset.putAndInsertUint16(DCM_Rows, rows);
+    dset.putAndInsertUint16(DCM_Columns, columns);
+    dset.putAndInsertUint16(DCM_BitsAllocated, OFstatic_cast(Uint16, bits));
+    dset.putAndInsertUint16(DCM_BitsStored, OFstatic_cast(Uint16, bits));
+    dset.putAndInsertUint16(DCM_HighBit, OFstatic_cast(Uint16, bits - 1));
+    dset.putAndInsertUint16(DCM_PixelRepresentation, 0);
+    OFVector<Uint16> values(3 * count);
+    for (unsigned long i = 0; i < count; ++i)
+    {
+        for (unsigned long c = 0; c < 3; ++c)
+            values[planar ? c * count + i : 3 * i + c] = pixels[3 * i + c];
+    }
+    if (bits == 8)
+    {
+        OFVector<Uint8> bytes(values.size());
+        for (size_t j = 0; j < values.size(); ++j)
+            bytes[j] = OFstatic_cast(Uint8, values[j]);
+        dset.putAndInsertUint8Array(DCM_PixelData, &bytes[0], OFstatic_cast(unsigned long, bytes.size()));
+    } else
+        dset.putAndInsertUint16Array(DCM_PixelData, &values[0], OFstatic_cast(unsigned long, values.size()));
+}
+
+/* render the given dataset to color-by-pixel output data with the given number of bits
+ * and compare the result with the expected values
+ */
+static void compareImage(DcmDataset &dset,
+                         const int bits,
+                         const OFBool inverse,
+                         const OFVector<Uint16> &expected,
+                         const char *description)
+{
+    DicomImage image(&dset, EXS_LittleEndianExplicit);
+    OFCHECK_EQUAL(image.getStatus(), EIS_Normal);
+    if (image.getStatus() != EIS_Normal)
+        return;
+    if (inverse)
+        OFCHECK(image.setPolarity(EPP_Reverse));
+    const unsigned long size = image.getOutputDataSize(bits);
+    OFCHECK_EQUAL(size, expected.size() * ((bits > 8) ? 2 : 1));
+    if (size != expected.size() * ((bits > 8) ? 2 : 1))
+        return;
+    if (bits > 8)
+    {
+        OFVector<Uint16> output(expected.size());
+        OFCHECK(image.getOutputData(&output[0], size, bits) != 0);
+        compareValues(&expected[0], &output[0], OFstatic_cast(unsigned long, expected.size()), description, bits);
+    } else {
+        OFVector<Uint8> output(expected.size());
+        OFCHECK(image.getOutputData(&output[0], size, bits) != 0);
+        compareValues(&expected[0], &output[0], OFstatic_cast(unsigned long, expected.size()), description, bits);
+    }
+}
+
+
+OFTEST(dcmimage_colorKernel_YBRToRGB)
+{
+    // all 2^24 combinations of YCbCr values, one Cr value after the other
+    OFVector<Uint8> y(65536), cb(65536), cr(65536);
+    for (unsigned long i = 0; i < 65536; ++i)
+    {
+        y[i] = OFstatic_cast(Uint8, i & 0xff);
+        cb[i] = OFstatic_cast(Uint8, i >> 8);
+    }
+    for (unsigned long value = 0; value < 256; ++value)
+    {
+        for (unsigned long i = 0; i < 65536; ++i)
+            cr[i] = OFstatic_cast(Uint8, value);
+        compareYBRToRGB(&y[0], &cb[0], &cr[0], 65536);
+    }
+
+    // different numbers of pixels and input data that does not start at an aligned address
+    OFVector<Uint8> values;
+    makeValues(values, 3 * 1001 + 3, 1);
+    for (size_t n = 0; n < ARRAY_SIZE(testCounts); ++n)
+        compareYBRToRGB(&values[1], &values[1002], &values[2003], testCounts[n]);
+}
+
+
+OFTEST(dcmimage_colorKernel_YBR422ToRGB)
+{
+    // all 2^24 combinations of YCbCr values, one Cr value after the other; the second
+    // luminance value of each pair is the complement of the first one
+    OFVector<Uint8> pixel(4 * 65536 + 1);
+    for (unsigned long value = 0; value < 256; ++value)
+    {
+        for (unsigned long i = 0; i < 65536; ++i)
+        {
+            pixel[4 * i + 1] = OFstatic_cast(Uint8, i & 0xff);
+            pixel[4 * i + 2] = OFstatic_cast(Uint8, 255 - (i & 0xff));
+            pixel[4 * i + 3] = OFstatic_cast(Uint8, i >> 8);
+            pixel[4 * i + 4] = OFstatic_cast(Uint8, value);
+        }
+        compareYBR422ToRGB(&pixel[1], 2 * 65536);
+    }
+
+    // different numbers of pixels, including odd numbers (where the last pixel is not converted)
+    OFVector<Uint8> values;
+    makeValues(values, 2 * 1001 + 1, 2);
+    for (size_t n = 0; n < ARRAY_SIZE(testCounts); ++n)
+        compareYBR422ToRGB(&values[1], testCounts[n]);
+}
+
+
+OFTEST(dcmimage_colorKernel_reorder)
+{
+    OFVector<Uint8> values8;
+    OFVector<Uint16> values16;
+    makeValues(values8, 3 * 1001 + 1, 3);
+    makeValues(values16, 3 * 1001 + 1, 4);
+    for (size_t n = 0; n < ARRAY_SIZE(testCounts); ++n)
+    {
+        const unsigned long count = testCounts[n];
+        compareDeinterleave(values8, count);
+        compareDeinterleave(values16, count);
+        for (int inverse = 0; inverse < 2; ++inverse)
+        {
+            compareInterleave(values8, count, inverse, OFstatic_cast(Uint8, 255));
+            compareInterleave(values8, count, inverse, OFstatic_cast(Uint8, 127));
+            compareInterleave(values16, count, inverse, OFstatic_cast(Uint16, 65535));
+            compareInterleave(values16, count, inverse, OFstatic_cast(Uint16, 4095));
+        }
+    }
+}
+
+
+OFTEST(dcmimage_colorKernel_image)
+{
+    // an odd number of columns, so that no row is a multiple of the vector size
+    const Uint16 rows = 5;
+    const Uint16 columns = 37;
+    const unsigned long count = OFstatic_cast(unsigned long, rows) * columns;
+    DcmDataset dset;
+    for (int bits = 8; bits <= 16; bits += 8)
+    {
+        OFVector<Uint16> pixels;
+        makeValues(pixels, 3 * count, bits);
+        for (size_t i = 0; i < pixels.size(); ++i)
+            pixels[i] = OFstatic_cast(Uint16, pixels[i] & ((1UL << bits) - 1));
+        OFVector<Uint16> inverted(pixels.size());
+        for (size_t j = 0; j < pixels.size(); ++j)
+            inverted[j] = OFstatic_cast(Uint16, ((1UL << bits) - 1) - pixels[j]);
+
+        // RGB data is split into planes and interleaved again
+        for (int planar = 0; planar < 2; ++planar)
+        {
+            makeColorDataset(dset, "RGB", rows, columns, bits, planar != 0, pixels);
+            compareImage(dset, bits, OFFalse, pixels, planar ? "RGB image, color-by-plane" : "RGB image, color-by-pixel");
+            compareImage(dset, bits, OFTrue, inverted, planar ? "inverse RGB image, color-by-plane" : "inverse RGB image, color-by-pixel");
+        }
+    }
+
+    // YCbCr data is converted to RGB like by the generic version
+    OFVector<Uint16> pixels;
+    makeValues(pixels, 3 * count, 5);
+    OFVector<Uint8> ybr(3 * count), rgb(3 * count);
+    for (unsigned long i = 0; i < count; ++i)
+    {
+        for (unsigned long c = 0; c < 3; ++c)
+        {
+            pixels[3 * i + c] = OFstatic_cast(Uint16, pixels[3 * i + c] & 0xff);
+            ybr[c * count + i] = OFstatic_cast(Uint8, pixels[3 * i + c]);
+        }
+    }
+    DiColorKernel::convertYBRToRGB<Uint8, Uint8>(&ybr[0], &ybr[count], &ybr[2 * count], 1, &rgb[0], &rgb[count], &rgb[2 * count], count);
+    OFVector<Uint16> expected(3 * count);
+    for (unsigned long j = 0; j < count; ++j)
+    {
+        for (unsigned long c = 0; c < 3; ++c)
+            expected[3 * j + c] = rgb[c * count + j];
+    }
+    for (int planar = 0; planar < 2; ++planar)
+    {
+        makeColorDataset(dset, "YBR_FULL", rows, columns, 8, planar != 0, pixels);
+        compareImage(dset, 8, OFFalse, expected, planar ? "YBR_FULL image, color-by-plane" : "YBR_FULL image, color-by-pixel");
+    }
+}
@@ -0,0 +1,34 @@
+/*
+ *
+ *  Copyright (C) 2016, OFFIS e.V.
+ *  All rights reserved.  See COPYRIGHT file for details.
+ *
+ *  This software and supporting documentation were developed by
+ *
+ *    OFFIS e.V.
+ *    R&D Division Health
+ *    Escherweg 2
+ *    D-26121 Oldenburg, Germany
+ *
+ *
+ *  Module:  dcmimage
+ *
+ *  Author:  OFFIS DICOM Team
+ *
+ *  Purpose: main test program
+ *
+ */
+
+#include "dcmtk/config/osconfig.h"
+
+#include "dcmtk/ofstd/oftest.h"
+
+OFTEST_REGISTER(dcmimage_colorKernel_YBRToRGB);
+OFTEST_REGISTER(dcmimage_colorKernel_YBR422ToRGB);
+OFTEST_REGISTER(dcmimage_colorKernel_reorder);
+OFTEST_REGISTER(dcmimage_colorKernel_image);
+OFTEST_REGISTER(dcmimage_quant_inverseColorMap);
+OFTEST_REGISTER(dcmimage_quant_colorTable);
+OFTEST_REGISTER(dcmimage_quant_histogramThreads);
+
+OFTEST_MAIN("dcmimage")
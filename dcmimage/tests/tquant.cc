@@ -0,0 +1,362 @@
+/*
+ *
+ *  Copyright (C) 2016, OFFIS e.V.
+ *  All rights reserved.  See COPYRIGHT file for details.
+ *
+ *  This software and supporting documentation were developed by
+ *
+ *    OFFIS e.V.
+ *    R&D Division Health
+ *    Escherweg 2
+ *    D-26121 Oldenburg, Germany
+ *
+ *
+ *  Module:  dcmimage
+ *
+ *  Author:  OFFIS DICOM Team
+ *
+ *  Purpose: test the color look-up and the histogram computation of the
+ *           color quantization (dcmquant)
+ *
+ */
+
+
+#include "dcmtk/config/osconfig.h"    /* make sure OS specific configuration is included first */
+
+#define INCLUDE_CSTDIO
+#define INCLUDE_CSTRING
+#include "dcmtk/ofstd/ofstdinc.h"
+
+#include "dcmtk/ofstd/oftest.h"
+#include "dcmtk/ofstd/ofvector.h"
+#include "dcmtk/dcmdata/dcdatset.h"
+#include "dcmtk/dcmdata/dcdeftag.h"
+#include "dcmtk/dcmimgle/dcmimage.h"
+#include "dcmtk/dcmimgle/diutils.h"
+#include "dcmtk/dcmimage/diregist.h"
+#include "dcmtk/dcmimage/diqtctab.h"
+#include "dcmtk/dcmimage/diqticm.h"
+
+
+#define ARRAY_SIZE(a) (sizeof(a) / sizeof(a[0]))
+
+
+/* simple pseudo-random number generator, returns values in the range 0..0xffff */
+static unsigned long nextRandom(unsigned long &state)
+{
+    state = state * 1103515245UL + 12345UL;
+    return (state >> 8) & 0xffff;
+}
+
+/* create an 8 bit RGB image (color-by-pixel) with the given pixel data */
+static void makeRGBDataset(DcmDataset &dset,
+                           const Uint16 rows,
+                           const Uint16 columns,
+                           const unsigned long frames,
+                           const OFVector<Uint8> &pixels)
+{
+    dset.clear();
+    dset.putAndInsertString(DCM_PhotometricInterpretation, "RGB");
+    dset.putAndInsertUint16(DCM_SamplesPerPixel, 3);
+    dset.putAndInsertUint16(DCM_PlanarConfiguration, 0);
+    dset.putAndInsertUint16(DCM_Rows, rows);
+    dset.putAndInsertUint16(DCM_Columns, columns);
+    if (frames > 1)
+    {
+        char buf[16];
+        sprintf(buf, "%lu", frames);
+        dset.putAndInsertString(DCM_NumberOfFrames, buf);
+    }
+    dset.putAndInsertUint16(DCM_BitsAllocated, 8);
+    dset.putAndInsertUint16(DCM_BitsStored, 8);
+    dset.putAndInsertUint16(DCM_HighBit, 7);
+    dset.putAndInsertUint16(DCM_PixelRepresentation, 0);
+    dset.putAndInsertUint8Array(DCM_PixelData, &pixels[0], OFstatic_cast(unsigned long, pixels.size()));
+}
+
+/* create a color table with the given number of random colors.  Each color
+ * component is in the range 0..maxval.  The table is the histogram of an image
+ * that contains each color once, i.e. the colors are unique.
+ */
+static void makeRandomPalette(DcmQuantColorTable &palette,
+                              const unsigned long colors,
+                              const unsigned long maxval,
+                              unsigned long seed)
+{
+    OFVector<Uint8> pixels(3 * colors);
+    for (size_t i = 0; i < pixels.size(); ++i)
+        pixels[i] = OFstatic_cast(Uint8, nextRandom(seed) % (maxval + 1));
+    DcmDataset dset;
+    makeRGBDataset(dset, 1, OFstatic_cast(Uint16, colors), 1, pixels);
+    DicomImage image(&dset, EXS_LittleEndianExplicit);
+    OFCHECK_EQUAL(image.getStatus(), EIS_Normal);
+    OFCHECK(palette.computeHistogram(image, DcmQuantMaxColors).good());
+    OFCHECK_EQUAL(palette.getMaxVal(), 255);
+}
+
+/* determine the closest match of the given color in the color table by
+ * checking all entries.  In case of a tie, the lowest index is returned.
+ */
+static int bruteForceIndex(const DcmQuantColorTable &palette,
+                           const DcmQuantPixel &px)
+{
+    int result = -1;
+    long dist = 2000000000;
+    for (unsigned long i = 0; i < palette.getColors(); ++i)
+    {
+        const long r = OFstatic_cast(long, px.getRed()) - palette.getRed(i);
+        const long g = OFstatic_cast(long, px.getGreen()) - palette.getGreen(i);
+        const long b = OFstatic_cast(long, px.getBlue()) - palette.getBlue(i);
+        const long newdist = r * r + g * g + b * b;
+        if (newdist < dist)
+        {
+            result = OFstatic_cast(int, i);
+            dist = newdist;
+        }
+    }
+    return result;
+}
+
+/* look up the given color in the inverse color map (twice, in order to check the
+ * cached result) and, if requested, in the color table, and compare the results
+ * with a brute-force search.  The first difference is reported as a test failure.
+ */
+static OFBool checkIndex(DcmQuantInverseColorMap &icm,
+                         const DcmQuantColorTable &palette,
+                         const OFBool checkTable,
+                         const DcmQuantPixel &px,
+                         const unsigned long maxval)
+{
+    const int expected = bruteForceIndex(palette, px);
+    const int result = icm.computeIndex(px);
+    const int cached = icm.computeIndex(px);
+    const int table = checkTable ? palette.computeIndex(px) : expected;
+    if ((result != expected) || (cached != expected) || (table != expected))
+    {
+        OFCHECK_FAIL("maxval " << maxval << ", " << palette.getColors() << " colors: color ("
+            << OFstatic_cast(unsigned long, px.getRed()) << "," << OFstatic_cast(unsigned long, px.getGreen()) << ","
+            << OFstatic_cast(unsigned long, px.getBlue()) << ") is mapped to "
+            << result << "/" << cached << "/" << table << " instead of " << expected);
+        return OFFalse;
+    }
+    return OFTrue;
+}
+
+/* check the inverse color map (and the color table if requested) for all colors
+ * with components in the range 0..maxval
+ */
+static void checkAllColors(const DcmQuantColorTable &palette,
+                           const OFBool checkTable,
+                           const unsigned long maxval)
+{
+    DcmQuantInverseColorMap icm(palette, maxval);
+    DcmQuantPixel px;
+    for (unsigned long r = 0; r <= maxval; ++r)
+    {
+        for (unsigned long g = 0; g <= maxval; ++g)
+        {
+            for (unsigned long b = 0; b <= maxval; ++b)
+            {
+                px.assign(OFstatic_cast(DcmQuantComponent, r), OFstatic_cast(DcmQuantComponent, g), OFstatic_cast(DcmQuantComponent, b));
+                if (!checkIndex(icm, palette, checkTable, px, maxval))
+                    return;
+            }
+        }
+    }
+}
+
+/* check the inverse color map (and the color table if requested) for the corners
+ * of the color cube and the given number of random colors with components in the
+ * range 0..maxval
+ */
+static void checkRandomColors(const DcmQuantColorTable &palette,
+                              const OFBool checkTable,
+                              const unsigned long maxval,
+                              const unsigned long count,
+                              unsigned long seed)
+{
+    DcmQuantInverseColorMap icm(palette, maxval);
+    DcmQuantPixel px;
+    unsigned long i;
+    for (i = 0; i < 8; ++i)
+    {
+        px.assign(OFstatic_cast(DcmQuantComponent, (i & 4) ? maxval : 0),
+                  OFstatic_cast(DcmQuantComponent, (i & 2) ? maxval : 0),
+                  OFstatic_cast(DcmQuantComponent, (i & 1) ? maxval : 0));
+        if (!checkIndex(icm, palette, checkTable, px, maxval))
+            return;
+    }
+    for (i = 0; i < count; ++i)
+    {
+        const DcmQuantComponent r = OFstatic_cast(DcmQuantComponent, nextRandom(seed) % (maxval + 1));
+        const DcmQuantComponent g = OFstatic_cast(DcmQuantComponent, nextRandom(seed) % (maxval + 1));
+        const DcmQuantComponent b = OFstatic_cast(DcmQuantComponent, nextRandom(seed) % (maxval + 1));
+        px.assign(r, g, b);
+        if (!checkIndex(icm, palette, checkTable, px, maxval))
+            return;
+    }
+}
+
+/* copy the colors of the given color table */
+static void copyColors(const DcmQuantColorTable &table,
+                       OFVector<Uint16> &colors)
+{
+    colors.clear();
+    for (unsigned long i = 0; i < table.getColors(); ++i)
+    {
+        colors.push_back(table.getRed(i));
+        colors.push_back(table.getGreen(i));
+        colors.push_back(table.getBlue(i));
+    }
+}
+
+/* check whether the given colors are identical */
+static OFBool sameColors(const OFVector<Uint16> &colors1,
+                         const OFVector<Uint16> &colors2)
+{
+    return (colors1.size() == colors2.size()) &&
+        (colors1.empty() || (memcmp(&colors1[0], &colors2[0], colors1.size() * sizeof(Uint16)) == 0));
+}
+
+/* compute the histogram of the given image and a color table (with two different
+ * methods of choosing the representative colors) with the given number of threads
+ */
+static void computeColors(DicomImage &image,
+                          const unsigned int threads,
+                          unsigned long &maxval,
+                          OFVector<Uint16> &histogramColors,
+                          OFVector<Uint16> &paletteColors,
+                          OFVector<Uint16> &averageColors)
+{
+    DicomImageClass::setNumberOfThreads(threads);
+    DcmQuantColorTable histogram;
+    OFCHECK(histogram.computeHistogram(image, DcmQuantMaxColors).good());
+    maxval = histogram.getMaxVal();
+    copyColors(histogram, histogramColors);
+    const unsigned long sum = image.getWidth() * image.getHeight() * image.getFrameCount();
+    DcmQuantColorTable palette;
+    OFCHECK(palette.medianCut(histogram, sum, maxval, 256, DcmLargestDimensionType_default, DcmRepresentativeColorType_default).good());
+    copyColors(palette, paletteColors);
+    OFCHECK(palette.medianCut(histogram, sum, maxval, 256, DcmLargestDimensionType_default, DcmRepresentativeColorType_averagePixels).good());
+    copyColors(palette, averageColors);
+}
+
+/* check that the histogram and the color table of the given image do not depend
+ * on the number of threads
+ */
+static void checkThreads(DcmDataset &dset,
+                         const unsigned long expectedMaxval)
+{
+    DicomImage image(&dset, EXS_LittleEndianExplicit);
+    OFCHECK_EQUAL(image.getStatus(), EIS_Normal);
+    unsigned long maxval;
+    OFVector<Uint16> histogramColors, paletteColors, averageColors;
+    computeColors(image, 1, maxval, histogramColors, paletteColors, averageColors);
+    OFCHECK_EQUAL(maxval, expectedMaxval);
+    OFCHECK(!histogramColors.empty());
+    static const unsigned int threadCounts[] = { 2, 3, 4, 8 };
+    for (size_t i = 0; i < ARRAY_SIZE(threadCounts); ++i)
+    {
+        unsigned long threadMaxval;
+        OFVector<Uint16> threadHistogramColors, threadPaletteColors, threadAverageColors;
+        computeColors(image, threadCounts[i], threadMaxval, threadHistogramColors, threadPaletteColors, threadAverageColors);
+        OFCHECK_EQUAL(threadMaxval, maxval);
+        if (!sameColors(threadHistogramColors, histogramColors))
+            OFCHECK_FAIL("histogram differs for " << threadCounts[i] << " threads");
+        if (!sameColors(threadPaletteColors, paletteColors))
+            OFCHECK_FAIL("color table differs for " << threadCounts[i] << " threads");
+        if (!sameColors(threadAverageColors, averageColors))
+            OFCHECK_FAIL("color table (average pixels) differs for " << threadCounts[i] << " threads");
+    }
+}
+
+
+OFTEST(dcmimage_quant_inverseColorMap)
+{
+    // random color tables, all colors are checked.  The inverse color map caches
+    // its results for the smaller values of maxval.
+    static const unsigned long maxvals[] = { 1, 15, 40, 63, 100 };
+    static const unsigned long colors[] = { 3, 2, 17, 256, 64 };
+    for (size_t i = 0; i < ARRAY_SIZE(maxvals); ++i)
+    {
+        DcmQuantColorTable palette;
+        makeRandomPalette(palette, colors[i], maxvals[i], i + 1);
+        OFCHECK(palette.getColors() > 1);
+        checkAllColors(palette, OFFalse, maxvals[i]);
+    }
+
+    // full range of 8 bit values, random colors are checked
+    DcmQuantColorTable palette;
+    makeRandomPalette(palette, 256, 255, 11);
+    checkRandomColors(palette, OFFalse, 255, 100000, 12);
+    makeRandomPalette(palette, 1, 255, 13);
+    OFCHECK_EQUAL(palette.getColors(), 1);
+    checkRandomColors(palette, OFFalse, 255, 1000, 14);
+}
+
+
+OFTEST(dcmimage_quant_colorTable)
+{
+    // color tables created by the median cut algorithm.  Both the color table and
+    // the inverse color map must return the closest match.
+    static const unsigned long maxvals[] = { 63, 255 };
+    for (size_t i = 0; i < ARRAY_SIZE(maxvals); ++i)
+    {
+        const Uint16 rows = 64;
+        const Uint16 columns = 100;
+        OFVector<Uint8> pixels(3 * rows * columns);
+        unsigned long seed = 21 + i;
+        for (size_t j = 0; j < pixels.size(); ++j)
+            pixels[j] = OFstatic_cast(Uint8, nextRandom(seed) % (maxvals[i] + 1));
+        DcmDataset dset;
+        makeRGBDataset(dset, rows, columns, 1, pixels);
+        DicomImage image(&dset, EXS_LittleEndianExplicit);
+        OFCHECK_EQUAL(image.getStatus(), EIS_Normal);
+        DcmQuantColorTable histogram;
+        OFCHECK(histogram.computeHistogram(image, DcmQuantMaxColors).good());
+        DcmQuantColorTable palette;
+        OFCHECK(palette.medianCut(histogram, rows * columns, histogram.getMaxVal(), 200,
+            DcmLargestDimensionType_default, DcmRepresentativeColorType_default).good());
+        OFCHECK_EQUAL(palette.getColors(), 200);
+        if (maxvals[i] < 255)
+            checkAllColors(palette, OFTrue, maxvals[i]);
+        else
+            checkRandomColors(palette, OFTrue, maxvals[i], 100000, 31);
+    }
+}
+
+
+OFTEST(dcmimage_quant_histogramThreads)
+{
+    const unsigned int threads = DicomImageClass::getNumberOfThreads();
+    // large enough to be split into several ranges of rows, with two frames
+    const Uint16 rows = 512;
+    const Uint16 columns = 641;
+    const unsigned long frames = 2;
+    OFVector<Uint8> pixels(3 * rows * columns * frames);
+    DcmDataset dset;
+    unsigned long seed = 41;
+    size_t i;
+
+    // colors from a small set, i.e. most colors occur in all ranges
+    OFVector<Uint8> colors(3 * 1000);
+    for (i = 0; i < colors.size(); ++i)
+        colors[i] = OFstatic_cast(Uint8, nextRandom(seed) >> 8);
+    for (i = 0; i < pixels.size(); i += 3)
+    {
+        const unsigned long c = 3 * (nextRandom(seed) % 1000);
+        pixels[i] = colors[c];
+        pixels[i + 1] = colors[c + 1];
+        pixels[i + 2] = colors[c + 2];
+    }
+    makeRGBDataset(dset, rows, columns, frames, pixels);
+    checkThreads(dset, 255);
+
+    // random colors, too many for a histogram without down-sampling
+    for (i = 0; i < pixels.size(); ++i)
+        pixels[i] = OFstatic_cast(Uint8, nextRandom(seed) >> 8);
+    makeRGBDataset(dset, rows, columns, frames, pixels);
+    checkThreads(dset, 31);
+
+    DicomImageClass::setNumberOfThreads(threads);
+}
@@ -176,6 +176,43 @@ class DCMTK_DCMIMGLE_EXPORT DicomImage
             Image->processNextFrames(fcount) : 0;
     }
 
+    /** process the given range of frames (random access).  In contrast to processNextFrames(),
+     *  this function allows for accessing the frames stored in the DICOM image in any order, e.g.
+     *  for moving back and forth within a cine loop.  Each frame is read (and decompressed if
+     *  required) separately, i.e. the complete pixel data is never loaded.  This requires that
+     *  the image object has been created with the flag CIF_UsePartialAccessToPixelData.
+     *  The intermediate representation of the previously processed frames can be kept in a
+     *  cache in order to avoid decoding them again (see setFrameCacheSize()).  If the requested
+     *  frames cannot be processed, the previously processed frames remain selected.
+     *  NB: Only "original" images can be processed in this way (see processNextFrames()).
+     *
+     ** @param  fstart  number of the first frame to be processed (0..n-1)
+     *  @param  fcount  number of frames to be processed (0 = same number as before)
+     *
+     ** @return status, true if successful, false otherwise
+     */
+    inline int processFrames(const unsigned long fstart,
+                             const unsigned long fcount = 0)
+    {
+        return (Image != NULL) ?
+            Image->processFrames(fstart, fcount) : 0;
+    }
+
+    /** set maximum size of the cache for the intermediate representation of previously processed
+     *  frames (see processFrames()).  The least recently used frames are removed from the cache if
+     *  the given size is exceeded.  Each cache entry refers to the range of frames that has been
+     *  processed at once, i.e. it is only reused if exactly the same range is requested again.
+     *  The cache is cleared when the image is flipped or rotated.
+     *  NB: Currently, the cache is only used for monochrome images.
+     *
+     ** @param  size  maximum size of the cache (in bytes), 0 = disable cache (default)
+     */
+    inline void setFrameCacheSize(const unsigned long size)
+    {
+        if (Image != NULL)
+            Image->setFrameCacheSize(size);
+    }
+
 
  // --- information: return requested value if successful
 
@@ -1371,7 +1408,8 @@ class DCMTK_DCMIMGLE_EXPORT DicomImage
      *  @param  interpolate  specifies whether scaling algorithm should use interpolation (if necessary).
      *                       default: no interpolation (0), preferred interpolation algorithm (if applicable):
      *                         1 = pbmplus algorithm, 2 = c't algorithm, 3 = bilinear magnification,
-     *                         4 = bicubic magnification
+     *                         4 = bicubic magnification, 5 = Lanczos resampling,
+     *                         6 = area averaging (resampling)
      *  @param  aspect       specifies whether pixel aspect ratio should be taken into consideration
      *                       (if true, width OR height should be 0, i.e. this component will be calculated
      *                        automatically)
@@ -1391,7 +1429,8 @@ class DCMTK_DCMIMGLE_EXPORT DicomImage
      *  @param  interpolate  specifies whether scaling algorithm should use interpolation (if necessary).
      *                       default: no interpolation (0), preferred interpolation algorithm (if applicable):
      *                         1 = pbmplus algorithm, 2 = c't algorithm, 3 = bilinear magnification,
-     *                         4 = bicubic magnification
+     *                         4 = bicubic magnification, 5 = Lanczos resampling,
+     *                         6 = area averaging (resampling)
      *  @param  aspect       specifies whether pixel aspect ratio should be taken into consideration
      *                       (if true, width OR height should be 0, i.e. this component will be calculated
      *                        automatically)
@@ -1406,6 +1445,8 @@ class DCMTK_DCMIMGLE_EXPORT DicomImage
     /** create scaled copy of specified (clipping) area of the current image object.
      *  memory is not handled internally - must be deleted from calling program.
      *  NB: Clipping and interpolated scaling at the same moment is not yet fully implemented!
+     *      Only the resampling algorithms (5 and 6) support all combinations of clipping and
+     *      scaling (incl. clipping areas outside the image boundaries).
      *
      ** @param  left_pos      x coordinate of top left corner of area to be scaled
      *                        (referring to image origin, negative values create a border around the image)
@@ -1417,7 +1458,8 @@ class DCMTK_DCMIMGLE_EXPORT DicomImage
      *  @param  interpolate   specifies whether scaling algorithm should use interpolation (if necessary).
      *                        default: no interpolation (0), preferred interpolation algorithm (if applicable):
      *                          1 = pbmplus algorithm, 2 = c't algorithm, 3 = bilinear magnification,
-     *                          4 = bicubic magnification
+     *                          4 = bicubic magnification, 5 = Lanczos resampling,
+     *                          6 = area averaging (resampling)
      *  @param  aspect        specifies whether pixel aspect ratio should be taken into consideration
      *                        (if true, width OR height should be 0, i.e. this component will be calculated
      *                         automatically)
@@ -1449,7 +1491,8 @@ class DCMTK_DCMIMGLE_EXPORT DicomImage
      *  @param  interpolate  specifies whether scaling algorithm should use interpolation (if necessary).
      *                       default: no interpolation (0), preferred interpolation algorithm (if applicable):
      *                         1 = pbmplus algorithm, 2 = c't algorithm, 3 = bilinear magnification,
-     *                         4 = bicubic magnification
+     *                         4 = bicubic magnification, 5 = Lanczos resampling,
+     *                         6 = area averaging (resampling)
      *  @param  aspect       specifies whether pixel aspect ratio should be taken into consideration
      *                       (if true, width OR height should be 0, i.e. this component will be calculated
      *                        automatically)
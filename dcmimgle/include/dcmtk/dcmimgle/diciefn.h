@@ -124,6 +124,12 @@ class DCMTK_DCMIMGLE_EXPORT DiCIELABFunction
 
  protected:
 
+    /** get identifier of the display function type used for the cache of display LUTs
+     *
+     ** @return identifier of the display function type ("CIELAB")
+     */
+    const char *getCacheIdentifier() const;
+
     /** create CIELAB LUT with specified number of entries
      *
      ** @param  count  number of LUT entries
@@ -27,6 +27,10 @@
 
 #include "dcmtk/ofstd/oftypes.h"
 
+#ifdef WITH_THREADS
+#include "dcmtk/ofstd/ofthread.h"
+#endif
+
 #include "dcmtk/dcmimgle/didefine.h"
 
 /*------------------------*
@@ -215,7 +219,13 @@ class DCMTK_DCMIMGLE_EXPORT DiDisplayFunction
      */
     Uint16 getDDLforValue(const double value) const;
 
-    /** create look-up table with specified number of entries
+    /** create look-up table with specified number of entries.
+     *  The LUT is created only once for each depth of input values (unless the number of entries,
+     *  the ambient light or illumination value has changed since).  If supported by the display
+     *  function (see getCacheIdentifier()), it is taken from the process-wide DiDisplayLUTCache,
+     *  i.e. display function objects with identical properties share one LUT.
+     *  This method is thread-safe, but the returned LUT must not be used after the parameters of
+     *  the display function have been changed and another LUT has been requested.
      *
      ** @param  bits   depth of input values
      *  @param  count  number of LUT entries (default: 0 = computed automatically)
@@ -376,6 +386,16 @@ class DCMTK_DCMIMGLE_EXPORT DiDisplayFunction
 
  protected:
 
+    /** get identifier of the display function type used for the process-wide cache of display LUTs
+     *  (see DiDisplayLUTCache).  Derived classes that compute their LUTs only from the data stored in
+     *  this base class (characteristic curve, ambient light, illumination, min/max density) should
+     *  return a unique identifier.  The default implementation returns NULL, i.e. the LUTs are not
+     *  shared with other display function objects.
+     *
+     ** @return identifier of the display function type, NULL if LUTs should not be cached
+     */
+    virtual const char *getCacheIdentifier() const;
+
     /** create display LUT with specified number of entries (abstract method)
      *
      ** @param  count  number of LUT entries
@@ -474,9 +494,16 @@ class DCMTK_DCMIMGLE_EXPORT DiDisplayFunction
     /// array with pointer to the different lookup tables (here: 8-16 bits)
     DiDisplayLUT *LookupTable[MAX_NUMBER_OF_TABLES];
 
+#ifdef WITH_THREADS
+    /// mutex protecting the array of lookup tables
+    OFMutex LookupTableMutex;
+#endif
+
 
  private:
 
+    friend class DiDisplayLUTCache;
+
  // --- declarations to avoid compiler warnings
 
     DiDisplayFunction(const DiDisplayFunction &);
@@ -0,0 +1,232 @@
+/*
+ *
+ *  Copyright (C) 2016, OFFIS e.V.
+ *  All rights reserved.  See COPYRIGHT file for details.
+ *
+ *  This software and supporting documentation were developed by
+ *
+ *    OFFIS e.V.
+ *    R&D Division Health
+ *    Escherweg 2
+ *    D-26121 Oldenburg, Germany
+ *
+ *
+ *  Module:  dcmimgle
+ *
+ *  Author:  OFFIS DICOM Team
+ *
+ *  Purpose: DicomDisplayLUTCache (Header)
+ *
+ */
+
+
+#ifndef DIDLCACH_H
+#define DIDLCACH_H
+
+#include "dcmtk/config/osconfig.h"
+#include "dcmtk/ofstd/oftypes.h"
+#include "dcmtk/ofstd/oflist.h"
+
+#ifdef WITH_THREADS
+#include "dcmtk/ofstd/ofthread.h"
+#endif
+
+#include "dcmtk/dcmimgle/didefine.h"
+
+
+/*------------------------*
+ *  forward declarations  *
+ *------------------------*/
+
+class DiDisplayFunction;
+class DiDisplayLUT;
+
+
+/*---------------------*
+ *  class declaration  *
+ *---------------------*/
+
+/** Class implementing a process-wide cache of display LUTs (see DiDisplayFunction::getLookupTable()).
+ *  A display LUT only depends on the type and the characteristic curve of the display function,
+ *  its current parameters (ambient light, illumination, min/max density) and the number of LUT
+ *  entries.  Display function objects with identical properties, e.g. created from the same
+ *  DISPLAY file for each image, therefore share one LUT instead of computing their own copy.
+ *  The cached LUTs are reference counted.  LUTs that are no longer used by any display function
+ *  object are kept until the maximum number of unused entries is exceeded, i.e. the least
+ *  recently used ones are deleted.
+ *  All methods are thread-safe (if the toolkit is compiled with thread support).  The cached
+ *  LUTs themselves are never modified, so they can be used by several threads concurrently.
+ *  The cache itself is never destroyed, so display function objects with static storage
+ *  duration can still release their LUTs during program termination.
+ */
+class DCMTK_DCMIMGLE_EXPORT DiDisplayLUTCache
+{
+
+ public:
+
+    /** get display LUT for the given display function and number of entries.
+     *  If there is no matching LUT in the cache, it is created by the display function and added
+     *  to the cache (if the display function supports caching).  The caller holds a reference to
+     *  the LUT and has to release it by means of releaseLookupTable() if it is no longer needed.
+     *
+     ** @param  disp   display function for which the LUT is requested
+     *  @param  count  number of LUT entries
+     *
+     ** @return pointer to display LUT if successful, NULL otherwise
+     */
+    static DiDisplayLUT *getLookupTable(DiDisplayFunction &disp,
+                                        const unsigned long count);
+
+    /** release a reference to the given display LUT.
+     *  LUTs that have not been taken from the cache are deleted immediately.
+     *
+     ** @param  lut  display LUT to be released (might be NULL)
+     */
+    static void releaseLookupTable(DiDisplayLUT *lut);
+
+    /** set maximum number of LUTs kept in the cache that are currently not used by any display
+     *  function object.  Removes the least recently used entries if the current number exceeds
+     *  the new maximum.  Default: 16
+     *
+     ** @param  count  maximum number of unused LUTs (0 = delete LUTs as soon as they are unused)
+     */
+    static void setMaximumUnusedEntries(const unsigned long count);
+
+    /** get maximum number of LUTs kept in the cache that are currently not used
+     *
+     ** @return maximum number of unused LUTs
+     */
+    static unsigned long getMaximumUnusedEntries();
+
+    /** get number of LUTs in the cache (including the ones that are currently used)
+     *
+     ** @return number of cached LUTs
+     */
+    static unsigned long getNumberOfEntries();
+
+    /** remove all unused LUTs from the cache.
+     *  LUTs that are still used by a display function object are not affected.
+     */
+    static void clear();
+
+
+ private:
+
+    /** Internal structure for a cache entry.
+     *  Contains a copy of all properties of the display function the LUT depends on.
+     */
+    struct Entry
+    {
+        /// identifier of the display function type (see DiDisplayFunction::getCacheIdentifier())
+        const char *Identifier;
+        /// output device type
+        int DeviceType;
+        /// maximum DDL value
+        Uint16 MaxDDLValue;
+        /// number of DDL and luminance/OD values
+        unsigned long ValueCount;
+        /// array of DDL values
+        Uint16 *DDLValue;
+        /// array of corresponding luminance/OD values
+        double *LODValue;
+        /// minimum luminance/OD value
+        double MinValue;
+        /// maximum luminance/OD value
+        double MaxValue;
+        /// ambient light value
+        double AmbientLight;
+        /// illumination value
+        double Illumination;
+        /// minimum optical density
+        double MinDensity;
+        /// maximum optical density
+        double MaxDensity;
+        /// number of LUT entries
+        unsigned long Count;
+        /// cached display LUT
+        DiDisplayLUT *LookupTable;
+        /// number of references to the display LUT
+        unsigned long References;
+    };
+
+    /** Internal structure for the state of the cache
+     */
+    struct Cache
+    {
+        /** constructor
+         */
+        Cache();
+
+        /// list of cache entries (most recently used first)
+        OFList<Entry *> Entries;
+        /// maximum number of unused entries
+        unsigned long MaximumUnusedEntries;
+#ifdef WITH_THREADS
+        /// mutex protecting the list of cache entries
+        OFMutex Mutex;
+#endif
+    };
+
+    /** get the state of the cache.  It is created on first use and never deleted, i.e. it is
+     *  independent of the order in which static objects are constructed and destroyed.
+     *
+     ** @return reference to the state of the cache
+     */
+    static Cache &getCache();
+
+    /** search for an entry matching the given display function and number of LUT entries.
+     *  If found, the entry is moved to the front of the list and a reference is added.
+     *  The cache has to be locked by the caller.
+     *
+     ** @param  cache  state of the cache
+     *  @param  disp   display function
+     *  @param  count  number of LUT entries
+     *
+     ** @return pointer to matching entry if found, NULL otherwise
+     */
+    static Entry *findEntry(Cache &cache,
+                            const DiDisplayFunction &disp,
+                            const unsigned long count);
+
+    /** check whether the given entry matches the display function and number of LUT entries
+     *
+     ** @param  entry  cache entry to be checked
+     *  @param  disp   display function
+     *  @param  count  number of LUT entries
+     *
+     ** @return true if matching, false otherwise
+     */
+    static OFBool matchesEntry(const Entry &entry,
+                               const DiDisplayFunction &disp,
+                               const unsigned long count);
+
+    /** create a new entry for the given display LUT (with one reference)
+     *
+     ** @param  disp   display function the LUT has been created by
+     *  @param  count  number of LUT entries
+     *  @param  lut    display LUT to be cached
+     *
+     ** @return pointer to new entry
+     */
+    static Entry *createEntry(const DiDisplayFunction &disp,
+                              const unsigned long count,
+                              DiDisplayLUT *lut);
+
+    /** delete the given entry and its display LUT
+     *
+     ** @param  entry  cache entry to be deleted
+     */
+    static void deleteEntry(Entry *entry);
+
+    /** remove the least recently used entries that are not used until the number of unused
+     *  entries does not exceed the given maximum.  The cache has to be locked by the caller.
+     *
+     ** @param  cache    state of the cache
+     *  @param  maximum  maximum number of unused entries
+     */
+    static void reduceSize(Cache &cache,
+                           const unsigned long maximum);
+};
+
+
+#endif
@@ -27,6 +27,7 @@
 
 #include "dcmtk/dcmimgle/dipixel.h"
 #include "dcmtk/dcmimgle/ditranst.h"
+#include "dcmtk/dcmimgle/diparlop.h"
 
 
 /*---------------------*
@@ -137,29 +138,7 @@ class DiFlipTemplate
     inline void flipHorz(const T *src[],
                          T *dest[])
     {
-        if ((src != NULL) && (dest != NULL))
-        {
-            register Uint16 x;
-            register Uint16 y;
-            register const T *p;
-            register T *q;
-            register T *r;
-            for (int j = 0; j < this->Planes; ++j)
-            {
-                p = src[j];
-                r = dest[j];
-                for (Uint32 f = this->Frames; f != 0; --f)
-                {
-                    for (y = this->Src_Y; y != 0; --y)
-                    {
-                        q = r + this->Dest_X;
-                        for (x = this->Src_X; x != 0; --x)
-                            *--q = *p++;
-                        r += this->Dest_X;
-                    }
-                }
-            }
-        }
+        flipFrames(src, dest, &DiFlipTemplate<T>::flipHorzRows);
     }
 
    /** flip source image vertically and store result in destination image
@@ -170,32 +149,7 @@ class DiFlipTemplate
     inline void flipVert(const T *src[],
                          T *dest[])
     {
-        if ((src != NULL) && (dest != NULL))
-        {
-            register Uint16 x;
-            register Uint16 y;
-            register const T *p;
-            register T *q;
-            register T *r;
-            const unsigned long count = OFstatic_cast(unsigned long, this->Dest_X) * OFstatic_cast(unsigned long, this->Dest_Y);
-            for (int j = 0; j < this->Planes; ++j)
-            {
-                p = src[j];
-                r = dest[j];
-                for (Uint32 f = this->Frames; f != 0; --f)
-                {
-                    r += count;
-                    for (y = this->Src_Y; y != 0; --y)
-                    {
-                        q = r - this->Dest_X;
-                        for (x = this->Src_X; x != 0; --x)
-                            *q++ = *p++;
-                        r -= this->Dest_X;
-                    }
-                    r += count;
-                }
-            }
-        }
+        flipFrames(src, dest, &DiFlipTemplate<T>::flipVertRows);
     }
 
    /** flip source image horizontally and vertically and store result in destination image
@@ -206,9 +160,30 @@ class DiFlipTemplate
     inline void flipHorzVert(const T *src[],
                              T *dest[])
     {
-       if ((src != NULL) && (dest != NULL))
-       {
-            register unsigned long i;
+        flipFrames(src, dest, &DiFlipTemplate<T>::flipHorzVertRows);
+    }
+
+ private:
+
+    /// type of the methods flipping a range of rows of a frame and storing the result in another frame
+    typedef void (DiFlipTemplate<T>::*RowsMethod)(const T *, T *, const unsigned long, const unsigned long);
+
+    /// type of the methods flipping a range of rows of a frame in place
+    typedef void (DiFlipTemplate<T>::*InPlaceRowsMethod)(T *, T *, const unsigned long, const unsigned long);
+
+   /** flip all frames of the source image and store result in destination image.
+    *  Large frames are processed by several threads in parallel.
+    *
+    ** @param  src     array of pointers to source image pixels
+    *  @param  dest    array of pointers to destination image pixels
+    *  @param  method  method flipping a range of rows of a frame
+    */
+    inline void flipFrames(const T *src[],
+                           T *dest[],
+                           RowsMethod method)
+    {
+        if ((src != NULL) && (dest != NULL))
+        {
             register const T *p;
             register T *q;
             const unsigned long count = OFstatic_cast(unsigned long, this->Dest_X) * OFstatic_cast(unsigned long, this->Dest_Y);
@@ -218,112 +193,228 @@ class DiFlipTemplate
                 q = dest[j];
                 for (Uint32 f = this->Frames; f != 0; --f)
                 {
-                    q += count;
-                    for (i = count; i != 0; --i)
-                        *--q = *p++;
+                    DiParallelMethodLoop<DiFlipTemplate<T>, const T *, T *> loop(this, method, p, q);
+                    loop.run(this->Src_Y, this->Src_X);
+                    p += count;
                     q += count;
                 }
             }
         }
     }
 
- private:
+   /** flip all frames of the image and store result in the same storage area.
+    *  Large frames are processed by several threads in parallel.
+    *
+    ** @param  data    array of pointers to source/destination image pixels
+    *  @param  method  method flipping a range of rows of a frame in place
+    *  @param  rows    number of rows to be processed by the method
+    */
+    inline void flipFramesInPlace(T *data[],
+                                  InPlaceRowsMethod method,
+                                  const unsigned long rows)
+    {
+        register T *s;
+        const unsigned long count = OFstatic_cast(unsigned long, this->Dest_X) * OFstatic_cast(unsigned long, this->Dest_Y);
+        for (int j = 0; j < this->Planes; ++j)
+        {
+            s = data[j];
+            for (Uint32 f = this->Frames; f != 0; --f)
+            {
+                DiParallelMethodLoop<DiFlipTemplate<T>, T *, T *> loop(this, method, s, s + count);
+                loop.run(rows, this->Src_X);
+                s += count;
+            }
+        }
+    }
 
-   /** flip image horizontally and store result in the same storage area
+   /** flip a range of rows of a frame horizontally
     *
-    ** @param  data  array of pointers to source/destination image pixels
+    ** @param  src    pointer to source frame
+    *  @param  dest   pointer to destination frame
+    *  @param  first  first row to be processed
+    *  @param  last   row after the last one to be processed
     */
-    inline void flipHorz(T *data[])
+    void flipHorzRows(const T *src,
+                      T *dest,
+                      const unsigned long first,
+                      const unsigned long last)
+    {
+        register Uint16 x;
+        register const T *p = src + first * this->Src_X;
+        register T *q;
+        register T *r = dest + first * this->Dest_X;
+        for (unsigned long y = first; y < last; ++y)
+        {
+            q = r + this->Dest_X;
+            for (x = this->Src_X; x != 0; --x)
+                *--q = *p++;
+            r += this->Dest_X;
+        }
+    }
+
+   /** flip a range of rows of a frame vertically
+    *
+    ** @param  src    pointer to source frame
+    *  @param  dest   pointer to destination frame
+    *  @param  first  first row to be processed
+    *  @param  last   row after the last one to be processed
+    */
+    void flipVertRows(const T *src,
+                      T *dest,
+                      const unsigned long first,
+                      const unsigned long last)
+    {
+        register Uint16 x;
+        register const T *p = src + first * this->Src_X;
+        register T *q;
+        register T *r = dest + (OFstatic_cast(unsigned long, this->Dest_Y) - first) * this->Dest_X;
+        for (unsigned long y = first; y < last; ++y)
+        {
+            q = r - this->Dest_X;
+            for (x = this->Src_X; x != 0; --x)
+                *q++ = *p++;
+            r -= this->Dest_X;
+        }
+    }
+
+   /** flip a range of rows of a frame horizontally and vertically
+    *
+    ** @param  src    pointer to source frame
+    *  @param  dest   pointer to destination frame
+    *  @param  first  first row to be processed
+    *  @param  last   row after the last one to be processed
+    */
+    void flipHorzVertRows(const T *src,
+                          T *dest,
+                          const unsigned long first,
+                          const unsigned long last)
+    {
+        register unsigned long i;
+        register const T *p = src + first * this->Src_X;
+        register T *q = dest + (OFstatic_cast(unsigned long, this->Dest_Y) - first) * this->Dest_X;
+        for (i = (last - first) * this->Src_X; i != 0; --i)
+            *--q = *p++;
+    }
+
+   /** flip a range of rows of a frame horizontally in place
+    *
+    ** @param  begin  pointer to the first pixel of the frame
+    *  @param  first  first row to be processed
+    *  @param  last   row after the last one to be processed
+    */
+    void swapPixelsInRows(T *begin,
+                          T * /*end*/,
+                          const unsigned long first,
+                          const unsigned long last)
     {
         register Uint16 x;
-        register Uint16 y;
         register T *p;
         register T *q;
         register T t;
-        T *r;
-        for (int j = 0; j < this->Planes; ++j)
+        T *r = begin + first * this->Dest_X;
+        for (unsigned long y = first; y < last; ++y)
         {
-            r = data[j];
-            for (Uint32 f = this->Frames; f != 0; --f)
+            p = r;
+            r += this->Dest_X;
+            q = r;
+            for (x = this->Src_X / 2; x != 0; --x)
             {
-                for (y = this->Src_Y; y != 0; --y)
-                {
-                    p = r;
-                    r += this->Dest_X;
-                    q = r;
-                    for (x = this->Src_X / 2; x != 0; --x)
-                    {
-                        t = *p;
-                        *p++ = *--q;
-                        *q = t;
-                    }
-                }
+                t = *p;
+                *p++ = *--q;
+                *q = t;
             }
         }
     }
 
-   /** flip image vertically and store result in the same storage area
+   /** flip a frame vertically in place by swapping a range of rows of the upper half of
+    *  the frame with the corresponding rows of the lower half
     *
-    ** @param  data  array of pointers to source/destination image pixels
+    ** @param  begin  pointer to the first pixel of the frame
+    *  @param  end    pointer after the last pixel of the frame
+    *  @param  first  first row to be processed (less than half the number of rows)
+    *  @param  last   row after the last one to be processed
     */
-    inline void flipVert(T *data[])
+    void swapRows(T *begin,
+                  T *end,
+                  const unsigned long first,
+                  const unsigned long last)
     {
         register Uint16 x;
-        register Uint16 y;
-        register T *p;
+        register T *p = begin + first * this->Dest_X;
         register T *q;
-        register T *r;
+        register T *r = end - first * this->Dest_X;
         register T t;
-        T *s;
-        const unsigned long count = OFstatic_cast(unsigned long, this->Dest_X) * OFstatic_cast(unsigned long, this->Dest_Y);
-        for (int j = 0; j < this->Planes; ++j)
+        for (unsigned long y = first; y < last; ++y)
         {
-            s = data[j];
-            for (Uint32 f = this->Frames; f != 0; --f)
+            r -= this->Dest_X;
+            q = r;
+            for (x = this->Src_X; x != 0; --x)
             {
-                p = s;
-                s += count;
-                r = s;
-                for (y = this->Src_Y / 2; y != 0; --y)
-                {
-                    r -= this->Dest_X;
-                    q = r;
-                    for (x = this->Src_X; x != 0; --x)
-                    {
-                        t = *p;
-                        *p++ = *q;
-                        *q++ = t;
-                    }
-                }
+                t = *p;
+                *p++ = *q;
+                *q++ = t;
             }
         }
     }
 
+   /** flip a frame horizontally and vertically in place by swapping a range of pixels with
+    *  the corresponding pixels from the end of the frame (in reverse order)
+    *
+    ** @param  begin  pointer to the first pixel of the frame
+    *  @param  end    pointer after the last pixel of the frame
+    *  @param  first  first pixel to be processed (less than half the number of pixels)
+    *  @param  last   pixel after the last one to be processed
+    */
+    void swapPixels(T *begin,
+                    T *end,
+                    const unsigned long first,
+                    const unsigned long last)
+    {
+        register unsigned long i;
+        register T *p = begin + first;
+        register T *q = end - first;
+        register T t;
+        for (i = last - first; i != 0; --i)
+        {
+            t = *p;
+            *p++ = *--q;
+            *q = t;
+        }
+    }
+
+   /** flip image horizontally and store result in the same storage area
+    *
+    ** @param  data  array of pointers to source/destination image pixels
+    */
+    inline void flipHorz(T *data[])
+    {
+        flipFramesInPlace(data, &DiFlipTemplate<T>::swapPixelsInRows, this->Src_Y);
+    }
+
+   /** flip image vertically and store result in the same storage area
+    *
+    ** @param  data  array of pointers to source/destination image pixels
+    */
+    inline void flipVert(T *data[])
+    {
+        flipFramesInPlace(data, &DiFlipTemplate<T>::swapRows, this->Src_Y / 2);
+    }
+
    /** flip image horizontally and vertically and store result in the same storage area
     *
     ** @param  data  array of pointers to source/destination image pixels
     */
     inline void flipHorzVert(T *data[])
     {
-        register unsigned long i;
-        register T *p;
-        register T *q;
-        register T t;
-        T *s;
         const unsigned long count = OFstatic_cast(unsigned long, this->Dest_X) * OFstatic_cast(unsigned long, this->Dest_Y);
+        register T *s;
         for (int j = 0; j < this->Planes; ++j)
         {
             s = data[j];
             for (Uint32 f = this->Frames; f != 0; --f)
             {
-                p = s;
-                q = s + count;
-                for (i = count / 2; i != 0; --i)
-                {
-                    t = *p;
-                    *p++ = *--q;
-                    *q = t;
-                }
+                DiParallelMethodLoop<DiFlipTemplate<T>, T *, T *> loop(this, &DiFlipTemplate<T>::swapPixels, s, s + count);
+                loop.run(count / 2, 2);
                 s += count;
             }
         }
@@ -0,0 +1,161 @@
+/*
+ *
+ *  Copyright (C) 2016, OFFIS e.V.
+ *  All rights reserved.  See COPYRIGHT file for details.
+ *
+ *  This software and supporting documentation were developed by
+ *
+ *    OFFIS e.V.
+ *    R&D Division Health
+ *    Escherweg 2
+ *    D-26121 Oldenburg, Germany
+ *
+ *
+ *  Module:  dcmimgle
+ *
+ *  Author:  OFFIS DICOM Team
+ *
+ *  Purpose: DicomFrameCache (Header)
+ *
+ */
+
+
+#ifndef DIFRCACH_H
+#define DIFRCACH_H
+
+#include "dcmtk/config/osconfig.h"
+#include "dcmtk/ofstd/oflist.h"
+
+#include "dcmtk/dcmimgle/didefine.h"
+
+
+/*------------------------*
+ *  forward declarations  *
+ *------------------------*/
+
+class DiPixel;
+
+
+/*---------------------*
+ *  class declaration  *
+ *---------------------*/
+
+/** Class implementing a cache for the intermediate representation of previously processed
+ *  frames of a multi-frame image (see DicomImage::processFrames()).  The entries are ordered
+ *  by the time of their last use.  If the total size of the cached pixel data exceeds the
+ *  maximum size, the least recently used entries are removed.
+ *  By default, the maximum size is 0, i.e. the cache is disabled.
+ */
+class DCMTK_DCMIMGLE_EXPORT DiFrameCache
+{
+
+ public:
+
+    /** constructor
+     */
+    DiFrameCache();
+
+    /** destructor.
+     *  Deletes all cached pixel data objects.
+     */
+    virtual ~DiFrameCache();
+
+    /** set maximum size of the cache.
+     *  Removes the least recently used entries if the current size exceeds the new maximum.
+     *
+     ** @param  size  maximum size of the cached pixel data (in bytes), 0 = disable cache
+     */
+    void setMaximumSize(const unsigned long size);
+
+    /** get maximum size of the cache
+     *
+     ** @return maximum size of the cached pixel data (in bytes)
+     */
+    inline unsigned long getMaximumSize() const
+    {
+        return MaximumSize;
+    }
+
+    /** get current size of the cache
+     *
+     ** @return current size of the cached pixel data (in bytes)
+     */
+    inline unsigned long getCurrentSize() const
+    {
+        return CurrentSize;
+    }
+
+    /** get number of entries in the cache
+     *
+     ** @return number of cached pixel data objects
+     */
+    inline unsigned long getNumberOfEntries() const
+    {
+        return OFstatic_cast(unsigned long, Entries.size());
+    }
+
+    /** add the intermediate representation of a range of frames to the cache.
+     *  The cache takes over the ownership of the pixel data object.  If the object is too large
+     *  for the cache (or the cache is disabled), it is deleted immediately.
+     *
+     ** @param  fstart  number of the first frame stored in the pixel data object
+     *  @param  fcount  number of frames stored in the pixel data object
+     *  @param  pixel   pixel data object to be cached (might be NULL)
+     *
+     ** @return true if the object has been added to the cache, false otherwise
+     */
+    OFBool addFrames(const unsigned long fstart,
+                     const unsigned long fcount,
+                     DiPixel *pixel);
+
+    /** remove the intermediate representation of a range of frames from the cache.
+     *  The caller takes over the ownership of the returned pixel data object.
+     *
+     ** @param  fstart  number of the first frame
+     *  @param  fcount  number of frames
+     *
+     ** @return pixel data object for the given range of frames, NULL if not cached
+     */
+    DiPixel *removeFrames(const unsigned long fstart,
+                          const unsigned long fcount);
+
+    /** remove all entries from the cache and delete the cached pixel data objects
+     */
+    void clear();
+
+
+ private:
+
+    /** Internal structure for a cache entry
+     */
+    struct Entry
+    {
+        /// number of the first frame
+        unsigned long FirstFrame;
+        /// number of frames
+        unsigned long NumberOfFrames;
+        /// size of the pixel data (in bytes)
+        unsigned long Size;
+        /// cached pixel data object
+        DiPixel *Pixel;
+    };
+
+    /** remove least recently used entries until the current size does not exceed the maximum
+     */
+    void reduceSize();
+
+    /// list of cache entries (most recently used first)
+    OFList<Entry *> Entries;
+    /// maximum size of the cached pixel data (in bytes)
+    unsigned long MaximumSize;
+    /// current size of the cached pixel data (in bytes)
+    unsigned long CurrentSize;
+
+ // --- declarations to avoid compiler warnings
+
+    DiFrameCache(const DiFrameCache &);
+    DiFrameCache &operator=(const DiFrameCache &);
+};
+
+
+#endif
@@ -176,6 +176,12 @@ class DCMTK_DCMIMGLE_EXPORT DiGSDFunction
 
  protected:
 
+    /** get identifier of the display function type used for the cache of display LUTs
+     *
+     ** @return identifier of the display function type ("GSDF")
+     */
+    const char *getCacheIdentifier() const;
+
     /** create GSDF LUT with specified number of entries
      *
      ** @param  count  number of LUT entries
@@ -33,6 +33,7 @@
 #endif
 
 #include "dcmtk/dcmimgle/diovlay.h"
+#include "dcmtk/dcmimgle/difrcach.h"
 #include "dcmtk/dcmimgle/diutils.h"
 
 #define INCLUDE_CSTDIO
@@ -84,7 +85,9 @@ class DCMTK_DCMIMGLE_EXPORT DiImage
      */
     virtual ~DiImage();
 
-    /** process next couple of frames
+    /** process next couple of frames.
+     *  The default implementation calls processFrames() for the frames following the
+     *  currently processed ones, i.e. also makes use of the frame cache (if enabled).
      *
      ** @param  fcount  number of frames to be processed (0 = same number as before)
      *
@@ -92,6 +95,27 @@ class DCMTK_DCMIMGLE_EXPORT DiImage
      */
     virtual int processNextFrames(const unsigned long fcount);
 
+    /** process the given range of frames (random access).
+     *  Requires that the image has been created with CIF_UsePartialAccessToPixelData.
+     *
+     ** @param  fstart  number of the first frame to be processed (0..n-1)
+     *  @param  fcount  number of frames to be processed (0 = same number as before)
+     *
+     ** @return status, true if successful, false otherwise
+     */
+    virtual int processFrames(const unsigned long fstart,
+                              const unsigned long fcount);
+
+    /** set maximum size of the cache for the intermediate representation of previously
+     *  processed frames (see processFrames()).  Currently, only used for monochrome images.
+     *
+     ** @param  size  maximum size of the cache (in bytes), 0 = disable cache (default)
+     */
+    inline void setFrameCacheSize(const unsigned long size)
+    {
+        FrameCache.setMaximumSize(size);
+    }
+
     /** get status of the image object
      *
      ** @return status of the image object
@@ -357,7 +381,8 @@ class DCMTK_DCMIMGLE_EXPORT DiImage
      *  @param  interpolate   specifies whether scaling algorithm should use interpolation (if necessary).
      *                        default: no interpolation (0), preferred interpolation algorithm (if applicable):
      *                          1 = pbmplus algorithm, 2 = c't algorithm, 3 = bilinear magnification,
-     *                          4 = bicubic magnification
+     *                          4 = bicubic magnification, 5 = Lanczos resampling,
+     *                          6 = area averaging (resampling)
      *  @param  aspect        specifies whether pixel aspect ratio should be taken into consideration
      *                        (if true, width OR height should be 0, i.e. this component will be calculated
      *                         automatically)
@@ -582,6 +607,46 @@ class DCMTK_DCMIMGLE_EXPORT DiImage
             const int stored,
             const int alloc);
 
+    /** check whether the given frame can be processed separately, i.e. whether partial
+     *  access to the pixel data is enabled and the frame exists
+     *
+     ** @param  fstart  number of the first frame to be processed
+     *
+     ** @return true if frame can be processed, false otherwise
+     */
+    int checkFrames(const unsigned long fstart) const;
+
+    /** determine the number of frames that would be selected by selectFrames()
+     *
+     ** @param  fstart  number of the first frame to be processed
+     *  @param  fcount  number of frames to be processed (0 = same number as before)
+     *
+     ** @return number of frames to be processed (limited to the number of frames stored)
+     */
+    unsigned long determineFrameCount(const unsigned long fstart,
+                                      const unsigned long fcount) const;
+
+    /** select the range of frames to be processed (without converting the pixel data)
+     *
+     ** @param  fstart  number of the first frame to be processed
+     *  @param  fcount  number of frames to be processed (0 = same number as before)
+     */
+    void selectFrames(const unsigned long fstart,
+                      const unsigned long fcount);
+
+    /** select the given range of frames and create the input pixel data representation for
+     *  them.  If successful, the input pixel data of the previously processed frames (if any)
+     *  is deleted.  Otherwise, the previous frame selection and input pixel data are restored
+     *  and the image status remains unchanged, i.e. the image can still be used.
+     *
+     ** @param  fstart  number of the first frame to be processed
+     *  @param  fcount  number of frames to be processed (0 = same number as before)
+     *
+     ** @return status, true if successful, false otherwise
+     */
+    int decodeFrames(const unsigned long fstart,
+                     const unsigned long fcount);
+
     /** delete internally handled object for the input pixel data conversion
      */
     void deleteInputData();
@@ -665,6 +730,8 @@ class DCMTK_DCMIMGLE_EXPORT DiImage
     DcmFileCache FileCache;
     /// current pixel item fragment (for encapsulated pixel data)
     Uint32 CurrentFragment;
+    /// cache for the intermediate representation of previously processed frames
+    DiFrameCache FrameCache;
 
  // --- declarations to avoid compiler warnings
 
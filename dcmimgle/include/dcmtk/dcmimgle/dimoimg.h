@@ -90,13 +90,19 @@ class DCMTK_DCMIMGLE_EXPORT DiMonoImage
      */
     virtual ~DiMonoImage();
 
-    /** process next couple of frames
+    /** process the given range of frames (random access).
+     *  The intermediate representation of the previously processed frames is stored in the
+     *  frame cache (if enabled, see setFrameCacheSize()) and reused if these frames are
+     *  requested again.  If the new frames cannot be processed (e.g. because of a decompression
+     *  error), the previously processed frames remain selected and valid.
      *
-     ** @param  fcount  number of frames to be processed (0 = same number as before)
+     ** @param  fstart  number of the first frame to be processed (0..n-1)
+     *  @param  fcount  number of frames to be processed (0 = same number as before)
      *
      ** @return status, true if successful, false otherwise
      */
-    virtual int processNextFrames(const unsigned long fcount);
+    virtual int processFrames(const unsigned long fstart,
+                              const unsigned long fcount);
 
     /** get minimum and maximum pixel values.
      *  the resulting pixel values are stored in 'double' variables to avoid problems
@@ -356,7 +362,9 @@ class DCMTK_DCMIMGLE_EXPORT DiMonoImage
      */
     inline const char *getModalityLutExplanation() const
     {
-        return (InterData != NULL) ? InterData->getModalityLutExplanation() : OFstatic_cast(const char *, NULL);
+        if (InterData != NULL)
+            return InterData->getModalityLutExplanation();
+        return (DeferredModality != NULL) ? DeferredModality->getExplanation() : OFstatic_cast(const char *, NULL);
     }
 
     /** set hardcopy parameters. (used to display LinOD images)
@@ -655,21 +663,25 @@ class DCMTK_DCMIMGLE_EXPORT DiMonoImage
                                             unsigned long &frames,
                                             const unsigned int idx = 0);
 
-    /** get pointer to intermediate pixel data representation
+    /** get pointer to intermediate pixel data representation.
+     *  The intermediate representation is created on demand (if not yet done).
      *
      ** @return pointer to intermediate pixel data
      */
     const DiPixel *getInterData() const
     {
+        OFconst_cast(DiMonoImage *, this)->createInterData();
         return InterData;
     }
 
-    /** get pointer to intermediate pixel data representation
+    /** get pointer to intermediate pixel data representation.
+     *  The intermediate representation is created on demand (if not yet done).
      *
      ** @return pointer to intermediate pixel data
      */
     const DiMonoPixel *getMonoInterData() const
     {
+        OFconst_cast(DiMonoImage *, this)->createInterData();
         return InterData;
     }
 
@@ -846,7 +858,8 @@ class DCMTK_DCMIMGLE_EXPORT DiMonoImage
      *  @param  interpolate   specifies whether scaling algorithm should use interpolation (if necessary).
      *                        default: no interpolation (0), preferred interpolation algorithm (if applicable):
      *                          1 = pbmplus algorithm, 2 = c't algorithm, 3 = bilinear magnification,
-     *                          4 = bicubic magnification
+     *                          4 = bicubic magnification, 5 = Lanczos resampling,
+     *                          6 = area averaging (resampling)
      *  @param  aspect        specifies whether pixel aspect ratio should be taken into consideration
      *                        (if true, width OR height should be 0, i.e. this component will be calculated
      *                         automatically)
@@ -903,41 +916,93 @@ class DCMTK_DCMIMGLE_EXPORT DiMonoImage
     void Init(DiMonoModality *modality,
               const OFBool reuse = OFFalse);
 
-    /** initialize internal data structures (for Uint8)
+    /** create intermediate representation from the given input data (for Uint8)
      *
-     ** @param  modality  pointer to object handling the modality transform
+     ** @param  input     pointer to input pixel representation
+     *  @param  modality  pointer to object handling the modality transform (reference is taken over)
+     *
+     ** @return pointer to new intermediate representation, NULL if unsupported
      */
-    void InitUint8(DiMonoModality *modality);
+    DiMonoPixel *InitUint8(DiInputPixel *input,
+                           DiMonoModality *modality);
 
-    /** initialize internal data structures (for Sint8)
+    /** create intermediate representation from the given input data (for Sint8)
      *
-     ** @param  modality  pointer to object handling the modality transform
+     ** @param  input     pointer to input pixel representation
+     *  @param  modality  pointer to object handling the modality transform (reference is taken over)
+     *
+     ** @return pointer to new intermediate representation, NULL if unsupported
      */
-    void InitSint8(DiMonoModality *modality);
+    DiMonoPixel *InitSint8(DiInputPixel *input,
+                           DiMonoModality *modality);
 
-    /** initialize internal data structures (for Uint16)
+    /** create intermediate representation from the given input data (for Uint16)
      *
-     ** @param  modality  pointer to object handling the modality transform
+     ** @param  input     pointer to input pixel representation
+     *  @param  modality  pointer to object handling the modality transform (reference is taken over)
+     *
+     ** @return pointer to new intermediate representation, NULL if unsupported
      */
-    void InitUint16(DiMonoModality *modality);
+    DiMonoPixel *InitUint16(DiInputPixel *input,
+                            DiMonoModality *modality);
 
-    /** initialize internal data structures (for Sint16)
+    /** create intermediate representation from the given input data (for Sint16)
      *
-     ** @param  modality  pointer to object handling the modality transform
+     ** @param  input     pointer to input pixel representation
+     *  @param  modality  pointer to object handling the modality transform (reference is taken over)
+     *
+     ** @return pointer to new intermediate representation, NULL if unsupported
      */
-    void InitSint16(DiMonoModality *modality);
+    DiMonoPixel *InitSint16(DiInputPixel *input,
+                            DiMonoModality *modality);
 
-    /** initialize internal data structures (for Uint32)
+    /** create intermediate representation from the given input data (for Uint32)
      *
-     ** @param  modality  pointer to object handling the modality transform
+     ** @param  input     pointer to input pixel representation
+     *  @param  modality  pointer to object handling the modality transform (reference is taken over)
+     *
+     ** @return pointer to new intermediate representation, NULL if unsupported
      */
-    void InitUint32(DiMonoModality *modality);
+    DiMonoPixel *InitUint32(DiInputPixel *input,
+                            DiMonoModality *modality);
 
-    /** initialize internal data structures (for Sint32)
+    /** create intermediate representation from the given input data (for Sint32)
      *
-     ** @param  modality  pointer to object handling the modality transform
+     ** @param  input     pointer to input pixel representation
+     *  @param  modality  pointer to object handling the modality transform (reference is taken over)
+     *
+     ** @return pointer to new intermediate representation, NULL if unsupported
      */
-    void InitSint32(DiMonoModality *modality);
+    DiMonoPixel *InitSint32(DiInputPixel *input,
+                            DiMonoModality *modality);
+
+    /** create intermediate representation from the given input data.
+     *  Calls the appropriate InitXXX() function depending on the input representation.
+     *
+     ** @param  input     pointer to input pixel representation
+     *  @param  modality  pointer to object handling the modality transform (reference is taken over)
+     *
+     ** @return pointer to new intermediate representation, NULL if unsupported
+     */
+    DiMonoPixel *convertInputData(DiInputPixel *input,
+                                  DiMonoModality *modality);
+
+    /** create intermediate representation from the stored pixel values (if not yet done).
+     *  If the image object has been created with CIF_CreateIntermediateDataOnDemand, the
+     *  creation of the intermediate representation is deferred until it is actually required.
+     *
+     ** @return status, true if intermediate representation exists, false otherwise
+     */
+    int createInterData();
+
+    /** check whether the output data can be rendered directly from the stored pixel values,
+     *  i.e. whether the creation of the intermediate representation can be deferred.  This is
+     *  the case for stored pixel values with up to 16 bits, if the frames are large enough
+     *  compared to the number of possible stored pixel values.
+     *
+     ** @return true if output data can be rendered directly, false otherwise
+     */
+    int checkDirectRendering() const;
 
     /** check intermediate pixel representation for consistency
      *
@@ -973,119 +1038,225 @@ class DCMTK_DCMIMGLE_EXPORT DiMonoImage
                         const int planar,
                         const int negative);
 
-    /** get pixel data with specified format for Uint8 input (helper function).
-     *  (memory is handled externally)
-     *
-     ** @param  buffer   untyped pointer to the externally allocated memory buffer
-     *  @param  disp     pointer to current display function object
-     *  @param  samples  number of samples per pixel
-     *  @param  frame    number of frame to be rendered
-     *  @param  bits     number of bits for the output pixel data (depth)
-     *  @param  low      output pixel value to which 0 is mapped (min)
-     *  @param  high     output pixel value to which 2^bits-1 is mapped (max)
-     */
-    void getDataUint8(void *buffer,
-                      DiDisplayFunction *disp,
-                      const int samples,
-                      const unsigned long frame,
-                      const int bits,
-                      const Uint32 low,
-                      const Uint32 high);
-
-    /** get pixel data with specified format for Sint8 input (helper function).
-     *  (memory is handled externally)
-     *
-     ** @param  buffer   untyped pointer to the externally allocated memory buffer
-     *  @param  disp     pointer to current display function object
-     *  @param  samples  number of samples per pixel
-     *  @param  frame    number of frame to be rendered
-     *  @param  bits     number of bits for the output pixel data (depth)
-     *  @param  low      output pixel value to which 0 is mapped (min)
-     *  @param  high     output pixel value to which 2^bits-1 is mapped (max)
-     */
-    void getDataSint8(void *buffer,
-                      DiDisplayFunction *disp,
-                      const int samples,
-                      const unsigned long frame,
-                      const int bits,
-                      const Uint32 low,
-                      const Uint32 high);
-
-    /** get pixel data with specified format for Uint16 input (helper function).
-     *  (memory is handled externally)
-     *
-     ** @param  buffer   untyped pointer to the externally allocated memory buffer
-     *  @param  disp     pointer to current display function object
-     *  @param  samples  number of samples per pixel
-     *  @param  frame    number of frame to be rendered
-     *  @param  bits     number of bits for the output pixel data (depth)
-     *  @param  low      output pixel value to which 0 is mapped (min)
-     *  @param  high     output pixel value to which 2^bits-1 is mapped (max)
-     */
-    void getDataUint16(void *buffer,
-                       DiDisplayFunction *disp,
-                       const int samples,
-                       const unsigned long frame,
-                       const int bits,
-                       const Uint32 low,
-                       const Uint32 high);
-
-    /** get pixel data with specified format for Sint16 input (helper function).
-     *  (memory is handled externally)
-     *
-     ** @param  buffer   untyped pointer to the externally allocated memory buffer
-     *  @param  disp     pointer to current display function object
-     *  @param  samples  number of samples per pixel
-     *  @param  frame    number of frame to be rendered
-     *  @param  bits     number of bits for the output pixel data (depth)
-     *  @param  low      output pixel value to which 0 is mapped (min)
-     *  @param  high     output pixel value to which 2^bits-1 is mapped (max)
-     */
-    void getDataSint16(void *buffer,
-                       DiDisplayFunction *disp,
-                       const int samples,
-                       const unsigned long frame,
-                       const int bits,
-                       const Uint32 low,
-                       const Uint32 high);
-
-    /** get pixel data with specified format for Uint32 input (helper function).
-     *  (memory is handled externally)
+    /** create output data with specified format for the given intermediate representation.
+     *  Calls the appropriate getDataXXX() function depending on the intermediate representation.
+     *  See there for the parameters.
+     *
+     ** @return pointer to new output data object, NULL if unsupported
+     */
+    DiMonoOutputPixel *createOutputData(void *buffer,
+                                        const DiMonoPixel *inter,
+                                        DiOverlay *overlays[2],
+                                        DiDisplayFunction *disp,
+                                        const int samples,
+                                        const unsigned long frame,
+                                        const int bits,
+                                        const Uint32 low,
+                                        const Uint32 high,
+                                        const Uint16 columns,
+                                        const Uint16 rows,
+                                        const unsigned long frames);
+
+    /** create output data with specified format directly from the stored pixel values, i.e.
+     *  without creating the intermediate representation.  All transformations are applied to
+     *  each possible stored pixel value once, the resulting table is then applied to the pixel
+     *  data of the selected frame in a single pass.
+     *
+     ** @param  buffer  untyped pointer to the externally allocated memory buffer (maybe NULL)
+     *  @param  disp    pointer to current display function object
+     *  @param  frame   number of frame to be rendered
+     *  @param  bits    number of bits for the output pixel data (depth)
+     *  @param  low     output pixel value to which 0 is mapped (min)
+     *  @param  high    output pixel value to which 2^bits-1 is mapped (max)
      *
-     ** @param  buffer   untyped pointer to the externally allocated memory buffer
-     *  @param  disp     pointer to current display function object
-     *  @param  samples  number of samples per pixel
-     *  @param  frame    number of frame to be rendered
-     *  @param  bits     number of bits for the output pixel data (depth)
-     *  @param  low      output pixel value to which 0 is mapped (min)
-     *  @param  high     output pixel value to which 2^bits-1 is mapped (max)
-     */
-    void getDataUint32(void *buffer,
-                       DiDisplayFunction *disp,
-                       const int samples,
-                       const unsigned long frame,
-                       const int bits,
-                       const Uint32 low,
-                       const Uint32 high);
-
-    /** get pixel data with specified format for Sint32 input (helper function).
-     *  (memory is handled externally)
+     ** @return pointer to new output data object, NULL if not possible
+     */
+    DiMonoOutputPixel *getDataDirect(void *buffer,
+                                     DiDisplayFunction *disp,
+                                     const unsigned long frame,
+                                     const int bits,
+                                     const Uint32 low,
+                                     const Uint32 high);
+
+    /** create output data with specified format for Uint8 intermediate data (helper function).
      *
-     ** @param  buffer   untyped pointer to the externally allocated memory buffer
-     *  @param  disp     pointer to current display function object
-     *  @param  samples  number of samples per pixel
-     *  @param  frame    number of frame to be rendered
-     *  @param  bits     number of bits for the output pixel data (depth)
-     *  @param  low      output pixel value to which 0 is mapped (min)
-     *  @param  high     output pixel value to which 2^bits-1 is mapped (max)
-     */
-    void getDataSint32(void *buffer,
-                       DiDisplayFunction *disp,
-                       const int samples,
-                       const unsigned long frame,
-                       const int bits,
-                       const Uint32 low,
-                       const Uint32 high);
+     ** @param  buffer    untyped pointer to the externally allocated memory buffer (maybe NULL)
+     *  @param  inter     pointer to intermediate pixel representation
+     *  @param  overlays  array of overlay management objects (entries maybe NULL)
+     *  @param  disp      pointer to current display function object
+     *  @param  samples   number of samples per pixel
+     *  @param  frame     number of frame to be rendered
+     *  @param  bits      number of bits for the output pixel data (depth)
+     *  @param  low       output pixel value to which 0 is mapped (min)
+     *  @param  high      output pixel value to which 2^bits-1 is mapped (max)
+     *  @param  columns   width of the intermediate representation (in pixels)
+     *  @param  rows      height of the intermediate representation (in pixels)
+     *  @param  frames    number of frames in the intermediate representation
+     *
+     ** @return pointer to new output data object, NULL if unsupported
+     */
+    DiMonoOutputPixel *getDataUint8(void *buffer,
+                                    const DiMonoPixel *inter,
+                                    DiOverlay *overlays[2],
+                                    DiDisplayFunction *disp,
+                                    const int samples,
+                                    const unsigned long frame,
+                                    const int bits,
+                                    const Uint32 low,
+                                    const Uint32 high,
+                                    const Uint16 columns,
+                                    const Uint16 rows,
+                                    const unsigned long frames);
+
+    /** create output data with specified format for Sint8 intermediate data (helper function).
+     *
+     ** @param  buffer    untyped pointer to the externally allocated memory buffer (maybe NULL)
+     *  @param  inter     pointer to intermediate pixel representation
+     *  @param  overlays  array of overlay management objects (entries maybe NULL)
+     *  @param  disp      pointer to current display function object
+     *  @param  samples   number of samples per pixel
+     *  @param  frame     number of frame to be rendered
+     *  @param  bits      number of bits for the output pixel data (depth)
+     *  @param  low       output pixel value to which 0 is mapped (min)
+     *  @param  high      output pixel value to which 2^bits-1 is mapped (max)
+     *  @param  columns   width of the intermediate representation (in pixels)
+     *  @param  rows      height of the intermediate representation (in pixels)
+     *  @param  frames    number of frames in the intermediate representation
+     *
+     ** @return pointer to new output data object, NULL if unsupported
+     */
+    DiMonoOutputPixel *getDataSint8(void *buffer,
+                                    const DiMonoPixel *inter,
+                                    DiOverlay *overlays[2],
+                                    DiDisplayFunction *disp,
+                                    const int samples,
+                                    const unsigned long frame,
+                                    const int bits,
+                                    const Uint32 low,
+                                    const Uint32 high,
+                                    const Uint16 columns,
+                                    const Uint16 rows,
+                                    const unsigned long frames);
+
+    /** create output data with specified format for Uint16 intermediate data (helper function).
+     *
+     ** @param  buffer    untyped pointer to the externally allocated memory buffer (maybe NULL)
+     *  @param  inter     pointer to intermediate pixel representation
+     *  @param  overlays  array of overlay management objects (entries maybe NULL)
+     *  @param  disp      pointer to current display function object
+     *  @param  samples   number of samples per pixel
+     *  @param  frame     number of frame to be rendered
+     *  @param  bits      number of bits for the output pixel data (depth)
+     *  @param  low       output pixel value to which 0 is mapped (min)
+     *  @param  high      output pixel value to which 2^bits-1 is mapped (max)
+     *  @param  columns   width of the intermediate representation (in pixels)
+     *  @param  rows      height of the intermediate representation (in pixels)
+     *  @param  frames    number of frames in the intermediate representation
+     *
+     ** @return pointer to new output data object, NULL if unsupported
+     */
+    DiMonoOutputPixel *getDataUint16(void *buffer,
+                                     const DiMonoPixel *inter,
+                                     DiOverlay *overlays[2],
+                                     DiDisplayFunction *disp,
+                                     const int samples,
+                                     const unsigned long frame,
+                                     const int bits,
+                                     const Uint32 low,
+                                     const Uint32 high,
+                                     const Uint16 columns,
+                                     const Uint16 rows,
+                                     const unsigned long frames);
+
+    /** create output data with specified format for Sint16 intermediate data (helper function).
+     *
+     ** @param  buffer    untyped pointer to the externally allocated memory buffer (maybe NULL)
+     *  @param  inter     pointer to intermediate pixel representation
+     *  @param  overlays  array of overlay management objects (entries maybe NULL)
+     *  @param  disp      pointer to current display function object
+     *  @param  samples   number of samples per pixel
+     *  @param  frame     number of frame to be rendered
+     *  @param  bits      number of bits for the output pixel data (depth)
+     *  @param  low       output pixel value to which 0 is mapped (min)
+     *  @param  high      output pixel value to which 2^bits-1 is mapped (max)
+     *  @param  columns   width of the intermediate representation (in pixels)
+     *  @param  rows      height of the intermediate representation (in pixels)
+     *  @param  frames    number of frames in the intermediate representation
+     *
+     ** @return pointer to new output data object, NULL if unsupported
+     */
+    DiMonoOutputPixel *getDataSint16(void *buffer,
+                                     const DiMonoPixel *inter,
+                                     DiOverlay *overlays[2],
+                                     DiDisplayFunction *disp,
+                                     const int samples,
+                                     const unsigned long frame,
+                                     const int bits,
+                                     const Uint32 low,
+                                     const Uint32 high,
+                                     const Uint16 columns,
+                                     const Uint16 rows,
+                                     const unsigned long frames);
+
+    /** create output data with specified format for Uint32 intermediate data (helper function).
+     *
+     ** @param  buffer    untyped pointer to the externally allocated memory buffer (maybe NULL)
+     *  @param  inter     pointer to intermediate pixel representation
+     *  @param  overlays  array of overlay management objects (entries maybe NULL)
+     *  @param  disp      pointer to current display function object
+     *  @param  samples   number of samples per pixel
+     *  @param  frame     number of frame to be rendered
+     *  @param  bits      number of bits for the output pixel data (depth)
+     *  @param  low       output pixel value to which 0 is mapped (min)
+     *  @param  high      output pixel value to which 2^bits-1 is mapped (max)
+     *  @param  columns   width of the intermediate representation (in pixels)
+     *  @param  rows      height of the intermediate representation (in pixels)
+     *  @param  frames    number of frames in the intermediate representation
+     *
+     ** @return pointer to new output data object, NULL if unsupported
+     */
+    DiMonoOutputPixel *getDataUint32(void *buffer,
+                                     const DiMonoPixel *inter,
+                                     DiOverlay *overlays[2],
+                                     DiDisplayFunction *disp,
+                                     const int samples,
+                                     const unsigned long frame,
+                                     const int bits,
+                                     const Uint32 low,
+                                     const Uint32 high,
+                                     const Uint16 columns,
+                                     const Uint16 rows,
+                                     const unsigned long frames);
+
+    /** create output data with specified format for Sint32 intermediate data (helper function).
+     *
+     ** @param  buffer    untyped pointer to the externally allocated memory buffer (maybe NULL)
+     *  @param  inter     pointer to intermediate pixel representation
+     *  @param  overlays  array of overlay management objects (entries maybe NULL)
+     *  @param  disp      pointer to current display function object
+     *  @param  samples   number of samples per pixel
+     *  @param  frame     number of frame to be rendered
+     *  @param  bits      number of bits for the output pixel data (depth)
+     *  @param  low       output pixel value to which 0 is mapped (min)
+     *  @param  high      output pixel value to which 2^bits-1 is mapped (max)
+     *  @param  columns   width of the intermediate representation (in pixels)
+     *  @param  rows      height of the intermediate representation (in pixels)
+     *  @param  frames    number of frames in the intermediate representation
+     *
+     ** @return pointer to new output data object, NULL if unsupported
+     */
+    DiMonoOutputPixel *getDataSint32(void *buffer,
+                                     const DiMonoPixel *inter,
+                                     DiOverlay *overlays[2],
+                                     DiDisplayFunction *disp,
+                                     const int samples,
+                                     const unsigned long frame,
+                                     const int bits,
+                                     const Uint32 low,
+                                     const Uint32 high,
+                                     const Uint16 columns,
+                                     const Uint16 rows,
+                                     const unsigned long frames);
 
     /** create a presentation look-up table converting the pixel data which is linear to
      *  Optical Density to DDLs of the softcopy device (used to display print images on screen).
@@ -1133,6 +1304,8 @@ class DCMTK_DCMIMGLE_EXPORT DiMonoImage
     DiLookupTable *PresLutData;
     /// points to intermediate pixel data representation (object)
     DiMonoPixel *InterData;
+    /// modality transform object used to create the intermediate representation on demand
+    DiMonoModality *DeferredModality;
 
     /// points to grayscale standard display function (only referenced!)
     DiDisplayFunction *DisplayFunction;
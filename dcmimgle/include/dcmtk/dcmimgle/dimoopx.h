@@ -34,6 +34,7 @@
  *------------------------*/
 
 class DiMonoPixel;
+class DiInputPixel;
 
 
 /*---------------------*
@@ -59,6 +60,18 @@ class DCMTK_DCMIMGLE_EXPORT DiMonoOutputPixel
                       const unsigned long frame,
                       const unsigned long max);
 
+    /** constructor, used for rendering the stored pixel values directly
+     *
+     ** @param  pixel  pointer to input pixel representation
+     *  @param  size   number of pixel per frame
+     *  @param  frame  frame to be rendered
+     *  @param  max    maximum output value
+     */
+    DiMonoOutputPixel(const DiInputPixel *pixel,
+                      const unsigned long size,
+                      const unsigned long frame,
+                      const unsigned long max);
+
     /** destructor
      */
     virtual ~DiMonoOutputPixel();
@@ -30,11 +30,14 @@
 
 #include "dcmtk/dcmimgle/dimoopx.h"
 #include "dcmtk/dcmimgle/dimopx.h"
+#include "dcmtk/dcmimgle/diinpx.h"
 #include "dcmtk/dcmimgle/diluptab.h"
 #include "dcmtk/dcmimgle/diovlay.h"
 #include "dcmtk/dcmimgle/dipxrept.h"
 #include "dcmtk/dcmimgle/didispfn.h"
 #include "dcmtk/dcmimgle/didislut.h"
+#include "dcmtk/dcmimgle/diwinkrn.h"
+#include "dcmtk/dcmimgle/diparlop.h"
 
 #ifdef PASTEL_COLOR_OUTPUT
 #include "dimcopxt.h"
@@ -133,6 +136,64 @@ class DiMonoOutputPixelTemplate
         }
     }
 
+    /** constructor, render the stored pixel values directly.
+     *  The modality, VOI and presentation LUT transformation as well as the display function
+     *  have already been applied to all possible stored pixel values, i.e. the output pixel
+     *  data is created from the stored pixel values in a single pass by means of the given
+     *  table.  Finally, the overlay planes are added to the output data.
+     *
+     ** @param  buffer    storage area for the output pixel data (optional, maybe NULL)
+     *  @param  input     pointer to input pixel representation (stored pixel values)
+     *  @param  table     output pixel data for all possible stored pixel values (starting
+     *                    with the absolute minimum of the input pixel representation)
+     *  @param  overlays  array of overlay management objects
+     *  @param  disp      display function (optional, maybe NULL)
+     *  @param  low       lowest pixel value for the output data (e.g. 0)
+     *  @param  high      highest pixel value for the output data (e.g. 255)
+     *  @param  columns   image's width (in pixels)
+     *  @param  rows      image's height
+     *  @param  frame     frame to be rendered
+     */
+    DiMonoOutputPixelTemplate(void *buffer,
+                              const DiInputPixel *input,
+                              const DiMonoOutputPixel *table,
+                              DiOverlay *overlays[2],
+                              DiDisplayFunction *disp,
+                              const Uint32 low,
+                              const Uint32 high,
+                              const Uint16 columns,
+                              const Uint16 rows,
+                              const unsigned long frame)
+      : DiMonoOutputPixel(input, OFstatic_cast(unsigned long, columns) * OFstatic_cast(unsigned long, rows), frame,
+                          OFstatic_cast(unsigned long, fabs(OFstatic_cast(double, high - low)))),
+        Data(NULL),
+        DeleteData(buffer == NULL),
+        ColorData(NULL)
+    {
+        if ((input != NULL) && (table != NULL) && (Count > 0) && (FrameSize >= Count))
+        {
+            const T1 *pixel = OFstatic_cast(const T1 *, input->getData());
+            const T3 *lut = OFstatic_cast(const T3 *, table->getData());
+            if ((pixel != NULL) && (lut != NULL))
+            {
+                DCMIMGLE_TRACE("monochrome output image - columns: " << columns << ", rows: " << rows << ", frame: " << frame);
+                DCMIMGLE_DEBUG("rendering stored pixel values directly (" << OFstatic_cast(unsigned long, input->getAbsMaxRange())
+                    << " table entries)");
+                Data = OFstatic_cast(T3 *, buffer);
+                if (Data == NULL)
+                    Data = new T3[FrameSize];                                     // create new output buffer
+                if (Data != NULL)
+                {
+                    const T3 *lut0 = lut - OFstatic_cast(T2, input->getAbsMinimum());  // points to 'zero' entry
+                    applyOptimizationLUT(lut0, pixel + input->getPixelStart() + frame * FrameSize);
+                    if (Count < FrameSize)
+                        OFBitmanipTemplate<T3>::zeroMem(Data + Count, FrameSize - Count);  // set remaining pixels of frame to zero
+                    overlay(overlays, disp, columns, rows, frame);                // add (visible) overlay planes to output bitmap
+                }
+            }
+        }
+    }
+
     /** destructor
      */
     virtual ~DiMonoOutputPixelTemplate()
@@ -251,6 +312,23 @@ class DiMonoOutputPixelTemplate
 
  private:
 
+    /// parameters of the linear VOI window transformation, see applyWindowKernel()
+    struct WindowParameters
+    {
+        /// left border of the window
+        double LeftBorder;
+        /// right border of the window
+        double RightBorder;
+        /// offset of the linear function
+        double Offset;
+        /// gradient of the linear function
+        double Gradient;
+        /// lowest pixel value for the output data
+        T3 Low;
+        /// highest pixel value for the output data
+        T3 High;
+    };
+
     /** create a display LUT with the specified number of input bits
      *
      ** @param  dlut  reference to storage area where the display LUT should be stored
@@ -295,6 +373,109 @@ class DiMonoOutputPixelTemplate
         return result;
     }
 
+    /** apply an optimization LUT to the pixel data of the current frame and store the result
+     *  in the output buffer.  Large frames are processed by several threads in parallel.
+     *
+     ** @param  lut0   pointer to the LUT entry for pixel value 0
+     *  @param  pixel  pointer to the first pixel of the current frame
+     */
+    void applyOptimizationLUT(const T3 *lut0,
+                              const T1 *pixel)
+    {
+        DiParallelMethodLoop<DiMonoOutputPixelTemplate<T1, T2, T3>, const T3 *, const T1 *>
+            loop(this, &DiMonoOutputPixelTemplate<T1, T2, T3>::applyOptimizationLUTRange, lut0, pixel);
+        loop.run(Count, 1);
+    }
+
+    /** apply an optimization LUT to a range of pixels of the current frame
+     *
+     ** @param  lut0   pointer to the LUT entry for pixel value 0
+     *  @param  pixel  pointer to the first pixel of the current frame
+     *  @param  first  index of the first pixel to be processed
+     *  @param  last   index after the last pixel to be processed
+     */
+    void applyOptimizationLUTRange(const T3 *lut0,
+                                   const T1 *pixel,
+                                   const unsigned long first,
+                                   const unsigned long last)
+    {
+        register const T1 *p = pixel + first;
+        register T3 *q = Data + first;
+        register unsigned long i;
+        for (i = last - first; i != 0; --i)
+            *(q++) = *(lut0 + (*(p++)));
+    }
+
+    /** apply the linear VOI window transformation (without presentation LUT and display
+     *  function) to the pixel data of the current frame and store the result in the output
+     *  buffer.  Large frames are processed by several threads in parallel.
+     *
+     ** @param  pixel        pointer to the first pixel of the current frame
+     *  @param  leftBorder   left border of the window
+     *  @param  rightBorder  right border of the window
+     *  @param  offset       offset of the linear function
+     *  @param  gradient     gradient of the linear function
+     *  @param  low          lowest pixel value for the output data
+     *  @param  high         highest pixel value for the output data
+     */
+    void applyWindowKernel(const T1 *pixel,
+                           const double leftBorder,
+                           const double rightBorder,
+                           const double offset,
+                           const double gradient,
+                           const T3 low,
+                           const T3 high)
+    {
+        WindowParameters parameters;
+        parameters.LeftBorder = leftBorder;
+        parameters.RightBorder = rightBorder;
+        parameters.Offset = offset;
+        parameters.Gradient = gradient;
+        parameters.Low = low;
+        parameters.High = high;
+        DiParallelMethodLoop<DiMonoOutputPixelTemplate<T1, T2, T3>, const WindowParameters *, const T1 *>
+            loop(this, &DiMonoOutputPixelTemplate<T1, T2, T3>::applyWindowKernelRange, &parameters, pixel);
+        loop.run(Count, 1);
+    }
+
+    /** apply the linear VOI window transformation to a range of pixels of the current frame
+     *
+     ** @param  parameters  parameters of the window transformation
+     *  @param  pixel       pointer to the first pixel of the current frame
+     *  @param  first       index of the first pixel to be processed
+     *  @param  last        index after the last pixel to be processed
+     */
+    void applyWindowKernelRange(const WindowParameters *parameters,
+                                const T1 *pixel,
+                                const unsigned long first,
+                                const unsigned long last)
+    {
+        DiWindowKernel::apply(pixel + first, Data + first, last - first, parameters->LeftBorder, parameters->RightBorder,
+            parameters->Offset, parameters->Gradient, parameters->Low, parameters->High);  // vectorized if possible
+    }
+
+    /** determine the number of entries of an optimization LUT whose pixel value is less than
+     *  or equal to the given border (i.e. the index of the first entry greater than the border)
+     *
+     ** @param  absmin  pixel value of the first LUT entry
+     *  @param  border  border to be compared with
+     *  @param  ocnt    number of entries of the optimization LUT
+     *
+     ** @return number of entries with a pixel value less than or equal to the border
+     */
+    static unsigned long countEntriesUpTo(const double absmin,
+                                          const double border,
+                                          const unsigned long ocnt)
+    {
+        const double first = floor(border - absmin) + 1;                      // estimate, check for rounding errors below
+        unsigned long result = (first <= 0) ? 0 : ((first >= OFstatic_cast(double, ocnt)) ? ocnt : OFstatic_cast(unsigned long, first));
+        while ((result > 0) && (OFstatic_cast(double, result - 1) + absmin > border))
+            --result;
+        while ((result < ocnt) && (OFstatic_cast(double, result) + absmin <= border))
+            ++result;
+        return result;
+    }
+
 #ifdef PASTEL_COLOR_OUTPUT
     void color(void *buffer,                               // create true color pastel image
                const DiMonoPixel *inter,
@@ -438,9 +619,7 @@ class DiMonoOutputPixelTemplate
                                 }
                             }
                             const T3 *lut0 = lut - OFstatic_cast(T2, inter->getAbsMinimum());  // points to 'zero' entry
-                            q = Data;
-                            for (i = Count; i != 0; --i)                                  // apply LUT
-                                *(q++) = *(lut0 + (*(p++)));
+                            applyOptimizationLUT(lut0, p);                                // apply LUT
                         }
                         if (lut == NULL)                                                  // use "normal" transformation
                         {
@@ -538,9 +717,7 @@ class DiMonoOutputPixelTemplate
                                 }
                             }
                             const T3 *lut0 = lut - OFstatic_cast(T2, inter->getAbsMinimum());   // points to 'zero' entry
-                            q = Data;
-                            for (i = Count; i != 0; --i)                                  // apply LUT
-                                *(q++) = *(lut0 + (*(p++)));
+                            applyOptimizationLUT(lut0, p);                                // apply LUT
                         }
                         if (lut == NULL)                                                  // use "normal" transformation
                         {
@@ -665,9 +842,7 @@ class DiMonoOutputPixelTemplate
                             }
                         }
                         const T3 *lut0 = lut - OFstatic_cast(T2, inter->getAbsMinimum());  // points to 'zero' entry
-                        q = Data;
-                        for (i = Count; i != 0; --i)                                  // apply LUT
-                            *(q++) = *(lut0 + (*(p++)));
+                        applyOptimizationLUT(lut0, p);                                // apply LUT
                     }
                     if (lut == NULL)                                                  // use "normal" transformation
                     {
@@ -721,9 +896,7 @@ class DiMonoOutputPixelTemplate
                                 *(q++) = OFstatic_cast(T3, OFstatic_cast(double, low) + OFstatic_cast(double, i) * gradient);
                         }
                         const T3 *lut0 = lut - OFstatic_cast(T2, inter->getAbsMinimum());  // points to 'zero' entry
-                        q = Data;
-                        for (i = Count; i != 0; --i)                                  // apply LUT
-                            *(q++) = *(lut0 + (*(p++)));
+                        applyOptimizationLUT(lut0, p);                                // apply LUT
                     }
                     if (lut == NULL)                                                  // use "normal" transformation
                     {
@@ -823,9 +996,7 @@ class DiMonoOutputPixelTemplate
                             }
                         }
                         const T3 *lut0 = lut - OFstatic_cast(T2, absmin);             // points to 'zero' entry
-                        q = Data;
-                        for (i = Count; i != 0; --i)                                  // apply LUT
-                            *(q++) = *(lut0 + (*(p++)));
+                        applyOptimizationLUT(lut0, p);                                // apply LUT
                     }
                     if (lut == NULL)                                                  // use "normal" transformation
                     {
@@ -877,9 +1048,7 @@ class DiMonoOutputPixelTemplate
                             }
                         }
                         const T3 *lut0 = lut - OFstatic_cast(T2, absmin);             // points to 'zero' entry
-                        q = Data;
-                        for (i = Count; i != 0; --i)                                  // apply LUT
-                            *(q++) = *(lut0 + (*(p++)));
+                        applyOptimizationLUT(lut0, p);                                // apply LUT
                     }
                     if (lut == NULL)                                                  // use "normal" transformation
                     {
@@ -996,9 +1165,7 @@ class DiMonoOutputPixelTemplate
                             }
                         }
                         const T3 *lut0 = lut - OFstatic_cast(T2, absmin);             // points to 'zero' entry
-                        q = Data;
-                        for (i = Count; i != 0; --i)                                  // apply LUT
-                            *(q++) = *(lut0 + (*(p++)));
+                        applyOptimizationLUT(lut0, p);                                // apply LUT
                     }
                     if (lut == NULL)                                                  // use "normal" transformation
                     {
@@ -1059,21 +1226,18 @@ class DiMonoOutputPixelTemplate
                             DCMIMGLE_TRACE("monochrome rendering: VOI LINEAR #6");
                             const double offset = (width_1 == 0) ? 0 : (high - ((center - 0.5) / width_1 + 0.5) * outrange);
                             const double gradient = (width_1 == 0) ? 0 : outrange / width_1;
-                            for (i = 0; i < ocnt; ++i)                                 // calculating LUT entries
+                            const unsigned long left = countEntriesUpTo(absmin, leftBorder, ocnt);
+                            const unsigned long right = countEntriesUpTo(absmin, rightBorder, ocnt);
+                            OFBitmanipTemplate<T3>::setMem(q, low, left);                    // black/white
+                            for (i = left; i < right; ++i)                             // calculating LUT entries
                             {
                                 value = OFstatic_cast(double, i) + absmin;
-                                if (value <= leftBorder)
-                                    *(q++) = low;                                            // black/white
-                                else if (value > rightBorder)
-                                    *(q++) = high;                                           // white/black
-                                else
-                                    *(q++) = OFstatic_cast(T3, offset + value * gradient);   // gray value
+                                *(q + i) = OFstatic_cast(T3, offset + value * gradient);     // gray value
                             }
+                            OFBitmanipTemplate<T3>::setMem(q + right, high, ocnt - right);   // white/black
                         }
                         const T3 *lut0 = lut - OFstatic_cast(T2, absmin);             // points to 'zero' entry
-                        q = Data;
-                        for (i = Count; i != 0; --i)                                  // apply LUT
-                            *(q++) = *(lut0 + (*(p++)));
+                        applyOptimizationLUT(lut0, p);                                // apply LUT
                     }
                     if (lut == NULL)                                                  // use "normal" transformation
                     {
@@ -1096,16 +1260,7 @@ class DiMonoOutputPixelTemplate
                             DCMIMGLE_TRACE("monochrome rendering: VOI LINEAR #8");
                             const double offset = (width_1 == 0) ? 0 : (high - ((center - 0.5) / width_1 + 0.5) * outrange);
                             const double gradient = (width_1 == 0) ? 0 : outrange / width_1;
-                            for (i = Count; i != 0; --i)
-                            {
-                                value = OFstatic_cast(double, *(p++));
-                                if (value <= leftBorder)
-                                    *(q++) = low;                                            // black/white
-                                else if (value > rightBorder)
-                                    *(q++) = high;                                           // white/black
-                                else
-                                    *(q++) = OFstatic_cast(T3, offset + value * gradient);   // gray value
-                            }
+                            applyWindowKernel(p, leftBorder, rightBorder, offset, gradient, low, high);
                         }
                     }
                 }
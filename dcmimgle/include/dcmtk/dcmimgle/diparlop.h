@@ -0,0 +1,155 @@
+/*
+ *
+ *  Copyright (C) 2016, OFFIS e.V.
+ *  All rights reserved.  See COPYRIGHT file for details.
+ *
+ *  This software and supporting documentation were developed by
+ *
+ *    OFFIS e.V.
+ *    R&D Division Health
+ *    Escherweg 2
+ *    D-26121 Oldenburg, Germany
+ *
+ *
+ *  Module:  dcmimgle
+ *
+ *  Author:  OFFIS DICOM Team
+ *
+ *  Purpose: DicomParallelLoop (Header)
+ *
+ */
+
+
+#ifndef DIPARLOP_H
+#define DIPARLOP_H
+
+#include "dcmtk/config/osconfig.h"
+
+#include "dcmtk/dcmimgle/didefine.h"
+
+
+/*---------------------*
+ *  macro definitions  *
+ *---------------------*/
+
+/// minimum number of pixels processed by each thread of a parallel loop
+#define DIPARLOP_MIN_PIXELS_PER_THREAD 65536
+
+
+/*---------------------*
+ *  class declaration  *
+ *---------------------*/
+
+/** Abstract base class for loops whose iterations are independent of each other, so that
+ *  they can be split into ranges which are processed by several threads in parallel.
+ *  The maximum number of threads is given by DicomImageClass::getNumberOfThreads().
+ *  Each range is processed by a call of processRange() in a separate thread, except for the
+ *  first range, which is processed by the calling thread.
+ */
+class DCMTK_DCMIMGLE_EXPORT DiParallelLoop
+{
+
+ public:
+
+    /** constructor
+     */
+    DiParallelLoop();
+
+    /** destructor
+     */
+    virtual ~DiParallelLoop();
+
+    /** execute the loop, i.e. process the iterations 0 to count-1, and return when all
+     *  iterations have been processed.  The number of threads is limited so that each
+     *  thread processes at least DIPARLOP_MIN_PIXELS_PER_THREAD pixels.
+     *
+     ** @param  count   number of iterations
+     *  @param  pixels  number of pixels processed by each iteration (e.g. the number of
+     *                  columns if each iteration processes one row)
+     */
+    void run(const unsigned long count,
+             const unsigned long pixels);
+
+    /** process a range of iterations (abstract).
+     *  This method may be called by several threads at the same time (for different ranges).
+     *
+     ** @param  first  first iteration to be processed
+     *  @param  last   iteration after the last one to be processed
+     */
+    virtual void processRange(const unsigned long first,
+                              const unsigned long last) = 0;
+
+
+ private:
+
+ // --- declarations to avoid compiler warnings
+
+    DiParallelLoop(const DiParallelLoop &);
+    DiParallelLoop &operator=(const DiParallelLoop &);
+};
+
+
+/** Template class for a parallel loop which processes a range of iterations by calling a
+ *  method of an object with two fixed arguments (e.g. pointers to the source and destination
+ *  pixel data of the current frame) and the range of iterations.
+ */
+template<class C, class A1, class A2>
+class DiParallelMethodLoop
+  : public DiParallelLoop
+{
+
+ public:
+
+    /// type of the method to be called
+    typedef void (C::*Method)(A1, A2, const unsigned long, const unsigned long);
+
+    /** constructor
+     *
+     ** @param  object  object whose method is called
+     *  @param  method  method to be called for each range of iterations
+     *  @param  arg1    first argument passed to the method
+     *  @param  arg2    second argument passed to the method
+     */
+    DiParallelMethodLoop(C *object,
+                         Method method,
+                         A1 arg1,
+                         A2 arg2)
+      : DiParallelLoop(),
+        Object(object),
+        Function(method),
+        Argument1(arg1),
+        Argument2(arg2)
+    {
+    }
+
+    /** process a range of iterations by calling the method
+     *
+     ** @param  first  first iteration to be processed
+     *  @param  last   iteration after the last one to be processed
+     */
+    virtual void processRange(const unsigned long first,
+                              const unsigned long last)
+    {
+        (Object->*Function)(Argument1, Argument2, first, last);
+    }
+
+
+ private:
+
+    /// object whose method is called
+    C *Object;
+    /// method to be called
+    Method Function;
+    /// first argument passed to the method
+    A1 Argument1;
+    /// second argument passed to the method
+    A2 Argument2;
+
+ // --- declarations to avoid compiler warnings
+
+    DiParallelMethodLoop(const DiParallelMethodLoop<C, A1, A2> &);
+    DiParallelMethodLoop<C, A1, A2> &operator=(const DiParallelMethodLoop<C, A1, A2> &);
+};
+
+
+#endif
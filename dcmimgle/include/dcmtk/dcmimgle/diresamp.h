@@ -0,0 +1,342 @@
+/*
+ *
+ *  Copyright (C) 2016, OFFIS e.V.
+ *  All rights reserved.  See COPYRIGHT file for details.
+ *
+ *  This software and supporting documentation were developed by
+ *
+ *    OFFIS e.V.
+ *    R&D Division Health
+ *    Escherweg 2
+ *    D-26121 Oldenburg, Germany
+ *
+ *
+ *  Module:  dcmimgle
+ *
+ *  Author:  OFFIS DICOM Team
+ *
+ *  Purpose: DicomResampleFilter (Header)
+ *
+ */
+
+
+#ifndef DIRESAMP_H
+#define DIRESAMP_H
+
+#include "dcmtk/config/osconfig.h"
+#include "dcmtk/ofstd/oftypes.h"
+#include "dcmtk/ofstd/ofcast.h"
+
+#include "dcmtk/dcmimgle/didefine.h"
+
+
+/*---------------------*
+ *  macro definitions  *
+ *---------------------*/
+
+/// number of filter weights processed at once (filter tables are padded to a multiple of this value)
+#define DIRESAMP_BLOCK_SIZE 4
+
+
+/*--------------------*
+ *  type definitions  *
+ *--------------------*/
+
+/** resampling filters supported by the separable resampler
+ */
+enum ER_ResampleFilter
+{
+    /// area averaging, i.e. each destination pixel is the mean of the source area it covers
+    ERF_AreaAveraging,
+    /// Lanczos filter with three lobes (stretched accordingly when reducing)
+    ERF_Lanczos
+};
+
+
+/*---------------------*
+ *  class declaration  *
+ *---------------------*/
+
+/** Class computing and applying the filter weights for one dimension of a separable resampling,
+ *  i.e. for the mapping of the source columns (or rows) to the destination columns (or rows).
+ *  The weights for each destination position are normalized and restricted to the source area
+ *  (e.g. the clipping area of an image).  Source positions outside the image boundaries are
+ *  not accessed, their weight is reported separately (see getOutsideWeight()), so that the
+ *  caller can blend in a border value.
+ *  The filter can be applied in single precision floating point, where the inner loops are
+ *  vectorized if the compiler supports SSE2 (which is always the case on x86-64), or in double
+ *  precision, which is required for pixel values that cannot be represented exactly as single
+ *  precision numbers (i.e. more than 16 bits per pixel).
+ */
+class DCMTK_DCMIMGLE_EXPORT DiResampleFilter
+{
+
+ public:
+
+    /** constructor
+     *
+     ** @param  filter     resampling filter to be used
+     *  @param  src_size   number of source positions (e.g. width of the clipping area)
+     *  @param  dest_size  number of destination positions (e.g. width of the scaled image)
+     *  @param  offset     coordinate of the first source position in the image (e.g. left
+     *                     coordinate of the clipping area, might be negative)
+     *  @param  limit      number of positions in the image (e.g. number of columns), source
+     *                     positions outside the range 0..limit-1 are not accessed
+     */
+    DiResampleFilter(const ER_ResampleFilter filter,
+                     const Uint16 src_size,
+                     const Uint16 dest_size,
+                     const signed long offset,
+                     const Uint16 limit);
+
+    /** destructor
+     */
+    virtual ~DiResampleFilter();
+
+    /** check whether filter table is valid
+     *
+     ** @return true if valid, false otherwise (e.g. memory exhausted)
+     */
+    inline int isValid() const
+    {
+        return (Weights != NULL);
+    }
+
+    /** get image coordinate of the first source position accessed by this filter
+     *
+     ** @return image coordinate of the first source position accessed
+     */
+    inline unsigned long getFirstPosition() const
+    {
+        return FirstPosition;
+    }
+
+    /** get number of (consecutive) source positions accessed by this filter
+     *
+     ** @return number of source positions accessed
+     */
+    inline unsigned long getPositionCount() const
+    {
+        return PositionCount;
+    }
+
+    /** get size of a buffer which is used to store the input of filterRow(), i.e. the number
+     *  of source positions accessed plus some padding for the vectorized implementation
+     *
+     ** @return size of the buffer (number of elements)
+     */
+    inline unsigned long getBufferSize() const
+    {
+        return PositionCount + Taps;
+    }
+
+    /** get first source position contributing to the given destination position
+     *
+     ** @param  pos  destination position
+     *
+     ** @return first source position (relative to getFirstPosition())
+     */
+    inline unsigned long getStart(const Uint16 pos) const
+    {
+        return Start[pos];
+    }
+
+    /** get number of source positions contributing to the given destination position
+     *
+     ** @param  pos  destination position
+     *
+     ** @return number of source positions (might be 0 if all of them are outside the image)
+     */
+    inline unsigned long getCount(const Uint16 pos) const
+    {
+        return Count[pos];
+    }
+
+    /** get weights of the source positions contributing to the given destination position
+     *  (single precision)
+     *
+     ** @param  pos      destination position
+     *  @param  weights  pointer to the array of weights (return value, see getCount() for
+     *                   the number of entries)
+     */
+    inline void getWeights(const Uint16 pos,
+                           const float *&weights) const
+    {
+        weights = Weights + OFstatic_cast(unsigned long, pos) * Taps;
+    }
+
+    /** get weights of the source positions contributing to the given destination position
+     *  (double precision)
+     *
+     ** @param  pos      destination position
+     *  @param  weights  pointer to the array of weights (return value, see getCount() for
+     *                   the number of entries)
+     */
+    inline void getWeights(const Uint16 pos,
+                           const double *&weights) const
+    {
+        weights = PreciseWeights + OFstatic_cast(unsigned long, pos) * Taps;
+    }
+
+    /** get sum of weights of the source positions outside the image boundaries
+     *
+     ** @param  pos  destination position
+     *
+     ** @return sum of weights of the positions outside the image (0 if all are inside)
+     */
+    inline double getOutsideWeight(const Uint16 pos) const
+    {
+        return Outside[pos];
+    }
+
+    /** apply the filter to a row of values, i.e. compute the weighted sum of the source
+     *  positions for all destination positions (single precision).  The weights of the source
+     *  positions outside the image boundaries are not taken into account.
+     *
+     ** @param  row     pointer to the input values (getBufferSize() entries, the first
+     *                  getPositionCount() of them are used, the remaining entries have to be 0)
+     *  @param  output  pointer to the output values (number of destination positions)
+     */
+    void filterRow(const float *row,
+                   float *output) const;
+
+    /** apply the filter to a row of values (double precision).
+     *  See single precision version for details.
+     */
+    void filterRow(const double *row,
+                   double *output) const;
+
+    /** compute the weighted sum of several rows of pixels (e.g. of the source rows contributing
+     *  to a destination row) and store it in the given buffer (generic version, the sums are
+     *  computed with the precision of the weights and the buffer)
+     *
+     ** @param  pixel    pointer to the first pixel of the first row
+     *  @param  stride   distance between two consecutive rows (number of pixels)
+     *  @param  weights  array of weights (one for each row)
+     *  @param  rows     number of rows (might be 0, the buffer is then filled with 0)
+     *  @param  buffer   pointer to the buffer the weighted sums are stored in
+     *  @param  count    number of pixels per row to be processed
+     */
+    template<class T, class A>
+    static void accumulateRows(const T *pixel,
+                               const unsigned long stride,
+                               const A *weights,
+                               const unsigned long rows,
+                               A *buffer,
+                               const unsigned long count)
+    {
+        const T *p;
+        A *q;
+        A w;
+        unsigned long i;
+        if (rows == 0)
+        {
+            q = buffer;
+            for (i = count; i != 0; --i)
+                *(q++) = 0;
+        }
+        for (unsigned long k = 0; k < rows; ++k)
+        {
+            p = pixel + k * stride;
+            q = buffer;
+            w = weights[k];
+            if (k == 0)
+            {
+                for (i = count; i != 0; --i)
+                    *(q++) = w * OFstatic_cast(A, *(p++));
+            } else {
+                for (i = count; i != 0; --i)
+                    *(q++) += w * OFstatic_cast(A, *(p++));
+            }
+        }
+    }
+
+    /** compute the weighted sum of several rows of pixels (version for unsigned 8 bit data,
+     *  single precision).  See generic version for details.
+     */
+    static void accumulateRows(const Uint8 *pixel,
+                               const unsigned long stride,
+                               const float *weights,
+                               const unsigned long rows,
+                               float *buffer,
+                               const unsigned long count);
+
+    /** compute the weighted sum of several rows of pixels (version for signed 8 bit data,
+     *  single precision).  See generic version for details.
+     */
+    static void accumulateRows(const Sint8 *pixel,
+                               const unsigned long stride,
+                               const float *weights,
+                               const unsigned long rows,
+                               float *buffer,
+                               const unsigned long count);
+
+    /** compute the weighted sum of several rows of pixels (version for unsigned 16 bit data,
+     *  single precision).  See generic version for details.
+     */
+    static void accumulateRows(const Uint16 *pixel,
+                               const unsigned long stride,
+                               const float *weights,
+                               const unsigned long rows,
+                               float *buffer,
+                               const unsigned long count);
+
+    /** compute the weighted sum of several rows of pixels (version for signed 16 bit data,
+     *  single precision).  See generic version for details.
+     */
+    static void accumulateRows(const Sint16 *pixel,
+                               const unsigned long stride,
+                               const float *weights,
+                               const unsigned long rows,
+                               float *buffer,
+                               const unsigned long count);
+
+
+ private:
+
+    /** compute the unnormalized filter weights for one destination position
+     *
+     ** @param  filter     resampling filter to be used
+     *  @param  pos        destination position
+     *  @param  factor     ratio of source and destination size
+     *  @param  src_size   number of source positions
+     *  @param  weights    array of (at least 'Taps') weights to be filled
+     *  @param  first      first source position (return value)
+     *
+     ** @return number of source positions, i.e. number of weights computed
+     */
+    unsigned long computeWeights(const ER_ResampleFilter filter,
+                                 const Uint16 pos,
+                                 const double factor,
+                                 const Uint16 src_size,
+                                 double *weights,
+                                 signed long &first) const;
+
+    /// number of destination positions
+    const Uint16 Size;
+    /// number of weights stored for each destination position (multiple of DIRESAMP_BLOCK_SIZE)
+    unsigned long Taps;
+    /// image coordinate of the first source position accessed
+    unsigned long FirstPosition;
+    /// number of source positions accessed
+    unsigned long PositionCount;
+
+    /// first source position for each destination position (relative to 'FirstPosition')
+    unsigned long *Start;
+    /// number of source positions for each destination position
+    unsigned long *Count;
+    /// sum of weights of the source positions outside the image for each destination position
+    double *Outside;
+    /// filter weights ('Taps' entries for each destination position, padded with 0)
+    float *Weights;
+    /// filter weights in double precision (same layout as 'Weights')
+    double *PreciseWeights;
+
+ // --- declarations to avoid compiler warnings
+
+    DiResampleFilter(const DiResampleFilter &);
+    DiResampleFilter &operator=(const DiResampleFilter &);
+};
+
+
+#endif
@@ -28,6 +28,7 @@
 
 #include "dcmtk/dcmimgle/dipixel.h"
 #include "dcmtk/dcmimgle/ditranst.h"
+#include "dcmtk/dcmimgle/diparlop.h"
 
 
 /*---------------------*
@@ -141,10 +142,7 @@ class DiRotateTemplate
     {
         if ((src != NULL) && (dest != NULL))
         {
-            register Uint16 x;
-            register Uint16 y;
             register const T *p;
-            register T *q;
             register T *r;
             const unsigned long count = OFstatic_cast(unsigned long, this->Dest_X) * OFstatic_cast(unsigned long, this->Dest_Y);
             for (int j = 0; j < this->Planes; ++j)
@@ -153,16 +151,9 @@ class DiRotateTemplate
                 r = dest[j];
                 for (unsigned long f = this->Frames; f != 0; --f)
                 {
+                    rotateFrame(p, r, &DiRotateTemplate<T>::rotateLeftRows);
+                    p += count;
                     r += count;
-                    for (x = this->Dest_X; x != 0; --x)
-                    {
-                        q = r - x;
-                        for (y = this->Dest_Y; y != 0; --y)
-                        {
-                            *q = *p++;
-                            q -= this->Dest_X;
-                        }
-                    }
                 }
             }
         }
@@ -178,10 +169,7 @@ class DiRotateTemplate
     {
         if ((src != NULL) && (dest != NULL))
         {
-            register Uint16 x;
-            register Uint16 y;
             register const T *p;
-            register T *q;
             register T *r;
             const unsigned long count = OFstatic_cast(unsigned long, this->Dest_X) * OFstatic_cast(unsigned long, this->Dest_Y);
             for (int j = 0; j < this->Planes; ++j)
@@ -190,15 +178,8 @@ class DiRotateTemplate
                 r = dest[j];
                 for (unsigned long f = this->Frames; f != 0; --f)
                 {
-                    for (x = this->Dest_X; x != 0; --x)
-                    {
-                        q = r + x - 1;
-                        for (y = this->Dest_Y; y != 0; --y)
-                        {
-                            *q = *p++;
-                            q += this->Dest_X;
-                        }
-                    }
+                    rotateFrame(p, r, &DiRotateTemplate<T>::rotateRightRows);
+                    p += count;
                     r += count;
                 }
             }
@@ -215,7 +196,6 @@ class DiRotateTemplate
     {
         if ((src != NULL) && (dest != NULL))
         {
-            register unsigned long i;
             register const T *p;
             register T *q;
             const unsigned long count = OFstatic_cast(unsigned long, this->Dest_X) * OFstatic_cast(unsigned long, this->Dest_Y);
@@ -225,9 +205,9 @@ class DiRotateTemplate
                 q = dest[j];
                 for (unsigned long f = this->Frames; f != 0; --f)
                 {
-                    q += count;
-                    for (i = count; i != 0; --i)
-                        *--q = *p++;
+                    DiParallelMethodLoop<DiRotateTemplate<T>, const T *, T *> loop(this, &DiRotateTemplate<T>::rotateTopDownRows, p, q);
+                    loop.run(this->Dest_Y, this->Dest_X);
+                    p += count;
                     q += count;
                 }
             }
@@ -236,6 +216,95 @@ class DiRotateTemplate
 
  private:
 
+    /// type of the methods rotating a range of rows of a frame
+    typedef void (DiRotateTemplate<T>::*RowsMethod)(const T *, T *, const unsigned long, const unsigned long);
+
+   /** rotate a single frame left or right.  Large frames are processed by several threads in parallel.
+    *
+    ** @param  src     pointer to source frame
+    *  @param  dest    pointer to destination frame (must not be the same as the source frame)
+    *  @param  method  method rotating a range of rows of the source frame
+    */
+    inline void rotateFrame(const T *src,
+                            T *dest,
+                            RowsMethod method)
+    {
+        DiParallelMethodLoop<DiRotateTemplate<T>, const T *, T *> loop(this, method, src, dest);
+        loop.run(this->Dest_X, this->Dest_Y);
+    }
+
+   /** rotate a range of rows of a frame left, i.e. store them as columns of the destination frame
+    *
+    ** @param  src    pointer to source frame
+    *  @param  dest   pointer to destination frame
+    *  @param  first  first row (of the source frame) to be processed
+    *  @param  last   row after the last one to be processed
+    */
+    void rotateLeftRows(const T *src,
+                        T *dest,
+                        const unsigned long first,
+                        const unsigned long last)
+    {
+        register Uint16 y;
+        register const T *p = src + first * this->Dest_Y;
+        register T *q;
+        const unsigned long count = OFstatic_cast(unsigned long, this->Dest_X) * OFstatic_cast(unsigned long, this->Dest_Y);
+        for (unsigned long x = first; x < last; ++x)
+        {
+            q = dest + count - this->Dest_X + x;
+            for (y = this->Dest_Y; y != 0; --y)
+            {
+                *q = *p++;
+                q -= this->Dest_X;
+            }
+        }
+    }
+
+   /** rotate a range of rows of a frame right, i.e. store them as columns of the destination frame
+    *
+    ** @param  src    pointer to source frame
+    *  @param  dest   pointer to destination frame
+    *  @param  first  first row (of the source frame) to be processed
+    *  @param  last   row after the last one to be processed
+    */
+    void rotateRightRows(const T *src,
+                         T *dest,
+                         const unsigned long first,
+                         const unsigned long last)
+    {
+        register Uint16 y;
+        register const T *p = src + first * this->Dest_Y;
+        register T *q;
+        for (unsigned long x = first; x < last; ++x)
+        {
+            q = dest + this->Dest_X - 1 - x;
+            for (y = this->Dest_Y; y != 0; --y)
+            {
+                *q = *p++;
+                q += this->Dest_X;
+            }
+        }
+    }
+
+   /** rotate a range of rows of a frame top-down
+    *
+    ** @param  src    pointer to source frame
+    *  @param  dest   pointer to destination frame
+    *  @param  first  first row to be processed
+    *  @param  last   row after the last one to be processed
+    */
+    void rotateTopDownRows(const T *src,
+                           T *dest,
+                           const unsigned long first,
+                           const unsigned long last)
+    {
+        register unsigned long i;
+        register const T *p = src + first * this->Dest_X;
+        register T *q = dest + (OFstatic_cast(unsigned long, this->Dest_Y) - first) * this->Dest_X;
+        for (i = (last - first) * this->Dest_X; i != 0; --i)
+            *--q = *p++;
+    }
+
    /** rotate image left and store result in the same storage area
     *
     ** @param  data  array of pointers to source/destination image pixels
@@ -246,10 +315,6 @@ class DiRotateTemplate
         T *temp = new T[count];
         if (temp != NULL)
         {
-            register Uint16 x;
-            register Uint16 y;
-            register const T *p;
-            register T *q;
             register T *r;
             for (int j = 0; j < this->Planes; ++j)
             {
@@ -257,17 +322,8 @@ class DiRotateTemplate
                 for (unsigned long f = this->Frames; f != 0; --f)
                 {
                     OFBitmanipTemplate<T>::copyMem(OFstatic_cast(const T *, r), temp, count);  // create temporary copy of current frame
-                    p = temp;
+                    rotateFrame(temp, r, &DiRotateTemplate<T>::rotateLeftRows);
                     r += count;
-                    for (x = this->Dest_X; x != 0; --x)
-                    {
-                        q = r - x;
-                        for (y = this->Dest_Y; y != 0; --y)
-                        {
-                            *q = *p++;
-                            q -= this->Dest_X;
-                        }
-                    }
                 }
             }
             delete[] temp;
@@ -284,10 +340,6 @@ class DiRotateTemplate
         T *temp = new T[count];
         if (temp != NULL)
         {
-            register Uint16 x;
-            register Uint16 y;
-            register const T *p;
-            register T *q;
             register T *r;
             for (int j = 0; j < this->Planes; ++j)
             {
@@ -295,16 +347,7 @@ class DiRotateTemplate
                 for (unsigned long f = this->Frames; f != 0; --f)
                 {
                     OFBitmanipTemplate<T>::copyMem(OFstatic_cast(const T *, r), temp, count);  // create temporary copy of current frame
-                    p = temp;
-                    for (x = this->Dest_X; x != 0; --x)
-                    {
-                        q = r + x - 1;
-                        for (y = this->Dest_Y; y != 0; --y)
-                        {
-                            *q = *p++;
-                            q += this->Dest_X;
-                        }
-                    }
+                    rotateFrame(temp, r, &DiRotateTemplate<T>::rotateRightRows);
                     r += count;
                 }
             }
@@ -318,29 +361,44 @@ class DiRotateTemplate
     */
     inline void rotateTopDown(T *data[])
     {
-        register unsigned long i;
-        register T *p;
-        register T *q;
-        register T t;
-        T *s;
         const unsigned long count = OFstatic_cast(unsigned long, this->Dest_X) * OFstatic_cast(unsigned long, this->Dest_Y);
+        T *s;
         for (int j = 0; j < this->Planes; ++j)
         {
             s = data[j];
             for (unsigned long f = this->Frames; f != 0; --f)
             {
-                p = s;
-                q = s + count;
-                for (i = count / 2; i != 0; --i)
-                {
-                    t = *p;
-                    *p++ = *--q;
-                    *q = t;
-                }
+                DiParallelMethodLoop<DiRotateTemplate<T>, T *, T *> loop(this, &DiRotateTemplate<T>::swapPixels, s, s + count);
+                loop.run(count / 2, 2);
                 s += count;
             }
         }
     }
+
+   /** swap a range of pixels of a frame with the corresponding pixels from the end of the
+    *  frame (in reverse order), i.e. rotate the frame top-down in place
+    *
+    ** @param  begin  pointer to the first pixel of the frame
+    *  @param  end    pointer after the last pixel of the frame
+    *  @param  first  first pixel to be processed (less than half the number of pixels)
+    *  @param  last   pixel after the last one to be processed
+    */
+    void swapPixels(T *begin,
+                    T *end,
+                    const unsigned long first,
+                    const unsigned long last)
+    {
+        register unsigned long i;
+        register T *p = begin + first;
+        register T *q = end - first;
+        register T t;
+        for (i = last - first; i != 0; --i)
+        {
+            t = *p;
+            *p++ = *--q;
+            *q = t;
+        }
+    }
 };
 
 
@@ -28,7 +28,9 @@
 #include "dcmtk/ofstd/ofcast.h"
 
 #include "dcmtk/dcmimgle/ditranst.h"
+#include "dcmtk/dcmimgle/diparlop.h"
 #include "dcmtk/dcmimgle/dipxrept.h"
+#include "dcmtk/dcmimgle/diresamp.h"
 
 
 /*---------------------*
@@ -181,7 +183,9 @@ class DiScaleTemplate
      ** @param  src          array of pointers to source image pixels
      *  @param  dest         array of pointers to destination image pixels
      *  @param  interpolate  preferred interpolation algorithm (0 = no interpolation, 1 = pbmplus algorithm,
-     *                         2 = c't algorithm, 3 = bilinear magnification, 4 = bicubic magnification)
+     *                         2 = c't algorithm, 3 = bilinear magnification, 4 = bicubic magnification,
+     *                         5 = separable resampling with Lanczos filter, 6 = separable resampling with
+     *                         area averaging)
      *  @param  value        value to be set outside the image boundaries (used for clipping, default: 0)
      */
     void scaleData(const T *src[],
@@ -211,6 +215,10 @@ class DiScaleTemplate
                 else
                     clipBorderPixel(src, dest, value);                                // clipping (with border)
             }
+            else if (interpolate == 5)
+                resamplePixel(src, dest, ERF_Lanczos, value);                         // resampling (Lanczos)
+            else if (interpolate == 6)
+                resamplePixel(src, dest, ERF_AreaAveraging, value);                   // resampling (area averaging)
             else if ((interpolate == 1) && (this->Bits <= MAX_INTERPOLATION_BITS))
                 interpolatePixel(src, dest);                                          // interpolation (pbmplus)
             else if ((interpolate == 4) && (this->Dest_X >= this->Src_X) && (this->Dest_Y >= this->Src_Y) &&
@@ -248,6 +256,24 @@ class DiScaleTemplate
 
  private:
 
+    /** parameters of the separable resampling, see resamplePixel()
+     */
+    struct ResampleParameters
+    {
+        /// filter for the columns
+        const DiResampleFilter *XFilter;
+        /// filter for the rows
+        const DiResampleFilter *YFilter;
+        /// pointer to the current source frame
+        const T *Source;
+        /// minimum pixel value
+        double MinValue;
+        /// maximum pixel value
+        double MaxValue;
+        /// value to be set outside the image boundaries
+        double Border;
+    };
+
     /** clip image to specified area (only inside image boundaries).
      *  This is an optimization of the more general method clipBorderPixel().
      *
@@ -691,10 +717,46 @@ class DiScaleTemplate
                      T *dest[])
     {
         DCMIMGLE_DEBUG("using expand pixel scaling algorithm with interpolation from c't magazine");
-        const double x_factor = OFstatic_cast(double, this->Src_X) / OFstatic_cast(double, this->Dest_X);
-        const double y_factor = OFstatic_cast(double, this->Src_Y) / OFstatic_cast(double, this->Dest_Y);
         const unsigned long f_size = OFstatic_cast(unsigned long, Rows) * OFstatic_cast(unsigned long, Columns);
+        const unsigned long d_size = OFstatic_cast(unsigned long, this->Dest_X) * OFstatic_cast(unsigned long, this->Dest_Y);
         const T *sp;
+        T *q;
+
+        /*
+         *   based on scaling algorithm from "c't - Magazin fuer Computertechnik" (c't 11/94)
+         *   (adapted to be used with signed pixel representation, inverse images - mono1,
+         *    various bit depths, multi-frame and multi-plane/color images, combined clipping/scaling)
+         */
+
+        for (int j = 0; j < this->Planes; ++j)
+        {
+            sp = src[j] + OFstatic_cast(unsigned long, Top) * OFstatic_cast(unsigned long, Columns) + Left;
+            q = dest[j];
+            for (unsigned long f = 0; f < this->Frames; ++f)
+            {
+                DiParallelMethodLoop<DiScaleTemplate<T>, const T *, T *> loop(this, &DiScaleTemplate<T>::expandPixelRows, sp, q);
+                loop.run(this->Dest_Y, this->Dest_X);                           // rows are independent of each other
+                sp += f_size;
+                q += d_size;
+            }
+        }
+    }
+
+
+    /** expand a range of rows of one frame, see expandPixel()
+     *
+     ** @param  sp     pointer to the first pixel of the clipping area of the source frame
+     *  @param  dest   pointer to the destination frame
+     *  @param  first  first row (of the destination frame) to be processed
+     *  @param  last   row after the last one to be processed
+     */
+    void expandPixelRows(const T *sp,
+                         T *dest,
+                         const unsigned long first,
+                         const unsigned long last)
+    {
+        const double x_factor = OFstatic_cast(double, this->Src_X) / OFstatic_cast(double, this->Dest_X);
+        const double y_factor = OFstatic_cast(double, this->Src_Y) / OFstatic_cast(double, this->Dest_Y);
         double bx, ex;
         double by, ey;
         int bxi, exi;
@@ -709,98 +771,83 @@ class DiScaleTemplate
         register Uint16 x;
         register Uint16 y;
         register const T *p;
-        register T *q;
+        register T *q = dest + first * this->Dest_X;
 
-        /*
-         *   based on scaling algorithm from "c't - Magazin fuer Computertechnik" (c't 11/94)
-         *   (adapted to be used with signed pixel representation, inverse images - mono1,
-         *    various bit depths, multi-frame and multi-plane/color images, combined clipping/scaling)
-         */
-
-        for (int j = 0; j < this->Planes; ++j)
+        for (y = OFstatic_cast(Uint16, first); y < last; ++y)
         {
-            sp = src[j] + OFstatic_cast(unsigned long, Top) * OFstatic_cast(unsigned long, Columns) + Left;
-            q = dest[j];
-            for (unsigned long f = 0; f < this->Frames; ++f)
+            by = y_factor * OFstatic_cast(double, y);
+            ey = y_factor * (OFstatic_cast(double, y) + 1.0);
+            if (ey > this->Src_Y)
             {
-                for (y = 0; y < this->Dest_Y; ++y)
-                {
-                    by = y_factor * OFstatic_cast(double, y);
-                    ey = y_factor * (OFstatic_cast(double, y) + 1.0);
-                    if (ey > this->Src_Y)
-                    {
 #ifdef DEBUG            // this output is only useful for debugging purposes
-                        DCMIMGLE_TRACE("  limiting value of 'ey' to 'Src_Y': " << ey << " -> " << this->Src_Y);
+                DCMIMGLE_TRACE("  limiting value of 'ey' to 'Src_Y': " << ey << " -> " << this->Src_Y);
 #endif
-                        // see reducePixel()
-                        ey = this->Src_Y;
-                    }
-                    byi = OFstatic_cast(int, by);
-                    eyi = OFstatic_cast(int, ey);
-                    if (OFstatic_cast(double, eyi) == ey)
-                    {
+                // see reducePixel()
+                ey = this->Src_Y;
+            }
+            byi = OFstatic_cast(int, by);
+            eyi = OFstatic_cast(int, ey);
+            if (OFstatic_cast(double, eyi) == ey)
+            {
 #ifdef DEBUG            // this output is only useful for debugging purposes
-                        DCMIMGLE_TRACE("  decreasing value of 'eyi' by 1: " << eyi << " -> " << (eyi - 1));
+                DCMIMGLE_TRACE("  decreasing value of 'eyi' by 1: " << eyi << " -> " << (eyi - 1));
 #endif
-                        --eyi;
-                    }
-                    y_part = OFstatic_cast(double, eyi) / y_factor;
-                    b_factor = y_part - OFstatic_cast(double, y);
-                    t_factor = (OFstatic_cast(double, y) + 1.0) - y_part;
-                    for (x = 0; x < this->Dest_X; ++x)
-                    {
-                        value = 0;
-                        bx = x_factor * OFstatic_cast(double, x);
-                        ex = x_factor * (OFstatic_cast(double, x) + 1.0);
-                        if (ex > this->Src_X)
-                        {
+                --eyi;
+            }
+            y_part = OFstatic_cast(double, eyi) / y_factor;
+            b_factor = y_part - OFstatic_cast(double, y);
+            t_factor = (OFstatic_cast(double, y) + 1.0) - y_part;
+            for (x = 0; x < this->Dest_X; ++x)
+            {
+                value = 0;
+                bx = x_factor * OFstatic_cast(double, x);
+                ex = x_factor * (OFstatic_cast(double, x) + 1.0);
+                if (ex > this->Src_X)
+                {
 #ifdef DEBUG                // this output is only useful for debugging purposes
-                            DCMIMGLE_TRACE("  limiting value of 'ex' to 'Src_X': " << ex << " -> " << this->Src_X);
+                    DCMIMGLE_TRACE("  limiting value of 'ex' to 'Src_X': " << ex << " -> " << this->Src_X);
 #endif
-                            // see reducePixel()
-                            ex = this->Src_X;
-                        }
-                        bxi = OFstatic_cast(int, bx);
-                        exi = OFstatic_cast(int, ex);
-                        if (OFstatic_cast(double, exi) == ex)
-                        {
+                    // see reducePixel()
+                    ex = this->Src_X;
+                }
+                bxi = OFstatic_cast(int, bx);
+                exi = OFstatic_cast(int, ex);
+                if (OFstatic_cast(double, exi) == ex)
+                {
 #ifdef DEBUG                // this output is only useful for debugging purposes
-                            DCMIMGLE_TRACE("  decreasing value of 'exi' by 1: " << exi << " -> " << (exi - 1));
+                    DCMIMGLE_TRACE("  decreasing value of 'exi' by 1: " << exi << " -> " << (exi - 1));
 #endif
-                            --exi;
+                    --exi;
+                }
+                x_part = OFstatic_cast(double, exi) / x_factor;
+                l_factor = x_part - OFstatic_cast(double, x);
+                r_factor = (OFstatic_cast(double, x) + 1.0) - x_part;
+                offset = OFstatic_cast(unsigned long, byi) * OFstatic_cast(unsigned long, Columns);
+                for (yi = byi; yi <= eyi; ++yi)
+                {
+                    p = sp + offset + bxi;
+                    for (xi = bxi; xi <= exi; ++xi)
+                    {
+                        sum = OFstatic_cast(double, *(p++));
+                        if (bxi != exi)
+                        {
+                            if (xi == bxi)
+                                sum *= l_factor;
+                            else
+                                sum *= r_factor;
                         }
-                        x_part = OFstatic_cast(double, exi) / x_factor;
-                        l_factor = x_part - OFstatic_cast(double, x);
-                        r_factor = (OFstatic_cast(double, x) + 1.0) - x_part;
-                        offset = OFstatic_cast(unsigned long, byi) * OFstatic_cast(unsigned long, Columns);
-                        for (yi = byi; yi <= eyi; ++yi)
+                        if (byi != eyi)
                         {
-                            p = sp + offset + bxi;
-                            for (xi = bxi; xi <= exi; ++xi)
-                            {
-                                sum = OFstatic_cast(double, *(p++));
-                                if (bxi != exi)
-                                {
-                                    if (xi == bxi)
-                                        sum *= l_factor;
-                                    else
-                                        sum *= r_factor;
-                                }
-                                if (byi != eyi)
-                                {
-                                    if (yi == byi)
-                                        sum *= b_factor;
-                                    else
-                                        sum *= t_factor;
-                                }
-                                value += sum;
-                            }
-                            offset += Columns;
+                            if (yi == byi)
+                                sum *= b_factor;
+                            else
+                                sum *= t_factor;
                         }
-                        *(q++) = OFstatic_cast(T, value + 0.5);
+                        value += sum;
                     }
+                    offset += Columns;
                 }
-                sp += f_size;
+                *(q++) = OFstatic_cast(T, value + 0.5);
             }
         }
     }
@@ -815,11 +862,47 @@ class DiScaleTemplate
                      T *dest[])
     {
         DCMIMGLE_DEBUG("using reduce pixel scaling algorithm with interpolation from c't magazine");
+        const unsigned long f_size = OFstatic_cast(unsigned long, Rows) * OFstatic_cast(unsigned long, Columns);
+        const unsigned long d_size = OFstatic_cast(unsigned long, this->Dest_X) * OFstatic_cast(unsigned long, this->Dest_Y);
+        const T *sp;
+        T *q;
+
+        /*
+         *   based on scaling algorithm from "c't - Magazin fuer Computertechnik" (c't 11/94)
+         *   (adapted to be used with signed pixel representation, inverse images - mono1,
+         *    various bit depths, multi-frame and multi-plane/color images, combined clipping/scaling)
+         */
+
+        for (int j = 0; j < this->Planes; ++j)
+        {
+            sp = src[j] + OFstatic_cast(unsigned long, Top) * OFstatic_cast(unsigned long, Columns) + Left;
+            q = dest[j];
+            for (unsigned long f = 0; f < this->Frames; ++f)
+            {
+                DiParallelMethodLoop<DiScaleTemplate<T>, const T *, T *> loop(this, &DiScaleTemplate<T>::reducePixelRows, sp, q);
+                loop.run(this->Dest_Y, this->Dest_X);                           // rows are independent of each other
+                sp += f_size;
+                q += d_size;
+            }
+        }
+    }
+
+
+    /** reduce a range of rows of one frame, see reducePixel()
+     *
+     ** @param  sp     pointer to the first pixel of the clipping area of the source frame
+     *  @param  dest   pointer to the destination frame
+     *  @param  first  first row (of the destination frame) to be processed
+     *  @param  last   row after the last one to be processed
+     */
+    void reducePixelRows(const T *sp,
+                         T *dest,
+                         const unsigned long first,
+                         const unsigned long last)
+    {
         const double x_factor = OFstatic_cast(double, this->Src_X) / OFstatic_cast(double, this->Dest_X);
         const double y_factor = OFstatic_cast(double, this->Src_Y) / OFstatic_cast(double, this->Dest_Y);
         const double xy_factor = x_factor * y_factor;
-        const unsigned long f_size = OFstatic_cast(unsigned long, Rows) * OFstatic_cast(unsigned long, Columns);
-        const T *sp;
         double bx, ex;
         double by, ey;
         int bxi, exi;
@@ -833,96 +916,211 @@ class DiScaleTemplate
         register Uint16 x;
         register Uint16 y;
         register const T *p;
-        register T *q;
+        register T *q = dest + first * this->Dest_X;
 
-        /*
-         *   based on scaling algorithm from "c't - Magazin fuer Computertechnik" (c't 11/94)
-         *   (adapted to be used with signed pixel representation, inverse images - mono1,
-         *    various bit depths, multi-frame and multi-plane/color images, combined clipping/scaling)
-         */
-
-        for (int j = 0; j < this->Planes; ++j)
+        for (y = OFstatic_cast(Uint16, first); y < last; ++y)
         {
-            sp = src[j] + OFstatic_cast(unsigned long, Top) * OFstatic_cast(unsigned long, Columns) + Left;
-            q = dest[j];
-            for (unsigned long f = 0; f < this->Frames; ++f)
+            by = y_factor * OFstatic_cast(double, y);
+            ey = y_factor * (OFstatic_cast(double, y) + 1.0);
+            if (ey > this->Src_Y)
             {
-                for (y = 0; y < this->Dest_Y; ++y)
-                {
-                    by = y_factor * OFstatic_cast(double, y);
-                    ey = y_factor * (OFstatic_cast(double, y) + 1.0);
-                    if (ey > this->Src_Y)
-                    {
 #ifdef DEBUG            // this output is only useful for debugging purposes
-                        DCMIMGLE_TRACE("  limiting value of 'ey' to 'Src_Y': " << ey << " -> " << this->Src_Y);
+                DCMIMGLE_TRACE("  limiting value of 'ey' to 'Src_Y': " << ey << " -> " << this->Src_Y);
 #endif
-                        // yes, this can happen due to rounding, e.g. double(943) / double(471) * double(471)
-                        // is something like 943.00000000000011368683772161602974 and then, the eyi == ey check
-                        // fails to bring eyi back into range!
-                        ey = this->Src_Y;
-                    }
-                    byi = OFstatic_cast(int, by);
-                    eyi = OFstatic_cast(int, ey);
-                    if (OFstatic_cast(double, eyi) == ey)
-                    {
+                // yes, this can happen due to rounding, e.g. double(943) / double(471) * double(471)
+                // is something like 943.00000000000011368683772161602974 and then, the eyi == ey check
+                // fails to bring eyi back into range!
+                ey = this->Src_Y;
+            }
+            byi = OFstatic_cast(int, by);
+            eyi = OFstatic_cast(int, ey);
+            if (OFstatic_cast(double, eyi) == ey)
+            {
 #ifdef DEBUG            // this output is only useful for debugging purposes
-                        DCMIMGLE_TRACE("  decreasing value of 'eyi' by 1: " << eyi << " -> " << (eyi - 1));
+                DCMIMGLE_TRACE("  decreasing value of 'eyi' by 1: " << eyi << " -> " << (eyi - 1));
 #endif
-                        --eyi;
-                    }
-                    b_factor = 1 + OFstatic_cast(double, byi) - by;
-                    t_factor = ey - OFstatic_cast(double, eyi);
-                    for (x = 0; x < this->Dest_X; ++x)
-                    {
-                        value = 0;
-                        bx = x_factor * OFstatic_cast(double, x);
-                        ex = x_factor * (OFstatic_cast(double, x) + 1.0);
-                        if (ex > this->Src_X)
-                        {
+                --eyi;
+            }
+            b_factor = 1 + OFstatic_cast(double, byi) - by;
+            t_factor = ey - OFstatic_cast(double, eyi);
+            for (x = 0; x < this->Dest_X; ++x)
+            {
+                value = 0;
+                bx = x_factor * OFstatic_cast(double, x);
+                ex = x_factor * (OFstatic_cast(double, x) + 1.0);
+                if (ex > this->Src_X)
+                {
 #ifdef DEBUG                // this output is only useful for debugging purposes
-                            DCMIMGLE_TRACE("  limiting value of 'ex' to 'Src_X': " << ex << " -> " << this->Src_X);
+                    DCMIMGLE_TRACE("  limiting value of 'ex' to 'Src_X': " << ex << " -> " << this->Src_X);
 #endif
-                            // see above comment
-                            ex = this->Src_X;
-                        }
-                        bxi = OFstatic_cast(int, bx);
-                        exi = OFstatic_cast(int, ex);
-                        if (OFstatic_cast(double, exi) == ex)
-                        {
+                    // see above comment
+                    ex = this->Src_X;
+                }
+                bxi = OFstatic_cast(int, bx);
+                exi = OFstatic_cast(int, ex);
+                if (OFstatic_cast(double, exi) == ex)
+                {
 #ifdef DEBUG                // this output is only useful for debugging purposes
-                            DCMIMGLE_TRACE("  decreasing value of 'exi' by 1: " << exi << " -> " << (exi - 1));
+                    DCMIMGLE_TRACE("  decreasing value of 'exi' by 1: " << exi << " -> " << (exi - 1));
 #endif
-                            --exi;
-                        }
-                        l_factor = 1 + OFstatic_cast(double, bxi) - bx;
-                        r_factor = ex - OFstatic_cast(double, exi);
-                        offset = OFstatic_cast(unsigned long, byi) * OFstatic_cast(unsigned long, Columns);
-                        for (yi = byi; yi <= eyi; ++yi)
-                        {
-                            p = sp + offset + bxi;
-                            for (xi = bxi; xi <= exi; ++xi)
-                            {
-                                sum = OFstatic_cast(double, *(p++)) / xy_factor;
-                                if (xi == bxi)
-                                    sum *= l_factor;
-                                else if (xi == exi)
-                                    sum *= r_factor;
-                                if (yi == byi)
-                                    sum *= b_factor;
-                                else if (yi == eyi)
-                                    sum *= t_factor;
-                                value += sum;
-                            }
-                            offset += Columns;
-                        }
-                        *(q++) = OFstatic_cast(T, value + 0.5);
+                    --exi;
+                }
+                l_factor = 1 + OFstatic_cast(double, bxi) - bx;
+                r_factor = ex - OFstatic_cast(double, exi);
+                offset = OFstatic_cast(unsigned long, byi) * OFstatic_cast(unsigned long, Columns);
+                for (yi = byi; yi <= eyi; ++yi)
+                {
+                    p = sp + offset + bxi;
+                    for (xi = bxi; xi <= exi; ++xi)
+                    {
+                        sum = OFstatic_cast(double, *(p++)) / xy_factor;
+                        if (xi == bxi)
+                            sum *= l_factor;
+                        else if (xi == exi)
+                            sum *= r_factor;
+                        if (yi == byi)
+                            sum *= b_factor;
+                        else if (yi == eyi)
+                            sum *= t_factor;
+                        value += sum;
                     }
+                    offset += Columns;
                 }
-                sp += f_size;
+                *(q++) = OFstatic_cast(T, value + 0.5);
             }
         }
     }
 
+    /** separable resampling method with precomputed filter weights (for magnification and
+     *  reduction, also in combination with clipping).  The source rows contributing to a
+     *  destination row are filtered vertically first, then the resulting row is filtered
+     *  horizontally.  Pixels outside the image boundaries are replaced by the given value.
+     *
+     ** @param  src     array of pointers to source image pixels
+     *  @param  dest    array of pointers to destination image pixels
+     *  @param  filter  resampling filter to be used
+     *  @param  value   value to be set outside the image boundaries
+     */
+    void resamplePixel(const T *src[],
+                       T *dest[],
+                       const ER_ResampleFilter filter,
+                       const T value)
+    {
+        DCMIMGLE_DEBUG("using separable resampling algorithm with " << ((filter == ERF_Lanczos) ? "Lanczos filter" : "area averaging"));
+        const DiResampleFilter xfilter(filter, this->Src_X, this->Dest_X, Left, Columns);
+        const DiResampleFilter yfilter(filter, this->Src_Y, this->Dest_Y, Top, Rows);
+        if (xfilter.isValid() && yfilter.isValid())
+        {
+            const unsigned long f_size = OFstatic_cast(unsigned long, Rows) * OFstatic_cast(unsigned long, Columns);
+            const unsigned long d_size = OFstatic_cast(unsigned long, this->Dest_X) * OFstatic_cast(unsigned long, this->Dest_Y);
+            // number of pixels read and written per destination row (used to determine the number of threads)
+            const unsigned long pixels = (xfilter.getPositionCount() * yfilter.getPositionCount() + d_size) / this->Dest_Y;
+            ResampleParameters parameters;
+            parameters.XFilter = &xfilter;
+            parameters.YFilter = &yfilter;
+            parameters.MinValue = (isSigned()) ? -OFstatic_cast(double, DicomImageClass::maxval(this->Bits - 1, 0)) : 0.0;
+            parameters.MaxValue = OFstatic_cast(double, DicomImageClass::maxval(this->Bits - isSigned()));
+            parameters.Border = OFstatic_cast(double, value);
+            T *q;
+            for (int j = 0; j < this->Planes; ++j)
+            {
+                parameters.Source = src[j];
+                q = dest[j];
+                for (unsigned long f = 0; f < this->Frames; ++f)
+                {
+                    DiParallelMethodLoop<DiScaleTemplate<T>, const ResampleParameters *, T *> loop(this, &DiScaleTemplate<T>::resamplePixelRows, &parameters, q);
+                    loop.run(this->Dest_Y, pixels);                             // rows are independent of each other
+                    parameters.Source += f_size;
+                    q += d_size;
+                }
+            }
+        } else {
+            DCMIMGLE_ERROR("can't allocate filter tables for resampling");
+            this->clearPixel(dest);
+        }
+    }
+
+
+    /** resample a range of rows of one frame, see resamplePixel().
+     *  Pixel values with more than 16 bits cannot be represented exactly as single precision
+     *  floating point numbers, so they are filtered in double precision.
+     *
+     ** @param  parameters  parameters of the resampling (incl. source frame)
+     *  @param  dest        pointer to the destination frame
+     *  @param  first       first row (of the destination frame) to be processed
+     *  @param  last        row after the last one to be processed
+     */
+    void resamplePixelRows(const ResampleParameters *parameters,
+                           T *dest,
+                           const unsigned long first,
+                           const unsigned long last)
+    {
+        if (sizeof(T) > 2)
+            resampleRows<double>(parameters, dest, first, last);
+        else
+            resampleRows<float>(parameters, dest, first, last);
+    }
+
+
+    /** resample a range of rows of one frame with the given precision, see resamplePixelRows()
+     *
+     ** @param  parameters  parameters of the resampling (incl. source frame)
+     *  @param  dest        pointer to the destination frame
+     *  @param  first       first row (of the destination frame) to be processed
+     *  @param  last        row after the last one to be processed
+     */
+    template<class A>
+    void resampleRows(const ResampleParameters *parameters,
+                      T *dest,
+                      const unsigned long first,
+                      const unsigned long last)
+    {
+        const DiResampleFilter &xfilter = *parameters->XFilter;
+        const DiResampleFilter &yfilter = *parameters->YFilter;
+        const unsigned long b_size = xfilter.getBufferSize();
+        const unsigned long count = xfilter.getPositionCount();
+        const T *sp = parameters->Source + yfilter.getFirstPosition() * OFstatic_cast(unsigned long, Columns) + xfilter.getFirstPosition();
+        T *q = dest + first * this->Dest_X;
+        Uint16 x;
+        const A *weights;
+        double value;
+        double border;
+        // buffers used for storing temporarily the vertically and horizontally filtered rows
+        A *buffer = new A[b_size];
+        A *output = new A[this->Dest_X];
+        if ((buffer == NULL) || (output == NULL))
+        {
+            DCMIMGLE_ERROR("can't allocate temporary buffer for resampling");
+            OFBitmanipTemplate<T>::zeroMem(q, (last - first) * this->Dest_X);
+        } else {
+            // the padding of the buffer (behind the pixels of a row) is never written
+            OFBitmanipTemplate<A>::zeroMem(buffer, b_size);
+            for (Uint16 y = OFstatic_cast(Uint16, first); y < last; ++y)
+            {
+                // first, filter the source rows vertically:
+                yfilter.getWeights(y, weights);
+                DiResampleFilter::accumulateRows(sp + yfilter.getStart(y) * OFstatic_cast(unsigned long, Columns),
+                    Columns, weights, yfilter.getCount(y), buffer, count);
+                // ... then filter the resulting row horizontally
+                xfilter.filterRow(buffer, output);
+                // the weights of the pixels outside the image are applied to the border value
+                border = parameters->Border * yfilter.getOutsideWeight(y);
+                for (x = 0; x < this->Dest_X; ++x)
+                {
+                    value = output[x] + border + (parameters->Border - border) * xfilter.getOutsideWeight(x);
+                    if (value < parameters->MinValue)
+                        value = parameters->MinValue;
+                    else if (value > parameters->MaxValue)
+                        value = parameters->MaxValue;
+                    *(q++) = (value < 0) ? OFstatic_cast(T, value - 0.5) : OFstatic_cast(T, value + 0.5);
+                }
+            }
+        }
+        delete[] buffer;
+        delete[] output;
+    }
+
+
    /** bilinear interpolation method (only for magnification)
     *
     ** @param  src   array of pointers to source image pixels
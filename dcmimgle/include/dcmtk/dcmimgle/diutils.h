@@ -98,6 +98,10 @@ const unsigned long CIF_DecompressCompletePixelData  = 0x0000800;
 
 /// never access embedded overlays since this requires to load and uncompress the complete pixel data
 const unsigned long CIF_NeverAccessEmbeddedOverlays  = 0x0001000;
+
+/// create intermediate representation only when required, i.e. render monochrome images
+/// directly from the stored pixel values (if possible)
+const unsigned long CIF_CreateIntermediateDataOnDemand = 0x0002000;
 //@}
 
 
@@ -438,6 +442,26 @@ class DCMTK_DCMIMGLE_EXPORT DicomImageClass
     static EP_Representation determineRepresentation(double minvalue,
                                                      double maxvalue);
 
+    /** set the maximum number of threads used for processing the pixel data of a single
+     *  frame, e.g. when rendering, scaling, rotating or flipping an image.  This is a global
+     *  setting that applies to all images.  Only large frames are split, so that the overhead
+     *  of creating the threads remains small compared to the processing time.
+     *  If the toolkit has been compiled without thread support, this setting is ignored.
+     *
+     ** @param  threads  maximum number of threads (default: 1, i.e. no additional threads)
+     */
+    static void setNumberOfThreads(const unsigned int threads);
+
+    /** get the maximum number of threads used for processing the pixel data of a single frame
+     *
+     ** @return maximum number of threads (always 1 if compiled without thread support)
+     */
+    static unsigned int getNumberOfThreads();
+
+ private:
+
+    /// maximum number of threads used for processing the pixel data of a single frame
+    static unsigned int NumberOfThreads;
 };
 
 
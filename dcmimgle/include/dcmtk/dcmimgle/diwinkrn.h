@@ -0,0 +1,120 @@
+/*
+ *
+ *  Copyright (C) 2016, OFFIS e.V.
+ *  All rights reserved.  See COPYRIGHT file for details.
+ *
+ *  This software and supporting documentation were developed by
+ *
+ *    OFFIS e.V.
+ *    R&D Division Health
+ *    Escherweg 2
+ *    D-26121 Oldenburg, Germany
+ *
+ *
+ *  Module:  dcmimgle
+ *
+ *  Author:  OFFIS DICOM Team
+ *
+ *  Purpose: DicomWindowKernel (Header)
+ *
+ */
+
+
+#ifndef DIWINKRN_H
+#define DIWINKRN_H
+
+#include "dcmtk/config/osconfig.h"
+#include "dcmtk/ofstd/oftypes.h"
+#include "dcmtk/ofstd/ofcast.h"
+
+#include "dcmtk/dcmimgle/didefine.h"
+
+
+/*---------------------*
+ *  class declaration  *
+ *---------------------*/
+
+/** Class implementing the linear VOI window transformation of the pixel data of a frame
+ *  without presentation LUT and display function, i.e. the inner loop of the "normal"
+ *  transformation in DiMonoOutputPixelTemplate::window().
+ *  The generic implementation processes one pixel after the other. For the most common
+ *  case, 16 bit input data rendered to 8 bit output data, vectorized implementations are
+ *  provided where the compiler supports SSE2 (which is always the case on x86-64). They
+ *  produce exactly the same output values as the generic implementation.
+ */
+class DCMTK_DCMIMGLE_EXPORT DiWindowKernel
+{
+
+ public:
+
+    /** apply the linear VOI window transformation to the given pixel data (generic version).
+     *  Pixel values less than or equal to 'leftBorder' are mapped to 'low', values greater
+     *  than 'rightBorder' are mapped to 'high', and all other values are mapped to
+     *  'offset + value * gradient'.
+     *
+     ** @param  pixel        pointer to the input pixel data
+     *  @param  output       pointer to the output pixel data
+     *  @param  count        number of pixels to be processed
+     *  @param  leftBorder   left border of the window
+     *  @param  rightBorder  right border of the window
+     *  @param  offset       offset of the linear function
+     *  @param  gradient     gradient of the linear function
+     *  @param  low          output value for pixels left of the window
+     *  @param  high         output value for pixels right of the window
+     */
+    template<class T1, class T3>
+    static void apply(const T1 *pixel,
+                      T3 *output,
+                      const unsigned long count,
+                      const double leftBorder,
+                      const double rightBorder,
+                      const double offset,
+                      const double gradient,
+                      const T3 low,
+                      const T3 high)
+    {
+        const T1 *p = pixel;
+        T3 *q = output;
+        unsigned long i;
+        double value;
+        for (i = count; i != 0; --i)
+        {
+            value = OFstatic_cast(double, *(p++));
+            if (value <= leftBorder)
+                *(q++) = low;                                            // black/white
+            else if (value > rightBorder)
+                *(q++) = high;                                           // white/black
+            else
+                *(q++) = OFstatic_cast(T3, offset + value * gradient);   // gray value
+        }
+    }
+
+    /** apply the linear VOI window transformation to the given pixel data (version for
+     *  unsigned 16 bit input and 8 bit output data). See generic version for details.
+     */
+    static void apply(const Uint16 *pixel,
+                      Uint8 *output,
+                      const unsigned long count,
+                      const double leftBorder,
+                      const double rightBorder,
+                      const double offset,
+                      const double gradient,
+                      const Uint8 low,
+                      const Uint8 high);
+
+    /** apply the linear VOI window transformation to the given pixel data (version for
+     *  signed 16 bit input and 8 bit output data). See generic version for details.
+     */
+    static void apply(const Sint16 *pixel,
+                      Uint8 *output,
+                      const unsigned long count,
+                      const double leftBorder,
+                      const double rightBorder,
+                      const double offset,
+                      const double gradient,
+                      const Uint8 low,
+                      const Uint8 high);
+};
+
+
+#endif
@@ -436,7 +436,8 @@ DicomImage *DicomImage::createScaledImage(const signed long left_pos,
 
         if (((left_pos < 0) || (OFstatic_cast(unsigned long, left_pos + clip_width) > gw) ||
             (top_pos < 0) || (OFstatic_cast(unsigned long, top_pos + clip_height) > gh)) &&
-            ((clip_width != scale_width) || (clip_height != scale_height)))
+            ((clip_width != scale_width) || (clip_height != scale_height)) &&
+            (interpolate != 5) && (interpolate != 6))                // supported by the resampling algorithms
         {
             DCMIMGLE_ERROR("combined clipping & scaling outside image boundaries not yet supported");
         }
@@ -101,6 +101,12 @@ DiCIELABFunction::~DiCIELABFunction()
 /********************************************************************/
 
 
+const char *DiCIELABFunction::getCacheIdentifier() const
+{
+    return "CIELAB";
+}
+
+
 DiDisplayLUT *DiCIELABFunction::getDisplayLUT(unsigned long count)
 {
     DiDisplayLUT *lut = NULL;
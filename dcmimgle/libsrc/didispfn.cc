@@ -27,6 +27,7 @@
 #include "dcmtk/dcmimgle/displint.h"
 #include "dcmtk/dcmimgle/dicrvfit.h"
 #include "dcmtk/dcmimgle/didislut.h"
+#include "dcmtk/dcmimgle/didlcach.h"
 #include "dcmtk/ofstd/ofstream.h"
 
 #define INCLUDE_CCTYPE
@@ -199,7 +200,7 @@ DiDisplayFunction::~DiDisplayFunction()
     delete[] LODValue;
     register int i;
     for (i = 0; i < MAX_NUMBER_OF_TABLES; ++i)
-        delete LookupTable[i];
+        DiDisplayLUTCache::releaseLookupTable(LookupTable[i]);
 }
 
 
@@ -242,40 +243,51 @@ Uint16 DiDisplayFunction::getDDLforValue(const double value) const
 const DiDisplayLUT *DiDisplayFunction::getLookupTable(const int bits,
                                                       unsigned long count)
 {
+    const DiDisplayLUT *lut = NULL;
     if (Valid && (bits >= MinBits) && (bits <= MaxBits))
     {
         const int idx = bits - MinBits;
         /* automatically compute number of entries */
         if (count == 0)
             count = DicomImageClass::maxval(bits, 0);
+#ifdef WITH_THREADS
+        LookupTableMutex.lock();
+#endif
         /* check whether existing LUT is still valid */
         if ((LookupTable[idx] != NULL) && ((count != LookupTable[idx]->getCount()) ||
             (AmbientLight != LookupTable[idx]->getAmbientLightValue()) ||
             (Illumination != LookupTable[idx]->getIlluminationValue())))
         {
-            delete LookupTable[idx];
+            DiDisplayLUTCache::releaseLookupTable(LookupTable[idx]);
             LookupTable[idx] = NULL;
         }
         if (LookupTable[idx] == NULL)                             // first calculation of this LUT
-            LookupTable[idx] = getDisplayLUT(count);
-        return LookupTable[idx];
+            LookupTable[idx] = DiDisplayLUTCache::getLookupTable(*this, count);
+        lut = LookupTable[idx];
+#ifdef WITH_THREADS
+        LookupTableMutex.unlock();
+#endif
     }
-    return NULL;
+    return lut;
 }
 
 
 int DiDisplayFunction::deleteLookupTable(const int bits)
 {
+    int status = 0;
+#ifdef WITH_THREADS
+    LookupTableMutex.lock();
+#endif
     if (bits == 0)
     {
         /* delete all LUTs */
         register int i;
         for (i = 0; i < MAX_NUMBER_OF_TABLES; ++i)
         {
-            delete LookupTable[i];
+            DiDisplayLUTCache::releaseLookupTable(LookupTable[i]);
             LookupTable[i] = NULL;
         }
-        return 1;
+        status = 1;
     }
     else if ((bits >= MinBits) && (bits <= MaxBits))
     {
@@ -283,13 +295,16 @@ int DiDisplayFunction::deleteLookupTable(const int bits)
         const int idx = bits - MinBits;
         if (LookupTable[idx] != NULL)
         {
-            delete LookupTable[idx];
+            DiDisplayLUTCache::releaseLookupTable(LookupTable[idx]);
             LookupTable[idx] = NULL;
-            return 1;
-        }
-        return 2;
+            status = 1;
+        } else
+            status = 2;
     }
-    return 0;
+#ifdef WITH_THREADS
+    LookupTableMutex.unlock();
+#endif
+    return status;
 }
 
 
@@ -329,6 +344,12 @@ int DiDisplayFunction::setMaxDensityValue(const double value)
 }
 
 
+const char *DiDisplayFunction::getCacheIdentifier() const
+{
+    return NULL;
+}
+
+
 /********************************************************************/
 
 
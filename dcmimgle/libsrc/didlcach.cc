@@ -0,0 +1,331 @@
+/*
+ *
+ *  Copyright (C) 2016, OFFIS e.V.
+ *  All rights reserved.  See COPYRIGHT file for details.
+ *
+ *  This software and supporting documentation were developed by
+ *
+ *    OFFIS e.V.
+ *    R&D Division Health
+ *    Escherweg 2
+ *    D-26121 Oldenburg, Germany
+ *
+ *
+ *  Module:  dcmimgle
+ *
+ *  Author:  OFFIS DICOM Team
+ *
+ *  Purpose: DicomDisplayLUTCache (Source)
+ *
+ */
+
+
+#include "dcmtk/config/osconfig.h"
+
+#include "dcmtk/dcmimgle/didlcach.h"
+#include "dcmtk/dcmimgle/didispfn.h"
+#include "dcmtk/dcmimgle/didislut.h"
+#include "dcmtk/dcmimgle/diutils.h"
+
+#define INCLUDE_CSTRING
+#include "dcmtk/ofstd/ofstdinc.h"
+
+
+/** Helper class creating the cache during static initialization (i.e. before any threads are
+ *  started) and deleting the unused LUTs at program termination.  LUTs that are released later
+ *  on (e.g. by static display function objects) are not deleted.
+ */
+class DiDisplayLUTCacheCleanup
+{
+
+ public:
+
+    /** constructor
+     */
+    DiDisplayLUTCacheCleanup()
+    {
+        DiDisplayLUTCache::getMaximumUnusedEntries();
+    }
+
+    /** destructor
+     */
+    ~DiDisplayLUTCacheCleanup()
+    {
+        DiDisplayLUTCache::clear();
+    }
+};
+
+static DiDisplayLUTCacheCleanup cleanupDisplayLUTCache;
+
+
+/*----------------*
+ *  constructors  *
+ *----------------*/
+
+DiDisplayLUTCache::Cache::Cache()
+  : Entries(),
+    MaximumUnusedEntries(16)
+#ifdef WITH_THREADS
+  , Mutex()
+#endif
+{
+}
+
+
+/********************************************************************/
+
+
+DiDisplayLUTCache::Cache &DiDisplayLUTCache::getCache()
+{
+    /* never deleted, see class documentation */
+    static Cache *cache = new Cache;
+    return *cache;
+}
+
+
+DiDisplayLUT *DiDisplayLUTCache::getLookupTable(DiDisplayFunction &disp,
+                                                const unsigned long count)
+{
+    /* display functions that do not support caching create their own LUTs */
+    if (disp.getCacheIdentifier() == NULL)
+        return disp.getDisplayLUT(count);
+    Cache &cache = getCache();
+#ifdef WITH_THREADS
+    cache.Mutex.lock();
+#endif
+    Entry *entry = findEntry(cache, disp, count);
+#ifdef WITH_THREADS
+    cache.Mutex.unlock();
+#endif
+    if (entry != NULL)
+        return entry->LookupTable;
+    /* create the LUT without blocking other threads */
+    DiDisplayLUT *lut = disp.getDisplayLUT(count);
+    if ((lut != NULL) && lut->isValid())
+    {
+#ifdef WITH_THREADS
+        cache.Mutex.lock();
+#endif
+        /* another thread might have created the same LUT in the meantime */
+        entry = findEntry(cache, disp, count);
+        if (entry != NULL)
+        {
+            delete lut;
+            lut = entry->LookupTable;
+        } else {
+            cache.Entries.push_front(createEntry(disp, count, lut));
+            DCMIMGLE_DEBUG("added display LUT with " << count << " entries to cache (" << cache.Entries.size() << " entries)");
+        }
+#ifdef WITH_THREADS
+        cache.Mutex.unlock();
+#endif
+    }
+    return lut;
+}
+
+
+void DiDisplayLUTCache::releaseLookupTable(DiDisplayLUT *lut)
+{
+    if (lut != NULL)
+    {
+        OFBool found = OFFalse;
+        Cache &cache = getCache();
+#ifdef WITH_THREADS
+        cache.Mutex.lock();
+#endif
+        OFListIterator(Entry *) iter = cache.Entries.begin();
+        const OFListIterator(Entry *) last = cache.Entries.end();
+        while (iter != last)
+        {
+            if ((*iter)->LookupTable == lut)
+            {
+                if ((*iter)->References > 0)
+                    --(*iter)->References;
+                found = OFTrue;
+                break;
+            }
+            ++iter;
+        }
+        if (found)
+            reduceSize(cache, cache.MaximumUnusedEntries);
+#ifdef WITH_THREADS
+        cache.Mutex.unlock();
+#endif
+        /* LUT has not been taken from the cache */
+        if (!found)
+            delete lut;
+    }
+}
+
+
+void DiDisplayLUTCache::setMaximumUnusedEntries(const unsigned long count)
+{
+    Cache &cache = getCache();
+#ifdef WITH_THREADS
+    cache.Mutex.lock();
+#endif
+    cache.MaximumUnusedEntries = count;
+    reduceSize(cache, cache.MaximumUnusedEntries);
+#ifdef WITH_THREADS
+    cache.Mutex.unlock();
+#endif
+}
+
+
+unsigned long DiDisplayLUTCache::getMaximumUnusedEntries()
+{
+    return getCache().MaximumUnusedEntries;
+}
+
+
+unsigned long DiDisplayLUTCache::getNumberOfEntries()
+{
+    Cache &cache = getCache();
+#ifdef WITH_THREADS
+    cache.Mutex.lock();
+#endif
+    const unsigned long count = OFstatic_cast(unsigned long, cache.Entries.size());
+#ifdef WITH_THREADS
+    cache.Mutex.unlock();
+#endif
+    return count;
+}
+
+
+void DiDisplayLUTCache::clear()
+{
+    Cache &cache = getCache();
+#ifdef WITH_THREADS
+    cache.Mutex.lock();
+#endif
+    reduceSize(cache, 0);
+#ifdef WITH_THREADS
+    cache.Mutex.unlock();
+#endif
+}
+
+
+/********************************************************************/
+
+
+DiDisplayLUTCache::Entry *DiDisplayLUTCache::findEntry(Cache &cache,
+                                                       const DiDisplayFunction &disp,
+                                                       const unsigned long count)
+{
+    OFListIterator(Entry *) iter = cache.Entries.begin();
+    const OFListIterator(Entry *) last = cache.Entries.end();
+    while (iter != last)
+    {
+        if (matchesEntry(*(*iter), disp, count))
+        {
+            Entry *entry = *iter;
+            ++entry->References;
+            /* move entry to the front of the list (most recently used) */
+            if (iter != cache.Entries.begin())
+            {
+                cache.Entries.erase(iter);
+                cache.Entries.push_front(entry);
+            }
+            return entry;
+        }
+        ++iter;
+    }
+    return NULL;
+}
+
+
+OFBool DiDisplayLUTCache::matchesEntry(const Entry &entry,
+                                       const DiDisplayFunction &disp,
+                                       const unsigned long count)
+{
+    /* compare scalar values first */
+    if ((entry.Count != count) ||
+        (strcmp(entry.Identifier, disp.getCacheIdentifier()) != 0) ||
+        (entry.DeviceType != OFstatic_cast(int, disp.DeviceType)) ||
+        (entry.MaxDDLValue != disp.MaxDDLValue) ||
+        (entry.ValueCount != disp.ValueCount) ||
+        (entry.MinValue != disp.MinValue) ||
+        (entry.MaxValue != disp.MaxValue) ||
+        (entry.AmbientLight != disp.AmbientLight) ||
+        (entry.Illumination != disp.Illumination) ||
+        (entry.MinDensity != disp.MinDensity) ||
+        (entry.MaxDensity != disp.MaxDensity))
+    {
+        return OFFalse;
+    }
+    /* then the characteristic curve */
+    if ((disp.DDLValue == NULL) || (disp.LODValue == NULL))
+        return (entry.DDLValue == NULL) && (entry.LODValue == NULL);
+    if ((entry.DDLValue == NULL) || (entry.LODValue == NULL))
+        return OFFalse;
+    unsigned long i;
+    for (i = 0; i < entry.ValueCount; ++i)
+    {
+        if ((entry.DDLValue[i] != disp.DDLValue[i]) || (entry.LODValue[i] != disp.LODValue[i]))
+            return OFFalse;
+    }
+    return OFTrue;
+}
+
+
+DiDisplayLUTCache::Entry *DiDisplayLUTCache::createEntry(const DiDisplayFunction &disp,
+                                                         const unsigned long count,
+                                                         DiDisplayLUT *lut)
+{
+    Entry *entry = new Entry;
+    entry->Identifier = disp.getCacheIdentifier();
+    entry->DeviceType = OFstatic_cast(int, disp.DeviceType);
+    entry->MaxDDLValue = disp.MaxDDLValue;
+    entry->ValueCount = disp.ValueCount;
+    entry->DDLValue = NULL;
+    entry->LODValue = NULL;
+    if ((disp.DDLValue != NULL) && (disp.LODValue != NULL))
+    {
+        entry->DDLValue = new Uint16[disp.ValueCount];
+        entry->LODValue = new double[disp.ValueCount];
+        memcpy(entry->DDLValue, disp.DDLValue, disp.ValueCount * sizeof(Uint16));
+        memcpy(entry->LODValue, disp.LODValue, disp.ValueCount * sizeof(double));
+    }
+    entry->MinValue = disp.MinValue;
+    entry->MaxValue = disp.MaxValue;
+    entry->AmbientLight = disp.AmbientLight;
+    entry->Illumination = disp.Illumination;
+    entry->MinDensity = disp.MinDensity;
+    entry->MaxDensity = disp.MaxDensity;
+    entry->Count = count;
+    entry->LookupTable = lut;
+    entry->References = 1;
+    return entry;
+}
+
+
+void DiDisplayLUTCache::deleteEntry(Entry *entry)
+{
+    if (entry != NULL)
+    {
+        delete entry->LookupTable;
+        delete[] entry->DDLValue;
+        delete[] entry->LODValue;
+        delete entry;
+    }
+}
+
+
+void DiDisplayLUTCache::reduceSize(Cache &cache,
+                                   const unsigned long maximum)
+{
+    /* keep the most recently used entries, i.e. the ones at the front of the list */
+    unsigned long unused = 0;
+    OFListIterator(Entry *) iter = cache.Entries.begin();
+    const OFListIterator(Entry *) last = cache.Entries.end();
+    while (iter != last)
+    {
+        if (((*iter)->References == 0) && (++unused > maximum))
+        {
+            /* no logging here, might be called at program termination */
+            deleteEntry(*iter);
+            iter = cache.Entries.erase(iter);
+        } else
+            ++iter;
+    }
+}
@@ -0,0 +1,141 @@
+/*
+ *
+ *  Copyright (C) 2016, OFFIS e.V.
+ *  All rights reserved.  See COPYRIGHT file for details.
+ *
+ *  This software and supporting documentation were developed by
+ *
+ *    OFFIS e.V.
+ *    R&D Division Health
+ *    Escherweg 2
+ *    D-26121 Oldenburg, Germany
+ *
+ *
+ *  Module:  dcmimgle
+ *
+ *  Author:  OFFIS DICOM Team
+ *
+ *  Purpose: DicomFrameCache (Source)
+ *
+ */
+
+
+#include "dcmtk/config/osconfig.h"
+
+#include "dcmtk/dcmimgle/difrcach.h"
+#include "dcmtk/dcmimgle/dipixel.h"
+#include "dcmtk/dcmimgle/diutils.h"
+
+
+/*----------------*
+ *  constructors  *
+ *----------------*/
+
+DiFrameCache::DiFrameCache()
+  : Entries(),
+    MaximumSize(0),
+    CurrentSize(0)
+{
+}
+
+
+/*--------------*
+ *  destructor  *
+ *--------------*/
+
+DiFrameCache::~DiFrameCache()
+{
+    clear();
+}
+
+
+/********************************************************************/
+
+
+void DiFrameCache::setMaximumSize(const unsigned long size)
+{
+    MaximumSize = size;
+    reduceSize();
+}
+
+
+OFBool DiFrameCache::addFrames(const unsigned long fstart,
+                               const unsigned long fcount,
+                               DiPixel *pixel)
+{
+    if (pixel != NULL)
+    {
+        const unsigned long size = pixel->getCount() * OFstatic_cast(unsigned long, pixel->getPlanes()) *
+            (DicomImageClass::getRepresentationBits(pixel->getRepresentation()) / 8);
+        if (size <= MaximumSize)
+        {
+            /* replace an existing entry for the same frames (should never happen) */
+            delete removeFrames(fstart, fcount);
+            Entry *entry = new Entry;
+            entry->FirstFrame = fstart;
+            entry->NumberOfFrames = fcount;
+            entry->Size = size;
+            entry->Pixel = pixel;
+            Entries.push_front(entry);
+            CurrentSize += size;
+            reduceSize();
+            DCMIMGLE_TRACE("added frame(s) " << fstart << " to " << (fstart + fcount - 1) << " to frame cache ("
+                << Entries.size() << " entries, " << CurrentSize << " bytes)");
+            return OFTrue;
+        }
+        delete pixel;
+    }
+    return OFFalse;
+}
+
+
+DiPixel *DiFrameCache::removeFrames(const unsigned long fstart,
+                                    const unsigned long fcount)
+{
+    OFListIterator(Entry *) iter = Entries.begin();
+    const OFListIterator(Entry *) last = Entries.end();
+    while (iter != last)
+    {
+        if (((*iter)->FirstFrame == fstart) && ((*iter)->NumberOfFrames == fcount))
+        {
+            DiPixel *pixel = (*iter)->Pixel;
+            CurrentSize -= (*iter)->Size;
+            delete (*iter);
+            Entries.erase(iter);
+            return pixel;
+        }
+        ++iter;
+    }
+    return NULL;
+}
+
+
+void DiFrameCache::clear()
+{
+    OFListIterator(Entry *) iter = Entries.begin();
+    const OFListIterator(Entry *) last = Entries.end();
+    while (iter != last)
+    {
+        delete (*iter)->Pixel;
+        delete (*iter);
+        ++iter;
+    }
+    Entries.clear();
+    CurrentSize = 0;
+}
+
+
+void DiFrameCache::reduceSize()
+{
+    /* remove least recently used entries first */
+    while ((CurrentSize > MaximumSize) && !Entries.empty())
+    {
+        Entry *entry = Entries.back();
+        DCMIMGLE_TRACE("removing frame(s) " << entry->FirstFrame << " to " << (entry->FirstFrame + entry->NumberOfFrames - 1)
+            << " from frame cache");
+        CurrentSize -= entry->Size;
+        delete entry->Pixel;
+        delete entry;
+        Entries.pop_back();
+    }
+}
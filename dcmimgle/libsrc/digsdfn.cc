@@ -137,6 +137,12 @@ DiGSDFunction::~DiGSDFunction()
 /********************************************************************/
 
 
+const char *DiGSDFunction::getCacheIdentifier() const
+{
+    return "GSDF";
+}
+
+
 DiDisplayLUT *DiGSDFunction::getDisplayLUT(unsigned long count)
 {
     DiDisplayLUT *lut = NULL;
@@ -68,7 +68,8 @@ DiImage::DiImage(const DiDocument *docu,
     isOriginal(1),
     InputData(NULL),
     FileCache(),
-    CurrentFragment(0)
+    CurrentFragment(0),
+    FrameCache()
 {
     if ((Document != NULL) && (ImageStatus == EIS_Normal))
     {
@@ -229,7 +230,8 @@ DiImage::DiImage(const DiDocument *docu,
     isOriginal(1),
     InputData(NULL),
     FileCache(),
-    CurrentFragment(0)
+    CurrentFragment(0),
+    FrameCache()
 {
 }
 
@@ -262,7 +264,8 @@ DiImage::DiImage(const DiImage *image,
     isOriginal(0),
     InputData(NULL),
     FileCache(),
-    CurrentFragment(0)
+    CurrentFragment(0),
+    FrameCache()
 {
 }
 
@@ -298,7 +301,8 @@ DiImage::DiImage(const DiImage *image,
     isOriginal(0),
     InputData(NULL),
     FileCache(),
-    CurrentFragment(0)
+    CurrentFragment(0),
+    FrameCache()
 {
     /* we do not check for "division by zero", this is already done somewhere else */
     const double xfactor = OFstatic_cast(double, Columns) / OFstatic_cast(double, image->Columns);
@@ -365,7 +369,8 @@ DiImage::DiImage(const DiImage *image,
     isOriginal(0),
     InputData(NULL),
     FileCache(),
-    CurrentFragment(0)
+    CurrentFragment(0),
+    FrameCache()
 {
 }
 
@@ -399,7 +404,8 @@ DiImage::DiImage(const DiImage *image,
     isOriginal(0),
     InputData(NULL),
     FileCache(),
-    CurrentFragment(0)
+    CurrentFragment(0),
+    FrameCache()
 {
 }
 
@@ -418,27 +424,81 @@ DiImage::~DiImage()
 
 
 int DiImage::processNextFrames(const unsigned long fcount)
+{
+    // check whether there are still any frames to be processed
+    if (FirstFrame + NumberOfFrames < TotalNumberOfFrames)
+        return processFrames(FirstFrame + NumberOfFrames, (fcount > 0) ? fcount : NumberOfFrames);
+    return 0;
+}
+
+
+int DiImage::processFrames(const unsigned long fstart,
+                           const unsigned long fcount)
+{
+    if (checkFrames(fstart))
+        return decodeFrames(fstart, fcount);
+    return 0;
+}
+
+
+int DiImage::checkFrames(const unsigned long fstart) const
 {
     if ((ImageStatus == EIS_Normal) && (Document != NULL) && isOriginal)
     {
         if ((Document->getFlags() & CIF_UsePartialAccessToPixelData) && (Document->getPixelData() != NULL))
-        {
-            // check whether there are still any frames to be processed
-            if (FirstFrame + NumberOfFrames < TotalNumberOfFrames)
-            {
-                FirstFrame += NumberOfFrames;
-                if (fcount > 0)
-                    NumberOfFrames = fcount;
-                if (FirstFrame + NumberOfFrames > TotalNumberOfFrames)
-                    NumberOfFrames = TotalNumberOfFrames - FirstFrame;
-                // free memory of previously processed frames
-                deleteInputData();
-                // create new input data representation
-                convertPixelData();
-                return (ImageStatus == EIS_Normal);
-            }
-        }
+            return (fstart < TotalNumberOfFrames);
+    }
+    return 0;
+}
+
+
+unsigned long DiImage::determineFrameCount(const unsigned long fstart,
+                                          const unsigned long fcount) const
+{
+    const unsigned long count = (fcount > 0) ? fcount : NumberOfFrames;
+    if (fstart + count > TotalNumberOfFrames)
+        return TotalNumberOfFrames - fstart;
+    return count;
+}
+
+
+void DiImage::selectFrames(const unsigned long fstart,
+                           const unsigned long fcount)
+{
+    // the current fragment is only a valid hint when processing the frames sequentially
+    if (fstart != FirstFrame + NumberOfFrames)
+        CurrentFragment = 0;
+    NumberOfFrames = OFstatic_cast(Uint32, determineFrameCount(fstart, fcount));
+    FirstFrame = OFstatic_cast(Uint32, fstart);
+}
+
+
+int DiImage::decodeFrames(const unsigned long fstart,
+                          const unsigned long fcount)
+{
+    // keep the previously processed frames until the new ones have been decoded
+    const Uint32 old_start = FirstFrame;
+    const Uint32 old_count = NumberOfFrames;
+    const Uint32 old_fragment = CurrentFragment;
+    DiInputPixel *old_input = InputData;
+    InputData = NULL;
+    // create new input data representation
+    selectFrames(fstart, fcount);
+    convertPixelData();
+    if (ImageStatus == EIS_Normal)
+    {
+        // free memory of previously processed frames
+        delete old_input;
+        return 1;
     }
+    DCMIMGLE_WARN("can't process frame(s) " << FirstFrame << " to " << (FirstFrame + NumberOfFrames - 1)
+        << " ... keeping previously processed frame(s)");
+    deleteInputData();
+    InputData = old_input;
+    FirstFrame = old_start;
+    NumberOfFrames = old_count;
+    CurrentFragment = old_fragment;
+    ImageStatus = EIS_Normal;
     return 0;
 }
 
@@ -77,6 +77,7 @@ DiMonoImage::DiMonoImage(const DiDocument *docu,
     VoiLutData(NULL),
     PresLutData(NULL),
     InterData(NULL),
+    DeferredModality(NULL),
     DisplayFunction(NULL),
     OutputData(NULL),
     OverlayData(NULL)
@@ -113,6 +114,7 @@ DiMonoImage::DiMonoImage(const DiDocument *docu,
     VoiLutData(NULL),
     PresLutData(NULL),
     InterData(NULL),
+    DeferredModality(NULL),
     DisplayFunction(NULL),
     OutputData(NULL),
     OverlayData(NULL)
@@ -150,6 +152,7 @@ DiMonoImage::DiMonoImage(const DiDocument *docu,
     VoiLutData(NULL),
     PresLutData(NULL),
     InterData(NULL),
+    DeferredModality(NULL),
     DisplayFunction(NULL),
     OutputData(NULL),
     OverlayData(NULL)
@@ -189,6 +192,7 @@ DiMonoImage::DiMonoImage(const DiDocument *docu,
     VoiLutData(NULL),
     PresLutData(NULL),
     InterData(NULL),
+    DeferredModality(NULL),
     DisplayFunction(NULL),
     OutputData(NULL),
     OverlayData(NULL)
@@ -221,12 +225,14 @@ DiMonoImage::DiMonoImage(const DiMonoImage *image,
     VoiLutData(image->VoiLutData),
     PresLutData(image->PresLutData),
     InterData(NULL),
+    DeferredModality(NULL),
     DisplayFunction(image->DisplayFunction),
     OutputData(NULL),
     OverlayData(NULL)
 {
     Overlays[0] = image->Overlays[0];
     Overlays[1] = image->Overlays[1];
+    OFconst_cast(DiMonoImage *, image)->createInterData();  // create on demand (if not yet done)
     if (image->InterData != NULL)
     {
         const unsigned long fsize = OFstatic_cast(unsigned long, Columns) * OFstatic_cast(unsigned long, Rows);
@@ -289,6 +295,7 @@ DiMonoImage::DiMonoImage(const DiColorImage *image,
     VoiLutData(NULL),
     PresLutData(NULL),
     InterData(NULL),
+    DeferredModality(NULL),
     DisplayFunction(NULL),
     OutputData(NULL),
     OverlayData(NULL)
@@ -334,12 +341,14 @@ DiMonoImage::DiMonoImage(const DiMonoImage *image,
     VoiLutData(image->VoiLutData),
     PresLutData(image->PresLutData),
     InterData(NULL),
+    DeferredModality(NULL),
     DisplayFunction(image->DisplayFunction),
     OutputData(NULL),
     OverlayData(NULL)
 {
     Overlays[0] = NULL;
     Overlays[1] = NULL;
+    OFconst_cast(DiMonoImage *, image)->createInterData();  // create on demand (if not yet done)
     if (image->InterData != NULL)
     {
         const unsigned int bits = image->InterData->getBits();
@@ -419,12 +428,14 @@ DiMonoImage::DiMonoImage(const DiMonoImage *image,
     VoiLutData(image->VoiLutData),
     PresLutData(image->PresLutData),
     InterData(NULL),
+    DeferredModality(NULL),
     DisplayFunction(image->DisplayFunction),
     OutputData(NULL),
     OverlayData(NULL)
 {
     Overlays[0] = NULL;
     Overlays[1] = NULL;
+    OFconst_cast(DiMonoImage *, image)->createInterData();  // create on demand (if not yet done)
     if (image->InterData != NULL)
     {
         switch (image->InterData->getRepresentation())
@@ -486,12 +497,14 @@ DiMonoImage::DiMonoImage(const DiMonoImage *image,
     VoiLutData(image->VoiLutData),
     PresLutData(image->PresLutData),
     InterData(NULL),
+    DeferredModality(NULL),
     DisplayFunction(image->DisplayFunction),
     OutputData(NULL),
     OverlayData(NULL)
 {
     Overlays[0] = NULL;
     Overlays[1] = NULL;
+    OFconst_cast(DiMonoImage *, image)->createInterData();  // create on demand (if not yet done)
     if (image->InterData != NULL)
     {
         switch (image->InterData->getRepresentation())
@@ -558,6 +571,7 @@ DiMonoImage::DiMonoImage(const DiMonoImage &)
     VoiLutData(NULL),
     PresLutData(NULL),
     InterData(NULL),
+    DeferredModality(NULL),
     DisplayFunction(NULL),
     OutputData(NULL),
     OverlayData(NULL)
@@ -592,6 +606,7 @@ DiMonoImage::DiMonoImage(const DiMonoImage *image,
     VoiLutData(NULL),
     PresLutData(NULL),
     InterData(NULL),
+    DeferredModality(NULL),
     DisplayFunction(NULL),
     OutputData(NULL),
     OverlayData(NULL)
@@ -629,6 +644,8 @@ DiMonoImage::DiMonoImage(const DiMonoImage *image,
 DiMonoImage::~DiMonoImage()
 {
     delete InterData;
+    if (DeferredModality != NULL)
+        DeferredModality->removeReference();
     delete OutputData;
     delete OFstatic_cast(char *, OverlayData);    // type cast necessary to avoid compiler warnings using gcc 2.95
     if (VoiLutData != NULL)
@@ -646,19 +663,84 @@ DiMonoImage::~DiMonoImage()
 /*********************************************************************/
 
 
-int DiMonoImage::processNextFrames(const unsigned long fcount)
+int DiMonoImage::processFrames(const unsigned long fstart,
+                              const unsigned long fcount)
 {
-    if (DiImage::processNextFrames(fcount))
+    if (checkFrames(fstart) && ((InterData != NULL) || (DeferredModality != NULL)))
     {
-        if (InterData != NULL)
+        const Uint32 old_start = FirstFrame;
+        const Uint32 old_count = NumberOfFrames;
+        const Uint32 old_fragment = CurrentFragment;
+        const unsigned long count = determineFrameCount(fstart, fcount);
+        /* nothing to do if the same frames are requested again */
+        if ((fstart == old_start) && (count == old_count))
+            return 1;
+        DiPixel *pixel = FrameCache.removeFrames(fstart, count);
+        if (pixel != NULL)
         {
-            /* do not create a new object but reference the existing one */
-            DiMonoModality *modality = InterData->addReferenceToModality();
-            delete InterData;
-            InterData = NULL;
-            Init(modality, OFTrue /* reuse */);
-            return (ImageStatus == EIS_Normal);
+            DCMIMGLE_DEBUG("using cached intermediate representation of frame(s) " << fstart << " to "
+                << (fstart + count - 1));
+            selectFrames(fstart, count);
+            /* keep the previously processed frames (if the cache is enabled) */
+            FrameCache.addFrames(old_start, old_count, InterData);
+            if (DeferredModality != NULL)
+            {
+                /* the stored pixel values are no longer needed */
+                deleteInputData();
+                DeferredModality->removeReference();
+                DeferredModality = NULL;
+            }
+            InterData = OFstatic_cast(DiMonoPixel *, pixel);
+            /* the current fragment does not refer to the frame after the cached ones */
+            CurrentFragment = 0;
+            return 1;
         }
+        /* keep the previously processed frames until the new ones have been converted */
+        DiMonoPixel *old_inter = InterData;
+        DiMonoModality *old_deferred = DeferredModality;
+        DiInputPixel *old_input = InputData;
+        /* do not create a new object but reference the existing one */
+        DiMonoModality *modality = old_deferred;
+        if (old_inter != NULL)
+            modality = old_inter->addReferenceToModality();
+        else
+            modality->addReference();
+        InterData = NULL;
+        DeferredModality = NULL;
+        InputData = NULL;
+        if (decodeFrames(fstart, count))
+        {
+            Init(modality, OFTrue /* reuse */);
+            if (ImageStatus == EIS_Normal)
+            {
+                /* the new frames are valid, keep the previous ones in the cache (if enabled) */
+                FrameCache.addFrames(old_start, old_count, old_inter);
+                delete old_input;
+                if (old_deferred != NULL)
+                    old_deferred->removeReference();
+                return 1;
+            }
+            DCMIMGLE_WARN("can't process frame(s) " << FirstFrame << " to " << (FirstFrame + NumberOfFrames - 1)
+                << " ... keeping previously processed frame(s)");
+            /* the reference to the modality transform has been taken over (if successful) */
+            if (InterData != NULL)
+                delete InterData;
+            else if (DeferredModality != NULL)
+                DeferredModality->removeReference();
+            else
+                modality->removeReference();
+            deleteInputData();
+            /* restore the previous frame selection (already done by decodeFrames() on failure) */
+            FirstFrame = old_start;
+            NumberOfFrames = old_count;
+            CurrentFragment = old_fragment;
+            ImageStatus = EIS_Normal;
+        } else
+            modality->removeReference();
+        /* restore the previously processed frames */
+        InterData = old_inter;
+        DeferredModality = old_deferred;
+        InputData = old_input;
     }
     return 0;
 }
@@ -680,31 +762,18 @@ void DiMonoImage::Init(DiMonoModality *modality,
             if ((Overlays[0] == NULL) || (Overlays[0]->getCount() == 0) || (!Overlays[0]->hasEmbeddedData()))
                 detachPixelData();                          // no longer needed, save memory
         }
-        switch (InputData->getRepresentation())
+        if ((Document->getFlags() & CIF_CreateIntermediateDataOnDemand) && checkDirectRendering())
         {
-            case EPR_Uint8:
-                InitUint8(modality);
-                break;
-            case EPR_Sint8:
-                InitSint8(modality);
-                break;
-            case EPR_Uint16:
-                InitUint16(modality);
-                break;
-            case EPR_Sint16:
-                InitSint16(modality);
-                break;
-            case EPR_Uint32:
-                InitUint32(modality);
-                break;
-            case EPR_Sint32:
-                InitSint32(modality);
-                break;
+            /* keep the stored pixel values, see createInterData() */
+            DCMIMGLE_DEBUG("deferring creation of intermediate representation until it is required");
+            DeferredModality = modality;
+        } else {
+            InterData = convertInputData(InputData, modality);
+            deleteInputData();                              // no longer needed, save memory
         }
-        deleteInputData();                                  // no longer needed, save memory
         if (modality->getBits() > 0)
             BitsPerSample = modality->getBits();            // get bit depth of internal representation
-        if (checkInterData())
+        if ((DeferredModality != NULL) || checkInterData())
         {
             /* get grayscale related attributes (if desired) */
             if (!reuse && !(Document->getFlags() & CIF_UsePresentationState))
@@ -745,176 +814,209 @@ void DiMonoImage::Init(DiMonoModality *modality,
 }
 
 
-void DiMonoImage::InitUint8(DiMonoModality *modality)
+DiMonoPixel *DiMonoImage::InitUint8(DiInputPixel *input,
+                                    DiMonoModality *modality)
 {
     if (modality != NULL)
     {
         switch (modality->getRepresentation())
         {
             case EPR_Uint8:
-                InterData = new DiMonoInputPixelTemplate<Uint8, Uint32, Uint8>(InputData, modality);
-                break;
+                return new DiMonoInputPixelTemplate<Uint8, Uint32, Uint8>(input, modality);
             case EPR_Sint8:
-                InterData = new DiMonoInputPixelTemplate<Uint8, Uint32, Sint8>(InputData, modality);
-                break;
+                return new DiMonoInputPixelTemplate<Uint8, Uint32, Sint8>(input, modality);
             case EPR_Uint16:
-                InterData = new DiMonoInputPixelTemplate<Uint8, Uint32, Uint16>(InputData, modality);
-                break;
+                return new DiMonoInputPixelTemplate<Uint8, Uint32, Uint16>(input, modality);
             case EPR_Sint16:
-                InterData = new DiMonoInputPixelTemplate<Uint8, Uint32, Sint16>(InputData, modality);
-                break;
+                return new DiMonoInputPixelTemplate<Uint8, Uint32, Sint16>(input, modality);
             case EPR_Uint32:
-                InterData = new DiMonoInputPixelTemplate<Uint8, Uint32, Uint32>(InputData, modality);
-                break;
+                return new DiMonoInputPixelTemplate<Uint8, Uint32, Uint32>(input, modality);
             case EPR_Sint32:
-                InterData = new DiMonoInputPixelTemplate<Uint8, Uint32, Sint32>(InputData, modality);
-                break;
+                return new DiMonoInputPixelTemplate<Uint8, Uint32, Sint32>(input, modality);
         }
     }
+    return NULL;
 }
 
 
-void DiMonoImage::InitSint8(DiMonoModality *modality)
+DiMonoPixel *DiMonoImage::InitSint8(DiInputPixel *input,
+                                    DiMonoModality *modality)
 {
     if (modality != NULL)
     {
         switch (modality->getRepresentation())
         {
             case EPR_Uint8:
-                InterData = new DiMonoInputPixelTemplate<Sint8, Sint32, Uint8>(InputData, modality);
-                break;
+                return new DiMonoInputPixelTemplate<Sint8, Sint32, Uint8>(input, modality);
             case EPR_Sint8:
-                InterData = new DiMonoInputPixelTemplate<Sint8, Sint32, Sint8>(InputData, modality);
-                break;
+                return new DiMonoInputPixelTemplate<Sint8, Sint32, Sint8>(input, modality);
             case EPR_Uint16:
-                InterData = new DiMonoInputPixelTemplate<Sint8, Sint32, Uint16>(InputData, modality);
-                break;
+                return new DiMonoInputPixelTemplate<Sint8, Sint32, Uint16>(input, modality);
             case EPR_Sint16:
-                InterData = new DiMonoInputPixelTemplate<Sint8, Sint32, Sint16>(InputData, modality);
-                break;
+                return new DiMonoInputPixelTemplate<Sint8, Sint32, Sint16>(input, modality);
             case EPR_Uint32:
-                InterData = new DiMonoInputPixelTemplate<Sint8, Sint32, Uint32>(InputData, modality);
-                break;
+                return new DiMonoInputPixelTemplate<Sint8, Sint32, Uint32>(input, modality);
             case EPR_Sint32:
-                InterData = new DiMonoInputPixelTemplate<Sint8, Sint32, Sint32>(InputData, modality);
-                break;
+                return new DiMonoInputPixelTemplate<Sint8, Sint32, Sint32>(input, modality);
         }
     }
+    return NULL;
 }
 
-void DiMonoImage::InitUint16(DiMonoModality *modality)
+DiMonoPixel *DiMonoImage::InitUint16(DiInputPixel *input,
+                                     DiMonoModality *modality)
 {
     if (modality != NULL)
     {
         switch (modality->getRepresentation())
         {
             case EPR_Uint8:
-                InterData = new DiMonoInputPixelTemplate<Uint16, Uint32, Uint8>(InputData, modality);
-                break;
+                return new DiMonoInputPixelTemplate<Uint16, Uint32, Uint8>(input, modality);
             case EPR_Sint8:
-                InterData = new DiMonoInputPixelTemplate<Uint16, Uint32, Sint8>(InputData, modality);
-                break;
+                return new DiMonoInputPixelTemplate<Uint16, Uint32, Sint8>(input, modality);
             case EPR_Uint16:
-                InterData = new DiMonoInputPixelTemplate<Uint16, Uint32, Uint16>(InputData, modality);
-                break;
+                return new DiMonoInputPixelTemplate<Uint16, Uint32, Uint16>(input, modality);
             case EPR_Sint16:
-                InterData = new DiMonoInputPixelTemplate<Uint16, Uint32, Sint16>(InputData, modality);
-                break;
+                return new DiMonoInputPixelTemplate<Uint16, Uint32, Sint16>(input, modality);
             case EPR_Uint32:
-                InterData = new DiMonoInputPixelTemplate<Uint16, Uint32, Uint32>(InputData, modality);
-                break;
+                return new DiMonoInputPixelTemplate<Uint16, Uint32, Uint32>(input, modality);
             case EPR_Sint32:
-                InterData = new DiMonoInputPixelTemplate<Uint16, Uint32, Sint32>(InputData, modality);
-                break;
+                return new DiMonoInputPixelTemplate<Uint16, Uint32, Sint32>(input, modality);
         }
     }
+    return NULL;
 }
 
 
-void DiMonoImage::InitSint16(DiMonoModality *modality)
+DiMonoPixel *DiMonoImage::InitSint16(DiInputPixel *input,
+                                     DiMonoModality *modality)
 {
     if (modality != NULL)
     {
         switch (modality->getRepresentation())
         {
             case EPR_Uint8:
-                InterData = new DiMonoInputPixelTemplate<Sint16, Sint32, Uint8>(InputData, modality);
-                break;
+                return new DiMonoInputPixelTemplate<Sint16, Sint32, Uint8>(input, modality);
             case EPR_Sint8:
-                InterData = new DiMonoInputPixelTemplate<Sint16, Sint32, Sint8>(InputData, modality);
-                break;
+                return new DiMonoInputPixelTemplate<Sint16, Sint32, Sint8>(input, modality);
             case EPR_Uint16:
-                InterData = new DiMonoInputPixelTemplate<Sint16, Sint32, Uint16>(InputData, modality);
-                break;
+                return new DiMonoInputPixelTemplate<Sint16, Sint32, Uint16>(input, modality);
             case EPR_Sint16:
-                InterData = new DiMonoInputPixelTemplate<Sint16, Sint32, Sint16>(InputData, modality);
-                break;
+                return new DiMonoInputPixelTemplate<Sint16, Sint32, Sint16>(input, modality);
             case EPR_Uint32:
-                InterData = new DiMonoInputPixelTemplate<Sint16, Sint32, Uint32>(InputData, modality);
-                break;
+                return new DiMonoInputPixelTemplate<Sint16, Sint32, Uint32>(input, modality);
             case EPR_Sint32:
-                InterData = new DiMonoInputPixelTemplate<Sint16, Sint32, Sint32>(InputData, modality);
-                break;
+                return new DiMonoInputPixelTemplate<Sint16, Sint32, Sint32>(input, modality);
         }
     }
+    return NULL;
 }
 
 
-void DiMonoImage::InitUint32(DiMonoModality *modality)
+DiMonoPixel *DiMonoImage::InitUint32(DiInputPixel *input,
+                                     DiMonoModality *modality)
 {
     if (modality != NULL)
     {
         switch (modality->getRepresentation())
         {
             case EPR_Uint8:
-                InterData = new DiMonoInputPixelTemplate<Uint32, Uint32, Uint8>(InputData, modality);
-                break;
+                return new DiMonoInputPixelTemplate<Uint32, Uint32, Uint8>(input, modality);
             case EPR_Sint8:
-                InterData = new DiMonoInputPixelTemplate<Uint32, Uint32, Sint8>(InputData, modality);
-                break;
+                return new DiMonoInputPixelTemplate<Uint32, Uint32, Sint8>(input, modality);
             case EPR_Uint16:
-                InterData = new DiMonoInputPixelTemplate<Uint32, Uint32, Uint16>(InputData, modality);
-                break;
+                return new DiMonoInputPixelTemplate<Uint32, Uint32, Uint16>(input, modality);
             case EPR_Sint16:
-                InterData = new DiMonoInputPixelTemplate<Uint32, Uint32, Sint16>(InputData, modality);
-                break;
+                return new DiMonoInputPixelTemplate<Uint32, Uint32, Sint16>(input, modality);
             case EPR_Uint32:
-                InterData = new DiMonoInputPixelTemplate<Uint32, Uint32, Uint32>(InputData, modality);
-                break;
+                return new DiMonoInputPixelTemplate<Uint32, Uint32, Uint32>(input, modality);
             case EPR_Sint32:
-                InterData = new DiMonoInputPixelTemplate<Uint32, Uint32, Sint32>(InputData, modality);
-                break;
+                return new DiMonoInputPixelTemplate<Uint32, Uint32, Sint32>(input, modality);
         }
     }
+    return NULL;
 }
 
 
-void DiMonoImage::InitSint32(DiMonoModality *modality)
+DiMonoPixel *DiMonoImage::InitSint32(DiInputPixel *input,
+                                     DiMonoModality *modality)
 {
     if (modality != NULL)
     {
         switch (modality->getRepresentation())
         {
             case EPR_Uint8:
-                InterData = new DiMonoInputPixelTemplate<Sint32, Sint32, Uint8>(InputData, modality);
-                break;
+                return new DiMonoInputPixelTemplate<Sint32, Sint32, Uint8>(input, modality);
             case EPR_Sint8:
-                InterData = new DiMonoInputPixelTemplate<Sint32, Sint32, Sint8>(InputData, modality);
-                break;
+                return new DiMonoInputPixelTemplate<Sint32, Sint32, Sint8>(input, modality);
             case EPR_Uint16:
-                InterData = new DiMonoInputPixelTemplate<Sint32, Sint32, Uint16>(InputData, modality);
-                break;
+                return new DiMonoInputPixelTemplate<Sint32, Sint32, Uint16>(input, modality);
             case EPR_Sint16:
-                InterData = new DiMonoInputPixelTemplate<Sint32, Sint32, Sint16>(InputData, modality);
-                break;
+                return new DiMonoInputPixelTemplate<Sint32, Sint32, Sint16>(input, modality);
             case EPR_Uint32:
-                InterData = new DiMonoInputPixelTemplate<Sint32, Sint32, Uint32>(InputData, modality);
-                break;
+                return new DiMonoInputPixelTemplate<Sint32, Sint32, Uint32>(input, modality);
             case EPR_Sint32:
-                InterData = new DiMonoInputPixelTemplate<Sint32, Sint32, Sint32>(InputData, modality);
-                break;
+                return new DiMonoInputPixelTemplate<Sint32, Sint32, Sint32>(input, modality);
+        }
+    }
+    return NULL;
+}
+
+DiMonoPixel *DiMonoImage::convertInputData(DiInputPixel *input,
+                                           DiMonoModality *modality)
+{
+    if (input != NULL)
+    {
+        switch (input->getRepresentation())
+        {
+            case EPR_Uint8:
+                return InitUint8(input, modality);
+            case EPR_Sint8:
+                return InitSint8(input, modality);
+            case EPR_Uint16:
+                return InitUint16(input, modality);
+            case EPR_Sint16:
+                return InitSint16(input, modality);
+            case EPR_Uint32:
+                return InitUint32(input, modality);
+            case EPR_Sint32:
+                return InitSint32(input, modality);
         }
     }
+    return NULL;
+}
+
+
+int DiMonoImage::createInterData()
+{
+    if ((InterData == NULL) && (DeferredModality != NULL))
+    {
+        DCMIMGLE_DEBUG("creating intermediate representation on demand");
+        InterData = convertInputData(InputData, DeferredModality);
+        if (InterData == NULL)
+            DeferredModality->removeReference();
+        DeferredModality = NULL;                            // reference has been taken over
+        deleteInputData();                                  // no longer needed, save memory
+        return checkInterData();
+    }
+    return (InterData != NULL);
+}
+
+
+int DiMonoImage::checkDirectRendering() const
+{
+    if ((InputData != NULL) && (InputData->getPixelCount() >= InputData->getComputedCount()))
+    {
+        const EP_Representation repres = InputData->getRepresentation();
+        if ((repres == EPR_Uint8) || (repres == EPR_Sint8) || (repres == EPR_Uint16) || (repres == EPR_Sint16))
+        {
+            /* the table of all possible stored pixel values is processed in rows of 256 entries */
+            const unsigned long count = OFstatic_cast(unsigned long, InputData->getAbsMaxRange());
+            const unsigned long fsize = OFstatic_cast(unsigned long, Columns) * OFstatic_cast(unsigned long, Rows);
+            return ((count <= 256) || (count % 256 == 0)) && (count <= fsize);
+        }
+    }
+    return 0;
 }
 
 /*********************************************************************/
@@ -994,7 +1096,14 @@ int DiMonoImage::getMinMaxValues(double &min,
                                  double &max,
                                  const int mode) const
 {
-    if (InterData != NULL)
+    if (mode && (DeferredModality != NULL))
+    {
+        /* absolute range does not require the intermediate representation */
+        min = DeferredModality->getAbsMinimum();
+        max = DeferredModality->getAbsMaximum();
+        return 1;
+    }
+    if (OFconst_cast(DiMonoImage *, this)->createInterData())
     {
         if (mode)
         {
@@ -1070,7 +1179,7 @@ int DiMonoImage::setNoVoiTransformation()
 
 int DiMonoImage::setMinMaxWindow(const int idx)
 {
-    if (InterData != NULL)
+    if (createInterData())
     {
         double center;
         double width;
@@ -1087,7 +1196,7 @@ int DiMonoImage::setRoiWindow(const unsigned long left_pos,
                               const unsigned long height,
                               const unsigned long frame)
 {
-    if ((InterData != NULL) && (frame < NumberOfFrames))
+    if ((frame < NumberOfFrames) && createInterData())
     {
         double voiCenter;
         double voiWidth;
@@ -1100,7 +1209,7 @@ int DiMonoImage::setRoiWindow(const unsigned long left_pos,
 
 int DiMonoImage::setHistogramWindow(const double thresh)
 {
-    if (InterData != NULL)
+    if (createInterData())
     {
         double center;
         double width;
@@ -1380,6 +1489,9 @@ int DiMonoImage::removeAllOverlays()
 int DiMonoImage::flip(const int horz,
                       const int vert)
 {
+    FrameCache.clear();                             // cached frames are no longer valid
+    if (!createInterData())
+        return 0;
     switch (InterData->getRepresentation())
     {
         case EPR_Uint8:
@@ -1430,6 +1542,9 @@ int DiMonoImage::rotate(const int degree)
 {
     const Uint16 old_cols = Columns;                // save old values
     const Uint16 old_rows = Rows;
+    FrameCache.clear();                             // cached frames are no longer valid
+    if (!createInterData())
+        return 0;
     DiImage::rotate(degree);                        // swap width and height if necessary
     if ((Columns > 1) && (Rows > 1))                // re-interpret pixel data for cols = 1 or rows = 1
     {
@@ -1494,7 +1609,7 @@ const void *DiMonoImage::getData(void *buffer,
                                  const int /*planar*/,            /* not yet supported, needed for pastel color images !! */
                                  const int negative)
 {
-    if ((InterData != NULL) && (ImageStatus == EIS_Normal) && (frame < NumberOfFrames) &&
+    if (((InterData != NULL) || (DeferredModality != NULL)) && (ImageStatus == EIS_Normal) && (frame < NumberOfFrames) &&
         (((bits > 0) && (bits <= MAX_BITS)) || (bits == MI_PastelColor)))
     {
         if ((buffer == NULL) || (size >= getOutputDataSize(bits)))
@@ -1534,26 +1649,12 @@ const void *DiMonoImage::getData(void *buffer,
                 disp = NULL;
             }
             const int samples = (bits == MI_PastelColor) ? 3 : 1;
-            switch (InterData->getRepresentation())
+            if ((InterData == NULL) && (samples == 1))
+                OutputData = getDataDirect(buffer, disp, frame, bits, low, high);
+            if ((OutputData == NULL) && createInterData())
             {
-                case EPR_Uint8:
-                    getDataUint8(buffer, disp, samples, frame, bits, low, high);
-                    break;
-                case EPR_Sint8:
-                    getDataSint8(buffer, disp, samples, frame, bits, low, high);
-                    break;
-                case EPR_Uint16:
-                    getDataUint16(buffer, disp, samples, frame, bits, low, high);
-                    break;
-                case EPR_Sint16:
-                    getDataSint16(buffer, disp, samples, frame, bits, low, high);
-                    break;
-                case EPR_Uint32:
-                    getDataUint32(buffer, disp, samples, frame, bits, low, high);
-                    break;
-                case EPR_Sint32:
-                    getDataSint32(buffer, disp, samples, frame, bits, low, high);
-                    break;
+                OutputData = createOutputData(buffer, InterData, Overlays, disp, samples, frame, bits, low, high,
+                    Columns, Rows, NumberOfFrames);
             }
             if (OutputData == NULL)
             {
@@ -1570,6 +1671,41 @@ const void *DiMonoImage::getData(void *buffer,
 }
 
 
+DiMonoOutputPixel *DiMonoImage::createOutputData(void *buffer,
+                                                 const DiMonoPixel *inter,
+                                                 DiOverlay *overlays[2],
+                                                 DiDisplayFunction *disp,
+                                                 const int samples,
+                                                 const unsigned long frame,
+                                                 const int bits,
+                                                 const Uint32 low,
+                                                 const Uint32 high,
+                                                 const Uint16 columns,
+                                                 const Uint16 rows,
+                                                 const unsigned long frames)
+{
+    if (inter != NULL)
+    {
+        switch (inter->getRepresentation())
+        {
+            case EPR_Uint8:
+                return getDataUint8(buffer, inter, overlays, disp, samples, frame, bits, low, high, columns, rows, frames);
+            case EPR_Sint8:
+                return getDataSint8(buffer, inter, overlays, disp, samples, frame, bits, low, high, columns, rows, frames);
+            case EPR_Uint16:
+                return getDataUint16(buffer, inter, overlays, disp, samples, frame, bits, low, high, columns, rows, frames);
+            case EPR_Sint16:
+                return getDataSint16(buffer, inter, overlays, disp, samples, frame, bits, low, high, columns, rows, frames);
+            case EPR_Uint32:
+                return getDataUint32(buffer, inter, overlays, disp, samples, frame, bits, low, high, columns, rows, frames);
+            case EPR_Sint32:
+                return getDataSint32(buffer, inter, overlays, disp, samples, frame, bits, low, high, columns, rows, frames);
+        }
+    }
+    return NULL;
+}
+
+
 /*
  *   create 1/8/16-bit (bi-level) bitmap with overlay 'plane' data
  */
@@ -1988,7 +2124,7 @@ int DiMonoImage::writeImageToDataset(DcmItem &dataset,
                                      const int /*planar*/)
 {
     int result = 0;
-    if (InterData != NULL)
+    if (createInterData())
     {
         const void *pixel = InterData->getData();
         const unsigned long count = InterData->getCount();
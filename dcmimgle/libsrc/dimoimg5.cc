@@ -28,57 +28,68 @@
 #include "dcmtk/dcmimgle/diutils.h"
 
 
-void DiMonoImage::getDataUint32(void *buffer,
-                                DiDisplayFunction *disp,
-                                const int samples,
-                                const unsigned long frame,
-                                const int bits,
-                                const Uint32 low,
-                                const Uint32 high)
+DiMonoOutputPixel *DiMonoImage::getDataUint32(void *buffer,
+                                              const DiMonoPixel *inter,
+                                              DiOverlay *overlays[2],
+                                              DiDisplayFunction *disp,
+                                              const int samples,
+                                              const unsigned long frame,
+                                              const int bits,
+                                              const Uint32 low,
+                                              const Uint32 high,
+                                              const Uint16 columns,
+                                              const Uint16 rows,
+                                              const unsigned long frames)
 {
-    if (InterData != NULL)
+    if (inter != NULL)
     {
-        if (InterData->isPotentiallySigned())
+        if (inter->isPotentiallySigned())
         {
             if (bits <= 8)
-                OutputData = new DiMonoOutputPixelTemplate<Uint32, Sint32, Uint8>(buffer, InterData, Overlays, VoiLutData, PresLutData,
-                    disp, VoiLutFunction, WindowCenter, WindowWidth, low, high, Columns, Rows, frame, NumberOfFrames, samples > 1);
+                return new DiMonoOutputPixelTemplate<Uint32, Sint32, Uint8>(buffer, inter, overlays, VoiLutData, PresLutData,
+                    disp, VoiLutFunction, WindowCenter, WindowWidth, low, high, columns, rows, frame, frames, samples > 1);
             else if (bits <= 16)
-                OutputData = new DiMonoOutputPixelTemplate<Uint32, Sint32, Uint16>(buffer, InterData, Overlays, VoiLutData, PresLutData,
-                    disp, VoiLutFunction, WindowCenter, WindowWidth, low, high, Columns, Rows, frame, NumberOfFrames);
+                return new DiMonoOutputPixelTemplate<Uint32, Sint32, Uint16>(buffer, inter, overlays, VoiLutData, PresLutData,
+                    disp, VoiLutFunction, WindowCenter, WindowWidth, low, high, columns, rows, frame, frames);
             else
-                OutputData = new DiMonoOutputPixelTemplate<Uint32, Sint32, Uint32>(buffer, InterData, Overlays, VoiLutData, PresLutData,
-                    disp, VoiLutFunction, WindowCenter, WindowWidth, low, high, Columns, Rows, frame, NumberOfFrames);
+                return new DiMonoOutputPixelTemplate<Uint32, Sint32, Uint32>(buffer, inter, overlays, VoiLutData, PresLutData,
+                    disp, VoiLutFunction, WindowCenter, WindowWidth, low, high, columns, rows, frame, frames);
         } else {
             if (bits <= 8)
-                OutputData = new DiMonoOutputPixelTemplate<Uint32, Uint32, Uint8>(buffer, InterData, Overlays, VoiLutData, PresLutData,
-                    disp, VoiLutFunction, WindowCenter, WindowWidth, low, high, Columns, Rows, frame, NumberOfFrames, samples > 1);
+                return new DiMonoOutputPixelTemplate<Uint32, Uint32, Uint8>(buffer, inter, overlays, VoiLutData, PresLutData,
+                    disp, VoiLutFunction, WindowCenter, WindowWidth, low, high, columns, rows, frame, frames, samples > 1);
             else if (bits <= 16)
-                OutputData = new DiMonoOutputPixelTemplate<Uint32, Uint32, Uint16>(buffer, InterData, Overlays, VoiLutData, PresLutData,
-                    disp, VoiLutFunction, WindowCenter, WindowWidth, low, high, Columns, Rows, frame, NumberOfFrames);
+                return new DiMonoOutputPixelTemplate<Uint32, Uint32, Uint16>(buffer, inter, overlays, VoiLutData, PresLutData,
+                    disp, VoiLutFunction, WindowCenter, WindowWidth, low, high, columns, rows, frame, frames);
             else
-                OutputData = new DiMonoOutputPixelTemplate<Uint32, Uint32, Uint32>(buffer, InterData, Overlays, VoiLutData, PresLutData,
-                    disp, VoiLutFunction, WindowCenter, WindowWidth, low, high, Columns, Rows, frame, NumberOfFrames);
+                return new DiMonoOutputPixelTemplate<Uint32, Uint32, Uint32>(buffer, inter, overlays, VoiLutData, PresLutData,
+                    disp, VoiLutFunction, WindowCenter, WindowWidth, low, high, columns, rows, frame, frames);
         }
     }
+    return NULL;
 }
 
 
-void DiMonoImage::getDataSint32(void *buffer,
-                                DiDisplayFunction *disp,
-                                const int samples,
-                                const unsigned long frame,
-                                const int bits,
-                                const Uint32 low,
-                                const Uint32 high)
+DiMonoOutputPixel *DiMonoImage::getDataSint32(void *buffer,
+                                              const DiMonoPixel *inter,
+                                              DiOverlay *overlays[2],
+                                              DiDisplayFunction *disp,
+                                              const int samples,
+                                              const unsigned long frame,
+                                              const int bits,
+                                              const Uint32 low,
+                                              const Uint32 high,
+                                              const Uint16 columns,
+                                              const Uint16 rows,
+                                              const unsigned long frames)
 {
     if (bits <= 8)
-        OutputData = new DiMonoOutputPixelTemplate<Sint32, Sint32, Uint8>(buffer, InterData, Overlays, VoiLutData, PresLutData,
-            disp, VoiLutFunction, WindowCenter, WindowWidth, low, high, Columns, Rows, frame, NumberOfFrames, samples > 1);
+        return new DiMonoOutputPixelTemplate<Sint32, Sint32, Uint8>(buffer, inter, overlays, VoiLutData, PresLutData,
+            disp, VoiLutFunction, WindowCenter, WindowWidth, low, high, columns, rows, frame, frames, samples > 1);
     else if (bits <= 16)
-        OutputData = new DiMonoOutputPixelTemplate<Sint32, Sint32, Uint16>(buffer, InterData, Overlays, VoiLutData, PresLutData,
-            disp, VoiLutFunction, WindowCenter, WindowWidth, low, high, Columns, Rows, frame, NumberOfFrames);
+        return new DiMonoOutputPixelTemplate<Sint32, Sint32, Uint16>(buffer, inter, overlays, VoiLutData, PresLutData,
+            disp, VoiLutFunction, WindowCenter, WindowWidth, low, high, columns, rows, frame, frames);
     else
-        OutputData = new DiMonoOutputPixelTemplate<Sint32, Sint32, Uint32>(buffer, InterData, Overlays, VoiLutData, PresLutData,
-            disp, VoiLutFunction, WindowCenter, WindowWidth, low, high, Columns, Rows, frame, NumberOfFrames);
+        return new DiMonoOutputPixelTemplate<Sint32, Sint32, Uint32>(buffer, inter, overlays, VoiLutData, PresLutData,
+            disp, VoiLutFunction, WindowCenter, WindowWidth, low, high, columns, rows, frame, frames);
 }
@@ -0,0 +1,284 @@
+/*
+ *
+ *  Copyright (C) 2016, OFFIS e.V.
+ *  All rights reserved.  See COPYRIGHT file for details.
+ *
+ *  This software and supporting documentation were developed by
+ *
+ *    OFFIS e.V.
+ *    R&D Division Health
+ *    Escherweg 2
+ *    D-26121 Oldenburg, Germany
+ *
+ *
+ *  Module:  dcmimgle
+ *
+ *  Author:  OFFIS DICOM Team
+ *
+ *  Purpose: DicomMonochromeImage (Source, direct rendering)
+ *
+ */
+
+
+#include "dcmtk/config/osconfig.h"
+
+#include "dcmtk/dcmimgle/dimoimg.h"
+#include "dcmtk/dcmimgle/dimomod.h"
+#include "dcmtk/dcmimgle/dimoopxt.h"
+#include "dcmtk/dcmimgle/diinpx.h"
+#include "dcmtk/dcmimgle/dipxrept.h"
+#include "dcmtk/dcmimgle/diutils.h"
+
+
+/*---------------------*
+ *  class declaration  *
+ *---------------------*/
+
+/** Template class containing all possible stored pixel values of a given input representation
+ *  (in ascending order).  Used to compute the output pixel value for each stored pixel value
+ *  by means of the usual output routines (see DiMonoImage::getDataDirect()).
+ */
+template<class T>
+class DiStoredValueTemplate
+  : public DiInputPixel,
+    public DiPixelRepresentationTemplate<T>
+{
+
+ public:
+
+    /** constructor
+     *
+     ** @param  input  pointer to input pixel representation (stored pixel values)
+     *  @param  count  number of possible stored pixel values
+     */
+    DiStoredValueTemplate(const DiInputPixel *input,
+                          const unsigned long count)
+      : DiInputPixel(input->getBits(), 0, 1, count),
+        Data(NULL)
+    {
+        AbsMinimum = input->getAbsMinimum();
+        AbsMaximum = input->getAbsMaximum();
+        Data = new T[count];
+        if (Data != NULL)
+        {
+            Count = count;
+            T *q = Data;
+            T value = OFstatic_cast(T, AbsMinimum);
+            for (unsigned long i = count; i != 0; --i)
+                *(q++) = value++;
+        }
+    }
+
+    /** destructor
+     */
+    virtual ~DiStoredValueTemplate()
+    {
+        delete[] Data;
+    }
+
+    /** determine minimum and maximum pixel value (always the absolute values)
+     *
+     ** @return status, true if successful, false otherwise
+     */
+    int determineMinMax()
+    {
+        return (Data != NULL);
+    }
+
+    /** get pixel representation
+     *
+     ** @return pixel representation
+     */
+    inline EP_Representation getRepresentation() const
+    {
+        return DiPixelRepresentationTemplate<T>::getRepresentation();
+    }
+
+    /** get pointer to pixel data
+     *
+     ** @return pointer to pixel data
+     */
+    inline const void *getData() const
+    {
+        return OFstatic_cast(const void *, Data);
+    }
+
+    /** get pointer to pixel data
+     *
+     ** @return pointer to pixel data
+     */
+    virtual void *getDataPtr()
+    {
+        return OFstatic_cast(void *, Data);
+    }
+
+    /** remove reference to (internally handled) pixel data
+     */
+    inline void removeDataReference()
+    {
+        Data = NULL;
+    }
+
+    /** get minimum pixel value
+     *
+     ** @param  idx  ignored
+     *
+     ** @return absolute minimum pixel value
+     */
+    inline double getMinValue(const int /*idx*/) const
+    {
+        return AbsMinimum;
+    }
+
+    /** get maximum pixel value
+     *
+     ** @param  idx  ignored
+     *
+     ** @return absolute maximum pixel value
+     */
+    inline double getMaxValue(const int /*idx*/) const
+    {
+        return AbsMaximum;
+    }
+
+
+ private:
+
+    /// pointer to pixel data
+    T *Data;
+
+ // --- declarations to avoid compiler warnings
+
+    DiStoredValueTemplate(const DiStoredValueTemplate<T> &);
+    DiStoredValueTemplate<T> &operator=(const DiStoredValueTemplate<T> &);
+};
+
+
+/*-----------------------*
+ *  function definitions  *
+ *-----------------------*/
+
+/** create output data by applying the given table to the stored pixel values
+ *
+ ** @param  buffer    storage area for the output pixel data (maybe NULL)
+ *  @param  input     pointer to input pixel representation (stored pixel values)
+ *  @param  table     output pixel data for all possible stored pixel values
+ *  @param  overlays  array of overlay management objects
+ *  @param  disp      display function (maybe NULL)
+ *  @param  bits      number of bits for the output pixel data (depth)
+ *  @param  low       lowest pixel value for the output data
+ *  @param  high      highest pixel value for the output data
+ *  @param  columns   image's width (in pixels)
+ *  @param  rows      image's height
+ *  @param  frame     frame to be rendered
+ *
+ ** @return pointer to new output data object
+ */
+template<class T1, class T2>
+static DiMonoOutputPixel *createDirectOutputData(void *buffer,
+                                                 const DiInputPixel *input,
+                                                 const DiMonoOutputPixel *table,
+                                                 DiOverlay *overlays[2],
+                                                 DiDisplayFunction *disp,
+                                                 const int bits,
+                                                 const Uint32 low,
+                                                 const Uint32 high,
+                                                 const Uint16 columns,
+                                                 const Uint16 rows,
+                                                 const unsigned long frame)
+{
+    if (bits <= 8)
+        return new DiMonoOutputPixelTemplate<T1, T2, Uint8>(buffer, input, table, overlays, disp, low, high, columns, rows, frame);
+    else if (bits <= 16)
+        return new DiMonoOutputPixelTemplate<T1, T2, Uint16>(buffer, input, table, overlays, disp, low, high, columns, rows, frame);
+    return new DiMonoOutputPixelTemplate<T1, T2, Uint32>(buffer, input, table, overlays, disp, low, high, columns, rows, frame);
+}
+
+
+/*********************************************************************/
+
+
+DiMonoOutputPixel *DiMonoImage::getDataDirect(void *buffer,
+                                              DiDisplayFunction *disp,
+                                              const unsigned long frame,
+                                              const int bits,
+                                              const Uint32 low,
+                                              const Uint32 high)
+{
+    DiMonoOutputPixel *result = NULL;
+    if ((InputData != NULL) && (DeferredModality != NULL))
+    {
+        /* create table with all possible stored pixel values */
+        const unsigned long count = OFstatic_cast(unsigned long, InputData->getAbsMaxRange());
+        DiInputPixel *values = NULL;
+        switch (InputData->getRepresentation())
+        {
+            case EPR_Uint8:
+                values = new DiStoredValueTemplate<Uint8>(InputData, count);
+                break;
+            case EPR_Sint8:
+                values = new DiStoredValueTemplate<Sint8>(InputData, count);
+                break;
+            case EPR_Uint16:
+                values = new DiStoredValueTemplate<Uint16>(InputData, count);
+                break;
+            case EPR_Sint16:
+                values = new DiStoredValueTemplate<Sint16>(InputData, count);
+                break;
+            default:
+                break;
+        }
+        if ((values != NULL) && (values->getCount() == count))
+        {
+            /* apply modality transform to the table */
+            DeferredModality->addReference();
+            DiMonoPixel *inter = convertInputData(values, DeferredModality);
+            if (inter == NULL)
+                DeferredModality->removeReference();
+            else if (inter->getData() != NULL)
+            {
+                /* apply VOI transform, presentation LUT and display function to the table */
+                DiOverlay *noOverlays[2] = {NULL, NULL};
+                const Uint16 columns = OFstatic_cast(Uint16, (count > 256) ? 256 : count);
+                const Uint16 rows = OFstatic_cast(Uint16, count / columns);
+                DiMonoOutputPixel *table = createOutputData(NULL, inter, noOverlays, disp, 1 /*samples*/, 0 /*frame*/,
+                    bits, low, high, columns, rows, 1 /*frames*/);
+                if ((table != NULL) && (table->getData() != NULL))
+                {
+                    /* finally, apply the table to the stored pixel values of the selected frame */
+                    switch (InputData->getRepresentation())
+                    {
+                        case EPR_Uint8:
+                            result = createDirectOutputData<Uint8, Uint32>(buffer, InputData, table, Overlays, disp, bits,
+                                low, high, Columns, Rows, frame);
+                            break;
+                        case EPR_Sint8:
+                            result = createDirectOutputData<Sint8, Sint32>(buffer, InputData, table, Overlays, disp, bits,
+                                low, high, Columns, Rows, frame);
+                            break;
+                        case EPR_Uint16:
+                            result = createDirectOutputData<Uint16, Uint32>(buffer, InputData, table, Overlays, disp, bits,
+                                low, high, Columns, Rows, frame);
+                            break;
+                        case EPR_Sint16:
+                            result = createDirectOutputData<Sint16, Sint32>(buffer, InputData, table, Overlays, disp, bits,
+                                low, high, Columns, Rows, frame);
+                            break;
+                        default:
+                            break;
+                    }
+                    if ((result != NULL) && (result->getData() == NULL))
+                    {
+                        /* fall back to the usual rendering */
+                        delete result;
+                        result = NULL;
+                    }
+                }
+                delete table;
+            }
+            delete inter;
+        }
+        delete values;
+    }
+    return result;
+}
@@ -24,6 +24,7 @@
 
 #include "dcmtk/dcmimgle/dimoopx.h"
 #include "dcmtk/dcmimgle/dimopx.h"
+#include "dcmtk/dcmimgle/diinpx.h"
 
 
 /*----------------*
@@ -49,6 +50,25 @@ DiMonoOutputPixel::DiMonoOutputPixel(const DiMonoPixel *pixel,
 }
 
 
+DiMonoOutputPixel::DiMonoOutputPixel(const DiInputPixel *pixel,
+                                     const unsigned long size,
+                                     const unsigned long frame,
+                                     const unsigned long max)
+  : Count(0),
+    FrameSize(size),
+    UsedValues(NULL),
+    MaxValue(max)
+{
+    if (pixel != NULL)
+    {
+        if (pixel->getComputedCount() > frame * size)
+            Count = pixel->getComputedCount() - frame * size;  // number of pixels remaining for this 'frame'
+    }
+    if (Count > FrameSize)
+        Count = FrameSize;                                  // cut off at frame 'size'
+}
+
+
 /*--------------*
  *  destructor  *
  *--------------*/
@@ -0,0 +1,175 @@
+/*
+ *
+ *  Copyright (C) 2016, OFFIS e.V.
+ *  All rights reserved.  See COPYRIGHT file for details.
+ *
+ *  This software and supporting documentation were developed by
+ *
+ *    OFFIS e.V.
+ *    R&D Division Health
+ *    Escherweg 2
+ *    D-26121 Oldenburg, Germany
+ *
+ *
+ *  Module:  dcmimgle
+ *
+ *  Author:  OFFIS DICOM Team
+ *
+ *  Purpose: DicomParallelLoop (Source)
+ *
+ */
+
+
+#include "dcmtk/config/osconfig.h"
+
+#include "dcmtk/dcmimgle/diparlop.h"
+#include "dcmtk/dcmimgle/diutils.h"
+
+#ifdef WITH_THREADS
+#include "dcmtk/ofstd/ofthread.h"
+#endif
+
+
+#ifdef WITH_THREADS
+
+/*------------------------*
+ *  class implementation  *
+ *------------------------*/
+
+/** Thread processing one range of iterations of a parallel loop
+ */
+class DiParallelLoopThread
+  : public OFThread
+{
+
+ public:
+
+    /** constructor
+     *
+     ** @param  loop   parallel loop to be processed
+     *  @param  first  first iteration to be processed
+     *  @param  last   iteration after the last one to be processed
+     */
+    DiParallelLoopThread(DiParallelLoop *loop,
+                         const unsigned long first,
+                         const unsigned long last)
+      : OFThread(),
+        Loop(loop),
+        First(first),
+        Last(last),
+        Started(OFFalse)
+    {
+    }
+
+    /** start the thread, or process the range in the calling thread if the thread
+     *  could not be started
+     */
+    void startOrProcess()
+    {
+        Started = (start() == 0);
+        if (!Started)
+        {
+            DCMIMGLE_DEBUG("cannot create thread ... processing the pixel data in the calling thread");
+            Loop->processRange(First, Last);
+        }
+    }
+
+    /** wait until the thread has processed its range (if it has been started)
+     */
+    void wait()
+    {
+        if (Started)
+            join();
+    }
+
+
+ protected:
+
+    /** process the range of iterations
+     */
+    virtual void run()
+    {
+        Loop->processRange(First, Last);
+    }
+
+
+ private:
+
+    /// parallel loop to be processed
+    DiParallelLoop *Loop;
+    /// first iteration to be processed
+    const unsigned long First;
+    /// iteration after the last one to be processed
+    const unsigned long Last;
+    /// flag indicating whether the thread has been started
+    OFBool Started;
+
+ // --- declarations to avoid compiler warnings
+
+    DiParallelLoopThread(const DiParallelLoopThread &);
+    DiParallelLoopThread &operator=(const DiParallelLoopThread &);
+};
+
+#endif
+
+
+/*----------------*
+ *  constructors  *
+ *----------------*/
+
+DiParallelLoop::DiParallelLoop()
+{
+}
+
+
+/*--------------*
+ *  destructor  *
+ *--------------*/
+
+DiParallelLoop::~DiParallelLoop()
+{
+}
+
+
+/********************************************************************/
+
+
+void DiParallelLoop::run(const unsigned long count,
+                         const unsigned long pixels)
+{
+#ifdef WITH_THREADS
+    unsigned long threads = DicomImageClass::getNumberOfThreads();
+    if (threads > 1)
+    {
+        /* limit the number of threads so that each of them has enough work to do */
+        const double total = OFstatic_cast(double, count) * OFstatic_cast(double, (pixels > 0) ? pixels : 1);
+        const double maximum = total / DIPARLOP_MIN_PIXELS_PER_THREAD;
+        if (maximum < OFstatic_cast(double, threads))
+            threads = OFstatic_cast(unsigned long, maximum);
+        if (threads > count)
+            threads = count;
+    }
+    if (threads > 1)
+    {
+        DiParallelLoopThread **thread = new DiParallelLoopThread *[threads - 1];
+        unsigned long i;
+        /* ranges 1 to n-1 are processed by additional threads */
+        for (i = 1; i < threads; ++i)
+        {
+            thread[i - 1] = new DiParallelLoopThread(this, count / threads * i + count % threads * i / threads,
+                count / threads * (i + 1) + count % threads * (i + 1) / threads);
+            thread[i - 1]->startOrProcess();
+        }
+        /* range 0 is processed by the calling thread */
+        processRange(0, count / threads);
+        for (i = 0; i < threads - 1; ++i)
+        {
+            thread[i]->wait();
+            delete thread[i];
+        }
+        delete[] thread;
+        return;
+    }
+#endif
+    processRange(0, count);
+}
@@ -0,0 +1,462 @@
+/*
+ *
+ *  Copyright (C) 2016, OFFIS e.V.
+ *  All rights reserved.  See COPYRIGHT file for details.
+ *
+ *  This software and supporting documentation were developed by
+ *
+ *    OFFIS e.V.
+ *    R&D Division Health
+ *    Escherweg 2
+ *    D-26121 Oldenburg, Germany
+ *
+ *
+ *  Module:  dcmimgle
+ *
+ *  Author:  OFFIS DICOM Team
+ *
+ *  Purpose: DicomResampleFilter (Source)
+ *
+ */
+
+
+#include "dcmtk/config/osconfig.h"
+
+#include "dcmtk/dcmimgle/diresamp.h"
+#include "dcmtk/ofstd/ofbmanip.h"
+
+#define INCLUDE_CMATH
+#include "dcmtk/ofstd/ofstdinc.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2))
+#define DIRESAMP_USE_SSE2
+#include <emmintrin.h>
+#endif
+
+
+/*---------------------*
+ *  macro definitions  *
+ *---------------------*/
+
+/// number of lobes of the Lanczos filter
+#define DIRESAMP_LANCZOS_LOBES 3
+
+/// the constant pi
+#define DIRESAMP_PI 3.14159265358979323846
+
+
+/*--------------------*
+ *  helper functions  *
+ *--------------------*/
+
+/** Lanczos filter kernel, i.e. sinc(x) * sinc(x / lobes) for |x| < lobes, 0 otherwise
+ */
+static double lanczosKernel(const double x)
+{
+    if (x == 0.0)
+        return 1.0;
+    if ((x <= -DIRESAMP_LANCZOS_LOBES) || (x >= DIRESAMP_LANCZOS_LOBES))
+        return 0.0;
+    const double px = DIRESAMP_PI * x;
+    return DIRESAMP_LANCZOS_LOBES * sin(px) * sin(px / DIRESAMP_LANCZOS_LOBES) / (px * px);
+}
+
+
+#ifdef DIRESAMP_USE_SSE2
+
+/*------------------*
+ *  SSE2 functions  *
+ *------------------*/
+
+/** convert eight unsigned 8 bit pixel values to two vectors of floating point values
+ */
+static inline void convertPixels(const Uint8 *pixel,
+                                 __m128 &lower,
+                                 __m128 &upper)
+{
+    const __m128i value = _mm_unpacklo_epi8(_mm_loadl_epi64(OFreinterpret_cast(const __m128i *, pixel)), _mm_setzero_si128());
+    lower = _mm_cvtepi32_ps(_mm_unpacklo_epi16(value, _mm_setzero_si128()));
+    upper = _mm_cvtepi32_ps(_mm_unpackhi_epi16(value, _mm_setzero_si128()));
+}
+
+
+/** convert eight signed 8 bit pixel values to two vectors of floating point values
+ */
+static inline void convertPixels(const Sint8 *pixel,
+                                 __m128 &lower,
+                                 __m128 &upper)
+{
+    __m128i value = _mm_loadl_epi64(OFreinterpret_cast(const __m128i *, pixel));
+    value = _mm_srai_epi16(_mm_unpacklo_epi8(value, value), 8);
+    lower = _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(value, value), 16));
+    upper = _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpackhi_epi16(value, value), 16));
+}
+
+
+/** convert eight unsigned 16 bit pixel values to two vectors of floating point values
+ */
+static inline void convertPixels(const Uint16 *pixel,
+                                 __m128 &lower,
+                                 __m128 &upper)
+{
+    const __m128i value = _mm_loadu_si128(OFreinterpret_cast(const __m128i *, pixel));
+    lower = _mm_cvtepi32_ps(_mm_unpacklo_epi16(value, _mm_setzero_si128()));
+    upper = _mm_cvtepi32_ps(_mm_unpackhi_epi16(value, _mm_setzero_si128()));
+}
+
+
+/** convert eight signed 16 bit pixel values to two vectors of floating point values
+ */
+static inline void convertPixels(const Sint16 *pixel,
+                                 __m128 &lower,
+                                 __m128 &upper)
+{
+    const __m128i value = _mm_loadu_si128(OFreinterpret_cast(const __m128i *, pixel));
+    lower = _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(value, value), 16));
+    upper = _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpackhi_epi16(value, value), 16));
+}
+
+
+/** compute the weighted sum of several rows for all complete blocks of eight pixels.
+ *  Up to four rows are processed at once in order to reduce the accesses to the buffer.
+ *
+ ** @return number of pixels processed
+ */
+template<class T>
+static unsigned long accumulateRowsSSE2(const T *pixel,
+                                        const unsigned long stride,
+                                        const float *weights,
+                                        const unsigned long rows,
+                                        float *buffer,
+                                        const unsigned long count)
+{
+    const unsigned long blocks = count / 8;
+    __m128 weight[4];
+    __m128 lower;
+    __m128 upper;
+    __m128 sumLower;
+    __m128 sumUpper;
+    const T *p;
+    float *q;
+    unsigned long i;
+    unsigned long j;
+    unsigned long n;
+    for (unsigned long k = 0; k < rows; k += n)
+    {
+        n = (rows - k > 4) ? 4 : rows - k;
+        for (j = 0; j < n; ++j)
+            weight[j] = _mm_set1_ps(weights[k + j]);
+        p = pixel + k * stride;
+        q = buffer;
+        for (i = blocks; i != 0; --i)
+        {
+            if (k == 0)
+            {
+                sumLower = _mm_setzero_ps();
+                sumUpper = _mm_setzero_ps();
+            } else {
+                sumLower = _mm_loadu_ps(q);
+                sumUpper = _mm_loadu_ps(q + 4);
+            }
+            for (j = 0; j < n; ++j)
+            {
+                convertPixels(p + j * stride, lower, upper);
+                sumLower = _mm_add_ps(sumLower, _mm_mul_ps(weight[j], lower));
+                sumUpper = _mm_add_ps(sumUpper, _mm_mul_ps(weight[j], upper));
+            }
+            _mm_storeu_ps(q, sumLower);
+            _mm_storeu_ps(q + 4, sumUpper);
+            p += 8;
+            q += 8;
+        }
+    }
+    return (rows > 0) ? blocks * 8 : 0;
+}
+
+#endif
+
+
+/*----------------*
+ *  constructors  *
+ *----------------*/
+
+DiResampleFilter::DiResampleFilter(const ER_ResampleFilter filter,
+                                   const Uint16 src_size,
+                                   const Uint16 dest_size,
+                                   const signed long offset,
+                                   const Uint16 limit)
+  : Size(dest_size),
+    Taps(0),
+    FirstPosition(0),
+    PositionCount(0),
+    Start(NULL),
+    Count(NULL),
+    Outside(NULL),
+    Weights(NULL),
+    PreciseWeights(NULL)
+{
+    if ((src_size > 0) && (dest_size > 0))
+    {
+        const double factor = OFstatic_cast(double, src_size) / OFstatic_cast(double, dest_size);
+        const double stretch = (factor > 1.0) ? factor : 1.0;
+        /* determine maximum number of source positions contributing to a destination position */
+        unsigned long maximum;
+        if (filter == ERF_Lanczos)
+            maximum = 2 * OFstatic_cast(unsigned long, ceil(DIRESAMP_LANCZOS_LOBES * stretch)) + 2;
+        else
+            maximum = OFstatic_cast(unsigned long, ceil(factor)) + 2;
+        Taps = (maximum + DIRESAMP_BLOCK_SIZE - 1) / DIRESAMP_BLOCK_SIZE * DIRESAMP_BLOCK_SIZE;
+        Start = new unsigned long[Size];
+        Count = new unsigned long[Size];
+        Outside = new double[Size];
+        Weights = new float[OFstatic_cast(unsigned long, Size) * Taps];
+        PreciseWeights = new double[OFstatic_cast(unsigned long, Size) * Taps];
+        double *weights = new double[Taps];
+        if ((Start != NULL) && (Count != NULL) && (Outside != NULL) && (Weights != NULL) && (PreciseWeights != NULL) && (weights != NULL))
+        {
+            OFBitmanipTemplate<float>::zeroMem(Weights, OFstatic_cast(unsigned long, Size) * Taps);
+            OFBitmanipTemplate<double>::zeroMem(PreciseWeights, OFstatic_cast(unsigned long, Size) * Taps);
+            signed long lowest = limit;
+            signed long highest = 0;
+            signed long first;
+            signed long coord;
+            unsigned long i;
+            unsigned long n;
+            double sum;
+            double outside;
+            float *w;
+            double *pw;
+            for (Uint16 pos = 0; pos < Size; ++pos)
+            {
+                n = computeWeights(filter, pos, factor, src_size, weights, first);
+                sum = 0;
+                for (i = 0; i < n; ++i)
+                    sum += weights[i];
+                if (sum == 0.0)
+                    sum = 1.0;
+                /* store normalized weights of the source positions inside the image */
+                w = Weights + OFstatic_cast(unsigned long, pos) * Taps;
+                pw = PreciseWeights + OFstatic_cast(unsigned long, pos) * Taps;
+                outside = 0;
+                Start[pos] = 0;
+                Count[pos] = 0;
+                for (i = 0; i < n; ++i)
+                {
+                    coord = offset + first + OFstatic_cast(signed long, i);
+                    if ((coord < 0) || (coord >= OFstatic_cast(signed long, limit)))
+                        outside += weights[i] / sum;
+                    else
+                    {
+                        if (Count[pos] == 0)
+                            Start[pos] = OFstatic_cast(unsigned long, coord);
+                        pw[Count[pos]] = weights[i] / sum;
+                        w[Count[pos]] = OFstatic_cast(float, pw[Count[pos]]);
+                        ++Count[pos];
+                    }
+                }
+                Outside[pos] = outside;
+                if (Count[pos] > 0)
+                {
+                    if (OFstatic_cast(signed long, Start[pos]) < lowest)
+                        lowest = OFstatic_cast(signed long, Start[pos]);
+                    if (OFstatic_cast(signed long, Start[pos] + Count[pos]) > highest)
+                        highest = OFstatic_cast(signed long, Start[pos] + Count[pos]);
+                }
+            }
+            /* make start positions relative to the first source position accessed */
+            if (highest > lowest)
+            {
+                FirstPosition = OFstatic_cast(unsigned long, lowest);
+                PositionCount = OFstatic_cast(unsigned long, highest - lowest);
+                for (Uint16 pos = 0; pos < Size; ++pos)
+                {
+                    if (Count[pos] > 0)
+                        Start[pos] -= FirstPosition;
+                }
+            }
+        } else {
+            delete[] Weights;
+            Weights = NULL;
+        }
+        delete[] weights;
+    }
+}
+
+
+/*--------------*
+ *  destructor  *
+ *--------------*/
+
+DiResampleFilter::~DiResampleFilter()
+{
+    delete[] Start;
+    delete[] Count;
+    delete[] Outside;
+    delete[] Weights;
+    delete[] PreciseWeights;
+}
+
+
+/********************************************************************/
+
+
+unsigned long DiResampleFilter::computeWeights(const ER_ResampleFilter filter,
+                                               const Uint16 pos,
+                                               const double factor,
+                                               const Uint16 src_size,
+                                               double *weights,
+                                               signed long &first) const
+{
+    signed long begin;
+    signed long end;
+    signed long i;
+    if (filter == ERF_Lanczos)
+    {
+        /* weights are given by the (stretched) filter kernel centered on the destination position */
+        const double stretch = (factor > 1.0) ? factor : 1.0;
+        const double support = DIRESAMP_LANCZOS_LOBES * stretch;
+        const double center = (OFstatic_cast(double, pos) + 0.5) * factor;
+        begin = OFstatic_cast(signed long, floor(center - support));
+        end = OFstatic_cast(signed long, ceil(center + support));
+        if (begin < 0)
+            begin = 0;
+        if (end > OFstatic_cast(signed long, src_size))
+            end = src_size;
+        for (i = begin; i < end; ++i)
+            weights[i - begin] = lanczosKernel((OFstatic_cast(double, i) + 0.5 - center) / stretch);
+    } else {
+        /* weights are given by the overlap of the source and destination pixel areas */
+        const double left = OFstatic_cast(double, pos) * factor;
+        double right = (OFstatic_cast(double, pos) + 1.0) * factor;
+        if (right > src_size)
+            right = src_size;
+        begin = OFstatic_cast(signed long, floor(left));
+        end = OFstatic_cast(signed long, ceil(right));
+        if (end > OFstatic_cast(signed long, src_size))
+            end = src_size;
+        if (begin >= end)
+            begin = end - 1;
+        double overlap;
+        for (i = begin; i < end; ++i)
+        {
+            overlap = ((right < i + 1) ? right : i + 1) - ((left > i) ? left : i);
+            weights[i - begin] = (overlap > 0.0) ? overlap : 0.0;
+        }
+    }
+    first = begin;
+    return OFstatic_cast(unsigned long, end - begin);
+}
+
+
+void DiResampleFilter::filterRow(const float *row,
+                                 float *output) const
+{
+    const float *p;
+    const float *w;
+    unsigned long i;
+    float *q = output;
+    for (Uint16 pos = 0; pos < Size; ++pos)
+    {
+        p = row + Start[pos];
+        w = Weights + OFstatic_cast(unsigned long, pos) * Taps;
+#ifdef DIRESAMP_USE_SSE2
+        /* the weight table is padded with 0, the row buffer by 'Taps' entries */
+        __m128 sum = _mm_setzero_ps();
+        for (i = (Count[pos] + DIRESAMP_BLOCK_SIZE - 1) / DIRESAMP_BLOCK_SIZE; i != 0; --i)
+        {
+            sum = _mm_add_ps(sum, _mm_mul_ps(_mm_loadu_ps(p), _mm_loadu_ps(w)));
+            p += DIRESAMP_BLOCK_SIZE;
+            w += DIRESAMP_BLOCK_SIZE;
+        }
+        sum = _mm_add_ps(sum, _mm_movehl_ps(sum, sum));
+        sum = _mm_add_ss(sum, _mm_shuffle_ps(sum, sum, 1));
+        _mm_store_ss(q++, sum);
+#else
+        float sum = 0;
+        for (i = Count[pos]; i != 0; --i)
+            sum += *(p++) * *(w++);
+        *(q++) = sum;
+#endif
+    }
+}
+
+
+void DiResampleFilter::filterRow(const double *row,
+                                 double *output) const
+{
+    const double *p;
+    const double *w;
+    unsigned long i;
+    double sum;
+    double *q = output;
+    for (Uint16 pos = 0; pos < Size; ++pos)
+    {
+        p = row + Start[pos];
+        w = PreciseWeights + OFstatic_cast(unsigned long, pos) * Taps;
+        sum = 0;
+        for (i = Count[pos]; i != 0; --i)
+            sum += *(p++) * *(w++);
+        *(q++) = sum;
+    }
+}
+
+
+void DiResampleFilter::accumulateRows(const Uint8 *pixel,
+                                      const unsigned long stride,
+                                      const float *weights,
+                                      const unsigned long rows,
+                                      float *buffer,
+                                      const unsigned long count)
+{
+    unsigned long done = 0;
+#ifdef DIRESAMP_USE_SSE2
+    done = accumulateRowsSSE2(pixel, stride, weights, rows, buffer, count);
+#endif
+    accumulateRows<Uint8>(pixel + done, stride, weights, rows, buffer + done, count - done);
+}
+
+
+void DiResampleFilter::accumulateRows(const Sint8 *pixel,
+                                      const unsigned long stride,
+                                      const float *weights,
+                                      const unsigned long rows,
+                                      float *buffer,
+                                      const unsigned long count)
+{
+    unsigned long done = 0;
+#ifdef DIRESAMP_USE_SSE2
+    done = accumulateRowsSSE2(pixel, stride, weights, rows, buffer, count);
+#endif
+    accumulateRows<Sint8>(pixel + done, stride, weights, rows, buffer + done, count - done);
+}
+
+
+void DiResampleFilter::accumulateRows(const Uint16 *pixel,
+                                      const unsigned long stride,
+                                      const float *weights,
+                                      const unsigned long rows,
+                                      float *buffer,
+                                      const unsigned long count)
+{
+    unsigned long done = 0;
+#ifdef DIRESAMP_USE_SSE2
+    done = accumulateRowsSSE2(pixel, stride, weights, rows, buffer, count);
+#endif
+    accumulateRows<Uint16>(pixel + done, stride, weights, rows, buffer + done, count - done);
+}
+
+
+void DiResampleFilter::accumulateRows(const Sint16 *pixel,
+                                      const unsigned long stride,
+                                      const float *weights,
+                                      const unsigned long rows,
+                                      float *buffer,
+                                      const unsigned long count)
+{
+    unsigned long done = 0;
+#ifdef DIRESAMP_USE_SSE2
+    done = accumulateRowsSSE2(pixel, stride, weights, rows, buffer, count);
+#endif
+    accumulateRows<Sint16>(pixel + done, stride, weights, rows, buffer + done, count - done);
+}
+
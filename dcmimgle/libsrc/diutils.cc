@@ -38,6 +38,13 @@
 OFLogger DCM_dcmimgleLogger = OFLog::getLogger("dcmtk.dcmimgle");
 
 
+/*--------------------*
+ *  static variables  *
+ *--------------------*/
+
+unsigned int DicomImageClass::NumberOfThreads = 1;
+
+
 /*------------------------*
  *  function definitions  *
  *------------------------*/
@@ -136,3 +143,20 @@ EP_Representation DicomImageClass::determineRepresentation(double minvalue,
 #endif
     return EPR_Uint32;
 }
+
+
+void DicomImageClass::setNumberOfThreads(const unsigned int threads)
+{
+#ifdef WITH_THREADS
+    NumberOfThreads = (threads > 0) ? threads : 1;
+#else
+    if (threads > 1)
+        DCMIMGLE_WARN("toolkit compiled without thread support ... ignoring number of threads");
+#endif
+}
+
+
+unsigned int DicomImageClass::getNumberOfThreads()
+{
+    return NumberOfThreads;
+}
@@ -0,0 +1,182 @@
+/*
+ *
+ *  Copyright (C) 2016, OFFIS e.V.
+ *  All rights reserved.  See COPYRIGHT file for details.
+ *
+ *  This software and supporting documentation were developed by
+ *
+ *    OFFIS e.V.
+ *    R&D Division Health
+ *    Escherweg 2
+ *    D-26121 Oldenburg, Germany
+ *
+ *
+ *  Module:  dcmimgle
+ *
+ *  Author:  OFFIS DICOM Team
+ *
+ *  Purpose: DicomWindowKernel (Source)
+ *
+ */
+
+
+#include "dcmtk/config/osconfig.h"
+
+#include "dcmtk/dcmimgle/diwinkrn.h"
+
+#define INCLUDE_CMATH
+#include "dcmtk/ofstd/ofstdinc.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2))
+#define DIWINKRN_USE_SSE2
+#include <emmintrin.h>
+#endif
+
+
+#ifdef DIWINKRN_USE_SSE2
+
+/*------------------*
+ *  SSE2 functions  *
+ *------------------*/
+
+/** convert a window border to an integer value, so that for all 16 bit pixel values
+ *  'value <= border' is equivalent to 'value <= result'
+ */
+static Sint32 integerBorder(const double border)
+{
+    if (border < -65537.0)
+        return -65537;
+    if (border > 65536.0)
+        return 65536;
+    return OFstatic_cast(Sint32, floor(border));
+}
+
+
+/** extend eight signed 16 bit pixel values to two vectors of 32 bit values
+ */
+static inline void expandPixels(const Sint16 *pixel,
+                                __m128i &lower,
+                                __m128i &upper)
+{
+    const __m128i value = _mm_loadu_si128(OFreinterpret_cast(const __m128i *, pixel));
+    lower = _mm_srai_epi32(_mm_unpacklo_epi16(value, value), 16);
+    upper = _mm_srai_epi32(_mm_unpackhi_epi16(value, value), 16);
+}
+
+
+/** extend eight unsigned 16 bit pixel values to two vectors of 32 bit values
+ */
+static inline void expandPixels(const Uint16 *pixel,
+                                __m128i &lower,
+                                __m128i &upper)
+{
+    const __m128i value = _mm_loadu_si128(OFreinterpret_cast(const __m128i *, pixel));
+    lower = _mm_unpacklo_epi16(value, _mm_setzero_si128());
+    upper = _mm_unpackhi_epi16(value, _mm_setzero_si128());
+}
+
+
+/** transform four pixel values, computing the linear function in double precision
+ *  (like the generic version) and selecting the output values left and right of the window
+ */
+static inline __m128i transformPixels(const __m128i value,
+                                      const __m128i left,
+                                      const __m128i right,
+                                      const __m128d offset,
+                                      const __m128d gradient,
+                                      const __m128i low,
+                                      const __m128i high)
+{
+    const __m128d value0 = _mm_cvtepi32_pd(value);
+    const __m128d value1 = _mm_cvtepi32_pd(_mm_shuffle_epi32(value, 0xee));
+    const __m128i gray0 = _mm_cvttpd_epi32(_mm_add_pd(offset, _mm_mul_pd(value0, gradient)));
+    const __m128i gray1 = _mm_cvttpd_epi32(_mm_add_pd(offset, _mm_mul_pd(value1, gradient)));
+    __m128i result = _mm_unpacklo_epi64(gray0, gray1);
+    const __m128i isLow = _mm_cmplt_epi32(value, left);                 // value <= left border
+    const __m128i isHigh = _mm_cmpgt_epi32(value, right);               // value > right border
+    result = _mm_or_si128(_mm_andnot_si128(isLow, result), _mm_and_si128(isLow, low));
+    result = _mm_or_si128(_mm_andnot_si128(isHigh, result), _mm_and_si128(isHigh, high));
+    return result;
+}
+
+
+/** apply the linear VOI window transformation to all complete blocks of eight pixels
+ *
+ ** @return number of pixels processed
+ */
+template<class T1>
+static unsigned long applySSE2(const T1 *pixel,
+                               Uint8 *output,
+                               const unsigned long count,
+                               const double leftBorder,
+                               const double rightBorder,
+                               const double offset,
+                               const double gradient,
+                               const Uint8 low,
+                               const Uint8 high)
+{
+    const __m128i left = _mm_set1_epi32(integerBorder(leftBorder) + 1);
+    const __m128i right = _mm_set1_epi32(integerBorder(rightBorder));
+    const __m128d offset2 = _mm_set1_pd(offset);
+    const __m128d gradient2 = _mm_set1_pd(gradient);
+    const __m128i low4 = _mm_set1_epi32(low);
+    const __m128i high4 = _mm_set1_epi32(high);
+    const T1 *p = pixel;
+    Uint8 *q = output;
+    __m128i lower;
+    __m128i upper;
+    unsigned long i;
+    for (i = count / 8; i != 0; --i)
+    {
+        expandPixels(p, lower, upper);
+        // output values are within the range of Uint8, so saturation does not change them
+        const __m128i result = _mm_packs_epi32(transformPixels(lower, left, right, offset2, gradient2, low4, high4),
+                                               transformPixels(upper, left, right, offset2, gradient2, low4, high4));
+        _mm_storel_epi64(OFreinterpret_cast(__m128i *, q), _mm_packus_epi16(result, result));
+        p += 8;
+        q += 8;
+    }
+    return count - count % 8;
+}
+
+#endif
+
+
+/*------------------*
+ *  public methods  *
+ *------------------*/
+
+void DiWindowKernel::apply(const Uint16 *pixel,
+                           Uint8 *output,
+                           const unsigned long count,
+                           const double leftBorder,
+                           const double rightBorder,
+                           const double offset,
+                           const double gradient,
+                           const Uint8 low,
+                           const Uint8 high)
+{
+    unsigned long done = 0;
+#ifdef DIWINKRN_USE_SSE2
+    done = applySSE2(pixel, output, count, leftBorder, rightBorder, offset, gradient, low, high);
+#endif
+    apply<Uint16, Uint8>(pixel + done, output + done, count - done, leftBorder, rightBorder, offset, gradient, low, high);
+}
+
+
+void DiWindowKernel::apply(const Sint16 *pixel,
+                           Uint8 *output,
+                           const unsigned long count,
+                           const double leftBorder,
+                           const double rightBorder,
+                           const double offset,
+                           const double gradient,
+                           const Uint8 low,
+                           const Uint8 high)
+{
+    unsigned long done = 0;
+#ifdef DIWINKRN_USE_SSE2
+    done = applySSE2(pixel, output, count, leftBorder, rightBorder, offset, gradient, low, high);
+#endif
+    apply<Sint16, Uint8>(pixel + done, output + done, count - done, leftBorder, rightBorder, offset, gradient, low, high);
+}
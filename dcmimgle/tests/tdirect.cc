@@ -0,0 +1,195 @@
+/*
+ *
+ *  Copyright (C) 2016, OFFIS e.V.
+ *  All rights reserved.  See COPYRIGHT file for details.
+ *
+ *  This software and supporting documentation were developed by
+ *
+ *    OFFIS e.V.
+ *    R&D Division Health
+ *    Escherweg 2
+ *    D-26121 Oldenburg, Germany
+ *
+ *
+ *  Module:  dcmimgle
+ *
+ *  Author:  OFFIS DICOM Team
+ *
+ *  Purpose: test that rendering a monochrome image directly from the stored
+ *           pixel values gives the same output as the usual rendering
+ *
+ */
+
+
+#include "dcmtk/config/osconfig.h"    /* make sure OS specific configuration is included first */
+
+#define INCLUDE_CSTDLIB
+#include "dcmtk/ofstd/ofstdinc.h"
+
+#include "dcmtk/dcmimgle/diutils.h"
+#include "timghelp.h"
+
+#define NUM_THREADS 4
+
+
+/* parameters of a test image, the frames contain more pixels than possible stored values */
+struct TestImage
+{
+    const char *description;
+    Uint16 rows;
+    Uint16 columns;
+    unsigned long frames;
+    int bits;
+    OFBool isSigned;
+    /// rescale slope and intercept (NULL if absent)
+    const char *slope;
+    const char *intercept;
+};
+
+static const TestImage testImages[] =
+{
+    { "unsigned 16 bit", 256, 256, 1, 16, OFFalse, NULL, NULL },
+    { "signed 16 bit, multiframe, rescaled", 256, 257, 2, 16, OFTrue, "2", "-1024" },
+    { "unsigned 12 bit, multiframe", 64, 67, 3, 12, OFFalse, NULL, NULL },
+    { "signed 12 bit, rescaled", 65, 64, 1, 12, OFTrue, "0.5", "10" },
+    { "unsigned 8 bit, multiframe", 16, 17, 2, 8, OFFalse, "1", "-100" },
+    { "signed 10 bit", 32, 33, 1, 10, OFTrue, NULL, NULL }
+};
+
+#define ARRAY_SIZE(a) (sizeof(a) / sizeof(a[0]))
+
+
+/* render the given frame to 16 bit output data and append it to the list of outputs */
+static void render16(DicomImage &image,
+                     const unsigned long frame,
+                     OFVector<OFVector<Uint8> > &outputs)
+{
+    OFVector<Uint8> output(image.getOutputDataSize(16));
+    OFCHECK(image.getOutputData(&output[0], output.size(), 16, frame) != 0);
+    outputs.push_back(output);
+}
+
+/* render all frames of the test image with several VOI transformations and presentation
+ * LUTs and append the output data to 'outputs'. The range of modality values is computed
+ * from the parameters (and not determined from the image) in order to keep the image in
+ * the state that allows for direct rendering.
+ */
+static void renderAll(DcmDataset &dset,
+                      const TestImage &test,
+                      const unsigned long flags,
+                      OFVector<OFVector<Uint8> > &outputs)
+{
+    DicomImage image(&dset, EXS_LittleEndianExplicit, flags);
+    OFCHECK_EQUAL(image.getStatus(), EIS_Normal);
+    if (image.getStatus() != EIS_Normal)
+        return;
+    const double slope = (test.slope != NULL) ? atof(test.slope) : 1;
+    const double intercept = (test.intercept != NULL) ? atof(test.intercept) : 0;
+    const double storedMin = test.isSigned ? -OFstatic_cast(double, 1UL << (test.bits - 1)) : 0;
+    const double minValue = storedMin * slope + intercept;
+    const double range = OFstatic_cast(double, (1UL << test.bits) - 1) * slope;
+    DcmUnsignedShort voiData(DcmTag(DCM_LUTData, EVR_US));
+    DcmUnsignedShort voiDescriptor(DcmTag(DCM_LUTDescriptor, EVR_US));
+    imgMakeLut(voiData, voiDescriptor, 1000, OFstatic_cast(Sint16, minValue + range / 3), 12);
+    DcmUnsignedShort presentationData(DcmTag(DCM_LUTData, EVR_US));
+    DcmUnsignedShort presentationDescriptor(DcmTag(DCM_LUTDescriptor, EVR_US));
+    imgMakeLut(presentationData, presentationDescriptor, 256, 0, 10);
+    OFVector<Uint8> output;
+    for (unsigned long frame = 0; frame < test.frames; ++frame)
+    {
+        // no VOI transformation
+        OFCHECK(imgRender(image, output, frame));
+        outputs.push_back(output);
+        // windows with pixels outside on both sides, and normal and inverse polarity
+        OFCHECK(image.setWindow(minValue + range / 2, range / 4));
+        OFCHECK(imgRender(image, output, frame));
+        outputs.push_back(output);
+        render16(image, frame, outputs);
+        OFCHECK(image.setPolarity(EPP_Reverse));
+        OFCHECK(imgRender(image, output, frame));
+        outputs.push_back(output);
+        OFCHECK(image.setPolarity(EPP_Normal));
+        // very small windows, and windows completely outside the range of values
+        OFCHECK(image.setWindow(minValue + range / 8, 3));
+        OFCHECK(imgRender(image, output, frame));
+        outputs.push_back(output);
+        OFCHECK(image.setWindow(minValue + range / 3, 1));
+        OFCHECK(imgRender(image, output, frame));
+        outputs.push_back(output);
+        OFCHECK(image.setWindow(minValue - range, range / 2));
+        OFCHECK(imgRender(image, output, frame));
+        outputs.push_back(output);
+        OFCHECK(image.setWindow(minValue + 2 * range, range / 2));
+        OFCHECK(imgRender(image, output, frame));
+        outputs.push_back(output);
+        // VOI LUT (window is disabled)
+        OFCHECK(image.setVoiLut(voiData, voiDescriptor));
+        OFCHECK(imgRender(image, output, frame));
+        outputs.push_back(output);
+        render16(image, frame, outputs);
+        // window and presentation LUT, and inverse presentation LUT shape
+        OFCHECK(image.setWindow(minValue + range / 2, range / 2));
+        OFCHECK(image.setPresentationLut(presentationData, presentationDescriptor));
+        OFCHECK(imgRender(image, output, frame));
+        outputs.push_back(output);
+        render16(image, frame, outputs);
+        OFCHECK(image.setPresentationLutShape(ESP_Inverse));
+        OFCHECK(imgRender(image, output, frame));
+        outputs.push_back(output);
+        OFCHECK(image.setPresentationLutShape(ESP_Default));
+        OFCHECK(image.setNoVoiTransformation());
+    }
+    // a scaled copy requires the intermediate representation, which is then used for rendering
+    OFCHECK(image.setWindow(minValue + range / 2, range / 4));
+    DicomImage *scaled = image.createScaledImage(0.5, 0.5);
+    OFCHECK(scaled != NULL);
+    if (scaled != NULL)
+    {
+        OFCHECK(imgRender(*scaled, output));
+        outputs.push_back(output);
+        delete scaled;
+    }
+    OFCHECK(imgRender(image, output, test.frames - 1));
+    outputs.push_back(output);
+}
+
+
+OFTEST(dcmimgle_directRendering)
+{
+    for (size_t t = 0; t < ARRAY_SIZE(testImages); ++t)
+    {
+        const TestImage &test = testImages[t];
+        OFVector<Uint16> pixels;
+        imgMakePixels(pixels, OFstatic_cast(unsigned long, test.rows) * test.columns * test.frames, test.bits);
+        DcmDataset dset;
+        imgMakeDataset(dset, test.rows, test.columns, test.frames, test.bits, test.isSigned, pixels);
+        if (test.slope != NULL)
+            dset.putAndInsertString(DCM_RescaleSlope, test.slope);
+        if (test.intercept != NULL)
+            dset.putAndInsertString(DCM_RescaleIntercept, test.intercept);
+        // the usual rendering with a single thread is the reference
+        OFVector<OFVector<Uint8> > expected;
+        DicomImageClass::setNumberOfThreads(1);
+        renderAll(dset, test, 0, expected);
+        for (int threads = 1; threads <= NUM_THREADS; threads += NUM_THREADS - 1)
+        {
+            DicomImageClass::setNumberOfThreads(threads);
+            for (int direct = 0; direct < 2; ++direct)
+            {
+                OFVector<OFVector<Uint8> > outputs;
+                renderAll(dset, test, direct ? CIF_CreateIntermediateDataOnDemand : 0, outputs);
+                OFCHECK_EQUAL(expected.size(), outputs.size());
+                for (size_t i = 0; (i < expected.size()) && (i < outputs.size()); ++i)
+                {
+                    OFOStringStream stream;
+                    stream << test.description << (direct ? ", direct rendering" : "") << ", " << threads
+                           << " thread(s), output " << i << OFStringStream_ends;
+                    OFSTRINGSTREAM_GETSTR(stream, message)
+                    imgCompare(expected[i], outputs[i], message);
+                    OFSTRINGSTREAM_FREESTR(message)
+                }
+            }
+        }
+        DicomImageClass::setNumberOfThreads(1);
+    }
+}
@@ -0,0 +1,134 @@
+/*
+ *
+ *  Copyright (C) 2016, OFFIS e.V.
+ *  All rights reserved.  See COPYRIGHT file for details.
+ *
+ *  This software and supporting documentation were developed by
+ *
+ *    OFFIS e.V.
+ *    R&D Division Health
+ *    Escherweg 2
+ *    D-26121 Oldenburg, Germany
+ *
+ *
+ *  Module:  dcmimgle
+ *
+ *  Author:  OFFIS DICOM Team
+ *
+ *  Purpose: test the sharing of display LUTs between display functions with
+ *           identical properties
+ *
+ */
+
+
+#include "dcmtk/config/osconfig.h"    /* make sure OS specific configuration is included first */
+
+#define INCLUDE_CSTRING
+#include "dcmtk/ofstd/ofstdinc.h"
+
+#include "dcmtk/ofstd/oftest.h"
+#include "dcmtk/ofstd/ofvector.h"
+#include "dcmtk/dcmimgle/digsdfn.h"
+#include "dcmtk/dcmimgle/didlcach.h"
+#include "dcmtk/dcmimgle/didislut.h"
+
+#define NUM_BITS 8
+
+
+/* display function that is deleted during program termination, i.e. it releases its LUT
+ * after the static objects of the library might have been destroyed
+ */
+class StaticDisplayFunction
+{
+
+ public:
+
+    StaticDisplayFunction()
+      : Function(NULL)
+    {
+    }
+
+    ~StaticDisplayFunction()
+    {
+        delete Function;
+    }
+
+    DiDisplayFunction *Function;
+
+ private:
+
+    // --- declarations to avoid compiler warnings
+
+    StaticDisplayFunction(const StaticDisplayFunction &);
+    StaticDisplayFunction &operator=(const StaticDisplayFunction &);
+};
+
+static StaticDisplayFunction staticDisplayFunction;
+
+
+/* copy the values of the given LUT */
+static void copyValues(const DiDisplayLUT *lut,
+                       OFVector<Uint16> &values)
+{
+    values.clear();
+    if (lut != NULL)
+    {
+        for (Uint32 i = 0; i < lut->getCount(); ++i)
+            values.push_back(lut->getValue(i));
+    }
+}
+
+/* check whether the given values are identical */
+static OFBool sameValues(const OFVector<Uint16> &values1,
+                         const OFVector<Uint16> &values2)
+{
+    return (values1.size() == values2.size()) && !values1.empty() &&
+        (memcmp(&values1[0], &values2[0], values1.size() * sizeof(Uint16)) == 0);
+}
+
+
+OFTEST(dcmimgle_displayLUTCache)
+{
+    DiDisplayLUTCache::clear();
+    OFCHECK_EQUAL(DiDisplayLUTCache::getNumberOfEntries(), 0);
+    // two display functions with the same properties share one LUT
+    DiDisplayFunction *first = new DiGSDFunction(0.5, 300);
+    DiGSDFunction second(0.5, 300);
+    OFCHECK(first->isValid());
+    OFCHECK(second.isValid());
+    const DiDisplayLUT *lut = first->getLookupTable(NUM_BITS);
+    OFCHECK(lut != NULL);
+    OFCHECK(second.getLookupTable(NUM_BITS) == lut);
+    OFCHECK_EQUAL(DiDisplayLUTCache::getNumberOfEntries(), 1);
+    OFVector<Uint16> values;
+    copyValues(lut, values);
+    OFCHECK_EQUAL(values.size(), 1UL << NUM_BITS);
+    // releasing the LUT by one of them keeps it valid for the other one
+    delete first;
+    OFCHECK_EQUAL(DiDisplayLUTCache::getNumberOfEntries(), 1);
+    DiDisplayLUTCache::setMaximumUnusedEntries(0);
+    OFCHECK_EQUAL(DiDisplayLUTCache::getNumberOfEntries(), 1);
+    OFCHECK(second.getLookupTable(NUM_BITS) == lut);
+    OFVector<Uint16> current;
+    copyValues(lut, current);
+    OFCHECK(sameValues(current, values));
+    // a display function with different properties gets a different LUT
+    DiGSDFunction third(0.5, 300);
+    OFCHECK(third.setAmbientLightValue(10));
+    const DiDisplayLUT *other = third.getLookupTable(NUM_BITS);
+    OFCHECK(other != NULL);
+    OFCHECK(other != lut);
+    OFCHECK_EQUAL(DiDisplayLUTCache::getNumberOfEntries(), 2);
+    copyValues(other, current);
+    OFCHECK(!sameValues(current, values));
+    // LUTs that are no longer used are deleted (depending on the maximum number of unused entries)
+    OFCHECK(third.deleteLookupTable(NUM_BITS));
+    OFCHECK_EQUAL(DiDisplayLUTCache::getNumberOfEntries(), 1);
+    OFCHECK(second.deleteLookupTable(NUM_BITS));
+    OFCHECK_EQUAL(DiDisplayLUTCache::getNumberOfEntries(), 0);
+    DiDisplayLUTCache::setMaximumUnusedEntries(16);
+    // this display function keeps its LUT until the program terminates
+    staticDisplayFunction.Function = new DiGSDFunction(1, 250);
+    OFCHECK(staticDisplayFunction.Function->getLookupTable(NUM_BITS) != NULL);
+    OFCHECK_EQUAL(DiDisplayLUTCache::getNumberOfEntries(), 1);
+}
@@ -0,0 +1,37 @@
+/*
+ *
+ *  Copyright (C) 2016, OFFIS e.V.
+ *  All rights reserved.  See COPYRIGHT file for details.
+ *
+ *  This software and supporting documentation were developed by
+ *
+ *    OFFIS e.V.
+ *    R&D Division Health
+ *    Escherweg 2
+ *    D-26121 Oldenburg, Germany
+ *
+ *
+ *  Module:  dcmimgle
+ *
+ *  Author:  OFFIS DICOM Team
+ *
+ *  Purpose: main test program
+ *
+ */
+
+#include "dcmtk/config/osconfig.h"
+
+#include "dcmtk/ofstd/oftest.h"
+
+OFTEST_REGISTER(dcmimgle_windowKernel);
+OFTEST_REGISTER(dcmimgle_windowKernel_image);
+OFTEST_REGISTER(dcmimgle_parallelLoop);
+OFTEST_REGISTER(dcmimgle_parallelRendering);
+OFTEST_REGISTER(dcmimgle_directRendering);
+OFTEST_REGISTER(dcmimgle_displayLUTCache);
+OFTEST_REGISTER(dcmimgle_resampling);
+OFTEST_REGISTER(dcmimgle_frameAccess);
+OFTEST_REGISTER(dcmimgle_frameAccess_failure);
+OFTEST_REGISTER(dcmimgle_frameCache);
+
+OFTEST_MAIN("dcmimgle")
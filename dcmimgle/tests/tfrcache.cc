@@ -0,0 +1,217 @@
+/*
+ *
+ *  Copyright (C) 2016, OFFIS e.V.
+ *  All rights reserved.  See COPYRIGHT file for details.
+ *
+ *  This software and supporting documentation were developed by
+ *
+ *    OFFIS e.V.
+ *    R&D Division Health
+ *    Escherweg 2
+ *    D-26121 Oldenburg, Germany
+ *
+ *
+ *  Module:  dcmimgle
+ *
+ *  Author:  OFFIS DICOM Team
+ *
+ *  Purpose: test the random access to the frames of a multi-frame image and
+ *           the cache for the intermediate representation of these frames
+ *
+ */
+
+
+#include "dcmtk/config/osconfig.h"    /* make sure OS specific configuration is included first */
+
+#define INCLUDE_CSTRING
+#include "dcmtk/ofstd/ofstdinc.h"
+
+#include "dcmtk/dcmimgle/diutils.h"
+#include "timghelp.h"
+
+#define NUM_ROWS 16
+#define NUM_COLUMNS 24
+#define NUM_FRAMES 6
+#define NUM_BITS 8
+
+/* size of the intermediate representation of a frame (8 bit data is stored as Uint8).
+ * A frame has more pixels than possible values, so it can also be rendered directly.
+ */
+#define FRAME_SIZE (NUM_ROWS * NUM_COLUMNS)
+
+
+/* render each frame of the given dataset with a DicomImage that loads all frames at once */
+static void renderReference(DcmDataset &dset,
+                            OFVector<OFVector<Uint8> > &frames)
+{
+    DicomImage image(&dset, EXS_LittleEndianExplicit);
+    OFCHECK_EQUAL(image.getStatus(), EIS_Normal);
+    OFCHECK(image.setWindow(128, 256));
+    frames.clear();
+    OFVector<Uint8> output;
+    for (unsigned long f = 0; f < NUM_FRAMES; ++f)
+    {
+        OFCHECK(imgRender(image, output, f));
+        frames.push_back(output);
+    }
+}
+
+/* process the given range of frames and compare the output with the reference frames */
+static void checkFrames(DicomImage &image,
+                        const unsigned long fstart,
+                        const unsigned long fcount,
+                        const OFVector<OFVector<Uint8> > &reference,
+                        const char *description)
+{
+    const unsigned long number = (fcount > 0) ? fcount : image.getFrameCount();
+    const unsigned long count = (fstart + number > NUM_FRAMES) ? NUM_FRAMES - fstart : number;
+    OFCHECK(image.processFrames(fstart, fcount));
+    OFCHECK_EQUAL(image.getStatus(), EIS_Normal);
+    OFCHECK_EQUAL(image.getFirstFrame(), fstart);
+    OFCHECK_EQUAL(image.getFrameCount(), count);
+    OFVector<Uint8> output;
+    for (unsigned long f = 0; f < count; ++f)
+    {
+        OFCHECK(imgRender(image, output, f));
+        OFOStringStream stream;
+        stream << description << ", frame " << (fstart + f) << OFStringStream_ends;
+        OFSTRINGSTREAM_GETSTR(stream, message)
+        imgCompare(reference[fstart + f], output, message);
+        OFSTRINGSTREAM_FREESTR(message)
+    }
+}
+
+/* replace the values of the pixel data element (without replacing the element itself,
+ * which is referenced by the image)
+ */
+static void changePixelData(DcmDataset &dset,
+                            const unsigned long seed)
+{
+    OFVector<Uint16> pixels;
+    imgMakePixels(pixels, NUM_ROWS * NUM_COLUMNS * NUM_FRAMES, NUM_BITS, seed);
+    DcmElement *element = NULL;
+    OFCHECK(dset.findAndGetElement(DCM_PixelData, element).good());
+    if (element != NULL)
+        OFCHECK(element->putUint16Array(&pixels[0], OFstatic_cast(unsigned long, pixels.size())).good());
+}
+
+
+OFTEST(dcmimgle_frameAccess)
+{
+    static const unsigned long order[] = { 3, 0, 5, 5, 1, 4, 2, 0, 1 };
+    OFVector<Uint16> pixels;
+    imgMakePixels(pixels, NUM_ROWS * NUM_COLUMNS * NUM_FRAMES, NUM_BITS);
+    DcmDataset dset;
+    imgMakeDataset(dset, NUM_ROWS, NUM_COLUMNS, NUM_FRAMES, NUM_BITS, OFFalse, pixels);
+    OFVector<OFVector<Uint8> > reference;
+    renderReference(dset, reference);
+    // with and without deferred creation of the intermediate representation
+    for (int deferred = 0; deferred < 2; ++deferred)
+    {
+        const unsigned long flags = CIF_UsePartialAccessToPixelData | (deferred ? CIF_CreateIntermediateDataOnDemand : 0);
+        const char *description = deferred ? "random access (deferred)" : "random access";
+        DicomImage image(&dset, EXS_LittleEndianExplicit, flags, 0, 1);
+        OFCHECK_EQUAL(image.getStatus(), EIS_Normal);
+        OFCHECK(image.setWindow(128, 256));
+        // single frames in any order, with and without the cache
+        for (int cache = 0; cache < 2; ++cache)
+        {
+            image.setFrameCacheSize(cache ? 3 * FRAME_SIZE : 0);
+            for (size_t i = 0; i < sizeof(order) / sizeof(order[0]); ++i)
+                checkFrames(image, order[i], 1, reference, description);
+        }
+        // ranges of frames (also exceeding the last frame)
+        checkFrames(image, 1, 2, reference, description);
+        checkFrames(image, 4, 2, reference, description);
+        checkFrames(image, 0, 0 /* same number as before */, reference, description);
+        checkFrames(image, 5, 3, reference, description);
+        // processing the next frames is based on random access
+        checkFrames(image, 0, 1, reference, description);
+        for (unsigned long f = 1; f < NUM_FRAMES; ++f)
+        {
+            OFCHECK(image.processNextFrames());
+            OFCHECK_EQUAL(image.getFirstFrame(), f);
+        }
+        OFCHECK(!image.processNextFrames());
+        // frames that do not exist are rejected, the current frame remains valid
+        OFCHECK(!image.processFrames(NUM_FRAMES, 1));
+        OFCHECK_EQUAL(image.getStatus(), EIS_Normal);
+        checkFrames(image, NUM_FRAMES - 1, 1, reference, description);
+    }
+}
+
+
+OFTEST(dcmimgle_frameCache)
+{
+    OFVector<Uint16> pixels;
+    imgMakePixels(pixels, NUM_ROWS * NUM_COLUMNS * NUM_FRAMES, NUM_BITS);
+    DcmDataset dset;
+    imgMakeDataset(dset, NUM_ROWS, NUM_COLUMNS, NUM_FRAMES, NUM_BITS, OFFalse, pixels);
+    OFVector<OFVector<Uint8> > original;
+    renderReference(dset, original);
+    DicomImage image(&dset, EXS_LittleEndianExplicit, CIF_UsePartialAccessToPixelData, 0, 1);
+    OFCHECK_EQUAL(image.getStatus(), EIS_Normal);
+    OFCHECK(image.setWindow(128, 256));
+    // the cache can hold the intermediate representation of two frames
+    image.setFrameCacheSize(2 * FRAME_SIZE);
+    checkFrames(image, 1, 1, original, "frame cache");
+    checkFrames(image, 2, 1, original, "frame cache");          // cache: 1, 0
+    // from now on, frames that are decoded again differ from the cached ones
+    changePixelData(dset, 1);
+    OFVector<OFVector<Uint8> > changed;
+    renderReference(dset, changed);
+    OFCHECK(memcmp(&original[1][0], &changed[1][0], original[1].size()) != 0);
+    checkFrames(image, 1, 1, original, "cache hit");            // cache: 2, 0
+    checkFrames(image, 0, 1, original, "cache hit");            // cache: 1, 2
+    checkFrames(image, 3, 1, changed, "cache miss");            // cache: 0, 1 (2 is evicted)
+    checkFrames(image, 2, 1, changed, "evicted frame");         // cache: 3, 0 (1 is evicted)
+    checkFrames(image, 0, 1, original, "cache hit");            // cache: 2, 3
+    checkFrames(image, 1, 1, changed, "evicted frame");         // cache: 0, 2
+    // a range of frames is cached as a whole (and not used for a single frame of it)
+    checkFrames(image, 4, 2, changed, "range of frames");       // cache: 1, 0
+    changePixelData(dset, 2);
+    OFVector<OFVector<Uint8> > changedAgain;
+    renderReference(dset, changedAgain);
+    checkFrames(image, 4, 1, changedAgain, "part of range");    // cache: 4-5 (fills the cache)
+    checkFrames(image, 4, 2, changed, "cache hit");             // cache: 4
+    checkFrames(image, 1, 1, changedAgain, "evicted frame");    // cache: 4-5
+    // disabling the cache removes all entries
+    image.setFrameCacheSize(0);
+    checkFrames(image, 4, 2, changedAgain, "disabled cache");
+}
+
+
+OFTEST(dcmimgle_frameAccess_failure)
+{
+    // the pixel data only contains the first two frames and a half
+    OFVector<Uint16> pixels;
+    imgMakePixels(pixels, NUM_ROWS * NUM_COLUMNS * NUM_FRAMES, NUM_BITS);
+    DcmDataset dset;
+    imgMakeDataset(dset, NUM_ROWS, NUM_COLUMNS, NUM_FRAMES, NUM_BITS, OFFalse, pixels);
+    OFVector<OFVector<Uint8> > reference;
+    renderReference(dset, reference);
+    pixels.resize(NUM_ROWS * NUM_COLUMNS * 5 / 2);
+    imgMakeDataset(dset, NUM_ROWS, NUM_COLUMNS, NUM_FRAMES, NUM_BITS, OFFalse, pixels);
+    for (int deferred = 0; deferred < 2; ++deferred)
+    {
+        const unsigned long flags = CIF_UsePartialAccessToPixelData | (deferred ? CIF_CreateIntermediateDataOnDemand : 0);
+        const char *description = deferred ? "after failure (deferred)" : "after failure";
+        DicomImage image(&dset, EXS_LittleEndianExplicit, flags, 0, 1);
+        OFCHECK_EQUAL(image.getStatus(), EIS_Normal);
+        OFCHECK(image.setWindow(128, 256));
+        image.setFrameCacheSize(NUM_FRAMES * FRAME_SIZE);
+        checkFrames(image, 1, 1, reference, description);
+        // frames which cannot be read do not change the current frame selection and data
+        OFCHECK(!image.processFrames(4, 1));
+        OFCHECK(!image.processFrames(0, 4));
+        OFCHECK_EQUAL(image.getStatus(), EIS_Normal);
+        OFCHECK_EQUAL(image.getFirstFrame(), 1);
+        OFCHECK_EQUAL(image.getFrameCount(), 1);
+        OFVector<Uint8> output;
+        OFCHECK(imgRender(image, output));
+        imgCompare(reference[1], output, description);
+        // the image can still be used for other frames
+        checkFrames(image, 0, 1, reference, description);
+        checkFrames(image, 1, 1, reference, description);
+    }
+}
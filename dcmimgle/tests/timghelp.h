@@ -0,0 +1,146 @@
+/*
+ *
+ *  Copyright (C) 2016, OFFIS e.V.
+ *  All rights reserved.  See COPYRIGHT file for details.
+ *
+ *  This software and supporting documentation were developed by
+ *
+ *    OFFIS e.V.
+ *    R&D Division Health
+ *    Escherweg 2
+ *    D-26121 Oldenburg, Germany
+ *
+ *
+ *  Module:  dcmimgle
+ *
+ *  Author:  OFFIS DICOM Team
+ *
+ *  Purpose: helper functions for the dcmimgle tests, which create monochrome
+ *           test images and compare rendered output data
+ *
+ */
+
+#ifndef TIMGHELP_H
+#define TIMGHELP_H
+
+#include "dcmtk/config/osconfig.h"    /* make sure OS specific configuration is included first */
+
+#include "dcmtk/ofstd/oftest.h"
+#include "dcmtk/ofstd/ofvector.h"
+#include "dcmtk/dcmdata/dcdatset.h"
+#include "dcmtk/dcmdata/dcdeftag.h"
+#include "dcmtk/dcmdata/dcvrus.h"
+#include "dcmtk/dcmimgle/dcmimage.h"
+
+
+/** create the pixel values of a test image. Consecutive pixels have very different values,
+ *  and each block of 2^bits pixels contains every value that can be stored exactly once.
+ *  Adding 'seed' to the pixel index results in a different image.
+ */
+static void imgMakePixels(OFVector<Uint16> &pixels,
+                          const unsigned long count,
+                          const int bits,
+                          const unsigned long seed = 0)
+{
+    const unsigned long mask = (1UL << bits) - 1;
+    pixels.resize(count);
+    for (unsigned long i = 0; i < count; ++i)
+        pixels[i] = OFstatic_cast(Uint16, ((i + seed) * 40503UL) & mask);   // odd factor: bijective
+}
+
+/** create a monochrome image dataset with the given pixel values (16 bits allocated).
+ *  The number of pixel values has to be rows * columns * frames.
+ */
+static void imgMakeDataset(DcmDataset &dset,
+                           const Uint16 rows,
+                           const Uint16 columns,
+                           const unsigned long frames,
+                           const int bits,
+                           const OFBool isSigned,
+                           const OFVector<Uint16> &pixels)
+{
+    char buffer[32];
+    dset.clear();
+    dset.putAndInsertString(DCM_PhotometricInterpretation, "MONOCHROME2");
+    dset.putAndInsertUint16(DCM_SamplesPerPixel, 1);
+    dset.putAndInsertUint16(DCM_Rows, rows);
+    dset.putAndInsertUint16(DCM_Columns, columns);
+    dset.putAndInsertUint16(DCM_BitsAllocated, 16);
+    dset.putAndInsertUint16(DCM_BitsStored, OFstatic_cast(Uint16, bits));
+    dset.putAndInsertUint16(DCM_HighBit, OFstatic_cast(Uint16, bits - 1));
+    dset.putAndInsertUint16(DCM_PixelRepresentation, isSigned ? 1 : 0);
+    if (frames > 1)
+    {
+        sprintf(buffer, "%lu", frames);
+        dset.putAndInsertString(DCM_NumberOfFrames, buffer);
+    }
+    dset.putAndInsertUint16Array(DCM_PixelData, &pixels[0], OFstatic_cast(unsigned long, pixels.size()));
+}
+
+/** render the given frame of an image to 8 bit output data
+ *
+ ** @return OFTrue if successful, OFFalse otherwise
+ */
+static OFBool imgRender(DicomImage &image,
+                        OFVector<Uint8> &output,
+                        const unsigned long frame = 0)
+{
+    output.resize(image.getOutputDataSize(8));
+    return image.getOutputData(&output[0], output.size(), 8, frame) != 0;
+}
+
+/** compare the first 'count' bytes of two rendered frames (all bytes if 'count' is 0).
+ *  The first differing pixel (if any) is reported as a test failure.
+ */
+static void imgCompare(const OFVector<Uint8> &expected,
+                       const OFVector<Uint8> &output,
+                       const char *description,
+                       unsigned long count = 0)
+{
+    if (count == 0)
+    {
+        OFCHECK_EQUAL(expected.size(), output.size());
+        count = OFstatic_cast(unsigned long, expected.size());
+    }
+    if ((count > expected.size()) || (count > output.size()))
+    {
+        OFCHECK_FAIL(description << ": output data too small");
+        return;
+    }
+    for (unsigned long i = 0; i < count; ++i)
+    {
+        if (expected[i] != output[i])
+        {
+            OFCHECK_FAIL(description << ": pixel " << i << " is " << OFstatic_cast(int, output[i])
+                << " instead of " << OFstatic_cast(int, expected[i]));
+            return;
+        }
+    }
+}
+
+/** create a linear LUT (VOI LUT or presentation LUT) with the given number of entries
+ *  and bits per entry, where the first entry is mapped to 'first'. Every third entry is
+ *  changed, so that the LUT is not exactly linear.
+ */
+static void imgMakeLut(DcmUnsignedShort &data,
+                       DcmUnsignedShort &descriptor,
+                       const Uint16 entries,
+                       const Sint16 first,
+                       const Uint16 bits)
+{
+    OFVector<Uint16> values(entries);
+    const unsigned long maxValue = (1UL << bits) - 1;
+    for (unsigned long i = 0; i < entries; ++i)
+    {
+        unsigned long value = (entries > 1) ? i * maxValue / (entries - 1) : 0;
+        if ((i % 3 == 0) && (value > 0))
+            --value;
+        values[i] = OFstatic_cast(Uint16, value);
+    }
+    data.putUint16Array(&values[0], entries);
+    descriptor.putUint16(entries, 0);
+    descriptor.putUint16(OFstatic_cast(Uint16, first), 1);
+    descriptor.putUint16(bits, 2);
+}
+
+#endif
@@ -0,0 +1,255 @@
+/*
+ *
+ *  Copyright (C) 2016, OFFIS e.V.
+ *  All rights reserved.  See COPYRIGHT file for details.
+ *
+ *  This software and supporting documentation were developed by
+ *
+ *    OFFIS e.V.
+ *    R&D Division Health
+ *    Escherweg 2
+ *    D-26121 Oldenburg, Germany
+ *
+ *
+ *  Module:  dcmimgle
+ *
+ *  Author:  OFFIS DICOM Team
+ *
+ *  Purpose: test that processing the pixel data with several threads gives
+ *           the same output as processing it with a single thread
+ *
+ */
+
+
+#include "dcmtk/config/osconfig.h"    /* make sure OS specific configuration is included first */
+
+#include "dcmtk/dcmimgle/diparlop.h"
+#include "dcmtk/dcmimgle/diutils.h"
+#include "timghelp.h"
+
+#ifdef WITH_THREADS
+#include "dcmtk/ofstd/ofthread.h"
+#endif
+
+#define NUM_THREADS 4
+
+
+/* parallel loop which counts how often each iteration and how many ranges are processed */
+class TestParallelLoop
+  : public DiParallelLoop
+{
+
+ public:
+
+    TestParallelLoop(const unsigned long count)
+      : DiParallelLoop(),
+        Iterations(count, 0),
+        Ranges(0)
+#ifdef WITH_THREADS
+      , Mutex()
+#endif
+    {
+    }
+
+    virtual void processRange(const unsigned long first,
+                              const unsigned long last)
+    {
+        // the ranges do not overlap, so each element is only changed by one thread
+        for (unsigned long i = first; i < last; ++i)
+            ++Iterations[i];
+#ifdef WITH_THREADS
+        Mutex.lock();
+#endif
+        ++Ranges;
+#ifdef WITH_THREADS
+        Mutex.unlock();
+#endif
+    }
+
+    OFVector<unsigned int> Iterations;
+    unsigned long Ranges;
+
+ private:
+
+#ifdef WITH_THREADS
+    OFMutex Mutex;
+#endif
+};
+
+
+/* render the given image with several VOI transformations and presentation LUTs, as well
+ * as scaled, flipped and rotated copies of it, and append the output data to 'outputs'
+ */
+static void renderAll(DcmDataset &dset,
+                      const unsigned long frames,
+                      OFVector<OFVector<Uint8> > &outputs)
+{
+    DicomImage image(&dset, EXS_LittleEndianExplicit);
+    OFCHECK_EQUAL(image.getStatus(), EIS_Normal);
+    if (image.getStatus() != EIS_Normal)
+        return;
+    double minValue = 0;
+    double maxValue = 0;
+    image.getMinMaxValues(minValue, maxValue);
+    const double range = maxValue - minValue;
+    DcmUnsignedShort voiData(DcmTag(DCM_LUTData, EVR_US));
+    DcmUnsignedShort voiDescriptor(DcmTag(DCM_LUTDescriptor, EVR_US));
+    imgMakeLut(voiData, voiDescriptor, 1000, OFstatic_cast(Sint16, minValue + range / 3), 12);
+    DcmUnsignedShort presentationData(DcmTag(DCM_LUTData, EVR_US));
+    DcmUnsignedShort presentationDescriptor(DcmTag(DCM_LUTDescriptor, EVR_US));
+    imgMakeLut(presentationData, presentationDescriptor, 256, 0, 10);
+    OFVector<Uint8> output;
+    for (unsigned long frame = 0; frame < frames; ++frame)
+    {
+        // windows with pixels outside, and normal and inverse polarity
+        OFCHECK(image.setWindow(minValue + range / 2, range / 4));
+        OFCHECK(imgRender(image, output, frame));
+        outputs.push_back(output);
+        OFCHECK(image.setPolarity(EPP_Reverse));
+        OFCHECK(imgRender(image, output, frame));
+        outputs.push_back(output);
+        OFCHECK(image.setPolarity(EPP_Normal));
+        OFCHECK(image.setWindow(minValue + range / 8, 3));
+        OFCHECK(imgRender(image, output, frame));
+        outputs.push_back(output);
+        // VOI LUT (window is disabled)
+        OFCHECK(image.setVoiLut(voiData, voiDescriptor));
+        OFCHECK(imgRender(image, output, frame));
+        outputs.push_back(output);
+        // window and presentation LUT
+        OFCHECK(image.setWindow(minValue + range / 2, range / 2));
+        OFCHECK(image.setPresentationLut(presentationData, presentationDescriptor));
+        OFCHECK(imgRender(image, output, frame));
+        outputs.push_back(output);
+        OFCHECK(image.setPresentationLutShape(ESP_Inverse));
+        OFCHECK(imgRender(image, output, frame));
+        outputs.push_back(output);
+        OFCHECK(image.setPresentationLutShape(ESP_Default));
+    }
+    // scaled copies (expansion and reduction by integer factors and general scaling)
+    OFCHECK(image.setWindow(minValue + range / 2, range / 2));
+    static const double factors[] = { 2, 0.5, 3, 1.5 };
+    for (size_t i = 0; i < sizeof(factors) / sizeof(factors[0]); ++i)
+    {
+        for (int interpolate = 0; interpolate <= 2; ++interpolate)
+        {
+            DicomImage *scaled = image.createScaledImage(factors[i], factors[i], interpolate);
+            OFCHECK(scaled != NULL);
+            if (scaled != NULL)
+            {
+                OFCHECK(imgRender(*scaled, output));
+                outputs.push_back(output);
+                delete scaled;
+            }
+        }
+    }
+    // flipped and rotated copies and images
+    for (int horz = 0; horz < 2; ++horz)
+    {
+        DicomImage *flipped = image.createFlippedImage(horz, !horz);
+        OFCHECK(flipped != NULL);
+        if (flipped != NULL)
+        {
+            OFCHECK(imgRender(*flipped, output));
+            outputs.push_back(output);
+            delete flipped;
+        }
+    }
+    for (int degree = 90; degree < 360; degree += 90)
+    {
+        DicomImage *rotated = image.createRotatedImage(degree);
+        OFCHECK(rotated != NULL);
+        if (rotated != NULL)
+        {
+            OFCHECK(imgRender(*rotated, output));
+            outputs.push_back(output);
+            delete rotated;
+        }
+    }
+    OFCHECK(image.flipImage(1, 1));
+    OFCHECK(imgRender(image, output, frames - 1));
+    outputs.push_back(output);
+    OFCHECK(image.rotateImage(90));
+    OFCHECK(imgRender(image, output, frames - 1));
+    outputs.push_back(output);
+}
+
+/* render the given image with one and with several threads and compare the output */
+static void compareThreads(const char *description,
+                           const Uint16 rows,
+                           const Uint16 columns,
+                           const unsigned long frames,
+                           const int bits,
+                           const OFBool isSigned)
+{
+    OFVector<Uint16> pixels;
+    imgMakePixels(pixels, OFstatic_cast(unsigned long, rows) * columns * frames, bits);
+    DcmDataset dset;
+    imgMakeDataset(dset, rows, columns, frames, bits, isSigned, pixels);
+    OFVector<OFVector<Uint8> > expected;
+    OFVector<OFVector<Uint8> > outputs;
+    DicomImageClass::setNumberOfThreads(1);
+    renderAll(dset, frames, expected);
+    DicomImageClass::setNumberOfThreads(NUM_THREADS);
+    renderAll(dset, frames, outputs);
+    DicomImageClass::setNumberOfThreads(1);
+    OFCHECK_EQUAL(expected.size(), outputs.size());
+    for (size_t i = 0; (i < expected.size()) && (i < outputs.size()); ++i)
+    {
+        OFOStringStream stream;
+        stream << description << ", output " << i << OFStringStream_ends;
+        OFSTRINGSTREAM_GETSTR(stream, message)
+        imgCompare(expected[i], outputs[i], message);
+        OFSTRINGSTREAM_FREESTR(message)
+    }
+}
+
+
+OFTEST(dcmimgle_parallelLoop)
+{
+    static const unsigned long counts[] = { 0, 1, 2, 3, 255, 1024, 1027 };
+    static const unsigned long pixels[] = { 1, 256, 65536, 100000 };
+    for (unsigned int threads = 1; threads <= 8; threads += 7)
+    {
+        DicomImageClass::setNumberOfThreads(threads);
+        for (size_t c = 0; c < sizeof(counts) / sizeof(counts[0]); ++c)
+        {
+            for (size_t p = 0; p < sizeof(pixels) / sizeof(pixels[0]); ++p)
+            {
+                TestParallelLoop loop(counts[c]);
+                loop.run(counts[c], pixels[p]);
+                // each iteration is processed exactly once
+                unsigned long wrong = 0;
+                for (unsigned long i = 0; i < counts[c]; ++i)
+                {
+                    if (loop.Iterations[i] != 1)
+                        ++wrong;
+                }
+                OFCHECK_EQUAL(wrong, 0);
+                // each range has at least the minimum number of pixels
+                unsigned long expected = 1;
+#ifdef WITH_THREADS
+                const double total = OFstatic_cast(double, counts[c]) * pixels[p];
+                while ((expected < threads) && (expected < counts[c]) &&
+                       (total >= OFstatic_cast(double, expected + 1) * DIPARLOP_MIN_PIXELS_PER_THREAD))
+                {
+                    ++expected;
+                }
+#endif
+                OFCHECK_EQUAL(loop.Ranges, expected);
+            }
+        }
+    }
+    DicomImageClass::setNumberOfThreads(1);
+}
+
+
+OFTEST(dcmimgle_parallelRendering)
+{
+    // odd sizes, optimization LUT for 8 and 12 bit, window kernel for 16 bit
+    compareThreads("unsigned 16 bit", 384, 509, 1, 16, OFFalse);
+    compareThreads("signed 16 bit", 384, 509, 1, 16, OFTrue);
+    compareThreads("unsigned 12 bit", 517, 511, 1, 12, OFFalse);
+    compareThreads("signed 12 bit, multiframe", 301, 449, 3, 12, OFTrue);
+    compareThreads("unsigned 8 bit", 512, 512, 1, 8, OFFalse);
+}
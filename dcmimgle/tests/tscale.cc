@@ -0,0 +1,268 @@
+/*
+ *
+ *  Copyright (C) 2016, OFFIS e.V.
+ *  All rights reserved.  See COPYRIGHT file for details.
+ *
+ *  This software and supporting documentation were developed by
+ *
+ *    OFFIS e.V.
+ *    R&D Division Health
+ *    Escherweg 2
+ *    D-26121 Oldenburg, Germany
+ *
+ *
+ *  Module:  dcmimgle
+ *
+ *  Author:  OFFIS DICOM Team
+ *
+ *  Purpose: test the separable resampling (area averaging and Lanczos filter)
+ *           of 8, 16 and 32 bit pixel data against reference values
+ *
+ */
+
+
+#include "dcmtk/config/osconfig.h"    /* make sure OS specific configuration is included first */
+
+#define INCLUDE_CMATH
+#define INCLUDE_IOMANIP
+#include "dcmtk/ofstd/ofstdinc.h"
+
+#include "dcmtk/ofstd/oftest.h"
+#include "dcmtk/ofstd/ofvector.h"
+#include "dcmtk/dcmimgle/discalet.h"
+
+#define INTERPOLATE_LANCZOS 5
+#define INTERPOLATE_AREA 6
+#define LANCZOS_LOBES 3
+
+
+/* scale (and clip) a single frame with the given interpolation algorithm */
+template<class T>
+static void scaleFrame(const OFVector<T> &src,
+                       const Uint16 columns,
+                       const Uint16 rows,
+                       const signed long left,
+                       const signed long top,
+                       const Uint16 srcColumns,
+                       const Uint16 srcRows,
+                       const Uint16 destColumns,
+                       const Uint16 destRows,
+                       const int bits,
+                       const int interpolate,
+                       const T border,
+                       OFVector<T> &dest)
+{
+    DiScaleTemplate<T> scale(1, columns, rows, left, top, srcColumns, srcRows, destColumns, destRows, 1, bits);
+    dest.clear();
+    dest.resize(OFstatic_cast(size_t, destColumns) * destRows, 0);
+    const T *srcPlanes[1] = { &src[0] };
+    T *destPlanes[1] = { &dest[0] };
+    scale.scaleData(srcPlanes, destPlanes, interpolate, border);
+}
+
+/* round to the nearest integer (halfway cases away from zero) like the resampling does */
+static double roundValue(const double value)
+{
+    return (value < 0) ? ceil(value - 0.5) : floor(value + 0.5);
+}
+
+/* compare the scaled frame with the expected values (maximum difference 'tolerance') */
+template<class T>
+static void compareFrame(const OFVector<T> &output,
+                         const OFVector<double> &expected,
+                         const double tolerance,
+                         const char *description)
+{
+    OFCHECK_EQUAL(output.size(), expected.size());
+    for (size_t i = 0; (i < output.size()) && (i < expected.size()); ++i)
+    {
+        if (fabs(OFstatic_cast(double, output[i]) - expected[i]) > tolerance)
+        {
+            OFCHECK_FAIL(description << ": pixel " << i << " is " << STD_NAMESPACE setprecision(12)
+                << OFstatic_cast(double, output[i]) << " instead of " << expected[i]);
+            return;
+        }
+    }
+}
+
+/* Lanczos kernel with three lobes */
+static double lanczos(const double x)
+{
+    if (x == 0)
+        return 1;
+    if (fabs(x) >= LANCZOS_LOBES)
+        return 0;
+    const double pi = 3.14159265358979323846;
+    return sin(pi * x) / (pi * x) * sin(pi * x / LANCZOS_LOBES) / (pi * x / LANCZOS_LOBES);
+}
+
+/* compute the normalized weights of all source positions for one destination position,
+ * the filter is centered on the destination pixel and stretched when reducing
+ */
+static void lanczosWeights(const Uint16 srcSize,
+                           const Uint16 destSize,
+                           const Uint16 pos,
+                           OFVector<double> &weights)
+{
+    const double factor = OFstatic_cast(double, srcSize) / destSize;
+    const double stretch = (factor > 1) ? factor : 1;
+    const double center = (pos + 0.5) * factor;
+    double sum = 0;
+    weights.clear();
+    weights.resize(srcSize, 0);
+    for (Uint16 i = 0; i < srcSize; ++i)
+    {
+        weights[i] = lanczos((i + 0.5 - center) / stretch);
+        sum += weights[i];
+    }
+    for (Uint16 i = 0; i < srcSize; ++i)
+        weights[i] /= sum;
+}
+
+/* resample the whole image with the Lanczos filter in double precision (reference) */
+template<class T>
+static void lanczosReference(const OFVector<T> &src,
+                             const Uint16 columns,
+                             const Uint16 rows,
+                             const Uint16 destColumns,
+                             const Uint16 destRows,
+                             const double minValue,
+                             const double maxValue,
+                             OFVector<double> &expected)
+{
+    OFVector<double> xWeights;
+    OFVector<double> yWeights;
+    expected.clear();
+    for (Uint16 y = 0; y < destRows; ++y)
+    {
+        lanczosWeights(rows, destRows, y, yWeights);
+        for (Uint16 x = 0; x < destColumns; ++x)
+        {
+            lanczosWeights(columns, destColumns, x, xWeights);
+            double value = 0;
+            for (Uint16 j = 0; j < rows; ++j)
+            {
+                for (Uint16 i = 0; i < columns; ++i)
+                    value += yWeights[j] * xWeights[i] * OFstatic_cast(double, src[OFstatic_cast(size_t, j) * columns + i]);
+            }
+            if (value < minValue)
+                value = minValue;
+            else if (value > maxValue)
+                value = maxValue;
+            expected.push_back(roundValue(value));
+        }
+    }
+}
+
+/* area averaging of pixel values close to 'base' with reference values computed by hand */
+template<class T>
+static void testAreaAveraging(const char *type,
+                              const double base,
+                              const int bits)
+{
+    OFVector<T> src;
+    OFVector<T> dest;
+    OFVector<double> expected;
+    OFOStringStream stream;
+    stream << type << ", area averaging" << OFStringStream_ends;
+    OFSTRINGSTREAM_GETSTR(stream, description)
+    // 4x4 -> 2x2: mean of each block of 2x2 pixels
+    static const int blocks[16] = { 0, 2,  1, 5,
+                                    4, 6,  9, 1,
+                                    8, 8,  3, 3,
+                                    8, 0,  4, 6 };
+    for (int i = 0; i < 16; ++i)
+        src.push_back(OFstatic_cast(T, base + blocks[i]));
+    scaleFrame<T>(src, 4, 4, 0, 0, 4, 4, 2, 2, bits, INTERPOLATE_AREA, 0, dest);
+    expected.clear();
+    expected.push_back(base + 3);
+    expected.push_back(base + 4);
+    expected.push_back(base + 6);
+    expected.push_back(base + 4);
+    compareFrame(dest, expected, 0, description);
+    // 3x1 -> 2x1: the middle pixel contributes half of its area to both destination pixels
+    src.clear();
+    src.push_back(OFstatic_cast(T, base));
+    src.push_back(OFstatic_cast(T, base + 3));
+    src.push_back(OFstatic_cast(T, base + 6));
+    scaleFrame<T>(src, 3, 1, 0, 0, 3, 1, 2, 1, bits, INTERPOLATE_AREA, 0, dest);
+    expected.clear();
+    expected.push_back(base + 1);
+    expected.push_back(base + 5);
+    compareFrame(dest, expected, 0, description);
+    // 2x2 -> 4x4: each source pixel is replicated
+    src.clear();
+    for (int i = 0; i < 4; ++i)
+        src.push_back(OFstatic_cast(T, base + 7 * i));
+    scaleFrame<T>(src, 2, 2, 0, 0, 2, 2, 4, 4, bits, INTERPOLATE_AREA, 0, dest);
+    expected.clear();
+    for (int y = 0; y < 4; ++y)
+    {
+        for (int x = 0; x < 4; ++x)
+            expected.push_back(base + 7 * ((y / 2) * 2 + x / 2));
+    }
+    compareFrame(dest, expected, 0, description);
+    // 2x1 clipped with one column on either side -> 2x1: half of each pixel is the border value
+    src.clear();
+    src.push_back(OFstatic_cast(T, base + 1));
+    src.push_back(OFstatic_cast(T, base + 2));
+    scaleFrame<T>(src, 2, 1, -1, 0, 4, 1, 2, 1, bits, INTERPOLATE_AREA, 100, dest);
+    expected.clear();
+    expected.push_back(roundValue((base + 1 + 100) / 2));
+    expected.push_back(roundValue((base + 2 + 100) / 2));
+    compareFrame(dest, expected, 0, description);
+    OFSTRINGSTREAM_FREESTR(description)
+}
+
+/* Lanczos resampling of a constant image (which has to stay constant) and of an image with
+ * pixel values distributed over the whole range (compared with a reference implementation)
+ */
+template<class T>
+static void testLanczos(const char *type,
+                        const double constant,
+                        const double minValue,
+                        const double maxValue,
+                        const int bits)
+{
+    static const Uint16 columns = 7;
+    static const Uint16 rows = 5;
+    static const Uint16 sizes[][2] = { { 3, 2 }, { 16, 11 }, { 5, 9 } };
+    OFVector<T> src(OFstatic_cast(size_t, columns) * rows, OFstatic_cast(T, constant));
+    OFVector<T> dest;
+    OFVector<double> expected;
+    OFOStringStream stream;
+    stream << type << ", Lanczos filter" << OFStringStream_ends;
+    OFSTRINGSTREAM_GETSTR(stream, description)
+    for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); ++s)
+    {
+        scaleFrame<T>(src, columns, rows, 0, 0, columns, rows, sizes[s][0], sizes[s][1], bits, INTERPOLATE_LANCZOS, 0, dest);
+        expected.clear();
+        expected.resize(OFstatic_cast(size_t, sizes[s][0]) * sizes[s][1], constant);
+        compareFrame(dest, expected, 0, description);
+    }
+    // values in the whole range of the pixel type, in an irregular order
+    const double range = maxValue - minValue;
+    for (size_t i = 0; i < src.size(); ++i)
+        src[i] = OFstatic_cast(T, minValue + floor(range * OFstatic_cast(double, (i * 37) % src.size()) / (src.size() - 1)));
+    for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); ++s)
+    {
+        scaleFrame<T>(src, columns, rows, 0, 0, columns, rows, sizes[s][0], sizes[s][1], bits, INTERPOLATE_LANCZOS, 0, dest);
+        lanczosReference(src, columns, rows, sizes[s][0], sizes[s][1], minValue, maxValue, expected);
+        compareFrame(dest, expected, 1, description);
+    }
+    OFSTRINGSTREAM_FREESTR(description)
+}
+
+
+OFTEST(dcmimgle_resampling)
+{
+    // the 32 bit values cannot be represented exactly as single precision numbers
+    testAreaAveraging<Uint8>("unsigned 8 bit", 200, 8);
+    testAreaAveraging<Sint16>("signed 16 bit", -30000, 16);
+    testAreaAveraging<Uint32>("unsigned 32 bit", 4000000001.0, 32);
+    testAreaAveraging<Sint32>("signed 32 bit", -2000000001.0, 32);
+    testLanczos<Uint8>("unsigned 8 bit", 201, 0, 255, 8);
+    testLanczos<Sint16>("signed 16 bit", -30001, -32768, 32767, 16);
+    testLanczos<Uint32>("unsigned 32 bit", 4000000001.0, 0, 4294967295.0, 32);
+    testLanczos<Sint32>("signed 32 bit", -2000000001.0, -2147483648.0, 2147483647.0, 32);
+}
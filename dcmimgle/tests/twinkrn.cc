@@ -0,0 +1,143 @@
+/*
+ *
+ *  Copyright (C) 2016, OFFIS e.V.
+ *  All rights reserved.  See COPYRIGHT file for details.
+ *
+ *  This software and supporting documentation were developed by
+ *
+ *    OFFIS e.V.
+ *    R&D Division Health
+ *    Escherweg 2
+ *    D-26121 Oldenburg, Germany
+ *
+ *
+ *  Module:  dcmimgle
+ *
+ *  Author:  OFFIS DICOM Team
+ *
+ *  Purpose: test that the vectorized linear VOI window transformation gives
+ *           the same output as the generic implementation
+ *
+ */
+
+
+#include "dcmtk/config/osconfig.h"    /* make sure OS specific configuration is included first */
+
+#include "dcmtk/dcmimgle/diwinkrn.h"
+#include "timghelp.h"
+
+
+/* parameters of a window transformation as computed by DiMonoOutputPixelTemplate::window() */
+struct TestWindow
+{
+    double center;
+    double width;
+};
+
+/* windows within, partly outside and completely outside the range of 16 bit values */
+static const TestWindow testWindows[] =
+{
+    { 32768, 65536 }, { 1000, 400 }, { 0, 1 }, { 0.5, 1 }, { -0.5, 2 },
+    { 65535, 1 }, { -32768, 100 }, { -40000, 20000 }, { 100000, 10 },
+    { 2047.5, 4096 }, { 12345.25, 777.5 }, { 200, 70000 }, { -200, 3 }
+};
+
+#define ARRAY_SIZE(a) (sizeof(a) / sizeof(a[0]))
+
+
+/* apply the given window to all pixel values using the generic and the specialized
+ * version of DiWindowKernel::apply() and compare the results byte for byte. The data
+ * does not start at an aligned address and the number of pixels is not a multiple of
+ * the vector size.
+ */
+template<class T1>
+static void compareKernels(const OFVector<T1> &pixels,
+                           const TestWindow &window,
+                           const OFBool inverse)
+{
+    // computed like in DiMonoOutputPixelTemplate::window() for 8 bit output
+    const Uint8 low = inverse ? 255 : 0;
+    const Uint8 high = inverse ? 0 : 255;
+    const double width_1 = window.width - 1;
+    const double leftBorder = window.center - 0.5 - width_1 / 2;
+    const double rightBorder = window.center - 0.5 + width_1 / 2;
+    const double outrange = OFstatic_cast(double, high) - OFstatic_cast(double, low);
+    const double offset = (width_1 == 0) ? 0 : (high - ((window.center - 0.5) / width_1 + 0.5) * outrange);
+    const double gradient = (width_1 == 0) ? 0 : outrange / width_1;
+    const unsigned long count = OFstatic_cast(unsigned long, pixels.size()) - 1;
+    OFVector<Uint8> expected(count + 1, 42);
+    OFVector<Uint8> output(count + 1, 42);
+    DiWindowKernel::apply<T1, Uint8>(&pixels[1], &expected[1], count, leftBorder, rightBorder, offset, gradient, low, high);
+    DiWindowKernel::apply(&pixels[1], &output[1], count, leftBorder, rightBorder, offset, gradient, low, high);
+    OFOStringStream stream;
+    stream << "window " << window.center << "/" << window.width << (inverse ? " (inverse)" : "") << OFStringStream_ends;
+    OFSTRINGSTREAM_GETSTR(stream, description)
+    imgCompare(expected, output, description);
+    OFSTRINGSTREAM_FREESTR(description)
+}
+
+
+OFTEST(dcmimgle_windowKernel)
+{
+    // all 16 bit values (in different order), plus some more for a partial vector
+    OFVector<Uint16> pixels;
+    imgMakePixels(pixels, 65536 + 8 + 5, 16);
+    OFVector<Sint16> signedPixels(pixels.size());
+    for (size_t i = 0; i < pixels.size(); ++i)
+        signedPixels[i] = OFstatic_cast(Sint16, pixels[i] - 32768);
+    for (size_t w = 0; w < ARRAY_SIZE(testWindows); ++w)
+    {
+        compareKernels(pixels, testWindows[w], OFFalse);
+        compareKernels(pixels, testWindows[w], OFTrue);
+        compareKernels(signedPixels, testWindows[w], OFFalse);
+        compareKernels(signedPixels, testWindows[w], OFTrue);
+    }
+}
+
+
+OFTEST(dcmimgle_windowKernel_image)
+{
+    // the small image is rendered with the window kernel, the large image (which has
+    // more pixels than 3 times the number of possible values) with the optimization
+    // LUT. The first rows of both images are identical.
+    const Uint16 columns = 256;
+    const Uint16 smallRows = 256;
+    const Uint16 largeRows = 1024;
+    const unsigned long smallCount = OFstatic_cast(unsigned long, columns) * smallRows;
+    for (int isSigned = 0; isSigned < 2; ++isSigned)
+    {
+        OFVector<Uint16> pixels;
+        imgMakePixels(pixels, OFstatic_cast(unsigned long, columns) * largeRows, 16);
+        DcmDataset smallDataset;
+        DcmDataset largeDataset;
+        imgMakeDataset(largeDataset, largeRows, columns, 1, 16, isSigned != 0, pixels);
+        pixels.resize(smallCount);
+        imgMakeDataset(smallDataset, smallRows, columns, 1, 16, isSigned != 0, pixels);
+        DicomImage smallImage(&smallDataset, EXS_LittleEndianExplicit);
+        DicomImage largeImage(&largeDataset, EXS_LittleEndianExplicit);
+        OFCHECK_EQUAL(smallImage.getStatus(), EIS_Normal);
+        OFCHECK_EQUAL(largeImage.getStatus(), EIS_Normal);
+        for (size_t w = 0; w < ARRAY_SIZE(testWindows); ++w)
+        {
+            for (int inverse = 0; inverse < 2; ++inverse)
+            {
+                const EP_Polarity polarity = inverse ? EPP_Reverse : EPP_Normal;
+                const double center = isSigned ? testWindows[w].center - 32768 : testWindows[w].center;
+                OFCHECK(smallImage.setWindow(center, testWindows[w].width));
+                OFCHECK(largeImage.setWindow(center, testWindows[w].width));
+                OFCHECK(smallImage.setPolarity(polarity));
+                OFCHECK(largeImage.setPolarity(polarity));
+                OFVector<Uint8> smallOutput;
+                OFVector<Uint8> largeOutput;
+                OFCHECK(smallImage.getStatus() == EIS_Normal && imgRender(smallImage, smallOutput));
+                OFCHECK(largeImage.getStatus() == EIS_Normal && imgRender(largeImage, largeOutput));
+                OFOStringStream stream;
+                stream << (isSigned ? "signed" : "unsigned") << " image, window " << center << "/"
+                       << testWindows[w].width << (inverse ? " (inverse)" : "") << OFStringStream_ends;
+                OFSTRINGSTREAM_GETSTR(stream, description)
+                imgCompare(largeOutput, smallOutput, description, smallCount);
+                OFSTRINGSTREAM_FREESTR(description)
+            }
+        }
+    }
+}
@@ -131,6 +131,7 @@ int main(int argc, char *argv[])
     OFCmdUnsignedInt opt_acseTimeout = 30;
     OFCmdUnsignedInt opt_maxReceivePDULength = ASC_DEFAULTMAXPDU;
     OFCmdUnsignedInt opt_maxSendPDULength = 0;
+    OFCmdUnsignedInt opt_parallelAssociations = 1;
     T_DIMSE_BlockingMode opt_blockMode = DIMSE_BLOCKING;
 #ifdef WITH_ZLIB
     OFCmdUnsignedInt opt_compressionLevel = 0;
@@ -142,6 +143,7 @@ int main(int argc, char *argv[])
     OFBool opt_allowIllegalProposal = OFTrue;
     OFBool opt_checkUIDValues = OFTrue;
     OFBool opt_multipleAssociations = OFTrue;
+    OFBool opt_keepStudyOrder = OFFalse;
     DcmStorageSCU::E_DecompressionMode opt_decompressionMode = DcmStorageSCU::DM_losslessOnly;
 
     OFBool opt_dicomDir = OFFalse;
@@ -207,6 +209,9 @@ int main(int argc, char *argv[])
       cmd.addSubGroup("association handling:");
         cmd.addOption("--multi-associations",  "+ma",     "use multiple associations (one after the other)\nif needed to transfer the instances (default)");
         cmd.addOption("--single-association",  "-ma",     "always use a single association");
+        cmd.addOption("--parallel-assoc",      "+pa",  1, "[n]umber: integer (default: 1)",
+                                                          "use up to n concurrent associations\n(implies --multi-associations)");
+        cmd.addOption("--keep-study-order",    "+ks",     "send all instances of a study on the same\nassociation (only with --parallel-assoc)");
       cmd.addSubGroup("other network options:");
         cmd.addOption("--timeout",             "-to",  1, "[s]econds: integer (default: unlimited)",
                                                           "timeout for connection requests");
@@ -330,6 +335,16 @@ int main(int argc, char *argv[])
         if (cmd.findOption("--multi-associations")) opt_multipleAssociations = OFTrue;
         if (cmd.findOption("--single-association")) opt_multipleAssociations = OFFalse;
         cmd.endOptionBlock();
+        if (cmd.findOption("--parallel-assoc"))
+        {
+            app.checkConflict("--parallel-assoc", "--single-association", !opt_multipleAssociations);
+            app.checkValue(cmd.getValueAndCheckMin(opt_parallelAssociations, 1));
+        }
+        if (cmd.findOption("--keep-study-order"))
+        {
+            app.checkDependence("--keep-study-order", "--parallel-assoc", opt_parallelAssociations > 1);
+            opt_keepStudyOrder = OFTrue;
+        }
 
         if (cmd.findOption("--timeout"))
         {
@@ -477,79 +492,95 @@ int main(int argc, char *argv[])
         OFLOG_DEBUG(dcmsendLogger, "only a single associations allowed (option --single-association used)");
     }
 
-    /* add presentation contexts to be negotiated (if there are still any) */
-    while ((status = storageSCU.addPresentationContexts()).good())
+    /* send SOP instances on concurrent associations (if requested) */
+    if (opt_parallelAssociations > 1)
     {
-        if (opt_multipleAssociations)
-        {
-            /* output information on the start of the new association */
-            if (dcmsendLogger.isEnabledFor(OFLogger::DEBUG_LOG_LEVEL))
-            {
-                OFLOG_DEBUG(dcmsendLogger, OFString(65, '-') << OFendl
-                    << "starting association #" << (storageSCU.getAssociationCounter() + 1));
-            } else {
-                OFLOG_INFO(dcmsendLogger, "starting association #" << (storageSCU.getAssociationCounter() + 1));
-            }
-        }
-        OFLOG_INFO(dcmsendLogger, "initializing network ...");
-        /* initialize network */
-        status = storageSCU.initNetwork();
+        OFLOG_INFO(dcmsendLogger, "sending SOP instances on up to " << opt_parallelAssociations
+            << " parallel associations ...");
+        status = storageSCU.sendSOPInstancesInParallel(OFstatic_cast(size_t, opt_parallelAssociations),
+            opt_keepStudyOrder);
         if (status.bad())
         {
-            OFLOG_FATAL(dcmsendLogger, "cannot initialize network: " << status.text());
+            OFLOG_FATAL(dcmsendLogger, "cannot send SOP instances: " << status.text());
             cleanup();
-            return EXITCODE_CANNOT_INITIALIZE_NETWORK;
+            return EXITCODE_CANNOT_SEND_REQUEST;
         }
-        OFLOG_INFO(dcmsendLogger, "negotiating network association ...");
-        /* negotiate network association with peer */
-        status = storageSCU.negotiateAssociation();
-        if (status.bad())
+    } else {
+        /* otherwise, send SOP instances on one association after the other: */
+        /* add presentation contexts to be negotiated (if there are still any) */
+        while ((status = storageSCU.addPresentationContexts()).good())
         {
-            // check whether we can continue with a new association
-            if (status == NET_EC_NoAcceptablePresentationContexts)
+            if (opt_multipleAssociations)
             {
-                OFLOG_ERROR(dcmsendLogger, "cannot negotiate network association: " << status.text());
-                // check whether there are any SOP instances to be sent
-                const size_t numToBeSent = storageSCU.getNumberOfSOPInstancesToBeSent();
-                if (numToBeSent > 0)
+                /* output information on the start of the new association */
+                if (dcmsendLogger.isEnabledFor(OFLogger::DEBUG_LOG_LEVEL))
                 {
-                    OFLOG_WARN(dcmsendLogger, "trying to continue with a new association "
-                        << "in order to send the remaining " << numToBeSent << " SOP instances");
+                    OFLOG_DEBUG(dcmsendLogger, OFString(65, '-') << OFendl
+                        << "starting association #" << (storageSCU.getAssociationCounter() + 1));
+                } else {
+                    OFLOG_INFO(dcmsendLogger, "starting association #" << (storageSCU.getAssociationCounter() + 1));
                 }
-            } else {
-                OFLOG_FATAL(dcmsendLogger, "cannot negotiate network association: " << status.text());
+            }
+            OFLOG_INFO(dcmsendLogger, "initializing network ...");
+            /* initialize network */
+            status = storageSCU.initNetwork();
+            if (status.bad())
+            {
+                OFLOG_FATAL(dcmsendLogger, "cannot initialize network: " << status.text());
                 cleanup();
-                return EXITCODE_CANNOT_NEGOTIATE_ASSOCIATION;
+                return EXITCODE_CANNOT_INITIALIZE_NETWORK;
             }
-        }
-        if (status.good())
-        {
-            OFLOG_INFO(dcmsendLogger, "sending SOP instances ...");
-            /* send SOP instances to be transferred */
-            status = storageSCU.sendSOPInstances();
+            OFLOG_INFO(dcmsendLogger, "negotiating network association ...");
+            /* negotiate network association with peer */
+            status = storageSCU.negotiateAssociation();
             if (status.bad())
             {
-                OFLOG_FATAL(dcmsendLogger, "cannot send SOP instance: " << status.text());
-                // handle certain error conditions (initiated by the communication peer)
-                if (status == DUL_PEERREQUESTEDRELEASE)
+                // check whether we can continue with a new association
+                if (status == NET_EC_NoAcceptablePresentationContexts)
                 {
-                    // peer requested release (aborting)
-                    storageSCU.closeAssociation(DCMSCU_PEER_REQUESTED_RELEASE);
+                    OFLOG_ERROR(dcmsendLogger, "cannot negotiate network association: " << status.text());
+                    // check whether there are any SOP instances to be sent
+                    const size_t numToBeSent = storageSCU.getNumberOfSOPInstancesToBeSent();
+                    if (numToBeSent > 0)
+                    {
+                        OFLOG_WARN(dcmsendLogger, "trying to continue with a new association "
+                            << "in order to send the remaining " << numToBeSent << " SOP instances");
+                    }
+                } else {
+                    OFLOG_FATAL(dcmsendLogger, "cannot negotiate network association: " << status.text());
+                    cleanup();
+                    return EXITCODE_CANNOT_NEGOTIATE_ASSOCIATION;
                 }
-                else if (status == DUL_PEERABORTEDASSOCIATION)
+            }
+            if (status.good())
+            {
+                OFLOG_INFO(dcmsendLogger, "sending SOP instances ...");
+                /* send SOP instances to be transferred */
+                status = storageSCU.sendSOPInstances();
+                if (status.bad())
                 {
-                    // peer aborted the association
-                    storageSCU.closeAssociation(DCMSCU_PEER_ABORTED_ASSOCIATION);
+                    OFLOG_FATAL(dcmsendLogger, "cannot send SOP instance: " << status.text());
+                    // handle certain error conditions (initiated by the communication peer)
+                    if (status == DUL_PEERREQUESTEDRELEASE)
+                    {
+                        // peer requested release (aborting)
+                        storageSCU.closeAssociation(DCMSCU_PEER_REQUESTED_RELEASE);
+                    }
+                    else if (status == DUL_PEERABORTEDASSOCIATION)
+                    {
+                        // peer aborted the association
+                        storageSCU.closeAssociation(DCMSCU_PEER_ABORTED_ASSOCIATION);
+                    }
+                    cleanup();
+                    return EXITCODE_CANNOT_SEND_REQUEST;
                 }
-                cleanup();
-                return EXITCODE_CANNOT_SEND_REQUEST;
             }
+            /* close current network association */
+            storageSCU.releaseAssociation();
+            /* check whether multiple associations are permitted */
+            if (!opt_multipleAssociations)
+                break;
         }
-        /* close current network association */
-        storageSCU.releaseAssociation();
-        /* check whether multiple associations are permitted */
-        if (!opt_multipleAssociations)
-            break;
     }
 
     /* if anything went wrong, report it to the logger */
@@ -117,6 +117,26 @@ public:
    */
   virtual OFBool networkDataAvailable(int timeout) = 0;
 
+  /** sets or clears the TCP_CORK socket option on the underlying socket.
+   *  While the option is set, partial TCP segments are not sent, so that
+   *  data written in several calls to write() is combined into full-sized
+   *  segments. Clearing the option flushes any pending data.
+   *  @param cork OFTrue to set, OFFalse to clear the option
+   *  @return OFTrue if successful, OFFalse otherwise (e.g. if the option is
+   *    not supported on this platform)
+   */
+  OFBool setTCPCork(OFBool cork);
+
+  /** sets the TCP_QUICKACK socket option on the underlying socket, i.e.
+   *  acknowledgements are sent immediately instead of being delayed.
+   *  Please note that the operating system may reset this option (e.g. Linux
+   *  after the next acknowledgement), so it has to be set again after data
+   *  has been received.
+   *  @return OFTrue if successful, OFFalse otherwise (e.g. if the option is
+   *    not supported on this platform)
+   */
+  OFBool setTCPQuickAck();
+
   /** returns OFTrue if this connection is a transparent TCP connection,
    *  OFFalse if the connection is a secure connection.
    */
@@ -1,6 +1,6 @@
 /*
  *
- *  Copyright (C) 2011-2015, OFFIS e.V.
+ *  Copyright (C) 2011-2016, OFFIS e.V.
  *  All rights reserved.  See COPYRIGHT file for details.
  *
  *  This software and supporting documentation were developed by
@@ -333,6 +333,36 @@ class DCMTK_DCMNET_EXPORT DcmStorageSCU
      */
     OFCondition sendSOPInstances();
 
+    /** send all SOP instances from the transfer list that are not yet sent, using a number
+     *  of concurrent associations to the same peer.  The transfer list is split into shards,
+     *  which are put into a common queue.  Each of the worker threads takes the next shard
+     *  from this queue as soon as it has finished the previous one, i.e.\ faster
+     *  associations automatically process more shards.  For each shard, the worker adds the
+     *  required presentation contexts, negotiates a new association (or more than one, if
+     *  needed) and sends the SOP instances in the order of the transfer list.  The network
+     *  parameters and modes of this object (peer, AE titles, timeouts, maximum PDU length,
+     *  decompression mode, etc.) are also used for the workers.  The results are stored in
+     *  the transfer list of this object, so getStatusSummary() and createReportFile() report
+     *  on all associations together.  The methods notifySOPInstanceSent() and
+     *  shouldStopAfterCurrentSOPInstance() are called for this object from the worker
+     *  threads, but never concurrently.
+     *  This method must not be called while an association is active (see sendSOPInstances()
+     *  for the single association case).  Secure transport connections are currently not
+     *  supported by the workers.  If DCMTK is compiled without thread support, the shards are
+     *  processed one after the other.
+     *  @param  numAssociations  maximum number of concurrent associations (should be > 0)
+     *  @param  keepStudyOrder   flag indicating whether all SOP instances of a study should
+     *                           be sent on the same association and in the order of the
+     *                           transfer list.  If OFFalse, consecutive entries of the
+     *                           transfer list are grouped into shards regardless of the study
+     *                           they belong to.  Please note that the Study Instance UID has
+     *                           to be read from each DICOM file if this mode is enabled.
+     *  @return status, EC_Normal if successful, an error code otherwise.  If more than one
+     *    worker failed, the status of the first failure is returned.
+     */
+    OFCondition sendSOPInstancesInParallel(const size_t numAssociations,
+                                           const OFBool keepStudyOrder = OFFalse);
+
     /** get some status information on the overall sending process.  This text can for example
      *  be output to the logger (on the level at the user's option).
      *  @param  summary  reference to a string in which the summary is stored
@@ -497,6 +527,14 @@ class DCMTK_DCMNET_EXPORT DcmStorageSCU
 
   private:
 
+    /// internal class for the workers used by sendSOPInstancesInParallel()
+    class ParallelWorker;
+    /// internal structure for the state shared by the workers
+    struct ParallelContext;
+
+    // workers need access to the transfer list and counters of this class
+    friend class ParallelWorker;
+
     /// association counter
     unsigned long AssociationCounter;
     /// presentation context counter
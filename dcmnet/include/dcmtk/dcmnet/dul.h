@@ -115,6 +115,39 @@ extern DCMTK_DCMNET_EXPORT OFGlobal<const char *> dcmTCPWrapperDaemonName;   /*
  */
 extern DCMTK_DCMNET_EXPORT OFGlobal<unsigned long> dcmEnableBackwardCompatibility;
 
+/** Global size (bytes) of the socket send buffer (SO_SNDBUF) used for new
+ *  TCP connections. A value of 0 selects the default behaviour, i.e. the value
+ *  of the environment variable TCP_BUFFER_LENGTH if set. A negative value (or
+ *  0 if the environment variable is not set) disables setting the socket
+ *  option, so that the operating system's automatic buffer tuning (based on
+ *  the bandwidth-delay product of each connection) remains in effect. This is
+ *  recommended for fast networks with high latency and for large maximum PDU
+ *  sizes.
+ */
+extern DCMTK_DCMNET_EXPORT OFGlobal<Sint32> dcmSocketSendBufferSize;   /* default 0 */
+
+/** Global size (bytes) of the socket receive buffer (SO_RCVBUF) used for new
+ *  TCP connections. The meaning of the value is the same as for
+ *  dcmSocketSendBufferSize.
+ */
+extern DCMTK_DCMNET_EXPORT OFGlobal<Sint32> dcmSocketReceiveBufferSize;   /* default 0 */
+
+/** Global flag enabling the TCP_QUICKACK socket option for TCP connections,
+ *  i.e. delayed acknowledgements are disabled. Since the operating system may
+ *  reset this option (e.g. Linux after the next acknowledgement), it is set
+ *  again after each PDU that has been received. Only available on systems that
+ *  support this option (e.g. Linux), ignored otherwise.
+ */
+extern DCMTK_DCMNET_EXPORT OFGlobal<OFBool> dcmEnableTCPQuickAck;   /* default OFFalse */
+
+/** Global flag enabling the TCP_CORK socket option while a P-DATA-TF PDU is
+ *  written, so that PDU header and PDV data are combined into full-sized TCP
+ *  segments instead of sending the header in a separate small segment.
+ *  Only available on systems that support this option (e.g. Linux), ignored
+ *  otherwise.
+ */
+extern DCMTK_DCMNET_EXPORT OFGlobal<OFBool> dcmEnableTCPCork;   /* default OFFalse */
+
 typedef void DUL_NETWORKKEY;
 typedef void DUL_ASSOCIATIONKEY;
 typedef unsigned char DUL_PRESENTATIONCONTEXTID;
@@ -183,6 +183,40 @@ private:
 };
 
 
+class DcmSCU;
+
+/** Abstract base class for handlers of asynchronous DIMSE requests. An instance of a
+ *  derived class is passed to DcmSCU::sendFINDRequestAsync() and gets notified about all
+ *  responses received for this request as well as about the completion of the request.
+ */
+class DCMTK_DCMNET_EXPORT DcmSCUAsyncHandler
+{
+public:
+
+  /** Virtual destructor
+   */
+  virtual ~DcmSCUAsyncHandler() {}
+
+  /** Called for each C-FIND response received for an asynchronous C-FIND request
+   *  @param scu      [in] The SCU on which the response was received
+   *  @param response [in] The C-FIND response received. The handler takes over ownership
+   *                       and is responsible for deleting it.
+   */
+  virtual void notifyFINDResponse(DcmSCU &scu,
+                                  QRResponse *response) = 0;
+
+  /** Called once when an asynchronous request has been completed, i.e.\ after the final
+   *  response has been received or after an error occurred. Afterwards, a new asynchronous
+   *  request can be sent on the SCU (e.g.\ from within this method).
+   *  @param scu    [in] The SCU on which the request has been completed
+   *  @param result [in] EC_Normal if the final response has been received, an error code
+   *                     otherwise (e.g.\ if the association has been aborted by the peer)
+   */
+  virtual void notifyRequestCompleted(DcmSCU &scu,
+                                      const OFCondition &result) = 0;
+};
+
+
 /** Base class for implementing DICOM Service Class User functionality. The class offers
  *  support for negotiating associations and sending and receiving arbitrary DIMSE messages
  *  on that connection. DcmSCU has built-in C-ECHO support so derived classes do not have to
@@ -494,6 +528,56 @@ public:
                                          QRResponse *response,
                                          OFBool &waitForNextResponse);
 
+  /** Sends a C-FIND request on the currently opened association but does not wait for the
+   *  responses. Instead, the responses are received by handleAsyncResponse() or
+   *  processAsyncRequests() and passed to the given handler together with the final status.
+   *  This allows a single thread to drive C-FIND requests on many associations (e.g.\ to
+   *  different peers) concurrently. Only one asynchronous request can be outstanding on an
+   *  association at a time. The method handleFINDResponse() is called for each response
+   *  as in the synchronous case.
+   *  @param presID    [in] The presentation context ID that should be used. Must be an odd
+   *                        number.
+   *  @param queryKeys [in] The dataset containing the query keys to be searched for on the
+   *                        server (SCP).
+   *  @param handler   [in] The handler to be notified about the responses. Must not be NULL
+   *                        and must exist until the request has been completed.
+   *  @return EC_Normal if the request could be sent, an error code otherwise. In case of
+   *          error, the handler is not called.
+   */
+  virtual OFCondition sendFINDRequestAsync(const T_ASC_PresentationContextID presID,
+                                           DcmDataset *queryKeys,
+                                           DcmSCUAsyncHandler *handler);
+
+  /** Returns whether there is an outstanding asynchronous request on this association
+   *  @return OFTrue if an asynchronous request is waiting for responses, OFFalse otherwise
+   */
+  OFBool hasPendingAsyncRequest() const;
+
+  /** Receives and handles the next response for the outstanding asynchronous request, and
+   *  any further responses that have already been received completely. This method should
+   *  only be called if data is available on the association (e.g.\ as reported by
+   *  ASC_dataWaiting()), since it waits for the response according to the DIMSE blocking
+   *  mode and timeout otherwise.
+   *  @return EC_Normal if the response(s) could be handled, an error code otherwise. In case
+   *          of error, the asynchronous request is completed with that error code.
+   */
+  virtual OFCondition handleAsyncResponse();
+
+  /** Waits for responses on all given SCUs that have an outstanding asynchronous request and
+   *  handles them, until all requests have been completed. The associations are multiplexed
+   *  with select(), i.e.\ no additional threads are needed.
+   *  @param scus    [in] The SCUs to be processed. SCUs without an outstanding asynchronous
+   *                      request are ignored.
+   *  @param timeout [in] Maximum time in seconds to wait for data on any of the associations.
+   *                      If this time expires without any response being received, the method
+   *                      returns with DIMSE_NODATAAVAILABLE and the requests are still pending.
+   *  @return EC_Normal if all asynchronous requests have been completed (successfully or not,
+   *          see DcmSCUAsyncHandler::notifyRequestCompleted()), DIMSE_NODATAAVAILABLE if the
+   *          timeout expired
+   */
+  static OFCondition processAsyncRequests(const OFList<DcmSCU *> &scus,
+                                          const int timeout);
+
   /** Send C-CANCEL and, therefore, ends the C-FIND -GET or -MOVE session, i.e.\ no further
    *  responses will be handled. A call to this function only makes sense if an association
    *  is open, the given presentation context represents a valid C-FIND/GET/MOVE-enabled SOP
@@ -679,6 +763,17 @@ public:
    */
   OFBool isConnected() const;
 
+  /** Check whether an idle association is still usable, i.e.\ whether it has
+   *  neither been closed nor released or aborted by the peer in the meantime.
+   *  Since no DIMSE message is expected on an idle association, any incoming
+   *  data (e.g.\ an A-RELEASE-RQ or A-ABORT) or the end of the TCP stream
+   *  indicates that the association cannot be used any more. This method does
+   *  not block and does not read any data from the connection.
+   *  @return OFTrue if the SCU is connected and no data is waiting on the
+   *    association, OFFalse otherwise
+   */
+  OFBool isIdleAssociationAlive() const;
+
   /** Returns maximum PDU length configured to be received by SCU
    *  @return Maximum PDU length in bytes
    */
@@ -1064,6 +1159,31 @@ private:
   /// Progress notification mode (default: enabled)
   OFBool m_progressNotificationMode;
 
+  /// Handler of the outstanding asynchronous request (NULL if none)
+  DcmSCUAsyncHandler *m_asyncHandler;
+
+  /** Sends a C-FIND request message (without receiving the responses)
+   *  @param presID    [in] The presentation context ID that should be used
+   *  @param queryKeys [in] The dataset containing the query keys
+   *  @return EC_Normal if the request could be sent, an error code otherwise
+   */
+  OFCondition sendFINDRequestMessage(const T_ASC_PresentationContextID presID,
+                                     DcmDataset *queryKeys);
+
+  /** Receives a single C-FIND response (command and dataset, if any)
+   *  @param presID   [out] The presentation context ID the response was received on
+   *  @param response [out] The response received (to be deleted by the caller). Only
+   *                        set if the method returns EC_Normal.
+   *  @return EC_Normal if a C-FIND response could be received, an error code otherwise
+   */
+  OFCondition receiveFINDResponse(T_ASC_PresentationContextID &presID,
+                                  QRResponse *&response);
+
+  /** Completes the outstanding asynchronous request and notifies the handler
+   *  @param result [in] Result to be reported to the handler
+   */
+  void completeAsyncRequest(const OFCondition &result);
+
   /** Returns next available message ID free to be used by SCU
    *  @return Next free message ID
    */
@@ -0,0 +1,333 @@
+/*
+ *
+ *  Copyright (C) 2016, OFFIS e.V.
+ *  All rights reserved.  See COPYRIGHT file for details.
+ *
+ *  This software and supporting documentation were developed by
+ *
+ *    OFFIS e.V.
+ *    R&D Division Health
+ *    Escherweg 2
+ *    D-26121 Oldenburg, Germany
+ *
+ *
+ *  Module:  dcmnet
+ *
+ *  Author:  OFFIS DICOM Team
+ *
+ *  Purpose: Class managing a pool of negotiated associations (DcmSCU objects)
+ *           to communication peers, which are handed out to callers on demand
+ *           and kept open for reuse after they have been released.
+ *
+ */
+
+#ifndef SCUPOOL_H
+#define SCUPOOL_H
+
+#include "dcmtk/config/osconfig.h"  /* make sure OS specific configuration is included first */
+
+#include "dcmtk/ofstd/ofthread.h"
+#include "dcmtk/dcmnet/scu.h"
+
+/** Pool of negotiated associations for DcmSCU based clients. Applications that
+ *  frequently send short requests (e.g.\ C-FIND or C-STORE) to the same peers
+ *  can acquire an SCU from the pool, use it for one or more DIMSE operations
+ *  and release it again. Released associations are kept open and handed out
+ *  to the next caller requesting an association to the same peer, so that the
+ *  association negotiation (and a possible TLS handshake) is only needed once.
+ *  A new association is only negotiated if there is no idle association to the
+ *  peer on which all requested presentation contexts have been accepted. In
+ *  this case, all presentation contexts proposed to the peer before are
+ *  proposed again, so that the new association can be reused for all kinds of
+ *  requests. Idle associations are released after a configurable timeout by a
+ *  background thread that is started when the first association becomes idle.
+ *  Before an idle association is handed out again, the pool checks whether the
+ *  peer has released or aborted it or closed the connection in the meantime
+ *  (and optionally sends a C-ECHO request, see setEchoInterval()). Dead
+ *  associations are discarded and the next idle one is tried or a new one is
+ *  negotiated.
+ *  All public methods of this class are thread-safe, i.e.\ an SCU acquired from
+ *  the pool can be used in any thread, while other threads acquire or release
+ *  other SCUs. An acquired SCU itself must not be used by more than one thread
+ *  at a time, of course.
+ *  @note The liveness check cannot detect a peer that silently disappeared
+ *    (e.g.\ due to a network failure) unless C-ECHO checks are enabled. If a
+ *    DIMSE operation on an acquired SCU fails, it should therefore be released
+ *    with 'keepAlive' set to OFFalse and the operation should be retried with a
+ *    newly acquired SCU.
+ */
+class DCMTK_DCMNET_EXPORT DcmSCUPool
+{
+
+public:
+
+  /** Presentation context requested from the pool
+   */
+  struct DCMTK_DCMNET_EXPORT PresentationContext
+  {
+    /** constructor
+     *  @param abstractSyntax   [in] Abstract syntax name in UID format
+     *  @param transferSyntaxes [in] List of transfer syntaxes for the given
+     *                               abstract syntax. Any of them is sufficient
+     *                               for the presentation context to be usable.
+     *  @param role             [in] The role to be negotiated
+     */
+    PresentationContext(const OFString &abstractSyntax,
+                        const OFList<OFString> &transferSyntaxes,
+                        const T_ASC_SC_ROLE role = ASC_SC_ROLE_DEFAULT);
+
+    /** comparison operator
+     *  @param other [in] presentation context to compare with
+     *  @return OFTrue if abstract syntax, transfer syntaxes and role are equal
+     */
+    OFBool operator==(const PresentationContext &other) const;
+
+    /// abstract syntax name in UID format
+    OFString AbstractSyntax;
+    /// list of transfer syntaxes
+    OFList<OFString> TransferSyntaxes;
+    /// role to be negotiated
+    T_ASC_SC_ROLE Role;
+  };
+
+  /** Constructor. Initializes internal member variables.
+   */
+  DcmSCUPool();
+
+  /** Virtual destructor. Releases all associations and deletes all SCUs that
+   *  are still managed by the pool. Please make sure that no SCU is in use any
+   *  more when the pool is destroyed.
+   */
+  virtual ~DcmSCUPool();
+
+  /** Set the time after which an idle association is released.
+   *  @param idleTimeout [in] timeout in seconds. 0 means that idle
+   *                          associations are only released by an explicit
+   *                          call of releaseIdleAssociations(). Default: 60.
+   */
+  void setIdleTimeout(const Uint32 idleTimeout);
+
+  /** Get the time after which an idle association is released.
+   *  @return timeout in seconds (0 = no automatic release)
+   */
+  Uint32 getIdleTimeout() const;
+
+  /** Set the time after which an idle association is checked with a C-ECHO
+   *  request before it is handed out again. The check is only performed if a
+   *  presentation context for the Verification SOP Class has been accepted on
+   *  the association (see acquireSCU()). Associations on which the C-ECHO fails
+   *  are aborted and discarded.
+   *  @param echoInterval [in] minimum idle time in seconds before a C-ECHO is
+   *                           sent. 0 disables the check (default).
+   */
+  void setEchoInterval(const Uint32 echoInterval);
+
+  /** Get the time after which an idle association is checked with a C-ECHO
+   *  request before it is handed out again.
+   *  @return minimum idle time in seconds (0 = no C-ECHO check)
+   */
+  Uint32 getEchoInterval() const;
+
+  /** Set the maximum number of idle associations that are kept open for a
+   *  single communication peer. If more SCUs are released, the association
+   *  that has been idle for the longest time is released.
+   *  @param maxIdle [in] maximum number of idle associations per peer
+   *                      (default: 4)
+   */
+  void setMaxIdleAssociations(const size_t maxIdle);
+
+  /** Get the maximum number of idle associations that are kept open for a
+   *  single communication peer.
+   *  @return maximum number of idle associations per peer
+   */
+  size_t getMaxIdleAssociations() const;
+
+  /** Acquire an SCU with a negotiated association to the given peer, on which
+   *  all given presentation contexts have been accepted. If there is such an
+   *  idle association in the pool, it is handed out. Otherwise, a new SCU is
+   *  created using createSCU() and a new association is negotiated.
+   *  The SCU is owned by the pool and must be given back using releaseSCU().
+   *  @param peerHostName [in]  host name or IP address of the peer
+   *  @param peerPort     [in]  TCP port number of the peer
+   *  @param peerAETitle  [in]  called AE title
+   *  @param aeTitle      [in]  calling AE title
+   *  @param presContexts [in]  presentation contexts that are needed
+   *  @param scu          [out] pointer to the acquired SCU, NULL in case of error
+   *  @return EC_Normal if successful, an error code otherwise.
+   *    NET_EC_NoAcceptablePresentationContexts is returned if the association
+   *    could be negotiated but not all requested presentation contexts were
+   *    accepted by the peer.
+   */
+  OFCondition acquireSCU(const OFString &peerHostName,
+                         const Uint16 peerPort,
+                         const OFString &peerAETitle,
+                         const OFString &aeTitle,
+                         const OFList<PresentationContext> &presContexts,
+                         DcmSCU *&scu);
+
+  /** Acquire an SCU with a negotiated association to the given peer, on which
+   *  a presentation context for the given abstract syntax has been accepted.
+   *  See the other acquireSCU() method for details.
+   *  @param peerHostName     [in]  host name or IP address of the peer
+   *  @param peerPort         [in]  TCP port number of the peer
+   *  @param peerAETitle      [in]  called AE title
+   *  @param aeTitle          [in]  calling AE title
+   *  @param abstractSyntax   [in]  abstract syntax name in UID format
+   *  @param transferSyntaxes [in]  list of transfer syntaxes for the abstract
+   *                                syntax
+   *  @param scu              [out] pointer to the acquired SCU, NULL in case of
+   *                                error
+   *  @return EC_Normal if successful, an error code otherwise
+   */
+  OFCondition acquireSCU(const OFString &peerHostName,
+                         const Uint16 peerPort,
+                         const OFString &peerAETitle,
+                         const OFString &aeTitle,
+                         const OFString &abstractSyntax,
+                         const OFList<OFString> &transferSyntaxes,
+                         DcmSCU *&scu);
+
+  /** Give an SCU acquired with acquireSCU() back to the pool.
+   *  @param scu       [in] the SCU to be released. Must not be used by the
+   *                        caller any more after this call.
+   *  @param keepAlive [in] if OFTrue (default), the association is kept open
+   *                        for reuse. If OFFalse, e.g.\ because an error
+   *                        occurred during a DIMSE operation, the association
+   *                        is aborted and the SCU is deleted.
+   *  @return EC_Normal if successful, NET_EC_UnknownSCU if the SCU has not been
+   *    acquired from this pool
+   */
+  OFCondition releaseSCU(DcmSCU *scu,
+                         const OFBool keepAlive = OFTrue);
+
+  /** Release idle associations whose idle timeout has expired. This method is
+   *  also called internally by acquireSCU() and releaseSCU() and by the
+   *  background thread of the pool whenever an idle association expires, so applications usually only need it
+   *  in order to release all idle associations at once.
+   *  @param all [in] if OFTrue, all idle associations are released regardless
+   *                  of the idle timeout
+   */
+  void releaseIdleAssociations(const OFBool all = OFFalse);
+
+  /** Get number of associations currently managed by the pool.
+   *  @param onlyBusy [in] return only number of associations that are in use
+   *                       (i.e.\ acquired and not yet released), if OFTrue
+   *  @return number of associations
+   */
+  size_t numAssociations(const OFBool onlyBusy);
+
+protected:
+
+  /** Create a new SCU for a new association. The pool sets the peer and AE
+   *  titles, adds the presentation contexts and negotiates the association
+   *  afterwards. The default implementation creates a DcmSCU object. Derived
+   *  classes may overwrite this method in order to configure further settings
+   *  (e.g.\ timeouts or the maximum PDU size) or to return an instance of a
+   *  class derived from DcmSCU (e.g.\ one that uses a secure connection).
+   *  @return newly created SCU, which is owned by the pool
+   */
+  virtual DcmSCU *createSCU();
+
+private:
+
+  /// background thread releasing expired idle associations (see scupool.cc)
+  class Reaper;
+
+  /** Internal structure for a single association managed by the pool
+   */
+  struct Entry
+  {
+    /// the SCU (owned by the pool)
+    DcmSCU *SCU;
+    /// host name or IP address of the peer
+    OFString PeerHostName;
+    /// TCP port number of the peer
+    Uint16 PeerPort;
+    /// called AE title
+    OFString PeerAETitle;
+    /// calling AE title
+    OFString AETitle;
+    /// presentation contexts proposed on this association
+    OFList<PresentationContext> PresContexts;
+    /// flag indicating whether the SCU is in use
+    OFBool Busy;
+    /// time when the SCU has been released (if not busy)
+    time_t LastUsed;
+  };
+
+  /** Check whether all given presentation contexts are usable on the
+   *  association of the given SCU
+   *  @param scu          [in] the SCU to check
+   *  @param presContexts [in] presentation contexts that are needed
+   *  @return OFTrue if all presentation contexts are usable, OFFalse otherwise
+   */
+  static OFBool isUsable(DcmSCU &scu,
+                         const OFList<PresentationContext> &presContexts);
+
+  /** Check whether the idle association of the given entry can still be used.
+   *  Must be called without holding the mutex, since a C-ECHO request might be
+   *  sent (see setEchoInterval()). The entry must be marked as busy.
+   *  @param entry [in] the entry to check
+   *  @param now   [in] current time
+   *  @return OFTrue if the association is alive, OFFalse otherwise
+   */
+  OFBool isAlive(const Entry &entry,
+                 const time_t now) const;
+
+  /** Release (or abort) the associations of the given SCUs and delete them.
+   *  Must be called without holding the mutex, since this requires network I/O.
+   *  @param scus  [in] list of SCUs to be closed (must not be managed by the
+   *                    pool any more)
+   *  @param abort [in] abort the associations instead of releasing them
+   */
+  static void closeSCUs(OFList<DcmSCU *> &scus,
+                        const OFBool abort = OFFalse);
+
+  /** Start the background thread releasing expired idle associations, if it
+   *  is not running yet. The caller must hold the mutex.
+   */
+  void startReaper();
+
+  /** Determine how long the background thread can sleep until the next idle
+   *  association expires. The caller must hold the mutex.
+   *  @param now [in] current time
+   *  @return delay in milliseconds, 0 if an idle association has already
+   *    expired, -1 if there is no idle association that can expire
+   */
+  long getReaperDelay(const time_t now) const;
+
+  /** Remove idle associations from the internal list that should be released.
+   *  Idle associations are expected in the order of their last use (most
+   *  recent first), so a single pass is sufficient. The caller must hold the
+   *  mutex.
+   *  @param now [in] current time
+   *  @param all [in] remove all idle associations, if OFTrue
+   *  @param scus [out] list to which the removed SCUs are appended
+   */
+  void removeIdleEntries(const time_t now,
+                         const OFBool all,
+                         OFList<DcmSCU *> &scus);
+
+  /// mutex that guards the list of associations and the settings
+  mutable OFMutex m_mutex;
+  /// list of all associations managed by the pool (idle ones sorted by last use, most recent first)
+  OFList<Entry *> m_entries;
+  /// idle timeout in seconds (0 = unlimited)
+  Uint32 m_idleTimeout;
+  /// maximum number of idle associations per peer
+  size_t m_maxIdle;
+  /// minimum idle time in seconds before a C-ECHO check (0 = disabled)
+  Uint32 m_echoInterval;
+  /// background thread releasing expired idle associations (NULL if not started)
+  Reaper *m_reaper;
+  /// flag telling the background thread to terminate
+  OFBool m_stopReaper;
+
+  // private undefined copy constructor
+  DcmSCUPool(const DcmSCUPool &);
+
+  // private undefined assignment operator
+  DcmSCUPool &operator=(const DcmSCUPool &);
+};
+
+#endif // SCUPOOL_H
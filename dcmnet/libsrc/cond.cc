@@ -83,6 +83,8 @@ makeOFConditionConst(NET_EC_NoSOPInstancesToSend,            OFM_dcmnet, 1007, O
 makeOFConditionConst(NET_EC_NoSuchSOPInstance,               OFM_dcmnet, 1008, OF_error, "No such SOP instance");
 makeOFConditionConst(NET_EC_InvalidDatasetPointer,           OFM_dcmnet, 1009, OF_error, "Invalid dataset pointer");
 makeOFConditionConst(NET_EC_AlreadyConnected,                OFM_dcmnet, 1010, OF_error, "Already connected");
+makeOFConditionConst(NET_EC_UnknownSCU,                      OFM_dcmnet, 1011, OF_error, "Unknown SCU");
+makeOFConditionConst(NET_EC_AsyncRequestPending,             OFM_dcmnet, 1012, OF_error, "Asynchronous request pending");
 makeOFConditionConst(NET_EC_InsufficientPortPrivileges,      OFM_dcmnet, 1023, OF_error, "Insufficient port privileges");
 // codes 1024 to 1073 are used for the association negotiation profile classes
 makeOFConditionConst(NET_EC_SCPBusy,                         OFM_dcmnet, 1074, OF_error, "SCP is busy");
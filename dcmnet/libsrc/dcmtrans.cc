@@ -43,6 +43,15 @@ BEGIN_EXTERN_C
 #ifdef HAVE_SYS_SELECT_H
 #include <sys/select.h>
 #endif
+#ifdef HAVE_NETINET_IN_SYSTM_H
+#include <netinet/in_systm.h>   /* prerequisite for netinet/in.h on NeXT */
+#endif
+#ifdef HAVE_NETINET_IN_H
+#include <netinet/in.h>         /* prerequisite for netinet/tcp.h on NeXT */
+#endif
+#ifdef HAVE_NETINET_TCP_H
+#include <netinet/tcp.h>        /* for TCP_CORK */
+#endif
 END_EXTERN_C
 
 #ifdef HAVE_WINDOWS_H
@@ -115,6 +124,40 @@ DcmTransportConnection::~DcmTransportConnection()
 {
 }
 
+OFBool DcmTransportConnection::setTCPCork(OFBool cork)
+{
+#if defined(TCP_CORK) && !defined(HAVE_GUSI_H)
+  if (theSocket >= 0)
+  {
+    // preserve errno, which may still be needed by the caller for an error message
+    const int savedErrno = errno;
+    int value = cork ? 1 : 0;
+    const OFBool result = (setsockopt(theSocket, IPPROTO_TCP, TCP_CORK, (char *) &value, sizeof(value)) == 0);
+    errno = savedErrno;
+    return result;
+  }
+#else
+  (void) cork;
+#endif
+  return OFFalse;
+}
+
+OFBool DcmTransportConnection::setTCPQuickAck()
+{
+#if defined(TCP_QUICKACK) && !defined(HAVE_GUSI_H)
+  if (theSocket >= 0)
+  {
+    // preserve errno, which may still be needed by the caller for an error message
+    const int savedErrno = errno;
+    int value = 1;
+    const OFBool result = (setsockopt(theSocket, IPPROTO_TCP, TCP_QUICKACK, (char *) &value, sizeof(value)) == 0);
+    errno = savedErrno;
+    return result;
+  }
+#endif
+  return OFFalse;
+}
+
 OFBool DcmTransportConnection::safeSelectReadableAssociation(DcmTransportConnection *connections[], int connCount, int timeout)
 {
   int numberOfRounds = timeout+1;
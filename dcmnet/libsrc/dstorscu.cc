@@ -23,12 +23,19 @@
 #include "dcmtk/config/osconfig.h"    /* make sure OS specific configuration is included first */
 
 #include "dcmtk/ofstd/ofdatime.h"
+#include "dcmtk/ofstd/ofvector.h"
+#include "dcmtk/ofstd/ofmap.h"
 #include "dcmtk/dcmdata/dccodec.h"
+#include "dcmtk/dcmdata/dcdeftag.h"
 #include "dcmtk/dcmdata/dcfilefo.h"
 #include "dcmtk/dcmdata/dcdatutl.h"
 #include "dcmtk/dcmnet/dstorscu.h"
 #include "dcmtk/dcmnet/diutil.h"
 
+#ifdef WITH_THREADS
+#include "dcmtk/ofstd/ofthread.h"
+#endif
+
 
 // these are private DIMSE status codes of the class "pending"
 #define STATUS_STORE_Pending_NoPresentationContext 0xffff
@@ -130,6 +137,249 @@ void DcmStorageSCU::TransferEntry::Init()
 }
 
 
+// implementation of the internal structure for the state shared by parallel workers
+
+struct DcmStorageSCU::ParallelContext
+{
+    /** constructor
+     *  @param  master  reference to the object whose transfer list is sent
+     */
+    ParallelContext(DcmStorageSCU &master)
+      : Master(master),
+        Shards(),
+        NextShard(0),
+        StopRequested(OFFalse),
+        Status(EC_Normal)
+#ifdef WITH_THREADS
+      , Mutex()
+#endif
+    {
+    }
+
+    /** lock the shared state (if compiled with thread support)
+     */
+    void lock()
+    {
+#ifdef WITH_THREADS
+        Mutex.lock();
+#endif
+    }
+
+    /** unlock the shared state (if compiled with thread support)
+     */
+    void unlock()
+    {
+#ifdef WITH_THREADS
+        Mutex.unlock();
+#endif
+    }
+
+    /// object whose transfer list is sent (and whose counters are updated)
+    DcmStorageSCU &Master;
+    /// list of shards, each of which contains entries from the master's transfer list
+    OFVector<OFList<TransferEntry *> > Shards;
+    /// index of the next shard to be processed
+    size_t NextShard;
+    /// flag indicating whether the workers should stop after the current SOP instance
+    OFBool StopRequested;
+    /// status of the first worker that failed (EC_Normal if none)
+    OFCondition Status;
+#ifdef WITH_THREADS
+    /// mutex protecting all of the above and the master object
+    OFMutex Mutex;
+#endif
+};
+
+
+// implementation of the internal class for a worker sending on one of the parallel associations
+
+class DcmStorageSCU::ParallelWorker
+  : public DcmStorageSCU
+#ifdef WITH_THREADS
+  , public OFThread
+#endif
+{
+
+  public:
+
+    /** constructor.  Copies the network parameters and modes from the master object.
+     *  @param  context  reference to the shared state of all workers
+     */
+    ParallelWorker(ParallelContext &context)
+      : DcmStorageSCU(),
+#ifdef WITH_THREADS
+        OFThread(),
+#endif
+        Context(context)
+    {
+        const DcmStorageSCU &master = Context.Master;
+        setPeerHostName(master.getPeerHostName());
+        setPeerPort(master.getPeerPort());
+        setPeerAETitle(master.getPeerAETitle());
+        setAETitle(master.getAETitle());
+        setMaxReceivePDULength(master.getMaxReceivePDULength());
+        setACSETimeout(master.getACSETimeout());
+        setDIMSETimeout(master.getDIMSETimeout());
+        setDIMSEBlockingMode(master.getDIMSEBlockingMode());
+        setVerbosePCMode(master.getVerbosePCMode());
+        setDatasetConversionMode(master.getDatasetConversionMode());
+        setProgressNotificationMode(master.getProgressNotificationMode());
+        DecompressionMode = master.DecompressionMode;
+        HaltOnUnsuccessfulStoreMode = master.HaltOnUnsuccessfulStoreMode;
+        AllowIllegalProposalMode = master.AllowIllegalProposalMode;
+        MoveOriginatorAETitle = master.MoveOriginatorAETitle;
+        MoveOriginatorMsgID = master.MoveOriginatorMsgID;
+    }
+
+    /** destructor
+     */
+    virtual ~ParallelWorker()
+    {
+        // the transfer entries are owned by the master, so do not delete them
+        TransferList.clear();
+        CurrentTransferEntry = TransferList.begin();
+    }
+
+    /** process shards from the shared queue until there are no more shards or the
+     *  sending process should be stopped
+     */
+    void process()
+    {
+        OFList<TransferEntry *> *shard;
+        while ((shard = nextShard()) != NULL)
+        {
+            OFCondition status = sendShard(*shard);
+            if (status.bad())
+            {
+                Context.lock();
+                // remember the first error and make sure that no further shards are processed
+                // (unless the transfer should be continued with the next SOP instance anyway)
+                if (Context.Status.good())
+                    Context.Status = status;
+                if (HaltOnUnsuccessfulStoreMode)
+                    Context.StopRequested = OFTrue;
+                Context.unlock();
+            }
+        }
+    }
+
+  protected:
+
+#ifdef WITH_THREADS
+    /** main method of the worker thread
+     */
+    virtual void run()
+    {
+        process();
+    }
+#endif
+
+    /** forward notification to the master object (serialized with the other workers)
+     *  @param  transferEntry  reference to current transfer entry that has been processed
+     */
+    virtual void notifySOPInstanceSent(const TransferEntry &transferEntry)
+    {
+        Context.lock();
+        Context.Master.notifySOPInstanceSent(transferEntry);
+        Context.unlock();
+    }
+
+    /** ask the master object whether to stop (serialized with the other workers)
+     *  @return OFTrue if sending should stop after current SOP instance, OFFalse otherwise.
+     */
+    virtual OFBool shouldStopAfterCurrentSOPInstance()
+    {
+        Context.lock();
+        if (!Context.StopRequested && Context.Master.shouldStopAfterCurrentSOPInstance())
+            Context.StopRequested = OFTrue;
+        const OFBool result = Context.StopRequested;
+        Context.unlock();
+        return result;
+    }
+
+  private:
+
+    /** get the next shard from the shared queue
+     *  @return pointer to the next shard, NULL if there are none left (or if stopped)
+     */
+    OFList<TransferEntry *> *nextShard()
+    {
+        OFList<TransferEntry *> *shard = NULL;
+        Context.lock();
+        if (!Context.StopRequested && (Context.NextShard < Context.Shards.size()))
+            shard = &Context.Shards[Context.NextShard++];
+        Context.unlock();
+        return shard;
+    }
+
+    /** send all SOP instances of the given shard on one or more new associations
+     *  @param  shard  list of transfer entries to be sent
+     *  @return status, EC_Normal if successful, an error code otherwise
+     */
+    OFCondition sendShard(const OFList<TransferEntry *> &shard)
+    {
+        OFCondition status;
+        // borrow the transfer entries from the master
+        TransferList = shard;
+        CurrentTransferEntry = TransferList.begin();
+        while ((status = addPresentationContexts()).good())
+        {
+            status = initNetwork();
+            if (status.bad())
+                break;
+            // association numbers are unique across all workers
+            Context.lock();
+            AssociationCounter = Context.Master.AssociationCounter++;
+            Context.unlock();
+            DCMNET_DEBUG("starting association #" << (AssociationCounter + 1) << " for "
+                << TransferList.size() << " SOP instances");
+            status = negotiateAssociation();
+            if (status.bad())
+            {
+                // continue with a new association if the rejected SOP instances could be skipped
+                if (status == NET_EC_NoAcceptablePresentationContexts)
+                    continue;
+                break;
+            }
+            status = sendSOPInstances();
+            if (status.bad())
+            {
+                // handle certain error conditions (initiated by the communication peer)
+                if (status == DUL_PEERREQUESTEDRELEASE)
+                    closeAssociation(DCMSCU_PEER_REQUESTED_RELEASE);
+                else if (status == DUL_PEERABORTEDASSOCIATION)
+                    closeAssociation(DCMSCU_PEER_ABORTED_ASSOCIATION);
+                else
+                    abortAssociation();
+                break;
+            }
+            releaseAssociation();
+            // check whether the sending process should be stopped
+            Context.lock();
+            const OFBool stop = Context.StopRequested;
+            Context.unlock();
+            if (stop)
+                break;
+        }
+        // all SOP instances of this shard have been processed
+        if (status == NET_EC_NoPresentationContextsDefined)
+            status = EC_Normal;
+        TransferList.clear();
+        CurrentTransferEntry = TransferList.begin();
+        return status;
+    }
+
+    /// reference to the state shared by all workers
+    ParallelContext &Context;
+
+    // private undefined copy constructor
+    ParallelWorker(const ParallelWorker &);
+
+    // private undefined assignment operator
+    ParallelWorker &operator=(const ParallelWorker &);
+};
+
+
 // implementation of the main interface class
 
 DcmStorageSCU::DcmStorageSCU()
@@ -869,7 +1119,13 @@ OFCondition DcmStorageSCU::sendSOPInstances()
                         MoveOriginatorAETitle, MoveOriginatorMsgID);
                     // store some further information (even in case of error)
                     (*CurrentTransferEntry)->AssociationNumber = AssociationCounter;
-                    (*CurrentTransferEntry)->NetworkTransferSyntax = dataset->getCurrentXfer();
+                    // the dataset itself is not converted if the pixel data is decompressed while sending
+                    OFString abstractSyntax, transferSyntax;
+                    findPresentationContext((*CurrentTransferEntry)->PresentationContextID, abstractSyntax, transferSyntax);
+                    if (!transferSyntax.empty())
+                        (*CurrentTransferEntry)->NetworkTransferSyntax = DcmXfer(transferSyntax.c_str()).getXfer();
+                    else
+                        (*CurrentTransferEntry)->NetworkTransferSyntax = dataset->getCurrentXfer();
                 }
                 // if it was successful (i.e. even if DIMSE status is not 0x0000 = success) ...
                 if (status.good())
@@ -921,6 +1177,111 @@ OFCondition DcmStorageSCU::sendSOPInstances()
 }
 
 
+OFCondition DcmStorageSCU::sendSOPInstancesInParallel(const size_t numAssociations,
+                                                     const OFBool keepStudyOrder)
+{
+    // check whether there are any instances in the transfer list
+    if (TransferList.empty())
+        return NET_EC_NoSOPInstancesToSend;
+    // the workers use their own associations
+    if (isConnected())
+        return NET_EC_AlreadyConnected;
+    ParallelContext context(*this);
+    const size_t numToBeSent = getNumberOfSOPInstancesToBeSent();
+#ifdef WITH_THREADS
+    const size_t numWorkers = (numAssociations > 0) ? numAssociations : 1;
+#else
+    const size_t numWorkers = 1;
+#endif
+    OFListIterator(TransferEntry *) transferEntry = TransferList.begin();
+    OFListConstIterator(TransferEntry *) lastEntry = TransferList.end();
+    if (keepStudyOrder)
+    {
+        // create one shard per study, in the order of the first occurrence of each study
+        OFMap<OFString, size_t> shardIndex;
+        while (transferEntry != lastEntry)
+        {
+            if (!(*transferEntry)->RequestSent)
+            {
+                OFString studyUID;
+                if ((*transferEntry)->Filename.isEmpty())
+                {
+                    if ((*transferEntry)->Dataset != NULL)
+                        (*transferEntry)->Dataset->findAndGetOFString(DCM_StudyInstanceUID, studyUID);
+                } else {
+                    DcmFileFormat fileformat;
+                    // do not load large element values, they are not needed here
+                    if (fileformat.loadFile((*transferEntry)->Filename, EXS_Unknown, EGL_noChange,
+                        64 /* maxReadLength */, (*transferEntry)->FileReadMode).good())
+                    {
+                        fileformat.getDataset()->findAndGetOFString(DCM_StudyInstanceUID, studyUID);
+                    }
+                }
+                size_t index;
+                OFMap<OFString, size_t>::const_iterator shard = shardIndex.find(studyUID);
+                if (shard == shardIndex.end())
+                {
+                    index = context.Shards.size();
+                    shardIndex[studyUID] = index;
+                    context.Shards.push_back(OFList<TransferEntry *>());
+                } else
+                    index = shard->second;
+                context.Shards[index].push_back(*transferEntry);
+            }
+            ++transferEntry;
+        }
+    } else {
+        // create about four shards per association, each with consecutive entries, so that
+        // faster associations can take over some of the work of the slower ones
+        const size_t numShards = numWorkers * 4;
+        const size_t shardSize = (numToBeSent + numShards - 1) / numShards;
+        while (transferEntry != lastEntry)
+        {
+            if (!(*transferEntry)->RequestSent)
+            {
+                if (context.Shards.empty() || (context.Shards.back().size() >= shardSize))
+                    context.Shards.push_back(OFList<TransferEntry *>());
+                context.Shards.back().push_back(*transferEntry);
+            }
+            ++transferEntry;
+        }
+    }
+    DCMNET_DEBUG("sending " << numToBeSent << " SOP instances in " << context.Shards.size()
+        << " shards using up to " << numWorkers << " concurrent associations");
+    // create the workers (before starting any of them)
+    OFVector<ParallelWorker *> workers;
+    for (size_t i = 0; (i < numWorkers) && (i < context.Shards.size()); ++i)
+        workers.push_back(new ParallelWorker(context));
+#ifdef WITH_THREADS
+    OFVector<ParallelWorker *>::iterator worker;
+    for (worker = workers.begin(); worker != workers.end(); ++worker)
+    {
+        if ((*worker)->start() != 0)
+        {
+            DCMNET_ERROR("cannot start worker thread, sending in the current thread instead");
+            (*worker)->process();
+        }
+    }
+    for (worker = workers.begin(); worker != workers.end(); ++worker)
+    {
+        (*worker)->join();
+        PresentationContextCounter += (*worker)->PresentationContextCounter;
+        delete *worker;
+    }
+#else
+    if (!workers.empty())
+    {
+        workers.front()->process();
+        PresentationContextCounter += workers.front()->PresentationContextCounter;
+        delete workers.front();
+    }
+#endif
+    // the next call of sendSOPInstances() or addPresentationContexts() starts from the beginning
+    CurrentTransferEntry = TransferList.begin();
+    return context.Status;
+}
+
+
 void DcmStorageSCU::notifySOPInstanceSent(const TransferEntry & /*transferEntry*/)
 {
     // do nothing in the default implementation
@@ -104,6 +104,8 @@ DUL_dataWaiting(DUL_ASSOCIATIONKEY * callerAssociation, int timeout)
 {
     PRIVATE_ASSOCIATIONKEY * association = (PRIVATE_ASSOCIATIONKEY *)callerAssociation;
     if ((association==NULL)||(association->connection == NULL)) return OFFalse;
+    /* PDVs that have already been received but not yet been picked up */
+    if (association->pdvIndex != -1) return OFTrue;
     return association->connection->networkDataAvailable(timeout);
 }
 
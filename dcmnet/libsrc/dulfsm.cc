@@ -278,7 +278,9 @@ defragmentTCP(DcmTransportConnection *connection, DUL_BLOCKOPTIONS block, time_t
 
 static OFString dump_pdu(const char *type, void *buffer, unsigned long length);
 
-static void setTCPBufferLength(int sock);
+static void setTCPCork(PRIVATE_ASSOCIATIONKEY ** association, OFBool cork);
+static void rearmTCPQuickAck(PRIVATE_ASSOCIATIONKEY ** association);
+
 OFCondition
 translatePresentationContextList(LST_HEAD ** internalList,
                                  LST_HEAD ** SCUSCPRoleList,
@@ -2432,6 +2434,7 @@ requestAssociationTCP(PRIVATE_NETWORKKEY ** network,
         }
 #endif
         setTCPBufferLength(s);
+        setTCPQuickAck(s);
 
 #ifndef DONT_DISABLE_NAGLE_ALGORITHM
         /*
@@ -3038,6 +3041,9 @@ writeDataPDU(PRIVATE_ASSOCIATIONKEY ** association,
     OFCondition cond = streamDataPDUHead(pdu, head, sizeof(head), &length);
     if (cond.bad()) return cond;
 
+    /* if enabled, hold back partial segments until the complete PDU has been written */
+    setTCPCork(association, OFTrue);
+
     /* send the PDU head information (see above) */
     do
     {
@@ -3047,6 +3053,7 @@ writeDataPDU(PRIVATE_ASSOCIATIONKEY ** association,
     /* if not all head information was sent, return an error */
     if ((unsigned long) nbytes != length)
     {
+        setTCPCork(association, OFFalse);
         char buf[256];
         OFString msg = "TCP I/O Error (";
         msg += OFStandard::strerror(errno, buf, sizeof(buf));
@@ -3061,6 +3068,9 @@ writeDataPDU(PRIVATE_ASSOCIATIONKEY ** association,
         size_t(pdu->presentationDataValue.length - 2)) : 0;
     } while (nbytes == -1 && errno == EINTR);
 
+    /* flush the PDU */
+    setTCPCork(association, OFFalse);
+
         /* if not all head information was sent, return an error */
     if ((unsigned long) nbytes != pdu->presentationDataValue.length - 2)
     {
@@ -3559,6 +3569,9 @@ readPDUBodyTCP(PRIVATE_ASSOCIATIONKEY ** association,
       cond = defragmentTCP((*association)->connection,
                          block, (*association)->timerStart, timeout,
                          buffer, (*association)->nextPDULength, &length);
+      /* the kernel might have switched back to delayed acknowledgements */
+      if (cond.good())
+          rearmTCPQuickAck(association);
     }
 
     /* return result value */
@@ -3716,10 +3729,13 @@ dump_pdu(const char *type, void *buffer, unsigned long length)
 /* setTCPBufferLength
 **
 ** Purpose:
-**      This routine checks for the existence of an environment
-**      variable (TCP_BUFFER_LENGTH).  If that variable is defined (and
-**      is a legal integer), this routine sets the socket SNDBUF and RCVBUF
-**      variables to the value defined in TCP_BUFFER_LENGTH.
+**      This routine sets the socket SNDBUF and RCVBUF variables if requested.
+**      The sizes are taken from the global variables dcmSocketSendBufferSize
+**      and dcmSocketReceiveBufferSize. If a global variable is 0 (default),
+**      the value of the environment variable TCP_BUFFER_LENGTH is used if
+**      defined (and a legal integer). If neither is set or the resulting
+**      value is not positive, the socket option is left untouched so that
+**      the operating system's automatic buffer tuning remains in effect.
 **
 ** Parameter Dictionary:
 **      sock            Socket descriptor (identifier)
@@ -3732,39 +3748,161 @@ dump_pdu(const char *type, void *buffer, unsigned long length)
 ** Algorithm:
 **      Description of the algorithm (optional) and any other notes.
 */
-static void
+void
 setTCPBufferLength(int sock)
 {
     char *TCPBufferLength;
     int bufLen;
+    int sendBufLen;
+    int recvBufLen;
 
     /*
-     * Use a 64K default socket buffer length, fitting the MTU size of the loopback device implementation
-     * in recent Linux kernel versions.
+     * By default, the socket buffer length is not changed, i.e. the buffer sizes are tuned
+     * automatically by the operating system (which is what fast networks with high latency need).
      * Different environments, particularly slower networks may require different values for optimal
      * performance.
      */
 #ifdef HAVE_GUSI_H
     /* GUSI always returns an error for setsockopt(...) */
 #else
-    bufLen = 65536; // a socket buffer size of 64K gives best throughput for image transmission
+    bufLen = -1; // do not set the socket buffer size
     if ((TCPBufferLength = getenv("TCP_BUFFER_LENGTH")) != NULL) {
         if (sscanf(TCPBufferLength, "%d", &bufLen) != 1)
         {
             DCMNET_WARN("DULFSM: cannot parse environment variable TCP_BUFFER_LENGTH=" << TCPBufferLength);
+            bufLen = -1;
         }
     }
+    sendBufLen = OFstatic_cast(int, dcmSocketSendBufferSize.get());
+    if (sendBufLen == 0) sendBufLen = bufLen;
+    recvBufLen = OFstatic_cast(int, dcmSocketReceiveBufferSize.get());
+    if (recvBufLen == 0) recvBufLen = bufLen;
 #if defined(SO_SNDBUF) && defined(SO_RCVBUF)
-    (void) setsockopt(sock, SOL_SOCKET, SO_SNDBUF, (char *) &bufLen, sizeof(bufLen));
-    (void) setsockopt(sock, SOL_SOCKET, SO_RCVBUF, (char *) &bufLen, sizeof(bufLen));
+    if (sendBufLen > 0)
+    {
+        if (setsockopt(sock, SOL_SOCKET, SO_SNDBUF, (char *) &sendBufLen, sizeof(sendBufLen)) < 0)
+        {
+            char buf[256];
+            DCMNET_WARN("DULFSM: cannot set socket send buffer size to " << sendBufLen << ": "
+                << OFStandard::strerror(errno, buf, sizeof(buf)));
+        }
+    }
+    if (recvBufLen > 0)
+    {
+        if (setsockopt(sock, SOL_SOCKET, SO_RCVBUF, (char *) &recvBufLen, sizeof(recvBufLen)) < 0)
+        {
+            char buf[256];
+            DCMNET_WARN("DULFSM: cannot set socket receive buffer size to " << recvBufLen << ": "
+                << OFStandard::strerror(errno, buf, sizeof(buf)));
+        }
+    }
 #else
-     DCMNET_WARN("DULFSM: setTCPBufferLength: "
+    (void) sock;
+    if ((sendBufLen > 0) || (recvBufLen > 0))
+    {
+        DCMNET_WARN("DULFSM: setTCPBufferLength: "
             "cannot set TCP buffer length socket option: "
             "code disabled because SO_SNDBUF and SO_RCVBUF constants are unknown");
+    }
 #endif // SO_SNDBUF and SO_RCVBUF
 #endif // HAVE_GUSI_H
 }
 
+/* setTCPQuickAck
+**
+** Purpose:
+**      This routine enables the TCP_QUICKACK socket option if requested
+**      through the global variable dcmEnableTCPQuickAck.
+**
+** Parameter Dictionary:
+**      sock            Socket descriptor (identifier)
+**
+** Return Values:
+**      None
+**
+** Notes:
+**      Failure to set the option is not considered an error.
+**
+** Algorithm:
+**      Description of the algorithm (optional) and any other notes.
+*/
+void
+setTCPQuickAck(int sock)
+{
+    if (dcmEnableTCPQuickAck.get())
+    {
+#if defined(TCP_QUICKACK) && !defined(HAVE_GUSI_H)
+        int quickAck = 1;
+        if (setsockopt(sock, IPPROTO_TCP, TCP_QUICKACK, (char *) &quickAck, sizeof(quickAck)) < 0)
+        {
+            char buf[256];
+            DCMNET_WARN("DULFSM: cannot set TCP_QUICKACK socket option: "
+                << OFStandard::strerror(errno, buf, sizeof(buf)));
+        }
+#else
+        (void) sock;
+        DCMNET_WARN("DULFSM: setTCPQuickAck: "
+            "cannot set TCP_QUICKACK socket option: not supported on this platform");
+#endif
+    }
+}
+
+/* rearmTCPQuickAck
+**
+** Purpose:
+**      This routine sets the TCP_QUICKACK socket option again on the
+**      connection of the given association if requested through the global
+**      variable dcmEnableTCPQuickAck.
+**
+** Parameter Dictionary:
+**      association     Handle to the Association
+**
+** Return Values:
+**      None
+**
+** Notes:
+**      On Linux, TCP_QUICKACK is not permanent: the kernel may switch back
+**      to delayed acknowledgements after the next ACK has been sent.
+**      Therefore, the option is set again after each PDU that has been read.
+**      Failure to set the option is not considered an error.
+**
+** Algorithm:
+**      Description of the algorithm (optional) and any other notes.
+*/
+static void
+rearmTCPQuickAck(PRIVATE_ASSOCIATIONKEY ** association)
+{
+    if (dcmEnableTCPQuickAck.get() && (*association)->connection)
+        (void) (*association)->connection->setTCPQuickAck();
+}
+
+/* setTCPCork
+**
+** Purpose:
+**      This routine sets or clears the TCP_CORK socket option on the
+**      connection of the given association if requested through the global
+**      variable dcmEnableTCPCork.
+**
+** Parameter Dictionary:
+**      association     Handle to the Association
+**      cork            OFTrue to set, OFFalse to clear the option
+**
+** Return Values:
+**      None
+**
+** Notes:
+**      Failure to set the option is not considered an error.
+**
+** Algorithm:
+**      Description of the algorithm (optional) and any other notes.
+*/
+static void
+setTCPCork(PRIVATE_ASSOCIATIONKEY ** association, OFBool cork)
+{
+    if (dcmEnableTCPCork.get() && (*association)->connection)
+        (void) (*association)->connection->setTCPCork(cork);
+}
+
 /* translatePresentationContextList
 **
 ** Purpose:
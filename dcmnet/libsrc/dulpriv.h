@@ -110,5 +110,7 @@ parseAssociate(unsigned char *buf, unsigned long len,
 OFCondition
 PRV_NextPDUType(PRIVATE_ASSOCIATIONKEY ** association,
 		DUL_BLOCKOPTIONS block, int timeout, unsigned char *type);
+void setTCPBufferLength(int sock);
+void setTCPQuickAck(int sock);
 
 #endif
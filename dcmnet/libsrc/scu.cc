@@ -25,7 +25,11 @@
 #include "dcmtk/dcmnet/diutil.h"    /* for dcmnet logger */
 #include "dcmtk/dcmdata/dcuid.h"    /* for dcmFindUIDName() */
 #include "dcmtk/dcmdata/dcostrmf.h" /* for class DcmOutputFileStream */
+#include "dcmtk/dcmdata/dcistrmp.h" /* for class DcmInputPixelStreamFactory */
+#include "dcmtk/dcmdata/dcpixel.h"  /* for class DcmPixelData */
+#include "dcmtk/dcmdata/dcvrobow.h" /* for class DcmOtherByteOtherWord */
 #include "dcmtk/ofstd/ofmem.h"      /* for OFunique_ptr */
+#include "dcmtk/ofstd/ofvector.h"   /* for OFVector */
 
 #ifdef WITH_ZLIB
 #include <zlib.h>                   /* for zlibVersion() */
@@ -53,7 +57,8 @@ DcmSCU::DcmSCU() :
   m_storageMode(DCMSCU_STORAGE_DISK),
   m_verbosePCMode(OFFalse),
   m_datasetConversionMode(OFFalse),
-  m_progressNotificationMode(OFTrue)
+  m_progressNotificationMode(OFTrue),
+  m_asyncHandler(NULL)
 {
 
 #ifdef HAVE_GUSI_H
@@ -94,6 +99,8 @@ void DcmSCU::freeNetwork()
   // Cleanup old DIMSE request if any
   delete m_openDIMSERequest;
   m_openDIMSERequest = NULL;
+  // Forget about outstanding asynchronous request (if any)
+  m_asyncHandler = NULL;
 }
 
 
@@ -678,6 +685,64 @@ OFCondition DcmSCU::sendECHORequest(const T_ASC_PresentationContextID presID)
 /*                            C-STORE functionality                          */
 /* ************************************************************************* */
 
+// Creates a copy of the given dataset in which the compressed pixel data is
+// replaced by an element whose uncompressed value is decompressed frame by frame
+// while the dataset is written. Returns NULL if this is not possible.
+static DcmDataset *createStreamingDataset(DcmDataset *dataset,
+                                          const E_TransferSyntax netXfer)
+{
+  DcmElement *elem = NULL;
+  if (dataset->findAndGetElement(DCM_PixelData, elem).bad() || (elem->ident() != EVR_PixelData))
+    return NULL;
+  DcmPixelData *pixelData = OFstatic_cast(DcmPixelData *, elem);
+  /* only needed if pixel data is compressed and not available uncompressed */
+  if (DcmXfer(netXfer).isEncapsulated() || pixelData->hasRepresentation(netXfer))
+    return NULL;
+  Uint32 frameSize = 0;
+  OFString colorModel;
+  if (pixelData->getUncompressedFrameSize(dataset, frameSize).bad() || (frameSize == 0) ||
+      pixelData->getDecompressedColorModel(dataset, colorModel).bad())
+    return NULL;
+  Sint32 numberOfFrames = 1;
+  if (dataset->findAndGetSint32(DCM_NumberOfFrames, numberOfFrames).bad() || (numberOfFrames < 1))
+    numberOfFrames = 1;
+  const Uint32 frames = OFstatic_cast(Uint32, numberOfFrames);
+  /* the value length must fit into 32 bits (and must be even) */
+  if (frameSize > (0xfffffffeUL / frames))
+    return NULL;
+  Uint32 length = frames * frameSize;
+  if (length & 1) ++length;
+  Uint16 bitsAllocated = 0;
+  dataset->findAndGetUint16(DCM_BitsAllocated, bitsAllocated);
+
+  /* copy all elements except for the pixel data */
+  DcmDataset *result = new DcmDataset();
+  DcmObject *obj = NULL;
+  while ((obj = dataset->nextInContainer(obj)) != NULL)
+  {
+    if (obj->getTag() != DCM_PixelData)
+      result->insert(OFstatic_cast(DcmElement *, obj->clone()));
+  }
+  DcmOtherByteOtherWord *newPixelData = new DcmOtherByteOtherWord(
+    DcmTag(DCM_PixelData, (bitsAllocated > 8) ? EVR_OW : EVR_OB));
+  newPixelData->createValueFromTempFile(new DcmInputPixelStreamFactory(dataset, pixelData, frames, frameSize),
+    length, gLocalByteOrder);
+  result->insert(newPixelData);
+  OFString photometricInterpretation;
+  dataset->findAndGetOFString(DCM_PhotometricInterpretation, photometricInterpretation);
+  if (!colorModel.empty() && (colorModel != photometricInterpretation))
+    result->putAndInsertOFStringArray(DCM_PhotometricInterpretation, colorModel);
+  /* convert nested pixel data (e.g. icon images), if any */
+  result->chooseRepresentation(netXfer, NULL);
+  if (!result->canWriteXfer(netXfer))
+  {
+    delete result;
+    return NULL;
+  }
+  return result;
+}
+
+
 // Sends C-STORE request to another DICOM application
 OFCondition DcmSCU::sendSTORERequest(const T_ASC_PresentationContextID presID,
                                      const OFFilename &dicomFile,
@@ -760,6 +825,8 @@ OFCondition DcmSCU::sendSTORERequest(const T_ASC_PresentationContextID presID,
     req->opts |= O_STORE_MOVEORIGINATORID;
   }
 
+  /* Dataset with streamed pixel data (if decompressed while sending) */
+  DcmDataset *streamingDataset = NULL;
   /* If no presentation context is specified by the caller ... */
   if (pcid == 0)
   {
@@ -788,7 +855,15 @@ OFCondition DcmSCU::sendSTORERequest(const T_ASC_PresentationContextID presID,
       {
         DCMNET_INFO("Converting transfer syntax: " << xfer.getXferName() << " -> "
           << netXfer.getXferName());
-        dataset->chooseRepresentation(netXfer.getXfer(), NULL);
+        /* decompress frame by frame while sending, if possible */
+        streamingDataset = createStreamingDataset(dataset, netXfer.getXfer());
+        if (streamingDataset != NULL)
+        {
+          DCMNET_DEBUG("Pixel data is decompressed frame by frame while sending");
+          dataset = streamingDataset;
+        }
+        else
+          dataset->chooseRepresentation(netXfer.getXfer(), NULL);
       }
     }
   }
@@ -799,6 +874,7 @@ OFCondition DcmSCU::sendSTORERequest(const T_ASC_PresentationContextID presID,
     OFString xferName = xfer.getXferName();
     DCMNET_ERROR("No presentation context found for sending C-STORE with SOP Class / Transfer Syntax: "
       << sopClassName << " / " << xferName);
+    delete streamingDataset;
     delete fileformat;
     return DIMSE_NOVALIDPRESENTATIONCONTEXTID;
   }
@@ -813,6 +889,7 @@ OFCondition DcmSCU::sendSTORERequest(const T_ASC_PresentationContextID presID,
       << dcmSOPClassUIDToModality(sopClassUID.c_str(), "OT") << ")");
   }
   cond = sendDIMSEMessage(pcid, &msg, dataset);
+  delete streamingDataset;
   delete fileformat;
   fileformat = NULL;
   if (cond.bad())
@@ -1524,6 +1601,161 @@ void DcmSCU::notifyInstanceStored(const OFString &filename,
 OFCondition DcmSCU::sendFINDRequest(const T_ASC_PresentationContextID presID,
                                     DcmDataset *queryKeys,
                                     OFList<QRResponse*> *responses)
+{
+  if (m_asyncHandler != NULL)
+    return NET_EC_AsyncRequestPending;
+
+  /* Send request */
+  OFCondition cond = sendFINDRequestMessage(presID, queryKeys);
+  if (cond.bad())
+    return cond;
+
+  /* Receive and handle response */
+  OFBool waitForNextResponse = OFTrue;
+  while (waitForNextResponse)
+  {
+    T_ASC_PresentationContextID pcid = presID;
+    QRResponse *response = NULL;
+    cond = receiveFINDResponse(pcid, response);
+    if (cond.bad())
+      return cond;
+    OFunique_ptr<QRResponse> findRSP(response);
+
+    // Handle C-FIND response (has to handle all possible status flags)
+    cond = handleFINDResponse(pcid, findRSP.get(), waitForNextResponse);
+    if (cond.bad())
+    {
+      DCMNET_WARN("Unable to handle C-FIND response correctly: " << cond.text() << " (ignored)");
+      // don't return here but trust the "waitForNextResponse" variable
+    }
+    // if response could be handled successfully, add it to response list
+    else
+    {
+      if (responses != NULL) // only add if desired by caller
+        responses->push_back(findRSP.release());
+    }
+  }
+  /* All responses received or break signal occurred */
+  return EC_Normal;
+}
+
+
+// Sends C-FIND request without waiting for the responses
+OFCondition DcmSCU::sendFINDRequestAsync(const T_ASC_PresentationContextID presID,
+                                         DcmDataset *queryKeys,
+                                         DcmSCUAsyncHandler *handler)
+{
+  if (handler == NULL)
+    return EC_IllegalParameter;
+  if (m_asyncHandler != NULL)
+    return NET_EC_AsyncRequestPending;
+
+  OFCondition cond = sendFINDRequestMessage(presID, queryKeys);
+  if (cond.good())
+    m_asyncHandler = handler;
+  return cond;
+}
+
+
+OFBool DcmSCU::hasPendingAsyncRequest() const
+{
+  return (m_asyncHandler != NULL);
+}
+
+
+// Receives responses for the outstanding asynchronous request
+OFCondition DcmSCU::handleAsyncResponse()
+{
+  if (m_asyncHandler == NULL)
+    return EC_Normal;
+  if (!isConnected())
+  {
+    completeAsyncRequest(DIMSE_ILLEGALASSOCIATION);
+    return DIMSE_ILLEGALASSOCIATION;
+  }
+
+  OFCondition cond;
+  /* handle all responses that are available without waiting (but at least one) */
+  do {
+    T_ASC_PresentationContextID pcid = 0;
+    QRResponse *response = NULL;
+    cond = receiveFINDResponse(pcid, response);
+    if (cond.bad())
+    {
+      completeAsyncRequest(cond);
+      break;
+    }
+    OFBool waitForNextResponse = OFTrue;
+    if (handleFINDResponse(pcid, response, waitForNextResponse).bad())
+      DCMNET_WARN("Unable to handle C-FIND response correctly (ignored)");
+    // the handler takes over ownership of the response
+    m_asyncHandler->notifyFINDResponse(*this, response);
+    if (!waitForNextResponse)
+    {
+      completeAsyncRequest(EC_Normal);
+      break;
+    }
+  } while (isConnected() && ASC_dataWaiting(m_assoc, 0));
+  return cond;
+}
+
+
+// Multiplexes outstanding asynchronous requests of several SCUs
+OFCondition DcmSCU::processAsyncRequests(const OFList<DcmSCU *> &scus,
+                                         const int timeout)
+{
+  OFVector<DcmSCU *> pending;
+  OFVector<T_ASC_Association *> assocs;
+  while (OFTrue)
+  {
+    /* collect SCUs with outstanding requests, handle buffered data right away */
+    pending.clear();
+    OFBool handled = OFFalse;
+    for (OFListConstIterator(DcmSCU *) it = scus.begin(); it != scus.end(); ++it)
+    {
+      DcmSCU *scu = *it;
+      if ((scu == NULL) || !scu->hasPendingAsyncRequest())
+        continue;
+      if (!scu->isConnected() || ASC_dataWaiting(scu->m_assoc, 0))
+      {
+        scu->handleAsyncResponse();
+        handled = OFTrue;
+      }
+      if (scu->hasPendingAsyncRequest())
+        pending.push_back(scu);
+    }
+    if (pending.empty())
+      break;
+    if (handled)
+      continue;
+    /* wait until data is available on any of the associations */
+    assocs.resize(pending.size());
+    for (size_t i = 0; i < pending.size(); ++i)
+      assocs[i] = pending[i]->m_assoc;
+    if (!ASC_selectReadableAssociation(&assocs[0], OFstatic_cast(int, assocs.size()), timeout))
+      return DIMSE_NODATAAVAILABLE;
+    for (size_t j = 0; j < pending.size(); ++j)
+    {
+      if (assocs[j] != NULL)
+        pending[j]->handleAsyncResponse();
+    }
+  }
+  return EC_Normal;
+}
+
+
+void DcmSCU::completeAsyncRequest(const OFCondition &result)
+{
+  DcmSCUAsyncHandler *handler = m_asyncHandler;
+  // reset handler first so that a new request can be sent from within the notification
+  m_asyncHandler = NULL;
+  if (handler != NULL)
+    handler->notifyRequestCompleted(*this, result);
+}
+
+
+OFCondition DcmSCU::sendFINDRequestMessage(const T_ASC_PresentationContextID presID,
+                                           DcmDataset *queryKeys)
 {
   // Do some basic validity checks
   if (!isConnected())
@@ -1539,7 +1771,6 @@ OFCondition DcmSCU::sendFINDRequest(const T_ASC_PresentationContextID presID,
   // Make sure everything is zeroed (especially options)
   bzero((char*)&msg, sizeof(msg));
 
-  DcmDataset* statusDetail = NULL;
   T_DIMSE_C_FindRQ* req = &(msg.msg.CFindRQ);
   // Set type of message
   msg.CommandField = DIMSE_C_FIND_RQ;
@@ -1567,87 +1798,73 @@ OFCondition DcmSCU::sendFINDRequest(const T_ASC_PresentationContextID presID,
   }
   cond = sendDIMSEMessage(pcid, &msg, queryKeys);
   if (cond.bad())
-  {
     DCMNET_ERROR("Failed sending C-FIND request: " << DimseCondition::dump(tempStr, cond));
-    return cond;
-  }
+  return cond;
+}
 
-  /* Receive and handle response */
-  OFBool waitForNextResponse = OFTrue;
-  while (waitForNextResponse)
-  {
-    T_DIMSE_Message rsp;
-    // Make sure everything is zeroed (especially options)
-    bzero((char*)&rsp, sizeof(rsp));
 
-    statusDetail = NULL;
+OFCondition DcmSCU::receiveFINDResponse(T_ASC_PresentationContextID &presID,
+                                        QRResponse *&response)
+{
+  OFCondition cond;
+  OFString tempStr;
+  T_DIMSE_Message rsp;
+  // Make sure everything is zeroed (especially options)
+  bzero((char*)&rsp, sizeof(rsp));
 
-    // Receive command set
-    cond = receiveDIMSECommand(&pcid, &rsp, &statusDetail, NULL /* not interested in the command set */);
-    if (cond.bad())
-    {
-      DCMNET_ERROR("Failed receiving DIMSE response: " << DimseCondition::dump(tempStr, cond));
-      return cond;
-    }
+  DcmDataset *statusDetail = NULL;
 
-    if (rsp.CommandField == DIMSE_C_FIND_RSP)
+  // Receive command set
+  cond = receiveDIMSECommand(&presID, &rsp, &statusDetail, NULL /* not interested in the command set */);
+  if (cond.bad())
+  {
+    DCMNET_ERROR("Failed receiving DIMSE response: " << DimseCondition::dump(tempStr, cond));
+    return cond;
+  }
+
+  if (rsp.CommandField == DIMSE_C_FIND_RSP)
+  {
+    if (DCM_dcmnetLogger.isEnabledFor(OFLogger::DEBUG_LOG_LEVEL))
     {
-      if (DCM_dcmnetLogger.isEnabledFor(OFLogger::DEBUG_LOG_LEVEL))
-      {
-        DCMNET_INFO("Received C-FIND Response");
-        DCMNET_DEBUG(DIMSE_dumpMessage(tempStr, rsp, DIMSE_INCOMING, NULL, pcid));
-      } else {
-        DCMNET_INFO("Received C-FIND Response (" << DU_cfindStatusString(rsp.msg.CFindRSP.DimseStatus) << ")");
-      }
+      DCMNET_INFO("Received C-FIND Response");
+      DCMNET_DEBUG(DIMSE_dumpMessage(tempStr, rsp, DIMSE_INCOMING, NULL, presID));
     } else {
-      DCMNET_ERROR("Expected C-FIND response but received DIMSE command 0x"
-        << STD_NAMESPACE hex << STD_NAMESPACE setfill('0') << STD_NAMESPACE setw(4)
-        << OFstatic_cast(unsigned int, rsp.CommandField));
-      DCMNET_DEBUG(DIMSE_dumpMessage(tempStr, rsp, DIMSE_INCOMING, NULL, pcid));
-      delete statusDetail;
-      return DIMSE_BADCOMMANDTYPE;
+      DCMNET_INFO("Received C-FIND Response (" << DU_cfindStatusString(rsp.msg.CFindRSP.DimseStatus) << ")");
     }
+  } else {
+    DCMNET_ERROR("Expected C-FIND response but received DIMSE command 0x"
+      << STD_NAMESPACE hex << STD_NAMESPACE setfill('0') << STD_NAMESPACE setw(4)
+      << OFstatic_cast(unsigned int, rsp.CommandField));
+    DCMNET_DEBUG(DIMSE_dumpMessage(tempStr, rsp, DIMSE_INCOMING, NULL, presID));
+    delete statusDetail;
+    return DIMSE_BADCOMMANDTYPE;
+  }
 
-    // Prepare response package for response handler
-    OFunique_ptr<QRResponse> findRSP(new QRResponse);
-    findRSP->m_affectedSOPClassUID = rsp.msg.CFindRSP.AffectedSOPClassUID;
-    findRSP->m_messageIDRespondedTo = rsp.msg.CFindRSP.MessageIDBeingRespondedTo;
-    findRSP->m_status = rsp.msg.CFindRSP.DimseStatus;
-    findRSP->m_statusDetail = statusDetail;
+  // Prepare response package for response handler
+  OFunique_ptr<QRResponse> findRSP(new QRResponse);
+  findRSP->m_affectedSOPClassUID = rsp.msg.CFindRSP.AffectedSOPClassUID;
+  findRSP->m_messageIDRespondedTo = rsp.msg.CFindRSP.MessageIDBeingRespondedTo;
+  findRSP->m_status = rsp.msg.CFindRSP.DimseStatus;
+  findRSP->m_statusDetail = statusDetail;
 
-    // Receive dataset if there is one (status PENDING)
-    DcmDataset *rspDataset = NULL;
-    if (DICOM_PENDING_STATUS(findRSP->m_status))
+  // Receive dataset if there is one (status PENDING)
+  DcmDataset *rspDataset = NULL;
+  if (DICOM_PENDING_STATUS(findRSP->m_status))
+  {
+    // Check if dataset is announced correctly
+    if (rsp.msg.CFindRSP.DataSetType == DIMSE_DATASET_NULL)
     {
-      // Check if dataset is announced correctly
-      if (rsp.msg.CFindRSP.DataSetType == DIMSE_DATASET_NULL)
-      {
-        DCMNET_ERROR("Received C-FIND response with PENDING status but no dataset announced, aborting");
-        return DIMSE_BADMESSAGE;
-      }
-
-      // Receive dataset
-      cond = receiveDIMSEDataset(&pcid, &rspDataset);
-      if (cond.bad())
-        return DIMSE_BADDATA;
-      findRSP->m_dataset = rspDataset;
+      DCMNET_ERROR("Received C-FIND response with PENDING status but no dataset announced, aborting");
+      return DIMSE_BADMESSAGE;
     }
 
-    // Handle C-FIND response (has to handle all possible status flags)
-    cond = handleFINDResponse(pcid, findRSP.get(), waitForNextResponse);
+    // Receive dataset
+    cond = receiveDIMSEDataset(&presID, &rspDataset);
     if (cond.bad())
-    {
-      DCMNET_WARN("Unable to handle C-FIND response correctly: " << cond.text() << " (ignored)");
-      // don't return here but trust the "waitForNextResponse" variable
-    }
-    // if response could be handled successfully, add it to response list
-    else
-    {
-      if (responses != NULL) // only add if desired by caller
-        responses->push_back(findRSP.release());
-    }
+      return DIMSE_BADDATA;
+    findRSP->m_dataset = rspDataset;
   }
-  /* All responses received or break signal occurred */
+  response = findRSP.release();
   return EC_Normal;
 }
 
@@ -2352,6 +2569,15 @@ OFBool DcmSCU::isConnected() const
   return (m_assoc != NULL) && (m_assoc->DULassociation != NULL);
 }
 
+OFBool DcmSCU::isIdleAssociationAlive() const
+{
+  if (!isConnected())
+    return OFFalse;
+  /* nothing is expected on an idle association, so any readable data means that the
+   * peer has released or aborted the association or closed the connection */
+  return !ASC_dataWaiting(m_assoc, 0);
+}
+
 Uint32 DcmSCU::getMaxReceivePDULength() const
 {
   return m_maxReceivePDULength;
@@ -0,0 +1,595 @@
+/*
+ *
+ *  Copyright (C) 2016, OFFIS e.V.
+ *  All rights reserved.  See COPYRIGHT file for details.
+ *
+ *  This software and supporting documentation were developed by
+ *
+ *    OFFIS e.V.
+ *    R&D Division Health
+ *    Escherweg 2
+ *    D-26121 Oldenburg, Germany
+ *
+ *
+ *  Module:  dcmnet
+ *
+ *  Author:  OFFIS DICOM Team
+ *
+ *  Purpose: Class managing a pool of negotiated associations (DcmSCU objects)
+ *
+ */
+
+
+#include "dcmtk/config/osconfig.h"    /* make sure OS specific configuration is included first */
+
+#include "dcmtk/dcmnet/scupool.h"
+#include "dcmtk/dcmnet/diutil.h"
+#include "dcmtk/dcmdata/dcuid.h"
+#include "dcmtk/oflog/thread/syncprim.h"
+#include "dcmtk/ofstd/ofmap.h"
+
+#define INCLUDE_CTIME
+#include "dcmtk/ofstd/ofstdinc.h"
+
+
+// maximum number of presentation contexts that can be proposed on a single association
+#define MAX_PRESENTATION_CONTEXTS 128
+
+
+
+// background thread releasing expired idle associations. It sleeps until the
+// next idle association expires or until it is woken up by the pool, e.g.
+// because another association has become idle.
+
+class DcmSCUPool::Reaper : public OFThread
+{
+public:
+
+  Reaper(DcmSCUPool &pool)
+    : OFThread(),
+      m_pool(pool),
+      m_event()
+  {
+  }
+
+  // wake up the thread, so that it determines the next expiry time again
+  void wakeUp()
+  {
+    m_event.signal();
+  }
+
+protected:
+
+  virtual void run()
+  {
+    for (;;)
+    {
+      // reset the event first, so that no wake-up after this point gets lost
+      m_event.reset();
+      m_pool.m_mutex.lock();
+      const OFBool stop = m_pool.m_stopReaper;
+      const long delay = stop ? 0 : m_pool.getReaperDelay(time(NULL));
+      m_pool.m_mutex.unlock();
+      if (stop)
+        break;
+      if (delay == 0)
+        m_pool.releaseIdleAssociations(OFFalse /* all */);
+      else if (delay < 0)
+        m_event.wait();
+      else
+        m_event.timed_wait(OFstatic_cast(unsigned long, delay));
+    }
+  }
+
+private:
+
+  DcmSCUPool &m_pool;
+  dcmtk::log4cplus::thread::ManualResetEvent m_event;
+
+  // private undefined copy constructor
+  Reaper(const Reaper &);
+
+  // private undefined assignment operator
+  Reaper &operator=(const Reaper &);
+};
+
+
+// implementation of the internal struct for a requested presentation context
+
+DcmSCUPool::PresentationContext::PresentationContext(const OFString &abstractSyntax,
+                                                     const OFList<OFString> &transferSyntaxes,
+                                                     const T_ASC_SC_ROLE role)
+  : AbstractSyntax(abstractSyntax),
+    TransferSyntaxes(transferSyntaxes),
+    Role(role)
+{
+}
+
+
+OFBool DcmSCUPool::PresentationContext::operator==(const PresentationContext &other) const
+{
+    if ((AbstractSyntax != other.AbstractSyntax) || (Role != other.Role) ||
+        (TransferSyntaxes.size() != other.TransferSyntaxes.size()))
+    {
+        return OFFalse;
+    }
+    OFListConstIterator(OFString) it1 = TransferSyntaxes.begin();
+    OFListConstIterator(OFString) it2 = other.TransferSyntaxes.begin();
+    while (it1 != TransferSyntaxes.end())
+    {
+        if (*it1 != *it2)
+            return OFFalse;
+        ++it1;
+        ++it2;
+    }
+    return OFTrue;
+}
+
+
+// implementation of the main class
+
+DcmSCUPool::DcmSCUPool()
+  : m_mutex(),
+    m_entries(),
+    m_idleTimeout(60),
+    m_maxIdle(4),
+    m_echoInterval(0),
+    m_reaper(NULL),
+    m_stopReaper(OFFalse)
+{
+}
+
+
+DcmSCUPool::~DcmSCUPool()
+{
+    OFList<DcmSCU *> scus;
+    m_mutex.lock();
+    m_stopReaper = OFTrue;
+    if (m_reaper != NULL)
+        m_reaper->wakeUp();
+    Reaper *reaper = m_reaper;
+    m_reaper = NULL;
+    m_mutex.unlock();
+    // stop the background thread before the associations are closed
+    if (reaper != NULL)
+    {
+        reaper->join();
+        delete reaper;
+    }
+    m_mutex.lock();
+    OFListIterator(Entry *) it = m_entries.begin();
+    while (it != m_entries.end())
+    {
+        if ((*it)->Busy)
+            DCMNET_WARN("DcmSCUPool: Deleting SCU that is still in use");
+        scus.push_back((*it)->SCU);
+        delete *it;
+        ++it;
+    }
+    m_entries.clear();
+    m_mutex.unlock();
+    closeSCUs(scus);
+}
+
+
+void DcmSCUPool::setIdleTimeout(const Uint32 idleTimeout)
+{
+    m_mutex.lock();
+    m_idleTimeout = idleTimeout;
+    // the next idle association might expire earlier (or never)
+    if (m_reaper != NULL)
+        m_reaper->wakeUp();
+    m_mutex.unlock();
+}
+
+
+Uint32 DcmSCUPool::getIdleTimeout() const
+{
+    m_mutex.lock();
+    const Uint32 idleTimeout = m_idleTimeout;
+    m_mutex.unlock();
+    return idleTimeout;
+}
+
+
+void DcmSCUPool::setEchoInterval(const Uint32 echoInterval)
+{
+    m_mutex.lock();
+    m_echoInterval = echoInterval;
+    m_mutex.unlock();
+}
+
+
+Uint32 DcmSCUPool::getEchoInterval() const
+{
+    m_mutex.lock();
+    const Uint32 echoInterval = m_echoInterval;
+    m_mutex.unlock();
+    return echoInterval;
+}
+
+
+void DcmSCUPool::setMaxIdleAssociations(const size_t maxIdle)
+{
+    m_mutex.lock();
+    m_maxIdle = maxIdle;
+    m_mutex.unlock();
+}
+
+
+size_t DcmSCUPool::getMaxIdleAssociations() const
+{
+    m_mutex.lock();
+    const size_t maxIdle = m_maxIdle;
+    m_mutex.unlock();
+    return maxIdle;
+}
+
+
+OFCondition DcmSCUPool::acquireSCU(const OFString &peerHostName,
+                                   const Uint16 peerPort,
+                                   const OFString &peerAETitle,
+                                   const OFString &aeTitle,
+                                   const OFString &abstractSyntax,
+                                   const OFList<OFString> &transferSyntaxes,
+                                   DcmSCU *&scu)
+{
+    OFList<PresentationContext> presContexts;
+    presContexts.push_back(PresentationContext(abstractSyntax, transferSyntaxes));
+    return acquireSCU(peerHostName, peerPort, peerAETitle, aeTitle, presContexts, scu);
+}
+
+
+OFCondition DcmSCUPool::acquireSCU(const OFString &peerHostName,
+                                   const Uint16 peerPort,
+                                   const OFString &peerAETitle,
+                                   const OFString &aeTitle,
+                                   const OFList<PresentationContext> &presContexts,
+                                   DcmSCU *&scu)
+{
+    scu = NULL;
+    if (presContexts.empty())
+        return NET_EC_NoPresentationContextsDefined;
+    OFList<DcmSCU *> closeList;
+    OFList<DcmSCU *> abortList;
+    OFList<PresentationContext> proposeList;
+    Entry *entry = NULL;
+    // first, look for an idle association to the same peer that can be reused
+    do {
+        const time_t now = time(NULL);
+        proposeList = presContexts;
+        entry = NULL;
+        m_mutex.lock();
+        removeIdleEntries(now, OFFalse /* all */, closeList);
+        for (OFListIterator(Entry *) it = m_entries.begin(); it != m_entries.end(); ++it)
+        {
+            Entry *e = *it;
+            if ((e->PeerPort == peerPort) && (e->PeerHostName == peerHostName) &&
+                (e->PeerAETitle == peerAETitle) && (e->AETitle == aeTitle))
+            {
+                if (!e->Busy && (entry == NULL) && isUsable(*e->SCU, presContexts))
+                {
+                    e->Busy = OFTrue;
+                    entry = e;
+                }
+                // collect presentation contexts that have been proposed to this peer before
+                OFListIterator(PresentationContext) pc = e->PresContexts.begin();
+                while ((pc != e->PresContexts.end()) && (proposeList.size() < MAX_PRESENTATION_CONTEXTS))
+                {
+                    OFListIterator(PresentationContext) known = proposeList.begin();
+                    while ((known != proposeList.end()) && !(*known == *pc))
+                        ++known;
+                    if (known == proposeList.end())
+                        proposeList.push_back(*pc);
+                    ++pc;
+                }
+            }
+        }
+        m_mutex.unlock();
+        closeSCUs(closeList);
+        // make sure that the peer did not close the association in the meantime (outside of the mutex)
+        if ((entry != NULL) && !isAlive(*entry, now))
+        {
+            DCMNET_DEBUG("DcmSCUPool: Discarding dead idle association to " << peerAETitle << " (" << peerHostName << ":" << peerPort << ")");
+            m_mutex.lock();
+            m_entries.remove(entry);
+            m_mutex.unlock();
+            abortList.push_back(entry->SCU);
+            delete entry;
+            closeSCUs(abortList, OFTrue /* abort */);
+            // try the next idle association (if any)
+            continue;
+        }
+        break;
+    } while (OFTrue);
+    if (entry != NULL)
+    {
+        DCMNET_DEBUG("DcmSCUPool: Reusing idle association to " << peerAETitle << " (" << peerHostName << ":" << peerPort << ")");
+        scu = entry->SCU;
+        return EC_Normal;
+    }
+    // no usable association available, so negotiate a new one (outside of the mutex)
+    DCMNET_DEBUG("DcmSCUPool: Negotiating new association to " << peerAETitle << " (" << peerHostName << ":" << peerPort << ")");
+    DcmSCU *newSCU = createSCU();
+    if (newSCU == NULL)
+        return EC_MemoryExhausted;
+    newSCU->setPeerHostName(peerHostName);
+    newSCU->setPeerPort(peerPort);
+    newSCU->setPeerAETitle(peerAETitle);
+    newSCU->setAETitle(aeTitle);
+    for (OFListIterator(PresentationContext) pc = proposeList.begin(); pc != proposeList.end(); ++pc)
+    {
+        if (pc->TransferSyntaxes.empty())
+        {
+            // propose the default transfer syntax if none was specified
+            OFList<OFString> xferSyntaxes;
+            xferSyntaxes.push_back(UID_LittleEndianImplicitTransferSyntax);
+            newSCU->addPresentationContext(pc->AbstractSyntax, xferSyntaxes, pc->Role);
+        } else
+            newSCU->addPresentationContext(pc->AbstractSyntax, pc->TransferSyntaxes, pc->Role);
+    }
+    OFCondition status = newSCU->initNetwork();
+    if (status.good())
+        status = newSCU->negotiateAssociation();
+    if (status.bad())
+    {
+        delete newSCU;
+        return status;
+    }
+    entry = new Entry;
+    entry->SCU = newSCU;
+    entry->PeerHostName = peerHostName;
+    entry->PeerPort = peerPort;
+    entry->PeerAETitle = peerAETitle;
+    entry->AETitle = aeTitle;
+    entry->PresContexts = proposeList;
+    entry->LastUsed = time(NULL);
+    // check whether the requested presentation contexts have been accepted
+    const OFBool usable = isUsable(*newSCU, presContexts);
+    entry->Busy = usable;
+    m_mutex.lock();
+    // idle associations are kept in the order of their last use (most recent first)
+    m_entries.push_front(entry);
+    if (!usable)
+    {
+        // keep the association for other requests, but respect the limit of idle associations
+        removeIdleEntries(entry->LastUsed, OFFalse /* all */, closeList);
+    }
+    m_mutex.unlock();
+    closeSCUs(closeList);
+    if (!usable)
+        return NET_EC_NoAcceptablePresentationContexts;
+    scu = newSCU;
+    return EC_Normal;
+}
+
+
+OFCondition DcmSCUPool::releaseSCU(DcmSCU *scu,
+                                   const OFBool keepAlive)
+{
+    OFCondition status = NET_EC_UnknownSCU;
+    OFList<DcmSCU *> closeList;
+    OFList<DcmSCU *> abortList;
+    m_mutex.lock();
+    for (OFListIterator(Entry *) it = m_entries.begin(); it != m_entries.end(); ++it)
+    {
+        if (((*it)->SCU == scu) && (*it)->Busy)
+        {
+            if (keepAlive && scu->isConnected())
+            {
+                Entry *entry = *it;
+                entry->Busy = OFFalse;
+                entry->LastUsed = time(NULL);
+                // the most recently used association is the first one in the list
+                m_entries.erase(it);
+                m_entries.push_front(entry);
+                // make sure that the idle association is released even if the pool is not used any more
+                if (m_idleTimeout > 0)
+                {
+                    startReaper();
+                    if (m_reaper != NULL)
+                        m_reaper->wakeUp();
+                }
+            } else {
+                // the association is not needed (or usable) any more, abort it outside of the mutex
+                abortList.push_back(scu);
+                delete *it;
+                m_entries.erase(it);
+            }
+            status = EC_Normal;
+            break;
+        }
+    }
+    // also release expired idle associations to other peers
+    if (status.good())
+        removeIdleEntries(time(NULL), OFFalse /* all */, closeList);
+    m_mutex.unlock();
+    closeSCUs(abortList, OFTrue /* abort */);
+    closeSCUs(closeList);
+    return status;
+}
+
+
+void DcmSCUPool::releaseIdleAssociations(const OFBool all)
+{
+    OFList<DcmSCU *> closeList;
+    m_mutex.lock();
+    removeIdleEntries(time(NULL), all, closeList);
+    m_mutex.unlock();
+    closeSCUs(closeList);
+}
+
+
+size_t DcmSCUPool::numAssociations(const OFBool onlyBusy)
+{
+    size_t count = 0;
+    m_mutex.lock();
+    if (onlyBusy)
+    {
+        for (OFListIterator(Entry *) it = m_entries.begin(); it != m_entries.end(); ++it)
+        {
+            if ((*it)->Busy)
+                ++count;
+        }
+    } else
+        count = m_entries.size();
+    m_mutex.unlock();
+    return count;
+}
+
+
+DcmSCU *DcmSCUPool::createSCU()
+{
+    return new DcmSCU();
+}
+
+
+OFBool DcmSCUPool::isUsable(DcmSCU &scu,
+                            const OFList<PresentationContext> &presContexts)
+{
+    if (!scu.isConnected())
+        return OFFalse;
+    for (OFListConstIterator(PresentationContext) pc = presContexts.begin(); pc != presContexts.end(); ++pc)
+    {
+        OFBool found = OFFalse;
+        if (pc->TransferSyntaxes.empty())
+            found = (scu.findPresentationContextID(pc->AbstractSyntax, "") != 0);
+        else
+        {
+            OFListConstIterator(OFString) ts = pc->TransferSyntaxes.begin();
+            while (!found && (ts != pc->TransferSyntaxes.end()))
+            {
+                found = (scu.findPresentationContextID(pc->AbstractSyntax, *ts) != 0);
+                ++ts;
+            }
+        }
+        if (!found)
+            return OFFalse;
+    }
+    return OFTrue;
+}
+
+
+OFBool DcmSCUPool::isAlive(const Entry &entry,
+                           const time_t now) const
+{
+    // the peer released or aborted the association or closed the connection
+    if (!entry.SCU->isIdleAssociationAlive())
+        return OFFalse;
+    // optionally, check associations that have been idle for some time with a C-ECHO
+    const Uint32 echoInterval = getEchoInterval();
+    if ((echoInterval > 0) && (now >= entry.LastUsed) &&
+        (OFstatic_cast(Uint32, now - entry.LastUsed) >= echoInterval))
+    {
+        const T_ASC_PresentationContextID presID = entry.SCU->findAnyPresentationContextID(UID_VerificationSOPClass, UID_LittleEndianImplicitTransferSyntax);
+        if (presID != 0)
+        {
+            DCMNET_DEBUG("DcmSCUPool: Checking idle association to " << entry.PeerAETitle << " with C-ECHO");
+            return entry.SCU->sendECHORequest(presID).good();
+        }
+    }
+    return OFTrue;
+}
+
+
+void DcmSCUPool::closeSCUs(OFList<DcmSCU *> &scus,
+                           const OFBool abort)
+{
+    while (!scus.empty())
+    {
+        DcmSCU *scu = scus.front();
+        scus.pop_front();
+        if (scu->isConnected())
+        {
+            if (abort)
+            {
+                DCMNET_DEBUG("DcmSCUPool: Aborting association to " << scu->getPeerAETitle());
+                scu->abortAssociation();
+            } else {
+                DCMNET_DEBUG("DcmSCUPool: Releasing idle association to " << scu->getPeerAETitle());
+                if (scu->releaseAssociation().bad())
+                    scu->abortAssociation();
+            }
+        }
+        delete scu;
+    }
+}
+
+
+void DcmSCUPool::startReaper()
+{
+    if ((m_reaper == NULL) && !m_stopReaper)
+    {
+        m_reaper = new Reaper(*this);
+        if (m_reaper->start() != 0)
+        {
+            DCMNET_WARN("DcmSCUPool: Cannot start thread for releasing idle associations");
+            delete m_reaper;
+            m_reaper = NULL;
+        }
+    }
+}
+
+
+long DcmSCUPool::getReaperDelay(const time_t now) const
+{
+    if (m_idleTimeout == 0)
+        return -1;
+    long delay = -1;
+    for (OFListConstIterator(Entry *) it = m_entries.begin(); it != m_entries.end(); ++it)
+    {
+        const Entry *e = *it;
+        if (!e->Busy)
+        {
+            // expired (or the system time has been changed)
+            if ((now >= e->LastUsed) && (OFstatic_cast(Uint32, now - e->LastUsed) >= m_idleTimeout))
+                return 0;
+            const long remaining = (now >= e->LastUsed) ? OFstatic_cast(long, m_idleTimeout - OFstatic_cast(Uint32, now - e->LastUsed)) : OFstatic_cast(long, m_idleTimeout);
+            if ((delay < 0) || (remaining * 1000 < delay))
+                delay = remaining * 1000;
+        }
+    }
+    return delay;
+}
+
+
+void DcmSCUPool::removeIdleEntries(const time_t now,
+                                   const OFBool all,
+                                   OFList<DcmSCU *> &scus)
+{
+    // number of idle associations to each peer that are kept (the list is
+    // sorted by the time of the last use, most recent first)
+    OFMap<OFString, size_t> idleCount;
+    OFListIterator(Entry *) it = m_entries.begin();
+    while (it != m_entries.end())
+    {
+        Entry *e = *it;
+        OFBool remove = OFFalse;
+        if (!e->Busy)
+        {
+            if (all || !e->SCU->isConnected())
+                remove = OFTrue;
+            else if ((m_idleTimeout > 0) && (now >= e->LastUsed) &&
+                     (OFstatic_cast(Uint32, now - e->LastUsed) >= m_idleTimeout))
+            {
+                remove = OFTrue;
+            } else {
+                // AE titles cannot contain a backslash, and the port number has a fixed length (4 hex digits)
+                OFString peer = e->AETitle + "\\" + e->PeerAETitle + "\\" + e->PeerHostName;
+                for (int shift = 12; shift >= 0; shift -= 4)
+                    peer += "0123456789abcdef"[(e->PeerPort >> shift) & 0xf];
+                size_t &count = idleCount[peer];
+                remove = (count >= m_maxIdle);
+                if (!remove)
+                    ++count;
+            }
+        }
+        if (remove)
+        {
+            scus.push_back(e->SCU);
+            delete e;
+            it = m_entries.erase(it);
+        } else
+            ++it;
+    }
+}
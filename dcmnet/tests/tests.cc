@@ -27,6 +27,10 @@ OFTEST_REGISTER(dcmnet_dimseDump_nullByte);
 
 #ifdef WITH_THREADS
 OFTEST_REGISTER(dcmnet_scp_pool);
+OFTEST_REGISTER(dcmnet_storage_scu_parallel);
+OFTEST_REGISTER(dcmnet_scu_pool);
+OFTEST_REGISTER(dcmnet_scu_pool_liveness);
+OFTEST_REGISTER(dcmnet_scu_async_find);
 #endif // WITH_THREADS
 
 OFTEST_MAIN("dcmnet")
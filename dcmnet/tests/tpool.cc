@@ -15,7 +15,8 @@
  *
  *  Author:  Jan Schlamelcher
  *
- *  Purpose: Test DcmSCPPool class, including DcmSCP and DcmSCU interaction
+ *  Purpose: Test DcmSCPPool and DcmSCUPool classes, including DcmSCP and
+ *           DcmSCU interaction (also asynchronous DIMSE requests)
  *
  */
 
@@ -27,6 +28,11 @@
 #include "dcmtk/ofstd/oftest.h"
 #include "dcmtk/dcmnet/scppool.h"
 #include "dcmtk/dcmnet/scu.h"
+#include "dcmtk/dcmnet/scupool.h"
+#include "dcmtk/dcmnet/dstorscu.h"
+#include "dcmtk/dcmdata/dcdeftag.h"
+#include "dcmtk/dcmdata/dcdict.h"
+#include "dcmtk/dcmdata/dcuid.h"
 
 struct TestSCU : DcmSCU, OFThread
 {
@@ -50,6 +56,42 @@ protected:
     }
 };
 
+static OFMutex storeCountMutex;
+static size_t storeCount = 0;
+
+struct TestStoreSCP : DcmThreadSCP
+{
+protected:
+    OFCondition handleIncomingCommand(T_DIMSE_Message *incomingMsg,
+                                      const DcmPresentationContextInfo &presInfo)
+    {
+        if (incomingMsg->CommandField == DIMSE_C_STORE_RQ)
+        {
+            DcmDataset *dataset = NULL;
+            OFCondition cond = handleSTORERequest(incomingMsg->msg.CStoreRQ, presInfo.presentationContextID, dataset);
+            delete dataset;
+            if (cond.good())
+            {
+                storeCountMutex.lock();
+                ++storeCount;
+                storeCountMutex.unlock();
+            }
+            return cond;
+        }
+        return DcmThreadSCP::handleIncomingCommand(incomingMsg, presInfo);
+    }
+};
+
+struct TestStorePool : DcmSCPPool<TestStoreSCP>, OFThread
+{
+    OFCondition result;
+protected:
+    void run()
+    {
+        result = listen();
+    }
+};
+
 
 /* Test starts pool with a maximum of 20 SCP workers. All workers are
  * configured to respond to C-ECHO (Verification SOP Class). 20 SCU
@@ -110,4 +152,337 @@ OFTEST_FLAGS(dcmnet_scp_pool, EF_Slow)
     OFCHECK(pool.result.good());
 }
 
+
+struct TestFindSCP : DcmThreadSCP
+{
+protected:
+    OFCondition handleIncomingCommand(T_DIMSE_Message *incomingMsg,
+                                      const DcmPresentationContextInfo &presInfo)
+    {
+        if (incomingMsg->CommandField == DIMSE_C_FIND_RQ)
+        {
+            T_DIMSE_C_FindRQ &req = incomingMsg->msg.CFindRQ;
+            DcmDataset *reqDataset = NULL;
+            OFCondition cond = receiveFINDRequest(req, presInfo.presentationContextID, reqDataset);
+            if (cond.bad())
+                return cond;
+            // respond with three matches and a final success response
+            for (int i = 0; (i < 3) && cond.good(); ++i)
+                cond = sendFINDResponse(presInfo.presentationContextID, req.MessageID, req.AffectedSOPClassUID, reqDataset, STATUS_Pending);
+            if (cond.good())
+                cond = sendFINDResponse(presInfo.presentationContextID, req.MessageID, req.AffectedSOPClassUID, NULL, STATUS_Success);
+            delete reqDataset;
+            return cond;
+        }
+        return DcmThreadSCP::handleIncomingCommand(incomingMsg, presInfo);
+    }
+};
+
+struct TestFindPool : DcmSCPPool<TestFindSCP>, OFThread
+{
+    OFCondition result;
+protected:
+    void run()
+    {
+        result = listen();
+    }
+};
+
+struct TestAsyncHandler : DcmSCUAsyncHandler
+{
+    TestAsyncHandler() : responses(0), completed(0), result() {}
+    void notifyFINDResponse(DcmSCU & /* scu */, QRResponse *response)
+    {
+        ++responses;
+        delete response;
+    }
+    void notifyRequestCompleted(DcmSCU & /* scu */, const OFCondition &cond)
+    {
+        ++completed;
+        result = cond;
+    }
+    size_t responses;
+    size_t completed;
+    OFCondition result;
+};
+
+
+/* Test starts a pool of storage SCP workers and sends 40 SOP instances
+ * from three studies on up to four concurrent associations using
+ * DcmStorageSCU::sendSOPInstancesInParallel(), once with and once without
+ * keeping the study order.
+ */
+OFTEST_FLAGS(dcmnet_storage_scu_parallel, EF_Slow)
+{
+    /* make sure data dictionary is loaded */
+    if (!dcmDataDict.isDictionaryLoaded())
+    {
+        OFCHECK_FAIL("no data dictionary loaded, check environment variable: " DCM_DICT_ENVIRONMENT_VARIABLE);
+        return;
+    }
+
+    TestStorePool pool;
+    DcmSCPConfig& config = pool.getConfig();
+
+    config.setAETitle("PoolTestSCP");
+    config.setPort(11113);
+    config.setConnectionBlockingMode(DUL_NOBLOCK);
+    config.setConnectionTimeout(1);
+
+    // more workers than associations, since a worker might still be busy
+    // for a moment after the SCU has released the association
+    pool.setMaxThreads(8);
+    OFList<OFString> xfers;
+    xfers.push_back(UID_LittleEndianExplicitTransferSyntax);
+    xfers.push_back(UID_LittleEndianImplicitTransferSyntax);
+    config.addPresentationContext(UID_SecondaryCaptureImageStorage, xfers);
+
+    pool.start();
+
+    // "ensure" the pool is initialized before any SCU starts connecting to it
+    OFStandard::sleep(5);
+
+    for (int run = 0; run < 2; ++run)
+    {
+        const OFBool keepStudyOrder = (run == 1);
+        DcmStorageSCU scu;
+        scu.setAETitle("PoolTestSCU");
+        scu.setPeerAETitle("PoolTestSCP");
+        scu.setPeerHostName("localhost");
+        scu.setPeerPort(11113);
+        char uid[100];
+        for (int i = 0; i < 40; ++i)
+        {
+            DcmDataset *dataset = new DcmDataset;
+            dataset->putAndInsertString(DCM_SOPClassUID, UID_SecondaryCaptureImageStorage);
+            dataset->putAndInsertString(DCM_SOPInstanceUID, dcmGenerateUniqueIdentifier(uid, SITE_INSTANCE_UID_ROOT));
+            dataset->putAndInsertString(DCM_StudyInstanceUID, (i % 3 == 0) ? "1.2.3.1" : ((i % 3 == 1) ? "1.2.3.2" : "1.2.3.3"));
+            OFCHECK(scu.addDataset(dataset, EXS_LittleEndianExplicit, DcmStorageSCU::HM_deleteAfterRemove).good());
+        }
+
+        storeCount = 0;
+        OFCHECK(scu.sendSOPInstancesInParallel(4, keepStudyOrder).good());
+        OFCHECK_EQUAL(scu.getNumberOfSOPInstancesToBeSent(), 0);
+        OFCHECK_EQUAL(storeCount, 40);
+        if (keepStudyOrder)
+            OFCHECK_EQUAL(scu.getAssociationCounter(), 3);
+        else
+            OFCHECK(scu.getAssociationCounter() > 1);
+    }
+
+    // Request shutdown.
+    pool.stopAfterCurrentAssociations();
+    pool.join();
+
+    OFCHECK(pool.result.good());
+}
+
+
+/* Test starts a pool of SCP workers and acquires SCUs from a DcmSCUPool.
+ * Released associations must be reused for subsequent requests, while
+ * concurrent requests must result in separate associations.
+ */
+OFTEST_FLAGS(dcmnet_scu_pool, EF_Slow)
+{
+    TestPool pool;
+    DcmSCPConfig& config = pool.getConfig();
+
+    config.setAETitle("PoolTestSCP");
+    config.setPort(11114);
+    config.setConnectionBlockingMode(DUL_NOBLOCK);
+    config.setConnectionTimeout(1);
+
+    pool.setMaxThreads(4);
+    OFList<OFString> xfers;
+    xfers.push_back(UID_LittleEndianExplicitTransferSyntax);
+    xfers.push_back(UID_LittleEndianImplicitTransferSyntax);
+    config.addPresentationContext(UID_VerificationSOPClass, xfers);
+
+    pool.start();
+
+    // "ensure" the pool is initialized before any SCU starts connecting to it
+    OFStandard::sleep(5);
+
+    DcmSCUPool scuPool;
+    DcmSCU *scu1 = NULL;
+    DcmSCU *scu2 = NULL;
+    OFCHECK(scuPool.acquireSCU("localhost", 11114, "PoolTestSCP", "PoolTestSCU", UID_VerificationSOPClass, xfers, scu1).good());
+    OFCHECK(scu1 != NULL);
+    if (scu1 != NULL)
+    {
+        OFCHECK(scu1->sendECHORequest(0).good());
+        OFCHECK(scuPool.releaseSCU(scu1).good());
+        OFCHECK_EQUAL(scuPool.numAssociations(OFTrue), 0);
+        OFCHECK_EQUAL(scuPool.numAssociations(OFFalse), 1);
+        // the idle association is reused
+        OFCHECK(scuPool.acquireSCU("localhost", 11114, "PoolTestSCP", "PoolTestSCU", UID_VerificationSOPClass, xfers, scu2).good());
+        OFCHECK(scu2 == scu1);
+        OFCHECK(scu2->sendECHORequest(0).good());
+        // a concurrent request results in a new association
+        OFCHECK(scuPool.acquireSCU("localhost", 11114, "PoolTestSCP", "PoolTestSCU", UID_VerificationSOPClass, xfers, scu1).good());
+        OFCHECK(scu1 != NULL && scu1 != scu2);
+        OFCHECK_EQUAL(scuPool.numAssociations(OFTrue), 2);
+        // only the most recently released association is kept
+        scuPool.setMaxIdleAssociations(1);
+        OFCHECK_EQUAL(scuPool.getMaxIdleAssociations(), 1);
+        OFCHECK(scuPool.releaseSCU(scu1).good());
+        OFCHECK(scuPool.releaseSCU(scu2).good());
+        OFCHECK_EQUAL(scuPool.numAssociations(OFFalse), 1);
+        DcmSCU *scu3 = NULL;
+        OFCHECK(scuPool.acquireSCU("localhost", 11114, "PoolTestSCP", "PoolTestSCU", UID_VerificationSOPClass, xfers, scu3).good());
+        OFCHECK(scu3 == scu2);
+        OFCHECK(scuPool.releaseSCU(scu3).good());
+        // releasing an SCU twice is an error
+        OFCHECK(scuPool.releaseSCU(scu2) == NET_EC_UnknownSCU);
+        // a presentation context that is not supported by the SCP
+        OFCHECK(scuPool.acquireSCU("localhost", 11114, "PoolTestSCP", "PoolTestSCU", UID_SecondaryCaptureImageStorage, xfers, scu1) == NET_EC_NoAcceptablePresentationContexts);
+        OFCHECK(scu1 == NULL);
+        scuPool.releaseIdleAssociations(OFTrue /* all */);
+        OFCHECK_EQUAL(scuPool.numAssociations(OFFalse), 0);
+    }
+
+    // Request shutdown.
+    pool.stopAfterCurrentAssociations();
+    pool.join();
+
+    OFCHECK(pool.result.good());
+}
+
+
+/* Test starts a pool of SCP workers that abort idle associations after one
+ * second. Associations closed by the peer must not be handed out by the
+ * DcmSCUPool again, and expired idle associations must be released even if
+ * the pool is not used any more.
+ */
+OFTEST_FLAGS(dcmnet_scu_pool_liveness, EF_Slow)
+{
+    TestPool pool;
+    DcmSCPConfig& config = pool.getConfig();
+
+    config.setAETitle("PoolTestSCP");
+    config.setPort(11116);
+    config.setConnectionBlockingMode(DUL_NOBLOCK);
+    config.setConnectionTimeout(1);
+    config.setDIMSEBlockingMode(DIMSE_NONBLOCKING);
+    config.setDIMSETimeout(1);
+
+    pool.setMaxThreads(4);
+    OFList<OFString> xfers;
+    xfers.push_back(UID_LittleEndianImplicitTransferSyntax);
+    config.addPresentationContext(UID_VerificationSOPClass, xfers);
+
+    pool.start();
+
+    // "ensure" the pool is initialized before any SCU starts connecting to it
+    OFStandard::sleep(5);
+
+    DcmSCUPool scuPool;
+    DcmSCU *scu1 = NULL;
+    DcmSCU *scu2 = NULL;
+    OFCHECK(scuPool.acquireSCU("localhost", 11116, "PoolTestSCP", "PoolTestSCU", UID_VerificationSOPClass, xfers, scu1).good());
+    OFCHECK(scu1 != NULL);
+    if (scu1 != NULL)
+    {
+        OFCHECK(scu1->sendECHORequest(0).good());
+        OFCHECK(scuPool.releaseSCU(scu1).good());
+        // wait until the SCP has aborted the idle association
+        OFStandard::sleep(3);
+        OFCHECK(!scu1->isIdleAssociationAlive());
+        // the dead association is discarded and a new one is negotiated
+        OFCHECK(scuPool.acquireSCU("localhost", 11116, "PoolTestSCP", "PoolTestSCU", UID_VerificationSOPClass, xfers, scu2).good());
+        OFCHECK(scu2 != NULL);
+        if (scu2 != NULL)
+        {
+            OFCHECK(scu2->isIdleAssociationAlive());
+            OFCHECK(scu2->sendECHORequest(0).good());
+            OFCHECK_EQUAL(scuPool.numAssociations(OFFalse), 1);
+            scuPool.setIdleTimeout(1);
+            OFCHECK(scuPool.releaseSCU(scu2).good());
+            OFCHECK_EQUAL(scuPool.numAssociations(OFFalse), 1);
+        }
+        // the expired idle association is released without any further call of the pool
+        OFStandard::sleep(3);
+        OFCHECK_EQUAL(scuPool.numAssociations(OFFalse), 0);
+    }
+
+    // Request shutdown.
+    pool.stopAfterCurrentAssociations();
+    pool.join();
+
+    OFCHECK(pool.result.good());
+}
+
+
+/* Test starts a pool of C-FIND SCP workers and sends asynchronous C-FIND
+ * requests on three associations, which are then driven concurrently by
+ * a single thread using DcmSCU::processAsyncRequests().
+ */
+OFTEST_FLAGS(dcmnet_scu_async_find, EF_Slow)
+{
+    /* make sure data dictionary is loaded */
+    if (!dcmDataDict.isDictionaryLoaded())
+    {
+        OFCHECK_FAIL("no data dictionary loaded, check environment variable: " DCM_DICT_ENVIRONMENT_VARIABLE);
+        return;
+    }
+
+    TestFindPool pool;
+    DcmSCPConfig& config = pool.getConfig();
+
+    config.setAETitle("PoolTestSCP");
+    config.setPort(11115);
+    config.setConnectionBlockingMode(DUL_NOBLOCK);
+    config.setConnectionTimeout(1);
+
+    pool.setMaxThreads(4);
+    OFList<OFString> xfers;
+    xfers.push_back(UID_LittleEndianExplicitTransferSyntax);
+    xfers.push_back(UID_LittleEndianImplicitTransferSyntax);
+    config.addPresentationContext(UID_FINDStudyRootQueryRetrieveInformationModel, xfers);
+
+    pool.start();
+
+    // "ensure" the pool is initialized before any SCU starts connecting to it
+    OFStandard::sleep(5);
+
+    DcmSCU scus[3];
+    TestAsyncHandler handlers[3];
+    OFList<DcmSCU *> scuList;
+    DcmDataset query;
+    query.putAndInsertString(DCM_QueryRetrieveLevel, "STUDY");
+    query.putAndInsertString(DCM_StudyInstanceUID, "");
+    for (int i = 0; i < 3; ++i)
+    {
+        scus[i].setAETitle("PoolTestSCU");
+        scus[i].setPeerAETitle("PoolTestSCP");
+        scus[i].setPeerHostName("localhost");
+        scus[i].setPeerPort(11115);
+        scus[i].addPresentationContext(UID_FINDStudyRootQueryRetrieveInformationModel, xfers);
+        OFCHECK(scus[i].initNetwork().good());
+        OFCHECK(scus[i].negotiateAssociation().good());
+        const T_ASC_PresentationContextID presID = scus[i].findPresentationContextID(UID_FINDStudyRootQueryRetrieveInformationModel, "");
+        OFCHECK(scus[i].sendFINDRequestAsync(presID, &query, &handlers[i]).good());
+        OFCHECK(scus[i].hasPendingAsyncRequest());
+        // only one outstanding request per association
+        OFCHECK(scus[i].sendFINDRequestAsync(presID, &query, &handlers[i]) == NET_EC_AsyncRequestPending);
+        scuList.push_back(&scus[i]);
+    }
+
+    OFCHECK(DcmSCU::processAsyncRequests(scuList, 30).good());
+    for (int j = 0; j < 3; ++j)
+    {
+        OFCHECK(!scus[j].hasPendingAsyncRequest());
+        OFCHECK_EQUAL(handlers[j].responses, 4);
+        OFCHECK_EQUAL(handlers[j].completed, 1);
+        OFCHECK(handlers[j].result.good());
+        scus[j].releaseAssociation();
+    }
+
+    // Request shutdown.
+    pool.stopAfterCurrentAssociations();
+    pool.join();
+
+    OFCHECK(pool.result.good());
+}
+
 #endif // WITH_THREADS
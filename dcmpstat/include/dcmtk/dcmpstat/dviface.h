@@ -1723,11 +1723,6 @@ private:
                                                    const char *seriesUID = NULL,
                                                    const char *instanceUID = NULL);
 
-    /** returns index of specified study within study description record
-     */
-    int findStudyIdx(StudyDescRecord *study,
-                     const char *uid);
-
     /** conditionally deletes given image file (only if file resides in index.dat directory)
      */
     int deleteImageFile(const char *filename);
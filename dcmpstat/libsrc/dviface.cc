@@ -1977,25 +1977,6 @@ OFCondition DVInterface::instanceReviewed(const char *studyUID,
 }
 
 
-int DVInterface::findStudyIdx(StudyDescRecord *study,
-                              const char *uid)
-{
-    if ((study != NULL) && (uid != NULL))
-    {
-        register int i = 0;
-        for (i = 0; i < PSTAT_MAXSTUDYCOUNT; i++)
-        {
-            if ((study[i].StudyInstanceUID != NULL) &&
-                (strcmp(uid, study[i].StudyInstanceUID) == 0))
-            {
-                return i;
-            }
-        }
-    }
-    return -1;
-}
-
-
 int DVInterface::deleteImageFile(const char *filename)
 {
     if ((filename != NULL) && (pHandle != NULL))
@@ -2026,35 +2007,27 @@ OFCondition DVInterface::deleteStudy(const char *studyUID)
             wasNew = newInstancesReceived();
             if (study->List.gotoFirst())
             {
-                StudyDescRecord *study_desc = OFstatic_cast(StudyDescRecord *, malloc(SIZEOF_STUDYDESC));
-                if (study_desc != NULL)
+                StudyDescRecord study_desc;
+                if (pHandle->DB_FindStudyDesc(studyUID, &study_desc).good())
                 {
-                    if (pHandle->DB_GetStudyDesc(study_desc).good())
+                    do /* for all series */
                     {
-                        int idx = findStudyIdx(study_desc, studyUID);
-                        if (idx >= 0)
+                        DVSeriesCache::ItemStruct *series = study->List.getItem();
+                        if (series != NULL)
                         {
-                            do /* for all series */
+                            if (series->List.gotoFirst())
                             {
-                                DVSeriesCache::ItemStruct *series = study->List.getItem();
-                                if (series != NULL)
+                                do /* for all instances */
                                 {
-                                    if (series->List.gotoFirst())
-                                    {
-                                        do /* for all instances */
-                                        {
-                                            pHandle->DB_IdxRemove(series->List.getPos());
-                                            deleteImageFile(series->List.getFilename());
-                                        } while (series->List.gotoNext());
-                                    }
-                                }
-                            } while (study->List.gotoNext());
-                            study_desc[idx].NumberofRegistratedImages = 0;
-                            study_desc[idx].StudySize = 0;
-                            pHandle->DB_StudyDescChange(study_desc);
+                                    pHandle->DB_IdxRemove(series->List.getPos());
+                                    deleteImageFile(series->List.getFilename());
+                                } while (series->List.gotoNext());
+                            }
                         }
-                    }
-                    free(study_desc);
+                    } while (study->List.gotoNext());
+                    study_desc.NumberofRegistratedImages = 0;
+                    study_desc.StudySize = 0;
+                    pHandle->DB_UpdateStudyDesc(&study_desc);
                 }
             }
         }
@@ -2080,28 +2053,23 @@ OFCondition DVInterface::deleteSeries(const char *studyUID,
             wasNew = newInstancesReceived();
             if (series->List.gotoFirst())
             {
-                StudyDescRecord *study_desc = OFstatic_cast(StudyDescRecord *, malloc(SIZEOF_STUDYDESC));
-                if (study_desc != NULL)
+                StudyDescRecord study_desc;
+                if (pHandle->DB_FindStudyDesc(studyUID, &study_desc).good())
                 {
-                    if (pHandle->DB_GetStudyDesc(study_desc).good())
+                    do /* for all images */
                     {
-                        int idx = findStudyIdx(study_desc, studyUID);
-                        if (idx >= 0)
+                        pHandle->DB_IdxRemove(series->List.getPos());
+                        if (study_desc.NumberofRegistratedImages > 0)
                         {
-                            do /* for all images */
-                            {
-                                pHandle->DB_IdxRemove(series->List.getPos());
-                                if (study_desc[idx].NumberofRegistratedImages > 0)
-                                {
-                                    study_desc[idx].NumberofRegistratedImages--;
-                                    study_desc[idx].StudySize -= series->List.getImageSize();
-                                }
-                                deleteImageFile(series->List.getFilename());
-                            } while (series->List.gotoNext());
-                            pHandle->DB_StudyDescChange(study_desc);
+                            study_desc.NumberofRegistratedImages--;
+                            if (study_desc.StudySize > series->List.getImageSize())
+                                study_desc.StudySize -= series->List.getImageSize();
+                            else
+                                study_desc.StudySize = 0;
                         }
-                    }
-                    free(study_desc);
+                        deleteImageFile(series->List.getFilename());
+                    } while (series->List.gotoNext());
+                    pHandle->DB_UpdateStudyDesc(&study_desc);
                 }
             }
         }
@@ -2128,31 +2096,21 @@ OFCondition DVInterface::deleteInstance(const char *studyUID,
         {
             wasNew = newInstancesReceived();
             pHandle->DB_IdxRemove(series->List.getPos());
-            StudyDescRecord *study_desc = OFstatic_cast(StudyDescRecord *, malloc(SIZEOF_STUDYDESC));
-            if (study_desc != NULL)
+            StudyDescRecord study_desc;
+            if (pHandle->DB_FindStudyDesc(studyUID, &study_desc).good())
             {
-                if (pHandle->DB_GetStudyDesc(study_desc).good())
+                if (study_desc.NumberofRegistratedImages > 0)
                 {
-                    register int i = 0;
-                    for (i = 0; i < PSTAT_MAXSTUDYCOUNT; i++)
-                    {
-                        if ((study_desc[i].StudyInstanceUID != NULL) &&
-                            (strcmp(studyUID, study_desc[i].StudyInstanceUID) != 0))
-                        {
-                            if (study_desc[i].NumberofRegistratedImages > 0)
-                            {
-                                study_desc[i].NumberofRegistratedImages--;
-                                study_desc[i].StudySize -= series->List.getImageSize();
-                                pHandle->DB_StudyDescChange(study_desc);
-                            }
-                            break;
-                        }
-                    }
-                    free(study_desc);
-                    result = EC_Normal;
+                    study_desc.NumberofRegistratedImages--;
+                    if (study_desc.StudySize > series->List.getImageSize())
+                        study_desc.StudySize -= series->List.getImageSize();
+                    else
+                        study_desc.StudySize = 0;
+                    pHandle->DB_UpdateStudyDesc(&study_desc);
                 }
-                deleteImageFile(series->List.getFilename());
             }
+            result = EC_Normal;
+            deleteImageFile(series->List.getFilename());
         }
         unlockExclusive();
         if (!wasNew)
@@ -0,0 +1,214 @@
+/*
+ *
+ *  Copyright (C) 2016, OFFIS e.V.
+ *  All rights reserved.  See COPYRIGHT file for details.
+ *
+ *  This software and supporting documentation were developed by
+ *
+ *    OFFIS e.V.
+ *    R&D Division Health
+ *    Escherweg 2
+ *    D-26121 Oldenburg, Germany
+ *
+ *
+ *  Module:  dcmpstat
+ *
+ *  Author:  OFFIS DICOM Team
+ *
+ *  Purpose: test the database functions of class DVInterface
+ *
+ */
+
+
+#include "dcmtk/config/osconfig.h"    /* make sure OS specific configuration is included first */
+
+BEGIN_EXTERN_C
+#ifdef HAVE_UNISTD_H
+#include <unistd.h>
+#endif
+#ifdef _WIN32
+#include <direct.h>     /* for _rmdir() */
+#endif
+END_EXTERN_C
+
+#define INCLUDE_CSTDIO
+#include "dcmtk/ofstd/ofstdinc.h"
+
+#include "dcmtk/ofstd/oftest.h"
+#include "dcmtk/ofstd/ofstd.h"
+#include "dcmtk/ofstd/oflist.h"
+#include "dcmtk/ofstd/oftempf.h"
+#include "dcmtk/dcmdata/dcfilefo.h"
+#include "dcmtk/dcmdata/dcdeftag.h"
+#include "dcmtk/dcmdata/dcuid.h"
+#include "dcmtk/dcmqrdb/dcmqrdbi.h"
+#include "dcmtk/dcmqrdb/dcmqrdbs.h"
+#include "dcmtk/dcmqrdb/dcmqridx.h"
+#include "dcmtk/dcmpstat/dviface.h"
+#include "dcmtk/dcmpstat/dvpsdef.h"
+
+
+/* temporary database directory with a configuration file for DVInterface */
+class TestDatabase
+{
+public:
+
+    TestDatabase()
+    : directory_()
+    , configFile_()
+    {
+        OFTempFile temp;
+        directory_ = temp.getFilename();
+        directory_ += ".db";
+        OFStandard::createDirectory(directory_, "");
+        configFile_ = filePath("dcmpstat.cfg");
+        FILE *f = fopen(configFile_.c_str(), "w");
+        if (f != NULL)
+        {
+            fprintf(f, "[[GENERAL]]\n[DATABASE]\nDirectory = %s\n", directory_.c_str());
+            fclose(f);
+        }
+    }
+
+    ~TestDatabase()
+    {
+        OFList<OFString> files;
+        OFStandard::searchDirectoryRecursively(directory_, files);
+        for (OFListIterator(OFString) it = files.begin(); it != files.end(); ++it)
+            OFStandard::deleteFile(*it);
+#ifdef _WIN32
+        _rmdir(directory_.c_str());
+#else
+        rmdir(directory_.c_str());
+#endif
+    }
+
+    OFString filePath(const char *name) const
+    {
+        OFString result(directory_);
+        result += PATH_SEPARATOR;
+        result += name;
+        return result;
+    }
+
+    /* write an instance to the database directory and register it */
+    OFBool storeInstance(const char *studyUID, const char *seriesUID, const char *sopUID)
+    {
+        DcmFileFormat fileformat;
+        DcmDataset *dset = fileformat.getDataset();
+        dset->putAndInsertString(DCM_SOPClassUID, UID_SecondaryCaptureImageStorage);
+        dset->putAndInsertString(DCM_SOPInstanceUID, sopUID);
+        dset->putAndInsertString(DCM_PatientName, "Test^Patient");
+        dset->putAndInsertString(DCM_PatientID, "P1");
+        dset->putAndInsertString(DCM_StudyInstanceUID, studyUID);
+        dset->putAndInsertString(DCM_SeriesInstanceUID, seriesUID);
+        dset->putAndInsertString(DCM_Modality, "OT");
+        OFString filename = filePath(sopUID);
+        filename += ".dcm";
+        if (fileformat.saveFile(filename.c_str(), EXS_LittleEndianExplicit).bad())
+            return OFFalse;
+        OFCondition cond;
+        DcmQueryRetrieveIndexDatabaseHandle handle(directory_.c_str(), PSTAT_MAXSTUDYCOUNT, PSTAT_STUDYSIZE, cond);
+        if (cond.bad())
+            return OFFalse;
+        DcmQueryRetrieveDatabaseStatus status;
+        handle.storeRequest(UID_SecondaryCaptureImageStorage, sopUID, filename.c_str(), &status);
+        return (status.status() == STATUS_Success);
+    }
+
+    /* read the study descriptor, returns OFFalse if not found */
+    OFBool getStudyDesc(const char *studyUID, StudyDescRecord &studyDesc)
+    {
+        OFCondition cond;
+        DcmQueryRetrieveIndexDatabaseHandle handle(directory_.c_str(), PSTAT_MAXSTUDYCOUNT, PSTAT_STUDYSIZE, cond);
+        if (cond.bad() || handle.DB_lock(OFFalse).bad())
+            return OFFalse;
+        cond = handle.DB_FindStudyDesc(studyUID, &studyDesc);
+        handle.DB_unlock();
+        return cond.good();
+    }
+
+    /* overwrite the counters of the study descriptor */
+    OFBool setStudyDesc(const char *studyUID, int numberOfImages, long studySize)
+    {
+        OFCondition cond;
+        DcmQueryRetrieveIndexDatabaseHandle handle(directory_.c_str(), PSTAT_MAXSTUDYCOUNT, PSTAT_STUDYSIZE, cond);
+        if (cond.bad() || handle.DB_lock(OFTrue).bad())
+            return OFFalse;
+        StudyDescRecord studyDesc;
+        cond = handle.DB_FindStudyDesc(studyUID, &studyDesc);
+        if (cond.good())
+        {
+            studyDesc.NumberofRegistratedImages = numberOfImages;
+            studyDesc.StudySize = studySize;
+            cond = handle.DB_UpdateStudyDesc(&studyDesc);
+        }
+        handle.DB_unlock();
+        return cond.good();
+    }
+
+    const char *configFile() const
+    {
+        return configFile_.c_str();
+    }
+
+private:
+
+    OFString directory_;
+    OFString configFile_;
+};
+
+
+OFTEST(dcmpstat_deleteLastInstance)
+{
+    TestDatabase db;
+    StudyDescRecord studyDesc;
+    OFCHECK(db.storeInstance("1.2.3.1", "1.2.3.1.1", "1.2.3.1.1.1"));
+    OFCHECK(db.getStudyDesc("1.2.3.1", studyDesc));
+    OFCHECK_EQUAL(studyDesc.NumberofRegistratedImages, 1);
+    const long imageSize = studyDesc.StudySize;
+    OFCHECK(imageSize > 0);
+    {
+        DVInterface dvi(db.configFile());
+        OFCHECK(dvi.deleteInstance("1.2.3.1", "1.2.3.1.1", "1.2.3.1.1.1").good());
+        OFCHECK_EQUAL(dvi.getNumberOfStudies(), 0);
+    }
+    /* a study without images is removed from the study table */
+    OFCHECK(!db.getStudyDesc("1.2.3.1", studyDesc));
+    /* the counters start from zero when the study is stored again */
+    OFCHECK(db.storeInstance("1.2.3.1", "1.2.3.1.1", "1.2.3.1.1.2"));
+    OFCHECK(db.getStudyDesc("1.2.3.1", studyDesc));
+    OFCHECK_EQUAL(studyDesc.NumberofRegistratedImages, 1);
+    OFCHECK_EQUAL(studyDesc.StudySize, imageSize);
+}
+
+
+OFTEST(dcmpstat_deleteInstanceWithWrongCounters)
+{
+    TestDatabase db;
+    StudyDescRecord studyDesc;
+    OFCHECK(db.storeInstance("1.2.3.2", "1.2.3.2.1", "1.2.3.2.1.1"));
+    OFCHECK(db.storeInstance("1.2.3.2", "1.2.3.2.1", "1.2.3.2.1.2"));
+    OFCHECK(db.getStudyDesc("1.2.3.2", studyDesc));
+    const long imageSize = studyDesc.StudySize / 2;
+    /* counters that are too small must neither wrap around nor become negative */
+    OFCHECK(db.setStudyDesc("1.2.3.2", 2, 10));
+    {
+        DVInterface dvi(db.configFile());
+        OFCHECK(dvi.deleteInstance("1.2.3.2", "1.2.3.2.1", "1.2.3.2.1.1").good());
+    }
+    OFCHECK(db.getStudyDesc("1.2.3.2", studyDesc));
+    OFCHECK_EQUAL(studyDesc.NumberofRegistratedImages, 1);
+    OFCHECK_EQUAL(studyDesc.StudySize, 0);
+    /* delete the last instance of the study, whose size is already zero */
+    {
+        DVInterface dvi(db.configFile());
+        OFCHECK(dvi.deleteInstance("1.2.3.2", "1.2.3.2.1", "1.2.3.2.1.2").good());
+        OFCHECK_EQUAL(dvi.getNumberOfStudies(), 0);
+    }
+    OFCHECK(!db.getStudyDesc("1.2.3.2", studyDesc));
+    OFCHECK(db.storeInstance("1.2.3.2", "1.2.3.2.1", "1.2.3.2.1.3"));
+    OFCHECK(db.getStudyDesc("1.2.3.2", studyDesc));
+    OFCHECK_EQUAL(studyDesc.NumberofRegistratedImages, 1);
+    OFCHECK_EQUAL(studyDesc.StudySize, imageSize);
+}
@@ -69,6 +69,7 @@ int main (int argc, char *argv[])
     const char *opt_storageArea = NULL;
     OFBool opt_print = OFFalse;
     OFBool opt_isNewFlag = OFTrue;
+    OFBool opt_convert = OFFalse;
 
 #ifdef WITH_TCPWRAPPER
     // this code makes sure that the linker cannot optimize away
@@ -91,6 +92,7 @@ int main (int argc, char *argv[])
      OFLog::addOptions(cmd);
      cmd.addOption("--print",   "-p", "list contents of database index file");
      cmd.addOption("--not-new", "-n", "set instance reviewed status to 'not new'");
+     cmd.addOption("--convert", "-c", "convert index file to compact format (in place)");
 
 #ifdef HAVE_GUSI_H
     /* needed for Macintosh */
@@ -134,6 +136,9 @@ int main (int argc, char *argv[])
 
         if (cmd.findOption("--not-new"))
             opt_isNewFlag = OFFalse;
+
+        if (cmd.findOption("--convert"))
+            opt_convert = OFTrue;
     }
 
     /* print resource identifier */
@@ -147,10 +152,22 @@ int main (int argc, char *argv[])
     }
 
     OFCondition cond;
-    DcmQueryRetrieveIndexDatabaseHandle hdl(opt_storageArea, DB_UpperMaxStudies, DB_UpperMaxBytesPerStudy, cond);
+    DcmQueryRetrieveIndexDatabaseHandle hdl(opt_storageArea, -1 /* no limit */, DB_UpperMaxBytesPerStudy, cond);
     if (cond.good())
     {
         hdl.enableQuotaSystem(OFFalse); /* disable deletion of images */
+        if (opt_convert)
+        {
+            if (hdl.isCompactIndexFile())
+                OFLOG_INFO(dcmqridxLogger, "index file is already in compact format");
+            else if (hdl.convertIndexFile().bad())
+            {
+                OFLOG_ERROR(dcmqridxLogger, "cannot convert index file to compact format");
+                return 1;
+            }
+            else
+                OFLOG_INFO(dcmqridxLogger, "index file converted to compact format");
+        }
         int paramCount = cmd.getParamCount();
         for (int param = 2; param <= paramCount; param++)
         {
@@ -151,10 +151,15 @@ main(int argc, char *argv[])
         opt5 += ")";
         cmd.addOption("--config",               "-c",     1, opt5.c_str(), "use specific configuration file");
     }
-#ifdef HAVE_FORK
+#if defined(HAVE_FORK) || defined(WITH_THREADS)
   cmd.addGroup("multi-process options:", LONGCOL, SHORTCOL + 2);
+#ifdef HAVE_FORK
     cmd.addOption("--single-process",           "-s",        "single process mode");
     cmd.addOption("--fork",                                  "fork child process for each assoc. (default)");
+#endif
+#ifdef WITH_THREADS
+    cmd.addOption("--multi-thread",                          "handle each association in a separate thread");
+#endif
 #endif
 
   cmd.addGroup("database options:");
@@ -179,6 +184,17 @@ main(int argc, char *argv[])
 #ifndef NO_PATIENTSTUDYONLY_SUPPORT
       cmd.addOption("--no-patient-study",       "-QO",       "do not support Patient/Study Only Q/R models");
 #endif
+    cmd.addSubGroup("query limits:");
+      cmd.addOption("--max-find-responses",                 1, "[n]umber: integer (default: 0 = unlimited)",
+                                                                 "maximum number of responses per C-FIND request");
+#ifdef WITH_THREADS
+    cmd.addSubGroup("move sub-operations:");
+      cmd.addOption("--move-associations",                  1, "[n]umber: integer (1..16, default: 1)",
+                                                                 "number of parallel sub-associations per C-MOVE");
+    cmd.addSubGroup("registration of received objects:");
+      cmd.addOption("--store-sync",                          "register objects before sending C-STORE-RSP\n(default)");
+      cmd.addOption("--store-journal",                       "journal objects and register them in the\nbackground after sending C-STORE-RSP");
+#endif
 
   cmd.addGroup("network options:");
     cmd.addSubGroup("preferred network transfer syntaxes (incoming associations):");
@@ -323,10 +339,19 @@ main(int argc, char *argv[])
       OFLog::configureFromCommandLine(cmd, app);
 
       if (cmd.findOption("--config")) app.checkValue(cmd.getValue(opt_configFileName));
-#ifdef HAVE_FORK
+#if defined(HAVE_FORK) || defined(WITH_THREADS)
       cmd.beginOptionBlock();
+#ifdef HAVE_FORK
       if (cmd.findOption("--single-process")) options.singleProcess_ = OFTrue;
       if (cmd.findOption("--fork")) options.singleProcess_ = OFFalse;
+#endif
+#ifdef WITH_THREADS
+      if (cmd.findOption("--multi-thread"))
+      {
+        options.singleProcess_ = OFFalse;
+        options.multiThread_ = OFTrue;
+      }
+#endif
       cmd.endOptionBlock();
 #endif
 
@@ -363,6 +388,14 @@ main(int argc, char *argv[])
       {
         app.printError("cannot disable all Q/R models");
       }
+      if (cmd.findOption("--max-find-responses")) app.checkValue(cmd.getValue(options.maxFindResponses_));
+#ifdef WITH_THREADS
+      if (cmd.findOption("--move-associations")) app.checkValue(cmd.getValueAndCheckMinMax(options.moveSubAssociations_, 1, 16));
+      cmd.beginOptionBlock();
+      if (cmd.findOption("--store-sync")) options.storeJournal_ = OFFalse;
+      if (cmd.findOption("--store-journal")) options.storeJournal_ = OFTrue;
+      cmd.endOptionBlock();
+#endif
 
       cmd.beginOptionBlock();
       if (cmd.findOption("--prefer-uncompr")) options.networkTransferSyntax_ = EXS_Unknown;
@@ -714,16 +747,23 @@ main(int argc, char *argv[])
 #else
     // use linear index database (index.dat)
     DcmQueryRetrieveIndexDatabaseHandleFactory factory(&config);
+    factory.setStoreJournal(options.storeJournal_);
 #endif
 
-    DcmQueryRetrieveSCP scp(config, options, factory);
-    scp.setDatabaseFlags(opt_checkFindIdentifier, opt_checkMoveIdentifier);
-
-    /* loop waiting for associations */
-    while (cond.good())
     {
-      cond = scp.waitForAssociation(options.net_);
-      if (!options.singleProcess_) scp.cleanChildren();  /* clean up any child processes */
+      DcmQueryRetrieveSCP scp(config, options, factory);
+      scp.setDatabaseFlags(opt_checkFindIdentifier, opt_checkMoveIdentifier);
+
+      /* loop waiting for associations */
+      while (cond.good())
+      {
+        cond = scp.waitForAssociation(options.net_);
+        if (!options.singleProcess_) scp.cleanChildren();  /* clean up any child processes */
+      }
+
+      /* the SCP object waits for associations handled by worker threads,
+       * which might still need the network for C-STORE sub-operations
+       */
     }
 
     cond = ASC_dropNetwork(&options.net_);
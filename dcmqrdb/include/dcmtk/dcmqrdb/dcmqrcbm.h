@@ -25,14 +25,29 @@
 #include "dcmtk/config/osconfig.h"    /* make sure OS specific configuration is included first */
 #include "dcmtk/dcmnet/dimse.h"
 #include "dcmtk/dcmqrdb/qrdefine.h"
+#include "dcmtk/dcmqrdb/dcmqrdba.h"    /* for MAXPATHLEN */
+#include "dcmtk/ofstd/oflist.h"
+#include "dcmtk/ofstd/ofvector.h"
+
+#ifdef WITH_THREADS
+#include "dcmtk/ofstd/ofthread.h"
+#endif
 
 class DcmQueryRetrieveDatabaseHandle;
 class DcmQueryRetrieveOptions;
 class DcmQueryRetrieveConfig;
 class DcmQueryRetrieveDatabaseStatus;
+class DcmQueryRetrieveMoveWorker;
 
 /** this class maintains the context information that is passed to the
  *  callback function called by DIMSE_moveProvider.
+ *  The C-STORE sub-operations are performed over one sub-association to the
+ *  move destination. If more than one sub-association is requested (see
+ *  DcmQueryRetrieveOptions::moveSubAssociations_), each sub-association is
+ *  served by a separate thread that takes the next image from a common list,
+ *  and the pending C-MOVE responses report the aggregated progress of all
+ *  sub-associations. In both cases, the files of the next few images are
+ *  read ahead while the current image is being sent.
  */
 class DCMTK_DCMQRDB_EXPORT DcmQueryRetrieveMoveContext
 {
@@ -72,10 +87,24 @@ public:
     , nCompleted(0)
     , nFailed(0)
     , nWarning(0)
+    , readAhead()
+    , dbRemaining(0)
+    , dbExhausted(OFFalse)
+    , dbFinalStatus(STATUS_Success)
+    , parallelAssocs()
+    , workers()
+    , runningWorkers(0)
+    , activeSubOps(0)
+    , cancelRequested(OFFalse)
+#ifdef WITH_THREADS
+    , mutex()
+    , progress(0)
+#endif
     {
       origAETitle[0] = '\0';
       origHostName[0] = '\0';
       dstAETitle[0] = '\0';
+      dstHostNamePlusPort[0] = '\0';
     }
 
     /** callback handler called by the DIMSE_storeProvider callback function.
@@ -103,8 +132,24 @@ public:
       if (ae) ourAETitle = ae; else ourAETitle.clear();
     }
 
+    /// destructor, terminates the sub-associations if still open
+    ~DcmQueryRetrieveMoveContext();
+
 private:
 
+    friend class DcmQueryRetrieveMoveWorker;
+
+    /// image to be sent by a C-STORE sub-operation
+    struct SubOperation
+    {
+      /// SOP Class UID of the image
+      DIC_UI sopClass;
+      /// SOP Instance UID of the image
+      DIC_UI sopInstance;
+      /// name of the image file
+      char fileName[MAXPATHLEN + 1];
+    };
+
     /// private undefined copy constructor
     DcmQueryRetrieveMoveContext(const DcmQueryRetrieveMoveContext& other);
 
@@ -112,10 +157,51 @@ private:
     DcmQueryRetrieveMoveContext& operator=(const DcmQueryRetrieveMoveContext& other);
 
     void addFailedUIDInstance(const char *sopInstance);
-    OFCondition performMoveSubOp(DIC_UI sopClass, DIC_UI sopInstance, char *fname);
+
+    /** increment a sub-operation counter and, for failed sub-operations,
+     *  add the SOP Instance UID to the list of failed instances. Locks the
+     *  mutex in parallel mode.
+     *  @param counter counter to be incremented
+     *  @param failedInstance SOP Instance UID of a failed sub-operation, may be NULL
+     */
+    void countSubOperation(DIC_US *counter, const char *failedInstance);
+
+    OFCondition performMoveSubOp(T_ASC_Association *assoc, DIC_UI sopClass, DIC_UI sopInstance, char *fname);
     OFCondition buildSubAssociation(T_DIMSE_C_MoveRQ *request);
+    OFCondition requestSubAssociation(T_ASC_Association **assoc);
     OFCondition closeSubAssociation();
+    void releaseSubAssociation(T_ASC_Association **assoc);
     void moveNextImage(DcmQueryRetrieveDatabaseStatus * dbStatus);
+
+    /** take the next image to be sent from the read-ahead list, which is
+     *  refilled from the database. Must be called with the mutex locked in
+     *  parallel mode.
+     *  @param subOp next image upon successful return
+     *  @return OFTrue if there is another image, OFFalse otherwise
+     */
+    OFBool nextSubOperation(SubOperation& subOp);
+
+    /// number of sub-operations that have not been completed yet
+    DIC_US remainingSubOperations() const;
+
+    /** start the threads for parallel sub-operations if more than one
+     *  sub-association has been requested and established
+     *  @return OFTrue if the sub-operations are performed in parallel
+     */
+    OFBool startParallelSubOperations();
+
+    /** wait for the progress of the parallel sub-operations and update the
+     *  status, which remains pending until all threads have finished
+     *  @param cancelled flag indicating whether a C-CANCEL was received
+     *  @param dbStatus status of the move request (in/out)
+     */
+    void waitForParallelSubOperations(OFBool cancelled, DcmQueryRetrieveDatabaseStatus * dbStatus);
+
+    /** perform sub-operations over the given sub-association until there are
+     *  no more images, called by the worker threads
+     *  @param assoc sub-association to be used
+     */
+    void runSubOperations(T_ASC_Association *assoc);
     void failAllSubOperations(DcmQueryRetrieveDatabaseStatus * dbStatus);
     void buildFailedInstanceList(DcmDataset ** rspIds);
     OFBool mapMoveDestination(
@@ -162,6 +248,9 @@ private:
     /// destination title for move
     DIC_AE dstAETitle;
 
+    /// presentation address (host:port) of the move destination
+    DIC_NODENAME dstHostNamePlusPort;
+
     /// instance UIDs of failed store sub-ops
     char *failedUIDs;
 
@@ -177,6 +266,41 @@ private:
     /// number of completed sub-operations that causes warnings
     DIC_US nWarning;
 
+    /// images taken from the database whose files are being read ahead
+    OFList<SubOperation> readAhead;
+
+    /// number of images remaining in the database
+    DIC_US dbRemaining;
+
+    /// true if all images have been taken from the database
+    OFBool dbExhausted;
+
+    /// status returned by the database after the last image
+    DIC_US dbFinalStatus;
+
+    /// additional sub-associations for parallel sub-operations
+    OFVector<T_ASC_Association *> parallelAssocs;
+
+    /// threads performing parallel sub-operations, one per sub-association
+    OFVector<DcmQueryRetrieveMoveWorker *> workers;
+
+    /// number of threads that have not finished yet
+    size_t runningWorkers;
+
+    /// number of sub-operations currently in progress
+    DIC_US activeSubOps;
+
+    /// true if the parallel sub-operations are to be cancelled
+    OFBool cancelRequested;
+
+#ifdef WITH_THREADS
+    /// mutex protecting the counters and lists in parallel mode
+    OFMutex mutex;
+
+    /// semaphore posted whenever a parallel sub-operation or thread finishes
+    OFSemaphore progress;
+#endif
+
 };
 
 #endif
@@ -0,0 +1,248 @@
+/*
+ *
+ *  Copyright (C) 2016, OFFIS e.V.
+ *  All rights reserved.  See COPYRIGHT file for details.
+ *
+ *  This software and supporting documentation were developed by
+ *
+ *    OFFIS e.V.
+ *    R&D Division Health
+ *    Escherweg 2
+ *    D-26121 Oldenburg, Germany
+ *
+ *
+ *  Module:  dcmqrdb
+ *
+ *  Author:  OFFIS DICOM Team
+ *
+ *  Purpose: class DcmQueryRetrieveCompactIndex
+ *
+ */
+
+#ifndef DCMQRDBC_H
+#define DCMQRDBC_H
+
+#include "dcmtk/config/osconfig.h"    /* make sure OS specific configuration is included first */
+
+#include "dcmtk/ofstd/ofcond.h"
+#include "dcmtk/dcmqrdb/qrdefine.h"
+
+/// size of a record slot (and of the file header) in the compact index file format
+#define DB_CompactSlotSize 512
+
+/** This class implements the compact format of the "index.dat" file. In the
+ *  original format, each record is a binary copy of struct IdxRecord, which
+ *  reserves the maximum length for each attribute value and is therefore
+ *  several kilobytes large, mostly filled with zeros. In the compact format,
+ *  each record occupies a slot of DB_CompactSlotSize bytes, which contains the
+ *  record encoded with variable-length attribute values (see
+ *  DcmQueryRetrieveIndexDatabaseHandle). Encoded records that do not fit into
+ *  their slot are stored in a separate heap file ("index.heap"), and the slot
+ *  only refers to the location in the heap. Since records keep their index,
+ *  files derived from the index file remain valid. This class only deals with
+ *  encoded records, the index file itself is opened and locked by the caller.
+ *  An index file in the original format can be converted in place, see
+ *  DcmQueryRetrieveIndexDatabaseHandle::convertIndexFile().
+ */
+class DCMTK_DCMQRDB_EXPORT DcmQueryRetrieveCompactIndex
+{
+public:
+
+  /// default constructor
+  DcmQueryRetrieveCompactIndex();
+
+  /// destructor, closes the heap file
+  ~DcmQueryRetrieveCompactIndex();
+
+  /** check whether the given index file is in compact format.
+   *  @param fd file descriptor of the index file
+   *  @return OFTrue if the file starts with the header of the compact format,
+   *    OFFalse otherwise (e.g. for an empty file)
+   */
+  static OFBool isCompactFile(int fd);
+
+  /** attach to an index file in compact format. An empty index file is
+   *  initialized with the header of the compact format.
+   *  @param fd file descriptor of the index file, not closed by this class
+   *  @param heapFilename path of the heap file, which is created if it does
+   *    not exist
+   *  @return EC_Normal upon success, an error code otherwise
+   */
+  OFCondition open(int fd, const char *heapFilename);
+
+  /// close the heap file and detach from the index file
+  void close();
+
+  /** check whether a conversion of the index file into the compact format has
+   *  been started but not been completed. Such an index file can only be used
+   *  for continuing the conversion.
+   *  @return OFTrue if a conversion is pending, OFFalse otherwise
+   */
+  OFBool conversionPending();
+
+  /** get the number of records (including free ones) in the index file
+   *  @return number of records
+   */
+  int numberOfRecords();
+
+  /** read an encoded record
+   *  @param idx index of the record
+   *  @param buffer buffer for the encoded record
+   *  @param bufsize size of the buffer in bytes
+   *  @param length length of the encoded record upon successful return
+   *  @return EC_Normal upon success, an error code otherwise
+   */
+  OFCondition readRecord(int idx, char *buffer, size_t bufsize, size_t &length);
+
+  /** write an encoded record, replacing the previous content of the slot.
+   *  The caller must hold an exclusive lock on the index file.
+   *  @param idx index of the record, may be the number of records in order
+   *    to append a record
+   *  @param buffer encoded record
+   *  @param length length of the encoded record in bytes
+   *  @return EC_Normal upon success, an error code otherwise
+   */
+  OFCondition writeRecord(int idx, const char *buffer, size_t length);
+
+  /** discard the records buffered for sequential reading. Must be called
+   *  whenever the index file might have been modified by another process,
+   *  i.e.\ when the lock on the index file is acquired or released.
+   */
+  void flushBuffer();
+
+  /** start the conversion of an index file in the original format. The file
+   *  header is overwritten, the study descriptors and records are kept.
+   *  @param fd file descriptor of the index file, not closed by this class
+   *  @param heapFilename path of the heap file, which is recreated
+   *  @param legacyRecords number of records in the original format
+   *  @return EC_Normal upon success, an error code otherwise
+   */
+  OFCondition beginConversion(int fd, const char *heapFilename, int legacyRecords);
+
+  /** get the number of records in the original format to be converted
+   *  @return number of records, only valid while a conversion is pending
+   */
+  int legacyRecords() const;
+
+  /** get the number of records that have already been converted
+   *  @return number of converted records, only valid while a conversion is pending
+   */
+  int convertedRecords() const;
+
+  /** set the number of records that have already been converted, so that an
+   *  interrupted conversion can be continued
+   *  @param count number of converted records
+   *  @return EC_Normal upon success, an error code otherwise
+   */
+  OFCondition setConvertedRecords(int count);
+
+  /** finish the conversion of the index file and remove the remaining data
+   *  of the original format from the end of the file
+   *  @return EC_Normal upon success, an error code otherwise
+   */
+  OFCondition endConversion();
+
+private:
+
+  /// private undefined copy constructor
+  DcmQueryRetrieveCompactIndex(const DcmQueryRetrieveCompactIndex& other);
+
+  /// private undefined assignment operator
+  DcmQueryRetrieveCompactIndex& operator=(const DcmQueryRetrieveCompactIndex& other);
+
+  /// header of the index file in compact format
+  struct Header
+  {
+    /// magic word and format version
+    char Magic[8];
+    /// size of a record slot, used to detect incompatible files
+    Uint32 SlotSize;
+    /// non-zero while the index file is being converted from the original format
+    Uint32 Converting;
+    /// number of records in the original format (only while converting)
+    Uint32 LegacyRecords;
+    /// number of records already converted (only while converting)
+    Uint32 ConvertedRecords;
+  };
+
+  /// header of the heap file
+  struct HeapHeader
+  {
+    /// magic word and format version
+    char Magic[8];
+    /// heads of the lists of free extents, one for each size class
+    Uint32 FreeExtent[4];
+  };
+
+  /** read the header of the index file
+   *  @return EC_Normal upon success, an error code otherwise
+   */
+  OFCondition readHeader();
+
+  /** write the header of the index file
+   *  @return EC_Normal upon success, an error code otherwise
+   */
+  OFCondition writeHeader();
+
+  /** open the heap file
+   *  @param heapFilename path of the heap file
+   *  @param truncate discard the current content of the heap file if OFTrue
+   *  @return EC_Normal upon success, an error code otherwise
+   */
+  OFCondition openHeap(const char *heapFilename, OFBool truncate);
+
+  /** allocate an extent in the heap file
+   *  @param length required length in bytes
+   *  @param offset offset of the extent upon successful return
+   *  @return EC_Normal upon success, an error code otherwise
+   */
+  OFCondition allocateExtent(Uint32 length, Uint32 &offset);
+
+  /** release an extent in the heap file for later reuse
+   *  @param offset offset of the extent
+   *  @param length length of the data stored in the extent
+   *  @return EC_Normal upon success, an error code otherwise
+   */
+  OFCondition releaseExtent(Uint32 offset, Uint32 length);
+
+  /** read a block of data from a file
+   *  @param fd file descriptor
+   *  @param offset file offset
+   *  @param buffer buffer to be filled
+   *  @param length number of bytes to be read
+   *  @return number of bytes read (less than length at the end of file), -1 on error
+   */
+  static long readBlock(int fd, long offset, char *buffer, size_t length);
+
+  /** write a block of data to a file
+   *  @param fd file descriptor
+   *  @param offset file offset
+   *  @param buffer data to be written
+   *  @param length number of bytes to be written
+   *  @return EC_Normal upon success, an error code otherwise
+   */
+  static OFCondition writeBlock(int fd, long offset, const char *buffer, size_t length);
+
+  /// file descriptor of the index file, -1 if not attached
+  int fd_;
+
+  /// file descriptor of the heap file, -1 if not open
+  int heapFd_;
+
+  /// header as read from or written to the index file
+  Header header_;
+
+  /// slots buffered for sequential reading
+  char *buffer_;
+
+  /// index of the first buffered slot
+  int bufferFirst_;
+
+  /// number of buffered slots
+  int bufferCount_;
+
+  /// index of the record read last, used to detect sequential reading
+  int lastRead_;
+};
+
+#endif
@@ -0,0 +1,212 @@
+/*
+ *
+ *  Copyright (C) 2016, OFFIS e.V.
+ *  All rights reserved.  See COPYRIGHT file for details.
+ *
+ *  This software and supporting documentation were developed by
+ *
+ *    OFFIS e.V.
+ *    R&D Division Health
+ *    Escherweg 2
+ *    D-26121 Oldenburg, Germany
+ *
+ *
+ *  Module:  dcmqrdb
+ *
+ *  Author:  OFFIS DICOM Team
+ *
+ *  Purpose: class DcmQueryRetrieveSummaryCache
+ *
+ */
+
+#ifndef DCMQRDBG_H
+#define DCMQRDBG_H
+
+#include "dcmtk/config/osconfig.h"    /* make sure OS specific configuration is included first */
+
+#include "dcmtk/ofstd/ofstring.h"
+#include "dcmtk/ofstd/ofvector.h"
+#include "dcmtk/dcmqrdb/qrdefine.h"
+
+#ifdef WITH_THREADS
+#include "dcmtk/ofstd/ofthread.h"
+#endif
+
+/** This class maintains an in-memory summary of the studies and series of a
+ *  storage area. For each series, the indexes of all records of the series
+ *  in the index file are kept, so that study and series level queries only
+ *  need to check one record (the one with the lowest index) per study or
+ *  series instead of all instance records, and so that the number of series
+ *  and instances of a study can be returned without counting records.
+ *  Each database handle has its own cache by default. The index database
+ *  factory creates one cache per storage area, which is shared by all handles
+ *  it creates for that storage area (e.g.\ all associations handled by a
+ *  multi-threaded server), see DcmQueryRetrieveIndexDatabaseHandle::setSummaryCache().
+ *  The cache is tied to the generation counter of
+ *  the study table (see DcmQueryRetrieveStudyTable::generation()): records
+ *  added or removed by the same process are applied incrementally, changes
+ *  made by other processes are detected by a different generation and cause
+ *  the summary to be rebuilt from the index file. All public methods are
+ *  thread-safe, but the caller must hold a lock on the index file so that
+ *  the generation counter and the index file are consistent.
+ */
+class DCMTK_DCMQRDB_EXPORT DcmQueryRetrieveSummaryCache
+{
+public:
+
+  /// default constructor, creates an empty summary that is not current
+  DcmQueryRetrieveSummaryCache();
+
+  /// destructor
+  ~DcmQueryRetrieveSummaryCache();
+
+  /** check whether the summary reflects the given generation of the index file
+   *  @param generation current generation counter of the study table
+   *  @return OFTrue if the summary is current, OFFalse if it must be rebuilt
+   */
+  OFBool isCurrent(Uint32 generation);
+
+  /** add a record to the summary without any locking or generation check.
+   *  Only to be used for building a summary that is not shared yet, see
+   *  replace().
+   *  @param idx index of the record in the index file
+   *  @param studyUID Study Instance UID of the record
+   *  @param seriesUID Series Instance UID of the record
+   */
+  void addRecord(int idx, const char *studyUID, const char *seriesUID);
+
+  /** replace the content of this cache by the content of a summary built
+   *  with addRecord(). The other summary is left empty.
+   *  @param other summary to be taken over
+   *  @param generation generation counter of the study table that the
+   *    summary has been built for
+   */
+  void replace(DcmQueryRetrieveSummaryCache &other, Uint32 generation);
+
+  /** update the summary after a record has been added to the index file.
+   *  The update is only applied if the summary was current before the
+   *  record was added, otherwise the summary remains outdated.
+   *  @param oldGeneration generation counter before adding the record
+   *  @param newGeneration generation counter after adding the record
+   *  @param idx index of the new record
+   *  @param studyUID Study Instance UID of the new record
+   *  @param seriesUID Series Instance UID of the new record
+   */
+  void recordAdded(Uint32 oldGeneration, Uint32 newGeneration, int idx, const char *studyUID, const char *seriesUID);
+
+  /** update the summary after a record has been removed from the index file.
+   *  The update is only applied if the summary was current before the
+   *  record was removed, otherwise the summary remains outdated.
+   *  @param oldGeneration generation counter before removing the record
+   *  @param newGeneration generation counter after removing the record
+   *  @param idx index of the removed record
+   *  @param studyUID Study Instance UID of the removed record
+   *  @param seriesUID Series Instance UID of the removed record
+   */
+  void recordRemoved(Uint32 oldGeneration, Uint32 newGeneration, int idx, const char *studyUID, const char *seriesUID);
+
+  /** mark the summary as outdated, e.g.\ after the generation counter of
+   *  the study table could not be updated. The summary is rebuilt when it
+   *  is used next.
+   */
+  void invalidate();
+
+  /** get one record per study, i.e.\ the record with the lowest index
+   *  @param result indexes of the records in ascending order
+   *  @return OFTrue upon success, OFFalse if the summary cannot be used
+   *    (e.g. because there are records without Study Instance UID)
+   */
+  OFBool getStudyRecords(OFVector<int> &result);
+
+  /** get one record per series, i.e.\ the record with the lowest index
+   *  @param studyUID only consider the series of this study if not NULL
+   *  @param result indexes of the records in ascending order
+   *  @return OFTrue upon success, OFFalse if the summary cannot be used
+   */
+  OFBool getSeriesRecords(const char *studyUID, OFVector<int> &result);
+
+  /** get the number of series and instances of a study
+   *  @param studyUID Study Instance UID
+   *  @param numSeries number of series upon successful return
+   *  @param numInstances number of instances upon successful return
+   *  @return OFTrue upon success, OFFalse if the study is unknown
+   */
+  OFBool getStudyCounts(const char *studyUID, size_t &numSeries, size_t &numInstances);
+
+private:
+
+  /// private undefined copy constructor
+  DcmQueryRetrieveSummaryCache(const DcmQueryRetrieveSummaryCache& other);
+
+  /// private undefined assignment operator
+  DcmQueryRetrieveSummaryCache& operator=(const DcmQueryRetrieveSummaryCache& other);
+
+  /// summary of a series
+  struct SeriesSummary
+  {
+    /// Series Instance UID
+    OFString uid;
+
+    /// indexes of the records of the series in ascending order
+    OFVector<int> records;
+  };
+
+  /// summary of a study
+  struct StudySummary
+  {
+    /// default constructor
+    StudySummary() : uid(), series(), numInstances(0) { }
+
+    /// destructor
+    ~StudySummary();
+
+    /// Study Instance UID
+    OFString uid;
+
+    /// series of the study, sorted by Series Instance UID
+    OFVector<SeriesSummary *> series;
+
+    /// number of instances of the study
+    size_t numInstances;
+  };
+
+  /// studies of the storage area, sorted by Study Instance UID
+  typedef OFVector<StudySummary *> StudyList;
+
+  /// remove all studies from the summary, the caller must hold the mutex
+  void clear();
+
+  /** add a record to the summary, the caller must hold the mutex
+   *  @param idx index of the record
+   *  @param studyUID Study Instance UID of the record
+   *  @param seriesUID Series Instance UID of the record
+   */
+  void insertRecord(int idx, const char *studyUID, const char *seriesUID);
+
+  /** remove a record from the summary, the caller must hold the mutex
+   *  @param idx index of the record
+   *  @param studyUID Study Instance UID of the record
+   *  @param seriesUID Series Instance UID of the record
+   *  @return OFTrue if the record was found, OFFalse otherwise
+   */
+  OFBool eraseRecord(int idx, const char *studyUID, const char *seriesUID);
+
+  /// summary of all studies
+  StudyList studies_;
+
+  /// number of records without Study Instance UID
+  size_t incomplete_;
+
+  /// generation counter of the study table that the summary reflects
+  Uint32 generation_;
+
+  /// OFTrue if generation_ is valid, i.e.\ the summary has been built
+  OFBool current_;
+
+#ifdef WITH_THREADS
+  /// mutex protecting the summary
+  OFMutex mutex_;
+#endif
+};
+
+#endif
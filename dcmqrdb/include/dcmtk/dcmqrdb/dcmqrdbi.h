@@ -28,16 +28,37 @@
 #include "dcmtk/dcmnet/dicom.h"
 #include "dcmtk/dcmnet/dimse.h"
 #include "dcmtk/ofstd/offname.h"
+#include "dcmtk/ofstd/ofstring.h"
+#include "dcmtk/ofstd/ofvector.h"
+
+#ifdef WITH_THREADS
+#include "dcmtk/ofstd/ofthread.h"
+#endif
 
 struct StudyDescRecord;
 struct DB_Private_Handle;
 struct DB_SmallDcmElmt;
 struct IdxRecord;
+struct ImagesofStudyArray;
 struct DB_ElementList;
 class DcmQueryRetrieveConfig;
+class DcmQueryRetrieveKeyIndex;
+class DcmQueryRetrieveStudyTable;
+class DcmQueryRetrieveCompactIndex;
+class DcmQueryRetrieveSummaryCache;
+class DcmQueryRetrieveStoreJournal;
 
 #define DBINDEXFILE "index.dat"
 
+/// name of the file containing the secondary (key) index for the index file
+#define DBKEYINDEXFILE "index.key"
+
+/// name of the file containing the study descriptors for the index file
+#define DBSTUDYFILE "study.dat"
+
+/// name of the file containing the long records of an index file in compact format
+#define DBHEAPFILE "index.heap"
+
 #ifndef _WIN32
 /* we lock image files on all platforms except Win32 where it does not work
  * due to the different semantics of LockFile/LockFileEx compared to flock.
@@ -76,7 +97,37 @@ enum DVIFhierarchyStatus
   DVIF_objectContainsNewSubobjects
 };
 
-/// upper limit for the number of studies per storage area
+/** description of a DICOM object that has been received through a C-STORE
+ *  operation and stored in a file, to be registered in the database with
+ *  DcmQueryRetrieveIndexDatabaseHandle::storeRequests()
+ */
+struct DCMTK_DCMQRDB_EXPORT DcmQueryRetrieveStoreRequest
+{
+  /// default constructor
+  DcmQueryRetrieveStoreRequest()
+  : sopClassUID(), sopInstanceUID(), fileName(), isNew(OFTrue), status(STATUS_Success) { }
+
+  /// SOP class UID of the DICOM instance
+  OFString sopClassUID;
+
+  /// SOP instance UID of the DICOM instance
+  OFString sopInstanceUID;
+
+  /// file name (full path) of the DICOM instance
+  OFString fileName;
+
+  /// if true, the instance is marked as "new" in the database
+  OFBool isNew;
+
+  /// DIMSE status code of the registration, set by storeRequests()
+  DIC_US status;
+};
+
+/** number of study descriptors at the start of the index file. The study
+ *  descriptors are now maintained in a separate file (see DBSTUDYFILE) and
+ *  the number of studies per storage area is not limited anymore, but the
+ *  space is still reserved in the index file for reasons of compatibility.
+ */
 #define DB_UpperMaxStudies              500
 
 /// upper limit for the number bytes per study
@@ -102,7 +153,8 @@ public:
    *  database storage area (storageArea).
    *  @param storageArea name of storage area, must not be NULL
    *  @param maxStudiesPerStorageArea maximum number of studies for this storage area,
-   *    needed to correctly parse the index file.
+   *    used by the quota mechanism. A negative value means that the number of
+   *    studies is not limited.
    *  @param maxBytesPerStudy maximum number of bytes per study, for quota mechanism
    *  @param result upon successful initialization of the database handle,
    *    EC_Normal is returned in this parameter, otherwise an error code is returned.
@@ -157,6 +209,17 @@ public:
       const char *imageFileName,
       DcmQueryRetrieveDatabaseStatus  *status,
       OFBool     isNew = OFTrue );
+
+  /** register a number of DICOM objects in the database. The files are
+   *  parsed before the index file is locked, and the lock is acquired only
+   *  once for all objects. The store journal (see enableStoreJournal()) is
+   *  not used by this method.
+   *  @param requests objects to be registered, the status of each object
+   *    is set upon return
+   *  @return EC_Normal if all objects have been registered, an error code
+   *    if the registration of at least one object failed
+   */
+  OFCondition storeRequests(OFVector<DcmQueryRetrieveStoreRequest> &requests);
   
   /** initiate FIND operation using the given SOP class UID (which identifies
    *  the query model) and DICOM dataset containing find request identifiers. 
@@ -263,6 +326,29 @@ public:
    */
   void enableQuotaSystem(OFBool enable);
 
+  /** enable/disable the store journal (default: disabled). If enabled,
+   *  storeRequest() only appends the object to a journal file in the storage
+   *  area, which is written to disk before the method returns, and the
+   *  object is registered in the index file by a background thread that
+   *  processes the journal in batches. Until then, the object is not found
+   *  by queries. Journals left over by terminated processes are replayed
+   *  when the journal is first used. Only available if compiled with
+   *  thread support.
+   *  @param enable enable or disable the store journal
+   */
+  void enableStoreJournal(OFBool enable);
+
+  /** share the summary of the studies and series of the storage area with
+   *  other database handles for the same storage area (default: each handle
+   *  has its own summary, see DcmQueryRetrieveSummaryCache). The index
+   *  database factory shares one summary between all handles it creates
+   *  for a storage area.
+   *  @param cache summary to be used instead of the handle's own one, NULL
+   *    to use the handle's own summary again. The summary must belong to
+   *    the same storage area and exist as long as it is used by this handle.
+   */
+  void setSummaryCache(DcmQueryRetrieveSummaryCache *cache);
+
   /** dump database index file to stdout.
    *  @param storeArea name of storage area, must not be NULL
    */
@@ -313,18 +399,37 @@ public:
    */
   OFCondition DB_IdxRead(int idx, IdxRecord *idxRec);
 
-  /** get study descriptor record from start of index file
-   *  @param pStudyDesc pointer to study record descriptor structure
+  /** get the study descriptors of the first DB_UpperMaxStudies studies.
+   *  This method is only provided for compatibility with previous versions,
+   *  use DB_FindStudyDesc() instead.
+   *  @param pStudyDesc pointer to an array of DB_UpperMaxStudies study
+   *    descriptors (see SIZEOF_STUDYDESC), unused entries are cleared
    *  @return EC_Normal upon success, an error code otherwise
    */
   OFCondition DB_GetStudyDesc(StudyDescRecord *pStudyDesc);
 
-  /** write study descriptor record to start of index file
-   *  @param pStudyDesc pointer to study record descriptor structure
+  /** update the study descriptors as retrieved with DB_GetStudyDesc().
+   *  This method is only provided for compatibility with previous versions,
+   *  use DB_UpdateStudyDesc() instead.
+   *  @param pStudyDesc pointer to an array of DB_UpperMaxStudies study descriptors
    *  @return EC_Normal upon success, an error code otherwise
    */
   OFCondition DB_StudyDescChange(StudyDescRecord *pStudyDesc);
 
+  /** get the study descriptor of the given study
+   *  @param studyUID Study Instance UID
+   *  @param pStudyDesc pointer to study descriptor, filled upon successful return
+   *  @return EC_Normal if the study is registered in the database, an error code otherwise
+   */
+  OFCondition DB_FindStudyDesc(const char *studyUID, StudyDescRecord *pStudyDesc);
+
+  /** add or replace the study descriptor of a study. A descriptor without
+   *  images removes the study from the study descriptors.
+   *  @param pStudyDesc pointer to study descriptor
+   *  @return EC_Normal upon success, an error code otherwise
+   */
+  OFCondition DB_UpdateStudyDesc(const StudyDescRecord *pStudyDesc);
+
   /** deactivate index record at given index by setting an empty filename
    *  @param idx index
    *  @return EC_Normal upon success, an error code otherwise
@@ -343,14 +448,57 @@ public:
   /// return path to index file
   const char *getIndexFilename() const;
 
+  /** check whether the index file is stored in the compact format, where each
+   *  record only occupies the space needed for its attribute values
+   *  (see DcmQueryRetrieveCompactIndex)
+   *  @return OFTrue if the index file is in compact format, OFFalse otherwise
+   */
+  OFBool isCompactIndexFile() const;
+
+  /** convert the index file from the original format, where each record is
+   *  a binary copy of struct IdxRecord, into the compact format. The file is
+   *  converted in place and the index of each record is retained. If the
+   *  conversion is interrupted, it is continued by the next call of this
+   *  method; the index file cannot be used otherwise until then. Nothing is
+   *  done if the index file is already in compact format.
+   *  @return EC_Normal upon success, an error code otherwise
+   */
+  OFCondition convertIndexFile();
+
       
 private:
 
   OFCondition removeDuplicateImage(
       const char *SOPInstanceUID, const char *StudyInstanceUID,
-      StudyDescRecord *pStudyDesc, const char *newImageFileName);
-  int deleteOldestStudy(StudyDescRecord *pStudyDesc);
-  OFCondition deleteOldestImages(StudyDescRecord *pStudyDesc, int StudyNum, char *StudyUID, long RequiredSize);
+      const char *newImageFileName);
+  OFCondition deleteOldestStudy();
+
+  /** initialize an index record for the given DICOM file. This does not
+   *  require a lock on the index file.
+   *  @param SOPClassUID SOP class UID of the DICOM instance
+   *  @param imageFileName file name (full path) of the DICOM instance
+   *  @param isNew if true, the instance is marked as "new"
+   *  @param idxRec index record, initialized upon successful return
+   *  @param status DIMSE status code set upon failure
+   *  @return EC_Normal upon success, an error code otherwise
+   */
+  OFCondition makeIdxRecord(
+    const char *SOPClassUID,
+    const char *imageFileName,
+    OFBool isNew,
+    IdxRecord &idxRec,
+    DcmQueryRetrieveDatabaseStatus *status);
+
+  /** add an index record created with makeIdxRecord() to the index file,
+   *  replacing a record of the same instance and enforcing the quota.
+   *  The caller must hold an exclusive lock on the index file.
+   *  @param idxRec index record
+   *  @param status DIMSE status code set upon return
+   *  @return EC_Normal upon success, an error code otherwise
+   */
+  OFCondition addIdxRecord(IdxRecord &idxRec, DcmQueryRetrieveDatabaseStatus *status);
+  OFCondition deleteOldestImages(StudyDescRecord &study, long RequiredSize);
+  OFCondition findStudyImages(const char *StudyUID, OFVector<ImagesofStudyArray> &images);
   int matchDate (DB_SmallDcmElmt *mod, DB_SmallDcmElmt *elt);
   int matchTime (DB_SmallDcmElmt *mod, DB_SmallDcmElmt *elt);
   int matchUID (DB_SmallDcmElmt *mod, DB_SmallDcmElmt *elt);
@@ -358,8 +506,7 @@ private:
   int matchOther (DB_SmallDcmElmt *mod, DB_SmallDcmElmt *elt);
   int dbmatch (DB_SmallDcmElmt *mod, DB_SmallDcmElmt *elt);
   void makeResponseList(DB_Private_Handle *phandle, IdxRecord *idxRec);
-  int matchStudyUIDInStudyDesc (StudyDescRecord *pStudyDesc, char *StudyUID, int maxStudiesAllowed);
-  OFCondition checkupinStudyDesc(StudyDescRecord *pStudyDesc, char *StudyUID, long imageSize);
+  OFCondition checkupinStudyDesc(const char *StudyUID, long imageSize);
 
   OFCondition hierarchicalCompare (
       DB_Private_Handle *phandle,
@@ -380,12 +527,124 @@ private:
       DB_LEVEL        infLevel,
       DB_LEVEL        lowestLevel);
 
+  /** make sure that the key index is valid, rebuild it from the index file
+   *  otherwise. The caller must hold an exclusive lock on the database.
+   */
+  void updateKeyIndex();
+
+  /** make sure that the study table is valid, rebuild it from the index
+   *  file otherwise. The caller must hold an exclusive lock on the database.
+   */
+  void updateStudyTable();
+
+  /** rebuild the study table and the list of free records from the index
+   *  file. The caller must hold an exclusive lock on the database.
+   *  @return EC_Normal upon success, an error code otherwise
+   */
+  OFCondition rebuildStudyTable();
+
+  /** add an index record, reusing a free record if possible
+   *  @param idx index of the new record upon successful return
+   *  @param idxRec index record to be added
+   *  @return EC_Normal upon success, an error code otherwise
+   */
+  OFCondition DB_IdxAdd(int *idx, IdxRecord *idxRec);
+
+  /** get the number of records (including free ones) in the index file
+   *  @return number of records
+   */
+  int DB_IdxCount();
+
+  /** write index record at given index
+   *  @param idx index, may be the number of records in order to append a record
+   *  @param idxRec pointer to index record
+   *  @return EC_Normal upon success, an error code otherwise
+   */
+  OFCondition DB_IdxWrite(int idx, IdxRecord *idxRec);
+
+  /** determine the records that might contain the given attribute value
+   *  using the key index.
+   *  @param tag attribute tag
+   *  @param value attribute value
+   *  @param result indexes of candidate records in ascending order
+   *  @return EC_Normal upon success, an error code if the key index cannot
+   *    be used, in which case all records have to be checked
+   */
+  OFCondition lookupKeyIndex(const DcmTagKey &tag, const char *value, OFVector<int> &result);
+
+  /** select the records to be checked for the current find or move request.
+   *  If the request contains a single value matching key that is maintained
+   *  in the key index and used for matching, only the records found in the
+   *  key index for this value are checked, otherwise all records.
+   *  @param qLevel highest level of the current information model
+   */
+  void selectCandidateRecords(DB_LEVEL qLevel);
+
+  /** make sure that the summary cache reflects the current content of the
+   *  index file. The caller must hold a lock on the database.
+   *  @param rebuild rebuild the summary cache from the index file if it is
+   *    outdated, otherwise only check whether it is current
+   *  @return OFTrue if the summary cache can be used, OFFalse otherwise
+   */
+  OFBool updateSummaryCache(OFBool rebuild);
+
+  /** reduce the records to be checked for the current find request to one
+   *  record per study or series if the query level allows for this and the
+   *  summary cache is current, see DcmQueryRetrieveSummaryCache. Must be
+   *  called after selectCandidateRecords().
+   */
+  void selectSummaryRecords();
+
+  /** get next index record that is to be checked for the current find or
+   *  move request (see selectCandidateRecords())
+   *  @param idx pointer to index number, updated upon successful return
+   *  @param idxRec pointer to index record structure
+   *  @return EC_Normal upon success, an error code if there are no more records
+   */
+  OFCondition DB_IdxGetNextCandidate(int *idx, IdxRecord *idxRec);
+
+  /** advance the cursor of the current find request to the next matching
+   *  record and prepare the response list for it. The caller must hold a
+   *  shared lock on the index file. The lock is only held while looking for
+   *  the next match and released before the response is sent, so concurrent
+   *  store requests are not blocked by a find request with many responses.
+   *  Records already reported (same UID on the query level) are skipped.
+   *  @param qLevel highest level of the current information model
+   *  @param matchFound set to OFTrue if a matching record has been found
+   *  @return EC_Normal upon success, an error code otherwise
+   */
+  OFCondition findNextMatch(DB_LEVEL qLevel, OFBool &matchFound);
+
+  /// free all data of the current find request, i.e.\ terminate the cursor
+  void endFindRequest();
+
   /// database handle
   DB_Private_Handle *handle_;
 
+  /// secondary index for the index file, NULL if not available
+  DcmQueryRetrieveKeyIndex *keyIndex_;
+
+  /// study descriptors and list of free records for the index file
+  DcmQueryRetrieveStudyTable *studyTable_;
+
+  /// access to the index file in compact format, NULL for the original format
+  DcmQueryRetrieveCompactIndex *compactIndex_;
+
+  /// summary of the studies and series of the storage area owned by this handle
+  DcmQueryRetrieveSummaryCache *ownSummaryCache_;
+
+  /// summary of the studies and series used by this handle, see setSummaryCache()
+  DcmQueryRetrieveSummaryCache *summaryCache_;
+
+  /// OFTrue if the summary cache is current for the find request in progress
+  OFBool summaryCurrent_;
+
   /// flag indicating whether or not the quota system is enabled
   OFBool quotaSystemEnabled;
 
+  /// flag indicating whether or not the store journal is enabled
+  OFBool storeJournalEnabled;
+
   /// flag indicating whether or not the check function for FIND requests is enabled
   OFBool doCheckFindIdentifier;
 
@@ -399,7 +658,9 @@ private:
 
 
 /** Index database factory class. Instances of this class are able to create database
- *  handles for a given called application entity title.
+ *  handles for a given called application entity title. All handles created for the
+ *  same storage area share one summary cache (see DcmQueryRetrieveSummaryCache), so
+ *  the handles must not be used after the factory has been destroyed.
  */
 class DCMTK_DCMQRDB_EXPORT DcmQueryRetrieveIndexDatabaseHandleFactory: public DcmQueryRetrieveDatabaseHandleFactory
 {
@@ -433,10 +694,37 @@ public:
     const char *calledAETitle,
     OFCondition& result) const;
 
+  /** enable/disable the store journal for all database handles created
+   *  by this factory, see DcmQueryRetrieveIndexDatabaseHandle::enableStoreJournal()
+   *  @param enable enable or disable the store journal
+   */
+  void setStoreJournal(OFBool enable);
+
 private:
 
+  /** get the summary cache shared by all handles for the given storage area.
+   *  The cache is created on first use and deleted with this factory.
+   *  @param storageArea path of the storage area
+   *  @return pointer to the cache, never NULL
+   */
+  DcmQueryRetrieveSummaryCache *getSummaryCache(const char *storageArea) const;
+
   /// pointer to system configuration
   const DcmQueryRetrieveConfig *config_;
+
+  /// flag indicating whether or not the store journal is enabled
+  OFBool storeJournal_;
+
+  /// storage areas for which a summary cache has been created
+  mutable OFVector<OFString> summaryCacheAreas_;
+
+  /// summary caches shared by the handles, one per entry of summaryCacheAreas_
+  mutable OFVector<DcmQueryRetrieveSummaryCache *> summaryCaches_;
+
+#ifdef WITH_THREADS
+  /// mutex protecting the list of summary caches
+  mutable OFMutex summaryCacheMutex_;
+#endif
 };
 
 #endif
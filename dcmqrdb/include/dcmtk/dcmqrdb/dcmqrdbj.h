@@ -0,0 +1,182 @@
+/*
+ *
+ *  Copyright (C) 2016, OFFIS e.V.
+ *  All rights reserved.  See COPYRIGHT file for details.
+ *
+ *  This software and supporting documentation were developed by
+ *
+ *    OFFIS e.V.
+ *    R&D Division Health
+ *    Escherweg 2
+ *    D-26121 Oldenburg, Germany
+ *
+ *
+ *  Module:  dcmqrdb
+ *
+ *  Author:  OFFIS DICOM Team
+ *
+ *  Purpose: class DcmQueryRetrieveStoreJournal
+ *
+ */
+
+#ifndef DCMQRDBJ_H
+#define DCMQRDBJ_H
+
+#include "dcmtk/config/osconfig.h"    /* make sure OS specific configuration is included first */
+
+#include "dcmtk/dcmqrdb/dcmqrdbi.h"
+
+#ifdef WITH_THREADS
+
+#include "dcmtk/ofstd/oflist.h"
+#include "dcmtk/ofstd/ofstring.h"
+#include "dcmtk/ofstd/ofthread.h"
+
+/// name of the directory within the storage area containing the store journals
+#define DBJOURNALDIR "journal"
+
+/** This class maintains a write-ahead journal of received DICOM objects
+ *  that have not yet been registered in the index file of a storage area.
+ *  Appending an object to the journal only requires writing one line to
+ *  the journal file, so that the C-STORE response can be sent without
+ *  waiting for the lock on the index file. A background thread registers
+ *  the journaled objects in batches, see
+ *  DcmQueryRetrieveIndexDatabaseHandle::storeRequests(), which also
+ *  enforces the quota of the storage area. Objects refused at this point
+ *  are deleted from the storage area, although their storage has already
+ *  been acknowledged.
+ *
+ *  There is a single journal per storage area and process. Each process
+ *  alternates between two journal files in the DBJOURNALDIR directory of
+ *  the storage area: new objects are appended to one file while the objects
+ *  of the other file are registered, after which that file is truncated.
+ *  The journal files are locked by the owning process, so that journals of
+ *  processes that have terminated before all objects were registered can be
+ *  detected and replayed by the next process that uses the journal.
+ *  Pending objects are registered before the process exits.
+ */
+class DCMTK_DCMQRDB_EXPORT DcmQueryRetrieveStoreJournal: public OFThread
+{
+public:
+
+  /** get the journal for the given storage area. The journal is created on
+   *  first use, which also replays the journal files left over by other
+   *  processes, and exists until the process terminates.
+   *  @param storageArea path of the storage area
+   *  @param maxStudiesPerStorageArea maximum number of studies for the quota mechanism
+   *  @param maxBytesPerStudy maximum number of bytes per study for the quota mechanism
+   *  @param quotaSystemEnabled enable the quota mechanism when registering objects
+   *  @return pointer to the journal, NULL if the journal cannot be used
+   */
+  static DcmQueryRetrieveStoreJournal *getJournal(
+    const char *storageArea,
+    long maxStudiesPerStorageArea,
+    long maxBytesPerStudy,
+    OFBool quotaSystemEnabled);
+
+  /** append a DICOM object to the journal. The image file and the journal
+   *  file are written to disk before this method returns.
+   *  @param SOPClassUID SOP class UID of the DICOM instance
+   *  @param SOPInstanceUID SOP instance UID of the DICOM instance
+   *  @param imageFileName file name (full path) of the DICOM instance
+   *  @param isNew if true, the instance is marked as "new" in the database
+   *  @return EC_Normal upon success, an error code otherwise
+   */
+  OFCondition append(
+    const char *SOPClassUID,
+    const char *SOPInstanceUID,
+    const char *imageFileName,
+    OFBool isNew);
+
+  /// wait until all objects appended so far have been registered in the index file
+  void flush();
+
+  /// flush all journals of the process
+  static void flushAll();
+
+protected:
+
+  /// register the journaled objects in batches, never returns
+  virtual void run();
+
+private:
+
+  /** constructor
+   *  @param storageArea path of the storage area
+   *  @param handle database handle used for registering the objects
+   */
+  DcmQueryRetrieveStoreJournal(const char *storageArea, DcmQueryRetrieveIndexDatabaseHandle *handle);
+
+  /// destructor, never called since journals exist until the process terminates
+  virtual ~DcmQueryRetrieveStoreJournal();
+
+  /// private undefined copy constructor
+  DcmQueryRetrieveStoreJournal(const DcmQueryRetrieveStoreJournal& other);
+
+  /// private undefined assignment operator
+  DcmQueryRetrieveStoreJournal& operator=(const DcmQueryRetrieveStoreJournal& other);
+
+  /** flush all journals of the process and delete their journal files,
+   *  called when the process exits
+   */
+  static void cleanup();
+
+  /** open and lock the two journal files of this process
+   *  @return EC_Normal upon success, an error code otherwise
+   */
+  OFCondition open();
+
+  /** replay all journal files in the journal directory that are not locked
+   *  by another process, and delete them afterwards
+   */
+  void recover();
+
+  /** register a batch of objects in the index file. The files of objects
+   *  that cannot be registered are deleted.
+   *  @param batch objects to be registered
+   */
+  void registerObjects(OFVector<DcmQueryRetrieveStoreRequest> &batch);
+
+  /// path of the storage area
+  OFString storageArea_;
+
+  /// path of the journal directory
+  OFString directory_;
+
+  /// names of the two journal files of this process
+  OFString fileName_[2];
+
+  /// file descriptors of the two journal files of this process
+  int fd_[2];
+
+  /// index of the journal file new objects are appended to
+  int active_;
+
+  /// objects appended to the active journal file
+  OFVector<DcmQueryRetrieveStoreRequest> pending_;
+
+  /// number of objects appended to the journal
+  unsigned long appended_;
+
+  /// number of objects processed by the background thread
+  unsigned long processed_;
+
+  /// number of threads waiting in flush()
+  unsigned long waiting_;
+
+  /// database handle used by the background thread
+  DcmQueryRetrieveIndexDatabaseHandle *handle_;
+
+  /// mutex protecting the members above
+  OFMutex mutex_;
+
+  /// semaphore posted when objects have been appended
+  OFSemaphore appendedSem_;
+
+  /// semaphore posted for each waiting thread when a batch has been processed
+  OFSemaphore processedSem_;
+};
+
+#endif
+
+#endif
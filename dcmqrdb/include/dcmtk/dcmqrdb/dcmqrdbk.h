@@ -0,0 +1,270 @@
+/*
+ *
+ *  Copyright (C) 2016, OFFIS e.V.
+ *  All rights reserved.  See COPYRIGHT file for details.
+ *
+ *  This software and supporting documentation were developed by
+ *
+ *    OFFIS e.V.
+ *    R&D Division Health
+ *    Escherweg 2
+ *    D-26121 Oldenburg, Germany
+ *
+ *
+ *  Module:  dcmqrdb
+ *
+ *  Author:  OFFIS DICOM Team
+ *
+ *  Purpose: class DcmQueryRetrieveKeyIndex
+ *
+ */
+
+#ifndef DCMQRDBK_H
+#define DCMQRDBK_H
+
+#include "dcmtk/config/osconfig.h"    /* make sure OS specific configuration is included first */
+
+#include "dcmtk/ofstd/ofcond.h"
+#include "dcmtk/ofstd/ofstring.h"
+#include "dcmtk/ofstd/ofvector.h"
+#include "dcmtk/dcmdata/dctagkey.h"
+#include "dcmtk/dcmqrdb/qrdefine.h"
+
+struct IdxRecord;
+
+/** This class maintains a persistent secondary index for the records of the
+ *  "index.dat" file, which is stored in a separate file ("index.key") in the
+ *  storage area. For each record, the values of the attributes PatientID,
+ *  StudyInstanceUID, SeriesInstanceUID, SOPInstanceUID, AccessionNumber and
+ *  StudyDate are stored in an on-disk hash table with open addressing, which
+ *  maps the hash code of the attribute value to the index of the record.
+ *  A lookup therefore only returns candidate records, which have to be read
+ *  and compared by the caller. The key index file is only modified while the
+ *  caller holds an exclusive lock on the index file. All modifications made
+ *  while the lock is held form one update transaction: the file is marked as
+ *  invalid and synchronized to disk before the first modification, and only
+ *  marked as valid again by commitUpdate() after all modifications have been
+ *  synchronized to disk. If the key index file is missing, outdated or has
+ *  not been updated completely (e.g. because the process or the system
+ *  crashed), it is therefore marked as invalid and must be rebuilt from the
+ *  index file.
+ */
+class DCMTK_DCMQRDB_EXPORT DcmQueryRetrieveKeyIndex
+{
+public:
+
+  /// default constructor
+  DcmQueryRetrieveKeyIndex();
+
+  /// destructor, closes the key index file
+  ~DcmQueryRetrieveKeyIndex();
+
+  /** open the key index file. The file is created if it does not exist,
+   *  in which case it is invalid until it has been rebuilt.
+   *  @param filename path of the key index file
+   *  @return EC_Normal upon success, an error code otherwise
+   */
+  OFCondition open(const char *filename);
+
+  /** close the key index file. An update transaction that is still in
+   *  progress is committed before.
+   */
+  void close();
+
+  /** check whether the key index file is valid, i.e.\ whether it has been
+   *  completely built and all updates have been completed. During an update
+   *  transaction of this object, the key index is valid as long as all
+   *  modifications have been successful.
+   *  @return OFTrue if the key index can be used, OFFalse otherwise
+   */
+  OFBool isValid();
+
+  /** complete the current update transaction, i.e.\ synchronize all
+   *  modifications made by addRecord() and removeRecord() to disk and mark
+   *  the key index file as valid again. Must be called before the exclusive
+   *  lock on the index file is released. Nothing is done if no modification
+   *  has been made since the last call.
+   *  @return EC_Normal upon success, an error code otherwise
+   */
+  OFCondition commitUpdate();
+
+  /** start rebuilding the key index. All entries are removed and the key
+   *  index is marked as invalid. Records added until endRebuild() is called
+   *  are collected in memory.
+   *  @param expectedRecords expected number of records, used to determine
+   *    the initial size of the hash table
+   *  @return EC_Normal upon success, an error code otherwise
+   */
+  OFCondition beginRebuild(size_t expectedRecords);
+
+  /** finish rebuilding the key index, write all entries collected since the
+   *  call of beginRebuild() to file and mark the key index as valid.
+   *  @return EC_Normal upon success, an error code otherwise
+   */
+  OFCondition endRebuild();
+
+  /** add the keys of the given index record. Starts an update transaction
+   *  if none is in progress (see commitUpdate()).
+   *  @param idx index of the record in the index file
+   *  @param idxRec index record
+   *  @return EC_Normal upon success, an error code otherwise
+   */
+  OFCondition addRecord(int idx, const IdxRecord &idxRec);
+
+  /** remove the keys of the given index record. Starts an update transaction
+   *  if none is in progress (see commitUpdate()).
+   *  @param idx index of the record in the index file
+   *  @param idxRec index record as stored before removal
+   *  @return EC_Normal upon success, an error code otherwise
+   */
+  OFCondition removeRecord(int idx, const IdxRecord &idxRec);
+
+  /** determine all records that might contain the given attribute value.
+   *  @param tag attribute tag, must be an indexed key
+   *  @param value attribute value (single value matching only)
+   *  @param result indexes of the candidate records in ascending order
+   *  @return EC_Normal upon success, an error code otherwise
+   */
+  OFCondition findRecords(const DcmTagKey &tag,
+                          const char *value,
+                          OFVector<int> &result);
+
+  /** determine the priority with which an attribute should be used for a
+   *  lookup. Lower values identify more selective keys.
+   *  @param tag attribute tag
+   *  @return priority (starting with 0), or -1 if the attribute is not indexed
+   */
+  static int keyPriority(const DcmTagKey &tag);
+
+  /** check whether a value used for matching in a query is a single value
+   *  that can be looked up in the key index, i.e.\ does not contain wild
+   *  cards, ranges or lists of UIDs.
+   *  @param tag attribute tag
+   *  @param value query value
+   *  @return OFTrue if the value can be looked up, OFFalse otherwise
+   */
+  static OFBool isSingleValue(const DcmTagKey &tag, const char *value);
+
+private:
+
+  /// private undefined copy constructor
+  DcmQueryRetrieveKeyIndex(const DcmQueryRetrieveKeyIndex& other);
+
+  /// private undefined assignment operator
+  DcmQueryRetrieveKeyIndex& operator=(const DcmQueryRetrieveKeyIndex& other);
+
+  /// header of the key index file
+  struct Header
+  {
+    /// magic word and format version
+    char Magic[8];
+    /// size of an index record, used to detect incompatible index files
+    Uint32 RecordSize;
+    /// number of buckets in the hash table (power of 2)
+    Uint32 NumBuckets;
+    /// number of buckets in use
+    Uint32 NumUsed;
+    /// number of buckets containing removed entries
+    Uint32 NumRemoved;
+    /// non-zero if the key index is valid
+    Uint32 Valid;
+  };
+
+  /// single bucket of the hash table
+  struct Bucket
+  {
+    /// hash code of the attribute value
+    Uint32 Hash;
+    /// index of the record, or one of the special values for empty/removed buckets
+    Sint32 Record;
+  };
+
+  /** compute the hash code for the given attribute value
+   *  @param tag attribute tag
+   *  @param value attribute value
+   *  @return hash code
+   */
+  static Uint32 hashValue(const DcmTagKey &tag, const char *value);
+
+  /** read the header from file
+   *  @return EC_Normal upon success, an error code otherwise
+   */
+  OFCondition readHeader();
+
+  /** write the header to file
+   *  @return EC_Normal upon success, an error code otherwise
+   */
+  OFCondition writeHeader();
+
+  /** read consecutive buckets from file
+   *  @param first index of first bucket
+   *  @param count number of buckets
+   *  @param buckets array of buckets to be filled
+   *  @return EC_Normal upon success, an error code otherwise
+   */
+  OFCondition readBuckets(Uint32 first, Uint32 count, Bucket *buckets);
+
+  /** write consecutive buckets to file
+   *  @param first index of first bucket
+   *  @param count number of buckets
+   *  @param buckets array of buckets to be written
+   *  @return EC_Normal upon success, an error code otherwise
+   */
+  OFCondition writeBuckets(Uint32 first, Uint32 count, const Bucket *buckets);
+
+  /** insert an entry into the hash table in memory (used while rebuilding)
+   *  @param hash hash code
+   *  @param idx record index
+   */
+  void insertInMemory(Uint32 hash, Sint32 idx);
+
+  /** insert an entry into the hash table on file
+   *  @param hash hash code
+   *  @param idx record index
+   *  @return EC_Normal upon success, an error code otherwise
+   */
+  OFCondition insertOnFile(Uint32 hash, Sint32 idx);
+
+  /** enlarge the hash table on file and remove all removed entries
+   *  @return EC_Normal upon success, an error code otherwise
+   */
+  OFCondition grow();
+
+  /** mark the key index file as invalid while it is being modified, or as
+   *  valid after the modification has been completed
+   *  @param valid new state
+   *  @return EC_Normal upon success, an error code otherwise
+   */
+  OFCondition setValid(OFBool valid);
+
+  /** start an update transaction if none is in progress, i.e.\ mark the
+   *  key index file as invalid and synchronize it to disk
+   *  @return EC_Normal upon success, an error code otherwise
+   */
+  OFCondition beginUpdate();
+
+  /** abort the current update transaction after a failed modification. The
+   *  key index file remains marked as invalid and is rebuilt by the next
+   *  writer.
+   */
+  void abortUpdate();
+
+  /** synchronize the key index file to disk
+   *  @return EC_Normal upon success, an error code otherwise
+   */
+  OFCondition syncFile();
+
+  /// file descriptor of the key index file, -1 if not open
+  int fd_;
+
+  /// header as read from or written to file
+  Header header_;
+
+  /// hash table in memory, only used while rebuilding
+  Bucket *memBuckets_;
+
+  /// true while an update transaction is in progress (file marked as invalid)
+  OFBool updating_;
+};
+
+#endif
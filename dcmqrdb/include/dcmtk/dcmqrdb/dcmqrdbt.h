@@ -0,0 +1,250 @@
+/*
+ *
+ *  Copyright (C) 2016, OFFIS e.V.
+ *  All rights reserved.  See COPYRIGHT file for details.
+ *
+ *  This software and supporting documentation were developed by
+ *
+ *    OFFIS e.V.
+ *    R&D Division Health
+ *    Escherweg 2
+ *    D-26121 Oldenburg, Germany
+ *
+ *
+ *  Module:  dcmqrdb
+ *
+ *  Author:  OFFIS DICOM Team
+ *
+ *  Purpose: class DcmQueryRetrieveStudyTable
+ *
+ */
+
+#ifndef DCMQRDBT_H
+#define DCMQRDBT_H
+
+#include "dcmtk/config/osconfig.h"    /* make sure OS specific configuration is included first */
+
+#include "dcmtk/ofstd/ofcond.h"
+#include "dcmtk/ofstd/ofvector.h"
+#include "dcmtk/dcmqrdb/qrdefine.h"
+
+struct StudyDescRecord;
+
+/// special value for an empty list of free records in the index file
+#define DB_NoFreeRecord       -1
+
+/// special value for an unknown list of free records in the index file
+#define DB_UnknownFreeRecords -2
+
+/** This class maintains the study descriptors of a storage area, which are
+ *  needed for the quota mechanism, in a separate file ("study.dat"). Unlike
+ *  the fixed-size array of study descriptors at the start of the "index.dat"
+ *  file used by previous versions, the number of studies is not limited.
+ *  The study descriptors are stored in an on-disk hash table with open
+ *  addressing, keyed by the Study Instance UID, that is read in pages of
+ *  consecutive descriptors and grows as needed. Looking up and updating a
+ *  study therefore does not depend on the number of studies. In addition,
+ *  the file contains the head of the list of free records in the index file,
+ *  which allows for reusing the records of deleted images without scanning
+ *  the index file. The file is only modified while the caller holds an
+ *  exclusive lock on the index file. If the file is missing or has not been
+ *  updated completely (e.g. because the process was terminated), it is
+ *  marked as invalid and must be rebuilt from the index file.
+ */
+class DCMTK_DCMQRDB_EXPORT DcmQueryRetrieveStudyTable
+{
+public:
+
+  /// default constructor
+  DcmQueryRetrieveStudyTable();
+
+  /// destructor, closes the study table file
+  ~DcmQueryRetrieveStudyTable();
+
+  /** open the study table file. The file is created if it does not exist,
+   *  in which case it is invalid until it has been rebuilt.
+   *  @param filename path of the study table file
+   *  @return EC_Normal upon success, an error code otherwise
+   */
+  OFCondition open(const char *filename);
+
+  /// close the study table file
+  void close();
+
+  /** check whether the study table is valid, i.e.\ whether it has been
+   *  completely built and all updates have been completed.
+   *  @return OFTrue if the study table can be used, OFFalse otherwise
+   */
+  OFBool isValid();
+
+  /** start rebuilding the study table. All study descriptors are removed,
+   *  the list of free records is marked as unknown and the study table is
+   *  marked as invalid. Study descriptors updated until endRebuild() is
+   *  called are kept in memory.
+   *  @param expectedStudies expected number of studies, used to determine
+   *    the initial size of the hash table
+   *  @return EC_Normal upon success, an error code otherwise
+   */
+  OFCondition beginRebuild(size_t expectedStudies);
+
+  /** finish rebuilding the study table, write all study descriptors to file
+   *  and mark the study table as valid.
+   *  @return EC_Normal upon success, an error code otherwise
+   */
+  OFCondition endRebuild();
+
+  /** cancel rebuilding the study table after an error. The study table
+   *  remains invalid.
+   */
+  void cancelRebuild();
+
+  /** look up the descriptor of the given study
+   *  @param studyUID Study Instance UID
+   *  @param study descriptor of the study upon successful return
+   *  @return EC_Normal if the study has at least one image, an error code otherwise
+   */
+  OFCondition findStudy(const char *studyUID, StudyDescRecord &study);
+
+  /** add or replace the descriptor of a study. A descriptor without images
+   *  removes the study.
+   *  @param study new descriptor of the study
+   *  @return EC_Normal upon success, an error code otherwise
+   */
+  OFCondition updateStudy(const StudyDescRecord &study);
+
+  /** determine the study that has been updated least recently
+   *  @param study descriptor of the study upon successful return
+   *  @return EC_Normal upon success, an error code if there is no study
+   */
+  OFCondition findOldestStudy(StudyDescRecord &study);
+
+  /** get the descriptors of all studies
+   *  @param studies descriptors of all studies with at least one image
+   *  @return EC_Normal upon success, an error code otherwise
+   */
+  OFCondition getStudies(OFVector<StudyDescRecord> &studies);
+
+  /** get the number of studies with at least one image
+   *  @return number of studies
+   */
+  size_t numberOfStudies() const;
+
+  /** get the head of the list of free records in the index file
+   *  @return index of the first free record, DB_NoFreeRecord if there are
+   *    no free records or DB_UnknownFreeRecords if the list is not known
+   */
+  int firstFreeRecord() const;
+
+  /** set the head of the list of free records in the index file
+   *  @param idx index of the first free record, DB_NoFreeRecord or
+   *    DB_UnknownFreeRecords
+   *  @return EC_Normal upon success, an error code otherwise
+   */
+  OFCondition setFirstFreeRecord(int idx);
+
+  /** get the generation counter of the index file, which is changed
+   *  whenever a record is added to or removed from the index file and
+   *  whenever the study table is rebuilt. It allows for detecting changes
+   *  made by other processes, see DcmQueryRetrieveSummaryCache.
+   *  @return generation counter as read by the last call of isValid()
+   */
+  Uint32 generation() const;
+
+  /** increment the generation counter after a record has been added to or
+   *  removed from the index file
+   *  @return EC_Normal upon success, an error code otherwise
+   */
+  OFCondition incrementGeneration();
+
+private:
+
+  /// private undefined copy constructor
+  DcmQueryRetrieveStudyTable(const DcmQueryRetrieveStudyTable& other);
+
+  /// private undefined assignment operator
+  DcmQueryRetrieveStudyTable& operator=(const DcmQueryRetrieveStudyTable& other);
+
+  /// header of the study table file
+  struct Header
+  {
+    /// magic word and format version
+    char Magic[8];
+    /// size of a study descriptor, used to detect incompatible files
+    Uint32 RecordSize;
+    /// number of slots in the hash table (power of 2)
+    Uint32 NumSlots;
+    /// number of slots containing a Study Instance UID
+    Uint32 NumUsed;
+    /// number of slots containing a study with at least one image
+    Uint32 NumStudies;
+    /// head of the list of free records in the index file
+    Sint32 FreeRecord;
+    /// non-zero if the study table is valid
+    Uint32 Valid;
+    /// generation counter of the index file
+    Uint32 Generation;
+  };
+
+  /** compute the hash code for the given Study Instance UID
+   *  @param studyUID Study Instance UID
+   *  @return hash code
+   */
+  static Uint32 hashValue(const char *studyUID);
+
+  /** read the header from file
+   *  @return EC_Normal upon success, an error code otherwise
+   */
+  OFCondition readHeader();
+
+  /** write the header to file
+   *  @return EC_Normal upon success, an error code otherwise
+   */
+  OFCondition writeHeader();
+
+  /** read consecutive slots from file or from memory while rebuilding
+   *  @param first index of first slot
+   *  @param count number of slots
+   *  @param slots array of slots to be filled
+   *  @return EC_Normal upon success, an error code otherwise
+   */
+  OFCondition readSlots(Uint32 first, Uint32 count, StudyDescRecord *slots);
+
+  /** write consecutive slots to file or to memory while rebuilding
+   *  @param first index of first slot
+   *  @param count number of slots
+   *  @param slots array of slots to be written
+   *  @return EC_Normal upon success, an error code otherwise
+   */
+  OFCondition writeSlots(Uint32 first, Uint32 count, const StudyDescRecord *slots);
+
+  /** find the slot of the given study, or the slot where it should be inserted
+   *  @param studyUID Study Instance UID
+   *  @param slot index of the slot upon successful return
+   *  @param study content of the slot upon successful return
+   *  @return EC_Normal upon success, an error code otherwise
+   */
+  OFCondition findSlot(const char *studyUID, Uint32 &slot, StudyDescRecord &study);
+
+  /** enlarge the hash table and remove all deleted studies
+   *  @return EC_Normal upon success, an error code otherwise
+   */
+  OFCondition grow();
+
+  /** mark the study table as invalid while it is being modified, or as
+   *  valid after the modification has been completed
+   *  @param valid new state
+   *  @return EC_Normal upon success, an error code otherwise
+   */
+  OFCondition setValid(OFBool valid);
+
+  /// file descriptor of the study table file, -1 if not open
+  int fd_;
+
+  /// header as read from or written to file
+  Header header_;
+
+  /// hash table in memory, only used while rebuilding
+  StudyDescRecord *memSlots_;
+};
+
+#endif
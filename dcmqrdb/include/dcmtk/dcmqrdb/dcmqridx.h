@@ -119,7 +119,6 @@ enum DB_KEY_CLASS
 #define DBC_MAXSTRING           256
 
 #define MAX_MAX_STUDIES         DB_UpperMaxStudies
-#define MAX_NUMBER_OF_IMAGES    10000
 #define SIZEOF_IDXRECORD        (sizeof (IdxRecord))
 #define SIZEOF_STUDYDESC        (sizeof (StudyDescRecord) * MAX_MAX_STUDIES)
 
@@ -184,6 +183,17 @@ struct DCMTK_DCMQRDB_EXPORT DB_CounterList
     struct DB_CounterList *next ;
 };
 
+/** this struct holds the data of a matching image determined when a
+ *  move request is started, i.e. while the index file is locked
+ */
+struct DCMTK_DCMQRDB_EXPORT DB_MoveList
+{
+    char SOPClassUID [UI_MAX_LENGTH+1] ;
+    char SOPInstanceUID [UI_MAX_LENGTH+1] ;
+    char filename [DBC_MAXSTRING+1] ;
+    struct DB_MoveList *next ;
+};
+
 struct DCMTK_DCMQRDB_EXPORT DB_FindAttr
 {
     DcmTagKey tag ;
@@ -207,10 +217,12 @@ struct DCMTK_DCMQRDB_EXPORT DB_Private_Handle
     long maxBytesPerStudy ;
     long maxStudiesAllowed ;
     int idxCounter ;
-    DB_CounterList *moveCounterList ;
+    DB_MoveList *moveList ;
     int NumberRemainOperations ;
     DB_QUERY_CLASS rootLevel ;
     DB_UidList *uidList ;
+    DB_CounterList *candidateList ;
+    OFBool useCandidateList ;
 
     DB_Private_Handle()
     : pidx(0)
@@ -222,16 +234,19 @@ struct DCMTK_DCMQRDB_EXPORT DB_Private_Handle
     , maxBytesPerStudy(0)
     , maxStudiesAllowed(0)
     , idxCounter(0)
-    , moveCounterList(NULL)
+    , moveList(NULL)
     , NumberRemainOperations(0)
     , rootLevel(STUDY_ROOT)
     , uidList(NULL)
+    , candidateList(NULL)
+    , useCandidateList(OFFalse)
     {
     }
 };
 
-/** this struct defines the structure of each "Study Record" in the index.dat
- *  file maintained by this module. A Study Record is a direct binary copy
+/** this struct defines the structure of each "Study Record" in the study.dat
+ *  file maintained by this module (and at the start of the index.dat file
+ *  maintained by previous versions). A Study Record is a direct binary copy
  *  of an instance of this struct.
  */
 struct DCMTK_DCMQRDB_EXPORT StudyDescRecord
@@ -84,9 +84,21 @@ public:
   /// maximum number of parallel associations accepted
   int               maxAssociations_;
 
+  /** maximum number of responses per C-FIND request, 0 for no limit.
+   *  If more records match, the request is terminated with the status
+   *  "Refused: Out of Resources" and an Error Comment naming the limit.
+   */
+  OFCmdUnsignedInt  maxFindResponses_;
+
   /// maximum PDU size
   OFCmdUnsignedInt  maxPDU_;
 
+  /** number of sub-associations used for the C-STORE sub-operations of a
+   *  C-MOVE request. If greater than 1, the sub-operations are performed in
+   *  parallel by separate threads (only if compiled with thread support).
+   */
+  OFCmdUnsignedInt  moveSubAssociations_;
+
   /// pointer to network structure used for requesting C-STORE sub-associations
   T_ASC_Network *   net_;
 
@@ -130,6 +142,16 @@ public:
   /// single process mode
   OFBool            singleProcess_;
 
+  /** multi-thread mode: handle each association in a separate thread
+   *  instead of a child process. Only used if single process mode is off.
+   */
+  OFBool            multiThread_;
+
+  /** store journal: register received objects in the index file by a
+   *  background thread after the C-STORE response has been sent
+   */
+  OFBool            storeJournal_;
+
   /// support for patient root q/r model
   OFBool            supportPatientRoot_;
 
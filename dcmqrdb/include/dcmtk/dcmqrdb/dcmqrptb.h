@@ -55,11 +55,19 @@ public:
   virtual ~DcmQueryRetrieveProcessTable();
 
   /** adds a new child process to the process table.
-   *  @param pid process ID of the child process
+   *  @param pid process ID of the child process (or ID of the worker thread
+   *    in multi-thread mode)
    *  @param assoc peer hostname and AEtitles are read from this object
    */
   void addProcessToTable(int pid, T_ASC_Association * assoc);
 
+  /** remove the process with the given process ID from the table.
+   *  Terminated child processes are removed by cleanChildren(), worker
+   *  threads must be removed explicitly.
+   *  @param pid process ID
+   */
+  void removeProcessFromTable(int pid);
+
   /** returns the number of child processes in the table
    *  @return number of child processes
    */
@@ -83,11 +91,6 @@ public:
 
 private:
 
-  /** remove the process with the given process ID from the table
-   *  @param pid process ID
-   */
-  void removeProcessFromTable(int pid);
-
   /// the list of process entries maintained by this object.
   OFList<DcmQueryRetrieveProcessSlot *> table_;
 };
@@ -28,10 +28,16 @@
 #include "dcmtk/dcmnet/dimse.h"
 #include "dcmtk/dcmqrdb/dcmqrptb.h"
 
+#ifdef WITH_THREADS
+#include "dcmtk/ofstd/ofthread.h"
+#include "dcmtk/ofstd/oflist.h"
+#endif
+
 class DcmQueryRetrieveConfig;
 class DcmQueryRetrieveOptions;
 class DcmQueryRetrieveDatabaseHandle;
 class DcmQueryRetrieveDatabaseHandleFactory;
+class DcmQueryRetrieveAssociationThread;
 
 /// enumeration describing reasons for refusing an association request
 enum CTN_RefuseReason
@@ -66,12 +72,15 @@ public:
     const DcmQueryRetrieveOptions& options,
     const DcmQueryRetrieveDatabaseHandleFactory& factory);
 
-  /// destructor
-  virtual ~DcmQueryRetrieveSCP() { }
+  /** destructor. In multi-thread mode, waits until all associations
+   *  handled by worker threads have terminated.
+   */
+  virtual ~DcmQueryRetrieveSCP();
 
   /** wait for incoming A-ASSOCIATE requests, perform association negotiation
-   *  and serve the requests. May fork child processes depending on availability
-   *  of the fork() system function and configuration options.
+   *  and serve the requests. May fork child processes or start worker threads
+   *  depending on availability of the fork() system function, thread support
+   *  and configuration options.
    *  @param theNet network structure for listen socket
    *  @return EC_Normal if successful, an error code otherwise
    */
@@ -85,12 +94,14 @@ public:
     OFBool dbCheckFindIdentifier,
     OFBool dbCheckMoveIdentifier);
 
-  /** clean up terminated child processes.
+  /** clean up terminated child processes (or worker threads in multi-thread mode).
    */
   void cleanChildren();
 
 private:
 
+  friend class DcmQueryRetrieveAssociationThread;
+
   /// private undefined copy constructor
   DcmQueryRetrieveSCP(const DcmQueryRetrieveSCP& other);
 
@@ -147,10 +158,27 @@ private:
 
   static void refuseAnyStorageContexts(T_ASC_Association *assoc);
 
+#ifdef WITH_THREADS
+  /** handle an association in a new worker thread (multi-thread mode)
+   *  @param assoc association, owned by the worker thread upon successful return
+   *  @return EC_Normal if successful, an error code otherwise
+   */
+  OFCondition startAssociationThread(T_ASC_Association *assoc);
+
+  /** note that the worker thread with the given ID has finished. Called by
+   *  the worker thread itself, the thread is joined in cleanChildren().
+   *  @param threadID ID of the worker thread
+   */
+  void threadFinished(int threadID);
+
+  /// join all worker threads that have finished and remove them from the process table
+  void joinFinishedThreads();
+#endif
+
   /// configuration facility
   const DcmQueryRetrieveConfig *config_;
 
-  /// child process table, only used in multi-processing mode
+  /// child process table, only used in multi-processing and multi-thread mode
   DcmQueryRetrieveProcessTable processtable_;
 
   /// flag for database interface: check C-FIND identifier
@@ -164,6 +192,20 @@ private:
 
   /// SCP configuration options
   const DcmQueryRetrieveOptions& options_;
+
+#ifdef WITH_THREADS
+  /// worker threads handling associations, only used in multi-thread mode
+  OFList<DcmQueryRetrieveAssociationThread *> threads_;
+
+  /// IDs of worker threads that have finished but not been joined yet
+  OFList<int> finishedThreads_;
+
+  /// mutex protecting finishedThreads_
+  OFMutex threadMutex_;
+
+  /// ID of the next worker thread, used instead of a process ID in the process table
+  int nextThreadID_;
+#endif
 };
 
 #endif
@@ -67,6 +67,22 @@ void DcmQueryRetrieveFindContext::callbackHandler(
         }
     }
 
+    /* terminate the request if there is another match beyond the permitted
+     * number of responses. The error comment tells the SCU that the request
+     * has been refused because of the limit and not because of a failure.
+     */
+    OFBool limitReached = OFFalse;
+    if ((options_.maxFindResponses_ > 0) && DICOM_PENDING_STATUS(dbStatus.status()) &&
+        (OFstatic_cast(OFCmdUnsignedInt, responseCount) > options_.maxFindResponses_)) {
+        DCMQRDB_WARN("findSCP: maximum number of responses (" << options_.maxFindResponses_
+            << ") reached, terminating C-FIND request");
+        delete *responseIdentifiers;
+        *responseIdentifiers = NULL;
+        dbHandle.cancelFindRequest(&dbStatus);
+        dbStatus.setStatus(STATUS_FIND_Refused_OutOfResources);
+        limitReached = OFTrue;
+    }
+
     if (*responseIdentifiers != NULL)
     {
 
@@ -78,6 +94,13 @@ void DcmQueryRetrieveFindContext::callbackHandler(
     /* set response status */
     response->DimseStatus = dbStatus.status();
     *stDetail = dbStatus.extractStatusDetail();
+    if (limitReached && (*stDetail == NULL)) {
+        OFOStringStream stream;
+        stream << "Too many matches, limit is " << options_.maxFindResponses_ << OFStringStream_ends;
+        OFSTRINGSTREAM_GETOFSTRING(stream, comment)
+        *stDetail = new DcmDataset;
+        (*stDetail)->putAndInsertString(DCM_ErrorComment, comment.c_str());
+    }
 
     OFString str;
     DCMQRDB_INFO("Find SCP Response " << responseCount << " [status: "
@@ -34,8 +34,76 @@ BEGIN_EXTERN_C
 #ifdef HAVE_FCNTL_H
 #include <fcntl.h>       /* needed on Solaris for O_RDONLY */
 #endif
+#ifdef HAVE_UNISTD_H
+#include <unistd.h>
+#endif
 END_EXTERN_C
 
+/* number of images read ahead per sub-association */
+#define MOVE_READ_AHEAD 4
+
+/* maximum number of sub-associations for parallel sub-operations */
+#define MOVE_MAX_SUBASSOCIATIONS 16
+
+
+/* ask the operating system to read the given file into the cache, so that
+ * it is available when the C-STORE sub-operation for the image is performed
+ */
+static void readAheadFile(const char *fname)
+{
+#ifdef HAVE_POSIX_FADVISE
+    int fd = open(fname, O_RDONLY);
+    if (fd >= 0) {
+        (void) posix_fadvise(fd, 0, 0, POSIX_FADV_WILLNEED);
+        close(fd);
+    }
+#else
+    (void) fname;
+#endif
+}
+
+#ifdef WITH_THREADS
+
+/** thread performing C-STORE sub-operations over one sub-association
+ *  for a move request with parallel sub-operations
+ */
+class DcmQueryRetrieveMoveWorker : public OFThread
+{
+public:
+    /** constructor
+     *  @param context move context providing the images to be sent
+     *  @param assoc sub-association to be used, not closed by this class
+     */
+    DcmQueryRetrieveMoveWorker(DcmQueryRetrieveMoveContext& context, T_ASC_Association *assoc)
+    : OFThread()
+    , context_(context)
+    , assoc_(assoc)
+    {
+    }
+
+protected:
+    /// perform sub-operations until there are no more images
+    virtual void run()
+    {
+        context_.runSubOperations(assoc_);
+    }
+
+private:
+    /// private undefined copy constructor
+    DcmQueryRetrieveMoveWorker(const DcmQueryRetrieveMoveWorker& other);
+
+    /// private undefined assignment operator
+    DcmQueryRetrieveMoveWorker& operator=(const DcmQueryRetrieveMoveWorker& other);
+
+    /// move context
+    DcmQueryRetrieveMoveContext& context_;
+
+    /// sub-association served by this thread
+    T_ASC_Association *assoc_;
+};
+
+#endif
+
 
 static void moveSubOpProgressCallback(void * /* callbackData */,
     T_DIMSE_StoreProgress *progress,
@@ -97,17 +165,27 @@ void DcmQueryRetrieveMoveContext::callbackHandler(
             } else if (cond.bad()) {
                 /* failed to build association, must fail move */
                 failAllSubOperations(&dbStatus);
+            } else {
+                startParallelSubOperations();
             }
         }
     }
 
-    /* only cancel if we have pending status */
-    if (cancelled && dbStatus.status() == STATUS_Pending) {
-        dbHandle.cancelMoveRequest(&dbStatus);
-    }
+    if (!workers.empty()) {
+        /* parallel sub-operations handle cancellation themselves */
+        waitForParallelSubOperations(cancelled, &dbStatus);
+    } else {
+        /* only cancel if we have pending status */
+        if (cancelled && dbStatus.status() == STATUS_Pending) {
+            dbHandle.cancelMoveRequest(&dbStatus);
+            nRemaining = remainingSubOperations();
+            readAhead.clear();
+            dbExhausted = OFTrue;
+        }
 
-    if (dbStatus.status() == STATUS_Pending) {
-        moveNextImage(&dbStatus);
+        if (dbStatus.status() == STATUS_Pending) {
+            moveNextImage(&dbStatus);
+        }
     }
 
     if (dbStatus.status() != STATUS_Pending) {
@@ -115,12 +193,26 @@ void DcmQueryRetrieveMoveContext::callbackHandler(
          * Tear down sub-association (if it exists).
          */
         closeSubAssociation();
+    }
 
+    /* the counters are updated by the threads performing parallel sub-operations */
+#ifdef WITH_THREADS
+    mutex.lock();
+#endif
+    const DIC_US remaining = nRemaining;
+    const DIC_US completed = nCompleted;
+    const DIC_US failed = nFailed;
+    const DIC_US warning = nWarning;
+#ifdef WITH_THREADS
+    mutex.unlock();
+#endif
+
+    if (dbStatus.status() != STATUS_Pending) {
         /*
          * Need to adjust the final status if any sub-operations failed or
          * had warnings
          */
-        if (nFailed > 0 || nWarning > 0) {
+        if (failed > 0 || warning > 0) {
             dbStatus.setStatus(STATUS_MOVE_Warning_SubOperationsCompleteOneOrMoreFailures);
         }
         /*
@@ -128,7 +220,7 @@ void DcmQueryRetrieveMoveContext::callbackHandler(
          * cf. DICOM part 4, C.4.2.3.1
          * we choose to generate a "Refused - Out of Resources - Unable to perform suboperations" status.
          */
-        if ((nFailed > 0) && ((nCompleted + nWarning) == 0)) {
+        if ((failed > 0) && ((completed + warning) == 0)) {
             dbStatus.setStatus(STATUS_MOVE_Refused_OutOfResourcesSubOperations);
         }
     }
@@ -144,10 +236,10 @@ void DcmQueryRetrieveMoveContext::callbackHandler(
 
     /* set response status */
     response->DimseStatus = dbStatus.status();
-    response->NumberOfRemainingSubOperations = nRemaining;
-    response->NumberOfCompletedSubOperations = nCompleted;
-    response->NumberOfFailedSubOperations = nFailed;
-    response->NumberOfWarningSubOperations = nWarning;
+    response->NumberOfRemainingSubOperations = remaining;
+    response->NumberOfCompletedSubOperations = completed;
+    response->NumberOfFailedSubOperations = failed;
+    response->NumberOfWarningSubOperations = warning;
     *stDetail = dbStatus.extractStatusDetail();
 
     OFString str;
@@ -162,6 +254,26 @@ void DcmQueryRetrieveMoveContext::callbackHandler(
     }
 }
 
+DcmQueryRetrieveMoveContext::~DcmQueryRetrieveMoveContext()
+{
+    /* only in case the move request has not been completed */
+    closeSubAssociation();
+    free(failedUIDs);
+}
+
+void DcmQueryRetrieveMoveContext::countSubOperation(DIC_US *counter, const char *failedInstance)
+{
+#ifdef WITH_THREADS
+    mutex.lock();
+#endif
+    (*counter)++;
+    if (failedInstance != NULL)
+        addFailedUIDInstance(failedInstance);
+#ifdef WITH_THREADS
+    mutex.unlock();
+#endif
+}
+
 void DcmQueryRetrieveMoveContext::addFailedUIDInstance(const char *sopInstance)
 {
     int len;
@@ -185,7 +297,7 @@ void DcmQueryRetrieveMoveContext::addFailedUIDInstance(const char *sopInstance)
     }
 }
 
-OFCondition DcmQueryRetrieveMoveContext::performMoveSubOp(DIC_UI sopClass, DIC_UI sopInstance, char *fname)
+OFCondition DcmQueryRetrieveMoveContext::performMoveSubOp(T_ASC_Association *assoc, DIC_UI sopClass, DIC_UI sopInstance, char *fname)
 {
     OFCondition cond = EC_Normal;
     T_DIMSE_C_StoreRQ req;
@@ -207,21 +319,23 @@ OFCondition DcmQueryRetrieveMoveContext::performMoveSubOp(DIC_UI sopClass, DIC_U
         /* due to quota system the file could have been deleted */
         DCMQRDB_ERROR("Move SCP: storeSCU: [file: " << fname << "]: "
             << OFStandard::strerror(errno, buf, sizeof(buf)));
-        nFailed++;
-        addFailedUIDInstance(sopInstance);
+        countSubOperation(&nFailed, sopInstance);
         return EC_Normal;
     }
     dcmtk_flock(lockfd, LOCK_SH);
 #endif
 
-    msgId = subAssoc->nextMsgID++;
+    msgId = assoc->nextMsgID++;
 
     /* which presentation context should be used */
-    presId = ASC_findAcceptedPresentationContextID(subAssoc,
+    presId = ASC_findAcceptedPresentationContextID(assoc,
         sopClass);
     if (presId == 0) {
-        nFailed++;
-        addFailedUIDInstance(sopInstance);
+#ifdef LOCK_IMAGE_FILES
+        dcmtk_flock(lockfd, LOCK_UN);
+        close(lockfd);
+#endif
+        countSubOperation(&nFailed, sopInstance);
         DCMQRDB_ERROR("Move SCP: storeSCU: [file: " << fname << "] No presentation context for: ("
             << dcmSOPClassUIDToModality(sopClass, "OT") << ") " << sopClass);
         return DIMSE_NOVALIDPRESENTATIONCONTEXTID;
@@ -239,7 +353,7 @@ OFCondition DcmQueryRetrieveMoveContext::performMoveSubOp(DIC_UI sopClass, DIC_U
     DCMQRDB_INFO("Store SCU RQ: MsgID " << msgId << ", ("
         << dcmSOPClassUIDToModality(sopClass, "OT") << ")");
 
-    cond = DIMSE_storeUser(subAssoc, presId, &req,
+    cond = DIMSE_storeUser(assoc, presId, &req,
         fname, NULL, moveSubOpProgressCallback, this,
         options_.blockMode_, options_.dimse_timeout_,
         &rsp, &stDetail);
@@ -255,22 +369,20 @@ OFCondition DcmQueryRetrieveMoveContext::performMoveSubOp(DIC_UI sopClass, DIC_U
             << DU_cstoreStatusString(rsp.DimseStatus) << "]");
         if (rsp.DimseStatus == STATUS_Success) {
             /* everything ok */
-            nCompleted++;
+            countSubOperation(&nCompleted, NULL);
         } else if ((rsp.DimseStatus & 0xf000) == 0xb000) {
             /* a warning status message */
-            nWarning++;
+            countSubOperation(&nWarning, NULL);
             DCMQRDB_ERROR("Move SCP: Store Warning: Response Status: " <<
                     DU_cstoreStatusString(rsp.DimseStatus));
         } else {
-            nFailed++;
-            addFailedUIDInstance(sopInstance);
+            countSubOperation(&nFailed, sopInstance);
             /* print a status message */
             DCMQRDB_ERROR("Move SCP: Store Failed: Response Status: " <<
                 DU_cstoreStatusString(rsp.DimseStatus));
         }
     } else {
-        nFailed++;
-        addFailedUIDInstance(sopInstance);
+        countSubOperation(&nFailed, sopInstance);
         OFString temp_str;
         DCMQRDB_ERROR("Move SCP: storeSCU: Store Request Failed: " << DimseCondition::dump(temp_str, cond));
     }
@@ -283,13 +395,8 @@ OFCondition DcmQueryRetrieveMoveContext::performMoveSubOp(DIC_UI sopClass, DIC_U
 
 OFCondition DcmQueryRetrieveMoveContext::buildSubAssociation(T_DIMSE_C_MoveRQ *request)
 {
-    OFCondition cond = EC_Normal;
     DIC_NODENAME dstHostName;
-    DIC_NODENAME dstHostNamePlusPort;
     int dstPortNumber;
-    DIC_NODENAME localHostName;
-    T_ASC_Parameters *params;
-    OFString temp_str;
 
     strcpy(dstAETitle, request->MoveDestination);
 
@@ -310,15 +417,31 @@ OFCondition DcmQueryRetrieveMoveContext::buildSubAssociation(T_DIMSE_C_MoveRQ *r
         request->MoveDestination, dstHostName, &dstPortNumber)) {
         return QR_EC_InvalidPeer;
     }
+    /* the host name might fill the buffer, so the address is truncated if necessary */
+    char portString[16];
+    sprintf(portString, ":%d", dstPortNumber);
+    OFStandard::strlcpy(dstHostNamePlusPort, dstHostName, sizeof(dstHostNamePlusPort));
+    OFStandard::strlcat(dstHostNamePlusPort, portString, sizeof(dstHostNamePlusPort));
+
+    OFCondition cond = requestSubAssociation(&subAssoc);
     if (cond.good()) {
-        cond = ASC_createAssociationParameters(&params, ASC_DEFAULTMAXPDU);
-        if (cond.bad()) {
-            DCMQRDB_ERROR("moveSCP: Cannot create Association-params for sub-ops: " << DimseCondition::dump(temp_str, cond));
-        }
+        assocStarted = OFTrue;
+    }
+    return cond;
+}
+
+OFCondition DcmQueryRetrieveMoveContext::requestSubAssociation(T_ASC_Association **assoc)
+{
+    DIC_NODENAME localHostName;
+    T_ASC_Parameters *params;
+    OFString temp_str;
+
+    OFCondition cond = ASC_createAssociationParameters(&params, ASC_DEFAULTMAXPDU);
+    if (cond.bad()) {
+        DCMQRDB_ERROR("moveSCP: Cannot create Association-params for sub-ops: " << DimseCondition::dump(temp_str, cond));
     }
     if (cond.good()) {
         gethostname(localHostName, sizeof(localHostName) - 1);
-        sprintf(dstHostNamePlusPort, "%s:%d", dstHostName, dstPortNumber);
         ASC_setPresentationAddresses(params, localHostName,
             dstHostNamePlusPort);
         ASC_setAPTitles(params, ourAETitle.c_str(), dstAETitle,NULL);
@@ -332,7 +455,7 @@ OFCondition DcmQueryRetrieveMoveContext::buildSubAssociation(T_DIMSE_C_MoveRQ *r
     if (cond.good()) {
         /* create association */
         DCMQRDB_INFO("Requesting Sub-Association");
-        cond = ASC_requestAssociation(options_.net_, params, &subAssoc);
+        cond = ASC_requestAssociation(options_.net_, params, assoc);
         if (cond.bad()) {
             if (cond == DUL_ASSOCIATIONREJECTED) {
                 T_ASC_RejectParameters rej;
@@ -342,12 +465,13 @@ OFCondition DcmQueryRetrieveMoveContext::buildSubAssociation(T_DIMSE_C_MoveRQ *r
             } else {
                 DCMQRDB_ERROR("moveSCP: Sub-Association Request Failed: " << DimseCondition::dump(temp_str, cond));
             }
+            /* the parameters are owned by the association if it was created */
+            if (*assoc != NULL) {
+                ASC_dropAssociation(*assoc);
+                ASC_destroyAssociation(assoc);
+            }
         }
     }
-
-    if (cond.good()) {
-        assocStarted = OFTrue;
-    }
     return cond;
 }
 
@@ -355,22 +479,28 @@ OFCondition DcmQueryRetrieveMoveContext::closeSubAssociation()
 {
     OFCondition cond = EC_Normal;
 
-    if (subAssoc != NULL) {
-        /* release association */
-        OFString temp_str;
-        DCMQRDB_INFO("Releasing Sub-Association");
-        cond = ASC_releaseAssociation(subAssoc);
-        if (cond.bad()) {
-            DCMQRDB_ERROR("moveSCP: Sub-Association Release Failed: " << DimseCondition::dump(temp_str, cond));
-        }
-        cond = ASC_dropAssociation(subAssoc);
-        if (cond.bad()) {
-            DCMQRDB_ERROR("moveSCP: Sub-Association Drop Failed: " << DimseCondition::dump(temp_str, cond));
-        }
-        cond = ASC_destroyAssociation(&subAssoc);
-        if (cond.bad()) {
-            DCMQRDB_ERROR("moveSCP: Sub-Association Destroy Failed: " << DimseCondition::dump(temp_str, cond));
+#ifdef WITH_THREADS
+    /* in case the move request has been aborted, let the threads finish */
+    if (!workers.empty()) {
+        mutex.lock();
+        cancelRequested = OFTrue;
+        mutex.unlock();
+        for (size_t i = 0; i < workers.size(); ++i) {
+            workers[i]->join();
+            delete workers[i];
         }
+        workers.clear();
+        runningWorkers = 0;
+    }
+#endif
+
+    for (size_t i = 0; i < parallelAssocs.size(); ++i) {
+        releaseSubAssociation(&parallelAssocs[i]);
+    }
+    parallelAssocs.clear();
+
+    if (subAssoc != NULL) {
+        releaseSubAssociation(&subAssoc);
     }
 
     if (assocStarted) {
@@ -380,64 +510,224 @@ OFCondition DcmQueryRetrieveMoveContext::closeSubAssociation()
     return cond;
 }
 
-void DcmQueryRetrieveMoveContext::moveNextImage(DcmQueryRetrieveDatabaseStatus * dbStatus)
+void DcmQueryRetrieveMoveContext::releaseSubAssociation(T_ASC_Association **assoc)
 {
-    OFCondition cond = EC_Normal;
-    OFCondition dbcond = EC_Normal;
-    DIC_UI subImgSOPClass;      /* sub-operation image SOP Class */
-    DIC_UI subImgSOPInstance;   /* sub-operation image SOP Instance */
-    char subImgFileName[MAXPATHLEN + 1];    /* sub-operation image file */
+    if (*assoc == NULL) return;
+
+    /* release association */
+    OFString temp_str;
+    DCMQRDB_INFO("Releasing Sub-Association");
+    OFCondition cond = ASC_releaseAssociation(*assoc);
+    if (cond.bad()) {
+        DCMQRDB_ERROR("moveSCP: Sub-Association Release Failed: " << DimseCondition::dump(temp_str, cond));
+    }
+    cond = ASC_dropAssociation(*assoc);
+    if (cond.bad()) {
+        DCMQRDB_ERROR("moveSCP: Sub-Association Drop Failed: " << DimseCondition::dump(temp_str, cond));
+    }
+    cond = ASC_destroyAssociation(assoc);
+    if (cond.bad()) {
+        DCMQRDB_ERROR("moveSCP: Sub-Association Destroy Failed: " << DimseCondition::dump(temp_str, cond));
+    }
+}
 
-    /* clear out strings */
-    bzero(subImgFileName, sizeof(subImgFileName));
-    bzero(subImgSOPClass, sizeof(subImgSOPClass));
-    bzero(subImgSOPInstance, sizeof(subImgSOPInstance));
+OFBool DcmQueryRetrieveMoveContext::nextSubOperation(SubOperation& subOp)
+{
+    /* keep a few images per sub-association in the read-ahead list */
+    size_t wanted = MOVE_READ_AHEAD * (1 + parallelAssocs.size());
+    while (!dbExhausted && (readAhead.size() < wanted)) {
+        DcmQueryRetrieveDatabaseStatus dbStatus(STATUS_Pending);
+        SubOperation next;
+        bzero(&next, sizeof(next));
 
-    /* get DB response */
-    dbcond = dbHandle.nextMoveResponse(
-        subImgSOPClass, subImgSOPInstance, subImgFileName, &nRemaining, dbStatus);
-    if (dbcond.bad()) {
-        DCMQRDB_ERROR("moveSCP: Database: nextMoveResponse Failed ("
-                << DU_cmoveStatusString(dbStatus->status()) << "):");
+        /* get DB response */
+        OFCondition dbcond = dbHandle.nextMoveResponse(
+            next.sopClass, next.sopInstance, next.fileName, &dbRemaining, &dbStatus);
+        if (dbcond.bad()) {
+            DCMQRDB_ERROR("moveSCP: Database: nextMoveResponse Failed ("
+                    << DU_cmoveStatusString(dbStatus.status()) << "):");
+        }
+
+        if (dbStatus.status() == STATUS_Pending) {
+            readAheadFile(next.fileName);
+            readAhead.push_back(next);
+        } else {
+            dbExhausted = OFTrue;
+            dbFinalStatus = dbStatus.status();
+            dbRemaining = 0;
+        }
     }
 
-    if (dbStatus->status() == STATUS_Pending) {
+    if (readAhead.empty()) return OFFalse;
+    subOp = readAhead.front();
+    readAhead.pop_front();
+    return OFTrue;
+}
+
+DIC_US DcmQueryRetrieveMoveContext::remainingSubOperations() const
+{
+    return OFstatic_cast(DIC_US, dbRemaining + readAhead.size() + activeSubOps);
+}
+
+void DcmQueryRetrieveMoveContext::moveNextImage(DcmQueryRetrieveDatabaseStatus * dbStatus)
+{
+    OFCondition cond = EC_Normal;
+    SubOperation subOp;
+
+    if (nextSubOperation(subOp)) {
+        /* the image being sent is not counted as remaining */
+        nRemaining = remainingSubOperations();
+
         /* perform sub-op */
-        cond = performMoveSubOp(subImgSOPClass, subImgSOPInstance, subImgFileName);
+        cond = performMoveSubOp(subAssoc, subOp.sopClass, subOp.sopInstance, subOp.fileName);
         if (cond != EC_Normal) {
             OFString temp_str;
             DCMQRDB_ERROR("moveSCP: Move Sub-Op Failed: " << DimseCondition::dump(temp_str, cond));
             /* clear condition stack */
         }
+    } else {
+        nRemaining = 0;
+        dbStatus->setStatus(dbFinalStatus);
     }
 }
 
-void DcmQueryRetrieveMoveContext::failAllSubOperations(DcmQueryRetrieveDatabaseStatus * dbStatus)
+OFBool DcmQueryRetrieveMoveContext::startParallelSubOperations()
 {
-    OFCondition dbcond = EC_Normal;
-    DIC_UI subImgSOPClass;      /* sub-operation image SOP Class */
-    DIC_UI subImgSOPInstance;   /* sub-operation image SOP Instance */
-    char subImgFileName[MAXPATHLEN + 1];    /* sub-operation image file */
+#ifdef WITH_THREADS
+    size_t numAssocs = OFstatic_cast(size_t, options_.moveSubAssociations_);
+    if (numAssocs > MOVE_MAX_SUBASSOCIATIONS) numAssocs = MOVE_MAX_SUBASSOCIATIONS;
+
+    /* the first sub-association has already been established */
+    while (parallelAssocs.size() + 1 < numAssocs) {
+        T_ASC_Association *assoc = NULL;
+        if (requestSubAssociation(&assoc).bad()) {
+            /* continue with the sub-associations we already have */
+            DCMQRDB_WARN("moveSCP: continuing with " << parallelAssocs.size() + 1 << " sub-association(s)");
+            break;
+        }
+        parallelAssocs.push_back(assoc);
+    }
+    if (parallelAssocs.empty()) return OFFalse;
+
+    /* fill the read-ahead list before any thread is running */
+    SubOperation subOp;
+    if (nextSubOperation(subOp)) readAhead.push_front(subOp);
+
+    /* one thread per sub-association, unused sub-associations are released at the end */
+    for (size_t i = 0; i <= parallelAssocs.size(); ++i) {
+        DcmQueryRetrieveMoveWorker *worker = new DcmQueryRetrieveMoveWorker(*this, (i == 0) ? subAssoc : parallelAssocs[i - 1]);
+        mutex.lock();
+        runningWorkers++;
+        mutex.unlock();
+        if (worker->start() == 0) {
+            workers.push_back(worker);
+        } else {
+            DCMQRDB_ERROR("moveSCP: cannot start thread for sub-operations");
+            mutex.lock();
+            runningWorkers--;
+            mutex.unlock();
+            delete worker;
+        }
+    }
+    DCMQRDB_INFO("Performing sub-operations over " << workers.size() << " sub-associations");
+    return !workers.empty();
+#else
+    return OFFalse;
+#endif
+}
 
-    /* clear out strings */
-    bzero(subImgFileName, sizeof(subImgFileName));
-    bzero(subImgSOPClass, sizeof(subImgSOPClass));
-    bzero(subImgSOPInstance, sizeof(subImgSOPInstance));
+void DcmQueryRetrieveMoveContext::waitForParallelSubOperations(OFBool cancelled, DcmQueryRetrieveDatabaseStatus * dbStatus)
+{
+#ifdef WITH_THREADS
+    mutex.lock();
+    if (cancelled) cancelRequested = OFTrue;
+    OFBool running = (runningWorkers > 0);
+    mutex.unlock();
+
+    /* report progress whenever a sub-operation has been completed */
+    if (running) progress.wait();
+
+    mutex.lock();
+    running = (runningWorkers > 0);
+    nRemaining = remainingSubOperations();
+    mutex.unlock();
+    if (running) {
+        dbStatus->setStatus(STATUS_Pending);
+        return;
+    }
 
-    while (dbStatus->status() == STATUS_Pending) {
-        /* get DB response */
-        dbcond = dbHandle.nextMoveResponse(
-            subImgSOPClass, subImgSOPInstance, subImgFileName, &nRemaining, dbStatus);
-        if (dbcond.bad()) {
-            DCMQRDB_ERROR("moveSCP: Database: nextMoveResponse Failed ("
-                << DU_cmoveStatusString(dbStatus->status()) << "):");
-        }
+    /* all threads have finished */
+    for (size_t i = 0; i < workers.size(); ++i) {
+        workers[i]->join();
+        delete workers[i];
+    }
+    workers.clear();
 
-        if (dbStatus->status() == STATUS_Pending) {
+    if (cancelRequested && !dbExhausted) {
+        dbStatus->setStatus(STATUS_Pending);
+        dbHandle.cancelMoveRequest(dbStatus);
+        readAhead.clear();
+        dbExhausted = OFTrue;
+    } else {
+        /* images left over because all sub-associations were lost */
+        SubOperation subOp;
+        while (nextSubOperation(subOp)) {
             nFailed++;
-            addFailedUIDInstance(subImgSOPInstance);
+            addFailedUIDInstance(subOp.sopInstance);
+        }
+        nRemaining = 0;
+        dbStatus->setStatus(cancelRequested ? OFstatic_cast(DIC_US, STATUS_MOVE_Cancel_SubOperationsTerminatedDueToCancelIndication) : dbFinalStatus);
+    }
+#else
+    (void) cancelled;
+    (void) dbStatus;
+#endif
+}
+
+void DcmQueryRetrieveMoveContext::runSubOperations(T_ASC_Association *assoc)
+{
+#ifdef WITH_THREADS
+    SubOperation subOp;
+    OFBool assocLost = OFFalse;
+    while (!assocLost) {
+        mutex.lock();
+        OFBool found = !cancelRequested && nextSubOperation(subOp);
+        if (found) activeSubOps++;
+        mutex.unlock();
+        if (!found) break;
+
+        OFCondition cond = performMoveSubOp(assoc, subOp.sopClass, subOp.sopInstance, subOp.fileName);
+        if (cond != EC_Normal) {
+            OFString temp_str;
+            DCMQRDB_ERROR("moveSCP: Move Sub-Op Failed: " << DimseCondition::dump(temp_str, cond));
+            /* the other sub-associations take over the remaining images */
+            assocLost = (cond == DUL_PEERABORTEDASSOCIATION) || (cond == DUL_NETWORKCLOSED) ||
+                (cond == DUL_PEERREQUESTEDRELEASE);
         }
+
+        mutex.lock();
+        activeSubOps--;
+        mutex.unlock();
+        progress.post();
+    }
+
+    mutex.lock();
+    runningWorkers--;
+    mutex.unlock();
+    progress.post();
+#else
+    (void) assoc;
+#endif
+}
+
+void DcmQueryRetrieveMoveContext::failAllSubOperations(DcmQueryRetrieveDatabaseStatus * dbStatus)
+{
+    SubOperation subOp;
+    while (nextSubOperation(subOp)) {
+        nFailed++;
+        addFailedUIDInstance(subOp.sopInstance);
     }
+    nRemaining = 0;
     dbStatus->setStatus(STATUS_MOVE_Warning_SubOperationsCompleteOneOrMoreFailures);
 }
 
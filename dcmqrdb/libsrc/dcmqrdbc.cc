@@ -0,0 +1,451 @@
+/*
+ *
+ *  Copyright (C) 2016, OFFIS e.V.
+ *  All rights reserved.  See COPYRIGHT file for details.
+ *
+ *  This software and supporting documentation were developed by
+ *
+ *    OFFIS e.V.
+ *    R&D Division Health
+ *    Escherweg 2
+ *    D-26121 Oldenburg, Germany
+ *
+ *
+ *  Module:  dcmqrdb
+ *
+ *  Author:  OFFIS DICOM Team
+ *
+ *  Purpose: class DcmQueryRetrieveCompactIndex
+ *
+ */
+
+#include "dcmtk/config/osconfig.h"    /* make sure OS specific configuration is included first */
+
+BEGIN_EXTERN_C
+#ifdef HAVE_FCNTL_H
+#include <fcntl.h>
+#endif
+#ifdef HAVE_UNISTD_H
+#include <unistd.h>
+#endif
+#ifdef HAVE_IO_H
+#include <io.h>
+#endif
+END_EXTERN_C
+
+#define INCLUDE_CSTDLIB
+#define INCLUDE_CSTRING
+#include "dcmtk/ofstd/ofstdinc.h"
+
+#include "dcmtk/dcmqrdb/dcmqrdbc.h"
+#include "dcmtk/dcmqrdb/dcmqropt.h"
+#include "dcmtk/dcmqrdb/dcmqrcnf.h"
+
+/* magic word and version of the compact index file format */
+#define COMPACTINDEX_MAGIC "DQRIDX01"
+
+/* magic word and version of the heap file format */
+#define COMPACTINDEX_HEAP_MAGIC "DQRHEAP1"
+
+/* number of slots read at once when reading sequentially */
+#define COMPACTINDEX_READAHEAD 64
+
+/* length stored in a slot if the encoded record is stored in the heap file */
+#define COMPACTINDEX_EXTERNAL 0xffff
+
+/* maximum length of an encoded record stored in the slot itself */
+#define COMPACTINDEX_MAX_INLINE (DB_CompactSlotSize - 2)
+
+/* size of the smallest extent in the heap file, the other size classes
+ * are 2, 4 and 8 times as large
+ */
+#define COMPACTINDEX_MIN_EXTENT 1024
+
+
+/* determine the size class of an extent, -1 if the length is too large */
+static int extentSizeClass(Uint32 length)
+{
+    for (int c = 0; c < 4; ++c)
+    {
+        if (length <= (OFstatic_cast(Uint32, COMPACTINDEX_MIN_EXTENT) << c)) return c;
+    }
+    return -1;
+}
+
+
+DcmQueryRetrieveCompactIndex::DcmQueryRetrieveCompactIndex()
+: fd_(-1)
+, heapFd_(-1)
+, header_()
+, buffer_(NULL)
+, bufferFirst_(0)
+, bufferCount_(0)
+, lastRead_(-2)
+{
+    memset(&header_, 0, sizeof(header_));
+}
+
+DcmQueryRetrieveCompactIndex::~DcmQueryRetrieveCompactIndex()
+{
+    close();
+}
+
+OFBool DcmQueryRetrieveCompactIndex::isCompactFile(int fd)
+{
+    char magic[8];
+    return (readBlock(fd, 0, magic, sizeof(magic)) == OFstatic_cast(long, sizeof(magic))) &&
+           (memcmp(magic, COMPACTINDEX_MAGIC, sizeof(magic)) == 0);
+}
+
+OFCondition DcmQueryRetrieveCompactIndex::open(int fd, const char *heapFilename)
+{
+    close();
+    fd_ = fd;
+    OFCondition result = EC_Normal;
+    if (lseek(fd_, 0, SEEK_END) == 0)
+    {
+        /* initialize an empty index file */
+        memcpy(header_.Magic, COMPACTINDEX_MAGIC, sizeof(header_.Magic));
+        header_.SlotSize = DB_CompactSlotSize;
+        result = writeHeader();
+    }
+    else
+        result = readHeader();
+    if (result.good())
+        result = openHeap(heapFilename, OFFalse);
+    if (result.bad())
+    {
+        close();
+        return result;
+    }
+    buffer_ = new char[COMPACTINDEX_READAHEAD * DB_CompactSlotSize];
+    return EC_Normal;
+}
+
+void DcmQueryRetrieveCompactIndex::close()
+{
+    delete[] buffer_;
+    buffer_ = NULL;
+    flushBuffer();
+    if (heapFd_ >= 0) ::close(heapFd_);
+    heapFd_ = -1;
+    fd_ = -1;
+}
+
+OFBool DcmQueryRetrieveCompactIndex::conversionPending()
+{
+    return (fd_ >= 0) && (header_.Converting != 0);
+}
+
+int DcmQueryRetrieveCompactIndex::numberOfRecords()
+{
+    if (fd_ < 0) return 0;
+    const long fileSize = OFstatic_cast(long, lseek(fd_, 0, SEEK_END));
+    if (fileSize <= DB_CompactSlotSize) return 0;
+    return OFstatic_cast(int, (fileSize - DB_CompactSlotSize) / DB_CompactSlotSize);
+}
+
+OFCondition DcmQueryRetrieveCompactIndex::readRecord(int idx, char *buffer, size_t bufsize, size_t &length)
+{
+    if ((fd_ < 0) || (buffer_ == NULL) || (idx < 0)) return QR_EC_IndexDatabaseError;
+    char single[DB_CompactSlotSize];
+    const char *slot = NULL;
+    if ((idx >= bufferFirst_) && (idx < bufferFirst_ + bufferCount_))
+        slot = buffer_ + OFstatic_cast(size_t, idx - bufferFirst_) * DB_CompactSlotSize;
+    else if (idx == lastRead_ + 1)
+    {
+        /* sequential reading, fill the buffer with the following slots */
+        const long n = readBlock(fd_, OFstatic_cast(long, idx + 1) * DB_CompactSlotSize, buffer_,
+                                 COMPACTINDEX_READAHEAD * DB_CompactSlotSize);
+        bufferFirst_ = idx;
+        bufferCount_ = (n > 0) ? OFstatic_cast(int, n / DB_CompactSlotSize) : 0;
+        if (bufferCount_ == 0) return QR_EC_IndexDatabaseError;
+        slot = buffer_;
+    }
+    else
+    {
+        if (readBlock(fd_, OFstatic_cast(long, idx + 1) * DB_CompactSlotSize, single, DB_CompactSlotSize) != DB_CompactSlotSize)
+            return QR_EC_IndexDatabaseError;
+        slot = single;
+    }
+    lastRead_ = idx;
+
+    Uint16 slotLength;
+    memcpy(&slotLength, slot, sizeof(slotLength));
+    if (slotLength == COMPACTINDEX_EXTERNAL)
+    {
+        /* the encoded record is stored in the heap file */
+        Uint32 offset;
+        Uint32 heapLength;
+        memcpy(&offset, slot + 2, sizeof(offset));
+        memcpy(&heapLength, slot + 6, sizeof(heapLength));
+        if ((heapFd_ < 0) || (heapLength > bufsize) ||
+            (readBlock(heapFd_, OFstatic_cast(long, offset), buffer, heapLength) != OFstatic_cast(long, heapLength)))
+            return QR_EC_IndexDatabaseError;
+        length = heapLength;
+    }
+    else
+    {
+        if ((slotLength > COMPACTINDEX_MAX_INLINE) || (slotLength > bufsize)) return QR_EC_IndexDatabaseError;
+        memcpy(buffer, slot + 2, slotLength);
+        length = slotLength;
+    }
+    return EC_Normal;
+}
+
+OFCondition DcmQueryRetrieveCompactIndex::writeRecord(int idx, const char *buffer, size_t length)
+{
+    if ((fd_ < 0) || (idx < 0)) return QR_EC_IndexDatabaseError;
+    flushBuffer();
+    const long slotOffset = OFstatic_cast(long, idx + 1) * DB_CompactSlotSize;
+
+    /* remember the extent of the previous content of the slot, if any. While
+     * converting, the slot still contains data of the original format.
+     */
+    Uint16 oldLength = 0;
+    Uint32 oldOffset = 0;
+    Uint32 oldHeapLength = 0;
+    char oldSlot[10];
+    if ((header_.Converting == 0) &&
+        (readBlock(fd_, slotOffset, oldSlot, sizeof(oldSlot)) == OFstatic_cast(long, sizeof(oldSlot))))
+    {
+        memcpy(&oldLength, oldSlot, sizeof(oldLength));
+        memcpy(&oldOffset, oldSlot + 2, sizeof(oldOffset));
+        memcpy(&oldHeapLength, oldSlot + 6, sizeof(oldHeapLength));
+    }
+
+    char slot[DB_CompactSlotSize];
+    memset(slot, 0, sizeof(slot));
+    OFCondition result = EC_Normal;
+    if (length <= COMPACTINDEX_MAX_INLINE)
+    {
+        const Uint16 slotLength = OFstatic_cast(Uint16, length);
+        memcpy(slot, &slotLength, sizeof(slotLength));
+        memcpy(slot + 2, buffer, length);
+    }
+    else
+    {
+        /* store the encoded record in the heap file */
+        const Uint16 slotLength = COMPACTINDEX_EXTERNAL;
+        const Uint32 heapLength = OFstatic_cast(Uint32, length);
+        Uint32 offset = 0;
+        if (heapFd_ < 0) return QR_EC_IndexDatabaseError;
+        result = allocateExtent(heapLength, offset);
+        if (result.good())
+            result = writeBlock(heapFd_, OFstatic_cast(long, offset), buffer, length);
+        if (result.bad()) return result;
+        memcpy(slot, &slotLength, sizeof(slotLength));
+        memcpy(slot + 2, &offset, sizeof(offset));
+        memcpy(slot + 6, &heapLength, sizeof(heapLength));
+    }
+    result = writeBlock(fd_, slotOffset, slot, sizeof(slot));
+
+    /* the previous extent is released only after the slot has been replaced */
+    if (result.good() && (oldLength == COMPACTINDEX_EXTERNAL))
+        releaseExtent(oldOffset, oldHeapLength);
+    return result;
+}
+
+void DcmQueryRetrieveCompactIndex::flushBuffer()
+{
+    bufferFirst_ = 0;
+    bufferCount_ = 0;
+    lastRead_ = -2;
+}
+
+OFCondition DcmQueryRetrieveCompactIndex::beginConversion(int fd, const char *heapFilename, int legacyRecords)
+{
+    close();
+    fd_ = fd;
+    memset(&header_, 0, sizeof(header_));
+    memcpy(header_.Magic, COMPACTINDEX_MAGIC, sizeof(header_.Magic));
+    header_.SlotSize = DB_CompactSlotSize;
+    header_.Converting = 1;
+    header_.LegacyRecords = OFstatic_cast(Uint32, legacyRecords);
+    header_.ConvertedRecords = 0;
+    OFCondition result = openHeap(heapFilename, OFTrue);
+    if (result.good())
+        result = writeHeader();
+    if (result.bad())
+    {
+        close();
+        return result;
+    }
+    buffer_ = new char[COMPACTINDEX_READAHEAD * DB_CompactSlotSize];
+    return EC_Normal;
+}
+
+int DcmQueryRetrieveCompactIndex::legacyRecords() const
+{
+    return OFstatic_cast(int, header_.LegacyRecords);
+}
+
+int DcmQueryRetrieveCompactIndex::convertedRecords() const
+{
+    return OFstatic_cast(int, header_.ConvertedRecords);
+}
+
+OFCondition DcmQueryRetrieveCompactIndex::setConvertedRecords(int count)
+{
+    header_.ConvertedRecords = OFstatic_cast(Uint32, count);
+    return writeHeader();
+}
+
+OFCondition DcmQueryRetrieveCompactIndex::endConversion()
+{
+    if (fd_ < 0) return QR_EC_IndexDatabaseError;
+    /* remove the remaining data of the original format before the conversion
+     * is marked as completed, so that it is never mistaken for records
+     */
+    const long fileSize = OFstatic_cast(long, header_.ConvertedRecords + 1) * DB_CompactSlotSize;
+#ifdef _WIN32
+    if (_chsize(fd_, fileSize) != 0)
+#else
+    if (ftruncate(fd_, fileSize) != 0)
+#endif
+    {
+        DCMQRDB_ERROR("cannot truncate index file after conversion");
+        return QR_EC_IndexDatabaseError;
+    }
+    header_.Converting = 0;
+    header_.LegacyRecords = 0;
+    header_.ConvertedRecords = 0;
+    flushBuffer();
+    return writeHeader();
+}
+
+OFCondition DcmQueryRetrieveCompactIndex::readHeader()
+{
+    Header header;
+    if (readBlock(fd_, 0, OFreinterpret_cast(char *, &header), sizeof(header)) != OFstatic_cast(long, sizeof(header)))
+        return QR_EC_IndexDatabaseError;
+    if ((memcmp(header.Magic, COMPACTINDEX_MAGIC, sizeof(header.Magic)) != 0) ||
+        (header.SlotSize != DB_CompactSlotSize))
+    {
+        DCMQRDB_ERROR("index file has an unsupported format");
+        return QR_EC_IndexDatabaseError;
+    }
+    header_ = header;
+    return EC_Normal;
+}
+
+OFCondition DcmQueryRetrieveCompactIndex::writeHeader()
+{
+    /* the header occupies the first slot of the file */
+    char slot[DB_CompactSlotSize];
+    memset(slot, 0, sizeof(slot));
+    memcpy(slot, &header_, sizeof(header_));
+    if (writeBlock(fd_, 0, slot, sizeof(slot)).bad())
+    {
+        DCMQRDB_WARN("cannot write index file header");
+        return QR_EC_IndexDatabaseError;
+    }
+    return EC_Normal;
+}
+
+OFCondition DcmQueryRetrieveCompactIndex::openHeap(const char *heapFilename, OFBool truncate)
+{
+    int flags = O_RDWR | O_CREAT;
+    if (truncate) flags |= O_TRUNC;
+#ifdef O_BINARY
+    flags |= O_BINARY;
+#endif
+    heapFd_ = ::open(heapFilename, flags, 0666);
+    if (heapFd_ < 0)
+    {
+        DCMQRDB_ERROR("cannot open index heap file: " << heapFilename);
+        return QR_EC_IndexDatabaseError;
+    }
+    HeapHeader heapHeader;
+    if (lseek(heapFd_, 0, SEEK_END) == 0)
+    {
+        memset(&heapHeader, 0, sizeof(heapHeader));
+        memcpy(heapHeader.Magic, COMPACTINDEX_HEAP_MAGIC, sizeof(heapHeader.Magic));
+        return writeBlock(heapFd_, 0, OFreinterpret_cast(const char *, &heapHeader), sizeof(heapHeader));
+    }
+    if ((readBlock(heapFd_, 0, OFreinterpret_cast(char *, &heapHeader), sizeof(heapHeader)) != OFstatic_cast(long, sizeof(heapHeader))) ||
+        (memcmp(heapHeader.Magic, COMPACTINDEX_HEAP_MAGIC, sizeof(heapHeader.Magic)) != 0))
+    {
+        DCMQRDB_ERROR("index heap file has an unsupported format: " << heapFilename);
+        return QR_EC_IndexDatabaseError;
+    }
+    return EC_Normal;
+}
+
+OFCondition DcmQueryRetrieveCompactIndex::allocateExtent(Uint32 length, Uint32 &offset)
+{
+    const int sizeClass = extentSizeClass(length);
+    HeapHeader heapHeader;
+    if ((sizeClass < 0) ||
+        (readBlock(heapFd_, 0, OFreinterpret_cast(char *, &heapHeader), sizeof(heapHeader)) != OFstatic_cast(long, sizeof(heapHeader))))
+        return QR_EC_IndexDatabaseError;
+    if (heapHeader.FreeExtent[sizeClass] != 0)
+    {
+        /* reuse a free extent of the same size class */
+        Uint32 next;
+        offset = heapHeader.FreeExtent[sizeClass];
+        if (readBlock(heapFd_, OFstatic_cast(long, offset), OFreinterpret_cast(char *, &next), sizeof(next)) != OFstatic_cast(long, sizeof(next)))
+            return QR_EC_IndexDatabaseError;
+        heapHeader.FreeExtent[sizeClass] = next;
+        return writeBlock(heapFd_, 0, OFreinterpret_cast(const char *, &heapHeader), sizeof(heapHeader));
+    }
+    /* append a new extent, the whole extent is reserved so that it can later
+     * be reused for any record of the same size class
+     */
+    const long fileSize = OFstatic_cast(long, lseek(heapFd_, 0, SEEK_END));
+    if (fileSize < OFstatic_cast(long, sizeof(heapHeader))) return QR_EC_IndexDatabaseError;
+    offset = OFstatic_cast(Uint32, fileSize);
+    const char zero = 0;
+    return writeBlock(heapFd_, fileSize + (COMPACTINDEX_MIN_EXTENT << sizeClass) - 1, &zero, 1);
+}
+
+OFCondition DcmQueryRetrieveCompactIndex::releaseExtent(Uint32 offset, Uint32 length)
+{
+    const int sizeClass = extentSizeClass(length);
+    HeapHeader heapHeader;
+    if ((heapFd_ < 0) || (sizeClass < 0) || (offset < sizeof(heapHeader)) ||
+        (readBlock(heapFd_, 0, OFreinterpret_cast(char *, &heapHeader), sizeof(heapHeader)) != OFstatic_cast(long, sizeof(heapHeader))))
+        return QR_EC_IndexDatabaseError;
+    /* the list of free extents is chained through the first bytes of each extent */
+    OFCondition result = writeBlock(heapFd_, OFstatic_cast(long, offset),
+        OFreinterpret_cast(const char *, &heapHeader.FreeExtent[sizeClass]), sizeof(Uint32));
+    if (result.good())
+    {
+        heapHeader.FreeExtent[sizeClass] = offset;
+        result = writeBlock(heapFd_, 0, OFreinterpret_cast(const char *, &heapHeader), sizeof(heapHeader));
+    }
+    return result;
+}
+
+long DcmQueryRetrieveCompactIndex::readBlock(int fd, long offset, char *buffer, size_t length)
+{
+    if (lseek(fd, offset, SEEK_SET) != offset)
+        return -1;
+    size_t done = 0;
+    while (done < length)
+    {
+        const long n = OFstatic_cast(long, read(fd, buffer + done, length - done));
+        if (n < 0) return -1;
+        if (n == 0) break;
+        done += OFstatic_cast(size_t, n);
+    }
+    return OFstatic_cast(long, done);
+}
+
+OFCondition DcmQueryRetrieveCompactIndex::writeBlock(int fd, long offset, const char *buffer, size_t length)
+{
+    if (lseek(fd, offset, SEEK_SET) != offset)
+        return QR_EC_IndexDatabaseError;
+    size_t done = 0;
+    while (done < length)
+    {
+        const long n = OFstatic_cast(long, write(fd, buffer + done, length - done));
+        if (n <= 0)
+        {
+            DCMQRDB_WARN("cannot write index file");
+            return QR_EC_IndexDatabaseError;
+        }
+        done += OFstatic_cast(size_t, n);
+    }
+    return EC_Normal;
+}
@@ -0,0 +1,329 @@
+/*
+ *
+ *  Copyright (C) 2016, OFFIS e.V.
+ *  All rights reserved.  See COPYRIGHT file for details.
+ *
+ *  This software and supporting documentation were developed by
+ *
+ *    OFFIS e.V.
+ *    R&D Division Health
+ *    Escherweg 2
+ *    D-26121 Oldenburg, Germany
+ *
+ *
+ *  Module:  dcmqrdb
+ *
+ *  Author:  OFFIS DICOM Team
+ *
+ *  Purpose: class DcmQueryRetrieveSummaryCache
+ *
+ */
+
+#include "dcmtk/config/osconfig.h"    /* make sure OS specific configuration is included first */
+
+#define INCLUDE_CSTDLIB
+#define INCLUDE_CSTRING
+#include "dcmtk/ofstd/ofstdinc.h"
+
+#include "dcmtk/dcmqrdb/dcmqrdbg.h"
+#include "dcmtk/ofstd/ofalgo.h"
+
+
+/* find the position of the entry with the given UID in a vector of
+ * pointers to entries sorted by UID, or the position where it should be
+ * inserted
+ */
+template <class T>
+static size_t findEntry(const OFVector<T *> &entries, const char *uid, OFBool &found)
+{
+    size_t first = 0;
+    size_t last = entries.size();
+    while (first < last)
+    {
+        size_t middle = first + (last - first) / 2;
+        if (entries[middle]->uid.compare(uid) < 0)
+            first = middle + 1;
+        else
+            last = middle;
+    }
+    found = (first < entries.size()) && (entries[first]->uid == uid);
+    return first;
+}
+
+/* compare function for qsort, a and b are pointers to record indexes */
+static int compareRecords(const void *a, const void *b)
+{
+    int idxA = *OFstatic_cast(const int *, a);
+    int idxB = *OFstatic_cast(const int *, b);
+    return (idxA < idxB) ? -1 : ((idxA > idxB) ? 1 : 0);
+}
+
+
+DcmQueryRetrieveSummaryCache::StudySummary::~StudySummary()
+{
+    for (size_t i = 0; i < series.size(); ++i)
+        delete series[i];
+}
+
+DcmQueryRetrieveSummaryCache::DcmQueryRetrieveSummaryCache()
+: studies_()
+, incomplete_(0)
+, generation_(0)
+, current_(OFFalse)
+#ifdef WITH_THREADS
+, mutex_()
+#endif
+{
+}
+
+DcmQueryRetrieveSummaryCache::~DcmQueryRetrieveSummaryCache()
+{
+    clear();
+}
+
+OFBool DcmQueryRetrieveSummaryCache::isCurrent(Uint32 generation)
+{
+#ifdef WITH_THREADS
+    mutex_.lock();
+#endif
+    OFBool result = current_ && (generation_ == generation);
+#ifdef WITH_THREADS
+    mutex_.unlock();
+#endif
+    return result;
+}
+
+void DcmQueryRetrieveSummaryCache::addRecord(int idx, const char *studyUID, const char *seriesUID)
+{
+    insertRecord(idx, studyUID, seriesUID);
+}
+
+void DcmQueryRetrieveSummaryCache::replace(DcmQueryRetrieveSummaryCache &other, Uint32 generation)
+{
+#ifdef WITH_THREADS
+    mutex_.lock();
+#endif
+    clear();
+    studies_.swap(other.studies_);
+    incomplete_ = other.incomplete_;
+    other.incomplete_ = 0;
+    generation_ = generation;
+    current_ = OFTrue;
+#ifdef WITH_THREADS
+    mutex_.unlock();
+#endif
+}
+
+void DcmQueryRetrieveSummaryCache::recordAdded(Uint32 oldGeneration, Uint32 newGeneration, int idx, const char *studyUID, const char *seriesUID)
+{
+#ifdef WITH_THREADS
+    mutex_.lock();
+#endif
+    if (current_ && (generation_ == oldGeneration))
+    {
+        insertRecord(idx, studyUID, seriesUID);
+        generation_ = newGeneration;
+    }
+#ifdef WITH_THREADS
+    mutex_.unlock();
+#endif
+}
+
+void DcmQueryRetrieveSummaryCache::recordRemoved(Uint32 oldGeneration, Uint32 newGeneration, int idx, const char *studyUID, const char *seriesUID)
+{
+#ifdef WITH_THREADS
+    mutex_.lock();
+#endif
+    if (current_ && (generation_ == oldGeneration))
+    {
+        /* a record that is not known means that the summary is not consistent */
+        if (eraseRecord(idx, studyUID, seriesUID))
+            generation_ = newGeneration;
+        else
+            current_ = OFFalse;
+    }
+#ifdef WITH_THREADS
+    mutex_.unlock();
+#endif
+}
+
+void DcmQueryRetrieveSummaryCache::invalidate()
+{
+#ifdef WITH_THREADS
+    mutex_.lock();
+#endif
+    current_ = OFFalse;
+#ifdef WITH_THREADS
+    mutex_.unlock();
+#endif
+}
+
+OFBool DcmQueryRetrieveSummaryCache::getStudyRecords(OFVector<int> &result)
+{
+    result.clear();
+#ifdef WITH_THREADS
+    mutex_.lock();
+#endif
+    OFBool usable = current_ && (incomplete_ == 0);
+    if (usable)
+    {
+        result.reserve(studies_.size());
+        for (size_t i = 0; i < studies_.size(); ++i)
+        {
+            const StudySummary *study = studies_[i];
+            int first = -1;
+            for (size_t j = 0; j < study->series.size(); ++j)
+            {
+                int idx = study->series[j]->records[0];
+                if ((first < 0) || (idx < first))
+                    first = idx;
+            }
+            result.push_back(first);
+        }
+    }
+#ifdef WITH_THREADS
+    mutex_.unlock();
+#endif
+    if (usable && ! result.empty())
+        qsort(&result[0], result.size(), sizeof(int), compareRecords);
+    return usable;
+}
+
+OFBool DcmQueryRetrieveSummaryCache::getSeriesRecords(const char *studyUID, OFVector<int> &result)
+{
+    result.clear();
+#ifdef WITH_THREADS
+    mutex_.lock();
+#endif
+    OFBool usable = current_ && (incomplete_ == 0);
+    if (usable)
+    {
+        size_t first = 0;
+        size_t last = studies_.size();
+        if (studyUID != NULL)
+        {
+            OFBool found = OFFalse;
+            first = findEntry(studies_, studyUID, found);
+            last = found ? first + 1 : first;
+        }
+        for (size_t i = first; i < last; ++i)
+        {
+            const StudySummary *study = studies_[i];
+            for (size_t j = 0; j < study->series.size(); ++j)
+                result.push_back(study->series[j]->records[0]);
+        }
+    }
+#ifdef WITH_THREADS
+    mutex_.unlock();
+#endif
+    if (usable && ! result.empty())
+        qsort(&result[0], result.size(), sizeof(int), compareRecords);
+    return usable;
+}
+
+OFBool DcmQueryRetrieveSummaryCache::getStudyCounts(const char *studyUID, size_t &numSeries, size_t &numInstances)
+{
+    OFBool found = OFFalse;
+#ifdef WITH_THREADS
+    mutex_.lock();
+#endif
+    if (current_)
+    {
+        size_t pos = findEntry(studies_, studyUID, found);
+        if (found)
+        {
+            numSeries = studies_[pos]->series.size();
+            numInstances = studies_[pos]->numInstances;
+        }
+    }
+#ifdef WITH_THREADS
+    mutex_.unlock();
+#endif
+    return found;
+}
+
+void DcmQueryRetrieveSummaryCache::clear()
+{
+    for (size_t i = 0; i < studies_.size(); ++i)
+        delete studies_[i];
+    studies_.clear();
+    incomplete_ = 0;
+    current_ = OFFalse;
+}
+
+void DcmQueryRetrieveSummaryCache::insertRecord(int idx, const char *studyUID, const char *seriesUID)
+{
+    if ((studyUID == NULL) || (studyUID[0] == '\0'))
+    {
+        incomplete_++;
+        return;
+    }
+    if (seriesUID == NULL)
+        seriesUID = "";
+
+    OFBool found = OFFalse;
+    size_t pos = findEntry(studies_, studyUID, found);
+    if (! found)
+    {
+        StudySummary *newStudy = new StudySummary;
+        newStudy->uid = studyUID;
+        studies_.insert(studies_.begin() + pos, newStudy);
+    }
+    StudySummary *study = studies_[pos];
+
+    pos = findEntry(study->series, seriesUID, found);
+    if (! found)
+    {
+        SeriesSummary *newSeries = new SeriesSummary;
+        newSeries->uid = seriesUID;
+        study->series.insert(study->series.begin() + pos, newSeries);
+    }
+    OFVector<int> &records = study->series[pos]->records;
+
+    /* records are usually added in ascending order, except for reused free records */
+    size_t i = records.size();
+    while ((i > 0) && (records[i - 1] > idx))
+        i--;
+    records.insert(records.begin() + i, idx);
+    study->numInstances++;
+}
+
+OFBool DcmQueryRetrieveSummaryCache::eraseRecord(int idx, const char *studyUID, const char *seriesUID)
+{
+    if ((studyUID == NULL) || (studyUID[0] == '\0'))
+    {
+        if (incomplete_ == 0)
+            return OFFalse;
+        incomplete_--;
+        return OFTrue;
+    }
+    if (seriesUID == NULL)
+        seriesUID = "";
+
+    OFBool found = OFFalse;
+    size_t studyPos = findEntry(studies_, studyUID, found);
+    if (! found)
+        return OFFalse;
+    StudySummary *study = studies_[studyPos];
+    size_t seriesPos = findEntry(study->series, seriesUID, found);
+    if (! found)
+        return OFFalse;
+    OFVector<int> &records = study->series[seriesPos]->records;
+    OFVector<int>::iterator it = OFFind(OFVector<int>::iterator, int, records.begin(), records.end(), idx);
+    if (it == records.end())
+        return OFFalse;
+
+    records.erase(it);
+    study->numInstances--;
+    if (records.empty())
+    {
+        delete study->series[seriesPos];
+        study->series.erase(study->series.begin() + seriesPos);
+        if (study->series.empty())
+        {
+            delete study;
+            studies_.erase(studies_.begin() + studyPos);
+        }
+    }
+    return OFTrue;
+}
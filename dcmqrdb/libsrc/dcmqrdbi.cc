@@ -40,6 +40,11 @@ END_EXTERN_C
 
 #include "dcmtk/dcmqrdb/dcmqrdbs.h"
 #include "dcmtk/dcmqrdb/dcmqrdbi.h"
+#include "dcmtk/dcmqrdb/dcmqrdbk.h"
+#include "dcmtk/dcmqrdb/dcmqrdbt.h"
+#include "dcmtk/dcmqrdb/dcmqrdbc.h"
+#include "dcmtk/dcmqrdb/dcmqrdbg.h"
+#include "dcmtk/dcmqrdb/dcmqrdbj.h"
 #include "dcmtk/dcmqrdb/dcmqrcnf.h"
 #include "dcmtk/dcmqrdb/dcmqropt.h"
 
@@ -434,6 +439,144 @@ static long DB_lseek(int fildes, long offset, int whence)
     return pos;
 }
 
+/******************************
+ *      Compact encoding of an Index record
+ *
+ * In the compact index file format, a record is encoded as RecordedDate,
+ * ImageSize and hstat followed by the non-empty attribute values, each
+ * preceded by a field identifier and its length. Empty values are omitted.
+ */
+
+/* field identifiers of the compact encoding, the attribute values in
+ * param[] use DB_FIELD_PARAM + RECORDIDX_xxx
+ */
+#define DB_FIELD_FILENAME               0
+#define DB_FIELD_SOPCLASSUID            1
+#define DB_FIELD_INSTANCEDESCRIPTION    2
+#define DB_FIELD_PARAM                  3
+
+/* length of the fixed part of an encoded record */
+#define DB_ENCODED_FIXED_LENGTH         (sizeof(double) + 2 * sizeof(Sint32))
+
+/* maximum length of an encoded record: all values at maximum length plus
+ * 3 bytes per value for field identifier and length
+ */
+#define DB_MAX_ENCODED_RECORD           (SIZEOF_IDXRECORD + 3 * (NBPARAMETERS + DB_FIELD_PARAM))
+
+static size_t DB_IdxEncodeValue (char *buffer, size_t pos, Uint8 field, const char *value, size_t maxLength)
+{
+    Uint16 length = 0 ;
+    while ((length < maxLength) && (value [length] != '\0'))
+        length++ ;
+    if (length == 0)
+        return pos ;
+    buffer [pos++] = OFstatic_cast(char, field) ;
+    memcpy (buffer + pos, &length, sizeof(length)) ;
+    pos += sizeof(length) ;
+    memcpy (buffer + pos, value, length) ;
+    return pos + length ;
+}
+
+static size_t DB_IdxEncodeRecord (IdxRecord *idxRec, char *buffer)
+{
+    IdxRecord   capacity ;
+    Sint32      value ;
+    size_t      pos = 0 ;
+
+    /*** The maximum length of each value is set by the initialization
+    **/
+
+    DB_IdxInitRecord (&capacity, 0) ;
+
+    memcpy (buffer + pos, &idxRec -> RecordedDate, sizeof(double)) ;
+    pos += sizeof(double) ;
+    value = idxRec -> ImageSize ;
+    memcpy (buffer + pos, &value, sizeof(value)) ;
+    pos += sizeof(value) ;
+    value = idxRec -> hstat ;
+    memcpy (buffer + pos, &value, sizeof(value)) ;
+    pos += sizeof(value) ;
+
+    pos = DB_IdxEncodeValue (buffer, pos, DB_FIELD_FILENAME, idxRec -> filename, DBC_MAXSTRING) ;
+    pos = DB_IdxEncodeValue (buffer, pos, DB_FIELD_SOPCLASSUID, idxRec -> SOPClassUID, UI_MAX_LENGTH) ;
+    pos = DB_IdxEncodeValue (buffer, pos, DB_FIELD_INSTANCEDESCRIPTION, idxRec -> InstanceDescription, DESCRIPTION_MAX_LENGTH) ;
+    for (int i = 0 ; i < NBPARAMETERS ; i++)
+        pos = DB_IdxEncodeValue (buffer, pos, OFstatic_cast(Uint8, DB_FIELD_PARAM + i),
+                                 idxRec -> param[i]. PValueField, capacity. param[i]. ValueLength) ;
+    return pos ;
+}
+
+static OFCondition DB_IdxDecodeRecord (const char *buffer, size_t length, IdxRecord *idxRec)
+{
+    Uint32      capacity [NBPARAMETERS] ;
+    Sint32      value ;
+    size_t      pos = 0 ;
+
+    DB_IdxInitRecord (idxRec, 0) ;
+    for (int i = 0 ; i < NBPARAMETERS ; i++) {
+        capacity [i] = idxRec -> param[i]. ValueLength ;
+        idxRec -> param[i]. ValueLength = 0 ;
+    }
+    idxRec -> filename [0] = '\0' ;
+    idxRec -> SOPClassUID [0] = '\0' ;
+    idxRec -> InstanceDescription [0] = '\0' ;
+
+    if (length < DB_ENCODED_FIXED_LENGTH)
+        return QR_EC_IndexDatabaseError ;
+    memcpy (&idxRec -> RecordedDate, buffer + pos, sizeof(double)) ;
+    pos += sizeof(double) ;
+    memcpy (&value, buffer + pos, sizeof(value)) ;
+    idxRec -> ImageSize = value ;
+    pos += sizeof(value) ;
+    memcpy (&value, buffer + pos, sizeof(value)) ;
+    idxRec -> hstat = OFstatic_cast(DVIFhierarchyStatus, value) ;
+    pos += sizeof(value) ;
+
+    while (pos < length) {
+        Uint16  valueLength ;
+        char    *dest = NULL ;
+        size_t  maxLength = 0 ;
+
+        if (pos + 1 + sizeof(valueLength) > length)
+            return QR_EC_IndexDatabaseError ;
+        const Uint8 field = OFstatic_cast(Uint8, buffer [pos]) ;
+        memcpy (&valueLength, buffer + pos + 1, sizeof(valueLength)) ;
+        pos += 1 + sizeof(valueLength) ;
+        if (pos + valueLength > length)
+            return QR_EC_IndexDatabaseError ;
+
+        if (field == DB_FIELD_FILENAME) {
+            dest = idxRec -> filename ;
+            maxLength = DBC_MAXSTRING ;
+        }
+        else if (field == DB_FIELD_SOPCLASSUID) {
+            dest = idxRec -> SOPClassUID ;
+            maxLength = UI_MAX_LENGTH ;
+        }
+        else if (field == DB_FIELD_INSTANCEDESCRIPTION) {
+            dest = idxRec -> InstanceDescription ;
+            maxLength = DESCRIPTION_MAX_LENGTH ;
+        }
+        else if (field < DB_FIELD_PARAM + NBPARAMETERS) {
+            DB_SmallDcmElmt *se = idxRec -> param + (field - DB_FIELD_PARAM) ;
+            dest = se -> PValueField ;
+            maxLength = capacity [field - DB_FIELD_PARAM] ;
+            se -> ValueLength = (valueLength < maxLength) ? valueLength : OFstatic_cast(Uint32, maxLength) ;
+        }
+
+        /*** Unknown fields are ignored
+        **/
+
+        if (dest != NULL) {
+            const size_t n = (valueLength < maxLength) ? valueLength : maxLength ;
+            memcpy (dest, buffer + pos, n) ;
+            dest [n] = '\0' ;
+        }
+        pos += valueLength ;
+    }
+    return EC_Normal ;
+}
+
 /******************************
  *      Read an Index record
  */
@@ -441,6 +584,15 @@ static long DB_lseek(int fildes, long offset, int whence)
 OFCondition DcmQueryRetrieveIndexDatabaseHandle::DB_IdxRead (int idx, IdxRecord *idxRec)
 {
 
+    if (compactIndex_) {
+        char    buffer [DB_MAX_ENCODED_RECORD] ;
+        size_t  length = 0 ;
+
+        if (compactIndex_->readRecord (idx, buffer, sizeof(buffer), length) != EC_Normal)
+            return (QR_EC_IndexDatabaseError) ;
+        return DB_IdxDecodeRecord (buffer, length, idxRec) ;
+    }
+
     /*** Goto the right index in file
     **/
 
@@ -462,40 +614,118 @@ OFCondition DcmQueryRetrieveIndexDatabaseHandle::DB_IdxRead (int idx, IdxRecord
 }
 
 
+/******************************
+ *      Write an Index record
+ */
+
+OFCondition DcmQueryRetrieveIndexDatabaseHandle::DB_IdxWrite (int idx, IdxRecord *idxRec)
+{
+    OFCondition cond = EC_Normal;
+
+    if (compactIndex_) {
+        char    buffer [DB_MAX_ENCODED_RECORD] ;
+
+        return compactIndex_->writeRecord (idx, buffer, DB_IdxEncodeRecord (idxRec, buffer)) ;
+    }
+
+    DB_lseek (handle_ -> pidx, (long) (SIZEOF_STUDYDESC + idx * SIZEOF_IDXRECORD), SEEK_SET) ;
+
+    if (write (handle_ -> pidx, (char *) idxRec, SIZEOF_IDXRECORD) != SIZEOF_IDXRECORD)
+        cond = QR_EC_IndexDatabaseError ;
+
+    DB_lseek (handle_ -> pidx, 0L, SEEK_SET) ;
+
+    return cond ;
+}
+
+
+/******************************
+ *      Get the number of Index records (including free ones)
+ */
+
+int DcmQueryRetrieveIndexDatabaseHandle::DB_IdxCount()
+{
+    if (compactIndex_)
+        return compactIndex_->numberOfRecords () ;
+
+    long fileSize = DB_lseek (handle_ -> pidx, 0L, SEEK_END) ;
+    DB_lseek (handle_ -> pidx, 0L, SEEK_SET) ;
+    if (fileSize <= (long) SIZEOF_STUDYDESC)
+        return 0 ;
+    return (int) ((fileSize - SIZEOF_STUDYDESC) / SIZEOF_IDXRECORD) ;
+}
+
+
 /******************************
  *      Add an Index record
  *      Returns the index allocated for this record
+ *      Free records are taken from the list of free records, which is
+ *      chained through the ImageSize field of the free records.
  */
 
-static OFCondition DB_IdxAdd (DB_Private_Handle *phandle, int *idx, IdxRecord *idxRec)
+OFCondition DcmQueryRetrieveIndexDatabaseHandle::DB_IdxAdd (int *idx, IdxRecord *idxRec)
 {
     IdxRecord   rec ;
+    int         numRecords = DB_IdxCount () ;
+    int         freeIdx = DB_UnknownFreeRecords ;
+    OFBool      studyTableValid = studyTable_->isValid () ;
+    Uint32      generation = studyTable_->generation () ;
     OFCondition cond = EC_Normal;
 
-    /*** Find free place for the record
-    *** A place is free if filename is empty
-    **/
+    if (studyTableValid)
+        freeIdx = studyTable_->firstFreeRecord () ;
 
-    *idx = 0 ;
+    if (freeIdx == DB_NoFreeRecord) {
 
-    DB_lseek (phandle -> pidx, (long) SIZEOF_STUDYDESC, SEEK_SET) ;
-    while (read (phandle -> pidx, (char *) &rec, SIZEOF_IDXRECORD) == SIZEOF_IDXRECORD) {
-        if (rec. filename [0] == '\0')
-            break ;
-        (*idx)++ ;
+        /*** No free record, append to the end of the file
+        **/
+
+        *idx = numRecords ;
+    }
+    else if ((freeIdx >= 0) && (freeIdx < numRecords) && (DB_IdxRead (freeIdx, &rec) == EC_Normal)
+             && (rec. filename [0] == '\0') && (rec. ImageSize >= DB_NoFreeRecord) && (rec. ImageSize < numRecords)) {
+
+        /*** Take the first record from the list of free records
+        **/
+
+        *idx = freeIdx ;
+        freeIdx = rec. ImageSize ;
+    }
+    else {
+
+        /*** The list of free records is not available or damaged.
+        *** Find free place for the record
+        *** A place is free if filename is empty
+        **/
+
+        if (freeIdx != DB_UnknownFreeRecords) {
+            DCMQRDB_WARN("list of free records in index file is damaged, searching for free record");
+            freeIdx = DB_UnknownFreeRecords ;
+            studyTable_->setFirstFreeRecord (freeIdx) ;
+        }
+        for (*idx = 0 ; *idx < numRecords ; (*idx)++) {
+            if ((DB_IdxRead (*idx, &rec) == EC_Normal) && (rec. filename [0] == '\0'))
+                break ;
+        }
     }
 
     /*** We have either found a free place or we are at the end of file. **/
 
+    cond = DB_IdxWrite (*idx, idxRec) ;
 
-    DB_lseek (phandle -> pidx, (long) (SIZEOF_STUDYDESC + (*idx) * SIZEOF_IDXRECORD), SEEK_SET) ;
+    if (cond.good() && (freeIdx != DB_UnknownFreeRecords) && (*idx != numRecords))
+        studyTable_->setFirstFreeRecord (freeIdx) ;
 
-    if (write (phandle -> pidx, (char *) idxRec, SIZEOF_IDXRECORD) != SIZEOF_IDXRECORD)
-        cond = QR_EC_IndexDatabaseError ;
-    else
-        cond = EC_Normal ;
+    /*** Tell other processes about the new record
+    **/
 
-    DB_lseek (phandle -> pidx, 0L, SEEK_SET) ;
+    if (cond.good() && studyTableValid) {
+        if (studyTable_->incrementGeneration ().good())
+            summaryCache_->recordAdded (generation, studyTable_->generation (), *idx,
+                idxRec -> StudyInstanceUID, idxRec -> SeriesInstanceUID) ;
+        else
+            summaryCache_->invalidate () ;
+    }
 
     return cond ;
 }
@@ -503,25 +733,45 @@ static OFCondition DB_IdxAdd (DB_Private_Handle *phandle, int *idx, IdxRecord *i
 
 /******************************
  *      Change the StudyDescRecord
+ *      Only provided for compatibility, see DB_UpdateStudyDesc()
  */
 
 OFCondition DcmQueryRetrieveIndexDatabaseHandle::DB_StudyDescChange(StudyDescRecord *pStudyDesc)
 {
     OFCondition cond = EC_Normal;
-    DB_lseek (handle_ -> pidx, 0L, SEEK_SET) ;
-    if (write (handle_ -> pidx, (char *) pStudyDesc, SIZEOF_STUDYDESC) != SIZEOF_STUDYDESC)
-        cond = QR_EC_IndexDatabaseError;
-    DB_lseek (handle_ -> pidx, 0L, SEEK_SET) ;
+    for (int i = 0 ; (i < MAX_MAX_STUDIES) && cond.good() ; i++) {
+        if (pStudyDesc[i]. StudyInstanceUID [0] != '\0')
+            cond = studyTable_->updateStudy (pStudyDesc[i]) ;
+    }
     return cond ;
 }
 
+/******************************
+ *      Get the StudyDescRecord of a study
+ */
+
+OFCondition DcmQueryRetrieveIndexDatabaseHandle::DB_FindStudyDesc(const char *studyUID, StudyDescRecord *pStudyDesc)
+{
+    return studyTable_->findStudy (studyUID, *pStudyDesc) ;
+}
+
+/******************************
+ *      Change the StudyDescRecord of a study
+ */
+
+OFCondition DcmQueryRetrieveIndexDatabaseHandle::DB_UpdateStudyDesc(const StudyDescRecord *pStudyDesc)
+{
+    return studyTable_->updateStudy (*pStudyDesc) ;
+}
+
 /******************************
  *      Init an Index record loop
  */
 
 OFCondition DcmQueryRetrieveIndexDatabaseHandle::DB_IdxInitLoop(int *idx)
 {
-    DB_lseek (handle_ -> pidx, SIZEOF_STUDYDESC, SEEK_SET) ;
+    if (! compactIndex_)
+        DB_lseek (handle_ -> pidx, SIZEOF_STUDYDESC, SEEK_SET) ;
     *idx = -1 ;
     return EC_Normal ;
 }
@@ -535,6 +785,17 @@ OFCondition DcmQueryRetrieveIndexDatabaseHandle::DB_IdxGetNext(int *idx, IdxReco
 {
 
     (*idx)++ ;
+
+    if (compactIndex_) {
+        /* records are read ahead by the compact index while reading sequentially */
+        while (DB_IdxRead (*idx, idxRec) == EC_Normal) {
+            if (idxRec -> filename [0] != '\0')
+                return EC_Normal ;
+            (*idx)++ ;
+        }
+        return QR_EC_IndexDatabaseError ;
+    }
+
     DB_lseek (handle_ -> pidx, SIZEOF_STUDYDESC + (long)(*idx) * SIZEOF_IDXRECORD, SEEK_SET) ;
     while (read (handle_ -> pidx, (char *) idxRec, SIZEOF_IDXRECORD) == SIZEOF_IDXRECORD) {
         if (idxRec -> filename [0] != '\0') {
@@ -552,20 +813,22 @@ OFCondition DcmQueryRetrieveIndexDatabaseHandle::DB_IdxGetNext(int *idx, IdxReco
 
 
 /******************************
- *      Get next Index record
- *      On return, idx is initialized with the index of the record read
+ *      Get the StudyDescRecords of the first studies
+ *      Only provided for compatibility, see DB_FindStudyDesc()
  */
 
 OFCondition DcmQueryRetrieveIndexDatabaseHandle::DB_GetStudyDesc (StudyDescRecord *pStudyDesc)
 {
+    OFVector<StudyDescRecord> studies ;
 
-    DB_lseek (handle_ -> pidx, 0L, SEEK_SET) ;
-    if ( read (handle_ -> pidx, (char *) pStudyDesc, SIZEOF_STUDYDESC) == SIZEOF_STUDYDESC )
-        return EC_Normal ;
+    bzero ((char *) pStudyDesc, SIZEOF_STUDYDESC) ;
+    if (studyTable_->getStudies (studies) != EC_Normal)
+        return QR_EC_IndexDatabaseError ;
 
-    DB_lseek (handle_ -> pidx, 0L, SEEK_SET) ;
+    for (size_t i = 0 ; (i < studies.size()) && (i < MAX_MAX_STUDIES) ; i++)
+        pStudyDesc[i] = studies[i] ;
 
-    return QR_EC_IndexDatabaseError ;
+    return EC_Normal ;
 }
 
 
@@ -577,18 +840,51 @@ OFCondition DcmQueryRetrieveIndexDatabaseHandle::DB_GetStudyDesc (StudyDescRecor
 OFCondition DcmQueryRetrieveIndexDatabaseHandle::DB_IdxRemove(int idx)
 {
     IdxRecord   rec ;
+    IdxRecord   oldRec ;
+    int         freeIdx = DB_UnknownFreeRecords ;
+    OFBool      studyTableValid = OFFalse ;
+    Uint32      generation = 0 ;
     OFCondition cond = EC_Normal;
 
-    DB_lseek (handle_ -> pidx, SIZEOF_STUDYDESC + (long)idx * SIZEOF_IDXRECORD, SEEK_SET) ;
+    /*** Nothing to do if the record is already free,
+    *** otherwise remember the keys of the record to be removed
+    **/
+
+    if (DB_IdxRead (idx, &oldRec) != EC_Normal)
+        return QR_EC_IndexDatabaseError ;
+    if (oldRec. filename [0] == '\0')
+        return EC_Normal ;
+
+    studyTableValid = studyTable_->isValid () ;
+    generation = studyTable_->generation () ;
+    if (studyTableValid)
+        freeIdx = studyTable_->firstFreeRecord () ;
+
     DB_IdxInitRecord (&rec, 0) ;
 
+    /*** Insert the record into the list of free records
+    **/
+
     rec. filename [0] = '\0' ;
-    if (write (handle_ -> pidx, (char *) &rec, SIZEOF_IDXRECORD) == SIZEOF_IDXRECORD)
-        cond = EC_Normal ;
-    else
-        cond = QR_EC_IndexDatabaseError ;
+    rec. ImageSize = (freeIdx == DB_UnknownFreeRecords) ? DB_NoFreeRecord : freeIdx ;
+    cond = DB_IdxWrite (idx, &rec) ;
 
-    DB_lseek (handle_ -> pidx, 0L, SEEK_SET) ;
+    if (cond.good() && (freeIdx != DB_UnknownFreeRecords))
+        studyTable_->setFirstFreeRecord (idx) ;
+
+    /*** An invalid key index is rebuilt by the next writer
+    **/
+
+    if (cond.good() && keyIndex_)
+        keyIndex_->removeRecord (idx, oldRec) ;
+
+    if (cond.good() && studyTableValid) {
+        if (studyTable_->incrementGeneration ().good())
+            summaryCache_->recordRemoved (generation, studyTable_->generation (), idx,
+                oldRec. StudyInstanceUID, oldRec. SeriesInstanceUID) ;
+        else
+            summaryCache_->invalidate () ;
+    }
 
     return cond ;
 }
@@ -602,15 +898,30 @@ OFCondition DcmQueryRetrieveIndexDatabaseHandle::DB_lock(OFBool exclusive)
     } else {
         lockmode = LOCK_SH;     /* shared lock */
     }
+    if (compactIndex_ && compactIndex_->conversionPending()) {
+        DCMQRDB_ERROR("conversion of index file " << handle_->indexFilename
+            << " has not been completed, run dcmqridx --convert");
+        return QR_EC_IndexDatabaseError;
+    }
     if (dcmtk_flock(handle_->pidx, lockmode) < 0) {
         dcmtk_plockerr("DB_lock");
         return QR_EC_IndexDatabaseError;
     }
+    /* the index file may have been modified by another process */
+    if (compactIndex_) compactIndex_->flushBuffer();
+    if (exclusive) {
+        /* rebuild the files derived from the index file if necessary */
+        updateStudyTable();
+        updateKeyIndex();
+    }
     return EC_Normal;
 }
 
 OFCondition DcmQueryRetrieveIndexDatabaseHandle::DB_unlock()
 {
+    if (compactIndex_) compactIndex_->flushBuffer();
+    /* mark the key index as valid again after all updates are on disk */
+    if (keyIndex_) keyIndex_->commitUpdate();
     if (dcmtk_flock(handle_->pidx, LOCK_UN) < 0) {
         dcmtk_plockerr("DB_unlock");
         return QR_EC_IndexDatabaseError;
@@ -661,6 +972,76 @@ static OFCondition DB_FreeElementList (DB_ElementList *lst)
  *    Matches two strings
  */
 
+/************
+**      Free the list of candidate records determined with the key index
+ */
+
+static void DB_FreeCandidateList (DB_Private_Handle *phandle)
+{
+    DB_CounterList *plist ;
+    while (phandle->candidateList) {
+        plist = phandle->candidateList ;
+        phandle->candidateList = plist->next ;
+        free (plist) ;
+    }
+    phandle->useCandidateList = OFFalse ;
+}
+
+/************
+**      Replace the list of candidate records
+**      Returns OFFalse if out of memory, in which case all records are checked
+ */
+
+static OFBool DB_SetCandidateList (DB_Private_Handle *phandle, const OFVector<int> &candidates)
+{
+    DB_CounterList *pidxlist ;
+    DB_CounterList *lastidxlist = NULL ;
+
+    DB_FreeCandidateList (phandle) ;
+    for (size_t i = 0 ; i < candidates.size() ; i++) {
+        pidxlist = (DB_CounterList *) malloc (sizeof( DB_CounterList ) ) ;
+        if (pidxlist == NULL) {
+            DB_FreeCandidateList (phandle) ;
+            return OFFalse ;
+        }
+        pidxlist->next = NULL ;
+        pidxlist->idxCounter = candidates[i] ;
+        if (phandle->candidateList == NULL)
+            phandle->candidateList = pidxlist ;
+        else
+            lastidxlist->next = pidxlist ;
+        lastidxlist = pidxlist ;
+    }
+    phandle->useCandidateList = OFTrue ;
+    return OFTrue ;
+}
+
+/************
+**      Compare two record indexes, for bsearch
+ */
+
+static int DB_CompareRecordIndex (const void *a, const void *b)
+{
+    int idxA = *(const int *) a ;
+    int idxB = *(const int *) b ;
+    return (idxA < idxB) ? -1 : ((idxA > idxB) ? 1 : 0) ;
+}
+
+/************
+**      Free the images of a move request that have not been retrieved yet
+ */
+
+static void DB_FreeMoveList (DB_Private_Handle *phandle)
+{
+    DB_MoveList *plist ;
+    while (phandle->moveList) {
+        plist = phandle->moveList ;
+        phandle->moveList = plist->next ;
+        free (plist) ;
+    }
+    phandle->NumberRemainOperations = 0 ;
+}
+
 static int DB_StringUnify  (char *pmod, char *pstr)
 {
     int uni;
@@ -1604,6 +1985,342 @@ OFCondition DcmQueryRetrieveIndexDatabaseHandle::hierarchicalCompare (
     return QR_EC_IndexDatabaseError;
 }
 
+/******************************
+ *      Rebuild the key index from the index file if it is not valid
+ */
+
+void DcmQueryRetrieveIndexDatabaseHandle::updateKeyIndex()
+{
+    int         idx ;
+    IdxRecord   idxRec ;
+    size_t      numRecords = 0 ;
+
+    if ((keyIndex_ == NULL) || keyIndex_->isValid())
+        return ;
+
+    numRecords = (size_t) DB_IdxCount () ;
+
+    OFCondition cond = keyIndex_->beginRebuild (numRecords) ;
+    if (cond.good()) {
+        numRecords = 0 ;
+        DB_IdxInitLoop (&idx) ;
+        while (cond.good() && (DB_IdxGetNext (&idx, &idxRec) == EC_Normal)) {
+            cond = keyIndex_->addRecord (idx, idxRec) ;
+            numRecords++ ;
+        }
+        if (cond.good())
+            cond = keyIndex_->endRebuild () ;
+    }
+    if (cond.good())
+        DCMQRDB_INFO("rebuilt key index for " << numRecords << " records in " << handle_ -> storageArea);
+    else
+        DCMQRDB_WARN("unable to rebuild key index in " << handle_ -> storageArea << ", queries are processed without key index");
+}
+
+/******************************
+ *      Rebuild the study table from the index file if it is not valid
+ */
+
+void DcmQueryRetrieveIndexDatabaseHandle::updateStudyTable()
+{
+    if (studyTable_->isValid())
+        return ;
+
+    if (rebuildStudyTable ().good())
+        DCMQRDB_INFO("rebuilt study table for " << studyTable_->numberOfStudies() << " studies in " << handle_ -> storageArea);
+    else
+        DCMQRDB_WARN("unable to rebuild study table in " << handle_ -> storageArea);
+}
+
+/******************************
+ *      Rebuild the study table and the list of free records
+ */
+
+OFCondition DcmQueryRetrieveIndexDatabaseHandle::rebuildStudyTable()
+{
+    IdxRecord       idxRec ;
+    StudyDescRecord study ;
+    int             freeIdx = DB_NoFreeRecord ;
+    int             numRecords = DB_IdxCount () ;
+
+    OFCondition cond = studyTable_->beginRebuild (0) ;
+
+    /*** Visit the records in reverse order, so that free records
+    *** are reused in ascending order
+    **/
+
+    for (int idx = numRecords - 1 ; (idx >= 0) && cond.good() ; idx--) {
+        cond = DB_IdxRead (idx, &idxRec) ;
+        if (cond.bad())
+            break ;
+        if (idxRec. filename [0] == '\0') {
+            idxRec. ImageSize = freeIdx ;
+            cond = DB_IdxWrite (idx, &idxRec) ;
+            freeIdx = idx ;
+        }
+        else if (idxRec. StudyInstanceUID [0] != '\0') {
+            if (studyTable_->findStudy (idxRec. StudyInstanceUID, study) != EC_Normal) {
+                memset (&study, 0, sizeof (study)) ;
+                OFStandard::strlcpy (study. StudyInstanceUID, idxRec. StudyInstanceUID, sizeof (study. StudyInstanceUID)) ;
+            }
+            study. NumberofRegistratedImages++ ;
+            study. StudySize += idxRec. ImageSize ;
+            if (idxRec. RecordedDate > study. LastRecordedDate)
+                study. LastRecordedDate = idxRec. RecordedDate ;
+            cond = studyTable_->updateStudy (study) ;
+        }
+    }
+
+    if (cond.good())
+        cond = studyTable_->setFirstFreeRecord (freeIdx) ;
+    if (cond.good())
+        cond = studyTable_->endRebuild () ;
+    else
+        studyTable_->cancelRebuild () ;
+    return cond ;
+}
+
+/******************************
+ *      Look up candidate records in the key index
+ */
+
+OFCondition DcmQueryRetrieveIndexDatabaseHandle::lookupKeyIndex(const DcmTagKey &tag, const char *value, OFVector<int> &result)
+{
+    result.clear() ;
+    if ((keyIndex_ == NULL) || ! DcmQueryRetrieveKeyIndex::isSingleValue (tag, value) || ! keyIndex_->isValid())
+        return QR_EC_IndexDatabaseError ;
+    return keyIndex_->findRecords (tag, value, result) ;
+}
+
+/******************************
+ *      Select the records to be checked for a find or move request
+ */
+
+void DcmQueryRetrieveIndexDatabaseHandle::selectCandidateRecords(DB_LEVEL qLevel)
+{
+    DB_ElementList  *plist ;
+    DB_ElementList  *keyElem = NULL ;
+    DB_LEVEL        XTagLevel = PATIENT_LEVEL ;
+    DcmTagKey       uidTag ;
+    int             keyPriority = -1 ;
+    int             priority ;
+    OFString        value ;
+    OFVector<int>   candidates ;
+
+    DB_FreeCandidateList (handle_) ;
+    if (keyIndex_ == NULL)
+        return ;
+
+    /*** Find the most selective indexed key that is actually used
+    *** for matching by hierarchicalCompare()
+    **/
+
+    for (plist = handle_->findRequestList ; plist ; plist = plist->next) {
+        priority = DcmQueryRetrieveKeyIndex::keyPriority (plist->elem. XTag) ;
+        if ((priority < 0) || ((keyElem != NULL) && (priority >= keyPriority)))
+            continue ;
+        if ((plist->elem. PValueField == NULL) || (DB_GetTagLevel (plist->elem. XTag, &XTagLevel) != EC_Normal))
+            continue ;
+        if (XTagLevel == handle_->queryLevel)
+            ;
+        else if ((XTagLevel >= qLevel) && (XTagLevel < handle_->queryLevel)
+                 && (DB_GetUIDTag (XTagLevel, &uidTag) == EC_Normal) && (uidTag == plist->elem. XTag))
+            ;
+        else if ((XTagLevel == PATIENT_LEVEL) && (handle_->queryLevel == STUDY_LEVEL) && (qLevel == STUDY_LEVEL))
+            ;
+        else
+            continue ;
+        value.assign (plist->elem. PValueField, plist->elem. ValueLength) ;
+        if (! DcmQueryRetrieveKeyIndex::isSingleValue (plist->elem. XTag, value.c_str()))
+            continue ;
+        keyElem = plist ;
+        keyPriority = priority ;
+    }
+
+    if (keyElem == NULL)
+        return ;
+
+    value.assign (keyElem->elem. PValueField, keyElem->elem. ValueLength) ;
+    if (lookupKeyIndex (keyElem->elem. XTag, value.c_str(), candidates).bad())
+        return ;
+
+    if (! DB_SetCandidateList (handle_, candidates))
+        return ;
+    DCMQRDB_DEBUG("using key index for " << DcmTag(keyElem->elem. XTag).getTagName()
+        << ", " << candidates.size() << " candidate records");
+}
+
+/******************************
+ *      Rebuild the summary cache from the index file if it is outdated
+ */
+
+OFBool DcmQueryRetrieveIndexDatabaseHandle::updateSummaryCache(OFBool rebuild)
+{
+    int         idx ;
+    IdxRecord   idxRec ;
+    size_t      numRecords = 0 ;
+
+    /*** The generation counter is only reliable if the study table is valid
+    **/
+
+    if (! studyTable_->isValid ())
+        return OFFalse ;
+    Uint32 generation = studyTable_->generation () ;
+    if (summaryCache_->isCurrent (generation))
+        return OFTrue ;
+    if (! rebuild)
+        return OFFalse ;
+
+    DcmQueryRetrieveSummaryCache summary ;
+    DB_IdxInitLoop (&idx) ;
+    while (DB_IdxGetNext (&idx, &idxRec) == EC_Normal) {
+        summary. addRecord (idx, idxRec. StudyInstanceUID, idxRec. SeriesInstanceUID) ;
+        numRecords++ ;
+    }
+    summaryCache_->replace (summary, generation) ;
+    DCMQRDB_DEBUG("rebuilt summary cache for " << numRecords << " records in " << handle_ -> storageArea);
+    return OFTrue ;
+}
+
+/******************************
+ *      Select one record per study or series for a find request
+ */
+
+void DcmQueryRetrieveIndexDatabaseHandle::selectSummaryRecords()
+{
+    DB_ElementList  *plist ;
+    DB_CounterList  *pidxlist ;
+    const char      *studyUID = NULL ;
+    OFString        value ;
+    OFVector<int>   records ;
+    OFVector<int>   selected ;
+    OFBool          usable = OFFalse ;
+
+    if (! summaryCurrent_)
+        return ;
+
+    /*** Patient and study level queries only depend on attributes that
+    *** are identical for all records of a study, series level queries
+    *** only on attributes that are identical for all records of a series
+    **/
+
+    if ((handle_->queryLevel == PATIENT_LEVEL) || (handle_->queryLevel == STUDY_LEVEL))
+        usable = summaryCache_->getStudyRecords (records) ;
+    else if (handle_->queryLevel == SERIE_LEVEL) {
+        for (plist = handle_->findRequestList ; plist ; plist = plist->next) {
+            if ((plist->elem. XTag == DCM_StudyInstanceUID) && (plist->elem. PValueField != NULL)) {
+                value.assign (plist->elem. PValueField, plist->elem. ValueLength) ;
+                if (DcmQueryRetrieveKeyIndex::isSingleValue (DCM_StudyInstanceUID, value.c_str()))
+                    studyUID = value.c_str() ;
+            }
+        }
+        usable = summaryCache_->getSeriesRecords (studyUID, records) ;
+    }
+    if (! usable)
+        return ;
+
+    /*** Keep only those candidates found in the key index that
+    *** represent a study or series
+    **/
+
+    if (handle_->useCandidateList) {
+        for (pidxlist = handle_->candidateList ; pidxlist ; pidxlist = pidxlist->next) {
+            if (! records.empty() && bsearch (&(pidxlist->idxCounter), &records[0], records.size(), sizeof (int), DB_CompareRecordIndex))
+                selected.push_back (pidxlist->idxCounter) ;
+        }
+        records.swap (selected) ;
+    }
+
+    if (DB_SetCandidateList (handle_, records))
+        DCMQRDB_DEBUG("using summary cache, " << records.size() << " candidate records");
+}
+
+/******************************
+ *      Get next Index record to be checked for a find or move request
+ *      On return, idx is initialized with the index of the record read
+ */
+
+OFCondition DcmQueryRetrieveIndexDatabaseHandle::DB_IdxGetNextCandidate(int *idx, IdxRecord *idxRec)
+{
+    DB_CounterList *plist ;
+
+    if (! handle_->useCandidateList)
+        return DB_IdxGetNext (idx, idxRec) ;
+
+    while (handle_->candidateList) {
+        plist = handle_->candidateList ;
+        handle_->candidateList = plist->next ;
+        *idx = plist->idxCounter ;
+        free (plist) ;
+        if ((DB_IdxRead (*idx, idxRec) == EC_Normal) && (idxRec -> filename [0] != '\0'))
+            return EC_Normal ;
+    }
+
+    return QR_EC_IndexDatabaseError ;
+}
+
+/********************
+**      Find next matching record of a find request
+**/
+
+OFCondition DcmQueryRetrieveIndexDatabaseHandle::findNextMatch(DB_LEVEL qLevel, OFBool &matchFound)
+{
+    int                 MatchFound ;
+    IdxRecord           idxRec ;
+    size_t              numSeries = 0 ;
+    size_t              numInstances = 0 ;
+    OFCondition         cond = EC_Normal;
+
+    matchFound = OFFalse ;
+    while (DB_IdxGetNextCandidate (&(handle_->idxCounter), &idxRec) == EC_Normal) {
+
+        /*** Skip records for which a response has already been sent
+        **/
+
+        if (DB_UIDAlreadyFound (handle_, &idxRec))
+            continue ;
+
+        /*** The number of series and instances of the study is taken
+        *** from the summary cache rather than from the stored dataset
+        **/
+
+        if (summaryCurrent_ && (handle_->queryLevel != PATIENT_LEVEL)
+            && summaryCache_->getStudyCounts (idxRec. StudyInstanceUID, numSeries, numInstances)) {
+            sprintf (idxRec. NumberofStudyRelatedSeries, "%lu", (unsigned long) numSeries) ;
+            idxRec. param[RECORDIDX_NumberofStudyRelatedSeries]. ValueLength = strlen (idxRec. NumberofStudyRelatedSeries) ;
+            sprintf (idxRec. NumberofStudyRelatedInstances, "%lu", (unsigned long) numInstances) ;
+            idxRec. param[RECORDIDX_NumberofStudyRelatedInstances]. ValueLength = strlen (idxRec. NumberofStudyRelatedInstances) ;
+        }
+
+        MatchFound = OFFalse ;
+        cond = hierarchicalCompare (handle_, &idxRec, qLevel, qLevel, &MatchFound) ;
+        if (cond != EC_Normal)
+            return cond ;
+        if (MatchFound) {
+            DB_UIDAddFound (handle_, &idxRec) ;
+            makeResponseList (handle_, &idxRec) ;
+            matchFound = OFTrue ;
+            break ;
+        }
+    }
+    return cond ;
+}
+
+/********************
+**      Terminate a find request
+**/
+
+void DcmQueryRetrieveIndexDatabaseHandle::endFindRequest()
+{
+    handle_->idxCounter = -1 ;
+    summaryCurrent_ = OFFalse ;
+    DB_FreeCandidateList (handle_) ;
+    DB_FreeElementList (handle_->findRequestList) ;
+    handle_->findRequestList = NULL ;
+    DB_FreeUidList (handle_->uidList) ;
+    handle_->uidList = NULL ;
+}
+
 /********************
 **      Start find in Database
 **/
@@ -1616,11 +2333,10 @@ OFCondition DcmQueryRetrieveIndexDatabaseHandle::startFindRequest(
     DB_SmallDcmElmt     elem ;
     DB_ElementList      *plist = NULL;
     DB_ElementList      *last = NULL;
-    int                 MatchFound ;
-    IdxRecord           idxRec ;
     DB_LEVEL            qLevel = PATIENT_LEVEL; // highest legal level for a query in the current model
     DB_LEVEL            lLevel = IMAGE_LEVEL;   // lowest legal level for a query in the current model
 
+    OFBool              MatchFound = OFFalse;
     OFCondition         cond = EC_Normal;
     OFBool qrLevelFound = OFFalse;
 
@@ -1777,31 +2493,18 @@ OFCondition DcmQueryRetrieveIndexDatabaseHandle::startFindRequest(
     }
 
     /**** Goto the beginning of Index File
-    **** Then find the first matching image
+    **** Then find the first matching image.
+    **** The lock is only held while looking for the next match.
     ***/
 
-    DB_lock(OFFalse);
-
-    DB_IdxInitLoop (&(handle_->idxCounter)) ;
-    MatchFound = OFFalse ;
-    cond = EC_Normal ;
-
-    while (1) {
-
-        /*** Exit loop if read error (or end of file)
-        **/
-
-        if (DB_IdxGetNext (&(handle_->idxCounter), &idxRec) != EC_Normal)
-            break ;
-
-        /*** Exit loop if error or matching OK
-        **/
-
-        cond = hierarchicalCompare (handle_, &idxRec, qLevel, qLevel, &MatchFound) ;
-        if (cond != EC_Normal)
-            break ;
-        if (MatchFound)
-            break ;
+    cond = DB_lock(OFFalse);
+    if (cond == EC_Normal) {
+        DB_IdxInitLoop (&(handle_->idxCounter)) ;
+        summaryCurrent_ = updateSummaryCache (handle_->queryLevel != IMAGE_LEVEL) ;
+        selectCandidateRecords (qLevel) ;
+        selectSummaryRecords () ;
+        cond = findNextMatch (qLevel, MatchFound) ;
+        DB_unlock();
     }
 
     /**** If an error occurred in Matching function
@@ -1809,29 +2512,20 @@ OFCondition DcmQueryRetrieveIndexDatabaseHandle::startFindRequest(
     ***/
 
     if (cond != EC_Normal) {
-        handle_->idxCounter = -1 ;
-        DB_FreeElementList (handle_->findRequestList) ;
-        handle_->findRequestList = NULL ;
+        endFindRequest() ;
 #ifdef DEBUG
         DCMQRDB_DEBUG("DB_startFindRequest () : STATUS_FIND_Failed_UnableToProcess");
 #endif
         status->setStatus(STATUS_FIND_Failed_UnableToProcess);
-
-        DB_unlock();
-
         return (cond) ;
     }
 
-
     /**** If a matching image has been found,
-    ****         add index record to UID found list
-    ****    prepare Response List in handle
+    ****    the Response List has been prepared in handle
     ****    return status is pending
     ***/
 
     if (MatchFound) {
-        DB_UIDAddFound (handle_, &idxRec) ;
-        makeResponseList (handle_, &idxRec) ;
 #ifdef DEBUG
         DCMQRDB_DEBUG("DB_startFindRequest () : STATUS_Pending");
 #endif
@@ -1845,16 +2539,11 @@ OFCondition DcmQueryRetrieveIndexDatabaseHandle::startFindRequest(
     ***/
 
     else {
-        handle_->idxCounter = -1 ;
-        DB_FreeElementList (handle_->findRequestList) ;
-        handle_->findRequestList = NULL ;
+        endFindRequest() ;
 #ifdef DEBUG
         DCMQRDB_DEBUG("DB_startFindRequest () : STATUS_Success");
 #endif
         status->setStatus(STATUS_Success);
-
-        DB_unlock();
-
         return (EC_Normal) ;
     }
 
@@ -1870,10 +2559,9 @@ OFCondition DcmQueryRetrieveIndexDatabaseHandle::nextFindResponse (
 {
 
     DB_ElementList      *plist = NULL;
-    int                 MatchFound = OFFalse;
-    IdxRecord           idxRec ;
-    DB_LEVEL            qLevel = PATIENT_LEVEL;
     const char          *queryLevelString = NULL;
+    DB_LEVEL            qLevel = PATIENT_LEVEL;
+    OFBool              MatchFound = OFFalse;
     OFCondition         cond = EC_Normal;
 
     if (handle_->findResponseList == NULL) {
@@ -1882,9 +2570,6 @@ OFCondition DcmQueryRetrieveIndexDatabaseHandle::nextFindResponse (
 #endif
         *findResponseIdentifiers = NULL ;
         status->setStatus(STATUS_Success);
-
-        DB_unlock();
-
         return (EC_Normal) ;
     }
 
@@ -1947,9 +2632,6 @@ OFCondition DcmQueryRetrieveIndexDatabaseHandle::nextFindResponse (
 #endif
     }
     else {
-
-        DB_unlock();
-
         return (QR_EC_IndexDatabaseError) ;
     }
 
@@ -1959,88 +2641,41 @@ OFCondition DcmQueryRetrieveIndexDatabaseHandle::nextFindResponse (
     case PATIENT_STUDY: qLevel = PATIENT_LEVEL ;        break ;
     }
 
-    /***** Free the last response...
-    ****/
-
-    DB_FreeElementList (handle_->findResponseList) ;
-    handle_->findResponseList = NULL ;
-
-    /***** ... and find the next one
-    ****/
-
-    MatchFound = OFFalse ;
-    cond = EC_Normal ;
-
-    while (1) {
-
-        /*** Exit loop if read error (or end of file)
-        **/
-
-        if (DB_IdxGetNext (&(handle_->idxCounter), &idxRec) != EC_Normal)
-            break ;
-
-        /*** If Response already found
-        **/
-
-        if (DB_UIDAlreadyFound (handle_, &idxRec))
-            continue ;
-
-        /*** Exit loop if error or matching OK
-        **/
+    /***** Free the last response...
+    ****/
 
-        cond = hierarchicalCompare (handle_, &idxRec, qLevel, qLevel, &MatchFound) ;
-        if (cond != EC_Normal)
-            break ;
-        if (MatchFound)
-            break ;
+    DB_FreeElementList (handle_->findResponseList) ;
+    handle_->findResponseList = NULL ;
+
+    /***** ... and find the next one, holding the lock only while searching
+    ****/
 
+    cond = DB_lock(OFFalse);
+    if (cond == EC_Normal) {
+        summaryCurrent_ = updateSummaryCache (OFFalse) ;
+        cond = findNextMatch (qLevel, MatchFound) ;
+        DB_unlock();
     }
 
     /**** If an error occured in Matching function
-    ****    return status is pending
+    ****    return a failed status
     ***/
 
     if (cond != EC_Normal) {
-        handle_->idxCounter = -1 ;
-        DB_FreeElementList (handle_->findRequestList) ;
-        handle_->findRequestList = NULL ;
+        endFindRequest() ;
 #ifdef DEBUG
         DCMQRDB_DEBUG("DB_nextFindResponse () : STATUS_FIND_Failed_UnableToProcess");
 #endif
         status->setStatus(STATUS_FIND_Failed_UnableToProcess);
-
-        DB_unlock();
-
         return (cond) ;
     }
 
-    /**** If a matching image has been found
-    ****    add index records UIDs in found UID list
-    ****    prepare Response List in handle
-    ***/
-
-    if (MatchFound) {
-        DB_UIDAddFound (handle_, &idxRec) ;
-        makeResponseList (handle_, &idxRec) ;
-#ifdef DEBUG
-        DCMQRDB_DEBUG("DB_nextFindResponse () : STATUS_Pending");
-#endif
-        status->setStatus(STATUS_Pending);
-        return (EC_Normal) ;
-    }
-
-    /**** else no matching image has been found,
-    ****    free query identifiers list
+    /**** If no matching image has been found, free query identifiers list.
     **** Response list is null, so next call will return STATUS_Success
     ***/
 
-    else {
-        handle_->idxCounter = -1 ;
-        DB_FreeElementList (handle_->findRequestList) ;
-        handle_->findRequestList = NULL ;
-        DB_FreeUidList (handle_->uidList) ;
-        handle_->uidList = NULL ;
-    }
+    if (! MatchFound)
+        endFindRequest() ;
 
 #ifdef DEBUG
     DCMQRDB_DEBUG("DB_nextFindResponse () : STATUS_Pending");
@@ -2057,6 +2692,7 @@ OFCondition DcmQueryRetrieveIndexDatabaseHandle::cancelFindRequest (DcmQueryRetr
 {
 
     handle_->idxCounter = -1 ;
+    DB_FreeCandidateList (handle_) ;
     DB_FreeElementList (handle_->findRequestList) ;
     handle_->findRequestList = NULL ;
     DB_FreeElementList (handle_->findResponseList) ;
@@ -2065,9 +2701,6 @@ OFCondition DcmQueryRetrieveIndexDatabaseHandle::cancelFindRequest (DcmQueryRetr
     handle_->uidList = NULL ;
 
     status->setStatus(STATUS_FIND_Cancel_MatchingTerminatedDueToCancelRequest);
-
-    DB_unlock();
-
     return (EC_Normal) ;
 }
 
@@ -2202,8 +2835,8 @@ OFCondition DcmQueryRetrieveIndexDatabaseHandle::startMoveRequest(
     DB_SmallDcmElmt     elem ;
     DB_ElementList      *plist = NULL;
     DB_ElementList      *last = NULL;
-    DB_CounterList      *pidxlist = NULL;
-    DB_CounterList      *lastidxlist = NULL;
+    DB_MoveList         *pmovelist = NULL;
+    DB_MoveList         *lastmovelist = NULL;
     int                 MatchFound = OFFalse;
     IdxRecord           idxRec ;
     DB_LEVEL            qLevel = PATIENT_LEVEL; // highest legal level for a query in the current model
@@ -2377,21 +3010,29 @@ OFCondition DcmQueryRetrieveIndexDatabaseHandle::startMoveRequest(
     ***/
 
     MatchFound = OFFalse ;
-    handle_->moveCounterList = NULL ;
+    handle_->moveList = NULL ;
     handle_->NumberRemainOperations = 0 ;
 
-    /**** Find matching images
+    /**** Find matching images. The data needed for the sub-operations is
+    **** copied, so that the lock is not held while the images are sent.
     ***/
 
-    DB_lock(OFFalse);
+    cond = DB_lock(OFFalse);
+    if (cond != EC_Normal) {
+        DB_FreeElementList (handle_->findRequestList) ;
+        handle_->findRequestList = NULL ;
+        status->setStatus(STATUS_MOVE_Failed_UnableToProcess);
+        return (cond) ;
+    }
 
     DB_IdxInitLoop (&(handle_->idxCounter)) ;
+    selectCandidateRecords (qLevel) ;
     while (1) {
 
         /*** Exit loop if read error (or end of file)
         **/
 
-        if (DB_IdxGetNext (&(handle_->idxCounter), &idxRec) != EC_Normal)
+        if (DB_IdxGetNextCandidate (&(handle_->idxCounter), &idxRec) != EC_Normal)
             break ;
 
         /*** If matching found
@@ -2399,24 +3040,34 @@ OFCondition DcmQueryRetrieveIndexDatabaseHandle::startMoveRequest(
 
         cond = hierarchicalCompare (handle_, &idxRec, qLevel, qLevel, &MatchFound) ;
         if (MatchFound) {
-            pidxlist = (DB_CounterList *) malloc (sizeof( DB_CounterList ) ) ;
-            if (pidxlist == NULL) {
+            pmovelist = (DB_MoveList *) malloc (sizeof( DB_MoveList ) ) ;
+            if (pmovelist == NULL) {
+                DB_unlock();
+                DB_FreeCandidateList (handle_) ;
+                DB_FreeMoveList (handle_) ;
+                DB_FreeElementList (handle_->findRequestList) ;
+                handle_->findRequestList = NULL ;
                 status->setStatus(STATUS_FIND_Refused_OutOfResources);
                 return (QR_EC_IndexDatabaseError) ;
             }
 
-            pidxlist->next = NULL ;
-            pidxlist->idxCounter = handle_->idxCounter ;
+            pmovelist->next = NULL ;
+            OFStandard::strlcpy (pmovelist->SOPClassUID, idxRec.SOPClassUID, sizeof (pmovelist->SOPClassUID)) ;
+            OFStandard::strlcpy (pmovelist->SOPInstanceUID, idxRec.SOPInstanceUID, sizeof (pmovelist->SOPInstanceUID)) ;
+            OFStandard::strlcpy (pmovelist->filename, idxRec.filename, sizeof (pmovelist->filename)) ;
             handle_->NumberRemainOperations++ ;
-            if ( handle_->moveCounterList == NULL )
-                handle_->moveCounterList = lastidxlist = pidxlist ;
+            if ( handle_->moveList == NULL )
+                handle_->moveList = lastmovelist = pmovelist ;
             else {
-                lastidxlist->next = pidxlist ;
-                lastidxlist = pidxlist ;
+                lastmovelist->next = pmovelist ;
+                lastmovelist = pmovelist ;
             }
         }
     }
 
+    DB_unlock();
+
+    DB_FreeCandidateList (handle_) ;
     DB_FreeElementList (handle_->findRequestList) ;
     handle_->findRequestList = NULL ;
 
@@ -2443,9 +3094,6 @@ OFCondition DcmQueryRetrieveIndexDatabaseHandle::startMoveRequest(
         DCMQRDB_DEBUG("DB_startMoveRequest : STATUS_Success");
 #endif
         status->setStatus(STATUS_Success);
-
-        DB_unlock();
-
         return (EC_Normal) ;
     }
 
@@ -2459,44 +3107,29 @@ OFCondition DcmQueryRetrieveIndexDatabaseHandle::nextMoveResponse(
                 unsigned short  *numberOfRemainingSubOperations,
                 DcmQueryRetrieveDatabaseStatus  *status)
 {
-    IdxRecord           idxRec ;
-    DB_CounterList              *nextlist ;
+    DB_MoveList         *nextlist ;
 
     /**** If all matching images have been retrieved,
     ****    status is success
     ***/
 
-    if ( handle_->NumberRemainOperations <= 0 ) {
+    if ( handle_->NumberRemainOperations <= 0 || handle_->moveList == NULL ) {
         status->setStatus(STATUS_Success);
-
-        DB_unlock();
-
         return (EC_Normal) ;
     }
 
-    /**** Goto the next matching image number of Index File
+    /**** Take the next matching image determined by startMoveRequest()
     ***/
 
-    if (DB_IdxRead (handle_->moveCounterList->idxCounter, &idxRec) != EC_Normal) {
-#ifdef DEBUG
-        DCMQRDB_DEBUG("DB_nextMoveResponse : STATUS_MOVE_Failed_UnableToProcess");
-#endif
-        status->setStatus(STATUS_MOVE_Failed_UnableToProcess);
-
-        DB_unlock();
-
-        return (QR_EC_IndexDatabaseError) ;
-    }
-
-    strcpy (SOPClassUID, (char *) idxRec. SOPClassUID) ;
-    strcpy (SOPInstanceUID, (char *) idxRec. SOPInstanceUID) ;
-    strcpy (imageFileName, (char *) idxRec. filename) ;
+    strcpy (SOPClassUID, handle_->moveList->SOPClassUID) ;
+    strcpy (SOPInstanceUID, handle_->moveList->SOPInstanceUID) ;
+    strcpy (imageFileName, handle_->moveList->filename) ;
 
     *numberOfRemainingSubOperations = --handle_->NumberRemainOperations ;
 
-    nextlist = handle_->moveCounterList->next ;
-    free (handle_->moveCounterList) ;
-    handle_->moveCounterList = nextlist ;
+    nextlist = handle_->moveList->next ;
+    free (handle_->moveList) ;
+    handle_->moveList = nextlist ;
     status->setStatus(STATUS_Pending);
 #ifdef DEBUG
     DCMQRDB_DEBUG("DB_nextMoveResponse : STATUS_Pending");
@@ -2508,18 +3141,9 @@ OFCondition DcmQueryRetrieveIndexDatabaseHandle::nextMoveResponse(
 
 OFCondition DcmQueryRetrieveIndexDatabaseHandle::cancelMoveRequest (DcmQueryRetrieveDatabaseStatus *status)
 {
-    DB_CounterList *plist ;
-
-    while (handle_->moveCounterList) {
-        plist  = handle_->moveCounterList ;
-        handle_->moveCounterList = handle_->moveCounterList->next ;
-        free (plist) ;
-    }
+    DB_FreeMoveList (handle_) ;
 
     status->setStatus(STATUS_MOVE_Cancel_SubOperationsTerminatedDueToCancelIndication);
-
-    DB_unlock();
-
     return (EC_Normal) ;
 }
 
@@ -2532,6 +3156,22 @@ void DcmQueryRetrieveIndexDatabaseHandle::enableQuotaSystem(OFBool enable)
     quotaSystemEnabled = enable;
 }
 
+void DcmQueryRetrieveIndexDatabaseHandle::enableStoreJournal(OFBool enable)
+{
+#ifdef WITH_THREADS
+    storeJournalEnabled = enable;
+#else
+    if (enable) DCMQRDB_WARN("store journal not available without thread support");
+#endif
+}
+
+
+void DcmQueryRetrieveIndexDatabaseHandle::setSummaryCache(DcmQueryRetrieveSummaryCache *cache)
+{
+    summaryCache_ = (cache != NULL) ? cache : ownSummaryCache_;
+    summaryCurrent_ = OFFalse;
+}
+
 
 /*
 ** Image file deleting
@@ -2584,51 +3224,73 @@ OFCondition DcmQueryRetrieveIndexDatabaseHandle::deleteImageFile(char* imgFile)
 
 
 /*************************
-**   Delete oldest study in database
+**   Find all images of a study in database
  */
 
-int DcmQueryRetrieveIndexDatabaseHandle::deleteOldestStudy(StudyDescRecord *pStudyDesc)
+OFCondition DcmQueryRetrieveIndexDatabaseHandle::findStudyImages(const char *StudyUID, OFVector<ImagesofStudyArray> &images)
 {
-
-    int oldestStudy ;
-    double OldestDate ;
-    int s ;
-    int n ;
-    int idx = 0 ;
     IdxRecord idxRec ;
+    ImagesofStudyArray image ;
+    OFVector<int> candidates ;
+    size_t candidateIdx = 0 ;
+    int idx = -1 ;
 
-    oldestStudy = 0 ;
-    OldestDate = 0.0 ;
+    images.clear() ;
 
-#ifdef DEBUG
-    DCMQRDB_DEBUG("deleteOldestStudy");
-#endif
+    /* only check the records found in the key index, if available */
+    const OFBool useKeyIndex = lookupKeyIndex(DCM_StudyInstanceUID, StudyUID, candidates).good();
+    if (! useKeyIndex)
+        DB_IdxInitLoop (&idx) ;
 
-    for ( s = 0 ; s < handle_ -> maxStudiesAllowed ; s++ ) {
-        if ( ( pStudyDesc[s]. NumberofRegistratedImages != 0 ) &&
-            ( ( OldestDate == 0.0 ) || ( pStudyDesc[s]. LastRecordedDate < OldestDate ) ) ) {
-            OldestDate = pStudyDesc[s]. LastRecordedDate ;
-            oldestStudy = s ;
-        }
+    while (1) {
+
+    if (useKeyIndex) {
+        if (candidateIdx == candidates.size()) break;
+        idx = candidates[candidateIdx++];
+        if ((DB_IdxRead(idx, &idxRec) != EC_Normal) || (idxRec.filename[0] == '\0')) continue;
+    }
+    else if (DB_IdxGetNext(&idx, &idxRec) != EC_Normal) break;
+
+    if (strcmp(idxRec.StudyInstanceUID, StudyUID) == 0) {
+        image.idxCounter = idx ;
+        image.RecordedDate = idxRec.RecordedDate ;
+        image.ImageSize = idxRec.ImageSize ;
+        images.push_back(image) ;
     }
+    }
+    return EC_Normal ;
+}
+
+
+/*************************
+**   Delete oldest study in database
+ */
+
+OFCondition DcmQueryRetrieveIndexDatabaseHandle::deleteOldestStudy()
+{
+
+    StudyDescRecord study ;
+    OFVector<ImagesofStudyArray> images ;
+    IdxRecord idxRec ;
+
+    if (studyTable_->findOldestStudy(study) != EC_Normal)
+        return QR_EC_IndexDatabaseError ;
 
 #ifdef DEBUG
-    DCMQRDB_DEBUG("deleteOldestStudy oldestStudy = " << oldestStudy);
+    DCMQRDB_DEBUG("deleteOldestStudy oldestStudy = " << study.StudyInstanceUID);
 #endif
 
-    n = strlen(pStudyDesc[oldestStudy].StudyInstanceUID) ;
-    while ( DB_IdxRead (idx, &idxRec) == EC_Normal ) {
-
-    if ( ! ( strncmp(idxRec. StudyInstanceUID, pStudyDesc[oldestStudy].StudyInstanceUID, n) ) ) {
-        DB_IdxRemove (idx) ;
-        deleteImageFile(idxRec.filename);
-    }
-    idx++ ;
+    findStudyImages(study.StudyInstanceUID, images) ;
+    for (size_t i = 0 ; i < images.size() ; i++) {
+        if (DB_IdxRead(images[i].idxCounter, &idxRec) == EC_Normal) {
+            DB_IdxRemove (images[i].idxCounter) ;
+            deleteImageFile(idxRec.filename);
+        }
     }
 
-    pStudyDesc[oldestStudy].NumberofRegistratedImages = 0 ;
-    pStudyDesc[oldestStudy].StudySize = 0 ;
-    return(oldestStudy) ;
+    study.NumberofRegistratedImages = 0 ;
+    study.StudySize = 0 ;
+    return studyTable_->updateStudy(study) ;
 }
 
 
@@ -2638,47 +3300,32 @@ int DcmQueryRetrieveIndexDatabaseHandle::deleteOldestStudy(StudyDescRecord *pStu
 **   Delete oldest images in database
  */
 
-OFCondition DcmQueryRetrieveIndexDatabaseHandle::deleteOldestImages(StudyDescRecord *pStudyDesc, int StudyNum, char *StudyUID, long RequiredSize)
+OFCondition DcmQueryRetrieveIndexDatabaseHandle::deleteOldestImages(StudyDescRecord &study, long RequiredSize)
 {
 
-    ImagesofStudyArray *StudyArray ;
-    IdxRecord idxRec ;
-    int nbimages = 0 , s = 0 , n ;
+    OFVector<ImagesofStudyArray> StudyArray ;
+    size_t s = 0 ;
     long DeletedSize ;
 
 #ifdef DEBUG
     DCMQRDB_DEBUG("deleteOldestImages RequiredSize = " << RequiredSize);
 #endif
-    n = strlen(StudyUID) ;
-    StudyArray = (ImagesofStudyArray *)malloc(MAX_NUMBER_OF_IMAGES * sizeof(ImagesofStudyArray)) ;
-
-    if (StudyArray == NULL) {
-        DCMQRDB_WARN("deleteOldestImages: out of memory");
-        return QR_EC_IndexDatabaseError;
-    }
 
     /** Find all images having the same StudyUID
      */
 
-    DB_IdxInitLoop (&(handle_ -> idxCounter)) ;
-    while ( DB_IdxGetNext(&(handle_ -> idxCounter), &idxRec) == EC_Normal ) {
-    if ( ! ( strncmp(idxRec. StudyInstanceUID, StudyUID, n) ) ) {
-
-        StudyArray[nbimages]. idxCounter = handle_ -> idxCounter ;
-        StudyArray[nbimages]. RecordedDate = idxRec. RecordedDate ;
-        StudyArray[nbimages++]. ImageSize = idxRec. ImageSize ;
-    }
-    }
+    findStudyImages(study.StudyInstanceUID, StudyArray) ;
 
     /** Sort the StudyArray in order to have the oldest images first
      */
-    qsort((char *)StudyArray, nbimages, sizeof(ImagesofStudyArray), DB_Compare) ;
+    if (StudyArray.size() > 1)
+        qsort((char *)&StudyArray[0], StudyArray.size(), sizeof(ImagesofStudyArray), DB_Compare) ;
 
 #ifdef DEBUG
     {
-        int i ;
+        size_t i ;
         DCMQRDB_DEBUG("deleteOldestImages : Sorted images ref array");
-        for (i = 0 ; i < nbimages ; i++)
+        for (i = 0 ; i < StudyArray.size() ; i++)
             DCMQRDB_DEBUG("[" << STD_NAMESPACE setw(2) << i << "] :   Size " << StudyArray[i].ImageSize
                 << "   Date " << STD_NAMESPACE setw(20) << STD_NAMESPACE setprecision(3) << StudyArray[i].RecordedDate
                 << "   Ref " << StudyArray[i].idxCounter);
@@ -2689,7 +3336,7 @@ OFCondition DcmQueryRetrieveIndexDatabaseHandle::deleteOldestImages(StudyDescRec
     s = 0 ;
     DeletedSize = 0 ;
 
-    while ( DeletedSize < RequiredSize ) {
+    while ( ( DeletedSize < RequiredSize ) && ( s < StudyArray.size() ) ) {
 
     IdxRecord idxRemoveRec ;
     DB_IdxRead (StudyArray[s]. idxCounter, &idxRemoveRec) ;
@@ -2699,70 +3346,37 @@ OFCondition DcmQueryRetrieveIndexDatabaseHandle::deleteOldestImages(StudyDescRec
     deleteImageFile(idxRemoveRec.filename);
 
     DB_IdxRemove (StudyArray[s]. idxCounter) ;
-    pStudyDesc[StudyNum].NumberofRegistratedImages -= 1 ;
-    pStudyDesc[StudyNum].StudySize -= StudyArray[s]. ImageSize ;
+    study.NumberofRegistratedImages -= 1 ;
+    study.StudySize -= StudyArray[s]. ImageSize ;
     DeletedSize += StudyArray[s++]. ImageSize ;
     }
 
 #ifdef DEBUG
     DCMQRDB_DEBUG("deleteOldestImages DeletedSize = " << (int)DeletedSize);
 #endif
-    free(StudyArray) ;
     return( EC_Normal ) ;
 
 }
 
 
-
-/*************************
- *   Verify if study UID already exists
- *   If the study UID exists, its index in the study descriptor is returned.
- *   If the study UID does not exist, the index of the first unused descriptor entry is returned.
- *   If no entries are free, maxStudiesAllowed is returned.
- */
-
-int DcmQueryRetrieveIndexDatabaseHandle::matchStudyUIDInStudyDesc (StudyDescRecord *pStudyDesc, char *StudyUID, int maxStudiesAllowed)
-{
-    int s = 0 ;
-    while  (s < maxStudiesAllowed)
-    {
-      if ((pStudyDesc[s].NumberofRegistratedImages > 0) && (0 == strcmp(pStudyDesc[s].StudyInstanceUID, StudyUID))) break;
-      s++ ;
-    }
-    if (s==maxStudiesAllowed) // study uid does not exist, look for free descriptor
-    {
-      s=0;
-      while  (s < maxStudiesAllowed)
-      {
-        if (pStudyDesc[s].NumberofRegistratedImages == 0) break;
-        s++ ;
-      }
-    }
-    return s;
-}
-
-
 /*************************
 **  Check up storage rights in Study Desk record
  */
 
-OFCondition DcmQueryRetrieveIndexDatabaseHandle::checkupinStudyDesc(StudyDescRecord *pStudyDesc, char *StudyUID, long imageSize)
+OFCondition DcmQueryRetrieveIndexDatabaseHandle::checkupinStudyDesc(const char *StudyUID, long imageSize)
 {
-    int         s ;
+    StudyDescRecord study ;
     long        RequiredSize ;
 
-    s = matchStudyUIDInStudyDesc (pStudyDesc, StudyUID,
-                     (int)(handle_ -> maxStudiesAllowed)) ;
-
     /** If Study already exists
      */
 
-    if ( pStudyDesc[s]. NumberofRegistratedImages != 0 ) {
+    if ( studyTable_->findStudy(StudyUID, study) == EC_Normal ) {
 
 #ifdef DEBUG
-    DCMQRDB_DEBUG("checkupinStudyDesc: study already exists : " << s) ;
+    DCMQRDB_DEBUG("checkupinStudyDesc: study already exists : " << StudyUID) ;
 #endif
-    if ( ( pStudyDesc[s]. StudySize + imageSize )
+    if ( ( study. StudySize + imageSize )
          > handle_ -> maxBytesPerStudy ) {
         if ( imageSize > handle_ -> maxBytesPerStudy ) {
 #ifdef DEBUG
@@ -2772,8 +3386,8 @@ OFCondition DcmQueryRetrieveIndexDatabaseHandle::checkupinStudyDesc(StudyDescRec
         }
 
         RequiredSize = imageSize -
-            ( handle_ -> maxBytesPerStudy - pStudyDesc[s]. StudySize ) ;
-        deleteOldestImages(pStudyDesc, s, StudyUID, RequiredSize) ;
+            ( handle_ -> maxBytesPerStudy - study. StudySize ) ;
+        deleteOldestImages(study, RequiredSize) ;
     }
 
 
@@ -2788,26 +3402,31 @@ OFCondition DcmQueryRetrieveIndexDatabaseHandle::checkupinStudyDesc(StudyDescRec
 #endif
         return ( QR_EC_IndexDatabaseError ) ;
     }
-    if ( s > ( handle_ -> maxStudiesAllowed - 1 ) )
-        s = deleteOldestStudy(pStudyDesc) ;
+    if ( ! studyTable_->isValid() )
+        return ( QR_EC_IndexDatabaseError ) ;
+
+    /* a negative maximum number of studies means no limit */
+    while ( ( handle_ -> maxStudiesAllowed >= 0 ) &&
+            ( studyTable_->numberOfStudies() >= (size_t)( handle_ -> maxStudiesAllowed ) ) ) {
+        if ( deleteOldestStudy() != EC_Normal )
+            break ;
+    }
 
+    memset(&study, 0, sizeof(study)) ;
+    OFStandard::strlcpy(study.StudyInstanceUID, StudyUID, sizeof(study.StudyInstanceUID)) ;
     }
 
-    pStudyDesc[s]. StudySize += imageSize ;
+    study. StudySize += imageSize ;
 #ifdef DEBUG
-    DCMQRDB_DEBUG("checkupinStudyDesc: ~~~~~~~~ StudySize = " << pStudyDesc[s]. StudySize);
+    DCMQRDB_DEBUG("checkupinStudyDesc: ~~~~~~~~ StudySize = " << study. StudySize);
 #endif
 
     /* we only have second accuracy */
-    pStudyDesc[s]. LastRecordedDate =  (double) time(NULL);
+    study. LastRecordedDate =  (double) time(NULL);
 
-    pStudyDesc[s]. NumberofRegistratedImages++ ;
-    strcpy(pStudyDesc[s].StudyInstanceUID,StudyUID) ;
+    study. NumberofRegistratedImages++ ;
 
-    if ( DB_StudyDescChange (pStudyDesc) == EC_Normal)
-        return ( EC_Normal ) ;
-    else
-        return ( QR_EC_IndexDatabaseError ) ;
+    return studyTable_->updateStudy(study) ;
 }
 
 /*
@@ -2816,24 +3435,33 @@ OFCondition DcmQueryRetrieveIndexDatabaseHandle::checkupinStudyDesc(StudyDescRec
  */
 OFCondition DcmQueryRetrieveIndexDatabaseHandle::removeDuplicateImage(
     const char *SOPInstanceUID, const char *StudyInstanceUID,
-    StudyDescRecord *pStudyDesc, const char *newImageFileName)
+    const char *newImageFileName)
 {
 
     int idx = 0;
     IdxRecord idxRec ;
-    int studyIdx = 0;
-
-    studyIdx = matchStudyUIDInStudyDesc (pStudyDesc, (char*)StudyInstanceUID,
-                        (int)(handle_ -> maxStudiesAllowed)) ;
+    StudyDescRecord study ;
+    OFVector<int> candidates ;
+    size_t candidateIdx = 0 ;
 
-    if ( pStudyDesc[studyIdx].NumberofRegistratedImages == 0 ) {
+    if ( studyTable_->findStudy(StudyInstanceUID, study) != EC_Normal ) {
     /* no study images, cannot be any old images */
     return EC_Normal;
     }
 
-    while (DB_IdxRead(idx, &idxRec) == EC_Normal) {
+    /* only check the records found in the key index, if available */
+    const OFBool useKeyIndex = lookupKeyIndex(DCM_SOPInstanceUID, SOPInstanceUID, candidates).good();
 
-    if (strcmp(idxRec.SOPInstanceUID, SOPInstanceUID) == 0) {
+    while (1) {
+
+    if (useKeyIndex) {
+        if (candidateIdx == candidates.size()) break;
+        idx = candidates[candidateIdx++];
+        if (DB_IdxRead(idx, &idxRec) != EC_Normal) continue;
+    }
+    else if (DB_IdxRead(idx, &idxRec) != EC_Normal) break;
+
+    if ((idxRec.filename[0] != '\0') && (strcmp(idxRec.SOPInstanceUID, SOPInstanceUID) == 0)) {
 
 #ifdef DEBUG
         DCMQRDB_DEBUG("--- Removing Existing DB Image Record: " << idxRec.filename);
@@ -2846,13 +3474,16 @@ OFCondition DcmQueryRetrieveIndexDatabaseHandle::removeDuplicateImage(
         if (strcmp(idxRec.filename, newImageFileName) != 0) {
             deleteImageFile(idxRec.filename);
         }
-        /* update the study info */
-        pStudyDesc[studyIdx].NumberofRegistratedImages--;
-        pStudyDesc[studyIdx].StudySize -= idxRec.ImageSize;
+        /* update the info of the study the image belonged to */
+        if (studyTable_->findStudy(idxRec.StudyInstanceUID, study) == EC_Normal) {
+            study.NumberofRegistratedImages--;
+            study.StudySize -= idxRec.ImageSize;
+            if (study.StudySize < 0) study.StudySize = 0;
+            studyTable_->updateStudy(study);
+        }
     }
     idx++;
     }
-    /* the study record should be written to file later */
     return EC_Normal;
 }
 
@@ -2863,15 +3494,86 @@ OFCondition DcmQueryRetrieveIndexDatabaseHandle::removeDuplicateImage(
 
 OFCondition DcmQueryRetrieveIndexDatabaseHandle::storeRequest (
     const char  *SOPClassUID,
-    const char  * /*SOPInstanceUID*/,
+    const char  *SOPInstanceUID,
     const char  *imageFileName,
     DcmQueryRetrieveDatabaseStatus *status,
     OFBool      isNew)
 {
     IdxRecord        idxRec ;
-    StudyDescRecord  *pStudyDesc ;
+
+#ifdef WITH_THREADS
+    if (storeJournalEnabled) {
+        /* the object is registered later by the background thread of the journal */
+        DcmQueryRetrieveStoreJournal *journal = DcmQueryRetrieveStoreJournal::getJournal(
+            handle_ -> storageArea, handle_ -> maxStudiesAllowed, handle_ -> maxBytesPerStudy, quotaSystemEnabled);
+        if (journal != NULL) {
+            OFCondition cond = journal->append(SOPClassUID, SOPInstanceUID, imageFileName, isNew);
+            status->setStatus(cond.good() ? STATUS_Success : STATUS_STORE_Refused_OutOfResources);
+            return cond;
+        }
+        /* store synchronously if the journal is not available */
+    }
+#else
+    (void) SOPInstanceUID;
+#endif
+
+    OFCondition cond = makeIdxRecord(SOPClassUID, imageFileName, isNew, idxRec, status);
+    if (cond.good()) {
+        /**** Goto the end of IndexFile, and write the record
+        ***/
+
+        DB_lock(OFTrue);
+        cond = addIdxRecord(idxRec, status);
+        DB_unlock();
+    }
+    return cond;
+}
+
+OFCondition DcmQueryRetrieveIndexDatabaseHandle::storeRequests(OFVector<DcmQueryRetrieveStoreRequest> &requests)
+{
+    OFCondition result = EC_Normal;
+    OFVector<IdxRecord *> records(requests.size(), OFstatic_cast(IdxRecord *, NULL));
+
+    /* parse all files before the index file is locked */
+    for (size_t n = 0; n < requests.size(); ++n) {
+        DcmQueryRetrieveDatabaseStatus dbStatus(STATUS_Success);
+        records[n] = new IdxRecord;
+        if (makeIdxRecord(requests[n].sopClassUID.c_str(), requests[n].fileName.c_str(),
+            requests[n].isNew, *records[n], &dbStatus).bad()) {
+            delete records[n];
+            records[n] = NULL;
+        }
+        requests[n].status = dbStatus.status();
+    }
+
+    if (DB_lock(OFTrue).bad()) {
+        result = QR_EC_IndexDatabaseError;
+    }
+    for (size_t n = 0; n < requests.size(); ++n) {
+        if (records[n] != NULL) {
+            if (result.good()) {
+                DcmQueryRetrieveDatabaseStatus dbStatus(STATUS_Success);
+                addIdxRecord(*records[n], &dbStatus);
+                requests[n].status = dbStatus.status();
+            } else {
+                requests[n].status = STATUS_STORE_Refused_OutOfResources;
+            }
+            delete records[n];
+        }
+        if (requests[n].status != STATUS_Success) result = QR_EC_IndexDatabaseError;
+    }
+    DB_unlock();
+    return result;
+}
+
+OFCondition DcmQueryRetrieveIndexDatabaseHandle::makeIdxRecord(
+    const char  *SOPClassUID,
+    const char  *imageFileName,
+    OFBool      isNew,
+    IdxRecord   &idxRec,
+    DcmQueryRetrieveDatabaseStatus *status)
+{
     int              i ;
-    struct stat      stat_buf ;
 
     /**** Initialize an IdxRecord
     ***/
@@ -3020,23 +3722,15 @@ OFCondition DcmQueryRetrieveIndexDatabaseHandle::storeRequest (
     DCMQRDB_DEBUG("-- END Parameters to Register in DB");
 #endif
 
-    /**** Goto the end of IndexFile, and write the record
-    ***/
-
-    DB_lock(OFTrue);
-
-    pStudyDesc = (StudyDescRecord *)malloc (SIZEOF_STUDYDESC) ;
-    if (pStudyDesc == NULL) {
-      DCMQRDB_ERROR("DB_storeRequest: out of memory");
-      status->setStatus(STATUS_STORE_Refused_OutOfResources);
-      DB_unlock();
-      return (QR_EC_IndexDatabaseError) ;
-    }
+    return EC_Normal;
+}
 
-    bzero((char *)pStudyDesc, SIZEOF_STUDYDESC);
-    DB_GetStudyDesc(pStudyDesc) ;
+OFCondition DcmQueryRetrieveIndexDatabaseHandle::addIdxRecord(IdxRecord &idxRec, DcmQueryRetrieveDatabaseStatus *status)
+{
+    int              i ;
+    struct stat      stat_buf ;
 
-    stat(imageFileName, &stat_buf) ;
+    stat(idxRec.filename, &stat_buf) ;
     idxRec. ImageSize = (int)(stat_buf. st_size) ;
 
     /* we only have second accuracy */
@@ -3048,31 +3742,26 @@ OFCondition DcmQueryRetrieveIndexDatabaseHandle::storeRequest (
      */
 
     removeDuplicateImage(idxRec.SOPInstanceUID,
-                idxRec.StudyInstanceUID, pStudyDesc,
-                imageFileName);
+                idxRec.StudyInstanceUID,
+                idxRec.filename);
 
 
-    if ( checkupinStudyDesc(pStudyDesc, idxRec. StudyInstanceUID, idxRec. ImageSize) != EC_Normal ) {
-        free (pStudyDesc) ;
+    if ( checkupinStudyDesc(idxRec. StudyInstanceUID, idxRec. ImageSize) != EC_Normal ) {
         status->setStatus(STATUS_STORE_Refused_OutOfResources);
 
-        DB_unlock();
-
         return (QR_EC_IndexDatabaseError) ;
     }
 
-    free (pStudyDesc) ;
-
-    if (DB_IdxAdd (handle_, &i, &idxRec) == EC_Normal)
+    if (DB_IdxAdd (&i, &idxRec) == EC_Normal)
     {
+        /* an invalid key index is rebuilt by the next writer */
+        if (keyIndex_) keyIndex_->addRecord(i, idxRec);
         status->setStatus(STATUS_Success);
-        DB_unlock();
         return (EC_Normal) ;
     }
     else
     {
         status->setStatus(STATUS_STORE_Refused_OutOfResources);
-        DB_unlock();
     }
     return QR_EC_IndexDatabaseError;
 }
@@ -3085,57 +3774,26 @@ OFCondition DcmQueryRetrieveIndexDatabaseHandle::pruneInvalidRecords()
 {
     int idx = 0;
     IdxRecord idxRec ;
-    StudyDescRecord *pStudyDesc;
 
     DB_lock(OFTrue);
 
-    pStudyDesc = (StudyDescRecord *)malloc (SIZEOF_STUDYDESC) ;
-    if (pStudyDesc == NULL) {
-      DCMQRDB_WARN("DB_pruneInvalidRecords: out of memory");
-      DB_unlock();
-      return (QR_EC_IndexDatabaseError) ;
-    }
-
-    for (int i = 0 ; i < handle_ -> maxStudiesAllowed ; i++ )
-      pStudyDesc[i]. NumberofRegistratedImages = 0 ;
-
-    DB_GetStudyDesc(pStudyDesc) ;
-
     while (DB_IdxRead(idx, &idxRec) == EC_Normal)
     {
-      if (access(idxRec.filename, R_OK) < 0)
+      if ((idxRec.filename[0] != '\0') && (access(idxRec.filename, R_OK) < 0))
       {
 #ifdef DEBUG
         DCMQRDB_DEBUG("*** Pruning Invalid DB Image Record: " << idxRec.filename);
 #endif
-        /* update the study info */
-        int studyIdx = matchStudyUIDInStudyDesc(pStudyDesc, idxRec.StudyInstanceUID, (int)(handle_->maxStudiesAllowed)) ;
-        if (studyIdx < handle_->maxStudiesAllowed)
-        {
-          if (pStudyDesc[studyIdx].NumberofRegistratedImages > 0)
-          {
-            pStudyDesc[studyIdx].NumberofRegistratedImages--;
-          } else {
-            pStudyDesc[studyIdx].NumberofRegistratedImages = 0;
-            pStudyDesc[studyIdx].StudySize = 0;
-            pStudyDesc[studyIdx].StudyInstanceUID[0] = '\0';
-          }
-          if (pStudyDesc[studyIdx].StudySize > idxRec.ImageSize)
-          {
-            pStudyDesc[studyIdx].StudySize -= idxRec.ImageSize;
-          }
-        }
-
         /* remove the idx record  */
         DB_IdxRemove (idx);
       }
       idx++;
     }
 
-    DB_StudyDescChange (pStudyDesc);
+    /* recompute the study descriptors from the remaining records */
+    OFCondition cond = rebuildStudyTable();
     DB_unlock();
-    free (pStudyDesc) ;
-    return EC_Normal;
+    return cond;
 }
 
 
@@ -3151,31 +3809,23 @@ void DcmQueryRetrieveIndexDatabaseHandle::printIndexFile (char *storeArea)
     int i ;
     int j ;
     IdxRecord           idxRec ;
-    StudyDescRecord     *pStudyDesc;
+    OFVector<StudyDescRecord> studies;
 
     OFCondition result;
     DcmQueryRetrieveIndexDatabaseHandle handle(storeArea, -1, -1, result);
     if (result.bad()) return;
 
-    pStudyDesc = (StudyDescRecord *)malloc (SIZEOF_STUDYDESC) ;
-    if (pStudyDesc == NULL) {
-        DCMQRDB_ERROR("printIndexFile: out of memory");
-        return;
-    }
-
     handle.DB_lock(OFFalse);
 
-    handle.DB_GetStudyDesc(pStudyDesc);
+    handle.studyTable_->getStudies(studies);
 
-    for (i=0; i<handle.handle_->maxStudiesAllowed; i++) {
-        if (pStudyDesc[i].NumberofRegistratedImages != 0 ) {
-            COUT << "******************************************************" << OFendl
-                << "STUDY DESCRIPTOR: " << i << OFendl
-                << "  Study UID: " << pStudyDesc[i].StudyInstanceUID << OFendl
-                << "  StudySize: " << pStudyDesc[i].StudySize << OFendl
-                << "  LastRecDate: " << pStudyDesc[i].LastRecordedDate << OFendl
-                << "  NumOfImages: " << pStudyDesc[i].NumberofRegistratedImages << OFendl;
-        }
+    for (i=0; i<OFstatic_cast(int, studies.size()); i++) {
+        COUT << "******************************************************" << OFendl
+            << "STUDY DESCRIPTOR: " << i << OFendl
+            << "  Study UID: " << studies[i].StudyInstanceUID << OFendl
+            << "  StudySize: " << studies[i].StudySize << OFendl
+            << "  LastRecDate: " << studies[i].LastRecordedDate << OFendl
+            << "  NumOfImages: " << studies[i].NumberofRegistratedImages << OFendl;
     }
 
     handle.DB_IdxInitLoop (&j) ;
@@ -3216,6 +3866,7 @@ OFBool DcmQueryRetrieveIndexDatabaseHandle::findSOPInstance(const char *storeAre
 {
     int j ;
     IdxRecord           idxRec ;
+    OFVector<int>       candidates ;
 
     OFCondition result;
     OFBool Found = OFFalse;
@@ -3227,6 +3878,19 @@ OFBool DcmQueryRetrieveIndexDatabaseHandle::findSOPInstance(const char *storeAre
 
     handle.DB_lock(OFFalse);
 
+    /* only check the records found in the key index, if available */
+    if (handle.lookupKeyIndex(DCM_SOPInstanceUID, sopInstanceUID.c_str(), candidates).good())
+    {
+        for (size_t i = 0; (i < candidates.size()) && !Found; i++)
+        {
+            if ((handle.DB_IdxRead(candidates[i], &idxRec) == EC_Normal) && (idxRec.filename[0] != '\0') &&
+                sopClassUID.compare(idxRec.SOPClassUID)==0 && sopInstanceUID.compare(idxRec.SOPInstanceUID)==0)
+                Found = OFTrue;
+        }
+        handle.DB_unlock();
+        return Found;
+    }
+
     handle.DB_IdxInitLoop (&j) ;
     while (1) {
         if (handle.DB_IdxGetNext(&j, &idxRec) != EC_Normal)
@@ -3272,7 +3936,14 @@ DcmQueryRetrieveIndexDatabaseHandle::DcmQueryRetrieveIndexDatabaseHandle(
     long maxBytesPerStudy,
     OFCondition& result)
 : handle_(NULL)
+, keyIndex_(NULL)
+, studyTable_(NULL)
+, compactIndex_(NULL)
+, ownSummaryCache_(new DcmQueryRetrieveSummaryCache)
+, summaryCache_(ownSummaryCache_)
+, summaryCurrent_(OFFalse)
 , quotaSystemEnabled(OFTrue)
+, storeJournalEnabled(OFFalse)
 , doCheckFindIdentifier(OFFalse)
 , doCheckMoveIdentifier(OFFalse)
 , fnamecreator()
@@ -3286,14 +3957,9 @@ DcmQueryRetrieveIndexDatabaseHandle::DcmQueryRetrieveIndexDatabaseHandle(
             << " maxBytesPerStudy: " << maxBytesPerStudy);
 #endif
 
-    /* check maximum number of studies for valid value */
+    /* a negative maximum number of studies means that there is no limit */
     if (maxStudiesPerStorageArea < 0) {
-        maxStudiesPerStorageArea = DB_UpperMaxStudies;
-    }
-    else if (maxStudiesPerStorageArea > DB_UpperMaxStudies) {
-        DCMQRDB_WARN("maxStudiesPerStorageArea too large" << OFendl
-            << "        setting to " << DB_UpperMaxStudies);
-        maxStudiesPerStorageArea = DB_UpperMaxStudies;
+        maxStudiesPerStorageArea = -1;
     }
     /* check maximum study size for valid value value */
     if (maxBytesPerStudy < 0) {
@@ -3338,6 +4004,51 @@ DcmQueryRetrieveIndexDatabaseHandle::DcmQueryRetrieveIndexDatabaseHandle(
             handle_ -> maxStudiesAllowed = maxStudiesPerStorageArea;
             handle_ -> uidList = NULL;
             result = EC_Normal;
+
+            /* new index files are created in compact format, index files in
+             * the original format are used as they are until converted
+             */
+            if ((DB_lseek (handle_ -> pidx, 0L, SEEK_END) == 0) ||
+                DcmQueryRetrieveCompactIndex::isCompactFile(handle_ -> pidx))
+            {
+                OFString heapFilename(storageArea);
+                heapFilename += PATH_SEPARATOR;
+                heapFilename += DBHEAPFILE;
+                compactIndex_ = new DcmQueryRetrieveCompactIndex;
+                if (compactIndex_->open(handle_ -> pidx, heapFilename.c_str()).bad())
+                {
+                    DCMQRDB_ERROR("unable to open index file " << handle_ -> indexFilename);
+                    result = QR_EC_IndexDatabaseError;
+                    return;
+                }
+                if (compactIndex_->conversionPending())
+                    DCMQRDB_WARN("conversion of index file " << handle_ -> indexFilename << " has not been completed");
+            }
+            DB_lseek (handle_ -> pidx, 0L, SEEK_SET);
+
+            /* open study table file, which is required for storing images */
+            OFString studyTableFilename(storageArea);
+            studyTableFilename += PATH_SEPARATOR;
+            studyTableFilename += DBSTUDYFILE;
+            studyTable_ = new DcmQueryRetrieveStudyTable;
+            if (studyTable_->open(studyTableFilename.c_str()).bad())
+            {
+                DCMQRDB_ERROR("unable to open study table file " << studyTableFilename);
+                result = QR_EC_IndexDatabaseError;
+                return;
+            }
+
+            /* open key index file, queries are processed without it if this fails */
+            OFString keyIndexFilename(storageArea);
+            keyIndexFilename += PATH_SEPARATOR;
+            keyIndexFilename += DBKEYINDEXFILE;
+            keyIndex_ = new DcmQueryRetrieveKeyIndex;
+            if (keyIndex_->open(keyIndexFilename.c_str()).bad())
+            {
+                DCMQRDB_WARN("unable to open key index file " << keyIndexFilename << ", processing queries without key index");
+                delete keyIndex_;
+                keyIndex_ = NULL;
+            }
             return;
         }
     }
@@ -3369,10 +4080,16 @@ DcmQueryRetrieveIndexDatabaseHandle::~DcmQueryRetrieveIndexDatabaseHandle()
       /* Free lists */
       DB_FreeElementList (handle_ -> findRequestList);
       DB_FreeElementList (handle_ -> findResponseList);
+      DB_FreeMoveList (handle_);
       DB_FreeUidList (handle_ -> uidList);
+      DB_FreeCandidateList (handle_);
 
       delete handle_;
     }
+    delete keyIndex_;
+    delete studyTable_;
+    delete compactIndex_;
+    delete ownSummaryCache_;
 }
 
 /**********************************
@@ -3418,9 +4135,7 @@ OFCondition DcmQueryRetrieveIndexDatabaseHandle::instanceReviewed(int idx)
       if (result.bad()) return result;
 
       record.hstat = DVIF_objectIsNotNew;
-      DB_lseek(handle_->pidx, OFstatic_cast(long, SIZEOF_STUDYDESC + idx * SIZEOF_IDXRECORD), SEEK_SET);
-      write(handle_->pidx, OFreinterpret_cast(char *, &record), SIZEOF_IDXRECORD);
-      DB_lseek(handle_->pidx, 0L, SEEK_SET);
+      result = DB_IdxWrite(idx, &record);
       DB_unlock();
     }
 
@@ -3428,6 +4143,77 @@ OFCondition DcmQueryRetrieveIndexDatabaseHandle::instanceReviewed(int idx)
 }
 
 
+OFBool DcmQueryRetrieveIndexDatabaseHandle::isCompactIndexFile() const
+{
+    return (compactIndex_ != NULL) && ! compactIndex_->conversionPending();
+}
+
+
+/***********************
+ *    Convert the index file into compact format
+ */
+
+OFCondition DcmQueryRetrieveIndexDatabaseHandle::convertIndexFile()
+{
+    IdxRecord   idxRec ;
+    char        buffer [DB_MAX_ENCODED_RECORD] ;
+    OFCondition cond = EC_Normal ;
+
+    if (isCompactIndexFile())
+        return EC_Normal ;
+
+    /* the index file must not be accessed by other processes meanwhile */
+    if (dcmtk_flock(handle_->pidx, LOCK_EX) < 0) {
+        dcmtk_plockerr("convertIndexFile");
+        return QR_EC_IndexDatabaseError;
+    }
+
+    if (compactIndex_ == NULL) {
+        OFString heapFilename(handle_ -> storageArea);
+        heapFilename += PATH_SEPARATOR;
+        heapFilename += DBHEAPFILE;
+        const int numRecords = DB_IdxCount () ;
+        compactIndex_ = new DcmQueryRetrieveCompactIndex;
+        cond = compactIndex_->beginConversion (handle_ -> pidx, heapFilename.c_str(), numRecords) ;
+        if (cond.bad()) {
+            delete compactIndex_;
+            compactIndex_ = NULL;
+            dcmtk_flock(handle_->pidx, LOCK_UN);
+            return cond;
+        }
+    }
+
+    DCMQRDB_INFO("converting " << compactIndex_->legacyRecords() - compactIndex_->convertedRecords()
+        << " records of index file " << handle_ -> indexFilename << " into compact format");
+
+    /*** The records of the original format are placed behind the area of the
+    *** study descriptors and each record is larger than a slot of the compact
+    *** format. Therefore, converting the records in ascending order never
+    *** overwrites a record that has not yet been converted.
+    **/
+
+    for (int idx = compactIndex_->convertedRecords () ; (idx < compactIndex_->legacyRecords ()) && cond.good() ; idx++) {
+        DB_lseek (handle_ -> pidx, SIZEOF_STUDYDESC + (long)idx * SIZEOF_IDXRECORD, SEEK_SET) ;
+        if (read (handle_ -> pidx, (char *) &idxRec, SIZEOF_IDXRECORD) != SIZEOF_IDXRECORD) {
+            cond = QR_EC_IndexDatabaseError ;
+            break ;
+        }
+        DB_IdxInitRecord (&idxRec, 1) ;
+        cond = compactIndex_->writeRecord (idx, buffer, DB_IdxEncodeRecord (&idxRec, buffer)) ;
+        if (cond.good())
+            cond = compactIndex_->setConvertedRecords (idx + 1) ;
+    }
+    if (cond.good())
+        cond = compactIndex_->endConversion () ;
+    DB_lseek (handle_ -> pidx, 0L, SEEK_SET) ;
+
+    dcmtk_flock(handle_->pidx, LOCK_UN);
+    if (cond.bad())
+        DCMQRDB_ERROR("conversion of index file " << handle_ -> indexFilename << " failed");
+    return cond ;
+}
+
+
 /***********************
  *    Default constructors for struct IdxRecord and DB_SSmallDcmElmt
  */
@@ -3450,11 +4236,19 @@ DB_SmallDcmElmt::DB_SmallDcmElmt()
 DcmQueryRetrieveIndexDatabaseHandleFactory::DcmQueryRetrieveIndexDatabaseHandleFactory(const DcmQueryRetrieveConfig *config)
 : DcmQueryRetrieveDatabaseHandleFactory()
 , config_(config)
+, storeJournal_(OFFalse)
+, summaryCacheAreas_()
+, summaryCaches_()
+#ifdef WITH_THREADS
+, summaryCacheMutex_()
+#endif
 {
 }
 
 DcmQueryRetrieveIndexDatabaseHandleFactory::~DcmQueryRetrieveIndexDatabaseHandleFactory()
 {
+  for (size_t i = 0; i < summaryCaches_.size(); ++i)
+    delete summaryCaches_[i];
 }
 
 DcmQueryRetrieveDatabaseHandle *DcmQueryRetrieveIndexDatabaseHandleFactory::createDBHandle(
@@ -3462,8 +4256,39 @@ DcmQueryRetrieveDatabaseHandle *DcmQueryRetrieveIndexDatabaseHandleFactory::crea
     const char *calledAETitle,
     OFCondition& result) const
 {
-  return new DcmQueryRetrieveIndexDatabaseHandle(
+  DcmQueryRetrieveIndexDatabaseHandle *handle = new DcmQueryRetrieveIndexDatabaseHandle(
     config_->getStorageArea(calledAETitle),
     config_->getMaxStudies(calledAETitle),
     config_->getMaxBytesPerStudy(calledAETitle), result);
+  if (storeJournal_) handle->enableStoreJournal(OFTrue);
+  if (result.good()) handle->setSummaryCache(getSummaryCache(config_->getStorageArea(calledAETitle)));
+  return handle;
+}
+
+DcmQueryRetrieveSummaryCache *DcmQueryRetrieveIndexDatabaseHandleFactory::getSummaryCache(const char *storageArea) const
+{
+  DcmQueryRetrieveSummaryCache *result = NULL;
+#ifdef WITH_THREADS
+  summaryCacheMutex_.lock();
+#endif
+  for (size_t i = 0; (i < summaryCacheAreas_.size()) && (result == NULL); ++i)
+  {
+    if (summaryCacheAreas_[i] == storageArea)
+      result = summaryCaches_[i];
+  }
+  if (result == NULL)
+  {
+    result = new DcmQueryRetrieveSummaryCache;
+    summaryCacheAreas_.push_back(storageArea);
+    summaryCaches_.push_back(result);
+  }
+#ifdef WITH_THREADS
+  summaryCacheMutex_.unlock();
+#endif
+  return result;
+}
+
+void DcmQueryRetrieveIndexDatabaseHandleFactory::setStoreJournal(OFBool enable)
+{
+  storeJournal_ = enable;
 }
@@ -0,0 +1,447 @@
+/*
+ *
+ *  Copyright (C) 2016, OFFIS e.V.
+ *  All rights reserved.  See COPYRIGHT file for details.
+ *
+ *  This software and supporting documentation were developed by
+ *
+ *    OFFIS e.V.
+ *    R&D Division Health
+ *    Escherweg 2
+ *    D-26121 Oldenburg, Germany
+ *
+ *
+ *  Module:  dcmqrdb
+ *
+ *  Author:  OFFIS DICOM Team
+ *
+ *  Purpose: class DcmQueryRetrieveStoreJournal
+ *
+ */
+
+#include "dcmtk/config/osconfig.h"    /* make sure OS specific configuration is included first */
+
+#include "dcmtk/dcmqrdb/dcmqrdbj.h"
+
+#ifdef WITH_THREADS
+
+BEGIN_EXTERN_C
+#ifdef HAVE_SYS_STAT_H
+#include <sys/stat.h>
+#endif
+#ifdef HAVE_FCNTL_H
+#include <fcntl.h>
+#endif
+#ifdef HAVE_UNISTD_H
+#include <unistd.h>
+#endif
+#ifdef HAVE_IO_H
+#include <io.h>
+#endif
+END_EXTERN_C
+
+#define INCLUDE_CSTDLIB
+#define INCLUDE_CSTDIO
+#define INCLUDE_CSTRING
+#include "dcmtk/ofstd/ofstdinc.h"
+
+#include "dcmtk/dcmqrdb/dcmqropt.h"
+#include "dcmtk/dcmqrdb/dcmqrcnf.h"
+#include "dcmtk/dcmnet/dcompat.h"     /* for dcmtk_flock() */
+#include "dcmtk/dcmnet/diutil.h"
+#include "dcmtk/ofstd/ofstd.h"
+
+#ifdef _WIN32
+#define fsync _commit
+#define ftruncate _chsize
+#endif
+
+/* file name extension of the journal files */
+#define JOURNAL_EXTENSION ".jnl"
+
+
+/* one journal per storage area, never deleted */
+static OFVector<OFString> storeJournalAreas;
+static OFVector<DcmQueryRetrieveStoreJournal *> storeJournals;
+static OFMutex storeJournalMutex;
+
+/* write all data to the given file descriptor, returns OFFalse upon error */
+static OFBool writeAll(int fd, const char *data, size_t length)
+{
+    while (length > 0)
+    {
+        long written = OFstatic_cast(long, write(fd, data, OFstatic_cast(unsigned int, length)));
+        if (written <= 0) return OFFalse;
+        data += written;
+        length -= OFstatic_cast(size_t, written);
+    }
+    return OFTrue;
+}
+
+/* write a file to disk, returns OFFalse upon error */
+static OFBool syncFile(const char *fileName)
+{
+#ifdef O_BINARY
+    int fd = ::open(fileName, O_RDONLY | O_BINARY);
+#else
+    int fd = ::open(fileName, O_RDONLY);
+#endif
+    if (fd < 0) return OFFalse;
+    OFBool result = (fsync(fd) == 0);
+    close(fd);
+    return result;
+}
+
+/* open a journal file and lock it exclusively. Since journal files are
+ * deleted after being replayed by another process, the file is opened again
+ * if it has been deleted before the lock was acquired. Returns -1 if the
+ * file cannot be opened or is locked by another process (if nonBlocking).
+ */
+static int openLocked(const char *fileName, int flags, OFBool nonBlocking)
+{
+    for (int attempt = 0; attempt < 3; ++attempt)
+    {
+#ifdef O_BINARY
+        int fd = ::open(fileName, flags | O_BINARY, 0666);
+#else
+        int fd = ::open(fileName, flags, 0666);
+#endif
+        if (fd < 0) return -1;
+        if (dcmtk_flock(fd, nonBlocking ? (LOCK_EX | LOCK_NB) : LOCK_EX) < 0)
+        {
+            close(fd);
+            return -1;
+        }
+        struct stat fdStat;
+        struct stat pathStat;
+        if ((fstat(fd, &fdStat) == 0) && (stat(fileName, &pathStat) == 0) &&
+            (fdStat.st_ino == pathStat.st_ino) && (fdStat.st_dev == pathStat.st_dev))
+        {
+            return fd;
+        }
+        /* the file has been replaced or deleted in the meantime */
+        dcmtk_flock(fd, LOCK_UN);
+        close(fd);
+    }
+    return -1;
+}
+
+/* parse the content of a journal file, incomplete lines are ignored */
+static void parseJournal(const OFString &content, OFVector<DcmQueryRetrieveStoreRequest> &requests)
+{
+    size_t pos = 0;
+    size_t eol;
+    while ((eol = content.find('\n', pos)) != OFString_npos)
+    {
+        const OFString line = content.substr(pos, eol - pos);
+        pos = eol + 1;
+        /* format: <N|O> TAB <SOP class UID> TAB <SOP instance UID> TAB <file name> */
+        const size_t tab1 = line.find('\t');
+        const size_t tab2 = (tab1 == OFString_npos) ? OFString_npos : line.find('\t', tab1 + 1);
+        const size_t tab3 = (tab2 == OFString_npos) ? OFString_npos : line.find('\t', tab2 + 1);
+        if ((tab1 != 1) || (tab3 == OFString_npos))
+        {
+            DCMQRDB_WARN("ignoring invalid line in store journal: " << line);
+            continue;
+        }
+        DcmQueryRetrieveStoreRequest request;
+        request.isNew = (line[0] == 'N');
+        request.sopClassUID = line.substr(tab1 + 1, tab2 - tab1 - 1);
+        request.sopInstanceUID = line.substr(tab2 + 1, tab3 - tab2 - 1);
+        request.fileName = line.substr(tab3 + 1);
+        requests.push_back(request);
+    }
+}
+
+
+DcmQueryRetrieveStoreJournal::DcmQueryRetrieveStoreJournal(const char *storageArea, DcmQueryRetrieveIndexDatabaseHandle *handle)
+: OFThread()
+, storageArea_(storageArea)
+, directory_()
+, active_(0)
+, pending_()
+, appended_(0)
+, processed_(0)
+, waiting_(0)
+, handle_(handle)
+, mutex_()
+, appendedSem_(0)
+, processedSem_(0)
+{
+    OFStandard::combineDirAndFilename(directory_, storageArea_, DBJOURNALDIR);
+    fd_[0] = -1;
+    fd_[1] = -1;
+}
+
+DcmQueryRetrieveStoreJournal::~DcmQueryRetrieveStoreJournal()
+{
+    for (int i = 0; i < 2; ++i)
+    {
+        if (fd_[i] >= 0)
+        {
+            close(fd_[i]);
+            unlink(fileName_[i].c_str());
+        }
+    }
+    delete handle_;
+}
+
+DcmQueryRetrieveStoreJournal *DcmQueryRetrieveStoreJournal::getJournal(
+    const char *storageArea,
+    long maxStudiesPerStorageArea,
+    long maxBytesPerStudy,
+    OFBool quotaSystemEnabled)
+{
+    DcmQueryRetrieveStoreJournal *result = NULL;
+    storeJournalMutex.lock();
+    size_t i;
+    for (i = 0; i < storeJournalAreas.size(); ++i)
+    {
+        if (storeJournalAreas[i] == storageArea) break;
+    }
+    if (i < storeJournalAreas.size())
+    {
+        result = storeJournals[i];
+    }
+    else
+    {
+        /* a journal that cannot be used is also registered, so that this is only tried once */
+        OFCondition cond;
+        DcmQueryRetrieveIndexDatabaseHandle *handle = new DcmQueryRetrieveIndexDatabaseHandle(
+            storageArea, maxStudiesPerStorageArea, maxBytesPerStudy, cond);
+        if (cond.good())
+        {
+            handle->enableQuotaSystem(quotaSystemEnabled);
+            result = new DcmQueryRetrieveStoreJournal(storageArea, handle);
+            result->recover();
+            if (result->open().bad() || (result->start() != 0))
+            {
+                DCMQRDB_ERROR("cannot use store journal in " << storageArea << ", storing synchronously");
+                delete result;
+                result = NULL;
+            }
+        }
+        else
+        {
+            delete handle;
+        }
+        if (storeJournals.empty() && (result != NULL))
+        {
+            /* register all pending objects before the process exits */
+            atexit(cleanup);
+        }
+        storeJournalAreas.push_back(storageArea);
+        storeJournals.push_back(result);
+    }
+    storeJournalMutex.unlock();
+    return result;
+}
+
+void DcmQueryRetrieveStoreJournal::flushAll()
+{
+    storeJournalMutex.lock();
+    for (size_t i = 0; i < storeJournals.size(); ++i)
+    {
+        if (storeJournals[i] != NULL) storeJournals[i]->flush();
+    }
+    storeJournalMutex.unlock();
+}
+
+void DcmQueryRetrieveStoreJournal::cleanup()
+{
+    flushAll();
+    storeJournalMutex.lock();
+    for (size_t i = 0; i < storeJournals.size(); ++i)
+    {
+        DcmQueryRetrieveStoreJournal *journal = storeJournals[i];
+        if (journal == NULL) continue;
+        /* the files remain locked until the process has terminated */
+        journal->mutex_.lock();
+        if (journal->processed_ == journal->appended_)
+        {
+            unlink(journal->fileName_[0].c_str());
+            unlink(journal->fileName_[1].c_str());
+        }
+        journal->mutex_.unlock();
+    }
+    storeJournalMutex.unlock();
+}
+
+OFCondition DcmQueryRetrieveStoreJournal::open()
+{
+    if (!OFStandard::dirExists(directory_) && OFStandard::createDirectory(directory_, storageArea_).bad())
+    {
+        DCMQRDB_ERROR("cannot create journal directory " << directory_);
+        return QR_EC_IndexDatabaseError;
+    }
+    for (int i = 0; i < 2; ++i)
+    {
+        char name[64];
+        sprintf(name, "%ld-%d" JOURNAL_EXTENSION, OFStandard::getProcessID(), i);
+        OFStandard::combineDirAndFilename(fileName_[i], directory_, name);
+        fd_[i] = openLocked(fileName_[i].c_str(), O_RDWR | O_CREAT | O_TRUNC | O_APPEND, OFFalse);
+        if (fd_[i] < 0)
+        {
+            char buf[256];
+            DCMQRDB_ERROR("cannot open store journal " << fileName_[i] << ": "
+                << OFStandard::strerror(errno, buf, sizeof(buf)));
+            return QR_EC_IndexDatabaseError;
+        }
+    }
+    return EC_Normal;
+}
+
+void DcmQueryRetrieveStoreJournal::recover()
+{
+    if (!OFStandard::dirExists(directory_)) return;
+
+    OFList<OFString> files;
+    OFStandard::searchDirectoryRecursively(directory_, files, "*" JOURNAL_EXTENSION, "", OFFalse);
+    OFListIterator(OFString) it = files.begin();
+    while (it != files.end())
+    {
+        /* journal files of running processes are locked */
+        int fd = openLocked((*it).c_str(), O_RDONLY, OFTrue);
+        if (fd >= 0)
+        {
+            OFString content;
+            char buf[4096];
+            long bytesRead;
+            while ((bytesRead = OFstatic_cast(long, read(fd, buf, sizeof(buf)))) > 0)
+                content.append(buf, OFstatic_cast(size_t, bytesRead));
+            OFVector<DcmQueryRetrieveStoreRequest> requests;
+            parseJournal(content, requests);
+            if (!requests.empty())
+            {
+                DCMQRDB_INFO("replaying " << requests.size() << " object(s) from store journal " << *it);
+                registerObjects(requests);
+            }
+            /* delete the file while it is still locked */
+            unlink((*it).c_str());
+            dcmtk_flock(fd, LOCK_UN);
+            close(fd);
+        }
+        ++it;
+    }
+}
+
+OFCondition DcmQueryRetrieveStoreJournal::append(
+    const char *SOPClassUID,
+    const char *SOPInstanceUID,
+    const char *imageFileName,
+    OFBool isNew)
+{
+    /* the object must be on disk before it is journaled */
+    if (!syncFile(imageFileName))
+    {
+        char buf[256];
+        DCMQRDB_ERROR("cannot write file to disk: " << imageFileName << ": "
+            << OFStandard::strerror(errno, buf, sizeof(buf)));
+        return QR_EC_IndexDatabaseError;
+    }
+
+    DcmQueryRetrieveStoreRequest request;
+    request.sopClassUID = SOPClassUID;
+    request.sopInstanceUID = SOPInstanceUID;
+    request.fileName = imageFileName;
+    request.isNew = isNew;
+
+    OFString line(isNew ? "N" : "O");
+    line += '\t';
+    line += request.sopClassUID;
+    line += '\t';
+    line += request.sopInstanceUID;
+    line += '\t';
+    line += request.fileName;
+    line += '\n';
+
+    mutex_.lock();
+    const int fd = fd_[active_];
+    OFBool ok = writeAll(fd, line.c_str(), line.length());
+    if (ok)
+    {
+        pending_.push_back(request);
+        appended_++;
+    }
+    mutex_.unlock();
+
+    /* a journal file is only truncated after its objects have been registered,
+     * so it does not matter if this happens before the file is written to disk
+     */
+    if (ok) ok = (fsync(fd) == 0);
+    appendedSem_.post();
+    if (!ok)
+    {
+        char buf[256];
+        DCMQRDB_ERROR("cannot write to store journal: " << OFStandard::strerror(errno, buf, sizeof(buf)));
+        return QR_EC_IndexDatabaseError;
+    }
+    return EC_Normal;
+}
+
+void DcmQueryRetrieveStoreJournal::flush()
+{
+    mutex_.lock();
+    const unsigned long target = appended_;
+    while (processed_ < target)
+    {
+        waiting_++;
+        mutex_.unlock();
+        processedSem_.wait();
+        mutex_.lock();
+    }
+    mutex_.unlock();
+}
+
+void DcmQueryRetrieveStoreJournal::run()
+{
+    OFVector<DcmQueryRetrieveStoreRequest> batch;
+    while (1)
+    {
+        appendedSem_.wait();
+
+        /* take all pending objects and switch to the other journal file */
+        mutex_.lock();
+        batch.swap(pending_);
+        const int done = active_;
+        if (!batch.empty()) active_ = 1 - active_;
+        mutex_.unlock();
+        if (batch.empty()) continue;
+
+        registerObjects(batch);
+        if (ftruncate(fd_[done], 0) != 0)
+            DCMQRDB_WARN("cannot truncate store journal " << fileName_[done]);
+
+        mutex_.lock();
+        processed_ += OFstatic_cast(unsigned long, batch.size());
+        unsigned long waiting = waiting_;
+        waiting_ = 0;
+        mutex_.unlock();
+        while (waiting-- > 0) processedSem_.post();
+        batch.clear();
+    }
+}
+
+void DcmQueryRetrieveStoreJournal::registerObjects(OFVector<DcmQueryRetrieveStoreRequest> &batch)
+{
+    DCMQRDB_DEBUG("registering " << batch.size() << " object(s) from store journal in " << storageArea_);
+    if (handle_->storeRequests(batch).good()) return;
+
+    /* the C-STORE responses have already been sent, so the refusal can only
+     * be logged. The files are deleted like in the synchronous case, since
+     * they would otherwise remain in the storage area without being indexed,
+     * counted against the quota or ever purged.
+     */
+    for (size_t i = 0; i < batch.size(); ++i)
+    {
+        if (batch[i].status != STATUS_Success)
+        {
+            DCMQRDB_ERROR("cannot register file in database ("
+                << DU_cstoreStatusString(batch[i].status) << "), deleting file: " << batch[i].fileName);
+            unlink(batch[i].fileName.c_str());
+        }
+    }
+    handle_->pruneInvalidRecords();
+}
+
+#endif
@@ -0,0 +1,554 @@
+/*
+ *
+ *  Copyright (C) 2016, OFFIS e.V.
+ *  All rights reserved.  See COPYRIGHT file for details.
+ *
+ *  This software and supporting documentation were developed by
+ *
+ *    OFFIS e.V.
+ *    R&D Division Health
+ *    Escherweg 2
+ *    D-26121 Oldenburg, Germany
+ *
+ *
+ *  Module:  dcmqrdb
+ *
+ *  Author:  OFFIS DICOM Team
+ *
+ *  Purpose: class DcmQueryRetrieveKeyIndex
+ *
+ */
+
+#include "dcmtk/config/osconfig.h"    /* make sure OS specific configuration is included first */
+
+BEGIN_EXTERN_C
+#ifdef HAVE_FCNTL_H
+#include <fcntl.h>
+#endif
+#ifdef HAVE_UNISTD_H
+#include <unistd.h>
+#endif
+END_EXTERN_C
+
+#define INCLUDE_CSTDLIB
+#define INCLUDE_CSTRING
+#include "dcmtk/ofstd/ofstdinc.h"
+
+#ifdef _WIN32
+#define fsync _commit
+#endif
+
+#include "dcmtk/dcmqrdb/dcmqrdbk.h"
+#include "dcmtk/dcmqrdb/dcmqridx.h"
+#include "dcmtk/dcmqrdb/dcmqropt.h"
+#include "dcmtk/dcmqrdb/dcmqrcnf.h"
+
+/* magic word and version of the key index file format */
+#define KEYINDEX_MAGIC "DQRKEY01"
+
+/* special values for buckets that are not in use */
+#define KEYINDEX_EMPTY   -1
+#define KEYINDEX_REMOVED -2
+
+/* minimum number of buckets in the hash table */
+#define KEYINDEX_MIN_BUCKETS 1024
+
+/* number of buckets read at once while probing */
+#define KEYINDEX_CHUNK 64
+
+/* the attributes maintained in the key index, most selective first */
+static const DcmTagKey KeyIndexTags[] = {
+    DCM_SOPInstanceUID,
+    DCM_SeriesInstanceUID,
+    DCM_StudyInstanceUID,
+    DCM_AccessionNumber,
+    DCM_PatientID,
+    DCM_StudyDate
+};
+
+static const int NbKeyIndexTags = OFstatic_cast(int, sizeof(KeyIndexTags) / sizeof(KeyIndexTags[0]));
+
+/* returns the value of the given key attribute in an index record */
+static const char *DB_KeyValue(const IdxRecord &idxRec, const DcmTagKey &tag)
+{
+    if (tag == DCM_SOPInstanceUID) return idxRec.SOPInstanceUID;
+    if (tag == DCM_SeriesInstanceUID) return idxRec.SeriesInstanceUID;
+    if (tag == DCM_StudyInstanceUID) return idxRec.StudyInstanceUID;
+    if (tag == DCM_AccessionNumber) return idxRec.AccessionNumber;
+    if (tag == DCM_PatientID) return idxRec.PatientID;
+    if (tag == DCM_StudyDate) return idxRec.StudyDate;
+    return NULL;
+}
+
+/* normalizes an attribute value in the same way as the matching functions
+ * of the index database do, i.e. removes all spaces from dates and leading
+ * and trailing spaces from all other values.
+ */
+static void DB_NormalizeKey(const DcmTagKey &tag, const char *value, OFString &result)
+{
+    result.clear();
+    if (value == NULL) return;
+    if (tag == DCM_StudyDate)
+    {
+        for (const char *c = value; *c; ++c)
+            if (*c != ' ') result += *c;
+    }
+    else
+    {
+        const char *first = value;
+        while (*first == ' ') ++first;
+        const char *last = first + strlen(first);
+        while ((last > first) && (*(last - 1) == ' ')) --last;
+        result.assign(first, last - first);
+    }
+}
+
+/* compares two record indexes, used for sorting */
+extern "C" int DB_CompareKeyIndexRecords(const void *e1, const void *e2)
+{
+    const int i1 = *OFstatic_cast(const int *, e1);
+    const int i2 = *OFstatic_cast(const int *, e2);
+    return (i1 < i2) ? -1 : ((i1 > i2) ? 1 : 0);
+}
+
+
+DcmQueryRetrieveKeyIndex::DcmQueryRetrieveKeyIndex()
+: fd_(-1)
+, header_()
+, memBuckets_(NULL)
+, updating_(OFFalse)
+{
+    memset(&header_, 0, sizeof(header_));
+}
+
+DcmQueryRetrieveKeyIndex::~DcmQueryRetrieveKeyIndex()
+{
+    close();
+}
+
+OFCondition DcmQueryRetrieveKeyIndex::open(const char *filename)
+{
+    close();
+#ifdef O_BINARY
+    fd_ = ::open(filename, O_RDWR | O_CREAT | O_BINARY, 0666);
+#else
+    fd_ = ::open(filename, O_RDWR | O_CREAT, 0666);
+#endif
+    if (fd_ < 0)
+    {
+        DCMQRDB_WARN("cannot open key index file: " << filename);
+        return QR_EC_IndexDatabaseError;
+    }
+    return EC_Normal;
+}
+
+void DcmQueryRetrieveKeyIndex::close()
+{
+    if (fd_ >= 0) commitUpdate();
+    delete[] memBuckets_;
+    memBuckets_ = NULL;
+    if (fd_ >= 0) ::close(fd_);
+    fd_ = -1;
+}
+
+OFBool DcmQueryRetrieveKeyIndex::isValid()
+{
+    if (fd_ < 0) return OFFalse;
+    /* the header in memory is up to date while this object is modifying the file */
+    if (updating_) return OFTrue;
+    if (readHeader().bad()) return OFFalse;
+    return (header_.Valid != 0);
+}
+
+OFCondition DcmQueryRetrieveKeyIndex::commitUpdate()
+{
+    if (! updating_) return EC_Normal;
+    updating_ = OFFalse;
+    /* all modifications must be on disk before the file is marked as valid */
+    OFCondition result = syncFile();
+    if (result.good())
+        result = setValid(OFTrue);
+    return result;
+}
+
+OFCondition DcmQueryRetrieveKeyIndex::beginRebuild(size_t expectedRecords)
+{
+    if (fd_ < 0) return QR_EC_IndexDatabaseError;
+    /* keep the load factor of the hash table below 2/3 */
+    const size_t expectedEntries = expectedRecords * NbKeyIndexTags * 3 / 2 + 1;
+    Uint32 numBuckets = KEYINDEX_MIN_BUCKETS;
+    while ((numBuckets < expectedEntries) && (numBuckets < 0x40000000UL)) numBuckets *= 2;
+
+    delete[] memBuckets_;
+    memBuckets_ = new Bucket[numBuckets];
+    for (Uint32 i = 0; i < numBuckets; ++i)
+    {
+        memBuckets_[i].Hash = 0;
+        memBuckets_[i].Record = KEYINDEX_EMPTY;
+    }
+    memcpy(header_.Magic, KEYINDEX_MAGIC, sizeof(header_.Magic));
+    header_.RecordSize = OFstatic_cast(Uint32, SIZEOF_IDXRECORD);
+    header_.NumBuckets = numBuckets;
+    header_.NumUsed = 0;
+    header_.NumRemoved = 0;
+    header_.Valid = 0;
+    return writeHeader();
+}
+
+OFCondition DcmQueryRetrieveKeyIndex::endRebuild()
+{
+    if ((fd_ < 0) || (memBuckets_ == NULL)) return QR_EC_IndexDatabaseError;
+    OFCondition result = writeBuckets(0, header_.NumBuckets, memBuckets_);
+    delete[] memBuckets_;
+    memBuckets_ = NULL;
+    /* the buckets must be on disk before the file is marked as valid. While
+     * the hash table is enlarged during an update transaction, the file
+     * remains invalid until the transaction is committed.
+     */
+    if (result.good())
+        result = syncFile();
+    if (result.good() && ! updating_)
+        result = setValid(OFTrue);
+    return result;
+}
+
+OFCondition DcmQueryRetrieveKeyIndex::addRecord(int idx, const IdxRecord &idxRec)
+{
+    if (fd_ < 0) return QR_EC_IndexDatabaseError;
+    OFCondition result = EC_Normal;
+    if (memBuckets_ == NULL)
+        result = beginUpdate();
+    for (int i = 0; (i < NbKeyIndexTags) && result.good(); ++i)
+    {
+        OFString value;
+        DB_NormalizeKey(KeyIndexTags[i], DB_KeyValue(idxRec, KeyIndexTags[i]), value);
+        if (value.empty()) continue;
+        const Uint32 hash = hashValue(KeyIndexTags[i], value.c_str());
+        if (memBuckets_ != NULL)
+            insertInMemory(hash, idx);
+        else
+            result = insertOnFile(hash, idx);
+    }
+    if (result.bad())
+        abortUpdate();
+    return result;
+}
+
+OFCondition DcmQueryRetrieveKeyIndex::removeRecord(int idx, const IdxRecord &idxRec)
+{
+    if ((fd_ < 0) || (memBuckets_ != NULL)) return QR_EC_IndexDatabaseError;
+    OFCondition result = beginUpdate();
+    Bucket buckets[KEYINDEX_CHUNK];
+    const Uint32 mask = header_.NumBuckets - 1;
+    for (int i = 0; (i < NbKeyIndexTags) && result.good(); ++i)
+    {
+        OFString value;
+        DB_NormalizeKey(KeyIndexTags[i], DB_KeyValue(idxRec, KeyIndexTags[i]), value);
+        if (value.empty()) continue;
+        const Uint32 hash = hashValue(KeyIndexTags[i], value.c_str());
+        Uint32 pos = hash & mask;
+        Uint32 probed = 0;
+        OFBool done = OFFalse;
+        while (!done && result.good() && (probed < header_.NumBuckets))
+        {
+            Uint32 count = header_.NumBuckets - pos;
+            if (count > KEYINDEX_CHUNK) count = KEYINDEX_CHUNK;
+            result = readBuckets(pos, count, buckets);
+            for (Uint32 j = 0; (j < count) && !done && result.good(); ++j)
+            {
+                if (buckets[j].Record == KEYINDEX_EMPTY)
+                    done = OFTrue; /* not found, nothing to remove */
+                else if ((buckets[j].Hash == hash) && (buckets[j].Record == idx))
+                {
+                    buckets[j].Record = KEYINDEX_REMOVED;
+                    result = writeBuckets(pos + j, 1, buckets + j);
+                    header_.NumUsed--;
+                    header_.NumRemoved++;
+                    done = OFTrue;
+                }
+            }
+            probed += count;
+            pos = (pos + count) & mask;
+        }
+    }
+    if (result.bad())
+        abortUpdate();
+    return result;
+}
+
+OFCondition DcmQueryRetrieveKeyIndex::findRecords(const DcmTagKey &tag,
+                                                  const char *value,
+                                                  OFVector<int> &result)
+{
+    result.clear();
+    if ((fd_ < 0) || (keyPriority(tag) < 0) || !isValid()) return QR_EC_IndexDatabaseError;
+    OFString key;
+    DB_NormalizeKey(tag, value, key);
+    if (key.empty()) return QR_EC_IndexDatabaseError;
+    const Uint32 hash = hashValue(tag, key.c_str());
+    const Uint32 mask = header_.NumBuckets - 1;
+    Bucket buckets[KEYINDEX_CHUNK];
+    Uint32 pos = hash & mask;
+    Uint32 probed = 0;
+    OFBool done = OFFalse;
+    while (!done && (probed < header_.NumBuckets))
+    {
+        Uint32 count = header_.NumBuckets - pos;
+        if (count > KEYINDEX_CHUNK) count = KEYINDEX_CHUNK;
+        if (readBuckets(pos, count, buckets).bad())
+        {
+            result.clear();
+            return QR_EC_IndexDatabaseError;
+        }
+        for (Uint32 j = 0; (j < count) && !done; ++j)
+        {
+            if (buckets[j].Record == KEYINDEX_EMPTY)
+                done = OFTrue;
+            else if ((buckets[j].Hash == hash) && (buckets[j].Record >= 0))
+                result.push_back(buckets[j].Record);
+        }
+        probed += count;
+        pos = (pos + count) & mask;
+    }
+    /* records are expected in the order of the index file */
+    if (result.size() > 1)
+    {
+        qsort(&result[0], result.size(), sizeof(int), DB_CompareKeyIndexRecords);
+        size_t last = 0;
+        for (size_t i = 1; i < result.size(); ++i)
+        {
+            if (result[i] != result[last]) result[++last] = result[i];
+        }
+        result.resize(last + 1);
+    }
+    return EC_Normal;
+}
+
+int DcmQueryRetrieveKeyIndex::keyPriority(const DcmTagKey &tag)
+{
+    for (int i = 0; i < NbKeyIndexTags; ++i)
+    {
+        if (KeyIndexTags[i] == tag) return i;
+    }
+    return -1;
+}
+
+OFBool DcmQueryRetrieveKeyIndex::isSingleValue(const DcmTagKey &tag, const char *value)
+{
+    if (keyPriority(tag) < 0) return OFFalse;
+    OFString key;
+    DB_NormalizeKey(tag, value, key);
+    if (key.empty()) return OFFalse;
+    if (tag == DCM_StudyDate)
+        return (key.find('-') == OFString_npos);
+    if ((tag == DCM_PatientID) || (tag == DCM_AccessionNumber))
+        return (key.find_first_of("*?") == OFString_npos);
+    /* UID list matching */
+    return (key.find('\\') == OFString_npos);
+}
+
+Uint32 DcmQueryRetrieveKeyIndex::hashValue(const DcmTagKey &tag, const char *value)
+{
+    /* FNV-1a hash over tag and value */
+    Uint32 hash = 2166136261UL;
+    const Uint32 tagValue = (OFstatic_cast(Uint32, tag.getGroup()) << 16) | tag.getElement();
+    for (int i = 0; i < 4; ++i)
+    {
+        hash ^= (tagValue >> (8 * i)) & 0xff;
+        hash *= 16777619UL;
+    }
+    for (const unsigned char *c = OFreinterpret_cast(const unsigned char *, value); *c; ++c)
+    {
+        hash ^= *c;
+        hash *= 16777619UL;
+    }
+    return hash & 0xffffffffUL;
+}
+
+OFCondition DcmQueryRetrieveKeyIndex::readHeader()
+{
+    Header header;
+    if ((lseek(fd_, 0, SEEK_SET) != 0) ||
+        (read(fd_, OFreinterpret_cast(char *, &header), sizeof(header)) != OFstatic_cast(int, sizeof(header))))
+        return QR_EC_IndexDatabaseError;
+    if ((memcmp(header.Magic, KEYINDEX_MAGIC, sizeof(header.Magic)) != 0) ||
+        (header.RecordSize != SIZEOF_IDXRECORD) ||
+        (header.NumBuckets < KEYINDEX_MIN_BUCKETS) ||
+        ((header.NumBuckets & (header.NumBuckets - 1)) != 0))
+        return QR_EC_IndexDatabaseError;
+    header_ = header;
+    return EC_Normal;
+}
+
+OFCondition DcmQueryRetrieveKeyIndex::writeHeader()
+{
+    if ((lseek(fd_, 0, SEEK_SET) != 0) ||
+        (write(fd_, OFreinterpret_cast(const char *, &header_), sizeof(header_)) != OFstatic_cast(int, sizeof(header_))))
+    {
+        DCMQRDB_WARN("cannot write key index file header");
+        return QR_EC_IndexDatabaseError;
+    }
+    return EC_Normal;
+}
+
+OFCondition DcmQueryRetrieveKeyIndex::readBuckets(Uint32 first, Uint32 count, Bucket *buckets)
+{
+    const long offset = OFstatic_cast(long, sizeof(Header) + OFstatic_cast(size_t, first) * sizeof(Bucket));
+    const size_t length = OFstatic_cast(size_t, count) * sizeof(Bucket);
+    if (lseek(fd_, offset, SEEK_SET) != offset)
+        return QR_EC_IndexDatabaseError;
+    char *buf = OFreinterpret_cast(char *, buckets);
+    size_t done = 0;
+    while (done < length)
+    {
+        const long n = OFstatic_cast(long, read(fd_, buf + done, length - done));
+        if (n <= 0) return QR_EC_IndexDatabaseError;
+        done += OFstatic_cast(size_t, n);
+    }
+    return EC_Normal;
+}
+
+OFCondition DcmQueryRetrieveKeyIndex::writeBuckets(Uint32 first, Uint32 count, const Bucket *buckets)
+{
+    const long offset = OFstatic_cast(long, sizeof(Header) + OFstatic_cast(size_t, first) * sizeof(Bucket));
+    const size_t length = OFstatic_cast(size_t, count) * sizeof(Bucket);
+    if (lseek(fd_, offset, SEEK_SET) != offset)
+        return QR_EC_IndexDatabaseError;
+    const char *buf = OFreinterpret_cast(const char *, buckets);
+    size_t done = 0;
+    while (done < length)
+    {
+        const long n = OFstatic_cast(long, write(fd_, buf + done, length - done));
+        if (n <= 0)
+        {
+            DCMQRDB_WARN("cannot write key index file");
+            return QR_EC_IndexDatabaseError;
+        }
+        done += OFstatic_cast(size_t, n);
+    }
+    return EC_Normal;
+}
+
+void DcmQueryRetrieveKeyIndex::insertInMemory(Uint32 hash, Sint32 idx)
+{
+    if ((header_.NumUsed + 1) * 3 > header_.NumBuckets * 2)
+    {
+        /* more records than expected, double the size of the hash table */
+        const Uint32 oldNumBuckets = header_.NumBuckets;
+        Bucket *oldBuckets = memBuckets_;
+        header_.NumBuckets = oldNumBuckets * 2;
+        header_.NumUsed = 0;
+        memBuckets_ = new Bucket[header_.NumBuckets];
+        for (Uint32 i = 0; i < header_.NumBuckets; ++i)
+        {
+            memBuckets_[i].Hash = 0;
+            memBuckets_[i].Record = KEYINDEX_EMPTY;
+        }
+        for (Uint32 i = 0; i < oldNumBuckets; ++i)
+        {
+            if (oldBuckets[i].Record >= 0) insertInMemory(oldBuckets[i].Hash, oldBuckets[i].Record);
+        }
+        delete[] oldBuckets;
+    }
+    const Uint32 mask = header_.NumBuckets - 1;
+    Uint32 pos = hash & mask;
+    while (memBuckets_[pos].Record >= 0) pos = (pos + 1) & mask;
+    memBuckets_[pos].Hash = hash;
+    memBuckets_[pos].Record = idx;
+    header_.NumUsed++;
+}
+
+OFCondition DcmQueryRetrieveKeyIndex::insertOnFile(Uint32 hash, Sint32 idx)
+{
+    OFCondition result = EC_Normal;
+    if ((header_.NumUsed + header_.NumRemoved + 1) * 3 > header_.NumBuckets * 2)
+    {
+        result = grow();
+        if (result.bad()) return result;
+    }
+    const Uint32 mask = header_.NumBuckets - 1;
+    Bucket buckets[KEYINDEX_CHUNK];
+    Uint32 pos = hash & mask;
+    while (1)
+    {
+        Uint32 count = header_.NumBuckets - pos;
+        if (count > KEYINDEX_CHUNK) count = KEYINDEX_CHUNK;
+        result = readBuckets(pos, count, buckets);
+        if (result.bad()) return result;
+        for (Uint32 j = 0; j < count; ++j)
+        {
+            /* the load factor guarantees that a free bucket is found */
+            if (buckets[j].Record < 0)
+            {
+                if (buckets[j].Record == KEYINDEX_REMOVED) header_.NumRemoved--;
+                buckets[j].Hash = hash;
+                buckets[j].Record = idx;
+                header_.NumUsed++;
+                return writeBuckets(pos + j, 1, buckets + j);
+            }
+        }
+        pos = (pos + count) & mask;
+    }
+    return result;
+}
+
+OFCondition DcmQueryRetrieveKeyIndex::grow()
+{
+    /* read the complete hash table and insert all entries into a new one */
+    const Uint32 oldNumBuckets = header_.NumBuckets;
+    Bucket *oldBuckets = new Bucket[oldNumBuckets];
+    OFCondition result = readBuckets(0, oldNumBuckets, oldBuckets);
+    if (result.good())
+    {
+        /* removed entries are dropped, the new table is sized for twice the entries in use */
+        const size_t numUsed = header_.NumUsed;
+        result = beginRebuild((numUsed * 2 + NbKeyIndexTags - 1) / NbKeyIndexTags);
+        for (Uint32 i = 0; (i < oldNumBuckets) && result.good(); ++i)
+        {
+            if (oldBuckets[i].Record >= 0) insertInMemory(oldBuckets[i].Hash, oldBuckets[i].Record);
+        }
+        if (result.good())
+            result = endRebuild();
+    }
+    delete[] oldBuckets;
+    return result;
+}
+
+OFCondition DcmQueryRetrieveKeyIndex::setValid(OFBool valid)
+{
+    header_.Valid = valid ? 1 : 0;
+    return writeHeader();
+}
+
+OFCondition DcmQueryRetrieveKeyIndex::beginUpdate()
+{
+    if (updating_) return EC_Normal;
+    if (! isValid()) return QR_EC_IndexDatabaseError;
+    /* the invalid flag must be on disk before the first bucket is modified */
+    OFCondition result = setValid(OFFalse);
+    if (result.good())
+        result = syncFile();
+    if (result.good())
+        updating_ = OFTrue;
+    return result;
+}
+
+void DcmQueryRetrieveKeyIndex::abortUpdate()
+{
+    /* the file has been marked as invalid before, so it is rebuilt by the next writer */
+    if (updating_)
+    {
+        updating_ = OFFalse;
+        DCMQRDB_WARN("update of key index file failed, key index is rebuilt by the next writer");
+    }
+}
+
+OFCondition DcmQueryRetrieveKeyIndex::syncFile()
+{
+    if (fsync(fd_) != 0)
+    {
+        DCMQRDB_WARN("cannot synchronize key index file to disk");
+        return QR_EC_IndexDatabaseError;
+    }
+    return EC_Normal;
+}
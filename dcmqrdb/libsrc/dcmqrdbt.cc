@@ -0,0 +1,458 @@
+/*
+ *
+ *  Copyright (C) 2016, OFFIS e.V.
+ *  All rights reserved.  See COPYRIGHT file for details.
+ *
+ *  This software and supporting documentation were developed by
+ *
+ *    OFFIS e.V.
+ *    R&D Division Health
+ *    Escherweg 2
+ *    D-26121 Oldenburg, Germany
+ *
+ *
+ *  Module:  dcmqrdb
+ *
+ *  Author:  OFFIS DICOM Team
+ *
+ *  Purpose: class DcmQueryRetrieveStudyTable
+ *
+ */
+
+#include "dcmtk/config/osconfig.h"    /* make sure OS specific configuration is included first */
+
+BEGIN_EXTERN_C
+#ifdef HAVE_FCNTL_H
+#include <fcntl.h>
+#endif
+#ifdef HAVE_UNISTD_H
+#include <unistd.h>
+#endif
+END_EXTERN_C
+
+#define INCLUDE_CSTDLIB
+#define INCLUDE_CSTRING
+#define INCLUDE_CTIME
+#include "dcmtk/ofstd/ofstdinc.h"
+
+#include "dcmtk/dcmqrdb/dcmqrdbt.h"
+#include "dcmtk/dcmqrdb/dcmqridx.h"
+#include "dcmtk/dcmqrdb/dcmqropt.h"
+#include "dcmtk/dcmqrdb/dcmqrcnf.h"
+
+/* magic word and version of the study table file format */
+#define STUDYTABLE_MAGIC "DQRSTU02"
+
+/* minimum number of slots in the hash table */
+#define STUDYTABLE_MIN_SLOTS 256
+
+/* number of slots read at once (one page) */
+#define STUDYTABLE_PAGE 64
+
+
+DcmQueryRetrieveStudyTable::DcmQueryRetrieveStudyTable()
+: fd_(-1)
+, header_()
+, memSlots_(NULL)
+{
+    memset(&header_, 0, sizeof(header_));
+    header_.FreeRecord = DB_UnknownFreeRecords;
+}
+
+DcmQueryRetrieveStudyTable::~DcmQueryRetrieveStudyTable()
+{
+    close();
+}
+
+OFCondition DcmQueryRetrieveStudyTable::open(const char *filename)
+{
+    close();
+#ifdef O_BINARY
+    fd_ = ::open(filename, O_RDWR | O_CREAT | O_BINARY, 0666);
+#else
+    fd_ = ::open(filename, O_RDWR | O_CREAT, 0666);
+#endif
+    if (fd_ < 0)
+    {
+        DCMQRDB_WARN("cannot open study table file: " << filename);
+        return QR_EC_IndexDatabaseError;
+    }
+    return EC_Normal;
+}
+
+void DcmQueryRetrieveStudyTable::close()
+{
+    delete[] memSlots_;
+    memSlots_ = NULL;
+    if (fd_ >= 0) ::close(fd_);
+    fd_ = -1;
+}
+
+OFBool DcmQueryRetrieveStudyTable::isValid()
+{
+    if ((fd_ < 0) || readHeader().bad()) return OFFalse;
+    return (header_.Valid != 0);
+}
+
+OFCondition DcmQueryRetrieveStudyTable::beginRebuild(size_t expectedStudies)
+{
+    if (fd_ < 0) return QR_EC_IndexDatabaseError;
+    /* keep the load factor of the hash table below 2/3 */
+    Uint32 numSlots = STUDYTABLE_MIN_SLOTS;
+    while ((numSlots * 2 < (expectedStudies + 1) * 3) && (numSlots < 0x10000000UL)) numSlots *= 2;
+
+    /* the generation of a rebuilt study table must differ from all previous
+     * generations, even if the previous header could not be read
+     */
+    Uint32 generation = OFstatic_cast(Uint32, time(NULL));
+    if (generation <= header_.Generation) generation = header_.Generation + 1;
+
+    delete[] memSlots_;
+    memSlots_ = new StudyDescRecord[numSlots];
+    memset(memSlots_, 0, numSlots * sizeof(StudyDescRecord));
+    memcpy(header_.Magic, STUDYTABLE_MAGIC, sizeof(header_.Magic));
+    header_.RecordSize = OFstatic_cast(Uint32, sizeof(StudyDescRecord));
+    header_.NumSlots = numSlots;
+    header_.NumUsed = 0;
+    header_.NumStudies = 0;
+    header_.FreeRecord = DB_UnknownFreeRecords;
+    header_.Valid = 0;
+    header_.Generation = generation;
+    return writeHeader();
+}
+
+OFCondition DcmQueryRetrieveStudyTable::endRebuild()
+{
+    if ((fd_ < 0) || (memSlots_ == NULL)) return QR_EC_IndexDatabaseError;
+    StudyDescRecord *slots = memSlots_;
+    memSlots_ = NULL;
+    OFCondition result = writeSlots(0, header_.NumSlots, slots);
+    delete[] slots;
+    if (result.good())
+    {
+        header_.Valid = 1;
+        result = writeHeader();
+    }
+    return result;
+}
+
+void DcmQueryRetrieveStudyTable::cancelRebuild()
+{
+    delete[] memSlots_;
+    memSlots_ = NULL;
+}
+
+OFCondition DcmQueryRetrieveStudyTable::findStudy(const char *studyUID, StudyDescRecord &study)
+{
+    if ((fd_ < 0) || (studyUID == NULL) || (studyUID[0] == '\0')) return QR_EC_IndexDatabaseError;
+    if ((memSlots_ == NULL) && !isValid()) return QR_EC_IndexDatabaseError;
+    Uint32 slot = 0;
+    OFCondition result = findSlot(studyUID, slot, study);
+    if (result.good() && ((strcmp(study.StudyInstanceUID, studyUID) != 0) || (study.NumberofRegistratedImages <= 0)))
+        result = QR_EC_IndexDatabaseError;
+    return result;
+}
+
+OFCondition DcmQueryRetrieveStudyTable::updateStudy(const StudyDescRecord &study)
+{
+    if ((fd_ < 0) || (study.StudyInstanceUID[0] == '\0')) return QR_EC_IndexDatabaseError;
+    OFCondition result = EC_Normal;
+    if (memSlots_ == NULL)
+    {
+        /* make sure that the study table is marked as invalid if the update
+         * is interrupted
+         */
+        if (! isValid()) return QR_EC_IndexDatabaseError;
+        result = setValid(OFFalse);
+    }
+    Uint32 slot = 0;
+    StudyDescRecord current;
+    if (result.good())
+        result = findSlot(study.StudyInstanceUID, slot, current);
+    if (result.good())
+    {
+        const OFBool found = (strcmp(current.StudyInstanceUID, study.StudyInstanceUID) == 0);
+        const OFBool wasRegistered = found && (current.NumberofRegistratedImages > 0);
+        const OFBool isRegistered = (study.NumberofRegistratedImages > 0);
+        if (found || isRegistered)
+        {
+            if (current.StudyInstanceUID[0] == '\0')
+            {
+                /* a slot that has never been used before */
+                if ((header_.NumUsed + 1) * 3 > header_.NumSlots * 2)
+                {
+                    result = grow();
+                    if (result.good())
+                        result = findSlot(study.StudyInstanceUID, slot, current);
+                }
+                header_.NumUsed++;
+            }
+            if (result.good())
+            {
+                current = study;
+                if (! isRegistered)
+                {
+                    /* the slot is kept for the hash chain and can be reused */
+                    current.NumberofRegistratedImages = 0;
+                    current.StudySize = 0;
+                }
+                result = writeSlots(slot, 1, &current);
+            }
+            if (result.good())
+            {
+                if (isRegistered && !wasRegistered) header_.NumStudies++;
+                else if (wasRegistered && !isRegistered) header_.NumStudies--;
+            }
+        }
+    }
+    if (result.good() && (memSlots_ == NULL))
+        result = setValid(OFTrue);
+    return result;
+}
+
+OFCondition DcmQueryRetrieveStudyTable::findOldestStudy(StudyDescRecord &study)
+{
+    if ((fd_ < 0) || ((memSlots_ == NULL) && !isValid())) return QR_EC_IndexDatabaseError;
+    OFBool found = OFFalse;
+    StudyDescRecord page[STUDYTABLE_PAGE];
+    for (Uint32 pos = 0; pos < header_.NumSlots; pos += STUDYTABLE_PAGE)
+    {
+        Uint32 count = header_.NumSlots - pos;
+        if (count > STUDYTABLE_PAGE) count = STUDYTABLE_PAGE;
+        if (readSlots(pos, count, page).bad()) return QR_EC_IndexDatabaseError;
+        for (Uint32 j = 0; j < count; ++j)
+        {
+            if ((page[j].NumberofRegistratedImages > 0) && (!found || (page[j].LastRecordedDate < study.LastRecordedDate)))
+            {
+                study = page[j];
+                found = OFTrue;
+            }
+        }
+    }
+    return found ? EC_Normal : QR_EC_IndexDatabaseError;
+}
+
+OFCondition DcmQueryRetrieveStudyTable::getStudies(OFVector<StudyDescRecord> &studies)
+{
+    studies.clear();
+    if ((fd_ < 0) || ((memSlots_ == NULL) && !isValid())) return QR_EC_IndexDatabaseError;
+    StudyDescRecord page[STUDYTABLE_PAGE];
+    for (Uint32 pos = 0; pos < header_.NumSlots; pos += STUDYTABLE_PAGE)
+    {
+        Uint32 count = header_.NumSlots - pos;
+        if (count > STUDYTABLE_PAGE) count = STUDYTABLE_PAGE;
+        if (readSlots(pos, count, page).bad())
+        {
+            studies.clear();
+            return QR_EC_IndexDatabaseError;
+        }
+        for (Uint32 j = 0; j < count; ++j)
+        {
+            if (page[j].NumberofRegistratedImages > 0) studies.push_back(page[j]);
+        }
+    }
+    return EC_Normal;
+}
+
+size_t DcmQueryRetrieveStudyTable::numberOfStudies() const
+{
+    return header_.NumStudies;
+}
+
+int DcmQueryRetrieveStudyTable::firstFreeRecord() const
+{
+    return header_.FreeRecord;
+}
+
+OFCondition DcmQueryRetrieveStudyTable::setFirstFreeRecord(int idx)
+{
+    if (fd_ < 0) return QR_EC_IndexDatabaseError;
+    header_.FreeRecord = idx;
+    /* the header is written at the end of a rebuild */
+    if (memSlots_ != NULL) return EC_Normal;
+    return writeHeader();
+}
+
+Uint32 DcmQueryRetrieveStudyTable::generation() const
+{
+    return header_.Generation;
+}
+
+OFCondition DcmQueryRetrieveStudyTable::incrementGeneration()
+{
+    if (fd_ < 0) return QR_EC_IndexDatabaseError;
+    header_.Generation++;
+    /* the header is written at the end of a rebuild */
+    if (memSlots_ != NULL) return EC_Normal;
+    return writeHeader();
+}
+
+Uint32 DcmQueryRetrieveStudyTable::hashValue(const char *studyUID)
+{
+    /* FNV-1a hash */
+    Uint32 hash = 2166136261UL;
+    for (const unsigned char *c = OFreinterpret_cast(const unsigned char *, studyUID); *c; ++c)
+    {
+        hash ^= *c;
+        hash *= 16777619UL;
+    }
+    return hash & 0xffffffffUL;
+}
+
+OFCondition DcmQueryRetrieveStudyTable::readHeader()
+{
+    Header header;
+    if ((lseek(fd_, 0, SEEK_SET) != 0) ||
+        (read(fd_, OFreinterpret_cast(char *, &header), sizeof(header)) != OFstatic_cast(int, sizeof(header))))
+        return QR_EC_IndexDatabaseError;
+    if ((memcmp(header.Magic, STUDYTABLE_MAGIC, sizeof(header.Magic)) != 0) ||
+        (header.RecordSize != sizeof(StudyDescRecord)) ||
+        (header.NumSlots < STUDYTABLE_MIN_SLOTS) ||
+        ((header.NumSlots & (header.NumSlots - 1)) != 0))
+        return QR_EC_IndexDatabaseError;
+    header_ = header;
+    return EC_Normal;
+}
+
+OFCondition DcmQueryRetrieveStudyTable::writeHeader()
+{
+    if ((lseek(fd_, 0, SEEK_SET) != 0) ||
+        (write(fd_, OFreinterpret_cast(const char *, &header_), sizeof(header_)) != OFstatic_cast(int, sizeof(header_))))
+    {
+        DCMQRDB_WARN("cannot write study table file header");
+        return QR_EC_IndexDatabaseError;
+    }
+    return EC_Normal;
+}
+
+OFCondition DcmQueryRetrieveStudyTable::readSlots(Uint32 first, Uint32 count, StudyDescRecord *slots)
+{
+    if (memSlots_ != NULL)
+    {
+        memcpy(slots, memSlots_ + first, OFstatic_cast(size_t, count) * sizeof(StudyDescRecord));
+        return EC_Normal;
+    }
+    const long offset = OFstatic_cast(long, sizeof(Header) + OFstatic_cast(size_t, first) * sizeof(StudyDescRecord));
+    const size_t length = OFstatic_cast(size_t, count) * sizeof(StudyDescRecord);
+    if (lseek(fd_, offset, SEEK_SET) != offset)
+        return QR_EC_IndexDatabaseError;
+    char *buf = OFreinterpret_cast(char *, slots);
+    size_t done = 0;
+    while (done < length)
+    {
+        const long n = OFstatic_cast(long, read(fd_, buf + done, length - done));
+        if (n <= 0) return QR_EC_IndexDatabaseError;
+        done += OFstatic_cast(size_t, n);
+    }
+    return EC_Normal;
+}
+
+OFCondition DcmQueryRetrieveStudyTable::writeSlots(Uint32 first, Uint32 count, const StudyDescRecord *slots)
+{
+    if (memSlots_ != NULL)
+    {
+        memcpy(memSlots_ + first, slots, OFstatic_cast(size_t, count) * sizeof(StudyDescRecord));
+        return EC_Normal;
+    }
+    const long offset = OFstatic_cast(long, sizeof(Header) + OFstatic_cast(size_t, first) * sizeof(StudyDescRecord));
+    const size_t length = OFstatic_cast(size_t, count) * sizeof(StudyDescRecord);
+    if (lseek(fd_, offset, SEEK_SET) != offset)
+        return QR_EC_IndexDatabaseError;
+    const char *buf = OFreinterpret_cast(const char *, slots);
+    size_t done = 0;
+    while (done < length)
+    {
+        const long n = OFstatic_cast(long, write(fd_, buf + done, length - done));
+        if (n <= 0)
+        {
+            DCMQRDB_WARN("cannot write study table file");
+            return QR_EC_IndexDatabaseError;
+        }
+        done += OFstatic_cast(size_t, n);
+    }
+    return EC_Normal;
+}
+
+OFCondition DcmQueryRetrieveStudyTable::findSlot(const char *studyUID, Uint32 &slot, StudyDescRecord &study)
+{
+    const Uint32 mask = header_.NumSlots - 1;
+    StudyDescRecord page[STUDYTABLE_PAGE];
+    Uint32 pos = hashValue(studyUID) & mask;
+    Uint32 probed = 0;
+    OFBool haveFreeSlot = OFFalse;
+    while (probed < header_.NumSlots)
+    {
+        Uint32 count = header_.NumSlots - pos;
+        if (count > STUDYTABLE_PAGE) count = STUDYTABLE_PAGE;
+        if (readSlots(pos, count, page).bad()) return QR_EC_IndexDatabaseError;
+        for (Uint32 j = 0; j < count; ++j)
+        {
+            if (page[j].StudyInstanceUID[0] == '\0')
+            {
+                /* end of the hash chain, prefer a slot of a deleted study */
+                if (! haveFreeSlot)
+                {
+                    slot = pos + j;
+                    study = page[j];
+                }
+                return EC_Normal;
+            }
+            if (strcmp(page[j].StudyInstanceUID, studyUID) == 0)
+            {
+                slot = pos + j;
+                study = page[j];
+                return EC_Normal;
+            }
+            if ((page[j].NumberofRegistratedImages <= 0) && !haveFreeSlot)
+            {
+                slot = pos + j;
+                study = page[j];
+                haveFreeSlot = OFTrue;
+            }
+        }
+        probed += count;
+        pos = (pos + count) & mask;
+    }
+    return haveFreeSlot ? EC_Normal : QR_EC_IndexDatabaseError;
+}
+
+OFCondition DcmQueryRetrieveStudyTable::grow()
+{
+    /* read the complete hash table and insert all studies into a new one */
+    const Uint32 oldNumSlots = header_.NumSlots;
+    StudyDescRecord *oldSlots = new StudyDescRecord[oldNumSlots];
+    OFCondition result = readSlots(0, oldNumSlots, oldSlots);
+    if (result.good())
+    {
+        /* deleted studies are dropped, at most a third of the new table is in use */
+        const OFBool rebuilding = (memSlots_ != NULL);
+        Uint32 numSlots = STUDYTABLE_MIN_SLOTS;
+        while ((numSlots < (header_.NumStudies + 1) * 3) && (numSlots < 0x10000000UL)) numSlots *= 2;
+        delete[] memSlots_;
+        memSlots_ = new StudyDescRecord[numSlots];
+        memset(memSlots_, 0, numSlots * sizeof(StudyDescRecord));
+        header_.NumSlots = numSlots;
+        header_.NumUsed = 0;
+        header_.NumStudies = 0;
+        for (Uint32 i = 0; (i < oldNumSlots) && result.good(); ++i)
+        {
+            if (oldSlots[i].NumberofRegistratedImages > 0) result = updateStudy(oldSlots[i]);
+        }
+        if (! rebuilding)
+        {
+            StudyDescRecord *slots = memSlots_;
+            memSlots_ = NULL;
+            if (result.good())
+                result = writeSlots(0, numSlots, slots);
+            delete[] slots;
+        }
+    }
+    delete[] oldSlots;
+    return result;
+}
+
+OFCondition DcmQueryRetrieveStudyTable::setValid(OFBool valid)
+{
+    header_.Valid = valid ? 1 : 0;
+    return writeHeader();
+}
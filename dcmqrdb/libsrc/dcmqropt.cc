@@ -39,6 +39,7 @@ DcmQueryRetrieveOptions::DcmQueryRetrieveOptions()
 , itempad_(0)
 , maxAssociations_(20)
 , maxPDU_(ASC_DEFAULTMAXPDU)
+, moveSubAssociations_(1)
 , net_(NULL)
 , networkTransferSyntax_(EXS_Unknown)
 #ifndef DISABLE_COMPRESSION_EXTENSION
@@ -58,6 +59,8 @@ DcmQueryRetrieveOptions::DcmQueryRetrieveOptions()
 #else
 , singleProcess_(OFTrue)
 #endif
+, multiThread_(OFFalse)
+, storeJournal_(OFFalse)
 , supportPatientRoot_(OFTrue)
 #ifdef NO_PATIENTSTUDYONLY_SUPPORT
 , supportPatientStudyOnly_(OFFalse)
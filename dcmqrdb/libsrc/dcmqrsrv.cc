@@ -91,6 +91,68 @@ static void storeCallback(
 }
 
 
+#ifdef WITH_THREADS
+
+/** worker thread handling a single association in multi-thread mode
+ */
+class DcmQueryRetrieveAssociationThread: public OFThread
+{
+public:
+
+  /** constructor
+   *  @param scp SCP object that accepted the association
+   *  @param assoc association to be handled, owned by this thread once started
+   *  @param threadID ID of this thread, used in the process table of the SCP
+   */
+  DcmQueryRetrieveAssociationThread(DcmQueryRetrieveSCP& scp, T_ASC_Association *assoc, int threadID)
+  : OFThread()
+  , scp_(scp)
+  , assoc_(assoc)
+  , threadID_(threadID)
+  {
+  }
+
+  /// destructor
+  virtual ~DcmQueryRetrieveAssociationThread() { }
+
+  /** get the ID of this thread
+   *  @return thread ID
+   */
+  int threadID() const
+  {
+    return threadID_;
+  }
+
+protected:
+
+  /// handle the association and notify the SCP when done
+  virtual void run()
+  {
+    scp_.handleAssociation(assoc_, scp_.options_.correctUIDPadding_);
+    scp_.threadFinished(threadID_);
+  }
+
+private:
+
+  /// private undefined copy constructor
+  DcmQueryRetrieveAssociationThread(const DcmQueryRetrieveAssociationThread& other);
+
+  /// private undefined assignment operator
+  DcmQueryRetrieveAssociationThread& operator=(const DcmQueryRetrieveAssociationThread& other);
+
+  /// SCP object that accepted the association
+  DcmQueryRetrieveSCP& scp_;
+
+  /// association handled by this thread
+  T_ASC_Association *assoc_;
+
+  /// ID of this thread
+  int threadID_;
+};
+
+#endif
+
+
 /*
  * ============================================================================================================
  */
@@ -106,10 +168,32 @@ DcmQueryRetrieveSCP::DcmQueryRetrieveSCP(
 , dbCheckMoveIdentifier_(OFFalse)
 , factory_(factory)
 , options_(options)
+#ifdef WITH_THREADS
+, threads_()
+, finishedThreads_()
+, threadMutex_()
+, nextThreadID_(1)
+#endif
 {
 }
 
 
+DcmQueryRetrieveSCP::~DcmQueryRetrieveSCP()
+{
+#ifdef WITH_THREADS
+  /* wait for all associations handled by worker threads */
+  OFListIterator(DcmQueryRetrieveAssociationThread *) first = threads_.begin();
+  OFListIterator(DcmQueryRetrieveAssociationThread *) last = threads_.end();
+  while (first != last)
+  {
+    (*first)->join();
+    delete *first;
+    first = threads_.erase(first);
+  }
+#endif
+}
+
+
 OFCondition DcmQueryRetrieveSCP::dispatch(T_ASC_Association *assoc, OFBool correctUIDPadding)
 {
     OFCondition cond = EC_Normal;
@@ -1034,6 +1118,23 @@ OFCondition DcmQueryRetrieveSCP::waitForAssociation(T_ASC_Network * theNet)
             /* don't spawn a sub-process to handle the association */
             cond = handleAssociation(assoc, options_.correctUIDPadding_);
         }
+#ifdef WITH_THREADS
+        else if (options_.multiThread_)
+        {
+            /* start a worker thread to handle the association */
+            cond = startAssociationThread(assoc);
+            if (cond.good())
+            {
+                /* the association is owned by the worker thread now */
+                assoc = NULL;
+            }
+            else
+            {
+                cond = refuseAssociation(&assoc, CTN_CannotFork);
+                go_cleanup = OFTrue;
+            }
+        }
+#endif
 #ifdef HAVE_FORK
         else
         {
@@ -1065,7 +1166,7 @@ OFCondition DcmQueryRetrieveSCP::waitForAssociation(T_ASC_Network * theNet)
 
     // cleanup code
     OFCondition oldcond = cond;    /* store condition flag for later use */
-    if (!options_.singleProcess_ && (cond != ASC_SHUTDOWNAPPLICATION))
+    if (!options_.singleProcess_ && (cond != ASC_SHUTDOWNAPPLICATION) && (assoc != NULL))
     {
         /* the child will handle the association, we can drop it */
         cond = ASC_dropAssociation(assoc);
@@ -1088,9 +1189,78 @@ OFCondition DcmQueryRetrieveSCP::waitForAssociation(T_ASC_Network * theNet)
 void DcmQueryRetrieveSCP::cleanChildren()
 {
   processtable_.cleanChildren();
+#ifdef WITH_THREADS
+  joinFinishedThreads();
+#endif
+}
+
+
+#ifdef WITH_THREADS
+
+OFCondition DcmQueryRetrieveSCP::startAssociationThread(T_ASC_Association *assoc)
+{
+  int threadID = nextThreadID_++;
+  DcmQueryRetrieveAssociationThread *thread = new DcmQueryRetrieveAssociationThread(*this, assoc, threadID);
+
+  /* note the thread in the process table before it is started, so that it
+   * is counted for the limit of parallel associations
+   */
+  processtable_.addProcessToTable(threadID, assoc);
+  int result = thread->start();
+  if (result != 0)
+  {
+    OFString errStr;
+    OFThread::errorstr(errStr, result);
+    DCMQRDB_ERROR("Cannot create association thread: " << errStr);
+    processtable_.removeProcessFromTable(threadID);
+    delete thread;
+    return EC_IllegalCall;
+  }
+  threads_.push_back(thread);
+  return EC_Normal;
+}
+
+
+void DcmQueryRetrieveSCP::threadFinished(int threadID)
+{
+  threadMutex_.lock();
+  finishedThreads_.push_back(threadID);
+  threadMutex_.unlock();
 }
 
 
+void DcmQueryRetrieveSCP::joinFinishedThreads()
+{
+  OFList<int> finished;
+  threadMutex_.lock();
+  finished.splice(finished.end(), finishedThreads_);
+  threadMutex_.unlock();
+
+  OFListIterator(int) id = finished.begin();
+  while (id != finished.end())
+  {
+    OFListIterator(DcmQueryRetrieveAssociationThread *) first = threads_.begin();
+    OFListIterator(DcmQueryRetrieveAssociationThread *) last = threads_.end();
+    while (first != last)
+    {
+      if ((*first)->threadID() == *id)
+      {
+        (*first)->join();
+        delete *first;
+        threads_.erase(first);
+        break;
+      }
+      ++first;
+    }
+    processtable_.removeProcessFromTable(*id);
+    DCMQRDB_DEBUG("Cleaned up after association thread (" << *id << ")");
+    ++id;
+  }
+}
+
+#endif
+
+
 void DcmQueryRetrieveSCP::setDatabaseFlags(
   OFBool dbCheckFindIdentifier,
   OFBool dbCheckMoveIdentifier)
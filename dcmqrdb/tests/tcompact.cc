@@ -0,0 +1,174 @@
+/*
+ *
+ *  Copyright (C) 2016, OFFIS e.V.
+ *  All rights reserved.  See COPYRIGHT file for details.
+ *
+ *  This software and supporting documentation were developed by
+ *
+ *    OFFIS e.V.
+ *    R&D Division Health
+ *    Escherweg 2
+ *    D-26121 Oldenburg, Germany
+ *
+ *
+ *  Module:  dcmqrdb
+ *
+ *  Author:  OFFIS DICOM Team
+ *
+ *  Purpose: test the compact format of the index file and the conversion
+ *           of index files in the original format
+ *
+ */
+
+
+#include "dcmtk/config/osconfig.h"    /* make sure OS specific configuration is included first */
+
+#define INCLUDE_CSTDIO
+#define INCLUDE_CSTRING
+#include "dcmtk/ofstd/ofstdinc.h"
+
+#include "dcmtk/ofstd/oftest.h"
+#include "tqrhelp.h"
+
+
+/* return the size of the given file, -1 if it does not exist */
+static long fileSize(const OFString &filename)
+{
+    long size = -1;
+    FILE *f = fopen(filename.c_str(), "rb");
+    if (f != NULL)
+    {
+        if (fseek(f, 0, SEEK_END) == 0)
+            size = ftell(f);
+        fclose(f);
+    }
+    return size;
+}
+
+/* create an empty index file in the original format, i.e. with the area of study descriptors only */
+static void createLegacyIndexFile(const OFString &filename)
+{
+    FILE *f = fopen(filename.c_str(), "wb");
+    OFCHECK(f != NULL);
+    if (f != NULL)
+    {
+        char *buffer = new char[SIZEOF_STUDYDESC];
+        memset(buffer, 0, SIZEOF_STUDYDESC);
+        OFCHECK_EQUAL(fwrite(buffer, 1, SIZEOF_STUDYDESC, f), SIZEOF_STUDYDESC);
+        delete[] buffer;
+        fclose(f);
+    }
+}
+
+/* store the test instances, one of them with values that do not fit into a slot */
+static void storeInstances(DcmQueryRetrieveIndexDatabaseHandle &handle,
+                           QRTestStorageArea &area,
+                           const OFString &longValue)
+{
+    OFCHECK_EQUAL(qrStoreInstance(handle, area, "P1", "1.2.3.1", "1.2.3.1.1", "1.2.3.1.1.1"), STATUS_Success);
+    OFCHECK_EQUAL(qrStoreInstance(handle, area, "P1", "1.2.3.1", "1.2.3.1.1", "1.2.3.1.1.2"), STATUS_Success);
+    DcmDataset dset;
+    qrMakeInstance(dset, "P2", "1.2.3.2", "1.2.3.2.1", "1.2.3.2.1.1", "20160202");
+    /* values of maximum length for all long attributes of the index record */
+    dset.putAndInsertString(DCM_StudyDescription, longValue.c_str());
+    dset.putAndInsertString(DCM_SeriesDescription, longValue.c_str());
+    dset.putAndInsertString(DCM_ProtocolName, longValue.c_str());
+    dset.putAndInsertString(DCM_AdmittingDiagnosesDescription, longValue.c_str());
+    dset.putAndInsertString(DCM_OtherPatientIDs, longValue.c_str());
+    dset.putAndInsertString(DCM_OtherPatientNames, longValue.c_str());
+    dset.putAndInsertString(DCM_ReferringPhysicianName, longValue.c_str());
+    dset.putAndInsertString(DCM_NameOfPhysiciansReadingStudy, longValue.c_str());
+    dset.putAndInsertString(DCM_OperatorsName, longValue.c_str());
+    dset.putAndInsertString(DCM_PerformingPhysicianName, longValue.c_str());
+    OFCHECK_EQUAL(qrStoreDataset(handle, area, dset), STATUS_Success);
+}
+
+/* check the query results, which must not depend on the format of the index file */
+static void checkQueries(DcmQueryRetrieveIndexDatabaseHandle &handle,
+                         const OFString &longValue)
+{
+    OFCHECK_EQUAL(qrCount(handle, "STUDY", DCM_StudyInstanceUID, ""), 2);
+    OFCHECK_EQUAL(qrCount(handle, "STUDY", DCM_PatientID, "P1"), 1);
+    OFCHECK_EQUAL(qrCount(handle, "STUDY", DCM_StudyDescription, "*x*"), 1);
+    OFCHECK_EQUAL(qrCount(handle, "IMAGE", DCM_SOPInstanceUID, "", "1.2.3.1", "1.2.3.1.1"), 2);
+    /* the long values are returned completely */
+    DcmDataset query;
+    Uint16 finalStatus = 0;
+    OFList<OFString> values;
+    qrMakeQuery(query, "STUDY", DCM_StudyDescription, "", "1.2.3.2");
+    OFCHECK_EQUAL(qrFind(handle, query, finalStatus, DCM_StudyDescription, &values), 1);
+    OFCHECK_EQUAL(finalStatus, STATUS_Success);
+    OFCHECK(!values.empty() && (values.front() == longValue));
+    values.clear();
+    qrMakeQuery(query, "STUDY", DCM_AdmittingDiagnosesDescription, "", "1.2.3.2");
+    OFCHECK_EQUAL(qrFind(handle, query, finalStatus, DCM_AdmittingDiagnosesDescription, &values), 1);
+    OFCHECK(!values.empty() && (values.front() == longValue));
+}
+
+
+OFTEST(dcmqrdb_compactIndex)
+{
+    QRTestStorageArea area;
+    const OFString longValue(64, 'x');
+    OFCondition cond;
+    {
+        DcmQueryRetrieveIndexDatabaseHandle handle(area.path(), -1, -1, cond);
+        OFCHECK(cond.good());
+        /* new index files are created in the compact format */
+        OFCHECK(handle.isCompactIndexFile());
+        storeInstances(handle, area, longValue);
+        checkQueries(handle, longValue);
+    }
+    /* the records are much smaller than in the original format */
+    OFCHECK(fileSize(area.filePath(DBINDEXFILE)) < OFstatic_cast(long, 3 * SIZEOF_IDXRECORD));
+    /* the record with the long values is stored in the heap file */
+    OFCHECK(fileSize(area.filePath(DBHEAPFILE)) > 0);
+    {
+        DcmQueryRetrieveIndexDatabaseHandle handle(area.path(), -1, -1, cond);
+        OFCHECK(cond.good());
+        OFCHECK(handle.isCompactIndexFile());
+        checkQueries(handle, longValue);
+        /* records are reused after removal */
+        OFCHECK(handle.DB_lock(OFTrue).good());
+        OFCHECK(handle.DB_IdxRemove(0).good());
+        OFCHECK(handle.DB_unlock().good());
+        const long size = fileSize(area.filePath(DBINDEXFILE));
+        OFCHECK_EQUAL(qrStoreInstance(handle, area, "P1", "1.2.3.1", "1.2.3.1.1", "1.2.3.1.1.1"), STATUS_Success);
+        OFCHECK_EQUAL(fileSize(area.filePath(DBINDEXFILE)), size);
+        checkQueries(handle, longValue);
+    }
+}
+
+
+OFTEST(dcmqrdb_compactIndex_convert)
+{
+    QRTestStorageArea area;
+    const OFString longValue(64, 'x');
+    const OFString indexFile = area.filePath(DBINDEXFILE);
+    OFCondition cond;
+    createLegacyIndexFile(indexFile);
+    {
+        /* existing index files are used in the original format */
+        DcmQueryRetrieveIndexDatabaseHandle handle(area.path(), -1, -1, cond);
+        OFCHECK(cond.good());
+        OFCHECK(!handle.isCompactIndexFile());
+        storeInstances(handle, area, longValue);
+        checkQueries(handle, longValue);
+        OFCHECK_EQUAL(fileSize(indexFile), OFstatic_cast(long, SIZEOF_STUDYDESC + 3 * SIZEOF_IDXRECORD));
+        /* convert the index file in place */
+        OFCHECK(handle.convertIndexFile().good());
+        OFCHECK(handle.isCompactIndexFile());
+        checkQueries(handle, longValue);
+    }
+    {
+        DcmQueryRetrieveIndexDatabaseHandle handle(area.path(), -1, -1, cond);
+        OFCHECK(cond.good());
+        OFCHECK(handle.isCompactIndexFile());
+        checkQueries(handle, longValue);
+        OFCHECK_EQUAL(qrStoreInstance(handle, area, "P3", "1.2.3.3", "1.2.3.3.1", "1.2.3.3.1.1"), STATUS_Success);
+        OFCHECK_EQUAL(qrCount(handle, "STUDY", DCM_StudyInstanceUID, ""), 3);
+        /* converting a compact index file again does nothing */
+        OFCHECK(handle.convertIndexFile().good());
+        OFCHECK_EQUAL(qrCount(handle, "STUDY", DCM_StudyInstanceUID, ""), 3);
+    }
+}
@@ -0,0 +1,44 @@
+/*
+ *
+ *  Copyright (C) 2016, OFFIS e.V.
+ *  All rights reserved.  See COPYRIGHT file for details.
+ *
+ *  This software and supporting documentation were developed by
+ *
+ *    OFFIS e.V.
+ *    R&D Division Health
+ *    Escherweg 2
+ *    D-26121 Oldenburg, Germany
+ *
+ *
+ *  Module:  dcmqrdb
+ *
+ *  Author:  OFFIS DICOM Team
+ *
+ *  Purpose: main test program
+ *
+ */
+
+#include "dcmtk/config/osconfig.h"
+
+#include "dcmtk/ofstd/oftest.h"
+
+OFTEST_REGISTER(dcmqrdb_keyIndex_transaction);
+OFTEST_REGISTER(dcmqrdb_keyIndex_rebuild);
+OFTEST_REGISTER(dcmqrdb_compactIndex);
+OFTEST_REGISTER(dcmqrdb_compactIndex_convert);
+OFTEST_REGISTER(dcmqrdb_findDoesNotBlockStore);
+OFTEST_REGISTER(dcmqrdb_moveDoesNotBlockStore);
+OFTEST_REGISTER(dcmqrdb_maxFindResponses);
+OFTEST_REGISTER(dcmqrdb_summaryCache_separateAreas);
+OFTEST_REGISTER(dcmqrdb_summaryCache_recreatedArea);
+OFTEST_REGISTER(dcmqrdb_summaryCache_factory);
+
+#ifdef WITH_THREADS
+OFTEST_REGISTER(dcmqrdb_storeJournal_replay);
+OFTEST_REGISTER(dcmqrdb_storeJournal_refused);
+OFTEST_REGISTER(dcmqrdb_multiThreadServer);
+OFTEST_REGISTER(dcmqrdb_parallelMove);
+#endif // WITH_THREADS
+
+OFTEST_MAIN("dcmqrdb")
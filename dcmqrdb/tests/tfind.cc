@@ -0,0 +1,116 @@
+/*
+ *
+ *  Copyright (C) 2016, OFFIS e.V.
+ *  All rights reserved.  See COPYRIGHT file for details.
+ *
+ *  This software and supporting documentation were developed by
+ *
+ *    OFFIS e.V.
+ *    R&D Division Health
+ *    Escherweg 2
+ *    D-26121 Oldenburg, Germany
+ *
+ *
+ *  Module:  dcmqrdb
+ *
+ *  Author:  OFFIS DICOM Team
+ *
+ *  Purpose: test the limit of the number of C-FIND responses
+ *
+ */
+
+
+#include "dcmtk/config/osconfig.h"    /* make sure OS specific configuration is included first */
+
+#include "dcmtk/ofstd/oftest.h"
+#include "dcmtk/dcmqrdb/dcmqrcbf.h"
+#include "dcmtk/dcmqrdb/dcmqropt.h"
+#include "tqrhelp.h"
+
+
+/* call the find callback like the DIMSE layer does until the final response
+ * and return the number of pending responses with an identifier
+ */
+static int findWithLimit(DcmQueryRetrieveIndexDatabaseHandle &handle,
+                         OFCmdUnsignedInt maxResponses,
+                         Uint16 &finalStatus,
+                         OFString &errorComment)
+{
+    DcmQueryRetrieveOptions options;
+    options.maxFindResponses_ = maxResponses;
+    DcmQueryRetrieveFindContext context(handle, options, STATUS_Pending);
+    context.setOurAETitle("QRTEST");
+
+    DcmDataset query;
+    qrMakeQuery(query, "STUDY", DCM_StudyInstanceUID, "");
+    T_DIMSE_C_FindRQ request;
+    memset(&request, 0, sizeof(request));
+    OFStandard::strlcpy(request.AffectedSOPClassUID, UID_FINDStudyRootQueryRetrieveInformationModel, sizeof(request.AffectedSOPClassUID));
+
+    int count = 0;
+    int responseCount = 1;
+    errorComment.clear();
+    finalStatus = STATUS_Pending;
+    while (DICOM_PENDING_STATUS(finalStatus) && (responseCount < 100))
+    {
+        T_DIMSE_C_FindRSP response;
+        memset(&response, 0, sizeof(response));
+        DcmDataset *identifiers = NULL;
+        DcmDataset *statusDetail = NULL;
+        context.callbackHandler(OFFalse, &request, &query, responseCount++, &response, &identifiers, &statusDetail);
+        finalStatus = response.DimseStatus;
+        if (DICOM_PENDING_STATUS(finalStatus))
+        {
+            OFCHECK(identifiers != NULL);
+            if (identifiers != NULL)
+                ++count;
+        } else {
+            /* the final response has no identifier */
+            OFCHECK(identifiers == NULL);
+        }
+        if (statusDetail != NULL)
+            statusDetail->findAndGetOFString(DCM_ErrorComment, errorComment);
+        delete identifiers;
+        delete statusDetail;
+    }
+    return count;
+}
+
+
+OFTEST(dcmqrdb_maxFindResponses)
+{
+    QRTestStorageArea area;
+    OFCondition cond;
+    DcmQueryRetrieveIndexDatabaseHandle handle(area.path(), -1, -1, cond);
+    OFCHECK(cond.good());
+    OFCHECK_EQUAL(qrStoreInstance(handle, area, "P1", "1.2.3.1", "1.2.3.1.1", "1.2.3.1.1.1"), STATUS_Success);
+    OFCHECK_EQUAL(qrStoreInstance(handle, area, "P2", "1.2.3.2", "1.2.3.2.1", "1.2.3.2.1.1"), STATUS_Success);
+    OFCHECK_EQUAL(qrStoreInstance(handle, area, "P3", "1.2.3.3", "1.2.3.3.1", "1.2.3.3.1.1"), STATUS_Success);
+
+    Uint16 finalStatus = 0;
+    OFString errorComment;
+
+    /* no limit */
+    OFCHECK_EQUAL(findWithLimit(handle, 0, finalStatus, errorComment), 3);
+    OFCHECK_EQUAL(finalStatus, STATUS_Success);
+    OFCHECK(errorComment.empty());
+
+    /* limit above and exactly at the number of matches */
+    OFCHECK_EQUAL(findWithLimit(handle, 4, finalStatus, errorComment), 3);
+    OFCHECK_EQUAL(finalStatus, STATUS_Success);
+    OFCHECK(errorComment.empty());
+    OFCHECK_EQUAL(findWithLimit(handle, 3, finalStatus, errorComment), 3);
+    OFCHECK_EQUAL(finalStatus, STATUS_Success);
+    OFCHECK(errorComment.empty());
+
+    /* more matches than permitted */
+    OFCHECK_EQUAL(findWithLimit(handle, 2, finalStatus, errorComment), 2);
+    OFCHECK_EQUAL(finalStatus, STATUS_FIND_Refused_OutOfResources);
+    OFCHECK_EQUAL(errorComment, "Too many matches, limit is 2");
+    OFCHECK_EQUAL(findWithLimit(handle, 1, finalStatus, errorComment), 1);
+    OFCHECK_EQUAL(finalStatus, STATUS_FIND_Refused_OutOfResources);
+    OFCHECK_EQUAL(errorComment, "Too many matches, limit is 1");
+
+    /* the terminated request does not affect the next one */
+    OFCHECK_EQUAL(qrCount(handle, "STUDY", DCM_StudyInstanceUID, ""), 3);
+}
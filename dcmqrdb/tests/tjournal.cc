@@ -0,0 +1,220 @@
+/*
+ *
+ *  Copyright (C) 2016, OFFIS e.V.
+ *  All rights reserved.  See COPYRIGHT file for details.
+ *
+ *  This software and supporting documentation were developed by
+ *
+ *    OFFIS e.V.
+ *    R&D Division Health
+ *    Escherweg 2
+ *    D-26121 Oldenburg, Germany
+ *
+ *
+ *  Module:  dcmqrdb
+ *
+ *  Author:  OFFIS DICOM Team
+ *
+ *  Purpose: test the replay of store journals left by terminated processes
+ *
+ */
+
+
+#include "dcmtk/config/osconfig.h"    /* make sure OS specific configuration is included first */
+
+#ifdef WITH_THREADS
+
+#define INCLUDE_CSTDIO
+#include "dcmtk/ofstd/ofstdinc.h"
+
+BEGIN_EXTERN_C
+#ifdef HAVE_FCNTL_H
+#include <fcntl.h>
+#endif
+END_EXTERN_C
+
+#include "dcmtk/ofstd/oftest.h"
+#include "dcmtk/dcmnet/dcompat.h"     /* for dcmtk_flock() */
+#include "dcmtk/dcmqrdb/dcmqrdbj.h"
+#include "tqrhelp.h"
+
+
+/* write a journal file with the given objects as left by a terminated
+ * process. The last line is incomplete, like after a crash during an append.
+ * @return name of the journal file, empty in case of error
+ */
+static OFString writeJournal(const OFString &directory,
+                             const char *name,
+                             const OFList<OFString> &sopUIDs,
+                             const OFList<OFString> &files)
+{
+    OFString filename;
+    OFStandard::combineDirAndFilename(filename, directory, name);
+    FILE *f = fopen(filename.c_str(), "w");
+    if (f == NULL)
+        return "";
+    OFListConstIterator(OFString) uid = sopUIDs.begin();
+    OFListConstIterator(OFString) file = files.begin();
+    while ((uid != sopUIDs.end()) && (file != files.end()))
+    {
+        fprintf(f, "N\t%s\t%s\t%s\n", UID_SecondaryCaptureImageStorage, (*uid).c_str(), (*file).c_str());
+        ++uid;
+        ++file;
+    }
+    fprintf(f, "N\t%s\t1.2.3.9.9", UID_SecondaryCaptureImageStorage);
+    fclose(f);
+    return filename;
+}
+
+/* write instances of the given series to the storage area without registering them */
+static void writeInstances(QRTestStorageArea &area,
+                           const char *patientID,
+                           const char *studyUID,
+                           const char *seriesUID,
+                           unsigned int count,
+                           OFList<OFString> &sopUIDs,
+                           OFList<OFString> &files)
+{
+    for (unsigned int i = 1; i <= count; ++i)
+    {
+        char sopUID[64];
+        sprintf(sopUID, "%s.%u", seriesUID, i);
+        DcmDataset dset;
+        qrMakeInstance(dset, patientID, studyUID, seriesUID, sopUID);
+        const OFString filename = qrWriteDataset(area, dset);
+        OFCHECK(!filename.empty());
+        sopUIDs.push_back(sopUID);
+        files.push_back(filename);
+    }
+}
+
+
+OFTEST(dcmqrdb_storeJournal_replay)
+{
+    QRTestStorageArea area;
+    const OFString directory = area.filePath(DBJOURNALDIR);
+    OFCHECK(OFStandard::createDirectory(directory, area.path()).good());
+
+    /* journal of a terminated process */
+    OFList<OFString> deadUIDs;
+    OFList<OFString> deadFiles;
+    writeInstances(area, "P1", "1.2.3.1", "1.2.3.1.1", 2, deadUIDs, deadFiles);
+    const OFString deadJournal = writeJournal(directory, "99999-0.jnl", deadUIDs, deadFiles);
+    OFCHECK(!deadJournal.empty());
+
+    /* journal of a running process, which holds the lock on it */
+    OFList<OFString> liveUIDs;
+    OFList<OFString> liveFiles;
+    writeInstances(area, "P2", "1.2.3.2", "1.2.3.2.1", 1, liveUIDs, liveFiles);
+    const OFString liveJournal = writeJournal(directory, "99998-0.jnl", liveUIDs, liveFiles);
+    OFCHECK(!liveJournal.empty());
+    const int liveFd = open(liveJournal.c_str(), O_RDONLY);
+    OFCHECK(liveFd >= 0);
+    OFCHECK(dcmtk_flock(liveFd, LOCK_EX | LOCK_NB) == 0);
+
+    OFCondition cond;
+    DcmQueryRetrieveIndexDatabaseHandle handle(area.path(), -1, -1, cond);
+    OFCHECK(cond.good());
+    OFCHECK_EQUAL(qrCount(handle, "IMAGE", DCM_SOPInstanceUID, "", "1.2.3.1", "1.2.3.1.1"), 0);
+
+    /* the first object stored through the journal replays the journal of
+     * the terminated process, but not the one of the running process
+     */
+    handle.enableStoreJournal(OFTrue);
+    OFCHECK_EQUAL(qrStoreInstance(handle, area, "P3", "1.2.3.3", "1.2.3.3.1", "1.2.3.3.1.1"), STATUS_Success);
+    DcmQueryRetrieveStoreJournal::flushAll();
+
+    OFCHECK_EQUAL(qrCount(handle, "IMAGE", DCM_SOPInstanceUID, "", "1.2.3.1", "1.2.3.1.1"), 2);
+    OFCHECK_EQUAL(qrCount(handle, "IMAGE", DCM_SOPInstanceUID, "", "1.2.3.3", "1.2.3.3.1"), 1);
+    OFCHECK_EQUAL(qrCount(handle, "IMAGE", DCM_SOPInstanceUID, "", "1.2.3.2", "1.2.3.2.1"), 0);
+    OFCHECK_EQUAL(qrCount(handle, "STUDY", DCM_StudyInstanceUID, ""), 2);
+    OFCHECK(!OFStandard::fileExists(deadJournal));
+    OFCHECK(OFStandard::fileExists(liveJournal));
+
+    if (liveFd >= 0)
+    {
+        dcmtk_flock(liveFd, LOCK_UN);
+        close(liveFd);
+    }
+
+    /* remove the journal directory, the journal of this process remains open */
+    OFList<OFString> files;
+    OFStandard::searchDirectoryRecursively(directory, files);
+    for (OFListIterator(OFString) it = files.begin(); it != files.end(); ++it)
+        OFStandard::deleteFile(*it);
+#ifdef _WIN32
+    _rmdir(directory.c_str());
+#else
+    rmdir(directory.c_str());
+#endif
+}
+
+
+OFTEST(dcmqrdb_storeJournal_refused)
+{
+    QRTestStorageArea area;
+    const OFString directory = area.filePath(DBJOURNALDIR);
+    OFCHECK(OFStandard::createDirectory(directory, area.path()).good());
+
+    /* journal of a terminated process with two objects that fit into the
+     * quota, one object that exceeds it and a file that cannot be parsed
+     */
+    OFList<OFString> uids;
+    OFList<OFString> files;
+    writeInstances(area, "P1", "1.2.3.1", "1.2.3.1.1", 2, uids, files);
+    DcmDataset dset;
+    qrMakeInstance(dset, "P2", "1.2.3.2", "1.2.3.2.1", "1.2.3.2.1.1");
+    dset.putAndInsertString(DCM_ImageComments, OFString(8192, 'x').c_str());
+    const OFString largeFile = qrWriteDataset(area, dset);
+    OFCHECK(!largeFile.empty());
+    uids.push_back("1.2.3.2.1.1");
+    files.push_back(largeFile);
+    const OFString invalidFile = area.newInstanceFile();
+    FILE *f = fopen(invalidFile.c_str(), "w");
+    OFCHECK(f != NULL);
+    if (f != NULL)
+    {
+        fputs("this is not a DICOM file", f);
+        fclose(f);
+    }
+    uids.push_back("1.2.3.2.1.2");
+    files.push_back(invalidFile);
+    const OFString journal = writeJournal(directory, "99999-0.jnl", uids, files);
+    OFCHECK(!journal.empty());
+
+    OFCondition cond;
+    DcmQueryRetrieveIndexDatabaseHandle handle(area.path(), -1, 4096, cond);
+    OFCHECK(cond.good());
+
+    /* the refused objects have been acknowledged already, but they must
+     * not remain in the storage area without being indexed
+     */
+    handle.enableStoreJournal(OFTrue);
+    OFCHECK_EQUAL(qrStoreInstance(handle, area, "P3", "1.2.3.3", "1.2.3.3.1", "1.2.3.3.1.1"), STATUS_Success);
+    DcmQueryRetrieveStoreJournal::flushAll();
+
+    OFCHECK_EQUAL(qrCount(handle, "IMAGE", DCM_SOPInstanceUID, "", "1.2.3.1", "1.2.3.1.1"), 2);
+    OFCHECK_EQUAL(qrCount(handle, "IMAGE", DCM_SOPInstanceUID, "", "1.2.3.3", "1.2.3.3.1"), 1);
+    OFCHECK_EQUAL(qrCount(handle, "IMAGE", DCM_SOPInstanceUID, "", "1.2.3.2", "1.2.3.2.1"), 0);
+    for (OFListIterator(OFString) it = files.begin(); it != files.end(); ++it)
+    {
+        if ((*it == largeFile) || (*it == invalidFile))
+            OFCHECK(!OFStandard::fileExists(*it));
+        else
+            OFCHECK(OFStandard::fileExists(*it));
+    }
+    OFCHECK(!OFStandard::fileExists(journal));
+
+    /* remove the journal directory, the journal of this process remains open */
+    OFList<OFString> journalFiles;
+    OFStandard::searchDirectoryRecursively(directory, journalFiles);
+    for (OFListIterator(OFString) it = journalFiles.begin(); it != journalFiles.end(); ++it)
+        OFStandard::deleteFile(*it);
+#ifdef _WIN32
+    _rmdir(directory.c_str());
+#else
+    rmdir(directory.c_str());
+#endif
+}
+
+#endif // WITH_THREADS
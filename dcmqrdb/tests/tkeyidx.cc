@@ -0,0 +1,166 @@
+/*
+ *
+ *  Copyright (C) 2016, OFFIS e.V.
+ *  All rights reserved.  See COPYRIGHT file for details.
+ *
+ *  This software and supporting documentation were developed by
+ *
+ *    OFFIS e.V.
+ *    R&D Division Health
+ *    Escherweg 2
+ *    D-26121 Oldenburg, Germany
+ *
+ *
+ *  Module:  dcmqrdb
+ *
+ *  Author:  OFFIS DICOM Team
+ *
+ *  Purpose: test the key index of the index database (index.key)
+ *
+ */
+
+
+#include "dcmtk/config/osconfig.h"    /* make sure OS specific configuration is included first */
+
+#define INCLUDE_CSTDIO
+#define INCLUDE_CSTRING
+#include "dcmtk/ofstd/ofstdinc.h"
+
+#include "dcmtk/ofstd/oftest.h"
+#include "dcmtk/dcmqrdb/dcmqrdbk.h"
+#include "tqrhelp.h"
+
+/* offset of the "valid" flag in the header of the key index file */
+#define KEYINDEX_VALID_OFFSET 24
+
+
+/* read the "valid" flag of the key index file */
+static Uint32 readValidFlag(const OFString &filename)
+{
+    Uint32 valid = 0xffffffff;
+    FILE *f = fopen(filename.c_str(), "rb");
+    if (f != NULL)
+    {
+        if ((fseek(f, KEYINDEX_VALID_OFFSET, SEEK_SET) != 0) || (fread(&valid, sizeof(valid), 1, f) != 1))
+            valid = 0xffffffff;
+        fclose(f);
+    }
+    return valid;
+}
+
+/* overwrite part of the key index file */
+static void corruptFile(const OFString &filename, long offset, const char *data, size_t length)
+{
+    FILE *f = fopen(filename.c_str(), "r+b");
+    OFCHECK(f != NULL);
+    if (f != NULL)
+    {
+        OFCHECK(fseek(f, offset, SEEK_SET) == 0);
+        OFCHECK(fwrite(data, 1, length, f) == length);
+        fclose(f);
+    }
+}
+
+/* store the test instances: two studies with three instances each */
+static void storeInstances(DcmQueryRetrieveIndexDatabaseHandle &handle, QRTestStorageArea &area)
+{
+    OFCHECK_EQUAL(qrStoreInstance(handle, area, "P1", "1.2.3.1", "1.2.3.1.1", "1.2.3.1.1.1"), STATUS_Success);
+    OFCHECK_EQUAL(qrStoreInstance(handle, area, "P1", "1.2.3.1", "1.2.3.1.1", "1.2.3.1.1.2"), STATUS_Success);
+    OFCHECK_EQUAL(qrStoreInstance(handle, area, "P1", "1.2.3.1", "1.2.3.1.2", "1.2.3.1.2.1"), STATUS_Success);
+    OFCHECK_EQUAL(qrStoreInstance(handle, area, "P2", "1.2.3.2", "1.2.3.2.1", "1.2.3.2.1.1", "20160202"), STATUS_Success);
+    OFCHECK_EQUAL(qrStoreInstance(handle, area, "P2", "1.2.3.2", "1.2.3.2.1", "1.2.3.2.1.2", "20160202"), STATUS_Success);
+    OFCHECK_EQUAL(qrStoreInstance(handle, area, "P2", "1.2.3.2", "1.2.3.2.1", "1.2.3.2.1.3", "20160202"), STATUS_Success);
+}
+
+/* check that the key index file is valid and returns the expected candidates */
+static void checkKeyIndex(const OFString &filename)
+{
+    DcmQueryRetrieveKeyIndex keyIndex;
+    OFCHECK(keyIndex.open(filename.c_str()).good());
+    OFCHECK(keyIndex.isValid());
+    OFVector<int> records;
+    OFCHECK(keyIndex.findRecords(DCM_SOPInstanceUID, "1.2.3.2.1.3", records).good());
+    OFCHECK_EQUAL(records.size(), 1);
+    OFCHECK(keyIndex.findRecords(DCM_StudyInstanceUID, "1.2.3.1", records).good());
+    OFCHECK(records.size() >= 3);
+    OFCHECK(keyIndex.findRecords(DCM_PatientID, "P2", records).good());
+    OFCHECK(records.size() >= 3);
+    keyIndex.close();
+}
+
+/* check the query results, which do not depend on the state of the key index */
+static void checkQueries(DcmQueryRetrieveIndexDatabaseHandle &handle)
+{
+    OFCHECK_EQUAL(qrCount(handle, "STUDY", DCM_StudyInstanceUID, "1.2.3.1"), 1);
+    OFCHECK_EQUAL(qrCount(handle, "STUDY", DCM_PatientID, "P2"), 1);
+    OFCHECK_EQUAL(qrCount(handle, "STUDY", DCM_StudyDate, "20160202"), 1);
+    OFCHECK_EQUAL(qrCount(handle, "SERIES", DCM_SeriesInstanceUID, "1.2.3.1.2", "1.2.3.1"), 1);
+    OFCHECK_EQUAL(qrCount(handle, "IMAGE", DCM_SOPInstanceUID, "1.2.3.2.1.3", "1.2.3.2", "1.2.3.2.1"), 1);
+    OFCHECK_EQUAL(qrCount(handle, "IMAGE", DCM_SOPInstanceUID, "1.2.3.2.1.9", "1.2.3.2", "1.2.3.2.1"), 0);
+}
+
+
+OFTEST(dcmqrdb_keyIndex_transaction)
+{
+    QRTestStorageArea area;
+    const OFString keyFile = area.filePath(DBKEYINDEXFILE);
+    OFCondition cond;
+    DcmQueryRetrieveIndexDatabaseHandle handle(area.path(), -1, -1, cond);
+    OFCHECK(cond.good());
+    storeInstances(handle, area);
+    /* the key index is marked as valid after each completed update */
+    OFCHECK_EQUAL(readValidFlag(keyFile), 1);
+    checkKeyIndex(keyFile);
+    checkQueries(handle);
+    /* an update transaction that has not been committed leaves the key index invalid */
+    OFCHECK(handle.DB_lock(OFTrue).good());
+    OFCHECK(handle.DB_IdxRemove(0).good());
+    OFCHECK_EQUAL(readValidFlag(keyFile), 0);
+    OFCHECK(handle.DB_unlock().good());
+    OFCHECK_EQUAL(readValidFlag(keyFile), 1);
+}
+
+
+OFTEST(dcmqrdb_keyIndex_rebuild)
+{
+    QRTestStorageArea area;
+    const OFString keyFile = area.filePath(DBKEYINDEXFILE);
+    OFCondition cond;
+    {
+        DcmQueryRetrieveIndexDatabaseHandle handle(area.path(), -1, -1, cond);
+        OFCHECK(cond.good());
+        storeInstances(handle, area);
+    }
+    OFCHECK_EQUAL(readValidFlag(keyFile), 1);
+
+    /* simulate an interrupted update: the file is marked as invalid and the hash table is garbage */
+    char garbage[256];
+    memset(garbage, 0x5a, sizeof(garbage));
+    const Uint32 invalid = 0;
+    corruptFile(keyFile, KEYINDEX_VALID_OFFSET, OFreinterpret_cast(const char *, &invalid), sizeof(invalid));
+    corruptFile(keyFile, KEYINDEX_VALID_OFFSET + 4, garbage, sizeof(garbage));
+    {
+        DcmQueryRetrieveIndexDatabaseHandle handle(area.path(), -1, -1, cond);
+        OFCHECK(cond.good());
+        /* the invalid key index is not used for queries */
+        checkQueries(handle);
+        /* the next writer rebuilds the key index */
+        OFCHECK_EQUAL(qrStoreInstance(handle, area, "P3", "1.2.3.3", "1.2.3.3.1", "1.2.3.3.1.1"), STATUS_Success);
+        OFCHECK_EQUAL(readValidFlag(keyFile), 1);
+        checkKeyIndex(keyFile);
+        checkQueries(handle);
+        OFCHECK_EQUAL(qrCount(handle, "STUDY", DCM_StudyInstanceUID, "1.2.3.3"), 1);
+    }
+
+    /* a key index file with a corrupted header is rebuilt as well */
+    corruptFile(keyFile, 0, garbage, 16);
+    {
+        DcmQueryRetrieveIndexDatabaseHandle handle(area.path(), -1, -1, cond);
+        OFCHECK(cond.good());
+        OFCHECK(handle.DB_lock(OFTrue).good());
+        OFCHECK(handle.DB_unlock().good());
+        OFCHECK_EQUAL(readValidFlag(keyFile), 1);
+        checkKeyIndex(keyFile);
+        checkQueries(handle);
+    }
+}
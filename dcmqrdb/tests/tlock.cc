@@ -0,0 +1,175 @@
+/*
+ *
+ *  Copyright (C) 2016, OFFIS e.V.
+ *  All rights reserved.  See COPYRIGHT file for details.
+ *
+ *  This software and supporting documentation were developed by
+ *
+ *    OFFIS e.V.
+ *    R&D Division Health
+ *    Escherweg 2
+ *    D-26121 Oldenburg, Germany
+ *
+ *
+ *  Module:  dcmqrdb
+ *
+ *  Author:  OFFIS DICOM Team
+ *
+ *  Purpose: test that pending C-FIND and C-MOVE requests do not hold the
+ *           lock on the index file and thus do not block storage requests
+ *
+ */
+
+
+#include "dcmtk/config/osconfig.h"    /* make sure OS specific configuration is included first */
+
+#define INCLUDE_CSTDIO
+#define INCLUDE_CSTRING
+#include "dcmtk/ofstd/ofstdinc.h"
+
+BEGIN_EXTERN_C
+#ifdef HAVE_FCNTL_H
+#include <fcntl.h>
+#endif
+END_EXTERN_C
+
+#include "dcmtk/ofstd/oftest.h"
+#include "dcmtk/dcmnet/dcompat.h"     /* for dcmtk_flock() */
+#include "tqrhelp.h"
+
+
+/* check whether the index file can be locked exclusively, i.e. whether no
+ * other handle holds a lock on it. The check does not block.
+ */
+static OFBool indexFileUnlocked(const QRTestStorageArea &area)
+{
+    OFBool result = OFFalse;
+#ifdef O_BINARY
+    const int fd = open(area.filePath(DBINDEXFILE).c_str(), O_RDWR | O_BINARY);
+#else
+    const int fd = open(area.filePath(DBINDEXFILE).c_str(), O_RDWR);
+#endif
+    if (fd >= 0)
+    {
+        if (dcmtk_flock(fd, LOCK_EX | LOCK_NB) == 0)
+        {
+            dcmtk_flock(fd, LOCK_UN);
+            result = OFTrue;
+        }
+        close(fd);
+    }
+    return result;
+}
+
+/* store three studies with two instances each */
+static void storeStudies(DcmQueryRetrieveIndexDatabaseHandle &handle,
+                         QRTestStorageArea &area)
+{
+    OFCHECK_EQUAL(qrStoreInstance(handle, area, "P1", "1.2.3.1", "1.2.3.1.1", "1.2.3.1.1.1"), STATUS_Success);
+    OFCHECK_EQUAL(qrStoreInstance(handle, area, "P1", "1.2.3.1", "1.2.3.1.1", "1.2.3.1.1.2"), STATUS_Success);
+    OFCHECK_EQUAL(qrStoreInstance(handle, area, "P2", "1.2.3.2", "1.2.3.2.1", "1.2.3.2.1.1"), STATUS_Success);
+    OFCHECK_EQUAL(qrStoreInstance(handle, area, "P2", "1.2.3.2", "1.2.3.2.1", "1.2.3.2.1.2"), STATUS_Success);
+    OFCHECK_EQUAL(qrStoreInstance(handle, area, "P3", "1.2.3.3", "1.2.3.3.1", "1.2.3.3.1.1"), STATUS_Success);
+    OFCHECK_EQUAL(qrStoreInstance(handle, area, "P3", "1.2.3.3", "1.2.3.3.1", "1.2.3.3.1.2"), STATUS_Success);
+}
+
+
+OFTEST(dcmqrdb_findDoesNotBlockStore)
+{
+    QRTestStorageArea area;
+    OFCondition cond;
+    DcmQueryRetrieveIndexDatabaseHandle reader(area.path(), -1, -1, cond);
+    OFCHECK(cond.good());
+    DcmQueryRetrieveIndexDatabaseHandle writer(area.path(), -1, -1, cond);
+    OFCHECK(cond.good());
+    storeStudies(writer, area);
+
+    DcmDataset query;
+    qrMakeQuery(query, "STUDY", DCM_StudyInstanceUID, "");
+    DcmQueryRetrieveDatabaseStatus status;
+    OFCHECK(reader.startFindRequest(UID_FINDStudyRootQueryRetrieveInformationModel, &query, &status).good());
+    OFCHECK_EQUAL(status.status(), STATUS_Pending);
+    int count = 0;
+    unsigned int stored = 0;
+    while (status.status() == STATUS_Pending)
+    {
+        /* the index file is not locked while the response is sent.
+         * Otherwise, the following store would block forever.
+         */
+        const OFBool unlocked = indexFileUnlocked(area);
+        OFCHECK(unlocked);
+        if (unlocked && (stored < 2))
+        {
+            /* new instances of an existing study and of a new study */
+            if (stored == 0)
+                OFCHECK_EQUAL(qrStoreInstance(writer, area, "P1", "1.2.3.1", "1.2.3.1.1", "1.2.3.1.1.3"), STATUS_Success);
+            else
+                OFCHECK_EQUAL(qrStoreInstance(writer, area, "P4", "1.2.3.4", "1.2.3.4.1", "1.2.3.4.1.1"), STATUS_Success);
+            ++stored;
+        }
+        DcmDataset *response = NULL;
+        if (reader.nextFindResponse(&response, &status).bad())
+            break;
+        if (response != NULL)
+        {
+            ++count;
+            delete response;
+        }
+    }
+    OFCHECK_EQUAL(status.status(), STATUS_Success);
+    OFCHECK(indexFileUnlocked(area));
+    /* each study is reported once; the study stored during the query may or may not be reported */
+    OFCHECK((count == 3) || (count == 4));
+    OFCHECK_EQUAL(stored, 2);
+    /* the next query sees all studies */
+    OFCHECK_EQUAL(qrCount(reader, "STUDY", DCM_StudyInstanceUID, ""), 4);
+    OFCHECK_EQUAL(qrCount(reader, "IMAGE", DCM_SOPInstanceUID, "", "1.2.3.1", "1.2.3.1.1"), 3);
+}
+
+
+OFTEST(dcmqrdb_moveDoesNotBlockStore)
+{
+    QRTestStorageArea area;
+    OFCondition cond;
+    DcmQueryRetrieveIndexDatabaseHandle reader(area.path(), -1, -1, cond);
+    OFCHECK(cond.good());
+    DcmQueryRetrieveIndexDatabaseHandle writer(area.path(), -1, -1, cond);
+    OFCHECK(cond.good());
+    storeStudies(writer, area);
+
+    DcmDataset query;
+    query.putAndInsertString(DCM_QueryRetrieveLevel, "STUDY");
+    query.putAndInsertString(DCM_StudyInstanceUID, "1.2.3.2");
+    DcmQueryRetrieveDatabaseStatus status;
+    OFCHECK(reader.startMoveRequest(UID_MOVEStudyRootQueryRetrieveInformationModel, &query, &status).good());
+    OFCHECK_EQUAL(status.status(), STATUS_Pending);
+    const OFBool unlocked = indexFileUnlocked(area);
+    OFCHECK(unlocked);
+
+    /* an instance stored during the retrieval is not part of it */
+    if (unlocked)
+        OFCHECK_EQUAL(qrStoreInstance(writer, area, "P2", "1.2.3.2", "1.2.3.2.1", "1.2.3.2.1.3"), STATUS_Success);
+
+    char sopClass[128];
+    char sopInstance[128];
+    char filename[MAXPATHLEN + 1];
+    unsigned short remaining = 0;
+    OFList<OFString> instances;
+    while (status.status() == STATUS_Pending)
+    {
+        OFCHECK(indexFileUnlocked(area));
+        if (reader.nextMoveResponse(sopClass, sopInstance, filename, &remaining, &status).bad())
+            break;
+        if (status.status() == STATUS_Pending)
+        {
+            instances.push_back(sopInstance);
+            OFCHECK_EQUAL(OFString(sopClass), UID_SecondaryCaptureImageStorage);
+            OFCHECK(OFStandard::fileExists(filename));
+        }
+    }
+    OFCHECK_EQUAL(status.status(), STATUS_Success);
+    OFCHECK_EQUAL(instances.size(), 2);
+    OFCHECK_EQUAL(remaining, 0);
+    OFCHECK(indexFileUnlocked(area));
+    OFCHECK_EQUAL(qrCount(reader, "IMAGE", DCM_SOPInstanceUID, "", "1.2.3.2", "1.2.3.2.1"), 3);
+}
@@ -0,0 +1,280 @@
+/*
+ *
+ *  Copyright (C) 2016, OFFIS e.V.
+ *  All rights reserved.  See COPYRIGHT file for details.
+ *
+ *  This software and supporting documentation were developed by
+ *
+ *    OFFIS e.V.
+ *    R&D Division Health
+ *    Escherweg 2
+ *    D-26121 Oldenburg, Germany
+ *
+ *
+ *  Module:  dcmqrdb
+ *
+ *  Author:  OFFIS DICOM Team
+ *
+ *  Purpose: helper functions for the dcmqrdb tests, which create a
+ *           temporary storage area and fill it with test instances
+ *
+ */
+
+#ifndef TQRHELP_H
+#define TQRHELP_H
+
+#include "dcmtk/config/osconfig.h"    /* make sure OS specific configuration is included first */
+
+BEGIN_EXTERN_C
+#ifdef HAVE_UNISTD_H
+#include <unistd.h>
+#endif
+#ifdef _WIN32
+#include <direct.h>     /* for _rmdir() */
+#endif
+END_EXTERN_C
+
+#include "dcmtk/ofstd/ofstd.h"
+#include "dcmtk/ofstd/oflist.h"
+#include "dcmtk/ofstd/oftempf.h"
+#include "dcmtk/dcmdata/dcfilefo.h"
+#include "dcmtk/dcmdata/dcdatset.h"
+#include "dcmtk/dcmdata/dcdeftag.h"
+#include "dcmtk/dcmdata/dcuid.h"
+#include "dcmtk/dcmqrdb/dcmqrdbi.h"
+#include "dcmtk/dcmqrdb/dcmqrdbs.h"
+#include "dcmtk/dcmqrdb/dcmqridx.h"
+
+/** temporary storage area, which is removed with all its files by the destructor
+ */
+class QRTestStorageArea
+{
+public:
+
+    QRTestStorageArea()
+    : directory_()
+    , counter_(0)
+    {
+        // use the name of a temporary file for the directory. The name of a
+        // deleted temporary file can be returned again, so add a counter.
+        static unsigned int areaCounter = 0;
+        char suffix[32];
+        sprintf(suffix, ".qr%u", ++areaCounter);
+        OFTempFile temp;
+        directory_ = temp.getFilename();
+        directory_ += suffix;
+        OFStandard::createDirectory(directory_, "");
+    }
+
+    ~QRTestStorageArea()
+    {
+        OFList<OFString> files;
+        OFStandard::searchDirectoryRecursively(directory_, files);
+        for (OFListIterator(OFString) it = files.begin(); it != files.end(); ++it)
+            OFStandard::deleteFile(*it);
+#ifdef _WIN32
+        _rmdir(directory_.c_str());
+#else
+        rmdir(directory_.c_str());
+#endif
+    }
+
+    /// return the path of the storage area
+    const char *path() const
+    {
+        return directory_.c_str();
+    }
+
+    /// return the path of the given file in the storage area
+    OFString filePath(const char *name) const
+    {
+        OFString result(directory_);
+        result += PATH_SEPARATOR;
+        result += name;
+        return result;
+    }
+
+    /// create a new file name for an instance
+    OFString newInstanceFile()
+    {
+        char name[32];
+        sprintf(name, "IMG%05u.dcm", ++counter_);
+        return filePath(name);
+    }
+
+private:
+
+    OFString directory_;
+    unsigned int counter_;
+};
+
+/** fill a dataset with a secondary capture instance with the given identifiers
+ */
+static void qrMakeInstance(DcmDataset &dset,
+                           const char *patientID,
+                           const char *studyUID,
+                           const char *seriesUID,
+                           const char *sopUID,
+                           const char *studyDate = "20160101")
+{
+    dset.putAndInsertString(DCM_SOPClassUID, UID_SecondaryCaptureImageStorage);
+    dset.putAndInsertString(DCM_SOPInstanceUID, sopUID);
+    dset.putAndInsertString(DCM_PatientName, "Test^Patient");
+    dset.putAndInsertString(DCM_PatientID, patientID);
+    dset.putAndInsertString(DCM_StudyInstanceUID, studyUID);
+    dset.putAndInsertString(DCM_StudyDate, studyDate);
+    dset.putAndInsertString(DCM_StudyID, "1");
+    dset.putAndInsertString(DCM_SeriesInstanceUID, seriesUID);
+    dset.putAndInsertString(DCM_Modality, "OT");
+    dset.putAndInsertString(DCM_SeriesNumber, "1");
+    dset.putAndInsertString(DCM_InstanceNumber, "1");
+}
+
+/** write the given dataset to a new file in the storage area
+ *  @return name of the file, empty in case of error
+ */
+static OFString qrWriteDataset(QRTestStorageArea &area,
+                               DcmDataset &dset)
+{
+    DcmFileFormat fileformat(&dset);
+    const OFString filename = area.newInstanceFile();
+    if (fileformat.saveFile(filename.c_str(), EXS_LittleEndianExplicit).bad())
+        return "";
+    return filename;
+}
+
+/** write the given dataset to the storage area and register it in the database
+ *  @return the DIMSE status of the storage request
+ */
+static Uint16 qrStoreDataset(DcmQueryRetrieveIndexDatabaseHandle &handle,
+                             QRTestStorageArea &area,
+                             DcmDataset &dset)
+{
+    const OFString filename = qrWriteDataset(area, dset);
+    OFString sopUID;
+    if (filename.empty() || dset.findAndGetOFString(DCM_SOPInstanceUID, sopUID).bad())
+        return STATUS_STORE_Refused_OutOfResources;
+    DcmQueryRetrieveDatabaseStatus status;
+    handle.storeRequest(UID_SecondaryCaptureImageStorage, sopUID.c_str(), filename.c_str(), &status);
+    return status.status();
+}
+
+/** write an instance with the given identifiers to the storage area and
+ *  register it in the database
+ *  @return the DIMSE status of the storage request
+ */
+static Uint16 qrStoreInstance(DcmQueryRetrieveIndexDatabaseHandle &handle,
+                              QRTestStorageArea &area,
+                              const char *patientID,
+                              const char *studyUID,
+                              const char *seriesUID,
+                              const char *sopUID,
+                              const char *studyDate = "20160101")
+{
+    DcmDataset dset;
+    qrMakeInstance(dset, patientID, studyUID, seriesUID, sopUID, studyDate);
+    return qrStoreDataset(handle, area, dset);
+}
+
+/** create a study root C-FIND query on the given level with a single matching
+ *  key. The unique keys of the higher levels are taken from the given
+ *  instance identifiers, all other unique keys are return keys.
+ */
+static void qrMakeQuery(DcmDataset &query,
+                        const char *level,
+                        const DcmTagKey &key,
+                        const char *value,
+                        const char *studyUID = NULL,
+                        const char *seriesUID = NULL)
+{
+    query.clear();
+    query.putAndInsertString(DCM_QueryRetrieveLevel, level);
+    query.putAndInsertString(DCM_StudyInstanceUID, studyUID ? studyUID : "");
+    if (strcmp(level, "STUDY") != 0)
+        query.putAndInsertString(DCM_SeriesInstanceUID, seriesUID ? seriesUID : "");
+    if (strcmp(level, "IMAGE") == 0)
+        query.putAndInsertString(DCM_SOPInstanceUID, "");
+    query.putAndInsertString(key, value);
+}
+
+/** perform a study root C-FIND with the given query
+ *  @param finalStatus final DIMSE status of the query
+ *  @param key attribute whose values are returned in 'values'
+ *  @param values if not NULL, the values of 'key' in the responses
+ *  @return number of responses
+ */
+static int qrFind(DcmQueryRetrieveIndexDatabaseHandle &handle,
+                  DcmDataset &query,
+                  Uint16 &finalStatus,
+                  const DcmTagKey &key = DCM_StudyInstanceUID,
+                  OFList<OFString> *values = NULL)
+{
+    DcmQueryRetrieveDatabaseStatus status;
+    int count = 0;
+    if (handle.startFindRequest(UID_FINDStudyRootQueryRetrieveInformationModel, &query, &status).good())
+    {
+        while (status.status() == STATUS_Pending)
+        {
+            DcmDataset *response = NULL;
+            if (handle.nextFindResponse(&response, &status).bad())
+                break;
+            if (response != NULL)
+            {
+                ++count;
+                OFString v;
+                if (values && response->findAndGetOFString(key, v).good())
+                    values->push_back(v);
+                delete response;
+            }
+        }
+    }
+    finalStatus = status.status();
+    return count;
+}
+
+/** perform a study root C-FIND on the given level with a single matching key
+ *  (see qrMakeQuery()) and return the number of successful responses, or -1
+ *  if the query did not complete successfully
+ */
+static int qrCount(DcmQueryRetrieveIndexDatabaseHandle &handle,
+                   const char *level,
+                   const DcmTagKey &key,
+                   const char *value,
+                   const char *studyUID = NULL,
+                   const char *seriesUID = NULL)
+{
+    DcmDataset query;
+    Uint16 finalStatus = 0;
+    qrMakeQuery(query, level, key, value, studyUID, seriesUID);
+    const int count = qrFind(handle, query, finalStatus);
+    return (finalStatus == STATUS_Success) ? count : -1;
+}
+
+/** write a configuration file for dcmqrscp to the storage area, with the
+ *  storage area itself as a writable storage area open to any peer. If
+ *  'moveDestination' is given, it is known as a C-MOVE destination on the
+ *  local host with the port number 'moveDestinationPort'.
+ *  @return name of the configuration file, empty in case of error
+ */
+static OFString qrWriteConfig(QRTestStorageArea &area,
+                              const char *aetitle,
+                              unsigned int port,
+                              unsigned int maxAssociations,
+                              const char *moveDestination = NULL,
+                              unsigned int moveDestinationPort = 0)
+{
+    const OFString configFile = area.filePath("dcmqrscp.cfg");
+    FILE *f = fopen(configFile.c_str(), "w");
+    if (f == NULL)
+        return "";
+    fprintf(f, "NetworkTCPPort = %u\nMaxPDUSize = 16384\nMaxAssociations = %u\n", port, maxAssociations);
+    fprintf(f, "HostTable BEGIN\n");
+    if (moveDestination != NULL)
+        fprintf(f, "%s = (%s, localhost, %u)\n", moveDestination, moveDestination, moveDestinationPort);
+    fprintf(f, "HostTable END\nVendorTable BEGIN\nVendorTable END\n");
+    fprintf(f, "AETable BEGIN\n%s %s RW (100, 1024mb) ANY\nAETable END\n", aetitle, area.path());
+    fclose(f);
+    return configFile;
+}
+
+#endif
@@ -0,0 +1,165 @@
+/*
+ *
+ *  Copyright (C) 2016, OFFIS e.V.
+ *  All rights reserved.  See COPYRIGHT file for details.
+ *
+ *  This software and supporting documentation were developed by
+ *
+ *    OFFIS e.V.
+ *    R&D Division Health
+ *    Escherweg 2
+ *    D-26121 Oldenburg, Germany
+ *
+ *
+ *  Module:  dcmqrdb
+ *
+ *  Author:  OFFIS DICOM Team
+ *
+ *  Purpose: test the summary cache of studies and series used for
+ *           study and series level queries
+ *
+ */
+
+
+#include "dcmtk/config/osconfig.h"    /* make sure OS specific configuration is included first */
+
+#include "dcmtk/ofstd/oftest.h"
+#include "dcmtk/dcmqrdb/dcmqrcnf.h"
+#include "tqrhelp.h"
+
+
+/* return the Number of Study Related Instances of the given study, -1 if not found */
+static long studyInstances(DcmQueryRetrieveIndexDatabaseHandle &handle,
+                           const char *studyUID)
+{
+    DcmDataset query;
+    Uint16 finalStatus = 0;
+    OFList<OFString> values;
+    qrMakeQuery(query, "STUDY", DCM_NumberOfStudyRelatedInstances, "", studyUID);
+    if ((qrFind(handle, query, finalStatus, DCM_NumberOfStudyRelatedInstances, &values) != 1) || values.empty())
+        return -1;
+    return atol(values.front().c_str());
+}
+
+/* delete all files in the given directory and the directory itself */
+static void removeDirectory(const OFString &directory)
+{
+    OFList<OFString> files;
+    OFStandard::searchDirectoryRecursively(directory, files);
+    for (OFListIterator(OFString) it = files.begin(); it != files.end(); ++it)
+        OFStandard::deleteFile(*it);
+#ifdef _WIN32
+    _rmdir(directory.c_str());
+#else
+    rmdir(directory.c_str());
+#endif
+}
+
+
+OFTEST(dcmqrdb_summaryCache_separateAreas)
+{
+    QRTestStorageArea area1;
+    QRTestStorageArea area2;
+    OFCondition cond;
+    DcmQueryRetrieveIndexDatabaseHandle handle1(area1.path(), -1, -1, cond);
+    OFCHECK(cond.good());
+    DcmQueryRetrieveIndexDatabaseHandle handle2(area2.path(), -1, -1, cond);
+    OFCHECK(cond.good());
+
+    /* the records of different studies have the same indexes in both areas */
+    OFCHECK_EQUAL(qrStoreInstance(handle1, area1, "P1", "1.2.3.1", "1.2.3.1.1", "1.2.3.1.1.1"), STATUS_Success);
+    OFCHECK_EQUAL(qrStoreInstance(handle1, area1, "P1", "1.2.3.1", "1.2.3.1.1", "1.2.3.1.1.2"), STATUS_Success);
+    OFCHECK_EQUAL(qrStoreInstance(handle2, area2, "P2", "1.2.3.2", "1.2.3.2.1", "1.2.3.2.1.1"), STATUS_Success);
+    OFCHECK_EQUAL(qrStoreInstance(handle2, area2, "P3", "1.2.3.3", "1.2.3.3.1", "1.2.3.3.1.1"), STATUS_Success);
+
+    /* the second pass uses the summaries built by the first one */
+    for (int i = 0; i < 2; ++i)
+    {
+        OFCHECK_EQUAL(qrCount(handle1, "STUDY", DCM_StudyInstanceUID, ""), 1);
+        OFCHECK_EQUAL(qrCount(handle2, "STUDY", DCM_StudyInstanceUID, ""), 2);
+        OFCHECK_EQUAL(qrCount(handle1, "SERIES", DCM_SeriesInstanceUID, "", "1.2.3.1"), 1);
+        OFCHECK_EQUAL(qrCount(handle2, "SERIES", DCM_SeriesInstanceUID, "", "1.2.3.1"), 0);
+        OFCHECK_EQUAL(studyInstances(handle1, "1.2.3.1"), 2);
+        OFCHECK_EQUAL(studyInstances(handle2, "1.2.3.2"), 1);
+    }
+
+    /* updates of one area do not affect the summary of the other one */
+    OFCHECK_EQUAL(qrStoreInstance(handle1, area1, "P1", "1.2.3.1", "1.2.3.1.2", "1.2.3.1.2.1"), STATUS_Success);
+    OFCHECK_EQUAL(qrCount(handle1, "SERIES", DCM_SeriesInstanceUID, "", "1.2.3.1"), 2);
+    OFCHECK_EQUAL(studyInstances(handle1, "1.2.3.1"), 3);
+    OFCHECK_EQUAL(qrCount(handle2, "STUDY", DCM_StudyInstanceUID, ""), 2);
+    OFCHECK_EQUAL(studyInstances(handle2, "1.2.3.2"), 1);
+}
+
+
+OFTEST(dcmqrdb_summaryCache_recreatedArea)
+{
+    QRTestStorageArea area;
+    const OFString directory = area.filePath("store");
+    OFCondition cond;
+
+    /* the summary of a storage area that has been removed must not be used
+     * for a new storage area at the same location
+     */
+    OFCHECK(OFStandard::createDirectory(directory, "").good());
+    {
+        DcmQueryRetrieveIndexDatabaseHandle handle(directory.c_str(), -1, -1, cond);
+        OFCHECK(cond.good());
+        OFCHECK_EQUAL(qrStoreInstance(handle, area, "P1", "1.2.3.1", "1.2.3.1.1", "1.2.3.1.1.1"), STATUS_Success);
+        OFCHECK_EQUAL(qrStoreInstance(handle, area, "P1", "1.2.3.1", "1.2.3.1.1", "1.2.3.1.1.2"), STATUS_Success);
+        OFCHECK_EQUAL(qrStoreInstance(handle, area, "P2", "1.2.3.2", "1.2.3.2.1", "1.2.3.2.1.1"), STATUS_Success);
+        OFCHECK_EQUAL(qrCount(handle, "STUDY", DCM_StudyInstanceUID, ""), 2);
+    }
+    removeDirectory(directory);
+    OFCHECK(OFStandard::createDirectory(directory, "").good());
+    {
+        DcmQueryRetrieveIndexDatabaseHandle handle(directory.c_str(), -1, -1, cond);
+        OFCHECK(cond.good());
+        OFCHECK_EQUAL(qrStoreInstance(handle, area, "P3", "1.2.3.3", "1.2.3.3.1", "1.2.3.3.1.1"), STATUS_Success);
+        OFCHECK_EQUAL(qrStoreInstance(handle, area, "P4", "1.2.3.4", "1.2.3.4.1", "1.2.3.4.1.1"), STATUS_Success);
+        OFCHECK_EQUAL(qrStoreInstance(handle, area, "P5", "1.2.3.5", "1.2.3.5.1", "1.2.3.5.1.1"), STATUS_Success);
+        OFCHECK_EQUAL(qrCount(handle, "STUDY", DCM_StudyInstanceUID, ""), 3);
+        OFCHECK_EQUAL(studyInstances(handle, "1.2.3.3"), 1);
+    }
+    removeDirectory(directory);
+}
+
+
+OFTEST(dcmqrdb_summaryCache_factory)
+{
+    QRTestStorageArea area;
+    const OFString configFile = qrWriteConfig(area, "QRTEST", 11121, 10);
+    OFCHECK(!configFile.empty());
+    DcmQueryRetrieveConfig config;
+    OFCHECK(config.init(configFile.c_str()) == 1);
+    DcmQueryRetrieveIndexDatabaseHandleFactory factory(&config);
+
+    /* handles created by the factory share the summary of the storage area */
+    OFCondition cond;
+    DcmQueryRetrieveIndexDatabaseHandle *handle1 =
+        OFstatic_cast(DcmQueryRetrieveIndexDatabaseHandle *, factory.createDBHandle("SCU", "QRTEST", cond));
+    OFCHECK(cond.good());
+    DcmQueryRetrieveIndexDatabaseHandle *handle2 =
+        OFstatic_cast(DcmQueryRetrieveIndexDatabaseHandle *, factory.createDBHandle("SCU", "QRTEST", cond));
+    OFCHECK(cond.good());
+    if ((handle1 == NULL) || (handle2 == NULL))
+    {
+        delete handle1;
+        delete handle2;
+        return;
+    }
+    OFCHECK_EQUAL(qrStoreInstance(*handle1, area, "P1", "1.2.3.1", "1.2.3.1.1", "1.2.3.1.1.1"), STATUS_Success);
+    OFCHECK_EQUAL(qrCount(*handle2, "STUDY", DCM_StudyInstanceUID, ""), 1);
+    /* incremental updates through either handle are seen by the other one */
+    OFCHECK_EQUAL(qrStoreInstance(*handle2, area, "P1", "1.2.3.1", "1.2.3.1.2", "1.2.3.1.2.1"), STATUS_Success);
+    OFCHECK_EQUAL(qrStoreInstance(*handle1, area, "P2", "1.2.3.2", "1.2.3.2.1", "1.2.3.2.1.1"), STATUS_Success);
+    OFCHECK_EQUAL(qrCount(*handle1, "STUDY", DCM_StudyInstanceUID, ""), 2);
+    OFCHECK_EQUAL(qrCount(*handle2, "STUDY", DCM_StudyInstanceUID, ""), 2);
+    OFCHECK_EQUAL(qrCount(*handle2, "SERIES", DCM_SeriesInstanceUID, "", "1.2.3.1"), 2);
+    OFCHECK_EQUAL(studyInstances(*handle1, "1.2.3.1"), 2);
+    delete handle1;
+    /* the summary remains valid for the other handle */
+    OFCHECK_EQUAL(qrStoreInstance(*handle2, area, "P2", "1.2.3.2", "1.2.3.2.1", "1.2.3.2.1.2"), STATUS_Success);
+    OFCHECK_EQUAL(studyInstances(*handle2, "1.2.3.2"), 2);
+    delete handle2;
+}
@@ -0,0 +1,430 @@
+/*
+ *
+ *  Copyright (C) 2016, OFFIS e.V.
+ *  All rights reserved.  See COPYRIGHT file for details.
+ *
+ *  This software and supporting documentation were developed by
+ *
+ *    OFFIS e.V.
+ *    R&D Division Health
+ *    Escherweg 2
+ *    D-26121 Oldenburg, Germany
+ *
+ *
+ *  Module:  dcmqrdb
+ *
+ *  Author:  OFFIS DICOM Team
+ *
+ *  Purpose: test the multi-thread mode of the Query/Retrieve SCP with
+ *           concurrent storage and query associations, and C-MOVE requests
+ *           performed over parallel sub-associations
+ *
+ */
+
+
+#include "dcmtk/config/osconfig.h"    /* make sure OS specific configuration is included first */
+
+#ifdef WITH_THREADS
+
+#define INCLUDE_CSTDIO
+#include "dcmtk/ofstd/ofstdinc.h"
+
+#include "dcmtk/ofstd/oftest.h"
+#include "dcmtk/ofstd/ofthread.h"
+#include "dcmtk/dcmnet/scu.h"
+#include "dcmtk/dcmnet/scppool.h"
+#include "dcmtk/dcmqrdb/dcmqrcnf.h"
+#include "dcmtk/dcmqrdb/dcmqropt.h"
+#include "dcmtk/dcmqrdb/dcmqrsrv.h"
+#include "tqrhelp.h"
+
+#define TEST_PORT 11120
+#define TEST_AETITLE "QRTEST"
+#define NUM_CLIENTS 4
+#define NUM_INSTANCES 3
+#define MOVE_PORT 11121
+#define MOVE_AETITLE "MOVEDEST"
+#define MOVE_INSTANCES 20
+#define MOVE_SUBASSOCIATIONS 4
+
+
+/* Query/Retrieve SCP in multi-thread mode, running in its own thread */
+struct TestQRServer : OFThread
+{
+    TestQRServer(DcmQueryRetrieveSCP &scp, T_ASC_Network *net)
+    : scp_(scp)
+    , net_(net)
+    , stop_(OFFalse)
+    , mutex_()
+    {
+    }
+
+    void stop()
+    {
+        mutex_.lock();
+        stop_ = OFTrue;
+        mutex_.unlock();
+    }
+
+protected:
+
+    void run()
+    {
+        OFBool done = OFFalse;
+        while (!done)
+        {
+            /* returns after one second if there is no association request */
+            scp_.waitForAssociation(net_);
+            scp_.cleanChildren();
+            mutex_.lock();
+            done = stop_;
+            mutex_.unlock();
+        }
+    }
+
+    DcmQueryRetrieveSCP &scp_;
+    T_ASC_Network *net_;
+    OFBool stop_;
+    OFMutex mutex_;
+};
+
+/* client that stores the instances of one study and queries them afterwards */
+struct TestQRClient : DcmSCU, OFThread
+{
+    TestQRClient()
+    : number(0)
+    , storeFailures(0)
+    , numResults(-1)
+    , result()
+    {
+    }
+
+    unsigned int number;
+    unsigned int storeFailures;
+    int numResults;
+    OFCondition result;
+
+protected:
+
+    void run()
+    {
+        char studyUID[64];
+        char seriesUID[64];
+        char sopUID[64];
+        char patientID[16];
+        sprintf(studyUID, "1.2.3.%u", number);
+        sprintf(seriesUID, "1.2.3.%u.1", number);
+        sprintf(patientID, "P%u", number);
+        OFList<OFString> xfers;
+        xfers.push_back(UID_LittleEndianExplicitTransferSyntax);
+        addPresentationContext(UID_SecondaryCaptureImageStorage, xfers);
+        addPresentationContext(UID_FINDStudyRootQueryRetrieveInformationModel, xfers);
+        setAETitle("QRCLIENT");
+        setPeerAETitle(TEST_AETITLE);
+        setPeerHostName("localhost");
+        setPeerPort(TEST_PORT);
+        setDIMSEBlockingMode(DIMSE_NONBLOCKING);
+        setDIMSETimeout(30);
+        result = initNetwork();
+        if (result.good())
+            result = negotiateAssociation();
+        if (result.bad())
+            return;
+        const T_ASC_PresentationContextID storeID = findPresentationContextID(UID_SecondaryCaptureImageStorage, "");
+        for (unsigned int i = 1; (i <= NUM_INSTANCES) && result.good(); ++i)
+        {
+            sprintf(sopUID, "1.2.3.%u.1.%u", number, i);
+            DcmDataset dset;
+            qrMakeInstance(dset, patientID, studyUID, seriesUID, sopUID);
+            Uint16 status = 0;
+            result = sendSTORERequest(storeID, "", &dset, status);
+            if (status != STATUS_Success)
+                ++storeFailures;
+        }
+        if (result.good())
+        {
+            DcmDataset query;
+            qrMakeQuery(query, "IMAGE", DCM_SOPInstanceUID, "", studyUID, seriesUID);
+            OFList<QRResponse *> responses;
+            result = sendFINDRequest(findPresentationContextID(UID_FINDStudyRootQueryRetrieveInformationModel, ""), &query, &responses);
+            numResults = 0;
+            for (OFListIterator(QRResponse *) it = responses.begin(); it != responses.end(); ++it)
+            {
+                if (((*it)->m_status == STATUS_Pending) && ((*it)->m_dataset != NULL))
+                    ++numResults;
+                delete *it;
+            }
+        }
+        releaseAssociation();
+    }
+};
+
+
+/* SOP instances received by the move destination, and number of associations */
+static OFMutex moveDestinationMutex;
+static OFList<OFString> moveDestinationInstances;
+static unsigned int moveDestinationAssociations = 0;
+
+/* storage SCP acting as the move destination */
+struct TestMoveDestinationSCP : DcmThreadSCP
+{
+protected:
+
+    void notifyAssociationAcknowledge()
+    {
+        moveDestinationMutex.lock();
+        ++moveDestinationAssociations;
+        moveDestinationMutex.unlock();
+    }
+
+    OFCondition handleIncomingCommand(T_DIMSE_Message *incomingMsg,
+                                      const DcmPresentationContextInfo &presInfo)
+    {
+        if (incomingMsg->CommandField == DIMSE_C_STORE_RQ)
+        {
+            DcmDataset *dataset = NULL;
+            OFCondition cond = handleSTORERequest(incomingMsg->msg.CStoreRQ, presInfo.presentationContextID, dataset);
+            OFString sopUID;
+            if (cond.good() && (dataset != NULL) && dataset->findAndGetOFString(DCM_SOPInstanceUID, sopUID).good())
+            {
+                moveDestinationMutex.lock();
+                moveDestinationInstances.push_back(sopUID);
+                moveDestinationMutex.unlock();
+            }
+            delete dataset;
+            return cond;
+        }
+        return DcmThreadSCP::handleIncomingCommand(incomingMsg, presInfo);
+    }
+};
+
+/* pool of move destination SCPs, listening in its own thread */
+struct TestMoveDestination : DcmSCPPool<TestMoveDestinationSCP>, OFThread
+{
+    OFCondition result;
+protected:
+    void run()
+    {
+        result = listen();
+    }
+};
+
+/* client that performs a C-MOVE of a study */
+struct TestMoveClient : DcmSCU
+{
+    /* wait until the given peer accepts associations (at most 10 seconds) */
+    static OFBool waitForPeer(const char *aetitle,
+                              const unsigned int port)
+    {
+        for (int i = 0; i < 20; ++i)
+        {
+            DcmSCU scu;
+            OFList<OFString> xfers;
+            xfers.push_back(UID_LittleEndianImplicitTransferSyntax);
+            scu.addPresentationContext(UID_VerificationSOPClass, xfers);
+            scu.setAETitle("QRCLIENT");
+            scu.setPeerAETitle(aetitle);
+            scu.setPeerHostName("localhost");
+            scu.setPeerPort(OFstatic_cast(Uint16, port));
+            if (scu.initNetwork().good() && scu.negotiateAssociation().good())
+            {
+                scu.releaseAssociation();
+                return OFTrue;
+            }
+            OFStandard::milliSleep(500);
+        }
+        return OFFalse;
+    }
+
+    /* move all instances of the given study to the move destination and return the final response */
+    OFCondition moveStudy(const char *studyUID,
+                          RetrieveResponse &finalResponse)
+    {
+        OFList<OFString> xfers;
+        xfers.push_back(UID_LittleEndianExplicitTransferSyntax);
+        addPresentationContext(UID_FINDStudyRootQueryRetrieveInformationModel, xfers);
+        addPresentationContext(UID_MOVEStudyRootQueryRetrieveInformationModel, xfers);
+        setAETitle("QRCLIENT");
+        setPeerAETitle(TEST_AETITLE);
+        setPeerHostName("localhost");
+        setPeerPort(TEST_PORT);
+        setDIMSEBlockingMode(DIMSE_NONBLOCKING);
+        setDIMSETimeout(30);
+        OFCondition result = initNetwork();
+        if (result.good())
+            result = negotiateAssociation();
+        if (result.bad())
+            return result;
+        DcmDataset query;
+        query.putAndInsertString(DCM_QueryRetrieveLevel, "STUDY");
+        query.putAndInsertString(DCM_StudyInstanceUID, studyUID);
+        OFList<RetrieveResponse *> responses;
+        result = sendMOVERequest(findPresentationContextID(UID_MOVEStudyRootQueryRetrieveInformationModel, ""),
+            MOVE_AETITLE, &query, &responses);
+        if (result.good() && !responses.empty())
+        {
+            const RetrieveResponse *last = responses.back();
+            finalResponse.m_status = last->m_status;
+            finalResponse.m_numberOfRemainingSubops = last->m_numberOfRemainingSubops;
+            finalResponse.m_numberOfCompletedSubops = last->m_numberOfCompletedSubops;
+            finalResponse.m_numberOfFailedSubops = last->m_numberOfFailedSubops;
+            finalResponse.m_numberOfWarningSubops = last->m_numberOfWarningSubops;
+        }
+        for (OFListIterator(RetrieveResponse *) it = responses.begin(); it != responses.end(); ++it)
+            delete *it;
+        releaseAssociation();
+        return result;
+    }
+};
+
+
+OFTEST(dcmqrdb_multiThreadServer)
+{
+    QRTestStorageArea area;
+
+    const OFString configFile = qrWriteConfig(area, TEST_AETITLE, TEST_PORT, NUM_CLIENTS + 1);
+    OFCHECK(!configFile.empty());
+    DcmQueryRetrieveConfig config;
+    OFCHECK(config.init(configFile.c_str()) == 1);
+    DcmQueryRetrieveOptions options;
+    options.singleProcess_ = OFFalse;
+    options.multiThread_ = OFTrue;
+    options.maxAssociations_ = config.getMaxAssociations();
+    OFCHECK(ASC_initializeNetwork(NET_ACCEPTORREQUESTOR, TEST_PORT, options.acse_timeout_, &options.net_).good());
+    DcmQueryRetrieveIndexDatabaseHandleFactory factory(&config);
+    {
+        DcmQueryRetrieveSCP scp(config, options, factory);
+        TestQRServer server(scp, options.net_);
+        server.start();
+
+        /* all clients run their associations at the same time */
+        TestQRClient clients[NUM_CLIENTS];
+        for (unsigned int i = 0; i < NUM_CLIENTS; ++i)
+        {
+            clients[i].number = i + 1;
+            clients[i].start();
+        }
+        for (unsigned int i = 0; i < NUM_CLIENTS; ++i)
+        {
+            clients[i].join();
+            OFCHECK(clients[i].result.good());
+            OFCHECK_EQUAL(clients[i].storeFailures, 0);
+            OFCHECK_EQUAL(clients[i].numResults, NUM_INSTANCES);
+        }
+
+        server.stop();
+        server.join();
+        /* the destructor of the SCP waits for the remaining worker threads */
+    }
+    ASC_dropNetwork(&options.net_);
+
+    /* all instances have been registered in the index file */
+    OFCondition cond;
+    DcmQueryRetrieveIndexDatabaseHandle handle(area.path(), -1, -1, cond);
+    OFCHECK(cond.good());
+    OFCHECK_EQUAL(qrCount(handle, "STUDY", DCM_StudyInstanceUID, ""), NUM_CLIENTS);
+    for (unsigned int i = 1; i <= NUM_CLIENTS; ++i)
+    {
+        char studyUID[64];
+        char seriesUID[64];
+        sprintf(studyUID, "1.2.3.%u", i);
+        sprintf(seriesUID, "1.2.3.%u.1", i);
+        OFCHECK_EQUAL(qrCount(handle, "IMAGE", DCM_SOPInstanceUID, "", studyUID, seriesUID), NUM_INSTANCES);
+    }
+}
+
+
+
+OFTEST(dcmqrdb_parallelMove)
+{
+    QRTestStorageArea area;
+
+    /* one study, one of its files has been removed from the storage area */
+    OFString missingUID;
+    {
+        OFCondition cond;
+        DcmQueryRetrieveIndexDatabaseHandle handle(area.path(), -1, -1, cond);
+        OFCHECK(cond.good());
+        for (unsigned int i = 1; i <= MOVE_INSTANCES; ++i)
+        {
+            char sopUID[64];
+            sprintf(sopUID, "1.2.4.1.1.%u", i);
+            OFCHECK_EQUAL(qrStoreInstance(handle, area, "P1", "1.2.4.1", "1.2.4.1.1", sopUID), STATUS_Success);
+        }
+        missingUID = "1.2.4.1.1.7";
+        OFCHECK(OFStandard::deleteFile(area.filePath("IMG00007.dcm")));
+    }
+
+    TestMoveDestination destination;
+    DcmSCPConfig &destConfig = destination.getConfig();
+    destConfig.setAETitle(MOVE_AETITLE);
+    destConfig.setPort(MOVE_PORT);
+    destConfig.setConnectionBlockingMode(DUL_NOBLOCK);
+    destConfig.setConnectionTimeout(1);
+    OFList<OFString> xfers;
+    xfers.push_back(UID_LittleEndianExplicitTransferSyntax);
+    xfers.push_back(UID_LittleEndianImplicitTransferSyntax);
+    destConfig.addPresentationContext(UID_SecondaryCaptureImageStorage, xfers);
+    destConfig.addPresentationContext(UID_VerificationSOPClass, xfers);
+    destination.setMaxThreads(MOVE_SUBASSOCIATIONS + 2);
+    destination.start();
+    OFCHECK(TestMoveClient::waitForPeer(MOVE_AETITLE, MOVE_PORT));
+    moveDestinationMutex.lock();
+    moveDestinationInstances.clear();
+    moveDestinationAssociations = 0;
+    moveDestinationMutex.unlock();
+
+    const OFString configFile = qrWriteConfig(area, TEST_AETITLE, TEST_PORT, 2, MOVE_AETITLE, MOVE_PORT);
+    OFCHECK(!configFile.empty());
+    DcmQueryRetrieveConfig config;
+    OFCHECK(config.init(configFile.c_str()) == 1);
+    DcmQueryRetrieveOptions options;
+    options.singleProcess_ = OFFalse;
+    options.multiThread_ = OFTrue;
+    options.maxAssociations_ = config.getMaxAssociations();
+    options.moveSubAssociations_ = MOVE_SUBASSOCIATIONS;
+    OFCHECK(ASC_initializeNetwork(NET_ACCEPTORREQUESTOR, TEST_PORT, options.acse_timeout_, &options.net_).good());
+    DcmQueryRetrieveIndexDatabaseHandleFactory factory(&config);
+    {
+        DcmQueryRetrieveSCP scp(config, options, factory);
+        TestQRServer server(scp, options.net_);
+        server.start();
+
+        TestMoveClient client;
+        RetrieveResponse response;
+        OFCHECK(client.moveStudy("1.2.4.1", response).good());
+        OFCHECK_EQUAL(response.m_status, STATUS_MOVE_Warning_SubOperationsCompleteOneOrMoreFailures);
+        OFCHECK_EQUAL(response.m_numberOfRemainingSubops, 0);
+        OFCHECK_EQUAL(response.m_numberOfCompletedSubops, MOVE_INSTANCES - 1);
+        OFCHECK_EQUAL(response.m_numberOfFailedSubops, 1);
+        OFCHECK_EQUAL(response.m_numberOfWarningSubops, 0);
+
+        server.stop();
+        server.join();
+    }
+    ASC_dropNetwork(&options.net_);
+
+    destination.stopAfterCurrentAssociations();
+    destination.join();
+    OFCHECK(destination.result.good());
+
+    /* every instance except for the missing one has arrived exactly once */
+    moveDestinationMutex.lock();
+    OFCHECK_EQUAL(moveDestinationAssociations, MOVE_SUBASSOCIATIONS);
+    OFCHECK_EQUAL(moveDestinationInstances.size(), MOVE_INSTANCES - 1);
+    for (unsigned int i = 1; i <= MOVE_INSTANCES; ++i)
+    {
+        char sopUID[64];
+        sprintf(sopUID, "1.2.4.1.1.%u", i);
+        size_t count = 0;
+        for (OFListIterator(OFString) it = moveDestinationInstances.begin(); it != moveDestinationInstances.end(); ++it)
+        {
+            if (*it == sopUID)
+                ++count;
+        }
+        OFCHECK_EQUAL(count, (missingUID == sopUID) ? 0 : 1);
+    }
+    moveDestinationMutex.unlock();
+}
+
+#endif // WITH_THREADS
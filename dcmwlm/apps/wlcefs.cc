@@ -72,8 +72,8 @@ WlmConsoleEngineFileSystem::WlmConsoleEngineFileSystem( int argc, char *argv[],
     opt_rejectWithoutImplementationUID( OFFalse ), opt_sleepAfterFind( 0 ), opt_sleepDuringFind( 0 ),
     opt_maxPDU( ASC_DEFAULTMAXPDU ), opt_networkTransferSyntax( EXS_Unknown ),
     opt_failInvalidQuery( OFTrue ), opt_singleProcess( OFTrue ),
-    opt_forkedChild( OFFalse ), opt_maxAssociations( 50 ), opt_noSequenceExpansion( OFFalse ),
-    opt_enableRejectionOfIncompleteWlFiles( OFTrue ), opt_blockMode(DIMSE_BLOCKING),
+    opt_forkedChild( OFFalse ), opt_multiThread( OFFalse ), opt_maxAssociations( 50 ), opt_noSequenceExpansion( OFFalse ),
+    opt_enableRejectionOfIncompleteWlFiles( OFTrue ), opt_enableIndexOfWlFiles( OFFalse ), opt_blockMode(DIMSE_BLOCKING),
     opt_dimse_timeout(0), opt_acse_timeout(30), app( NULL ), cmd( NULL ), command_argc( argc ),
     command_argv(argv), dataSource( dataSourcev )
 {
@@ -105,13 +105,18 @@ WlmConsoleEngineFileSystem::WlmConsoleEngineFileSystem( int argc, char *argv[],
     cmd->addOption("--version",                          "print version information and exit", OFCommandLine::AF_Exclusive);
     OFLog::addOptions(*cmd);
 
-#if defined(HAVE_FORK) || defined(_WIN32)
+#if defined(HAVE_FORK) || defined(_WIN32) || defined(WITH_THREADS)
   cmd->addGroup("multi-process options:", LONGCOL, SHORTCOL + 2);
+#if defined(HAVE_FORK) || defined(_WIN32)
     cmd->addOption("--single-process",        "-s",      "single process mode");
     cmd->addOption("--fork",                             "fork child process for each association (def.)");
 #ifdef _WIN32
     cmd->addOption("--forked-child",                     "process is forked child, internal use only", OFCommandLine::AF_Internal);
 #endif
+#endif
+#ifdef WITH_THREADS
+    cmd->addOption("--multi-thread",                     "handle each association in a separate thread");
+#endif
 #endif
 
   cmd->addGroup("input options:");
@@ -123,6 +128,8 @@ WlmConsoleEngineFileSystem::WlmConsoleEngineFileSystem( int argc, char *argv[],
     cmd->addSubGroup("handling of worklist files:");
       cmd->addOption("--enable-file-reject",  "-efr",    "enable rejection of incomplete worklist files\n(default)");
       cmd->addOption("--disable-file-reject", "-dfr",    "disable rejection of incomplete worklist files");
+      cmd->addOption("--read-files",          "-rf",     "read all worklist files for each query (default)");
+      cmd->addOption("--index-files",         "-if",     "keep worklist files in an in-memory index and\nonly read new or changed files");
 
   cmd->addGroup("processing options:");
     cmd->addSubGroup("returned character set:");
@@ -217,12 +224,21 @@ WlmConsoleEngineFileSystem::WlmConsoleEngineFileSystem( int argc, char *argv[],
 
     OFLog::configureFromCommandLine(*cmd, *app);
 
-#if defined(HAVE_FORK) || defined(_WIN32)
+#if defined(HAVE_FORK) || defined(_WIN32) || defined(WITH_THREADS)
     cmd->beginOptionBlock();
+#if defined(HAVE_FORK) || defined(_WIN32)
     if (cmd->findOption("--single-process")) opt_singleProcess = OFTrue;
     if (cmd->findOption("--fork")) opt_singleProcess = OFFalse;
+#endif
+#ifdef WITH_THREADS
+    if (cmd->findOption("--multi-thread"))
+    {
+      opt_singleProcess = OFFalse;
+      opt_multiThread = OFTrue;
+    }
+#endif
     cmd->endOptionBlock();
-#ifdef _WIN32
+#if defined(_WIN32)
     if (cmd->findOption("--forked-child")) opt_forkedChild = OFTrue;
 #endif
 #endif
@@ -234,6 +250,11 @@ WlmConsoleEngineFileSystem::WlmConsoleEngineFileSystem( int argc, char *argv[],
     if( cmd->findOption("--disable-file-reject") ) opt_enableRejectionOfIncompleteWlFiles = OFFalse;
     cmd->endOptionBlock();
 
+    cmd->beginOptionBlock();
+    if( cmd->findOption("--read-files") ) opt_enableIndexOfWlFiles = OFFalse;
+    if( cmd->findOption("--index-files") ) opt_enableIndexOfWlFiles = OFTrue;
+    cmd->endOptionBlock();
+
     cmd->beginOptionBlock();
     if( cmd->findOption("--return-no-char-set") ) opt_returnedCharacterSet = RETURN_NO_CHARACTER_SET;
     if( cmd->findOption("--return-iso-ir-100") ) opt_returnedCharacterSet = RETURN_CHARACTER_SET_ISO_IR_100;
@@ -319,6 +340,7 @@ WlmConsoleEngineFileSystem::WlmConsoleEngineFileSystem( int argc, char *argv[],
   // set specific parameters in data source object
   dataSource->SetDfPath( opt_dfPath );
   dataSource->SetEnableRejectionOfIncompleteWlFiles( opt_enableRejectionOfIncompleteWlFiles );
+  dataSource->SetEnableIndexOfWlFiles( opt_enableIndexOfWlFiles );
 }
 
 // ----------------------------------------------------------------------------
@@ -369,6 +391,7 @@ int WlmConsoleEngineFileSystem::StartProvidingService()
       opt_singleProcess, opt_maxAssociations,
       opt_blockMode, opt_dimse_timeout, opt_acse_timeout,
       opt_forkedChild, command_argc, command_argv );
+  activityManager->SetMultiThreadMode( opt_multiThread );
   cond = activityManager->StartProvidingService();
   if( cond.bad() )
   {
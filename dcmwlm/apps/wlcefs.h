@@ -62,12 +62,16 @@ class WlmConsoleEngineFileSystem
     OFBool opt_singleProcess;
     /// indicates if this process is called as a child process, used by dcmnet
     OFBool opt_forkedChild;
+    /// indicates if each association shall be handled in a separate thread
+    OFBool opt_multiThread;
     /// indicates how many associations can be accepted at the same time
     int opt_maxAssociations;
     /// indicates if an expansion of empty sequences in C-Find RQ messages shall take place or not
     OFBool opt_noSequenceExpansion;
     /// indicates if wl-files which are lacking return type 1 attributes or information in such attributes shall be rejected or not
     OFBool opt_enableRejectionOfIncompleteWlFiles;
+    /// indicates if wl-files shall be kept in an in-memory index instead of being read for each query
+    OFBool opt_enableIndexOfWlFiles;
     /// blocking mode for DIMSE operations
     T_DIMSE_BlockingMode opt_blockMode;
     /// timeout for DIMSE operations
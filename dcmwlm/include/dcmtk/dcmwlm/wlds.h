@@ -497,6 +497,30 @@ class DCMTK_DCMWLM_EXPORT WlmDataSource
        */
     virtual void SetEnableRejectionOfIncompleteWlFiles( OFBool /*value*/ ) {}
 
+      /** Set value in a member variable in a derived class.
+       */
+    virtual void SetEnableIndexOfWlFiles( OFBool /*value*/ ) {}
+
+      /** Updates an in-memory index of the worklist entries for the given called application
+       *  entity title, if the derived class maintains such an index. This function is called
+       *  before an association is handled in a child process, so that the child process
+       *  inherits an up-to-date index and does not have to build it again. In multi-thread
+       *  mode, it is not called; the data sources of the threads have to keep their indexes
+       *  up to date themselves (see CreateDataSourceForThread()).
+       *  @param calledAETitle The called application entity title of the association.
+       */
+    virtual void UpdateIndex( const OFString& /*calledAETitle*/ ) {}
+
+      /** Creates a new data source object which can be used to handle an association in a
+       *  separate thread, while this object is used by the main thread. The new object has
+       *  the same settings as this object and is already connected to the data source; it
+       *  may share read-only data with this object. The default implementation returns NULL,
+       *  i.e. the derived class does not support handling associations in separate threads.
+       *  @return Pointer to the new data source object, NULL if not supported or in case
+       *          of an error. The caller is responsible for deleting it before this object.
+       */
+    virtual WlmDataSource *CreateDataSourceForThread() { return NULL; }
+
       /** Set value in a member variable in a derived class.
        */
     virtual void SetCreateNullvalues( OFBool /*value*/ ) {}
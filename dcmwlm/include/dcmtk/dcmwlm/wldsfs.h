@@ -25,6 +25,7 @@
 #include "dcmtk/config/osconfig.h"
 #include "dcmtk/dcmwlm/wlds.h"
 #include "dcmtk/dcmwlm/wlfsim.h"
+#include "dcmtk/ofstd/ofmap.h"
 
 //class WlmFileSystemInteractionManager;
 class DcmItem;
@@ -45,8 +46,22 @@ class DCMTK_DCMWLM_EXPORT WlmDataSourceFileSystem : public WlmDataSource
     OFString dfPath;
     /// indicates if wl-files which are lacking return type 1 attributes or information in such attributes shall be rejected or not
     OFBool enableRejectionOfIncompleteWlFiles;
+    /// indicates if the worklist files shall be kept in an in-memory index instead of being read for each query
+    OFBool enableIndexOfWlFiles;
     /// handle to the read lock file
     int handleToReadLockFile;
+    /// data source whose indexes are used and updated by this object before each query, NULL if none
+    WlmDataSourceFileSystem *indexOwner;
+    /// data source which maintains the indexes for the data sources of other threads, NULL if none
+    WlmDataSourceFileSystem *indexMaintainer;
+    /// number of index updates that have been started so far, for each called AE title
+    OFMap<OFString, unsigned long> indexUpdateCounts;
+#ifdef WITH_THREADS
+    /// mutex which serializes all updates of the indexes of this object
+    OFMutex indexUpdateMutex;
+    /// mutex which protects the number of started index updates
+    OFMutex indexUpdateCountMutex;
+#endif
 
       /** This function sets a read lock on the LOCKFILE in the directory
        *  that is specified through dfPath and calledApplicationEntityTitle.
@@ -81,6 +96,22 @@ class DCMTK_DCMWLM_EXPORT WlmDataSourceFileSystem : public WlmDataSource
        */
     void HandleSequenceElementInResultDataset( DcmElement *element, unsigned long idx );
 
+      /** Updates the in-memory index of the worklist files for the given called application
+       *  entity title on behalf of a data source which is used by another thread (see
+       *  CreateDataSourceForThread()). Only one thread updates the indexes at a time; if an
+       *  update is already running, the calling thread waits for it and then only updates
+       *  the index again if no other thread has started an update in the meantime, since
+       *  such an update has seen all changes made before this function was called.
+       *  @param calledAETitle The called application entity title.
+       */
+    void RequestIndexUpdate( const OFString& calledAETitle );
+
+      /** Creates a new data source object with the same settings as this object and
+       *  connects it to the data source.
+       *  @return Pointer to the new data source object, NULL in case of an error.
+       */
+    WlmDataSourceFileSystem *CloneDataSource();
+
       /** Protected undefined copy-constructor. Shall never be called.
        *  @param Src Source object.
        */
@@ -122,6 +153,28 @@ class DCMTK_DCMWLM_EXPORT WlmDataSourceFileSystem : public WlmDataSource
        */
     void SetEnableRejectionOfIncompleteWlFiles( OFBool value );
 
+      /** Set value in member variable.
+       *  @param value The value to set.
+       */
+    void SetEnableIndexOfWlFiles( OFBool value );
+
+      /** Updates the in-memory index of the worklist files for the given called application
+       *  entity title, if the index is enabled (see SetEnableIndexOfWlFiles()).
+       *  @param calledAETitle The called application entity title.
+       */
+    void UpdateIndex( const OFString& calledAETitle );
+
+      /** Creates a new data source object with the same settings as this object, which can
+       *  be used to handle an association in a separate thread. If the in-memory index is
+       *  enabled, the indexes for all threads are maintained by a separate data source object
+       *  owned by this object, so that this object can still be used by the main thread. The
+       *  new object updates the index of the called application entity title before each query
+       *  (see RequestIndexUpdate()) and uses the snapshot which is published by the update.
+       *  @return Pointer to the new data source object (already connected), NULL in case
+       *          of an error. The caller is responsible for deleting it before this object.
+       */
+    WlmDataSource *CreateDataSourceForThread();
+
       /** Checks if the called application entity title is supported. This function expects
        *  that the called application entity title was made available for this instance through
        *  WlmDataSource::SetCalledApplicationEntityTitle(). If this is not the case, OFFalse
@@ -0,0 +1,332 @@
+/*
+ *
+ *  Copyright (C) 2016, OFFIS e.V.
+ *  All rights reserved.  See COPYRIGHT file for details.
+ *
+ *  This software and supporting documentation were developed by
+ *
+ *    OFFIS e.V.
+ *    R&D Division Health
+ *    Escherweg 2
+ *    D-26121 Oldenburg, Germany
+ *
+ *
+ *  Module:  dcmwlm
+ *
+ *  Author:  OFFIS DICOM Team
+ *
+ *  Purpose: Class for an in-memory index of worklist files.
+ *
+ */
+
+#ifndef WlmFileSystemIndex_h
+#define WlmFileSystemIndex_h
+
+#include "dcmtk/config/osconfig.h"
+#include "dcmtk/ofstd/ofstring.h"
+#include "dcmtk/ofstd/oftypes.h"   /* for OFBool */
+#include "dcmtk/ofstd/ofvector.h"
+#include "dcmtk/dcmwlm/wldefine.h"
+#include "dcmtk/dcmwlm/wlmatch.h"
+
+#ifdef WITH_THREADS
+#include "dcmtk/ofstd/ofthread.h"
+#endif
+
+#define INCLUDE_CTIME
+#include "dcmtk/ofstd/ofstdinc.h"
+
+class DcmDataset;
+
+/** This class keeps the parsed content of the worklist files in one directory
+ *  of the worklist file system database in memory, together with sorted tables
+ *  of the values of the most selective matching key attributes, so that a query
+ *  only has to look at the worklist files which can possibly match instead of
+ *  reading and parsing all files in the directory. The index itself does not
+ *  access the worklist files; WlmFileSystemInteractionManager keeps it up to date.
+ *  Where supported (Linux inotify), the directory is watched for changes, so that
+ *  only changed files have to be examined; otherwise, all files in the directory
+ *  are checked for a changed modification time or size before each query.
+ *  In order to serve queries from several threads, the index can publish snapshots
+ *  of itself, see PublishSnapshot(). A snapshot is never changed after it has been
+ *  published, so it can be read by any number of threads without locking.
+ */
+class DCMTK_DCMWLM_EXPORT WlmFileSystemIndex
+{
+  public:
+    /// matching key attributes for which the index maintains a table of values
+    enum KeyType
+    {
+      /// ScheduledStationAETitle (0040,0001)
+      KEY_ScheduledStationAETitle,
+      /// ScheduledProcedureStepStartDate (0040,0002), normalized to the format YYYYMMDD
+      KEY_ScheduledProcedureStepStartDate,
+      /// Modality (0008,0060)
+      KEY_Modality,
+      /// PatientID (0010,0020)
+      KEY_PatientID,
+      /// number of key types, not a valid key type
+      NUMBER_OF_KEY_TYPES
+    };
+
+    /// result of checking the directory for changes, see PollChanges()
+    enum ChangeStatus
+    {
+      /// no changes since the last check
+      CHANGES_None,
+      /// only the files returned by PollChanges() have changed
+      CHANGES_Files,
+      /// the changes are not known, all files have to be checked
+      CHANGES_Unknown
+    };
+
+    /// information about one worklist file in the index
+    struct DCMTK_DCMWLM_EXPORT Entry
+    {
+        /** default constructor.
+         */
+      Entry();
+
+        /** destructor, deletes the dataset.
+         */
+      ~Entry();
+
+      /// name of the worklist file (without path)
+      OFString fileName;
+      /// size of the worklist file when it was read
+      unsigned long fileSize;
+      /// modification time of the worklist file when it was read
+      time_t modificationTime;
+      /// OFTrue if the file was modified in the second it was read, i.e. may have changed since
+      OFBool racy;
+      /// OFTrue if the file was found during the current update
+      OFBool seen;
+      /// dataset of the worklist file, NULL if the file cannot be used for matching
+      DcmDataset *dataset;
+      /// values of the indexed matching key attributes (trailing spaces removed)
+      OFString keyValues[NUMBER_OF_KEY_TYPES];
+      /// indicates which of the indexed matching key attributes have a value
+      OFBool hasKeyValue[NUMBER_OF_KEY_TYPES];
+      /// values of all matching key attributes (see WlmMatchingRecordSet::AddRecord())
+      OFString matchingKeyValues[NUMBER_OF_SUPPORTED_MATCHING_KEY_ATTRIBUTES];
+      /// indicates which of the matching key attributes have a value
+      OFBool hasMatchingKeyValue[NUMBER_OF_SUPPORTED_MATCHING_KEY_ATTRIBUTES];
+      /// number of indexes which contain this entry, i.e. the index and its snapshots
+      unsigned long useCount;
+#ifdef WITH_THREADS
+      /// mutex which serializes the copying of the dataset, see WlmFileSystemIndex::CopyDataset()
+      mutable OFMutex datasetMutex;
+#endif
+
+    private:
+        /** Privately defined copy constructor.
+         *  @param old Object which shall be copied.
+         */
+      Entry( const Entry &old );
+
+        /** Privately defined assignment operator.
+         *  @param obj Object which shall be copied.
+         */
+      Entry &operator=( const Entry &obj );
+    };
+
+      /** constructor.
+       *  @param directoryv Path of the directory that contains the worklist files.
+       */
+    WlmFileSystemIndex( const OFString &directoryv );
+
+      /** destructor
+       */
+    ~WlmFileSystemIndex();
+
+      /** Get the path of the directory that contains the worklist files.
+       *  @return Path of the directory.
+       */
+    const OFString &GetDirectory() const { return directory; }
+
+      /** Start watching the directory for changes. This function should be called
+       *  before the directory is read for the first time, so that no change gets lost.
+       *  @return OFTrue if the directory is watched, OFFalse if changes cannot be
+       *          detected without checking all files.
+       */
+    OFBool StartWatching();
+
+      /** Determine the changes in the directory since the last call of this function.
+       *  If this function is called in a process that was forked from the process which
+       *  started watching, the events are not consumed (so that they are still available
+       *  to the parent process), and CHANGES_Unknown is returned if there are any.
+       *  @param changedFiles Names (without path) of the changed, created or deleted
+       *         files in case CHANGES_Files is returned.
+       *  @return Status of the directory, see ChangeStatus.
+       */
+    ChangeStatus PollChanges( OFVector<OFString> &changedFiles );
+
+      /** Create a copy of the dataset of an entry. The datasets must not be copied directly
+       *  if the index (or one of its snapshots) is used by several threads, since reading a
+       *  dataset changes its internal state (the current position in its list of elements);
+       *  this function locks the entry while its dataset is copied, so that only copies of
+       *  the same entry have to wait for each other.
+       *  @param entry The entry, must have a dataset.
+       *  @return The copy of the dataset, never NULL.
+       */
+    DcmDataset *CopyDataset( const Entry &entry );
+
+      /** Find the entry for the given file.
+       *  @param fileName Name of the worklist file (without path).
+       *  @return Pointer to the entry, NULL if there is no entry for this file.
+       */
+    Entry *FindEntry( const OFString &fileName );
+
+      /** Add an entry to the index. An existing entry for the same file is replaced.
+       *  @param entry The new entry. The index takes over ownership of the entry.
+       */
+    void AddEntry( Entry *entry );
+
+      /** Remove the entry for the given file from the index, if there is one.
+       *  @param fileName Name of the worklist file (without path).
+       */
+    void RemoveEntry( const OFString &fileName );
+
+      /** Reset the flag Entry::seen in all entries.
+       */
+    void ClearSeenFlags();
+
+      /** Remove all entries from the index whose flag Entry::seen is not set.
+       *  @return Number of removed entries.
+       */
+    size_t RemoveUnseenEntries();
+
+      /** Get the number of entries in the index.
+       *  @return Number of entries.
+       */
+    size_t GetNumberOfEntries() const { return entries.size(); }
+
+      /** Get an entry of the index. Entries are sorted by file name.
+       *  @param idx Index of the entry, must be less than GetNumberOfEntries().
+       *  @return Pointer to the entry, never NULL.
+       */
+    const Entry *GetEntry( size_t idx ) const { return entries[idx]; }
+
+      /** Determine the entries whose value of a matching key attribute is within a
+       *  range of values (where values are compared as strings).
+       *  @param key The matching key attribute.
+       *  @param lower Lower bound of the range (inclusive).
+       *  @param upper Upper bound of the range (inclusive).
+       *  @param result Indexes of the entries (see GetEntry()) in ascending order.
+       */
+    void FindEntries( KeyType key, const OFString &lower, const OFString &upper, OFVector<size_t> &result );
+
+      /** Rebuild the tables of matching key attribute values and the record set if the
+       *  entries have changed. This is otherwise done on first use after a change; calling
+       *  this function before a process is forked avoids that the work is repeated in every
+       *  child process.
+       */
+    void PrepareTables();
+
+      /** Get the values of the matching key attributes of all entries, prepared for
+       *  evaluation by WlmMatchingPlan. The record number of an entry is its index
+       *  (see GetEntry()); entries without dataset have no values.
+       *  @return The record set.
+       */
+    const WlmMatchingRecordSet &GetRecords();
+
+      /** Publish a snapshot of the current state of the index, unless the entries have
+       *  not changed since the last snapshot was published. The snapshot shares the
+       *  entries with the index and has its tables prepared; it replaces the previously
+       *  published snapshot, which is deleted as soon as it is not used anymore. This
+       *  function and all functions which change the index must only be called by the
+       *  thread which updates the index.
+       */
+    void PublishSnapshot();
+
+      /** Get the latest published snapshot of the index. The snapshot must not be
+       *  changed, and it must be released by ReleaseSnapshot() after use. This function
+       *  can be called by any thread.
+       *  @return Pointer to the snapshot, NULL if no snapshot has been published yet.
+       */
+    WlmFileSystemIndex *AcquireSnapshot();
+
+      /** Release this snapshot after use, see AcquireSnapshot(). This function can
+       *  be called by any thread.
+       */
+    void ReleaseSnapshot();
+
+  private:
+      /** Privately defined copy constructor.
+       *  @param old Object which shall be copied.
+       */
+    WlmFileSystemIndex( const WlmFileSystemIndex &old );
+
+      /** Privately defined assignment operator.
+       *  @param obj Object which shall be copied.
+       */
+    WlmFileSystemIndex &operator=( const WlmFileSystemIndex &obj );
+
+      /** Find the position of the entry for the given file, or the position where
+       *  an entry for this file would have to be inserted.
+       *  @param fileName Name of the worklist file (without path).
+       *  @param found Set to OFTrue if there is an entry for this file.
+       *  @return Position in the array of entries.
+       */
+    size_t FindPosition( const OFString &fileName, OFBool &found ) const;
+
+      /** Rebuild the tables of matching key attribute values and the record set after
+       *  the entries changed.
+       */
+    void RebuildKeyTables();
+
+      /** Remove an entry from this index, and delete it if it is not contained in any
+       *  other index (i.e. a snapshot) anymore.
+       *  @param entry The entry.
+       */
+    static void ReleaseEntry( Entry *entry );
+
+    /// value of a matching key attribute in a table of values
+    struct KeyTableEntry
+    {
+      /// the value, points into Entry::keyValues
+      const char *value;
+      /// index of the entry
+      size_t entry;
+    };
+
+      /** Compare function for qsort() which sorts a table of values.
+       *  @param a Pointer to the first KeyTableEntry.
+       *  @param b Pointer to the second KeyTableEntry.
+       *  @return Result of comparing the values with strcmp().
+       */
+    static int CompareKeyTableEntries( const void *a, const void *b );
+
+    /// path of the directory that contains the worklist files
+    OFString directory;
+    /// entries of the index, sorted by file name
+    OFVector<Entry *> entries;
+    /// values of the matching key attributes, sorted by value
+    OFVector<KeyTableEntry> keyTables[NUMBER_OF_KEY_TYPES];
+    /// values of the matching key attributes of all entries
+    WlmMatchingRecordSet records;
+    /// OFTrue if the tables of values and the record set have to be rebuilt
+    OFBool keyTablesOutdated;
+    /// inotify file descriptor for watching the directory, -1 if the directory is not watched
+    int notifyHandle;
+    /// process which started watching the directory
+    long watchingProcess;
+    /// OFTrue if PollChanges() has been called before
+    OFBool polled;
+    /// index of which this index is a snapshot, NULL if this index is not a snapshot
+    WlmFileSystemIndex *origin;
+    /// OFTrue if the entries have changed since the last snapshot was published
+    OFBool snapshotOutdated;
+    /// latest published snapshot, NULL if no snapshot has been published yet
+    WlmFileSystemIndex *snapshot;
+    /// snapshots which have been replaced, but might still be in use
+    OFVector<WlmFileSystemIndex *> retiredSnapshots;
+    /// number of threads which currently use this index as a snapshot
+    unsigned long snapshotUsers;
+#ifdef WITH_THREADS
+    /// mutex which protects the published snapshot and the number of users of all snapshots
+    OFMutex snapshotMutex;
+#endif
+};
+
+#endif
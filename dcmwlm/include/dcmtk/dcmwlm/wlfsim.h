@@ -27,6 +27,11 @@
 #include "dcmtk/ofstd/oftypes.h"   /* for OFBool */
 #include "dcmtk/ofstd/ofvector.h"
 #include "dcmtk/dcmwlm/wldefine.h"
+#include "dcmtk/dcmwlm/wlfsidx.h"
+
+#ifdef WITH_THREADS
+#include "dcmtk/ofstd/ofthread.h"
+#endif
 
 template <class T> class OFOrderedSet;
 struct WlmSuperiorSequenceInfoType;
@@ -63,6 +68,87 @@ class DCMTK_DCMWLM_EXPORT WlmFileSystemInteractionManager
     DcmDataset **matchingRecords;
     /// number of array fields
     unsigned long numOfMatchingRecords;
+    /// indicates if the worklist files shall be kept in an in-memory index instead of being read for each query
+    OFBool enableIndexOfWlFiles;
+    /// in-memory indexes of the worklist files, one for each directory (i.e. called AE title)
+    OFVector<WlmFileSystemIndex *> worklistIndexes;
+    /// object whose indexes are used (through their snapshots) instead of own indexes, NULL if none
+    WlmFileSystemInteractionManager *indexOwner;
+    /// indicates if snapshots of the indexes shall be published after each update
+    OFBool publishSnapshotsOfIndexes;
+#ifdef WITH_THREADS
+    /// mutex which protects the list of indexes against concurrent access by other objects
+    OFMutex worklistIndexesMutex;
+#endif
+
+      /** This function returns the path of the directory that contains the worklist
+       *  files for the current called application entity title, i.e. dfPath and
+       *  calledApplicationEntityTitle separated by PATH_SEPARATOR.
+       *  @return Path of the directory.
+       */
+    OFString GetWorklistDirectory();
+
+      /** This function returns the in-memory index of the worklist files in the directory
+       *  specified by dfPath and calledApplicationEntityTitle. The index is created and
+       *  watched for changes on first use, but not updated.
+       *  @return Pointer to the index, never NULL.
+       */
+    WlmFileSystemIndex *GetWorklistIndex();
+
+      /** This function returns the latest published snapshot of the in-memory index of the
+       *  worklist files in the given directory. It can be called by any thread.
+       *  @param directory Path of the directory, see GetWorklistDirectory().
+       *  @return Pointer to the snapshot, which has to be released by
+       *          WlmFileSystemIndex::ReleaseSnapshot(); NULL if there is none.
+       */
+    WlmFileSystemIndex *AcquireWorklistIndexSnapshot( const OFString &directory );
+
+      /** This function updates the entry for the given worklist file in the given index.
+       *  The file is only read if it is not in the index yet, if its size or modification
+       *  time has changed, or if reading is forced. If the file does not exist anymore,
+       *  its entry is removed from the index.
+       *  @param index     The index to be updated.
+       *  @param fileName  Name of the worklist file (without path).
+       *  @param scanTime  Time when the update of the index was started.
+       *  @param forceRead Read the file even if its size and modification time are unchanged.
+       *  @return OFTrue in case the file was read, OFFalse otherwise.
+       */
+    OFBool UpdateWorklistIndexEntry( WlmFileSystemIndex &index, const OFString &fileName, time_t scanTime, OFBool forceRead );
+
+      /** This function reads a worklist file and stores its dataset and the values of
+       *  the indexed matching key attributes in the given index entry. Incomplete files
+       *  are rejected if enableRejectionOfIncompleteWlFiles is set, in which case the
+       *  dataset of the entry remains NULL.
+       *  @param fullName Path and filename of the worklist file.
+       *  @param entry    The index entry to be filled.
+       */
+    void ReadWorklistFile( const OFString &fullName, WlmFileSystemIndex::Entry &entry );
+
+      /** This function determines the entries of the given index which can match the
+       *  given search mask, based on the values of the indexed matching key attributes
+       *  in the search mask. Entries which are not part of the result do not match the
+       *  search mask; entries which are part of the result still have to be matched
+       *  completely (see WlmMatchingPlan).
+       *  @param index      The index of the worklist files.
+       *  @param searchMask The search mask.
+       *  @param candidates Indexes of the entries (see WlmFileSystemIndex::GetEntry()) in
+       *                    ascending order, only valid if OFTrue is returned.
+       *  @return OFTrue if the search mask restricts the entries to be matched,
+       *          OFFalse if all entries have to be matched.
+       */
+    OFBool DetermineIndexCandidates( WlmFileSystemIndex &index, DcmDataset *searchMask, OFVector<size_t> &candidates );
+
+      /** This function determines the range of normalized (YYYYMMDD) scheduled procedure
+       *  step start dates that can match the given values in the search mask. It fails if
+       *  the values do not restrict the date, or if they are not in a form the index can
+       *  handle, in which case the index must not be used for the start date.
+       *  @param searchMaskDateValue Value of the start date in the search mask; might be NULL.
+       *  @param searchMaskTimeValue Value of the start time in the search mask; might be NULL.
+       *  @param lower Lower bound of the date range, only valid if OFTrue is returned.
+       *  @param upper Upper bound of the date range, only valid if OFTrue is returned.
+       *  @return OFTrue if the date range was determined, OFFalse otherwise.
+       */
+    OFBool DetermineIndexDateRange( const char *searchMaskDateValue, const char *searchMaskTimeValue, OFString &lower, OFString &upper );
 
       /** This function determines all worklist files in the directory specified by
        *  dfPath and calledApplicationEntityTitle, and returns the complete path and
@@ -406,6 +492,30 @@ class DCMTK_DCMWLM_EXPORT WlmFileSystemInteractionManager
        */
     void SetEnableRejectionOfIncompleteWlFiles( OFBool value );
 
+      /**  Set value in member variable.
+       *  @param value The value to set.
+       */
+    void SetEnableIndexOfWlFiles( OFBool value );
+
+      /** This function updates the in-memory index of the worklist files in the directory
+       *  specified by dfPath and calledApplicationEntityTitle, i.e. reads all new and changed
+       *  worklist files and removes deleted ones. If the directory is watched for changes,
+       *  only the files reported as changed are examined. This function does nothing if
+       *  the index is not enabled.
+       */
+    void UpdateWorklistIndex();
+
+      /** Use the in-memory indexes of the given object instead of own indexes. This object
+       *  does not update the indexes, but uses the snapshots that are published by the given
+       *  object each time it updates an index, so that this object can be used in a thread
+       *  other than the one using the given object. If no snapshot is available for a
+       *  directory, the worklist files are read for each query. This function has to be
+       *  called by the thread using the given object.
+       *  @param owner The object which maintains the indexes; must not be deleted before
+       *               this object.
+       */
+    void SetIndexOwner( WlmFileSystemInteractionManager *owner );
+
       /** Connects to the worklist file system database.
        *  @param dfPathv Path to worklist file system database.
        *  @return Indicates if the connection could be established or not.
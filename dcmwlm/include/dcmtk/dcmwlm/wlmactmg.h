@@ -29,8 +29,13 @@
 #include "dcmtk/dcmnet/dimse.h"    /* for T_DIMSE_BlockingMode */
 #include "dcmtk/dcmwlm/wltypdef.h" /* for WlmRefuseReasonType */
 
+#ifdef WITH_THREADS
+#include "dcmtk/ofstd/ofthread.h"
+#endif
+
 class WlmDataSource;
 class OFCondition;
+class WlmAssociationThread;
 
 /** This class encapsulates data structures and operations for basic worklist management service
  *  class providers.
@@ -38,6 +43,8 @@ class OFCondition;
 class DCMTK_DCMWLM_EXPORT WlmActivityManager
 {
   protected:
+    friend class WlmAssociationThread;
+
     /// data source connection object
     WlmDataSource *dataSource;
     /// port on which the application is listening
@@ -77,8 +84,20 @@ class DCMTK_DCMWLM_EXPORT WlmActivityManager
     char **supportedAbstractSyntaxes;
     /// number of array fields
     int numberOfSupportedAbstractSyntaxes;
-    /// table of processes for non-single process mode
+    /// table of processes for non-single process mode (or worker threads in multi-thread mode)
     OFList<WlmProcessSlotType*> processTable;
+    /// indicates if each association shall be handled in a separate thread (instead of a child process)
+    OFBool opt_multiThread;
+#ifdef WITH_THREADS
+    /// worker threads which handle an association in multi-thread mode
+    OFList<WlmAssociationThread*> threads;
+    /// IDs of the worker threads which have finished, but have not been joined yet
+    OFList<int> finishedThreads;
+    /// mutex which protects the list of finished worker threads
+    OFMutex threadMutex;
+    /// ID of the next worker thread, used in the table of processes
+    int nextThreadID;
+#endif
 
       /** This function takes care of receiving, negotiating and accepting/refusing an
        *  association request. Additionally, it handles the request the association
@@ -93,6 +112,28 @@ class DCMTK_DCMWLM_EXPORT WlmActivityManager
        */
     void CleanChildren();
 
+#ifdef WITH_THREADS
+      /** This function handles an association in a new worker thread (multi-thread mode).
+       *  @param assoc                 The association (network connection to another DICOM
+       *                               application), owned by the thread upon successful return.
+       *  @param associationDataSource Data source which shall be used by the thread, owned by
+       *                               the thread upon successful return.
+       *  @return OFCondition value denoting success or error.
+       */
+    OFCondition StartAssociationThread( T_ASC_Association *assoc, WlmDataSource *associationDataSource );
+
+      /** This function notes that the worker thread with the given ID has finished. It is
+       *  called by the worker thread itself, the thread is joined in JoinFinishedThreads().
+       *  @param threadID ID of the worker thread.
+       */
+    void ThreadFinished( int threadID );
+
+      /** This function joins all worker threads which have finished and removes them
+       *  from the table which stores all subprocess information.
+       */
+    void JoinFinishedThreads();
+#endif
+
       /** This function negotiates a presentation context which will be used by this application
        *  and the other DICOM appliation that requests an association.
        *  @param assoc The association (network connection to another DICOM application).
@@ -119,18 +160,20 @@ class DCMTK_DCMWLM_EXPORT WlmActivityManager
 
       /** This function takes care of handling the other DICOM application's request. After
        *  having accomplished all necessary steps, the association will be dropped and destroyed.
-       *  @param assoc The association (network connection to another DICOM application).
+       *  @param assoc                 The association (network connection to another DICOM application).
+       *  @param associationDataSource The data source which shall be used for this association.
        */
-    void HandleAssociation( T_ASC_Association *assoc );
+    void HandleAssociation( T_ASC_Association *assoc, WlmDataSource *associationDataSource );
 
       /** This function takes care of handling the other DICOM application's request.
-       *  @param assoc The association (network connection to another DICOM application).
+       *  @param assoc                 The association (network connection to another DICOM application).
+       *  @param associationDataSource The data source which shall be used for this association.
        *  @return An OFCondition value 'cond' for which 'cond.bad()' will always be set
        *          indicating that either some kind of error occurred, or that the peer aborted
        *          the association (DUL_PEERABORTEDASSOCIATION), or that the peer requested the
        *          release of the association (DUL_PEERREQUESTEDRELEASE).
        */
-    OFCondition ReceiveAndHandleCommands( T_ASC_Association *assoc );
+    OFCondition ReceiveAndHandleCommands( T_ASC_Association *assoc, WlmDataSource *associationDataSource );
 
       /** Having received a DIMSE C-ECHO-RQ message, this function takes care of sending a
        *  DIMSE C-ECHO-RSP message over the network connection.
@@ -144,13 +187,14 @@ class DCMTK_DCMWLM_EXPORT WlmActivityManager
 
       /** This function processes a DIMSE C-FIND-RQ commmand that was
        *  received over the network connection.
-       *  @param assoc   The association (network connection to another DICOM application).
-       *  @param request The DIMSE C-FIND-RQ message that was received.
-       *  @param presID  The ID of the presentation context which was specified in the PDV
-       *                 which contained the DIMSE command.
+       *  @param assoc                 The association (network connection to another DICOM application).
+       *  @param request               The DIMSE C-FIND-RQ message that was received.
+       *  @param presID                The ID of the presentation context which was specified in the PDV
+       *                               which contained the DIMSE command.
+       *  @param associationDataSource The data source which shall be used for this association.
        *  @return OFCondition value denoting success or error.
        */
-    OFCondition HandleFindSCP( T_ASC_Association *assoc, T_DIMSE_C_FindRQ *request, T_ASC_PresentationContextID presID );
+    OFCondition HandleFindSCP( T_ASC_Association *assoc, T_DIMSE_C_FindRQ *request, T_ASC_PresentationContextID presID, WlmDataSource *associationDataSource );
 
       /** Protected undefined copy-constructor. Shall never be called.
        *  @param Src Source object.
@@ -203,10 +247,22 @@ class DCMTK_DCMWLM_EXPORT WlmActivityManager
         int argcv = 0,
         char *argvv[] = NULL );
 
-      /** destructor
+      /** destructor. In multi-thread mode, waits until all associations handled by
+       *  worker threads have terminated.
        */
     ~WlmActivityManager();
 
+      /** Specifies if each association shall be handled in a separate thread of this process
+       *  instead of a child process. Each thread uses its own data source object, which is
+       *  created by WlmDataSource::CreateDataSourceForThread(); if the data source does not
+       *  support this, associations are handled one after the other. Multi-thread mode is
+       *  only available if DCMTK has been compiled with thread support, and it is not used
+       *  in single process mode. This function has to be called before
+       *  StartProvidingService().
+       *  @param value OFTrue if associations shall be handled in separate threads.
+       */
+    void SetMultiThreadMode( OFBool value );
+
       /** Starts providing the implemented service for calling SCUs.
        *  After having created an instance of this class, this function
        *  shall be called from main.
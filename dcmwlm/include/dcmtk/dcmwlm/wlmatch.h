@@ -0,0 +1,284 @@
+/*
+ *
+ *  Copyright (C) 2016, OFFIS e.V.
+ *  All rights reserved.  See COPYRIGHT file for details.
+ *
+ *  This software and supporting documentation were developed by
+ *
+ *    OFFIS e.V.
+ *    R&D Division Health
+ *    Escherweg 2
+ *    D-26121 Oldenburg, Germany
+ *
+ *
+ *  Module:  dcmwlm
+ *
+ *  Author:  OFFIS DICOM Team
+ *
+ *  Purpose: Classes for compiled matching of worklist records.
+ *
+ */
+
+#ifndef WlmMatchingPlan_h
+#define WlmMatchingPlan_h
+
+#include "dcmtk/config/osconfig.h"
+#include "dcmtk/ofstd/ofstring.h"
+#include "dcmtk/ofstd/oftypes.h"   /* for OFBool */
+#include "dcmtk/ofstd/ofvector.h"
+#include "dcmtk/dcmwlm/wltypdef.h"
+
+/** This class stores the values of the matching key attributes of a number of
+ *  worklist records column by column, prepared for evaluation by WlmMatchingPlan:
+ *  trailing spaces are removed from string values, and date and time values are
+ *  converted to numbers once, so that matching a record does neither require
+ *  access to its dataset nor any string copying or date and time parsing.
+ */
+class DCMTK_DCMWLM_EXPORT WlmMatchingRecordSet
+{
+  public:
+      /** default constructor.
+       */
+    WlmMatchingRecordSet();
+
+      /** Remove all records.
+       */
+    void Clear();
+
+      /** Reserve memory for the given number of records, so that adding records
+       *  does not require any reallocation until this number is reached.
+       *  @param n Number of records.
+       */
+    void Reserve( size_t n );
+
+      /** Add a record to the set.
+       *  @param values Values of the matching key attributes of the record, in the order
+       *         of WlmFileSystemInteractionManager::DetermineMatchingKeyAttributeValues();
+       *         an array of NUMBER_OF_SUPPORTED_MATCHING_KEY_ATTRIBUTES pointers, NULL
+       *         for attributes that are not present.
+       */
+    void AddRecord( const char *const *values );
+
+      /** Get the number of records in the set.
+       *  @return Number of records.
+       */
+    size_t GetNumberOfRecords() const { return numOfRecords; }
+
+  private:
+    friend class WlmMatchingPlan;
+
+    /// state of a value in the record set
+    enum ValueState
+    {
+      /// the attribute is not present in the record
+      VALUE_Absent,
+      /// the attribute is present (and, for dates and times, could be converted)
+      VALUE_Valid,
+      /// the attribute is present, but is not a valid date or time
+      VALUE_Invalid
+    };
+
+    /// type of a matching key attribute, determines the kind of column it is stored in
+    enum AttributeType
+    {
+      /// string value, stored in a string column
+      ATTR_String,
+      /// date value, stored as YYYYMMDD in a numeric column
+      ATTR_Date,
+      /// time value, stored as seconds in a numeric column
+      ATTR_Time
+    };
+
+      /** Privately defined copy constructor.
+       *  @param old Object which shall be copied.
+       */
+    WlmMatchingRecordSet( const WlmMatchingRecordSet &old );
+
+      /** Privately defined assignment operator.
+       *  @param obj Object which shall be copied.
+       */
+    WlmMatchingRecordSet &operator=( const WlmMatchingRecordSet &obj );
+
+      /** Determine the type of a matching key attribute.
+       *  @param key Number of the matching key attribute.
+       *  @return Type of the attribute.
+       */
+    static AttributeType GetAttributeType( size_t key );
+
+    /// number of records
+    size_t numOfRecords;
+    /// states of the values, one column per matching key attribute
+    OFVector<unsigned char> states[NUMBER_OF_SUPPORTED_MATCHING_KEY_ATTRIBUTES];
+    /// values without trailing spaces, only used for string attributes
+    OFVector<OFString> strings[NUMBER_OF_SUPPORTED_MATCHING_KEY_ATTRIBUTES];
+    /// converted values, only used for date and time attributes
+    OFVector<double> numbers[NUMBER_OF_SUPPORTED_MATCHING_KEY_ATTRIBUTES];
+};
+
+
+/** This class represents a search mask which has been compiled into a list of
+ *  predicates, so that it can be evaluated over a WlmMatchingRecordSet much faster
+ *  than by WlmFileSystemInteractionManager::DatasetMatchesSearchMask(), with exactly
+ *  the same result. Universal matching keys are dropped, wild card patterns are
+ *  split into segments in advance, date and time values are converted to numeric
+ *  ranges, and the remaining predicates are ordered so that the most selective and
+ *  cheapest ones are evaluated first.
+ */
+class DCMTK_DCMWLM_EXPORT WlmMatchingPlan
+{
+  public:
+      /** default constructor, creates a plan which matches all records.
+       */
+    WlmMatchingPlan();
+
+      /** Compile a search mask into this plan.
+       *  @param values Values of the matching key attributes of the search mask, see
+       *         WlmMatchingRecordSet::AddRecord().
+       */
+    void Compile( const char *const *values );
+
+      /** Check whether no record can match the search mask, e.g. because it contains
+       *  an invalid date.
+       *  @return OFTrue if no record can match, OFFalse otherwise.
+       */
+    OFBool MatchesNothing() const { return matchesNothing; }
+
+      /** Get the number of predicates that have to be evaluated for each record.
+       *  @return Number of predicates.
+       */
+    size_t GetNumberOfPredicates() const { return predicates.size(); }
+
+      /** Check whether a single record matches the search mask.
+       *  @param records The record set.
+       *  @param row Number of the record in the record set.
+       *  @return OFTrue if the record matches, OFFalse otherwise.
+       */
+    OFBool Matches( const WlmMatchingRecordSet &records, size_t row ) const;
+
+      /** Remove all records which do not match the search mask from a list of records.
+       *  The predicates are evaluated one at a time over all remaining records.
+       *  @param records The record set.
+       *  @param rows Numbers of the records in the record set which shall be checked;
+       *         the numbers of the matching records remain in their original order.
+       */
+    void Filter( const WlmMatchingRecordSet &records, OFVector<size_t> &rows ) const;
+
+  private:
+    friend class WlmMatchingRecordSet;
+
+    /// kind of comparison performed by a predicate
+    enum PredicateType
+    {
+      /// string value equals the given value
+      PRED_Equal,
+      /// string value matches the given wild card pattern
+      PRED_Wildcard,
+      /// date or time value is within the given range (inclusive)
+      PRED_Range,
+      /// combination of date and time value is within the given range (inclusive)
+      PRED_DateTimeRange
+    };
+
+    /// one condition that a record has to fulfill
+    struct Predicate
+    {
+      /// default constructor
+      Predicate();
+
+      /// kind of comparison
+      PredicateType type;
+      /// number of the matching key attribute (date for PRED_DateTimeRange)
+      size_t key;
+      /// number of the time attribute for PRED_DateTimeRange
+      size_t timeKey;
+      /// OFTrue if a record without this attribute matches
+      OFBool matchAbsent;
+      /// value without trailing spaces for PRED_Equal
+      OFString value;
+      /// segments of the pattern between the star symbols for PRED_Wildcard
+      OFVector<OFString> segments;
+      /// OFTrue if the pattern contains a star symbol
+      OFBool hasStar;
+      /// lower bound (date for PRED_DateTimeRange)
+      double lower;
+      /// upper bound (date for PRED_DateTimeRange)
+      double upper;
+      /// lower time bound for PRED_DateTimeRange
+      double lowerTime;
+      /// upper time bound for PRED_DateTimeRange
+      double upperTime;
+      /// estimated cost of the predicate, used for ordering (lower is evaluated first)
+      int cost;
+    };
+
+      /** Add a predicate for a string attribute which uses single value matching, where a
+       *  record without the attribute only matches an empty value.
+       *  @param key Number of the matching key attribute.
+       *  @param value Value in the search mask; never NULL.
+       */
+    void AddSingleValuePredicate( size_t key, const char *value );
+
+      /** Add a predicate for a string attribute which uses wild card matching.
+       *  @param key Number of the matching key attribute.
+       *  @param value Value in the search mask; never NULL.
+       */
+    void AddWildcardPredicate( size_t key, const char *value );
+
+      /** Add a predicate for a date or time attribute which uses single value matching.
+       *  @param key Number of the matching key attribute.
+       *  @param value Value in the search mask; never NULL.
+       */
+    void AddSingleDateTimePredicate( size_t key, const char *value );
+
+      /** Add a predicate for a date or time attribute which uses range matching.
+       *  @param key Number of the matching key attribute.
+       *  @param value Value in the search mask, contains '-'; never NULL.
+       */
+    void AddDateTimeRangePredicate( size_t key, const char *value );
+
+      /** Add a predicate for the scheduled procedure step start date and time which uses
+       *  combined range matching.
+       *  @param dateValue Date value in the search mask, contains '-'; never NULL.
+       *  @param timeValue Time value in the search mask, contains '-'; never NULL.
+       */
+    void AddCombinedDateTimeRangePredicate( const char *dateValue, const char *timeValue );
+
+      /** Convert a date or time value to a number, see WlmMatchingRecordSet.
+       *  @param type ATTR_Date or ATTR_Time.
+       *  @param value The value without trailing spaces.
+       *  @param result The converted value.
+       *  @return OFTrue if the value could be converted, OFFalse otherwise.
+       */
+    static OFBool ConvertDateTime( WlmMatchingRecordSet::AttributeType type, const OFString &value, double &result );
+
+      /** Determine the bounds of a date or time range.
+       *  @param type ATTR_Date or ATTR_Time.
+       *  @param value The range value, contains '-'; never NULL.
+       *  @param lower The converted lower bound.
+       *  @param upper The converted upper bound.
+       *  @return OFTrue if both bounds could be converted, OFFalse otherwise.
+       */
+    static OFBool ConvertRange( WlmMatchingRecordSet::AttributeType type, const char *value, double &lower, double &upper );
+
+      /** Check whether a value matches a compiled wild card pattern.
+       *  @param predicate The predicate of type PRED_Wildcard.
+       *  @param value The value without trailing spaces.
+       *  @return OFTrue if the value matches, OFFalse otherwise.
+       */
+    static OFBool WildcardMatches( const Predicate &predicate, const OFString &value );
+
+      /** Check whether a record fulfills a predicate.
+       *  @param predicate The predicate.
+       *  @param records The record set.
+       *  @param row Number of the record in the record set.
+       *  @return OFTrue if the record fulfills the predicate, OFFalse otherwise.
+       */
+    static OFBool Evaluate( const Predicate &predicate, const WlmMatchingRecordSet &records, size_t row );
+
+    /// OFTrue if no record can match
+    OFBool matchesNothing;
+    /// predicates which have to be fulfilled, ordered by cost
+    OFVector<Predicate> predicates;
+};
+
+#endif
@@ -97,7 +97,8 @@ enum WlmRefuseReasonType
   WLM_BAD_APP_CONTEXT,
   WLM_BAD_AE_SERVICE,
   WLM_FORCED,
-  WLM_NO_IC_UID
+  WLM_NO_IC_UID,
+  WLM_CANNOT_START_THREAD
 };
 
 /// const objects for error objects
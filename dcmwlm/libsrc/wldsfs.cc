@@ -42,6 +42,15 @@ END_EXTERN_C
 
 #include "dcmtk/dcmwlm/wldsfs.h"
 
+// Open file description locks (Linux) are owned by the open file instead of the process.
+// With these, the read locks of data sources that are used by different threads of the
+// same process (see CreateDataSourceForThread()) do not release each other.
+#ifdef F_OFD_SETLKW
+#define WLM_SETLKW F_OFD_SETLKW
+#else
+#define WLM_SETLKW F_SETLKW
+#endif
+
 // ----------------------------------------------------------------------------
 
 WlmDataSourceFileSystem::WlmDataSourceFileSystem()
@@ -51,7 +60,11 @@ WlmDataSourceFileSystem::WlmDataSourceFileSystem()
 // Parameters   : none.
 // Return Value : none.
   : fileSystemInteractionManager( ), dfPath( "" ), enableRejectionOfIncompleteWlFiles( OFTrue ),
-    handleToReadLockFile( 0 )
+    enableIndexOfWlFiles( OFFalse ), handleToReadLockFile( 0 ), indexOwner( NULL ), indexMaintainer( NULL ),
+    indexUpdateCounts( )
+#ifdef WITH_THREADS
+    , indexUpdateMutex( ), indexUpdateCountMutex( )
+#endif
 {
 }
 
@@ -67,6 +80,13 @@ WlmDataSourceFileSystem::~WlmDataSourceFileSystem()
   // release read lock on data source if it is set
   if( readLockSetOnDataSource ) ReleaseReadlock();
 
+  // the data sources of the other threads are not used anymore at this point
+  if( indexMaintainer != NULL )
+  {
+    indexMaintainer->DisconnectFromDataSource();
+    delete indexMaintainer;
+  }
+
 }
 
 // ----------------------------------------------------------------------------
@@ -80,6 +100,7 @@ OFCondition WlmDataSourceFileSystem::ConnectToDataSource()
 {
   // set variables in fileSystemInteractionManager object
   fileSystemInteractionManager.SetEnableRejectionOfIncompleteWlFiles( enableRejectionOfIncompleteWlFiles );
+  fileSystemInteractionManager.SetEnableIndexOfWlFiles( enableIndexOfWlFiles );
 
   // connect to file system
   OFCondition cond = fileSystemInteractionManager.ConnectToFileSystem( dfPath );
@@ -130,6 +151,125 @@ void WlmDataSourceFileSystem::SetEnableRejectionOfIncompleteWlFiles( OFBool valu
 
 // ----------------------------------------------------------------------------
 
+void WlmDataSourceFileSystem::SetEnableIndexOfWlFiles( OFBool value )
+// Task         : Set member variable.
+// Parameters   : value - Value for member variable.
+// Return Value : none.
+{
+  enableIndexOfWlFiles = value;
+}
+
+// ----------------------------------------------------------------------------
+
+void WlmDataSourceFileSystem::UpdateIndex( const OFString& calledAETitle )
+// Task         : Updates the in-memory index of the worklist files for the given called
+//                application entity title, if the index is enabled.
+// Parameters   : calledAETitle - [in] The called application entity title.
+// Return Value : none.
+{
+  if( !enableIndexOfWlFiles )
+    return;
+
+  // the directory of the called AE title must exist, the
+  // index is updated under a read lock like a query
+  SetCalledApplicationEntityTitle( calledAETitle );
+  if( IsCalledApplicationEntityTitleSupported() && SetReadlock() )
+  {
+    fileSystemInteractionManager.UpdateWorklistIndex();
+    ReleaseReadlock();
+  }
+}
+
+// ----------------------------------------------------------------------------
+
+void WlmDataSourceFileSystem::RequestIndexUpdate( const OFString& calledAETitle )
+// Task         : Updates the in-memory index of the worklist files for the given called
+//                application entity title on behalf of a data source used by another thread.
+//                Requests of several threads which arrive while an update is running are
+//                served by a single subsequent update.
+// Parameters   : calledAETitle - [in] The called application entity title.
+// Return Value : none.
+{
+#ifdef WITH_THREADS
+  // an update which is started after this point sees all changes made so far
+  indexUpdateCountMutex.lock();
+  const unsigned long requested = indexUpdateCounts[ calledAETitle ];
+  indexUpdateCountMutex.unlock();
+
+  indexUpdateMutex.lock();
+  indexUpdateCountMutex.lock();
+  unsigned long &started = indexUpdateCounts[ calledAETitle ];
+  const OFBool needed = ( started == requested );
+  if( needed )
+    started++;
+  indexUpdateCountMutex.unlock();
+  if( needed )
+    UpdateIndex( calledAETitle );
+  else
+    DCMWLM_DEBUG("Worklist index has been updated by another thread in the meantime");
+  indexUpdateMutex.unlock();
+#else
+  UpdateIndex( calledAETitle );
+#endif
+}
+
+// ----------------------------------------------------------------------------
+
+WlmDataSource *WlmDataSourceFileSystem::CreateDataSourceForThread()
+// Task         : Creates a new data source object with the same settings as this object
+//                which can be used to handle an association in a separate thread.
+// Parameters   : none.
+// Return Value : Pointer to the new data source object, NULL in case of an error.
+{
+  // the indexes for the other threads are maintained by a separate object, so that
+  // their updates do not interfere with the use of this object by the main thread
+  if( enableIndexOfWlFiles && indexMaintainer == NULL )
+  {
+    indexMaintainer = CloneDataSource();
+    if( indexMaintainer == NULL )
+      return( NULL );
+  }
+
+  WlmDataSourceFileSystem *threadDataSource = CloneDataSource();
+
+  // the new object does not maintain indexes of its own, but uses
+  // the snapshots of the indexes which the maintaining object publishes
+  if( threadDataSource != NULL && enableIndexOfWlFiles )
+  {
+    threadDataSource->fileSystemInteractionManager.SetIndexOwner( &indexMaintainer->fileSystemInteractionManager );
+    threadDataSource->indexOwner = indexMaintainer;
+  }
+  return( threadDataSource );
+}
+
+// ----------------------------------------------------------------------------
+
+WlmDataSourceFileSystem *WlmDataSourceFileSystem::CloneDataSource()
+// Task         : Creates a new data source object with the same settings as this object
+//                and connects it to the data source.
+// Parameters   : none.
+// Return Value : Pointer to the new data source object, NULL in case of an error.
+{
+  WlmDataSourceFileSystem *clone = new WlmDataSourceFileSystem();
+
+  // copy the settings of this object
+  clone->SetFailOnInvalidQuery( failOnInvalidQuery );
+  clone->SetNoSequenceExpansion( noSequenceExpansion );
+  clone->SetReturnedCharacterSet( returnedCharacterSet );
+  clone->SetDfPath( dfPath );
+  clone->SetEnableRejectionOfIncompleteWlFiles( enableRejectionOfIncompleteWlFiles );
+  clone->SetEnableIndexOfWlFiles( enableIndexOfWlFiles );
+
+  if( clone->ConnectToDataSource().bad() )
+  {
+    delete clone;
+    return( NULL );
+  }
+  return( clone );
+}
+
+// ----------------------------------------------------------------------------
+
 OFBool WlmDataSourceFileSystem::IsCalledApplicationEntityTitleSupported()
 // Date         : December 10, 2001
 // Author       : Thomas Wilkens
@@ -302,6 +442,11 @@ WlmDataSourceStatusType WlmDataSourceFileSystem::StartFindRequest( const DcmData
     << DcmObject::PrintHelper(*identifiers) << OFendl
     << "=============================");
 
+  // In multi-thread mode, bring the index of the worklist files up to date first;
+  // the matching records are then determined from its latest snapshot.
+  if( indexOwner != NULL )
+    indexOwner->RequestIndexUpdate( calledApplicationEntityTitle );
+
   // Set a read lock on the worklist files which shall be read from.
   if( !SetReadlock() )
     return( WLM_REFUSED_OUT_OF_RESOURCES );
@@ -693,14 +838,15 @@ OFBool WlmDataSourceFileSystem::SetReadlock()
   lockdata.l_whence=0;
   lockdata.l_start=0;
   lockdata.l_len=0;
+  lockdata.l_pid=0;
 #if SIZEOF_VOID_P == SIZEOF_INT
   // some systems, e.g. NeXTStep, need the third argument for fcntl calls to be
   // casted to int. Other systems, e.g. OSF1-Alpha, won't accept this because int
   // and struct flock * have different sizes. The workaround used here is to use a
   // typecast to int if sizeof(void *) == sizeof(int) and leave it away otherwise.
-  result = fcntl( handleToReadLockFile, F_SETLKW, (int)(&lockdata) );
+  result = fcntl( handleToReadLockFile, WLM_SETLKW, (int)(&lockdata) );
 #else
-  result = fcntl( handleToReadLockFile, F_SETLKW, &lockdata );
+  result = fcntl( handleToReadLockFile, WLM_SETLKW, &lockdata );
 #endif
 #endif
   if( result == -1 )
@@ -751,10 +897,11 @@ OFBool WlmDataSourceFileSystem::ReleaseReadlock()
   lockdata.l_whence=0;
   lockdata.l_start=0;
   lockdata.l_len=0;
+  lockdata.l_pid=0;
 #if SIZEOF_VOID_P == SIZEOF_INT
-  result = fcntl( handleToReadLockFile, F_SETLKW, (int)(&lockdata) );
+  result = fcntl( handleToReadLockFile, WLM_SETLKW, (int)(&lockdata) );
 #else
-  result = fcntl( handleToReadLockFile, F_SETLKW, &lockdata );
+  result = fcntl( handleToReadLockFile, WLM_SETLKW, &lockdata );
 #endif
 #endif
   if( result == -1 )
@@ -0,0 +1,502 @@
+/*
+ *
+ *  Copyright (C) 2016, OFFIS e.V.
+ *  All rights reserved.  See COPYRIGHT file for details.
+ *
+ *  This software and supporting documentation were developed by
+ *
+ *    OFFIS e.V.
+ *    R&D Division Health
+ *    Escherweg 2
+ *    D-26121 Oldenburg, Germany
+ *
+ *
+ *  Module:  dcmwlm
+ *
+ *  Author:  OFFIS DICOM Team
+ *
+ *  Purpose: Class for an in-memory index of worklist files.
+ *
+ */
+
+// ----------------------------------------------------------------------------
+
+#include "dcmtk/config/osconfig.h"
+
+#define INCLUDE_CSTDLIB
+#define INCLUDE_CSTRING
+#define INCLUDE_CERRNO
+#include "dcmtk/ofstd/ofstdinc.h"
+
+#ifdef HAVE_SYS_INOTIFY_H
+BEGIN_EXTERN_C
+#include <sys/inotify.h>
+#include <poll.h>
+#ifdef HAVE_UNISTD_H
+#include <unistd.h>
+#endif
+END_EXTERN_C
+#endif
+
+#include "dcmtk/ofstd/ofstd.h"
+#include "dcmtk/dcmdata/dcdatset.h"
+#include "dcmtk/dcmwlm/wlds.h"
+
+#include "dcmtk/dcmwlm/wlfsidx.h"
+
+// ----------------------------------------------------------------------------
+
+/* compare function for qsort, a and b are pointers to entry indexes */
+static int compareEntryIndexes( const void *a, const void *b )
+{
+  size_t idxA = *OFstatic_cast(const size_t *, a);
+  size_t idxB = *OFstatic_cast(const size_t *, b);
+  return ( idxA < idxB ) ? -1 : ( ( idxA > idxB ) ? 1 : 0 );
+}
+
+// ----------------------------------------------------------------------------
+
+WlmFileSystemIndex::Entry::Entry()
+  : fileName( "" ), fileSize( 0 ), modificationTime( 0 ), racy( OFFalse ), seen( OFFalse ), dataset( NULL ), useCount( 0 )
+#ifdef WITH_THREADS
+    , datasetMutex( )
+#endif
+{
+  for( int i=0 ; i<NUMBER_OF_KEY_TYPES ; i++ )
+    hasKeyValue[i] = OFFalse;
+  for( int j=0 ; j<NUMBER_OF_SUPPORTED_MATCHING_KEY_ATTRIBUTES ; j++ )
+    hasMatchingKeyValue[j] = OFFalse;
+}
+
+// ----------------------------------------------------------------------------
+
+WlmFileSystemIndex::Entry::~Entry()
+{
+  delete dataset;
+}
+
+// ----------------------------------------------------------------------------
+
+WlmFileSystemIndex::WlmFileSystemIndex( const OFString &directoryv )
+  : directory( directoryv ), entries( ), records( ), keyTablesOutdated( OFTrue ), notifyHandle( -1 ), watchingProcess( 0 ), polled( OFFalse ),
+    origin( NULL ), snapshotOutdated( OFTrue ), snapshot( NULL ), retiredSnapshots( ), snapshotUsers( 0 )
+#ifdef WITH_THREADS
+    , snapshotMutex( )
+#endif
+{
+}
+
+// ----------------------------------------------------------------------------
+
+WlmFileSystemIndex::~WlmFileSystemIndex()
+{
+  // the snapshots are not used anymore at this point
+  delete snapshot;
+  for( size_t i=0 ; i<retiredSnapshots.size() ; i++ )
+    delete retiredSnapshots[i];
+  for( size_t j=0 ; j<entries.size() ; j++ )
+    ReleaseEntry( entries[j] );
+#ifdef HAVE_SYS_INOTIFY_H
+  if( notifyHandle >= 0 )
+    close( notifyHandle );
+#endif
+}
+
+// ----------------------------------------------------------------------------
+
+OFBool WlmFileSystemIndex::StartWatching()
+{
+#ifdef HAVE_SYS_INOTIFY_H
+  if( notifyHandle < 0 )
+  {
+    notifyHandle = inotify_init1( IN_NONBLOCK | IN_CLOEXEC );
+    if( notifyHandle < 0 )
+    {
+      char buf[256];
+      DCMWLM_WARN("Cannot watch worklist directory " << directory << " for changes: " << OFStandard::strerror( errno, buf, sizeof(buf) ));
+      return OFFalse;
+    }
+    // IN_CLOSE_WRITE is not watched since every query opens the lock file for
+    // writing; a file that is still being written causes further IN_MODIFY events
+    const uint32_t mask = IN_CREATE | IN_MODIFY | IN_ATTRIB | IN_MOVED_FROM | IN_MOVED_TO |
+                          IN_DELETE | IN_DELETE_SELF | IN_MOVE_SELF | IN_ONLYDIR;
+    if( inotify_add_watch( notifyHandle, directory.c_str(), mask ) < 0 )
+    {
+      char buf[256];
+      DCMWLM_WARN("Cannot watch worklist directory " << directory << " for changes: " << OFStandard::strerror( errno, buf, sizeof(buf) ));
+      close( notifyHandle );
+      notifyHandle = -1;
+      return OFFalse;
+    }
+    watchingProcess = OFStandard::getProcessID();
+  }
+  return OFTrue;
+#else
+  return OFFalse;
+#endif
+}
+
+// ----------------------------------------------------------------------------
+
+WlmFileSystemIndex::ChangeStatus WlmFileSystemIndex::PollChanges( OFVector<OFString> &changedFiles )
+{
+  changedFiles.clear();
+#ifdef HAVE_SYS_INOTIFY_H
+  if( notifyHandle < 0 )
+    return CHANGES_Unknown;
+
+  // a forked child process shares the event queue with its parent, so it
+  // must not consume the events; it can only check whether there are any
+  if( watchingProcess != OFStandard::getProcessID() )
+  {
+    struct pollfd pfd;
+    pfd.fd = notifyHandle;
+    pfd.events = POLLIN;
+    pfd.revents = 0;
+    return ( poll( &pfd, 1, 0 ) == 0 ) ? CHANGES_None : CHANGES_Unknown;
+  }
+
+  ChangeStatus status = CHANGES_None;
+  OFBool stopWatching = OFFalse;
+  union
+  {
+    struct inotify_event event;
+    char buffer[16384];
+  } events;
+  for( ;; )
+  {
+    ssize_t length = read( notifyHandle, events.buffer, sizeof(events.buffer) );
+    if( length <= 0 )
+    {
+      // EAGAIN means that all events have been read
+      if( length < 0 && errno != EAGAIN && errno != EINTR )
+      {
+        status = CHANGES_Unknown;
+        stopWatching = OFTrue;
+      }
+      if( length == 0 || errno != EINTR )
+        break;
+      continue;
+    }
+    for( ssize_t pos = 0 ; pos < length ; )
+    {
+      const struct inotify_event *event = OFreinterpret_cast(const struct inotify_event *, events.buffer + pos);
+      if( event->mask & ( IN_Q_OVERFLOW | IN_IGNORED | IN_DELETE_SELF | IN_MOVE_SELF | IN_UNMOUNT ) )
+      {
+        // events were lost or the directory itself has gone
+        status = CHANGES_Unknown;
+        if( !( event->mask & IN_Q_OVERFLOW ) )
+          stopWatching = OFTrue;
+      }
+      else if( event->len > 0 && event->name[0] != '\0' )
+      {
+        if( status == CHANGES_None )
+          status = CHANGES_Files;
+        // a file usually causes several events in a row
+        if( changedFiles.empty() || changedFiles.back() != event->name )
+          changedFiles.push_back( event->name );
+      }
+      pos += sizeof(struct inotify_event) + event->len;
+    }
+  }
+  if( stopWatching )
+  {
+    DCMWLM_WARN("Stopped watching worklist directory " << directory << " for changes");
+    close( notifyHandle );
+    notifyHandle = -1;
+  }
+  // the first update of the index has to read all files anyway
+  if( !polled )
+    status = CHANGES_Unknown;
+  polled = OFTrue;
+  if( status == CHANGES_Unknown )
+    changedFiles.clear();
+  return status;
+#else
+  return CHANGES_Unknown;
+#endif
+}
+
+// ----------------------------------------------------------------------------
+
+size_t WlmFileSystemIndex::FindPosition( const OFString &fileName, OFBool &found ) const
+{
+  size_t first = 0;
+  size_t last = entries.size();
+  while( first < last )
+  {
+    size_t middle = first + ( last - first ) / 2;
+    if( entries[middle]->fileName.compare( fileName ) < 0 )
+      first = middle + 1;
+    else
+      last = middle;
+  }
+  found = ( first < entries.size() ) && ( entries[first]->fileName == fileName );
+  return first;
+}
+
+// ----------------------------------------------------------------------------
+
+DcmDataset *WlmFileSystemIndex::CopyDataset( const Entry &entry )
+{
+  // the entries are shared with the snapshots, so the lock belongs to the entry
+#ifdef WITH_THREADS
+  OFMutex &mutex = entry.datasetMutex;
+  mutex.lock();
+#endif
+  DcmDataset *result = new DcmDataset( *entry.dataset );
+#ifdef WITH_THREADS
+  mutex.unlock();
+#endif
+  return result;
+}
+
+// ----------------------------------------------------------------------------
+
+WlmFileSystemIndex::Entry *WlmFileSystemIndex::FindEntry( const OFString &fileName )
+{
+  OFBool found = OFFalse;
+  size_t pos = FindPosition( fileName, found );
+  return found ? entries[pos] : NULL;
+}
+
+// ----------------------------------------------------------------------------
+
+void WlmFileSystemIndex::AddEntry( Entry *entry )
+{
+  OFBool found = OFFalse;
+  size_t pos = FindPosition( entry->fileName, found );
+  entry->useCount++;
+  if( found )
+  {
+    ReleaseEntry( entries[pos] );
+    entries[pos] = entry;
+  }
+  else
+    entries.insert( entries.begin() + pos, entry );
+  keyTablesOutdated = OFTrue;
+  snapshotOutdated = OFTrue;
+}
+
+// ----------------------------------------------------------------------------
+
+void WlmFileSystemIndex::RemoveEntry( const OFString &fileName )
+{
+  OFBool found = OFFalse;
+  size_t pos = FindPosition( fileName, found );
+  if( found )
+  {
+    ReleaseEntry( entries[pos] );
+    entries.erase( entries.begin() + pos );
+    keyTablesOutdated = OFTrue;
+    snapshotOutdated = OFTrue;
+  }
+}
+
+// ----------------------------------------------------------------------------
+
+void WlmFileSystemIndex::ClearSeenFlags()
+{
+  for( size_t i=0 ; i<entries.size() ; i++ )
+    entries[i]->seen = OFFalse;
+}
+
+// ----------------------------------------------------------------------------
+
+size_t WlmFileSystemIndex::RemoveUnseenEntries()
+{
+  // compact the array in place, keeping the order of the remaining entries
+  size_t kept = 0;
+  for( size_t i=0 ; i<entries.size() ; i++ )
+  {
+    if( entries[i]->seen )
+      entries[kept++] = entries[i];
+    else
+      ReleaseEntry( entries[i] );
+  }
+  size_t removed = entries.size() - kept;
+  if( removed > 0 )
+  {
+    entries.resize( kept );
+    keyTablesOutdated = OFTrue;
+    snapshotOutdated = OFTrue;
+  }
+  return removed;
+}
+
+// ----------------------------------------------------------------------------
+
+int WlmFileSystemIndex::CompareKeyTableEntries( const void *a, const void *b )
+{
+  const KeyTableEntry *entryA = OFstatic_cast(const KeyTableEntry *, a);
+  const KeyTableEntry *entryB = OFstatic_cast(const KeyTableEntry *, b);
+  return strcmp( entryA->value, entryB->value );
+}
+
+// ----------------------------------------------------------------------------
+
+void WlmFileSystemIndex::RebuildKeyTables()
+{
+  for( int key=0 ; key<NUMBER_OF_KEY_TYPES ; key++ )
+  {
+    OFVector<KeyTableEntry> &table = keyTables[key];
+    table.clear();
+    table.reserve( entries.size() );
+    for( size_t i=0 ; i<entries.size() ; i++ )
+    {
+      const Entry *entry = entries[i];
+      if( entry->dataset != NULL && entry->hasKeyValue[key] )
+      {
+        KeyTableEntry tableEntry;
+        tableEntry.value = entry->keyValues[key].c_str();
+        tableEntry.entry = i;
+        table.push_back( tableEntry );
+      }
+    }
+    if( !table.empty() )
+      qsort( &table[0], table.size(), sizeof(KeyTableEntry), CompareKeyTableEntries );
+  }
+
+  // one record per entry, so that the record number is the index of the entry
+  records.Clear();
+  records.Reserve( entries.size() );
+  const char *values[NUMBER_OF_SUPPORTED_MATCHING_KEY_ATTRIBUTES];
+  for( size_t i=0 ; i<entries.size() ; i++ )
+  {
+    const Entry *entry = entries[i];
+    for( int j=0 ; j<NUMBER_OF_SUPPORTED_MATCHING_KEY_ATTRIBUTES ; j++ )
+      values[j] = ( entry->dataset != NULL && entry->hasMatchingKeyValue[j] ) ? entry->matchingKeyValues[j].c_str() : NULL;
+    records.AddRecord( values );
+  }
+  keyTablesOutdated = OFFalse;
+}
+
+// ----------------------------------------------------------------------------
+
+void WlmFileSystemIndex::FindEntries( KeyType key, const OFString &lower, const OFString &upper, OFVector<size_t> &result )
+{
+  result.clear();
+  if( keyTablesOutdated )
+    RebuildKeyTables();
+
+  // find the first value that is not less than the lower bound
+  const OFVector<KeyTableEntry> &table = keyTables[key];
+  size_t first = 0;
+  size_t last = table.size();
+  while( first < last )
+  {
+    size_t middle = first + ( last - first ) / 2;
+    if( strcmp( table[middle].value, lower.c_str() ) < 0 )
+      first = middle + 1;
+    else
+      last = middle;
+  }
+
+  // collect all entries up to the upper bound
+  for( size_t i=first ; i<table.size() && strcmp( table[i].value, upper.c_str() ) <= 0 ; i++ )
+    result.push_back( table[i].entry );
+  if( !result.empty() )
+    qsort( &result[0], result.size(), sizeof(size_t), compareEntryIndexes );
+}
+
+// ----------------------------------------------------------------------------
+
+const WlmMatchingRecordSet &WlmFileSystemIndex::GetRecords()
+{
+  if( keyTablesOutdated )
+    RebuildKeyTables();
+  return records;
+}
+
+// ----------------------------------------------------------------------------
+
+void WlmFileSystemIndex::PrepareTables()
+{
+  if( keyTablesOutdated )
+    RebuildKeyTables();
+}
+
+// ----------------------------------------------------------------------------
+
+void WlmFileSystemIndex::ReleaseEntry( Entry *entry )
+{
+  // the use count is only changed by the thread which updates the index
+  if( --entry->useCount == 0 )
+    delete entry;
+}
+
+// ----------------------------------------------------------------------------
+
+void WlmFileSystemIndex::PublishSnapshot()
+{
+  WlmFileSystemIndex *newSnapshot = NULL;
+  if( snapshot == NULL || snapshotOutdated )
+  {
+    // the snapshot shares the entries, only the tables are built anew
+    newSnapshot = new WlmFileSystemIndex( directory );
+    newSnapshot->origin = this;
+    newSnapshot->entries = entries;
+    for( size_t i=0 ; i<entries.size() ; i++ )
+      entries[i]->useCount++;
+    newSnapshot->RebuildKeyTables();
+    snapshotOutdated = OFFalse;
+  }
+
+  // swap the snapshots and determine which of the replaced ones are not used anymore
+  OFVector<WlmFileSystemIndex *> unusedSnapshots;
+#ifdef WITH_THREADS
+  snapshotMutex.lock();
+#endif
+  if( newSnapshot != NULL )
+  {
+    if( snapshot != NULL )
+      retiredSnapshots.push_back( snapshot );
+    snapshot = newSnapshot;
+  }
+  size_t kept = 0;
+  for( size_t j=0 ; j<retiredSnapshots.size() ; j++ )
+  {
+    if( retiredSnapshots[j]->snapshotUsers == 0 )
+      unusedSnapshots.push_back( retiredSnapshots[j] );
+    else
+      retiredSnapshots[kept++] = retiredSnapshots[j];
+  }
+  retiredSnapshots.resize( kept );
+#ifdef WITH_THREADS
+  snapshotMutex.unlock();
+#endif
+
+  // deleting a snapshot releases its entries, which must happen in this thread
+  for( size_t k=0 ; k<unusedSnapshots.size() ; k++ )
+    delete unusedSnapshots[k];
+}
+
+// ----------------------------------------------------------------------------
+
+WlmFileSystemIndex *WlmFileSystemIndex::AcquireSnapshot()
+{
+#ifdef WITH_THREADS
+  snapshotMutex.lock();
+#endif
+  WlmFileSystemIndex *result = snapshot;
+  if( result != NULL )
+    result->snapshotUsers++;
+#ifdef WITH_THREADS
+  snapshotMutex.unlock();
+#endif
+  return result;
+}
+
+// ----------------------------------------------------------------------------
+
+void WlmFileSystemIndex::ReleaseSnapshot()
+{
+  // the number of users is protected by the mutex of the index the snapshot belongs to
+#ifdef WITH_THREADS
+  origin->snapshotMutex.lock();
+#endif
+  snapshotUsers--;
+#ifdef WITH_THREADS
+  origin->snapshotMutex.unlock();
+#endif
+}
@@ -36,6 +36,9 @@ BEGIN_EXTERN_C
 #ifdef HAVE_DIRENT_H
 #include <dirent.h>    // for struct DIR, opendir()
 #endif
+#ifdef HAVE_SYS_STAT_H
+#include <sys/stat.h>  // for stat()
+#endif
 END_EXTERN_C
 
 #include "dcmtk/dcmnet/diutil.h"
@@ -51,6 +54,7 @@ END_EXTERN_C
 #include "dcmtk/dcmdata/dcvrtm.h"
 #include "dcmtk/dcmwlm/wltypdef.h"
 #include "dcmtk/dcmwlm/wlds.h"
+#include "dcmtk/dcmwlm/wlmatch.h"
 #include "dcmtk/dcmdata/dctk.h"
 #include <stdio.h>
 #include <stdlib.h>
@@ -67,7 +71,11 @@ WlmFileSystemInteractionManager::WlmFileSystemInteractionManager()
 // Return Value : none.
   : dfPath( "" ),
     enableRejectionOfIncompleteWlFiles( OFTrue ), calledApplicationEntityTitle( "" ),
-    matchingRecords( NULL ), numOfMatchingRecords( 0 )
+    matchingRecords( NULL ), numOfMatchingRecords( 0 ), enableIndexOfWlFiles( OFFalse ),
+    worklistIndexes( ), indexOwner( NULL ), publishSnapshotsOfIndexes( OFFalse )
+#ifdef WITH_THREADS
+    , worklistIndexesMutex( )
+#endif
 {
 }
 
@@ -80,6 +88,8 @@ WlmFileSystemInteractionManager::~WlmFileSystemInteractionManager()
 // Parameters   : none.
 // Return Value : none.
 {
+  for( size_t i=0 ; i<worklistIndexes.size() ; i++ )
+    delete worklistIndexes[i];
 }
 
 // ----------------------------------------------------------------------------
@@ -91,11 +101,40 @@ void WlmFileSystemInteractionManager::SetEnableRejectionOfIncompleteWlFiles( OFB
 // Parameters   : value - [in] The value to set.
 // Return Value : none.
 {
+  // the indexes only contain the files that passed the check at the time they were read
+  if( value != enableRejectionOfIncompleteWlFiles )
+  {
+    for( size_t i=0 ; i<worklistIndexes.size() ; i++ )
+      delete worklistIndexes[i];
+    worklistIndexes.clear();
+  }
   enableRejectionOfIncompleteWlFiles = value;
 }
 
 // ----------------------------------------------------------------------------
 
+void WlmFileSystemInteractionManager::SetEnableIndexOfWlFiles( OFBool value )
+// Task         : Set value in member variable.
+// Parameters   : value - [in] The value to set.
+// Return Value : none.
+{
+  enableIndexOfWlFiles = value;
+}
+
+// ----------------------------------------------------------------------------
+
+void WlmFileSystemInteractionManager::SetIndexOwner( WlmFileSystemInteractionManager *owner )
+// Task         : Use the in-memory indexes of the given object instead of own indexes.
+// Parameters   : owner - [in] The object which maintains the indexes.
+// Return Value : none.
+{
+  indexOwner = owner;
+  if( owner != NULL )
+    owner->publishSnapshotsOfIndexes = OFTrue;
+}
+
+// ----------------------------------------------------------------------------
+
 OFCondition WlmFileSystemInteractionManager::ConnectToFileSystem( const OFString& dfPathv )
 // Date         : July 11, 2002
 // Author       : Thomas Wilkens
@@ -173,86 +212,576 @@ unsigned long WlmFileSystemInteractionManager::DetermineMatchingRecords( DcmData
 // Parameters   : searchMask - [in] The search mask.
 // Return Value : Number of matching records.
 {
-  OFVector<OFString> worklistFiles;
+  OFVector<DcmDataset *> matches;
 
   // initialize member variables
   matchingRecords = NULL;
   numOfMatchingRecords = 0;
 
-  // determine all worklist files
-  DetermineWorklistFiles( worklistFiles );
+  // compile the search mask into a matching plan which is evaluated for all records
+  const char **mkaValuesSearchMask = NULL;
+  DetermineMatchingKeyAttributeValues( searchMask, mkaValuesSearchMask );
+  WlmMatchingPlan plan;
+  plan.Compile( mkaValuesSearchMask );
+  delete[] mkaValuesSearchMask;
+  if( plan.MatchesNothing() )
+    DCMWLM_DEBUG("Search mask cannot match any worklist file");
+  else
+    DCMWLM_DEBUG("Search mask compiled into " << plan.GetNumberOfPredicates() << " matching conditions");
+
+  // determine the index of the worklist files, if any
+  WlmFileSystemIndex *index = NULL;
+  WlmFileSystemIndex *snapshot = NULL;
+  if( enableIndexOfWlFiles && indexOwner != NULL )
+  {
+    // use the latest snapshot of the index which is kept up to date by the owner
+    snapshot = indexOwner->AcquireWorklistIndexSnapshot( GetWorklistDirectory() );
+    index = snapshot;
+    if( snapshot == NULL )
+      DCMWLM_DEBUG("No snapshot of the worklist index available, reading worklist files");
+  }
+  else if( enableIndexOfWlFiles )
+  {
+    // bring the index of the worklist files up to date
+    index = GetWorklistIndex();
+    UpdateWorklistIndex();
+  }
 
-  // go through all worklist files
-  for( unsigned int i=0 ; i<worklistFiles.size() ; i++ )
+  if( index != NULL )
   {
-    // read information from worklist file
-    DcmFileFormat fileform;
-    if (fileform.loadFile(worklistFiles[i].c_str()).bad())
+    // determine the entries which can match according to the index
+    OFVector<size_t> candidates;
+    OFBool restricted = DetermineIndexCandidates( *index, searchMask, candidates );
+    size_t numOfCandidates = restricted ? candidates.size() : index->GetNumberOfEntries();
+    DCMWLM_DEBUG("Worklist index selected " << numOfCandidates << " of " << index->GetNumberOfEntries() << " worklist files for matching");
+
+    // files which cannot be read or which were rejected are kept in the index without dataset
+    OFVector<size_t> rows;
+    rows.reserve( numOfCandidates );
+    for( size_t i=0 ; i<numOfCandidates ; i++ )
     {
-      DCMWLM_WARN("Could not read worklist file " << worklistFiles[i] << " properly, file will be ignored");
+      size_t idx = restricted ? candidates[i] : i;
+      if( index->GetEntry( idx )->dataset != NULL )
+        rows.push_back( idx );
     }
-    else
+
+    // check which of these entries match the matching key attribute values
+    OFVector<size_t> matchingRows( rows );
+    plan.Filter( index->GetRecords(), matchingRows );
+
+    // both lists are sorted, so the matching entries can be determined in one pass
+    size_t j = 0;
+    for( size_t i=0 ; i<rows.size() ; i++ )
+    {
+      const WlmFileSystemIndex::Entry *entry = index->GetEntry( rows[i] );
+      if( j >= matchingRows.size() || matchingRows[j] != rows[i] )
+      {
+        DCMWLM_INFO("Information from worklist file " << entry->fileName << " does not match query");
+      }
+      else
+      {
+        DCMWLM_INFO("Information from worklist file " << entry->fileName << " matches query");
+        matches.push_back( index->CopyDataset( *entry ) );
+        j++;
+      }
+    }
+
+    // the matching datasets have been copied, so the snapshot is not needed anymore
+    if( snapshot != NULL )
+      snapshot->ReleaseSnapshot();
+  }
+  else
+  {
+    OFVector<OFString> worklistFiles;
+    WlmMatchingRecordSet records;
+
+    // determine all worklist files
+    DetermineWorklistFiles( worklistFiles );
+
+    // in case we are running in verbose mode, dump all worklist file information
+    if (DCM_dcmwlmLogger.isEnabledFor(OFLogger::INFO_LOG_LEVEL))
+    {
+      DCMWLM_INFO("=============================");
+      DCMWLM_INFO("Worklist Database Files:");
+      if( worklistFiles.empty() )
+        DCMWLM_INFO("<no files found>");
+      else
+      {
+        OFVector<OFString>::const_iterator iter = worklistFiles.begin();
+        while( iter != worklistFiles.end() )
+        {
+          DCMWLM_INFO(*iter);
+          ++iter;
+        }
+      }
+      DCMWLM_INFO("=============================");
+    }
+
+    // go through all worklist files
+    for( unsigned int i=0 ; i<worklistFiles.size() ; i++ )
     {
-      // determine the data set which is contained in the worklist file
-      DcmDataset *dataset = fileform.getDataset();
-      if( dataset == NULL )
+      // read information from worklist file
+      DcmFileFormat fileform;
+      if (fileform.loadFile(worklistFiles[i].c_str()).bad())
       {
-        DCMWLM_WARN("Worklist file " << worklistFiles[i] << " is empty, file will be ignored");
+        DCMWLM_WARN("Could not read worklist file " << worklistFiles[i] << " properly, file will be ignored");
       }
       else
       {
-        if( enableRejectionOfIncompleteWlFiles )
-          DCMWLM_INFO("Checking whether worklist file " << worklistFiles[i] << " is complete");
-        // in case option --enable-file-reject is set, we have to check if the current
-        // .wl-file meets certain conditions; in detail, the file's dataset has to be
-        // checked whether it contains all necessary return type 1 attributes and contains
-        // information in all these attributes; if this is condition is not met, the
-        // .wl-file shall be rejected
-        if( enableRejectionOfIncompleteWlFiles && !DatasetIsComplete( dataset ) )
+        // determine the data set which is contained in the worklist file
+        DcmDataset *dataset = fileform.getDataset();
+        if( dataset == NULL )
         {
-          DCMWLM_WARN("Worklist file " << worklistFiles[i] << " is incomplete, file will be ignored");
+          DCMWLM_WARN("Worklist file " << worklistFiles[i] << " is empty, file will be ignored");
         }
         else
         {
-          // check if the current dataset matches the matching key attribute values
-          if( !DatasetMatchesSearchMask( dataset, searchMask ) )
+          if( enableRejectionOfIncompleteWlFiles )
+            DCMWLM_INFO("Checking whether worklist file " << worklistFiles[i] << " is complete");
+          // in case option --enable-file-reject is set, we have to check if the current
+          // .wl-file meets certain conditions; in detail, the file's dataset has to be
+          // checked whether it contains all necessary return type 1 attributes and contains
+          // information in all these attributes; if this is condition is not met, the
+          // .wl-file shall be rejected
+          if( enableRejectionOfIncompleteWlFiles && !DatasetIsComplete( dataset ) )
           {
-            DCMWLM_INFO("Information from worklist file " << worklistFiles[i] << " does not match query");
+            DCMWLM_WARN("Worklist file " << worklistFiles[i] << " is incomplete, file will be ignored");
           }
           else
           {
-            DCMWLM_INFO("Information from worklist file " << worklistFiles[i] << " matches query");
-
-            // since the dataset matches the matching key attribute values
-            // we need to insert it into the matchingRecords array
-            if( numOfMatchingRecords == 0 )
+            // determine the matching key attribute values in the dataset
+            const char **mkaValuesDataset = NULL;
+            DetermineMatchingKeyAttributeValues( dataset, mkaValuesDataset );
+            records.Clear();
+            records.AddRecord( mkaValuesDataset );
+            delete[] mkaValuesDataset;
+
+            // check if the current dataset matches the matching key attribute values
+            if( !plan.Matches( records, 0 ) )
             {
-              matchingRecords = new DcmDataset*[1];
-              matchingRecords[0] = new DcmDataset( *dataset );
+              DCMWLM_INFO("Information from worklist file " << worklistFiles[i] << " does not match query");
             }
             else
             {
-              DcmDataset **tmp = new DcmDataset*[numOfMatchingRecords + 1];
-              for( unsigned long j=0 ; j<numOfMatchingRecords ; j++ )
-                tmp[j] = matchingRecords[j];
-              tmp[numOfMatchingRecords] = new DcmDataset( *dataset );
-              delete[] matchingRecords;
-              matchingRecords = tmp;
-            }
+              DCMWLM_INFO("Information from worklist file " << worklistFiles[i] << " matches query");
 
-            numOfMatchingRecords++;
+              // since the dataset matches the matching key attribute values
+              // we need to insert it into the list of matching records
+              matches.push_back( new DcmDataset( *dataset ) );
+            }
           }
         }
       }
     }
   }
 
+  // store the matching records in the matchingRecords array
+  if( !matches.empty() )
+  {
+    numOfMatchingRecords = OFstatic_cast(unsigned long, matches.size());
+    matchingRecords = new DcmDataset*[numOfMatchingRecords];
+    for( unsigned long j=0 ; j<numOfMatchingRecords ; j++ )
+      matchingRecords[j] = matches[j];
+  }
+
   // return result
   return( numOfMatchingRecords );
 }
 
 // ----------------------------------------------------------------------------
 
+void WlmFileSystemInteractionManager::UpdateWorklistIndex()
+// Task         : This function updates the in-memory index of the worklist files in the directory
+//                specified by dfPath and calledApplicationEntityTitle, i.e. reads all new and changed
+//                worklist files and removes deleted ones.
+// Parameters   : none.
+// Return Value : none.
+{
+  if( !enableIndexOfWlFiles )
+    return;
+
+  WlmFileSystemIndex *index = GetWorklistIndex();
+  time_t scanTime = time( NULL );
+  unsigned long numOfReadFiles = 0;
+
+  // ask the index which files have changed since the last update
+  OFVector<OFString> changedFiles;
+  WlmFileSystemIndex::ChangeStatus status = index->PollChanges( changedFiles );
+  if( status == WlmFileSystemIndex::CHANGES_Files )
+  {
+    // only examine the files that were reported as changed
+    for( size_t i=0 ; i<changedFiles.size() ; i++ )
+    {
+      if( IsWorklistFile( changedFiles[i].c_str() ) && UpdateWorklistIndexEntry( *index, changedFiles[i], scanTime, OFTrue ) )
+        numOfReadFiles++;
+    }
+  }
+  else if( status == WlmFileSystemIndex::CHANGES_Unknown )
+  {
+    // check all files in the directory for changes
+    OFVector<OFString> worklistFiles;
+    DetermineWorklistFiles( worklistFiles );
+    const size_t pathLength = index->GetDirectory().length() + 1;
+    index->ClearSeenFlags();
+    for( size_t i=0 ; i<worklistFiles.size() ; i++ )
+    {
+      if( UpdateWorklistIndexEntry( *index, worklistFiles[i].substr( pathLength ), scanTime, OFFalse ) )
+        numOfReadFiles++;
+    }
+    index->RemoveUnseenEntries();
+  }
+
+  // in forking mode, the index is updated before each child process is forked;
+  // rebuild the tables now so that the child processes inherit them. In threaded
+  // mode, the threads use a snapshot of the index which has its own tables.
+  if( publishSnapshotsOfIndexes )
+    index->PublishSnapshot();
+  else
+    index->PrepareTables();
+
+  DCMWLM_DEBUG("Worklist index for directory " << index->GetDirectory() << " contains "
+    << index->GetNumberOfEntries() << " files, " << numOfReadFiles << " files (re)read");
+}
+
+// ----------------------------------------------------------------------------
+
+OFString WlmFileSystemInteractionManager::GetWorklistDirectory()
+// Task         : This function returns the path of the directory that contains the worklist
+//                files for the current called application entity title.
+// Parameters   : none.
+// Return Value : Path of the directory.
+{
+  // dfPath + PATH_SEPARATOR + calledApplicationEntityTitle
+  OFString path( dfPath );
+  if( !path.empty() && path[path.length()-1] != PATH_SEPARATOR )
+    path += PATH_SEPARATOR;
+  path += calledApplicationEntityTitle;
+  return( path );
+}
+
+// ----------------------------------------------------------------------------
+
+WlmFileSystemIndex *WlmFileSystemInteractionManager::GetWorklistIndex()
+// Task         : This function returns the in-memory index of the worklist files in the directory
+//                specified by dfPath and calledApplicationEntityTitle, and creates it on first use.
+// Parameters   : none.
+// Return Value : Pointer to the index, never NULL.
+{
+  OFString path = GetWorklistDirectory();
+  for( size_t i=0 ; i<worklistIndexes.size() ; i++ )
+  {
+    if( worklistIndexes[i]->GetDirectory() == path )
+      return( worklistIndexes[i] );
+  }
+
+  // a new index is empty, so all files will be read during the first update;
+  // start watching before that so that no change gets lost
+  WlmFileSystemIndex *index = new WlmFileSystemIndex( path );
+  if( index->StartWatching() )
+    DCMWLM_DEBUG("Watching worklist directory " << path << " for changes");
+#ifdef WITH_THREADS
+  worklistIndexesMutex.lock();
+#endif
+  worklistIndexes.push_back( index );
+#ifdef WITH_THREADS
+  worklistIndexesMutex.unlock();
+#endif
+  return( index );
+}
+
+// ----------------------------------------------------------------------------
+
+WlmFileSystemIndex *WlmFileSystemInteractionManager::AcquireWorklistIndexSnapshot( const OFString &directory )
+// Task         : This function returns the latest published snapshot of the in-memory index of the
+//                worklist files in the given directory. It can be called by any thread.
+// Parameters   : directory - [in] Path of the directory.
+// Return Value : Pointer to the snapshot, NULL if there is none.
+{
+  WlmFileSystemIndex *index = NULL;
+#ifdef WITH_THREADS
+  worklistIndexesMutex.lock();
+#endif
+  for( size_t i=0 ; i<worklistIndexes.size() && index == NULL ; i++ )
+  {
+    if( worklistIndexes[i]->GetDirectory() == directory )
+      index = worklistIndexes[i];
+  }
+#ifdef WITH_THREADS
+  worklistIndexesMutex.unlock();
+#endif
+
+  // indexes are never deleted while other objects use them
+  return( index != NULL ? index->AcquireSnapshot() : NULL );
+}
+
+// ----------------------------------------------------------------------------
+
+OFBool WlmFileSystemInteractionManager::UpdateWorklistIndexEntry( WlmFileSystemIndex &index, const OFString &fileName, time_t scanTime, OFBool forceRead )
+// Task         : This function updates the entry for the given worklist file in the given index.
+// Parameters   : index     - [in] The index to be updated.
+//                fileName  - [in] Name of the worklist file (without path).
+//                scanTime  - [in] Time when the update of the index was started.
+//                forceRead - [in] Read the file even if its size and modification time are unchanged.
+// Return Value : OFTrue in case the file was read, OFFalse otherwise.
+{
+  OFString fullName( index.GetDirectory() );
+  fullName += PATH_SEPARATOR;
+  fullName += fileName;
+
+  // files that have been deleted are removed from the index
+  struct stat fileStat;
+  if( stat( fullName.c_str(), &fileStat ) != 0 || ( fileStat.st_mode & S_IFMT ) != S_IFREG )
+  {
+    index.RemoveEntry( fileName );
+    return( OFFalse );
+  }
+
+  // files whose size and modification time are unchanged need not be read again, unless
+  // they were modified in the same second when they were read (and could have changed
+  // again in that second)
+  WlmFileSystemIndex::Entry *entry = index.FindEntry( fileName );
+  if( entry != NULL && !forceRead && !entry->racy &&
+      entry->fileSize == OFstatic_cast(unsigned long, fileStat.st_size) &&
+      entry->modificationTime == fileStat.st_mtime )
+  {
+    entry->seen = OFTrue;
+    return( OFFalse );
+  }
+
+  // read the file into a new entry
+  entry = new WlmFileSystemIndex::Entry;
+  entry->fileName = fileName;
+  entry->fileSize = OFstatic_cast(unsigned long, fileStat.st_size);
+  entry->modificationTime = fileStat.st_mtime;
+  entry->racy = ( fileStat.st_mtime >= scanTime );
+  entry->seen = OFTrue;
+  ReadWorklistFile( fullName, *entry );
+  index.AddEntry( entry );
+  return( OFTrue );
+}
+
+// ----------------------------------------------------------------------------
+
+static OFString StripTrailingSpaces( const char *value )
+// Task         : This function returns a copy of the given value without trailing spaces.
+// Parameters   : value - [in] The value; never NULL.
+// Return Value : The value without trailing spaces.
+{
+  char *v = new char[ strlen( value ) + 1 ];
+  strcpy( v, value );
+  DU_stripTrailingSpaces( v );
+  OFString result( v );
+  delete[] v;
+  return( result );
+}
+
+// ----------------------------------------------------------------------------
+
+void WlmFileSystemInteractionManager::ReadWorklistFile( const OFString &fullName, WlmFileSystemIndex::Entry &entry )
+// Task         : This function reads a worklist file and stores its dataset and the values of
+//                the indexed matching key attributes in the given index entry.
+// Parameters   : fullName - [in] Path and filename of the worklist file.
+//                entry    - [inout] The index entry to be filled.
+// Return Value : none.
+{
+  // read information from worklist file
+  DcmFileFormat fileform;
+  if( fileform.loadFile( fullName.c_str() ).bad() )
+  {
+    DCMWLM_WARN("Could not read worklist file " << fullName << " properly, file will be ignored");
+    return;
+  }
+
+  // determine the data set which is contained in the worklist file
+  DcmDataset *dataset = fileform.getAndRemoveDataset();
+  if( dataset == NULL )
+  {
+    DCMWLM_WARN("Worklist file " << fullName << " is empty, file will be ignored");
+    return;
+  }
+
+  // the file might change while the dataset is kept in the index, so
+  // large element values must not be loaded from the file on first access
+  dataset->loadAllDataIntoMemory();
+
+  // in case option --enable-file-reject is set, reject incomplete files
+  // (see DetermineMatchingRecords())
+  if( enableRejectionOfIncompleteWlFiles )
+  {
+    DCMWLM_INFO("Checking whether worklist file " << fullName << " is complete");
+    if( !DatasetIsComplete( dataset ) )
+    {
+      DCMWLM_WARN("Worklist file " << fullName << " is incomplete, file will be ignored");
+      delete dataset;
+      return;
+    }
+  }
+
+  // remember the values of the matching key attributes; these are
+  // exactly the values which will be used for matching (see WlmMatchingRecordSet)
+  const char **mkaValues = NULL;
+  DetermineMatchingKeyAttributeValues( dataset, mkaValues );
+  for( unsigned long i=0 ; i<NUMBER_OF_SUPPORTED_MATCHING_KEY_ATTRIBUTES ; i++ )
+  {
+    if( mkaValues[i] != NULL )
+    {
+      entry.matchingKeyValues[i] = mkaValues[i];
+      entry.hasMatchingKeyValue[i] = OFTrue;
+    }
+  }
+  if( mkaValues[0] != NULL )
+  {
+    entry.keyValues[WlmFileSystemIndex::KEY_ScheduledStationAETitle] = StripTrailingSpaces( mkaValues[0] );
+    entry.hasKeyValue[WlmFileSystemIndex::KEY_ScheduledStationAETitle] = OFTrue;
+  }
+  if( mkaValues[1] != NULL )
+  {
+    // dates are normalized so that they can be compared as strings
+    OFDate date;
+    if( DcmDate::getOFDateFromString( StripTrailingSpaces( mkaValues[1] ), date ).good() &&
+        date.getISOFormattedDate( entry.keyValues[WlmFileSystemIndex::KEY_ScheduledProcedureStepStartDate], OFFalse ) )
+      entry.hasKeyValue[WlmFileSystemIndex::KEY_ScheduledProcedureStepStartDate] = OFTrue;
+  }
+  if( mkaValues[3] != NULL )
+  {
+    entry.keyValues[WlmFileSystemIndex::KEY_Modality] = StripTrailingSpaces( mkaValues[3] );
+    entry.hasKeyValue[WlmFileSystemIndex::KEY_Modality] = OFTrue;
+  }
+  if( mkaValues[8] != NULL )
+  {
+    entry.keyValues[WlmFileSystemIndex::KEY_PatientID] = StripTrailingSpaces( mkaValues[8] );
+    entry.hasKeyValue[WlmFileSystemIndex::KEY_PatientID] = OFTrue;
+  }
+  delete[] mkaValues;
+
+  entry.dataset = dataset;
+}
+
+// ----------------------------------------------------------------------------
+
+OFBool WlmFileSystemInteractionManager::DetermineIndexCandidates( WlmFileSystemIndex &index, DcmDataset *searchMask, OFVector<size_t> &candidates )
+// Task         : This function determines the entries of the given index which can match the
+//                given search mask, based on the values of the indexed matching key attributes
+//                in the search mask.
+// Parameters   : index      - [in] The index of the worklist files.
+//                searchMask - [in] The search mask.
+//                candidates - [out] Indexes of the entries in ascending order.
+// Return Value : OFTrue  - The search mask restricts the entries to be matched.
+//                OFFalse - All entries have to be matched.
+{
+  OFBool restricted = OFFalse;
+  candidates.clear();
+
+  // determine matching key attribute values in the search mask
+  const char **mkaValuesSearchMask = NULL;
+  DetermineMatchingKeyAttributeValues( searchMask, mkaValuesSearchMask );
+
+  // determine the range of values for each indexed matching key attribute
+  for( int key=0 ; key<WlmFileSystemIndex::NUMBER_OF_KEY_TYPES ; key++ )
+  {
+    OFString lower, upper;
+    OFBool usable = OFFalse;
+    if( key == WlmFileSystemIndex::KEY_ScheduledProcedureStepStartDate )
+      usable = DetermineIndexDateRange( mkaValuesSearchMask[1], mkaValuesSearchMask[2], lower, upper );
+    else
+    {
+      // the other keys use single value matching (see ScheduledStationAETitlesMatch(),
+      // ModalitiesMatch() and PatientsIDsMatch()); a value that is empty after removing
+      // trailing spaces, that contains wild card characters or multiple values cannot be
+      // looked up in the index
+      const char *value = mkaValuesSearchMask[ ( key == WlmFileSystemIndex::KEY_ScheduledStationAETitle ) ? 0 : ( ( key == WlmFileSystemIndex::KEY_Modality ) ? 3 : 8 ) ];
+      if( value != NULL )
+      {
+        lower = StripTrailingSpaces( value );
+        upper = lower;
+        usable = !lower.empty() && lower.find_first_of( "*?\\" ) == OFString_npos;
+      }
+    }
+
+    // only entries that are selected by all usable keys can match
+    if( usable )
+    {
+      OFVector<size_t> entries;
+      index.FindEntries( OFstatic_cast(WlmFileSystemIndex::KeyType, key), lower, upper, entries );
+      if( !restricted )
+        candidates.swap( entries );
+      else
+      {
+        // both vectors are sorted, so the intersection can be computed in one pass
+        size_t n = 0;
+        for( size_t i=0, j=0 ; i<candidates.size() && j<entries.size() ; )
+        {
+          if( candidates[i] < entries[j] )
+            i++;
+          else if( entries[j] < candidates[i] )
+            j++;
+          else
+          {
+            candidates[n++] = candidates[i];
+            i++;
+            j++;
+          }
+        }
+        candidates.resize( n );
+      }
+      restricted = OFTrue;
+    }
+  }
+
+  // free locally allocated memory
+  delete[] mkaValuesSearchMask;
+
+  return( restricted );
+}
+
+// ----------------------------------------------------------------------------
+
+OFBool WlmFileSystemInteractionManager::DetermineIndexDateRange( const char *searchMaskDateValue, const char *searchMaskTimeValue, OFString &lower, OFString &upper )
+// Task         : This function determines the range of normalized scheduled procedure step start
+//                dates that can match the given values in the search mask, following the rules of
+//                ScheduledProcedureStepStartDateTimesMatch().
+// Parameters   : searchMaskDateValue - [in] Value of the start date in the search mask; might be NULL.
+//                searchMaskTimeValue - [in] Value of the start time in the search mask; might be NULL.
+//                lower               - [out] Lower bound of the date range.
+//                upper               - [out] Upper bound of the date range.
+// Return Value : OFTrue if the date range was determined, OFFalse otherwise.
+{
+  if( searchMaskDateValue == NULL )
+    return( OFFalse );
+
+  // a combined date and time range does not restrict the date alone in a way the index can handle
+  OFBool dateIsDateRange = ( strchr( searchMaskDateValue, '-' ) != NULL ) ? OFTrue : OFFalse;
+  OFBool timeIsTimeRange = ( searchMaskTimeValue != NULL && strchr( searchMaskTimeValue, '-' ) != NULL ) ? OFTrue : OFFalse;
+  if( dateIsDateRange && timeIsTimeRange )
+    return( OFFalse );
+
+  OFString value = StripTrailingSpaces( searchMaskDateValue );
+  OFDate lowerDate, upperDate;
+  OFBool result = OFFalse;
+  if( dateIsDateRange )
+  {
+    // same boundary values as in DateRangeMatch()
+    char *lowerValue = NULL, *upperValue = NULL;
+    ExtractValuesFromRange( value.c_str(), lowerValue, upperValue );
+    result = DcmDate::getOFDateFromString( ( lowerValue != NULL ) ? OFString( lowerValue ) : OFString( "19000101" ), lowerDate ).good() &&
+             DcmDate::getOFDateFromString( ( upperValue != NULL ) ? OFString( upperValue ) : OFString( "39991231" ), upperDate ).good();
+    delete[] lowerValue;
+    delete[] upperValue;
+  }
+  else if( !value.empty() )
+  {
+    // a single date is universal if it is empty (see DateSingleValueMatch())
+    result = DcmDate::getOFDateFromString( value, lowerDate ).good();
+    upperDate = lowerDate;
+  }
+
+  return( result &&
+          lowerDate.getISOFormattedDate( lower, OFFalse ) &&
+          upperDate.getISOFormattedDate( upper, OFFalse ) );
+}
+
+// ----------------------------------------------------------------------------
+
 unsigned long WlmFileSystemInteractionManager::GetNumberOfSequenceItemsForMatchingRecord( DcmTagKey sequenceTag, WlmSuperiorSequenceInfoType *superiorSequenceArray, unsigned long numOfSuperiorSequences, unsigned long idx )
 // Date         : January 6, 2004
 // Author       : Thomas Wilkens
@@ -439,11 +968,7 @@ void WlmFileSystemInteractionManager::DetermineWorklistFiles( OFVector<OFString>
   worklistFiles.clear();
 
   // determine complete path to data source files
-  // (dfPath + PATH_SEPARATOR + calledApplicationEntityTitle)
-  OFString path( dfPath );
-  if( !path.empty() && path[path.length()-1] != PATH_SEPARATOR )
-    path += PATH_SEPARATOR;
-  path += calledApplicationEntityTitle;
+  OFString path = GetWorklistDirectory();
 
   // determine worklist files in this folder
 #ifdef HAVE__FINDFIRST
@@ -505,25 +1030,6 @@ void WlmFileSystemInteractionManager::DetermineWorklistFiles( OFVector<OFString>
     closedir( dirp );
   }
 #endif
-
-  // in case we are running in verbose mode, dump all worklist file information
-  if (DCM_dcmwlmLogger.isEnabledFor(OFLogger::INFO_LOG_LEVEL))
-  {
-    DCMWLM_INFO("=============================");
-    DCMWLM_INFO("Worklist Database Files:");
-    if( worklistFiles.empty() )
-      DCMWLM_INFO("<no files found>");
-    else
-    {
-      OFVector<OFString>::const_iterator iter = worklistFiles.begin();
-      while( iter != worklistFiles.end() )
-      {
-        DCMWLM_INFO(*iter);
-        ++iter;
-      }
-    }
-    DCMWLM_INFO("=============================");
-  }
 }
 
 // ----------------------------------------------------------------------------
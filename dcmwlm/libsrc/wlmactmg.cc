@@ -81,6 +81,79 @@ static OFString AddStatusDetail( DcmDataset **statusDetail, const DcmElement *el
 
 // ----------------------------------------------------------------------------
 
+#ifdef WITH_THREADS
+
+/** Worker thread which handles a single association in multi-thread mode.
+ */
+class WlmAssociationThread : public OFThread
+{
+  public:
+      /** constructor.
+       *  @param managerv    The activity manager which accepted the association.
+       *  @param assocv      The association, owned by this thread once it has been started.
+       *  @param dataSourcev The data source used by this thread, owned by this thread.
+       *  @param threadIDv   ID of this thread, used in the table of processes of the manager.
+       */
+    WlmAssociationThread( WlmActivityManager &managerv, T_ASC_Association *assocv, WlmDataSource *dataSourcev, int threadIDv )
+      : OFThread(), manager( managerv ), assoc( assocv ), dataSource( dataSourcev ), threadID( threadIDv )
+    {
+    }
+
+      /** destructor, deletes the data source.
+       */
+    virtual ~WlmAssociationThread()
+    {
+      if( dataSource != NULL )
+      {
+        dataSource->DisconnectFromDataSource();
+        delete dataSource;
+      }
+    }
+
+      /** Release the ownership of the data source, in case the thread could not be started.
+       */
+    void DetachDataSource() { dataSource = NULL; }
+
+      /** Get the ID of this thread.
+       *  @return ID of this thread.
+       */
+    int GetThreadID() const { return threadID; }
+
+  protected:
+      /** Handle the association and notify the manager when done.
+       */
+    virtual void run()
+    {
+      manager.HandleAssociation( assoc, dataSource );
+      manager.ThreadFinished( threadID );
+    }
+
+  private:
+      /** Private undefined copy-constructor. Shall never be called.
+       *  @param Src Source object.
+       */
+    WlmAssociationThread( const WlmAssociationThread &Src );
+
+      /** Private undefined operator=. Shall never be called.
+       *  @param Src Source object.
+       *  @return Reference to this.
+       */
+    WlmAssociationThread &operator=( const WlmAssociationThread &Src );
+
+    /// activity manager which accepted the association
+    WlmActivityManager &manager;
+    /// association handled by this thread
+    T_ASC_Association *assoc;
+    /// data source used by this thread
+    WlmDataSource *dataSource;
+    /// ID of this thread
+    int threadID;
+};
+
+#endif
+
+// ----------------------------------------------------------------------------
+
 WlmActivityManager::WlmActivityManager(
     WlmDataSource *dataSourcev,
     OFCmdUnsignedInt opt_portv,
@@ -126,7 +199,10 @@ WlmActivityManager::WlmActivityManager(
     cmd_argv( argvv ), opt_maxAssociations( opt_maxAssociationsv ),
     opt_blockMode(opt_blockModev), opt_dimse_timeout(opt_dimse_timeoutv), opt_acse_timeout(opt_acse_timeoutv),
     supportedAbstractSyntaxes( NULL ), numberOfSupportedAbstractSyntaxes( 0 ),
-    processTable( )
+    processTable( ), opt_multiThread( OFFalse )
+#ifdef WITH_THREADS
+    , threads( ), finishedThreads( ), threadMutex( ), nextThreadID( 1 )
+#endif
 {
   // initialize supported abstract transfer syntaxes.
   supportedAbstractSyntaxes = new char*[2];
@@ -166,6 +242,17 @@ WlmActivityManager::~WlmActivityManager()
 // Parameters   : none.
 // Return Value : none.
 {
+#ifdef WITH_THREADS
+  // wait for all associations handled by worker threads
+  OFListIterator(WlmAssociationThread*) it = threads.begin();
+  while( it != threads.end() )
+  {
+    (*it)->join();
+    delete *it;
+    it = threads.erase( it );
+  }
+#endif
+
   // free memory
   delete[] supportedAbstractSyntaxes[0];
   delete[] supportedAbstractSyntaxes[1];
@@ -178,6 +265,21 @@ WlmActivityManager::~WlmActivityManager()
 
 // ----------------------------------------------------------------------------
 
+void WlmActivityManager::SetMultiThreadMode( OFBool value )
+// Task         : Specifies if each association shall be handled in a separate thread.
+// Parameters   : value - [in] OFTrue if associations shall be handled in separate threads.
+// Return Value : none.
+{
+#ifdef WITH_THREADS
+  opt_multiThread = value;
+#else
+  if( value )
+    DCMWLM_WARN("Multi-thread mode not available, DCMTK has been compiled without thread support");
+#endif
+}
+
+// ----------------------------------------------------------------------------
+
 OFCondition WlmActivityManager::StartProvidingService()
 // Date         : December 10, 2001
 // Author       : Thomas Wilkens
@@ -232,7 +334,7 @@ OFCondition WlmActivityManager::StartProvidingService()
   else
   {
     // parent process
-    if (!opt_singleProcess)
+    if (!opt_singleProcess && !opt_multiThread)
       DUL_requestForkOnTransportConnectionReceipt(cmd_argc, cmd_argv);
   }
 #endif
@@ -259,11 +361,17 @@ OFCondition WlmActivityManager::StartProvidingService()
     // the calling applications correspondingly.
     cond = WaitForAssociation( net );
 
+#ifdef WITH_THREADS
+    // Clean up any finished worker threads in multi-thread mode.
+    if( opt_multiThread && !opt_singleProcess )
+      JoinFinishedThreads();
+#endif
+
     // Clean up any child processes if the execution is not limited to a single process.
     // (On windows platform, childs are not handled via the process table,
     // so there's no need to clean up children)
 #ifdef HAVE_FORK
-    if( !opt_singleProcess )
+    if( !opt_singleProcess && !opt_multiThread )
       CleanChildren();
 #elif defined(_WIN32)
     // if running in multi-process mode, always terminate child after one association
@@ -301,6 +409,7 @@ void WlmActivityManager::RefuseAssociation( T_ASC_Association **assoc, WlmRefuse
     case WLM_BAD_AE_SERVICE:        DCMWLM_INFO("Refusing Association (bad application entity service)"); break;
     case WLM_FORCED:                DCMWLM_INFO("Refusing Association (forced via command line)"); break;
     case WLM_NO_IC_UID:             DCMWLM_INFO("Refusing Association (no implementation class UID provided)"); break;
+    case WLM_CANNOT_START_THREAD:   DCMWLM_INFO("Refusing Association (cannot create thread)"); break;
     default:                        DCMWLM_INFO("Refusing Association (unknown reason)"); break;
   }
 
@@ -317,6 +426,11 @@ void WlmActivityManager::RefuseAssociation( T_ASC_Association **assoc, WlmRefuse
       rej.source = ASC_SOURCE_SERVICEPROVIDER_PRESENTATION_RELATED;
       rej.reason = ASC_REASON_SP_PRES_TEMPORARYCONGESTION;
       break;
+    case WLM_CANNOT_START_THREAD:
+      rej.result = ASC_RESULT_REJECTEDTRANSIENT;
+      rej.source = ASC_SOURCE_SERVICEPROVIDER_PRESENTATION_RELATED;
+      rej.reason = ASC_REASON_SP_PRES_TEMPORARYCONGESTION;
+      break;
     case WLM_BAD_APP_CONTEXT:
       rej.result = ASC_RESULT_REJECTEDTRANSIENT;
       rej.source = ASC_SOURCE_SERVICEUSER;
@@ -518,11 +632,46 @@ OFCondition WlmActivityManager::WaitForAssociation( T_ASC_Network * net )
   if( opt_singleProcess || opt_forkedChild )
   {
     // Go ahead and handle the association (i.e. handle the callers requests) in this process.
-    HandleAssociation( assoc );
+    HandleAssociation( assoc, dataSource );
+  }
+#ifdef WITH_THREADS
+  else if( opt_multiThread )
+  {
+    // Create a data source for the worker thread. The index of the data source (if any) is
+    // not updated here, but by the worker thread before each query, so that reading changed
+    // worklist files does not delay the acceptance of other associations.
+    WlmDataSource *threadDataSource = dataSource->CreateDataSourceForThread();
+    if( threadDataSource != NULL )
+    {
+      // Pass the called AE title to the new data source like above (condition 5); the
+      // check also makes the data source select the corresponding worklist directory.
+      threadDataSource->SetCalledApplicationEntityTitle( assoc->params->DULparams.calledAPTitle );
+      threadDataSource->IsCalledApplicationEntityTitleSupported();
+    }
+
+    if( threadDataSource == NULL )
+    {
+      // The data source cannot be used by several threads, so handle the association in this thread.
+      DCMWLM_WARN("Data source does not support multi-thread mode, handling association in main thread");
+      HandleAssociation( assoc, dataSource );
+    }
+    else if( StartAssociationThread( assoc, threadDataSource ).bad() )
+    {
+      threadDataSource->DisconnectFromDataSource();
+      delete threadDataSource;
+      RefuseAssociation( &assoc, WLM_CANNOT_START_THREAD );
+      ASC_dropAssociation( assoc );
+      ASC_destroyAssociation( &assoc );
+      return( EC_Normal );
+    }
   }
+#endif
 #ifdef HAVE_FORK
   else
   {
+    // Update the index of the data source (if any) first, so that the sub-process inherits it
+    dataSource->UpdateIndex( assoc->params->DULparams.calledAPTitle );
+
     // Spawn a sub-process to handle the association (i.e. handle the callers requests)
     int pid = (int)(fork());
     if( pid < 0 )
@@ -549,7 +698,7 @@ OFCondition WlmActivityManager::WaitForAssociation( T_ASC_Network * net )
     {
       // If the process id is not positive, this must be the child process.
       // We want to handle the association, i.e. the callers requests.
-      HandleAssociation( assoc );
+      HandleAssociation( assoc, dataSource );
 
       // When everything is finished, terminate the child process.
       exit(0);
@@ -631,12 +780,13 @@ OFCondition WlmActivityManager::NegotiateAssociation( T_ASC_Association *assoc )
 
 // ----------------------------------------------------------------------------
 
-void WlmActivityManager::HandleAssociation( T_ASC_Association *assoc )
+void WlmActivityManager::HandleAssociation( T_ASC_Association *assoc, WlmDataSource *associationDataSource )
 // Date         : December 10, 2001
 // Author       : Thomas Wilkens
 // Task         : This function takes care of handling the other DICOM application's request. After
 //                having accomplished all necessary steps, the association will be dropped and destroyed.
-// Parameters   : assoc - [in] The association (network connection to another DICOM application).
+// Parameters   : assoc                 - [in] The association (network connection to another DICOM application).
+//                associationDataSource - [in] The data source which shall be used for this association.
 // Return Value : none.
 {
   // Receive a DIMSE command and perform all the necessary actions. (Note that ReceiveAndHandleCommands()
@@ -644,7 +794,7 @@ void WlmActivityManager::HandleAssociation( T_ASC_Association *assoc )
   // some kind of error occurred, or that the peer aborted the association (DUL_PEERABORTEDASSOCIATION),
   // or that the peer requested the release of the association (DUL_PEERREQUESTEDRELEASE).) (Also note
   // that ReceiveAndHandleCommands() will never return EC_Normal.)
-  OFCondition cond = ReceiveAndHandleCommands( assoc );
+  OFCondition cond = ReceiveAndHandleCommands( assoc, associationDataSource );
 
   // Clean up on association termination.
   if( cond == DUL_PEERREQUESTEDRELEASE )
@@ -674,11 +824,12 @@ void WlmActivityManager::HandleAssociation( T_ASC_Association *assoc )
 
 // ----------------------------------------------------------------------------
 
-OFCondition WlmActivityManager::ReceiveAndHandleCommands( T_ASC_Association *assoc )
+OFCondition WlmActivityManager::ReceiveAndHandleCommands( T_ASC_Association *assoc, WlmDataSource *associationDataSource )
 // Date         : December 10, 2001
 // Author       : Thomas Wilkens
 // Task         : This function takes care of handling the other DICOM application's request.
-// Parameters   : assoc - [in] The association (network connection to another DICOM application).
+// Parameters   : assoc                 - [in] The association (network connection to another DICOM application).
+//                associationDataSource - [in] The data source which shall be used for this association.
 // Return Value : An OFCondition value 'cond' for which 'cond.bad()' will always be set
 //                indicating that either some kind of error occurred, or that the peer aborted
 //                the association (DUL_PEERABORTEDASSOCIATION), or that the peer requested the
@@ -689,7 +840,7 @@ OFCondition WlmActivityManager::ReceiveAndHandleCommands( T_ASC_Association *ass
   T_ASC_PresentationContextID presID;
 
   // Tell object that manages the data source if it should fail on an invalid query or not.
-  dataSource->SetFailOnInvalidQuery( opt_failInvalidQuery );
+  associationDataSource->SetFailOnInvalidQuery( opt_failInvalidQuery );
 
   // start a loop to be able to receive more than one DIMSE command
   while( cond.good() )
@@ -710,7 +861,7 @@ OFCondition WlmActivityManager::ReceiveAndHandleCommands( T_ASC_Association *ass
           break;
         case DIMSE_C_FIND_RQ:
           // Process C-FIND-Request
-          cond = HandleFindSCP( assoc, &msg.msg.CFindRQ, presID );
+          cond = HandleFindSCP( assoc, &msg.msg.CFindRQ, presID, associationDataSource );
           break;
         case DIMSE_C_CANCEL_RQ:
           // Process C-CANCEL-Request
@@ -776,7 +927,7 @@ struct WlmFindContextType
 
 // ----------------------------------------------------------------------------
 
-OFCondition WlmActivityManager::HandleFindSCP( T_ASC_Association *assoc, T_DIMSE_C_FindRQ *request, T_ASC_PresentationContextID presID )
+OFCondition WlmActivityManager::HandleFindSCP( T_ASC_Association *assoc, T_DIMSE_C_FindRQ *request, T_ASC_PresentationContextID presID, WlmDataSource *associationDataSource )
 // Date         : December 10, 2001
 // Author       : Thomas Wilkens
 // Task         : This function processes a DIMSE C-FIND-RQ commmand that was
@@ -785,12 +936,13 @@ OFCondition WlmActivityManager::HandleFindSCP( T_ASC_Association *assoc, T_DIMSE
 //                request  - [in] The DIMSE C-FIND-RQ message that was received.
 //                presID   - [in] The ID of the presentation context which was specified in the PDV
 //                                which contained the DIMSE command.
+//                associationDataSource - [in] The data source which shall be used for this association.
 // Return Value : OFCondition value denoting success or error.
 {
   // Create callback data which needs to be passed to DIMSE_findProvider later.
   OFString temp_str;
   WlmFindContextType context;
-  context.dataSource = dataSource;
+  context.dataSource = associationDataSource;
   context.priorStatus = WLM_PENDING;
   ASC_getAPTitles( assoc->params, NULL, context.ourAETitle, NULL );
   context.opt_sleepDuringFind = opt_sleepDuringFind;
@@ -821,6 +973,86 @@ OFCondition WlmActivityManager::HandleFindSCP( T_ASC_Association *assoc, T_DIMSE
 
 // ----------------------------------------------------------------------------
 
+#ifdef WITH_THREADS
+
+OFCondition WlmActivityManager::StartAssociationThread( T_ASC_Association *assoc, WlmDataSource *associationDataSource )
+// Task         : This function handles an association in a new worker thread (multi-thread mode).
+// Parameters   : assoc                 - [in] The association (network connection to another DICOM application).
+//                associationDataSource - [in] Data source which shall be used by the thread.
+// Return Value : OFCondition value denoting success or error.
+{
+  int threadID = nextThreadID++;
+  WlmAssociationThread *thread = new WlmAssociationThread( *this, assoc, associationDataSource, threadID );
+
+  // Remember the thread in the process table before it is started, so that
+  // it is counted for the maximum number of concurrent associations.
+  AddProcessToTable( threadID, assoc );
+  int result = thread->start();
+  if( result != 0 )
+  {
+    OFString errStr;
+    OFThread::errorstr( errStr, result );
+    DCMWLM_ERROR("Cannot create association thread: " << errStr);
+    RemoveProcessFromTable( threadID );
+    // the caller still owns the association and the data source
+    thread->DetachDataSource();
+    delete thread;
+    return( EC_IllegalCall );
+  }
+  threads.push_back( thread );
+  return( EC_Normal );
+}
+
+// ----------------------------------------------------------------------------
+
+void WlmActivityManager::ThreadFinished( int threadID )
+// Task         : This function notes that the worker thread with the given ID has finished.
+// Parameters   : threadID - [in] ID of the worker thread.
+// Return Value : none.
+{
+  threadMutex.lock();
+  finishedThreads.push_back( threadID );
+  threadMutex.unlock();
+}
+
+// ----------------------------------------------------------------------------
+
+void WlmActivityManager::JoinFinishedThreads()
+// Task         : This function joins all worker threads which have finished and removes
+//                them from the table which stores all subprocess information.
+// Parameters   : none.
+// Return Value : none.
+{
+  OFList<int> finished;
+  threadMutex.lock();
+  finished.splice( finished.end(), finishedThreads );
+  threadMutex.unlock();
+
+  OFListIterator(int) id = finished.begin();
+  while( id != finished.end() )
+  {
+    OFListIterator(WlmAssociationThread*) it = threads.begin();
+    while( it != threads.end() )
+    {
+      if( (*it)->GetThreadID() == *id )
+      {
+        (*it)->join();
+        delete *it;
+        threads.erase( it );
+        break;
+      }
+      ++it;
+    }
+    RemoveProcessFromTable( *id );
+    DCMWLM_DEBUG("Cleaned up after association thread (" << *id << ")");
+    ++id;
+  }
+}
+
+#endif
+
+// ----------------------------------------------------------------------------
+
 void WlmActivityManager::AddProcessToTable( int pid, T_ASC_Association *assoc )
 // Date         : December 10, 2001
 // Author       : Thomas Wilkens
@@ -0,0 +1,566 @@
+/*
+ *
+ *  Copyright (C) 2016, OFFIS e.V.
+ *  All rights reserved.  See COPYRIGHT file for details.
+ *
+ *  This software and supporting documentation were developed by
+ *
+ *    OFFIS e.V.
+ *    R&D Division Health
+ *    Escherweg 2
+ *    D-26121 Oldenburg, Germany
+ *
+ *
+ *  Module:  dcmwlm
+ *
+ *  Author:  OFFIS DICOM Team
+ *
+ *  Purpose: Classes for compiled matching of worklist records.
+ *
+ */
+
+// ----------------------------------------------------------------------------
+
+#include "dcmtk/config/osconfig.h"
+
+#define INCLUDE_CSTRING
+#define INCLUDE_CCTYPE
+#include "dcmtk/ofstd/ofstdinc.h"
+
+#include "dcmtk/ofstd/ofdate.h"
+#include "dcmtk/ofstd/oftime.h"
+#include "dcmtk/dcmdata/dcvrda.h"
+#include "dcmtk/dcmdata/dcvrtm.h"
+
+#include "dcmtk/dcmwlm/wlmatch.h"
+
+// ----------------------------------------------------------------------------
+
+// numbers of the matching key attributes, see
+// WlmFileSystemInteractionManager::DetermineMatchingKeyAttributeValues()
+#define MKA_ScheduledStationAETitle          0
+#define MKA_ScheduledProcedureStepStartDate  1
+#define MKA_ScheduledProcedureStepStartTime  2
+#define MKA_Modality                         3
+#define MKA_ResponsiblePersonRole            7
+#define MKA_PatientID                        8
+#define MKA_AccessionNumber                  9
+#define MKA_RequestedProcedureID            10
+#define MKA_AdmissionID                     14
+#define MKA_PatientBirthDate                16
+
+// ----------------------------------------------------------------------------
+
+static OFString StripTrailingSpaces( const char *value )
+// Task         : This function returns a copy of the given value without trailing spaces
+//                (like DU_stripTrailingSpaces()).
+// Parameters   : value - [in] The value; never NULL.
+// Return Value : The value without trailing spaces.
+{
+  size_t length = strlen( value );
+  while( length > 0 && isspace( OFstatic_cast(unsigned char, value[length-1]) ) )
+    length--;
+  return( OFString( value, length ) );
+}
+
+// ----------------------------------------------------------------------------
+
+WlmMatchingRecordSet::WlmMatchingRecordSet()
+  : numOfRecords( 0 )
+{
+}
+
+// ----------------------------------------------------------------------------
+
+void WlmMatchingRecordSet::Clear()
+{
+  for( size_t i=0 ; i<NUMBER_OF_SUPPORTED_MATCHING_KEY_ATTRIBUTES ; i++ )
+  {
+    states[i].clear();
+    strings[i].clear();
+    numbers[i].clear();
+  }
+  numOfRecords = 0;
+}
+
+// ----------------------------------------------------------------------------
+
+void WlmMatchingRecordSet::Reserve( size_t n )
+{
+  for( size_t i=0 ; i<NUMBER_OF_SUPPORTED_MATCHING_KEY_ATTRIBUTES ; i++ )
+  {
+    states[i].reserve( n );
+    if( GetAttributeType( i ) == ATTR_String )
+      strings[i].reserve( n );
+    else
+      numbers[i].reserve( n );
+  }
+}
+
+// ----------------------------------------------------------------------------
+
+WlmMatchingRecordSet::AttributeType WlmMatchingRecordSet::GetAttributeType( size_t key )
+{
+  switch( key )
+  {
+    case MKA_ScheduledProcedureStepStartDate:
+    case MKA_PatientBirthDate:
+      return( ATTR_Date );
+    case MKA_ScheduledProcedureStepStartTime:
+      return( ATTR_Time );
+    default:
+      return( ATTR_String );
+  }
+}
+
+// ----------------------------------------------------------------------------
+
+void WlmMatchingRecordSet::AddRecord( const char *const *values )
+{
+  for( size_t i=0 ; i<NUMBER_OF_SUPPORTED_MATCHING_KEY_ATTRIBUTES ; i++ )
+  {
+    AttributeType type = GetAttributeType( i );
+    if( type == ATTR_String )
+    {
+      if( values[i] != NULL )
+      {
+        states[i].push_back( VALUE_Valid );
+        strings[i].push_back( StripTrailingSpaces( values[i] ) );
+      }
+      else
+      {
+        states[i].push_back( VALUE_Absent );
+        strings[i].push_back( OFString() );
+      }
+    }
+    else
+    {
+      double number = 0;
+      if( values[i] == NULL )
+        states[i].push_back( VALUE_Absent );
+      else if( WlmMatchingPlan::ConvertDateTime( type, StripTrailingSpaces( values[i] ), number ) )
+        states[i].push_back( VALUE_Valid );
+      else
+        states[i].push_back( VALUE_Invalid );
+      numbers[i].push_back( number );
+    }
+  }
+  numOfRecords++;
+}
+
+// ----------------------------------------------------------------------------
+
+WlmMatchingPlan::Predicate::Predicate()
+  : type( PRED_Equal ), key( 0 ), timeKey( 0 ), matchAbsent( OFFalse ), value( ), segments( ), hasStar( OFFalse ),
+    lower( 0 ), upper( 0 ), lowerTime( 0 ), upperTime( 0 ), cost( 0 )
+{
+}
+
+// ----------------------------------------------------------------------------
+
+WlmMatchingPlan::WlmMatchingPlan()
+  : matchesNothing( OFFalse ), predicates( )
+{
+}
+
+// ----------------------------------------------------------------------------
+
+void WlmMatchingPlan::Compile( const char *const *values )
+// Task         : This function compiles the values of the matching key attributes of a search mask
+//                into predicates, following the rules of DatasetMatchesSearchMask() and the matching
+//                functions it calls in WlmFileSystemInteractionManager.
+// Parameters   : values - [in] Values of the matching key attributes of the search mask.
+// Return Value : none.
+{
+  matchesNothing = OFFalse;
+  predicates.clear();
+
+  for( size_t i=0 ; i<NUMBER_OF_SUPPORTED_MATCHING_KEY_ATTRIBUTES ; i++ )
+  {
+    if( values[i] == NULL )
+      continue;
+    switch( i )
+    {
+      case MKA_ScheduledStationAETitle:
+      case MKA_Modality:
+      case MKA_ResponsiblePersonRole:
+      case MKA_PatientID:
+        // see CaseSensitiveSingleValueOrWildcardMatch()
+        AddSingleValuePredicate( i, values[i] );
+        break;
+
+      case MKA_ScheduledProcedureStepStartDate:
+      case MKA_ScheduledProcedureStepStartTime:
+      {
+        // see ScheduledProcedureStepStartDateTimesMatch(), which is only called once for both attributes
+        if( i == MKA_ScheduledProcedureStepStartTime && values[MKA_ScheduledProcedureStepStartDate] != NULL )
+          break;
+        const char *dateValue = values[MKA_ScheduledProcedureStepStartDate];
+        const char *timeValue = values[MKA_ScheduledProcedureStepStartTime];
+        OFBool dateIsDateRange = ( dateValue != NULL && strchr( dateValue, '-' ) != NULL ) ? OFTrue : OFFalse;
+        OFBool timeIsTimeRange = ( timeValue != NULL && strchr( timeValue, '-' ) != NULL ) ? OFTrue : OFFalse;
+        if( dateIsDateRange && timeIsTimeRange )
+          AddCombinedDateTimeRangePredicate( dateValue, timeValue );
+        else if( dateIsDateRange )
+          AddDateTimeRangePredicate( MKA_ScheduledProcedureStepStartDate, dateValue );
+        else
+        {
+          // a single date and a single or range time are matched independently
+          if( dateValue != NULL )
+            AddSingleDateTimePredicate( MKA_ScheduledProcedureStepStartDate, dateValue );
+          if( timeIsTimeRange )
+            AddDateTimeRangePredicate( MKA_ScheduledProcedureStepStartTime, timeValue );
+          else if( timeValue != NULL )
+            AddSingleDateTimePredicate( MKA_ScheduledProcedureStepStartTime, timeValue );
+        }
+        break;
+      }
+
+      case MKA_PatientBirthDate:
+        // see PatientsBirthDatesMatch()
+        if( strchr( values[i], '-' ) != NULL )
+          AddDateTimeRangePredicate( i, values[i] );
+        else
+          AddSingleDateTimePredicate( i, values[i] );
+        break;
+
+      default:
+        // see CaseSensitiveSingleValueOrWildcardStripSpacesMatch() and WildcardStripSpacesMatch()
+        AddWildcardPredicate( i, values[i] );
+        break;
+    }
+  }
+
+  // order the predicates by cost, keeping the order of predicates with equal cost
+  for( size_t i=1 ; i<predicates.size() ; i++ )
+  {
+    for( size_t j=i ; j>0 && predicates[j-1].cost > predicates[j].cost ; j-- )
+    {
+      Predicate tmp = predicates[j-1];
+      predicates[j-1] = predicates[j];
+      predicates[j] = tmp;
+    }
+  }
+
+  if( matchesNothing )
+    predicates.clear();
+}
+
+// ----------------------------------------------------------------------------
+
+void WlmMatchingPlan::AddSingleValuePredicate( size_t key, const char *value )
+// Task         : This function adds a predicate for a string attribute which uses single value matching.
+// Parameters   : key   - [in] Number of the matching key attribute.
+//                value - [in] Value in the search mask; never NULL.
+// Return Value : none.
+{
+  // an existing value has to be equal, a missing value only matches an empty search mask value
+  Predicate predicate;
+  predicate.type = PRED_Equal;
+  predicate.key = key;
+  predicate.value = StripTrailingSpaces( value );
+  predicate.matchAbsent = ( value[0] == '\0' ) ? OFTrue : OFFalse;
+  // identifiers are the most selective attributes
+  predicate.cost = ( key == MKA_PatientID ) ? 0 : 2;
+  predicates.push_back( predicate );
+}
+
+// ----------------------------------------------------------------------------
+
+void WlmMatchingPlan::AddWildcardPredicate( size_t key, const char *value )
+// Task         : This function adds a predicate for a string attribute which uses wild card matching.
+// Parameters   : key   - [in] Number of the matching key attribute.
+//                value - [in] Value in the search mask; never NULL.
+// Return Value : none.
+{
+  // universal matching does not need a predicate
+  OFString pattern = StripTrailingSpaces( value );
+  if( pattern.empty() || pattern == "*" )
+    return;
+
+  Predicate predicate;
+  predicate.key = key;
+  if( pattern.find_first_of( "*?" ) == OFString_npos )
+  {
+    // without wild card characters, wild card matching is the same as single value
+    // matching of an existing value
+    predicate.type = PRED_Equal;
+    predicate.value = pattern;
+    predicate.cost = ( key == MKA_AccessionNumber || key == MKA_RequestedProcedureID || key == MKA_AdmissionID ) ? 0 : 2;
+  }
+  else
+  {
+    // split the pattern at the star symbols; empty segments between two star symbols
+    // are dropped, the first and the last segment are always kept since they are anchored
+    predicate.type = PRED_Wildcard;
+    size_t start = 0;
+    size_t pos;
+    while( ( pos = pattern.find( '*', start ) ) != OFString_npos )
+    {
+      if( start == 0 || pos > start )
+        predicate.segments.push_back( pattern.substr( start, pos - start ) );
+      predicate.hasStar = OFTrue;
+      start = pos + 1;
+    }
+    predicate.segments.push_back( pattern.substr( start ) );
+    predicate.cost = 4;
+  }
+  predicate.matchAbsent = OFFalse;
+  predicates.push_back( predicate );
+}
+
+// ----------------------------------------------------------------------------
+
+void WlmMatchingPlan::AddSingleDateTimePredicate( size_t key, const char *value )
+// Task         : This function adds a predicate for a date or time attribute which uses single
+//                value matching (see DateSingleValueMatch() and TimeSingleValueMatch()).
+// Parameters   : key   - [in] Number of the matching key attribute.
+//                value - [in] Value in the search mask; never NULL.
+// Return Value : none.
+{
+  // universal matching does not need a predicate
+  if( value[0] == '\0' )
+    return;
+
+  Predicate predicate;
+  predicate.type = PRED_Range;
+  predicate.key = key;
+  if( !ConvertDateTime( WlmMatchingRecordSet::GetAttributeType( key ), StripTrailingSpaces( value ), predicate.lower ) )
+    matchesNothing = OFTrue;
+  predicate.upper = predicate.lower;
+  predicate.cost = 1;
+  predicates.push_back( predicate );
+}
+
+// ----------------------------------------------------------------------------
+
+void WlmMatchingPlan::AddDateTimeRangePredicate( size_t key, const char *value )
+// Task         : This function adds a predicate for a date or time attribute which uses range
+//                matching (see DateRangeMatch() and TimeRangeMatch()).
+// Parameters   : key   - [in] Number of the matching key attribute.
+//                value - [in] Value in the search mask; never NULL.
+// Return Value : none.
+{
+  Predicate predicate;
+  predicate.type = PRED_Range;
+  predicate.key = key;
+  if( !ConvertRange( WlmMatchingRecordSet::GetAttributeType( key ), value, predicate.lower, predicate.upper ) )
+    matchesNothing = OFTrue;
+  predicate.cost = 3;
+  predicates.push_back( predicate );
+}
+
+// ----------------------------------------------------------------------------
+
+void WlmMatchingPlan::AddCombinedDateTimeRangePredicate( const char *dateValue, const char *timeValue )
+// Task         : This function adds a predicate for the scheduled procedure step start date and
+//                time which uses combined range matching (see DateTimeRangeMatch()).
+// Parameters   : dateValue - [in] Date value in the search mask; never NULL.
+//                timeValue - [in] Time value in the search mask; never NULL.
+// Return Value : none.
+{
+  Predicate predicate;
+  predicate.type = PRED_DateTimeRange;
+  predicate.key = MKA_ScheduledProcedureStepStartDate;
+  predicate.timeKey = MKA_ScheduledProcedureStepStartTime;
+  if( !ConvertRange( WlmMatchingRecordSet::ATTR_Date, dateValue, predicate.lower, predicate.upper ) ||
+      !ConvertRange( WlmMatchingRecordSet::ATTR_Time, timeValue, predicate.lowerTime, predicate.upperTime ) )
+    matchesNothing = OFTrue;
+  predicate.cost = 3;
+  predicates.push_back( predicate );
+}
+
+// ----------------------------------------------------------------------------
+
+OFBool WlmMatchingPlan::ConvertDateTime( WlmMatchingRecordSet::AttributeType type, const OFString &value, double &result )
+// Task         : This function converts a date or time value to a number which can be compared
+//                in the same way as the corresponding OFDate or OFTime object.
+// Parameters   : type   - [in] ATTR_Date or ATTR_Time.
+//                value  - [in] The value without trailing spaces.
+//                result - [out] The converted value.
+// Return Value : OFTrue if the value could be converted, OFFalse otherwise.
+{
+  if( type == WlmMatchingRecordSet::ATTR_Date )
+  {
+    OFDate date;
+    if( DcmDate::getOFDateFromString( value, date ).bad() )
+      return( OFFalse );
+    result = OFstatic_cast(double, date.getYear()) * 10000 + date.getMonth() * 100 + date.getDay();
+  }
+  else
+  {
+    // same as the comparison operators of OFTime
+    OFTime time;
+    if( DcmTime::getOFTimeFromString( value, time ).bad() )
+      return( OFFalse );
+    result = time.getTimeInSeconds( OFTrue /*useTimeZone*/, OFFalse /*normalize*/ );
+  }
+  return( OFTrue );
+}
+
+// ----------------------------------------------------------------------------
+
+OFBool WlmMatchingPlan::ConvertRange( WlmMatchingRecordSet::AttributeType type, const char *value, double &lower, double &upper )
+// Task         : This function determines the bounds of a date or time range, using the same
+//                default values for open ranges as DateRangeMatch() and TimeRangeMatch().
+// Parameters   : type  - [in] ATTR_Date or ATTR_Time.
+//                value - [in] The range value; never NULL.
+//                lower - [out] The converted lower bound.
+//                upper - [out] The converted upper bound.
+// Return Value : OFTrue if both bounds could be converted, OFFalse otherwise.
+{
+  OFString range = StripTrailingSpaces( value );
+  size_t pos = range.find( '-' );
+  OFString lowerValue = range.substr( 0, pos );
+  OFString upperValue = range.substr( pos + 1 );
+  if( lowerValue.empty() )
+    lowerValue = ( type == WlmMatchingRecordSet::ATTR_Date ) ? "19000101" : "000000";
+  if( upperValue.empty() )
+    upperValue = ( type == WlmMatchingRecordSet::ATTR_Date ) ? "39991231" : "235959";
+  return( ConvertDateTime( type, lowerValue, lower ) && ConvertDateTime( type, upperValue, upper ) );
+}
+
+// ----------------------------------------------------------------------------
+
+static OFBool SegmentMatches( const char *value, const OFString &segment )
+// Task         : This function checks whether the beginning of a value matches a segment of a
+//                wild card pattern, where '?' matches any character.
+// Parameters   : value   - [in] The value, at least as long as the segment; never NULL.
+//                segment - [in] The segment, does not contain '*'.
+// Return Value : OFTrue if the value matches, OFFalse otherwise.
+{
+  const char *s = segment.c_str();
+  for( size_t i=0 ; i<segment.length() ; i++ )
+  {
+    if( s[i] != '?' && s[i] != value[i] )
+      return( OFFalse );
+  }
+  return( OFTrue );
+}
+
+// ----------------------------------------------------------------------------
+
+OFBool WlmMatchingPlan::WildcardMatches( const Predicate &predicate, const OFString &value )
+// Task         : This function checks whether a value matches a compiled wild card pattern. The
+//                result is the same as the result of WlmFileSystemInteractionManager::WildcardMatch(),
+//                but the pattern is matched without backtracking: the first and the last segment
+//                are anchored at the beginning and the end of the value, and each segment in
+//                between is matched at the leftmost possible position.
+// Parameters   : predicate - [in] The predicate of type PRED_Wildcard.
+//                value     - [in] The value without trailing spaces.
+// Return Value : OFTrue if the value matches, OFFalse otherwise.
+{
+  const OFVector<OFString> &segments = predicate.segments;
+  const char *v = value.c_str();
+  const size_t length = value.length();
+
+  if( !predicate.hasStar )
+    return( length == segments[0].length() && SegmentMatches( v, segments[0] ) );
+
+  const OFString &first = segments[0];
+  const OFString &last = segments[segments.size()-1];
+  if( length < first.length() + last.length() ||
+      !SegmentMatches( v, first ) ||
+      !SegmentMatches( v + length - last.length(), last ) )
+    return( OFFalse );
+
+  size_t pos = first.length();
+  const size_t end = length - last.length();
+  for( size_t i=1 ; i+1<segments.size() ; i++ )
+  {
+    const OFString &segment = segments[i];
+    while( pos + segment.length() <= end && !SegmentMatches( v + pos, segment ) )
+      pos++;
+    if( pos + segment.length() > end )
+      return( OFFalse );
+    pos += segment.length();
+  }
+  return( OFTrue );
+}
+
+// ----------------------------------------------------------------------------
+
+OFBool WlmMatchingPlan::Evaluate( const Predicate &predicate, const WlmMatchingRecordSet &records, size_t row )
+// Task         : This function checks whether a record fulfills a predicate.
+// Parameters   : predicate - [in] The predicate.
+//                records   - [in] The record set.
+//                row       - [in] Number of the record in the record set.
+// Return Value : OFTrue if the record fulfills the predicate, OFFalse otherwise.
+{
+  const unsigned char state = records.states[predicate.key][row];
+  if( state == WlmMatchingRecordSet::VALUE_Absent )
+    return( predicate.matchAbsent );
+  switch( predicate.type )
+  {
+    case PRED_Equal:
+      return( records.strings[predicate.key][row] == predicate.value );
+
+    case PRED_Wildcard:
+      return( WildcardMatches( predicate, records.strings[predicate.key][row] ) );
+
+    case PRED_Range:
+    {
+      if( state != WlmMatchingRecordSet::VALUE_Valid )
+        return( OFFalse );
+      const double number = records.numbers[predicate.key][row];
+      return( predicate.lower <= number && number <= predicate.upper );
+    }
+
+    case PRED_DateTimeRange:
+    {
+      if( state != WlmMatchingRecordSet::VALUE_Valid ||
+          records.states[predicate.timeKey][row] != WlmMatchingRecordSet::VALUE_Valid )
+        return( OFFalse );
+      const double date = records.numbers[predicate.key][row];
+      const double time = records.numbers[predicate.timeKey][row];
+      return( ( predicate.lower < date || ( predicate.lower == date && predicate.lowerTime <= time ) ) &&
+              ( predicate.upper > date || ( predicate.upper == date && predicate.upperTime >= time ) ) );
+    }
+  }
+  return( OFFalse );
+}
+
+// ----------------------------------------------------------------------------
+
+OFBool WlmMatchingPlan::Matches( const WlmMatchingRecordSet &records, size_t row ) const
+// Task         : This function checks whether a single record matches the search mask.
+// Parameters   : records - [in] The record set.
+//                row     - [in] Number of the record in the record set.
+// Return Value : OFTrue if the record matches, OFFalse otherwise.
+{
+  if( matchesNothing )
+    return( OFFalse );
+  for( size_t i=0 ; i<predicates.size() ; i++ )
+  {
+    if( !Evaluate( predicates[i], records, row ) )
+      return( OFFalse );
+  }
+  return( OFTrue );
+}
+
+// ----------------------------------------------------------------------------
+
+void WlmMatchingPlan::Filter( const WlmMatchingRecordSet &records, OFVector<size_t> &rows ) const
+// Task         : This function removes all records which do not match the search mask from a list
+//                of records, evaluating one predicate at a time over all remaining records.
+// Parameters   : records - [in] The record set.
+//                rows    - [inout] Numbers of the records which shall be checked.
+// Return Value : none.
+{
+  if( matchesNothing )
+  {
+    rows.clear();
+    return;
+  }
+  for( size_t i=0 ; i<predicates.size() && !rows.empty() ; i++ )
+  {
+    const Predicate &predicate = predicates[i];
+    size_t kept = 0;
+    for( size_t j=0 ; j<rows.size() ; j++ )
+    {
+      if( Evaluate( predicate, records, rows[j] ) )
+        rows[kept++] = rows[j];
+    }
+    rows.resize( kept );
+  }
+}
@@ -0,0 +1,33 @@
+/*
+ *
+ *  Copyright (C) 2016, OFFIS e.V.
+ *  All rights reserved.  See COPYRIGHT file for details.
+ *
+ *  This software and supporting documentation were developed by
+ *
+ *    OFFIS e.V.
+ *    R&D Division Health
+ *    Escherweg 2
+ *    D-26121 Oldenburg, Germany
+ *
+ *
+ *  Module:  dcmwlm
+ *
+ *  Author:  OFFIS DICOM Team
+ *
+ *  Purpose: main test program
+ *
+ */
+
+#include "dcmtk/config/osconfig.h"
+
+#include "dcmtk/ofstd/oftest.h"
+
+OFTEST_REGISTER(dcmwlm_matchingPlan);
+OFTEST_REGISTER(dcmwlm_worklistIndex);
+
+#ifdef WITH_THREADS
+OFTEST_REGISTER(dcmwlm_multiThreadServer);
+#endif // WITH_THREADS
+
+OFTEST_MAIN("dcmwlm")
@@ -0,0 +1,368 @@
+/*
+ *
+ *  Copyright (C) 2016, OFFIS e.V.
+ *  All rights reserved.  See COPYRIGHT file for details.
+ *
+ *  This software and supporting documentation were developed by
+ *
+ *    OFFIS e.V.
+ *    R&D Division Health
+ *    Escherweg 2
+ *    D-26121 Oldenburg, Germany
+ *
+ *
+ *  Module:  dcmwlm
+ *
+ *  Author:  OFFIS DICOM Team
+ *
+ *  Purpose: test that the in-memory index of worklist files selects the same
+ *           files as a full scan of the worklist directory, also while the
+ *           worklist files are created, modified and deleted
+ *
+ */
+
+#include "dcmtk/config/osconfig.h"    /* make sure OS specific configuration is included first */
+
+#define INCLUDE_CSTDIO
+#define INCLUDE_CSTDLIB
+#include "dcmtk/ofstd/ofstdinc.h"
+
+BEGIN_EXTERN_C
+#ifdef HAVE_SYS_STAT_H
+#include <sys/stat.h>
+#endif
+#ifdef HAVE_UTIME_H
+#include <utime.h>
+#endif
+END_EXTERN_C
+
+#include "dcmtk/ofstd/oftest.h"
+#include "dcmtk/ofstd/oftempf.h"
+#include "dcmtk/dcmdata/dcfilefo.h"
+#include "dcmtk/dcmdata/dcdeftag.h"
+#include "dcmtk/dcmwlm/wlfsim.h"
+#include "dcmtk/dcmwlm/wlfsidx.h"
+
+#define TEST_AETITLE "WLTEST"
+#define MAX_FILES 9
+
+/* modification time of the worklist files, so that they are not considered
+ * to have changed again in the second they were read
+ */
+#define TEST_MTIME 1451606400
+
+
+/* values of the matching key attributes used by the test, NULL if absent */
+struct TestValues
+{
+    const char *aetitle;
+    const char *date;
+    const char *time;
+    const char *modality;
+    const char *patientID;
+    const char *requestedProcedureID;
+};
+
+/* worklist files with present, empty and absent values; file n has the accession number "A<n>" */
+static const TestValues testFiles[MAX_FILES] =
+{
+    { "AE1",  "20160101", "083000", "CT",  "123",  "RP1"   },
+    { "AE2",  "20160102", "1200",   "MR",  "124",  "RP12"  },
+    { "AE1",  "20151231", "2359",   "CT ", "1234", NULL    },
+    { "AE10", "20160101", "0800",   "US",  "12",   ""      },
+    { NULL,   "20160103", NULL,     "CT",  NULL,   "RP1 "  },
+    { "",     NULL,       "10",     NULL,  "",     "RP2"   },
+    { "AE1",  "20160101", "",       "",    "1?3",  "R*"    },
+    { "AE2 ", "20160110", "000000", "MR",  "123 ", "RP1"   },
+    { "AE3",  "2016010",  "1300",   "CT",  "999",  "RP"    }
+};
+
+/* the values for the search masks, including wild cards, empty values and ranges */
+static const char *testAETitles[] =
+{
+    NULL, "", "  ", "*", "AE1", "AE1 ", "AE?", "AE1*", "XX"
+};
+static const char *testDates[] =
+{
+    NULL, "", "20160101", "20160101-", "-20160101", "20151231-20160102", "2016010", "-"
+};
+static const char *testTimes[] =
+{
+    NULL, "", "0800-1200"
+};
+static const char *testModalities[] =
+{
+    NULL, "", "*", "CT", "CT ", "C?", "CT\\MR", "MR"
+};
+static const char *testPatientIDs[] =
+{
+    NULL, "", "123", "12*", "1?3"
+};
+static const char *testRequestedProcedureIDs[] =
+{
+    NULL, "", "*", "RP1", "RP1*"
+};
+
+#define ARRAY_SIZE(a) (sizeof(a) / sizeof(a[0]))
+
+
+/* file system interaction manager which provides access to its index and matching functions */
+class TestIndexManager : public WlmFileSystemInteractionManager
+{
+  public:
+    /// return the index of the current directory
+    WlmFileSystemIndex *GetIndex()
+    {
+        return GetWorklistIndex();
+    }
+
+    /// return the files selected by the index for the given search mask
+    OFBool GetCandidates( DcmDataset *searchMask, OFVector<size_t> &candidates )
+    {
+        return DetermineIndexCandidates( *GetWorklistIndex(), searchMask, candidates );
+    }
+
+    /// check whether the given dataset matches the search mask, without any index
+    OFBool Matches( DcmDataset *dataset, DcmDataset *searchMask )
+    {
+        return DatasetMatchesSearchMask( dataset, searchMask );
+    }
+
+    /// return the matching records of the last query
+    DcmDataset *GetMatchingRecord( unsigned long idx )
+    {
+        return matchingRecords[idx];
+    }
+};
+
+/* temporary worklist directory with a subdirectory for the called AE title */
+class TestWorklistDirectory
+{
+  public:
+    TestWorklistDirectory()
+    : directory_()
+    , aeDirectory_()
+    {
+        OFTempFile temp;
+        directory_ = temp.getFilename();
+        directory_ += ".wl";
+        OFStandard::createDirectory( directory_, "" );
+        OFStandard::combineDirAndFilename( aeDirectory_, directory_, TEST_AETITLE );
+        OFStandard::createDirectory( aeDirectory_, directory_ );
+    }
+
+    ~TestWorklistDirectory()
+    {
+        OFList<OFString> files;
+        OFStandard::searchDirectoryRecursively( directory_, files );
+        for( OFListIterator(OFString) it = files.begin(); it != files.end(); ++it )
+            OFStandard::deleteFile( *it );
+#ifdef _WIN32
+        _rmdir( aeDirectory_.c_str() );
+        _rmdir( directory_.c_str() );
+#else
+        rmdir( aeDirectory_.c_str() );
+        rmdir( directory_.c_str() );
+#endif
+    }
+
+    /// return the path of the worklist directory
+    const char *path() const
+    {
+        return directory_.c_str();
+    }
+
+    /// return the path of the worklist file with the given number (1..MAX_FILES)
+    OFString fileName( size_t number ) const
+    {
+        char name[32];
+        sprintf( name, "wl%lu.wl", OFstatic_cast(unsigned long, number) );
+        OFString filename;
+        OFStandard::combineDirAndFilename( filename, aeDirectory_, name );
+        return filename;
+    }
+
+    /// write the worklist file with the given number and values
+    OFBool writeFile( size_t number, const TestValues &values )
+    {
+        char accessionNumber[16];
+        sprintf( accessionNumber, "A%lu", OFstatic_cast(unsigned long, number) );
+        DcmFileFormat fileformat;
+        DcmDataset *dset = fileformat.getDataset();
+        dset->putAndInsertString( DCM_AccessionNumber, accessionNumber );
+        dset->putAndInsertString( DCM_PatientName, "Doe^John" );
+        if( values.patientID ) dset->putAndInsertString( DCM_PatientID, values.patientID );
+        if( values.requestedProcedureID ) dset->putAndInsertString( DCM_RequestedProcedureID, values.requestedProcedureID );
+        DcmItem *item = NULL;
+        if( dset->findOrCreateSequenceItem( DCM_ScheduledProcedureStepSequence, item ).bad() )
+            return OFFalse;
+        if( values.aetitle )  item->putAndInsertString( DCM_ScheduledStationAETitle, values.aetitle );
+        if( values.date )     item->putAndInsertString( DCM_ScheduledProcedureStepStartDate, values.date );
+        if( values.time )     item->putAndInsertString( DCM_ScheduledProcedureStepStartTime, values.time );
+        if( values.modality ) item->putAndInsertString( DCM_Modality, values.modality );
+        const OFString filename = fileName( number );
+        if( fileformat.saveFile( filename.c_str(), EXS_LittleEndianExplicit ).bad() )
+            return OFFalse;
+#ifdef HAVE_UTIME_H
+        struct utimbuf times;
+        times.actime = TEST_MTIME;
+        times.modtime = TEST_MTIME;
+        if( utime( filename.c_str(), &times ) != 0 )
+            return OFFalse;
+#endif
+        return OFTrue;
+    }
+
+  private:
+    OFString directory_;
+    OFString aeDirectory_;
+};
+
+/* determine the number of the worklist file from the accession number of its dataset */
+static size_t fileNumber( DcmDataset *dataset )
+{
+    const char *value = NULL;
+    if( dataset == NULL || dataset->findAndGetString( DCM_AccessionNumber, value ).bad() || value == NULL )
+        return 0;
+    return OFstatic_cast(size_t, atoi( value + 1 ));
+}
+
+/* mark the given file in a string with one character per worklist file */
+static void markFile( OFString &files, size_t number )
+{
+    if( number >= 1 && number <= MAX_FILES )
+        files[number - 1] = 'x';
+}
+
+/* create a search mask with the given values */
+static void makeSearchMask( DcmDataset &dset, const TestValues &values )
+{
+    dset.clear();
+    if( values.patientID ) dset.putAndInsertString( DCM_PatientID, values.patientID );
+    if( values.requestedProcedureID ) dset.putAndInsertString( DCM_RequestedProcedureID, values.requestedProcedureID );
+    DcmItem *item = NULL;
+    if( dset.findOrCreateSequenceItem( DCM_ScheduledProcedureStepSequence, item ).good() )
+    {
+        if( values.aetitle )  item->putAndInsertString( DCM_ScheduledStationAETitle, values.aetitle );
+        if( values.date )     item->putAndInsertString( DCM_ScheduledProcedureStepStartDate, values.date );
+        if( values.time )     item->putAndInsertString( DCM_ScheduledProcedureStepStartTime, values.time );
+        if( values.modality ) item->putAndInsertString( DCM_Modality, values.modality );
+    }
+}
+
+/* read all worklist files that currently exist in the directory */
+static void readFiles( const TestWorklistDirectory &directory, OFVector<DcmDataset *> &datasets )
+{
+    for( size_t i = 0; i < datasets.size(); ++i )
+        delete datasets[i];
+    datasets.clear();
+    for( size_t n = 1; n <= MAX_FILES; ++n )
+    {
+        DcmFileFormat fileformat;
+        if( OFStandard::fileExists( directory.fileName( n ) ) &&
+            fileformat.loadFile( directory.fileName( n ).c_str() ).good() )
+            datasets.push_back( fileformat.getAndRemoveDataset() );
+    }
+}
+
+/* compare the files selected with the index for all search masks with a full
+ * scan of the given datasets
+ * @return number of search masks for which the index restricted the candidates
+ */
+static size_t compareWithFullScan( TestIndexManager &manager, OFVector<DcmDataset *> &datasets )
+{
+    size_t restrictedCount = 0;
+    DcmDataset searchMask;
+    TestValues maskValues;
+    for( size_t a = 0; a < ARRAY_SIZE(testAETitles); ++a )
+    for( size_t d = 0; d < ARRAY_SIZE(testDates); ++d )
+    for( size_t t = 0; t < ARRAY_SIZE(testTimes); ++t )
+    for( size_t m = 0; m < ARRAY_SIZE(testModalities); ++m )
+    for( size_t p = 0; p < ARRAY_SIZE(testPatientIDs); ++p )
+    for( size_t r = 0; r < ARRAY_SIZE(testRequestedProcedureIDs); ++r )
+    {
+        maskValues.aetitle = testAETitles[a];
+        maskValues.date = testDates[d];
+        maskValues.time = testTimes[t];
+        maskValues.modality = testModalities[m];
+        maskValues.patientID = testPatientIDs[p];
+        maskValues.requestedProcedureID = testRequestedProcedureIDs[r];
+        makeSearchMask( searchMask, maskValues );
+
+        // files matching according to a full scan
+        OFString expected( MAX_FILES, '-' );
+        for( size_t i = 0; i < datasets.size(); ++i )
+        {
+            if( manager.Matches( datasets[i], &searchMask ) )
+                markFile( expected, fileNumber( datasets[i] ) );
+        }
+
+        // files matching according to a query that uses the index
+        OFString matching( MAX_FILES, '-' );
+        const unsigned long count = manager.DetermineMatchingRecords( &searchMask );
+        for( unsigned long j = 0; j < count; ++j )
+            markFile( matching, fileNumber( manager.GetMatchingRecord( j ) ) );
+        manager.ClearMatchingRecords();
+        OFCHECK_EQUAL( matching, expected );
+
+        // the candidates selected by the index must include all matching files
+        OFVector<size_t> candidates;
+        WlmFileSystemIndex *index = manager.GetIndex();
+        if( manager.GetCandidates( &searchMask, candidates ) )
+        {
+            OFString selected( MAX_FILES, '-' );
+            for( size_t k = 0; k < candidates.size(); ++k )
+                markFile( selected, fileNumber( index->GetEntry( candidates[k] )->dataset ) );
+            for( size_t n = 0; n < MAX_FILES; ++n )
+            {
+                if( expected[n] != '-' )
+                    OFCHECK_EQUAL( selected[n], expected[n] );
+            }
+            ++restrictedCount;
+        }
+    }
+    return restrictedCount;
+}
+
+
+OFTEST(dcmwlm_worklistIndex)
+{
+    TestWorklistDirectory directory;
+    for( size_t n = 1; n < MAX_FILES; ++n )
+        OFCHECK( directory.writeFile( n, testFiles[n - 1] ) );
+
+    TestIndexManager manager;
+    manager.SetEnableRejectionOfIncompleteWlFiles( OFFalse );
+    manager.SetEnableIndexOfWlFiles( OFTrue );
+    OFCHECK( manager.ConnectToFileSystem( directory.path() ).good() );
+    OFCHECK( manager.IsCalledApplicationEntityTitleSupported( TEST_AETITLE ) );
+
+    OFVector<DcmDataset *> datasets;
+    readFiles( directory, datasets );
+    OFCHECK_EQUAL( datasets.size(), OFstatic_cast(size_t, MAX_FILES - 1) );
+    OFCHECK( compareWithFullScan( manager, datasets ) > 0 );
+    OFCHECK_EQUAL( manager.GetIndex()->GetNumberOfEntries(), OFstatic_cast(size_t, MAX_FILES - 1) );
+
+    // create, modify and delete worklist files while the index is in use
+    OFCHECK( directory.writeFile( MAX_FILES, testFiles[MAX_FILES - 1] ) );
+    TestValues values = testFiles[2];
+    values.patientID = "12";
+    values.modality = "MR";
+    OFCHECK( directory.writeFile( 3, values ) );
+    OFCHECK( OFStandard::deleteFile( directory.fileName( 5 ) ) );
+    // a change that neither modifies the size nor the modification time of the file
+    // is only detected if the directory is watched for changes
+    values = testFiles[1];
+    values.modality = "CT";
+    if( manager.GetIndex()->StartWatching() )
+        OFCHECK( directory.writeFile( 2, values ) );
+
+    readFiles( directory, datasets );
+    OFCHECK_EQUAL( datasets.size(), OFstatic_cast(size_t, MAX_FILES - 1) );
+    OFCHECK( compareWithFullScan( manager, datasets ) > 0 );
+    OFCHECK_EQUAL( manager.GetIndex()->GetNumberOfEntries(), OFstatic_cast(size_t, MAX_FILES - 1) );
+
+    for( size_t i = 0; i < datasets.size(); ++i )
+        delete datasets[i];
+    manager.DisconnectFromFileSystem();
+}
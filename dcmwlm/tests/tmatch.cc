@@ -0,0 +1,255 @@
+/*
+ *
+ *  Copyright (C) 2016, OFFIS e.V.
+ *  All rights reserved.  See COPYRIGHT file for details.
+ *
+ *  This software and supporting documentation were developed by
+ *
+ *    OFFIS e.V.
+ *    R&D Division Health
+ *    Escherweg 2
+ *    D-26121 Oldenburg, Germany
+ *
+ *
+ *  Module:  dcmwlm
+ *
+ *  Author:  OFFIS DICOM Team
+ *
+ *  Purpose: test that a compiled matching plan gives the same results as
+ *           the matching functions of the file system interaction manager
+ *
+ */
+
+
+#include "dcmtk/config/osconfig.h"    /* make sure OS specific configuration is included first */
+
+#include "dcmtk/ofstd/oftest.h"
+#include "dcmtk/dcmdata/dcdatset.h"
+#include "dcmtk/dcmdata/dcdeftag.h"
+#include "dcmtk/dcmwlm/wlfsim.h"
+#include "dcmtk/dcmwlm/wlmatch.h"
+
+
+/* values of the matching key attributes used by the test, NULL if absent */
+struct TestValues
+{
+    const char *aetitle;
+    const char *date;
+    const char *time;
+    const char *modality;
+    const char *patientName;
+    const char *patientID;
+    const char *birthDate;
+};
+
+/* worklist records with present, empty and absent values */
+static const TestValues testRecords[] =
+{
+    { "AE1",  "20160101", "083000",   "CT",  "Doe^John",   "123",  "19700101" },
+    { "AE2",  "20160102", "1200",     "MR",  "Doe^Jane",   "124",  "19800615" },
+    { "AE1",  "20151231", "235959.5", "CT ", "Smith^Anna", "1234", "19700101" },
+    { "AE10", "20160101", "0800",     "US",  "Doe",        "12",   "" },
+    { NULL,   "20160103", NULL,       "CT",  "Do^e",       NULL,   NULL },
+    { "",     NULL,       "10",       NULL,  "",           "",     "20000229" },
+    { "AE1",  "20160101", "",         "",    "Do*e^John",  "1?3",  "19991231" },
+    { "AE2 ", "20160110", "000000",   "MR",  "Doe^John ",  "123 ", "19700101" },
+    { "AE3",  "2016010",  "1300",     "CT",  "Mueller^Jo", "999",  "1970" }
+};
+
+/* the date and time values for the search masks, including open-ended ranges */
+static const char *testDates[] =
+{
+    NULL, "", "20160101", "20160101-", "-20160101", "20151231-20160102",
+    "20160102-20160101", "20160101-20160101", "2016010", "-", "20160101-2016010"
+};
+static const char *testTimes[] =
+{
+    NULL, "", "0830", "083000", "0800-", "-1200", "0800-1200", "120000-235959",
+    "1200-0800", "10", "-", "08-09"
+};
+
+/* the string values for the search masks, with wild cards */
+static const char *testStrings[] =
+{
+    NULL, "", "*", "?", "Doe^John", "Doe*", "*Jo*", "D?e^J*", "Do*e^*n", "**",
+    "????", "1?3", "12*", "123", "AE1", "AE?", "AE1*", "CT", "M?", "*oh?", "D\\oe"
+};
+
+/* the birth dates for the search masks */
+static const char *testBirthDates[] =
+{
+    NULL, "", "19700101", "19700101-", "-19800101", "19700102-19991231", "1970"
+};
+
+#define ARRAY_SIZE(a) (sizeof(a) / sizeof(a[0]))
+
+
+/* file system interaction manager which provides access to its matching functions */
+class TestInteractionManager : public WlmFileSystemInteractionManager
+{
+  public:
+    OFBool Matches( DcmDataset *dataset, DcmDataset *searchMask )
+    {
+        return DatasetMatchesSearchMask( dataset, searchMask );
+    }
+
+    void GetValues( DcmDataset *dataset, const char **&values )
+    {
+        DetermineMatchingKeyAttributeValues( dataset, values );
+    }
+};
+
+/* create a dataset with the given values */
+static void makeDataset( DcmDataset &dset, const TestValues &values )
+{
+    dset.clear();
+    if( values.aetitle )     dset.putAndInsertString( DCM_ScheduledStationAETitle, values.aetitle );
+    if( values.date )        dset.putAndInsertString( DCM_ScheduledProcedureStepStartDate, values.date );
+    if( values.time )        dset.putAndInsertString( DCM_ScheduledProcedureStepStartTime, values.time );
+    if( values.modality )    dset.putAndInsertString( DCM_Modality, values.modality );
+    if( values.patientName ) dset.putAndInsertString( DCM_PatientName, values.patientName );
+    if( values.patientID )   dset.putAndInsertString( DCM_PatientID, values.patientID );
+    if( values.birthDate )   dset.putAndInsertString( DCM_PatientBirthDate, values.birthDate );
+}
+
+/* compare the results of the plan for the given search mask with the results of
+ * DatasetMatchesSearchMask() for all test records, both for the evaluation of
+ * single records and for filtering all records at once
+ * @return number of matching records
+ */
+static size_t compareResults( TestInteractionManager &manager,
+                              DcmDataset *records,
+                              const WlmMatchingRecordSet &recordSet,
+                              const TestValues &maskValues )
+{
+    DcmDataset searchMask;
+    makeDataset( searchMask, maskValues );
+    const char **values = NULL;
+    manager.GetValues( &searchMask, values );
+    WlmMatchingPlan plan;
+    plan.Compile( values );
+    delete[] values;
+
+    OFVector<size_t> rows;
+    for( size_t i = 0; i < ARRAY_SIZE(testRecords); ++i )
+        rows.push_back( i );
+    if( plan.MatchesNothing() )
+        rows.clear();
+    else
+        plan.Filter( recordSet, rows );
+
+    size_t matches = 0;
+    size_t pos = 0;
+    for( size_t i = 0; i < ARRAY_SIZE(testRecords); ++i )
+    {
+        const OFBool expected = manager.Matches( &records[i], &searchMask );
+        const OFBool single = !plan.MatchesNothing() && plan.Matches( recordSet, i );
+        const OFBool filtered = ( pos < rows.size() ) && ( rows[pos] == i );
+        if( filtered )
+            ++pos;
+        if( ( single != expected ) || ( filtered != expected ) )
+        {
+            OFOStringStream stream;
+            stream << "record " << i << ", search mask"
+                   << " AE=" << ( maskValues.aetitle ? maskValues.aetitle : "(absent)" )
+                   << " date=" << ( maskValues.date ? maskValues.date : "(absent)" )
+                   << " time=" << ( maskValues.time ? maskValues.time : "(absent)" )
+                   << " modality=" << ( maskValues.modality ? maskValues.modality : "(absent)" )
+                   << " name=" << ( maskValues.patientName ? maskValues.patientName : "(absent)" )
+                   << " id=" << ( maskValues.patientID ? maskValues.patientID : "(absent)" )
+                   << " birth=" << ( maskValues.birthDate ? maskValues.birthDate : "(absent)" )
+                   << ": expected " << ( expected ? "match" : "no match" ) << OFStringStream_ends;
+            OFSTRINGSTREAM_GETSTR( stream, message )
+            OFCHECK_FAIL( message );
+            OFSTRINGSTREAM_FREESTR( message )
+        }
+        if( expected )
+            ++matches;
+    }
+    OFCHECK_EQUAL( pos, rows.size() );
+    return matches;
+}
+
+
+OFTEST(dcmwlm_matchingPlan)
+{
+    TestInteractionManager manager;
+    const size_t numRecords = ARRAY_SIZE(testRecords);
+    DcmDataset records[ARRAY_SIZE(testRecords)];
+    WlmMatchingRecordSet recordSet;
+    for( size_t i = 0; i < numRecords; ++i )
+    {
+        makeDataset( records[i], testRecords[i] );
+        const char **values = NULL;
+        manager.GetValues( &records[i], values );
+        recordSet.AddRecord( values );
+        delete[] values;
+    }
+    OFCHECK_EQUAL( recordSet.GetNumberOfRecords(), numRecords );
+
+    /* the search masks must not be trivial */
+    size_t someMatches = 0;
+    size_t noMatches = 0;
+    const TestValues empty = { NULL, NULL, NULL, NULL, NULL, NULL, NULL };
+
+    /* an empty search mask matches all records */
+    OFCHECK_EQUAL( compareResults( manager, records, recordSet, empty ), numRecords );
+
+    /* string attributes with single value and wild card matching */
+    for( size_t s = 0; s < ARRAY_SIZE(testStrings); ++s )
+    {
+        for( int attr = 0; attr < 4; ++attr )
+        {
+            TestValues mask = empty;
+            switch( attr )
+            {
+                case 0: mask.aetitle = testStrings[s]; break;
+                case 1: mask.modality = testStrings[s]; break;
+                case 2: mask.patientName = testStrings[s]; break;
+                default: mask.patientID = testStrings[s]; break;
+            }
+            const size_t matches = compareResults( manager, records, recordSet, mask );
+            if( matches == 0 ) ++noMatches; else if( matches < numRecords ) ++someMatches;
+        }
+    }
+
+    /* date and time, each on its own and combined (date time range matching) */
+    for( size_t d = 0; d < ARRAY_SIZE(testDates); ++d )
+    {
+        for( size_t t = 0; t < ARRAY_SIZE(testTimes); ++t )
+        {
+            TestValues mask = empty;
+            mask.date = testDates[d];
+            mask.time = testTimes[t];
+            const size_t matches = compareResults( manager, records, recordSet, mask );
+            if( matches == 0 ) ++noMatches; else if( matches < numRecords ) ++someMatches;
+        }
+    }
+
+    /* date range matching on a second date attribute */
+    for( size_t b = 0; b < ARRAY_SIZE(testBirthDates); ++b )
+    {
+        TestValues mask = empty;
+        mask.birthDate = testBirthDates[b];
+        const size_t matches = compareResults( manager, records, recordSet, mask );
+        if( matches == 0 ) ++noMatches; else if( matches < numRecords ) ++someMatches;
+    }
+
+    /* several attributes at once */
+    for( size_t d = 0; d < ARRAY_SIZE(testDates); ++d )
+    {
+        for( size_t s = 0; s < ARRAY_SIZE(testStrings); ++s )
+        {
+            TestValues mask = empty;
+            mask.date = testDates[d];
+            mask.time = "0800-";
+            mask.aetitle = "AE1";
+            mask.patientName = testStrings[s];
+            const size_t matches = compareResults( manager, records, recordSet, mask );
+            if( matches == 0 ) ++noMatches; else if( matches < numRecords ) ++someMatches;
+        }
+    }
+
+    OFCHECK( someMatches > 0 );
+    OFCHECK( noMatches > 0 );
+}
@@ -0,0 +1,294 @@
+/*
+ *
+ *  Copyright (C) 2016, OFFIS e.V.
+ *  All rights reserved.  See COPYRIGHT file for details.
+ *
+ *  This software and supporting documentation were developed by
+ *
+ *    OFFIS e.V.
+ *    R&D Division Health
+ *    Escherweg 2
+ *    D-26121 Oldenburg, Germany
+ *
+ *
+ *  Module:  dcmwlm
+ *
+ *  Author:  OFFIS DICOM Team
+ *
+ *  Purpose: test the multi-thread mode of the worklist SCP with concurrent
+ *           queries and an in-memory index of the worklist files
+ *
+ */
+
+
+#include "dcmtk/config/osconfig.h"    /* make sure OS specific configuration is included first */
+
+#ifdef WITH_THREADS
+
+#define INCLUDE_CSTDIO
+#include "dcmtk/ofstd/ofstdinc.h"
+
+#include "dcmtk/ofstd/oftest.h"
+#include "dcmtk/ofstd/ofthread.h"
+#include "dcmtk/ofstd/oftempf.h"
+#include "dcmtk/dcmdata/dcfilefo.h"
+#include "dcmtk/dcmdata/dcdeftag.h"
+#include "dcmtk/dcmdata/dcitem.h"
+#include "dcmtk/dcmnet/scu.h"
+#include "dcmtk/dcmwlm/wldsfs.h"
+#include "dcmtk/dcmwlm/wlmactmg.h"
+
+#define TEST_PORT 11130
+#define TEST_AETITLE "WLTEST"
+#define NUM_CLIENTS 4
+#define NUM_QUERIES 5
+#define NUM_FILES 6
+
+
+/* temporary worklist directory with a subdirectory for the called AE title */
+class TestWorklistDirectory
+{
+  public:
+    TestWorklistDirectory()
+    : directory_()
+    , aeDirectory_()
+    , counter_( 0 )
+    {
+        OFTempFile temp;
+        directory_ = temp.getFilename();
+        directory_ += ".wl";
+        OFStandard::createDirectory( directory_, "" );
+        OFStandard::combineDirAndFilename( aeDirectory_, directory_, TEST_AETITLE );
+        OFStandard::createDirectory( aeDirectory_, directory_ );
+        OFString lockfile;
+        OFStandard::combineDirAndFilename( lockfile, aeDirectory_, LOCKFILENAME );
+        FILE *f = fopen( lockfile.c_str(), "w" );
+        if( f != NULL )
+            fclose( f );
+    }
+
+    ~TestWorklistDirectory()
+    {
+        OFList<OFString> files;
+        OFStandard::searchDirectoryRecursively( directory_, files );
+        for( OFListIterator(OFString) it = files.begin(); it != files.end(); ++it )
+            OFStandard::deleteFile( *it );
+#ifdef _WIN32
+        _rmdir( aeDirectory_.c_str() );
+        _rmdir( directory_.c_str() );
+#else
+        rmdir( aeDirectory_.c_str() );
+        rmdir( directory_.c_str() );
+#endif
+    }
+
+    /// return the path of the worklist directory
+    const char *path() const
+    {
+        return directory_.c_str();
+    }
+
+    /// write a new worklist file for the given patient
+    OFBool addFile( const char *patientID )
+    {
+        char name[32];
+        sprintf( name, "wklist%u.wl", ++counter_ );
+        OFString filename;
+        OFStandard::combineDirAndFilename( filename, aeDirectory_, name );
+        DcmFileFormat fileformat;
+        DcmDataset *dset = fileformat.getDataset();
+        dset->putAndInsertString( DCM_PatientName, "Doe^John" );
+        dset->putAndInsertString( DCM_PatientID, patientID );
+        DcmItem *item = NULL;
+        if( dset->findOrCreateSequenceItem( DCM_ScheduledProcedureStepSequence, item ).bad() )
+            return OFFalse;
+        item->putAndInsertString( DCM_ScheduledStationAETitle, TEST_AETITLE );
+        item->putAndInsertString( DCM_ScheduledProcedureStepStartDate, "20160101" );
+        item->putAndInsertString( DCM_ScheduledProcedureStepStartTime, "0800" );
+        item->putAndInsertString( DCM_Modality, "CT" );
+        return fileformat.saveFile( filename.c_str(), EXS_LittleEndianExplicit ).good();
+    }
+
+  private:
+    OFString directory_;
+    OFString aeDirectory_;
+    unsigned int counter_;
+};
+
+/* activity manager which handles associations in its own thread until it is stopped */
+class TestWorklistServer : public WlmActivityManager, public OFThread
+{
+  public:
+    TestWorklistServer( WlmDataSource *dataSource, T_ASC_Network *net )
+    : WlmActivityManager( dataSource, TEST_PORT, OFFalse, OFFalse, 0, 0, ASC_DEFAULTMAXPDU,
+                          EXS_Unknown, OFFalse, OFFalse, NUM_CLIENTS + 1, DIMSE_BLOCKING, 0, 30 )
+    , net_( net )
+    , stop_( OFFalse )
+    , mutex_()
+    {
+        SetMultiThreadMode( OFTrue );
+    }
+
+    void stop()
+    {
+        mutex_.lock();
+        stop_ = OFTrue;
+        mutex_.unlock();
+    }
+
+  protected:
+    void run()
+    {
+        OFBool done = OFFalse;
+        while( !done )
+        {
+            /* returns after one second if there is no association request */
+            WaitForAssociation( net_ );
+            JoinFinishedThreads();
+            mutex_.lock();
+            done = stop_;
+            mutex_.unlock();
+        }
+    }
+
+  private:
+    T_ASC_Network *net_;
+    OFBool stop_;
+    OFMutex mutex_;
+};
+
+/* client that sends several worklist queries on one association */
+class TestWorklistClient : public DcmSCU, public OFThread
+{
+  public:
+    TestWorklistClient()
+    : patientID()
+    , numAllResults( 0 )
+    , numPatientResults( 0 )
+    , result()
+    {
+    }
+
+    /// ID of the patient which is queried for in addition to all patients
+    OFString patientID;
+    /// number of results of the queries for all patients (sum over all queries)
+    unsigned int numAllResults;
+    /// number of results of the queries for the above patient (sum over all queries)
+    unsigned int numPatientResults;
+    /// status of the last network operation
+    OFCondition result;
+
+  protected:
+    void run()
+    {
+        OFList<OFString> xfers;
+        xfers.push_back( UID_LittleEndianExplicitTransferSyntax );
+        addPresentationContext( UID_FINDModalityWorklistInformationModel, xfers );
+        setAETitle( "WLCLIENT" );
+        setPeerAETitle( TEST_AETITLE );
+        setPeerHostName( "localhost" );
+        setPeerPort( TEST_PORT );
+        setDIMSEBlockingMode( DIMSE_NONBLOCKING );
+        setDIMSETimeout( 30 );
+        result = initNetwork();
+        if( result.good() )
+            result = negotiateAssociation();
+        if( result.bad() )
+            return;
+        const T_ASC_PresentationContextID presID = findPresentationContextID( UID_FINDModalityWorklistInformationModel, "" );
+        for( unsigned int i = 0; ( i < NUM_QUERIES ) && result.good(); ++i )
+        {
+            numAllResults += query( presID, "" );
+            if( result.good() )
+                numPatientResults += query( presID, patientID.c_str() );
+        }
+        releaseAssociation();
+    }
+
+  private:
+    unsigned int query( T_ASC_PresentationContextID presID, const char *mask )
+    {
+        DcmDataset query;
+        query.putAndInsertString( DCM_PatientName, "" );
+        query.putAndInsertString( DCM_PatientID, mask );
+        OFList<QRResponse *> responses;
+        result = sendFINDRequest( presID, &query, &responses );
+        unsigned int count = 0;
+        for( OFListIterator(QRResponse *) it = responses.begin(); it != responses.end(); ++it )
+        {
+            if( DICOM_PENDING_STATUS( (*it)->m_status ) && ( (*it)->m_dataset != NULL ) )
+                ++count;
+            delete *it;
+        }
+        return count;
+    }
+};
+
+/* run one round of concurrent queries and check the results. The clients
+ * query for the patients of the second and following worklist files.
+ */
+static void runClients( unsigned int numFiles )
+{
+    TestWorklistClient clients[NUM_CLIENTS];
+    for( unsigned int i = 0; i < NUM_CLIENTS; ++i )
+    {
+        char patientID[16];
+        sprintf( patientID, "P%u", i + 2 );
+        clients[i].patientID = patientID;
+        clients[i].start();
+    }
+    for( unsigned int i = 0; i < NUM_CLIENTS; ++i )
+    {
+        clients[i].join();
+        OFCHECK( clients[i].result.good() );
+        OFCHECK_EQUAL( clients[i].numAllResults, NUM_QUERIES * numFiles );
+        OFCHECK_EQUAL( clients[i].numPatientResults, NUM_QUERIES );
+    }
+}
+
+
+OFTEST(dcmwlm_multiThreadServer)
+{
+    TestWorklistDirectory directory;
+    for( unsigned int i = 1; i <= NUM_FILES; ++i )
+    {
+        char patientID[16];
+        sprintf( patientID, "P%u", i );
+        OFCHECK( directory.addFile( patientID ) );
+    }
+
+    WlmDataSourceFileSystem dataSource;
+    dataSource.SetDfPath( directory.path() );
+    dataSource.SetEnableRejectionOfIncompleteWlFiles( OFFalse );
+    dataSource.SetEnableIndexOfWlFiles( OFTrue );
+    OFCHECK( dataSource.ConnectToDataSource().good() );
+
+    T_ASC_Network *net = NULL;
+    OFCHECK( ASC_initializeNetwork( NET_ACCEPTOR, TEST_PORT, 30, &net ).good() );
+    {
+        TestWorklistServer server( &dataSource, net );
+        server.start();
+
+        /* all clients query at the same time */
+        runClients( NUM_FILES );
+
+        /* a file added in the meantime is found by the next queries */
+        OFCHECK( directory.addFile( "P1" ) );
+        runClients( NUM_FILES + 1 );
+        /* the patient of the new file now has two worklist entries */
+        TestWorklistClient client;
+        client.patientID = "P1";
+        client.start();
+        client.join();
+        OFCHECK( client.result.good() );
+        OFCHECK_EQUAL( client.numPatientResults, 2 * NUM_QUERIES );
+
+        server.stop();
+        server.join();
+        /* the destructor of the activity manager waits for the remaining worker threads */
+    }
+    ASC_dropNetwork( &net );
+    dataSource.DisconnectFromDataSource();
+}
+
+#endif // WITH_THREADS